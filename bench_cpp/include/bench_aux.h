@@ -0,0 +1,92 @@
+#ifndef _QIF_bench_aux_h_
+#define _QIF_bench_aux_h_
+
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+
+#include "qif"
+
+using namespace qif;
+using std::string;
+
+
+// Inputs are random but generated from a fixed seed (set in main), so that runs are comparable over time.
+// Benchmarks are templated on eT and registered for double, float and rat (with smaller sizes for rat, which is
+// orders of magnitude slower).
+//
+
+// sizes for the benchmarks of each type
+template<typename eT>
+inline
+void bench_sizes(benchmark::internal::Benchmark* b) {
+	if constexpr (std::is_same<eT, rat>::value)
+		b->RangeMultiplier(2)->Range(8, 64);
+	else
+		b->RangeMultiplier(4)->Range(16, 1024);
+}
+
+// random channel in which each entry is non-zero with probability density (each row has at least one non-zero)
+template<typename eT>
+inline
+Chan<eT> bench_channel(uint n_rows, uint n_cols, double density = 1.0) {
+	Chan<eT> C = channel::randu<eT>(n_rows, n_cols);
+	if(density >= 1.0)
+		return C;
+
+	for(uint x = 0; x < n_rows; x++) {
+		for(uint y = 0; y < n_cols; y++)
+			if(rng::randu<double>() >= density)
+				C(x, y) = eT(0);
+		if(arma::accu(C.row(x)) == eT(0))
+			C(x, rng::randu<double>() * n_cols) = eT(1);
+	}
+	channel::normalize(C);
+	return C;
+}
+
+// For the float benchmarks: reports in the "rel_err" counter the relative error of measure(pi, C) with respect to the
+// same measure on the double versions of pi, C (the float path reads float but accumulates in double)
+template<typename eT, typename F>
+inline
+void report_float_error(benchmark::State& state, F measure, const Prob<eT>& pi, const Chan<eT>& C) {
+	if constexpr (std::is_same<eT, float>::value) {
+		double d = measure(arma::conv_to<prob>::from(pi), arma::conv_to<chan>::from(C));
+		state.counters["rel_err"] = std::abs(double(measure(pi, C)) - d) / std::abs(d);
+	}
+}
+
+// LP solvers, selected by index in the benchmark arguments. Those not compiled in are skipped.
+const std::vector<string> bench_solvers = { lp::Solver::INTERNAL, lp::Solver::GLPK, lp::Solver::GLOP };
+
+// sets lp::Defaults::solver to bench_solvers[i] for the lifetime of the object, ok is false (and the benchmark is
+// skipped) if the solver is not available
+class BenchSolver {
+	private:
+		string prev = lp::Defaults::solver;
+
+	public:
+		bool ok = true;
+
+		BenchSolver(benchmark::State& state, uint i) {
+			const string& s = bench_solvers.at(i);
+			#ifndef QIF_USE_GLPK
+			if(s == lp::Solver::GLPK) ok = false;
+			#endif
+			#ifndef QIF_USE_ORTOOLS
+			if(s == lp::Solver::GLOP) ok = false;
+			#endif
+
+			if(ok) {
+				lp::Defaults::solver = s;
+				state.SetLabel(s);
+			} else {
+				state.SkipWithError((s + " not available").c_str());
+			}
+		}
+		~BenchSolver() {
+			lp::Defaults::solver = prev;
+		}
+};
+
+#endif
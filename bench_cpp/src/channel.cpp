@@ -0,0 +1,62 @@
+#include "bench_aux.h"
+
+
+// args: size, density (%)
+template<typename eT>
+void hyper_args(benchmark::internal::Benchmark* b) {
+	if constexpr (std::is_same<eT, rat>::value) {
+		for(int n : { 16, 32, 64 })
+			b->Args({ n, 100 });
+	} else {
+		for(int n : { 64, 256, 1024 })
+			for(int d : { 1, 10, 100 })
+				b->Args({ n, d });
+	}
+}
+
+template<typename eT>
+void BM_hyper(benchmark::State& state) {
+	uint n = state.range(0);
+	Chan<eT> C = bench_channel<eT>(n, n, state.range(1) / 100.0);
+	Prob<eT> pi = probab::randu<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(channel::hyper(C, pi));
+
+	state.SetComplexityN(n);
+}
+
+template<typename eT>
+void BM_hyper_sparse(benchmark::State& state) {
+	uint n = state.range(0);
+	SpChan<eT> C(bench_channel<eT>(n, n, state.range(1) / 100.0));
+	Prob<eT> pi = probab::randu<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(channel::hyper(C, pi));
+
+	state.SetComplexityN(n);
+}
+
+template<typename eT>
+void BM_posteriors(benchmark::State& state) {
+	uint n = state.range(0);
+	Chan<eT> C = bench_channel<eT>(n, n);
+	Prob<eT> pi = probab::randu<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(channel::posteriors(C, pi));
+
+	state.SetComplexityN(n);
+}
+
+BENCHMARK_TEMPLATE(BM_hyper, double)->Apply(hyper_args<double>);
+BENCHMARK_TEMPLATE(BM_hyper, float )->Apply(hyper_args<float >);
+BENCHMARK_TEMPLATE(BM_hyper, rat   )->Apply(hyper_args<rat   >);
+
+BENCHMARK_TEMPLATE(BM_hyper_sparse, double)->Apply(hyper_args<double>);
+BENCHMARK_TEMPLATE(BM_hyper_sparse, float )->Apply(hyper_args<float >);
+
+BENCHMARK_TEMPLATE(BM_posteriors, double)->Apply(bench_sizes<double>)->Complexity();
+BENCHMARK_TEMPLATE(BM_posteriors, float )->Apply(bench_sizes<float >)->Complexity();
+BENCHMARK_TEMPLATE(BM_posteriors, rat   )->Apply(bench_sizes<rat   >)->Complexity();
@@ -0,0 +1,14 @@
+#include "bench_aux.h"
+
+
+int main(int argc, char **argv) {
+	qif::rng::set_seed(0);			// fixed inputs, see bench_aux.h
+
+	::benchmark::Initialize(&argc, argv);
+	if(::benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+
+	::benchmark::RunSpecifiedBenchmarks();
+	::benchmark::Shutdown();
+	return 0;
+}
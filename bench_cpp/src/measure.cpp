@@ -0,0 +1,58 @@
+#include "bench_aux.h"
+
+using namespace measure;
+
+
+template<typename eT>
+void BM_bayes_vuln_posterior(benchmark::State& state) {
+	uint n = state.range(0);
+	Chan<eT> C = bench_channel<eT>(n, n);
+	Prob<eT> pi = probab::randu<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(bayes_vuln::posterior(pi, C));
+
+	state.SetComplexityN(n);
+	report_float_error(state, [](const auto& pi, const auto& C) { return bayes_vuln::posterior(pi, C); }, pi, C);
+}
+
+template<typename eT>
+void BM_g_vuln_posterior(benchmark::State& state) {
+	uint n = state.range(0);
+	Chan<eT> C = bench_channel<eT>(n, n);
+	Prob<eT> pi = probab::randu<eT>(n);
+	Mat<eT> G = g_vuln::G_id<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(g_vuln::posterior(G, pi, C));
+
+	state.SetComplexityN(n);
+	report_float_error(state, [&](const auto& pi, const auto& C) {
+		typedef typename std::decay_t<decltype(C)>::elem_type T;
+		return g_vuln::posterior(Mat<T>(arma::conv_to<Mat<T>>::from(G)), pi, C);
+	}, pi, C);
+}
+
+template<typename eT>
+void BM_shannon_posterior(benchmark::State& state) {
+	uint n = state.range(0);
+	Chan<eT> C = bench_channel<eT>(n, n);
+	Prob<eT> pi = probab::randu<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(shannon::posterior(pi, C));
+
+	state.SetComplexityN(n);
+	report_float_error(state, [](const auto& pi, const auto& C) { return shannon::posterior(pi, C); }, pi, C);
+}
+
+BENCHMARK_TEMPLATE(BM_bayes_vuln_posterior, double)->Apply(bench_sizes<double>)->Complexity();
+BENCHMARK_TEMPLATE(BM_bayes_vuln_posterior, float )->Apply(bench_sizes<float >)->Complexity();
+BENCHMARK_TEMPLATE(BM_bayes_vuln_posterior, rat   )->Apply(bench_sizes<rat   >)->Complexity();
+
+BENCHMARK_TEMPLATE(BM_g_vuln_posterior, double)->Apply(bench_sizes<double>)->Complexity();
+BENCHMARK_TEMPLATE(BM_g_vuln_posterior, float )->Apply(bench_sizes<float >)->Complexity();
+BENCHMARK_TEMPLATE(BM_g_vuln_posterior, rat   )->Apply(bench_sizes<rat   >)->Complexity();
+
+BENCHMARK_TEMPLATE(BM_shannon_posterior, double)->Apply(bench_sizes<double>)->Complexity();
+BENCHMARK_TEMPLATE(BM_shannon_posterior, float )->Apply(bench_sizes<float >)->Complexity();
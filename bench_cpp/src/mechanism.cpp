@@ -0,0 +1,57 @@
+#include "bench_aux.h"
+
+// mechanisms are only defined for native types
+
+using namespace mechanism;
+
+
+template<typename eT>
+void BM_geometric(benchmark::State& state) {
+	uint n = state.range(0);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(d_privacy::geometric<eT>(n, eT(1)/2));
+
+	state.SetComplexityN(n);
+}
+
+// args: grid width (the channel has width^2 rows/cols)
+template<typename eT>
+void BM_planar_laplace_grid(benchmark::State& state) {
+	uint w = state.range(0);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(geo_ind::planar_laplace_grid<eT>(w, w, eT(1), eT(1)/2));
+
+	state.SetComplexityN(w * w);
+}
+
+// args: size, solver index
+template<typename eT>
+void BM_min_loss_given_d(benchmark::State& state) {
+	BenchSolver solver(state, state.range(1));
+	if(!solver.ok)
+		return;
+
+	uint n = state.range(0);
+	auto d = eT(1)/2 * metric::euclidean<eT, uint>();
+	auto loss = metric::discrete<eT, uint>();
+	Prob<eT> pi = probab::uniform<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(d_privacy::min_loss_given_d<eT>(pi, n, d, loss));
+}
+
+static void lp_args(benchmark::internal::Benchmark* b) {
+	for(int n : { 8, 16, 32 })
+		for(int s = 0; s < int(bench_solvers.size()); s++)
+			b->Args({ n, s });
+}
+
+BENCHMARK_TEMPLATE(BM_geometric, double)->Apply(bench_sizes<double>)->Complexity();
+BENCHMARK_TEMPLATE(BM_geometric, float )->Apply(bench_sizes<float >)->Complexity();
+
+BENCHMARK_TEMPLATE(BM_planar_laplace_grid, double)->DenseRange(4, 16, 4)->Complexity();
+BENCHMARK_TEMPLATE(BM_planar_laplace_grid, float )->DenseRange(4, 16, 4)->Complexity();
+
+BENCHMARK_TEMPLATE(BM_min_loss_given_d, double)->Apply(lp_args)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,52 @@
+#include "bench_aux.h"
+
+
+// points 0, 1, ..., n-1 on a line
+template<typename eT>
+Metric<eT, uint> bench_point_metric() {
+	return metric::euclidean<eT, uint>();
+}
+
+template<typename eT>
+void BM_kantorovich_fastemd(benchmark::State& state) {
+	uint n = state.range(0);
+	auto kant = metric::kantorovich_fastemd<eT, Prob<eT>>(bench_point_metric<eT>());
+	Prob<eT> a = probab::randu<eT>(n),
+			 b = probab::randu<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(kant(a, b));
+
+	state.SetComplexityN(n);
+}
+
+// kantorovich via LP, for each solver. args: size, solver index
+template<typename eT>
+void BM_kantorovich_lp(benchmark::State& state) {
+	BenchSolver solver(state, state.range(1));
+	if(!solver.ok)
+		return;
+
+	uint n = state.range(0);
+	auto kant = metric::kantorovich_lp<eT, Prob<eT>>(bench_point_metric<eT>());
+	Prob<eT> a = probab::randu<eT>(n),
+			 b = probab::randu<eT>(n);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(kant(a, b));
+}
+
+template<typename eT>
+void solver_args(benchmark::internal::Benchmark* b) {
+	for(int n : { 8, 32, 128 })
+		for(int s = 0; s < int(bench_solvers.size()); s++)
+			if(s == 0 || !std::is_same<eT, rat>::value)		// only the internal solver supports rat
+				b->Args({ n, s });
+}
+
+BENCHMARK_TEMPLATE(BM_kantorovich_fastemd, double)->RangeMultiplier(4)->Range(16, 1024)->Complexity();
+BENCHMARK_TEMPLATE(BM_kantorovich_fastemd, float )->RangeMultiplier(4)->Range(16, 1024)->Complexity();
+BENCHMARK_TEMPLATE(BM_kantorovich_fastemd, rat   )->RangeMultiplier(4)->Range(16, 256)->Complexity();
+
+BENCHMARK_TEMPLATE(BM_kantorovich_lp, double)->Apply(solver_args<double>);
+BENCHMARK_TEMPLATE(BM_kantorovich_lp, rat   )->Apply(solver_args<rat   >);
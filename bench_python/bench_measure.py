@@ -0,0 +1,43 @@
+import pytest
+import numpy as np
+from qif import *
+
+sizes = [10, 100, 1000]
+rat_sizes = [5, 20]
+
+
+@pytest.fixture(autouse=True)
+def seed():
+	np.random.seed(0)
+
+
+@pytest.mark.parametrize("n", sizes)
+def bench_bayes_vuln_posterior(qif_bench, n):
+	pi, C = probab.randu(n), channel.randu(n)
+	qif_bench(measure.bayes_vuln.posterior, pi, C)
+
+@pytest.mark.parametrize("n", rat_sizes)
+def bench_bayes_vuln_posterior_rat(qif_bench, n):
+	pi, C = probab.randu(n, rat), channel.randu(n, n, rat)
+	qif_bench(measure.bayes_vuln.posterior, pi, C)
+
+@pytest.mark.parametrize("n", sizes)
+def bench_bayes_vuln_posterior_c_order(qif_bench, n):
+	# C-ordered input, converted (copied) by the binding layer
+	pi, C = probab.randu(n), np.ascontiguousarray(channel.randu(n))
+	qif_bench(measure.bayes_vuln.posterior, pi, C)
+
+@pytest.mark.parametrize("n", sizes)
+def bench_g_vuln_posterior(qif_bench, n):
+	pi, C, G = probab.randu(n), channel.randu(n), measure.g_vuln.G_id(n)
+	qif_bench(measure.g_vuln.posterior, G, pi, C)
+
+@pytest.mark.parametrize("n", sizes)
+def bench_shannon_posterior(qif_bench, n):
+	pi, C = probab.randu(n), channel.randu(n)
+	qif_bench(measure.shannon.posterior, pi, C)
+
+@pytest.mark.parametrize("n", sizes)
+def bench_hyper(qif_bench, n):
+	pi, C = probab.randu(n), channel.randu(n)
+	qif_bench(channel.hyper, C, pi)
@@ -0,0 +1,41 @@
+import pytest
+import numpy as np
+from qif import *
+
+
+@pytest.mark.parametrize("width", [5, 10, 20])
+def bench_planar_laplace_grid(qif_bench, width):
+	qif_bench(mechanism.geo_ind.planar_laplace_grid, width, width, 1.0, 1.0)
+
+@pytest.mark.parametrize("width", [5, 10, 20])
+def bench_planar_geometric_grid(qif_bench, width):
+	qif_bench(mechanism.geo_ind.planar_geometric_grid, width, width, 1.0, 1.0)
+
+# The metric callbacks below run inside the C++ call, so their cost shows up as C++ time. Comparing them with
+# exponential_matrix gives the cost of going through python for the metric.
+#
+@pytest.mark.parametrize("n", [10, 100])
+def bench_exponential_metric(qif_bench, n):
+	# a metric created in C++, still called through python for each pair
+	qif_bench(mechanism.d_privacy.exponential, n, metric.euclidean(uint))
+
+@pytest.mark.parametrize("n", [10, 100, 1000])
+def bench_exponential_vectorised_metric(qif_bench, n):
+	# a python metric that works on arrays, evaluated once on the whole grid
+	qif_bench(mechanism.d_privacy.exponential, n, lambda x, y: np.abs(x - y))
+
+@pytest.mark.parametrize("n", [10, 100])
+def bench_exponential_scalar_metric(qif_bench, n):
+	# a python metric that only works on scalars, called back for each pair
+	qif_bench(mechanism.d_privacy.exponential, n, lambda x, y: abs(float(x) - float(y)))
+
+@pytest.mark.parametrize("n", [10, 100, 1000])
+def bench_exponential_matrix(qif_bench, n):
+	D = metric.euclidean_matrix(n)
+	qif_bench(mechanism.d_privacy.exponential, D)
+
+@pytest.mark.parametrize("n", [5, 10])
+def bench_min_loss_given_d(qif_bench, n):
+	pi = probab.uniform(n)
+	d = metric.euclidean(uint)
+	qif_bench(mechanism.d_privacy.min_loss_given_d, pi, n, d, d)
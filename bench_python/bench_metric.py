@@ -0,0 +1,29 @@
+import pytest
+import numpy as np
+from qif import *
+
+sizes = [10, 100, 1000]
+
+
+@pytest.fixture(autouse=True)
+def seed():
+	np.random.seed(0)
+
+
+@pytest.mark.parametrize("n", sizes)
+def bench_kantorovich(qif_bench, n):
+	a, b = probab.randu(n), probab.randu(n)
+	d = metric.kantorovich(metric.euclidean(uint))
+	qif_bench(d, a, b)
+
+@pytest.mark.parametrize("n", sizes)
+def bench_kantorovich_sinkhorn(qif_bench, n):
+	a, b = probab.randu(n), probab.randu(n)
+	d = metric.kantorovich_sinkhorn(metric.euclidean(uint), 0.1, 1e-6, False)
+	qif_bench(d, a, b)
+
+@pytest.mark.parametrize("n", sizes)
+def bench_mult_kantorovich(qif_bench, n):
+	a, b = probab.randu(n), probab.randu(n)
+	d = metric.mult_kantorovich(metric.euclidean(uint))
+	qif_bench(d, a, b)
@@ -0,0 +1,73 @@
+"""
+Benchmarks of the python bindings (pytest-benchmark), complementing bench_cpp.
+
+Each benchmark also reports how its time splits between C++ (the time spent inside the GIL-releasing functions, as
+measured by qif.trace.cpp_time) and the binding layer (argument/result conversion, overload resolution and the python
+call itself). The split is stored in the extra_info of each benchmark (so it ends up in --benchmark-json) and
+summarized at the end of the run.
+
+	pytest bench_python
+	pytest bench_python -k kantorovich --benchmark-json=bench_python/bench.json
+"""
+
+import time
+import pytest
+import qif
+
+_results = []		# (name, wall, cpp) per benchmark, for the summary
+
+
+@pytest.fixture
+def qif_bench(benchmark, request):
+	"""
+	qif_bench(f, *args) benchmarks f(*args) like benchmark(f, *args), timing the C++ part of each call.
+	"""
+	def run(f, *args):
+		acc = { "n": 0, "wall": 0.0, "cpp": 0.0 }
+
+		def timed():
+			c0 = qif.trace.cpp_time()
+			t0 = time.perf_counter()
+			res = f(*args)
+			acc["wall"] += time.perf_counter() - t0
+			acc["cpp"] += qif.trace.cpp_time() - c0
+			acc["n"] += 1
+			return res
+
+		qif.trace.reset_cpp_time()
+		qif.trace.set_cpp_timing(True)
+		try:
+			res = benchmark(timed)
+		finally:
+			qif.trace.set_cpp_timing(False)
+
+		if acc["n"] > 0:
+			wall = acc["wall"] / acc["n"]
+			cpp = min(acc["cpp"] / acc["n"], wall)
+			benchmark.extra_info["cpp_time"] = cpp
+			benchmark.extra_info["binding_time"] = wall - cpp
+			benchmark.extra_info["binding_fraction"] = (wall - cpp) / wall if wall > 0 else 0.0
+			_results.append((request.node.name, wall, cpp))
+		return res
+
+	return run
+
+
+def _format_time(t):
+	for unit, scale in [("s", 1), ("ms", 1e-3), ("us", 1e-6)]:
+		if t >= scale:
+			return "%.2f%s" % (t / scale, unit)
+	return "%.0fns" % (t / 1e-9)
+
+
+def pytest_terminal_summary(terminalreporter):
+	if not _results:
+		return
+
+	width = max(len(name) for name, _, _ in _results)
+	terminalreporter.section("binding overhead")
+	terminalreporter.write_line("%-*s %10s %10s %10s %8s" % (width, "name", "total", "c++", "binding", "binding%"))
+	for name, wall, cpp in sorted(_results):
+		terminalreporter.write_line("%-*s %10s %10s %10s %7.1f%%" % (
+			width, name, _format_time(wall), _format_time(cpp), _format_time(wall - cpp),
+			100 * (wall - cpp) / wall if wall > 0 else 0))
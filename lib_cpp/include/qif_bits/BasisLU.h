@@ -0,0 +1,214 @@
+namespace lp {
+
+// Sparse LU factorization of a simplex basis B (m x m), with product-form (eta) updates when a column is replaced.
+// Used by LinearProgram::simplex(), works both for floating types and for rat.
+//
+// factorize() performs a left-looking Gaussian elimination, column by column (sparsest columns first, so
+// slack/artificial columns produce no fill-in). Step k eliminates the basis column at position step_col[k] using
+// row step_row[k] as pivot, so that  E B Q = P U, where E is the product of the elimination steps L[0..m-1], U upper
+// triangular, and P, Q the row/column permutations given by step_row, step_col. The pivot row is chosen among the
+// eligible ones with the fewest non-zeros in B (for floating types, eligible means at least pivot_thres times the
+// largest candidate, for stability).
+//
+// After factorizing, replacing the basis column at position p by a column a with  alpha = B^-1 a  is recorded by
+// update(p, alpha) as an eta matrix, B'^-1 = Eta B^-1. Both ftran and btran apply the etas after/before the LU
+// solve, so they get slower with the number of updates; the caller refactorizes periodically.
+//
+template<typename eT>
+class BasisLU {
+	public:
+		typedef std::vector<std::pair<uint, eT>> SpVec;		// sparse vector, (index, value) pairs
+
+		static constexpr double pivot_thres = 0.1;
+
+		// column(pos, out) should store the non-zeros of the basis column at position pos in out, as (row, value).
+		// Returns false if B is (numerically) singular.
+		template<typename ColFunc>
+		bool factorize(uint m, ColFunc column);
+
+		// solves B x = a in place. On input x[row] = a[row], on output x[pos] = value of the pos-th basic variable.
+		void ftran(std::vector<eT>& x) const;
+
+		// solves y^T B = c^T in place. On input y[pos] = c[pos], on output y[row] = y[row].
+		void btran(std::vector<eT>& y) const;
+
+		// the column at position p is replaced by a column a, alpha = ftran(a)
+		void update(uint p, const std::vector<eT>& alpha);
+
+		uint n_updates() const	{ return etas.size(); }
+
+	private:
+		struct Eta {
+			uint p;
+			eT pivot;		// alpha_p
+			SpVec col;		// alpha_i, i != p
+		};
+
+		uint m = 0;
+		std::vector<uint> step_row, step_col;
+		std::vector<SpVec> L;		// L[t]: multipliers for the rows not yet pivoted at step t
+		std::vector<SpVec> U;		// U[k]: entries (t, U(t,k)) with t < k
+		std::vector<eT> U_diag;
+		std::vector<Eta> etas;
+
+		static bool is_zero(const eT& v) {
+			if constexpr (std::is_floating_point<eT>::value)
+				return std::abs(v) <= 1e-14;
+			else
+				return v == eT(0);
+		}
+};
+
+template<typename eT>
+template<typename ColFunc>
+bool BasisLU<eT>::factorize(uint m, ColFunc column) {
+	this->m = m;
+	step_row.assign(m, 0);
+	step_col.assign(m, 0);
+	L.assign(m, {});
+	U.assign(m, {});
+	U_diag.assign(m, eT(0));
+	etas.clear();
+
+	std::vector<SpVec> cols(m);
+	std::vector<uint> row_count(m, 0);
+	for(uint pos = 0; pos < m; pos++) {
+		column(pos, cols[pos]);
+		for(auto& [row, val] : cols[pos])
+			row_count[row]++;
+	}
+
+	// sparsest columns first
+	std::vector<uint> order(m);
+	for(uint pos = 0; pos < m; pos++)
+		order[pos] = pos;
+	std::stable_sort(order.begin(), order.end(), [&](uint a, uint b) { return cols[a].size() < cols[b].size(); });
+
+	std::vector<eT> w(m, eT(0));
+	std::vector<char> pivoted(m, 0);
+
+	for(uint k = 0; k < m; k++) {
+		uint pos = order[k];
+		for(auto& [row, val] : cols[pos])
+			w[row] = val;
+
+		// apply the previous elimination steps
+		for(uint t = 0; t < k; t++) {
+			const eT& wt = w[step_row[t]];
+			if(is_zero(wt)) continue;
+			for(auto& [row, l] : L[t])
+				w[row] -= l * wt;
+		}
+
+		// choose pivot row
+		uint pivot = m;
+		if constexpr (std::is_floating_point<eT>::value) {
+			eT max_abs(0);
+			for(uint i = 0; i < m; i++)
+				if(!pivoted[i])
+					max_abs = std::max(max_abs, std::abs(w[i]));
+			for(uint i = 0; i < m; i++)
+				if(!pivoted[i] && !is_zero(w[i]) && std::abs(w[i]) >= pivot_thres * max_abs && (pivot == m || row_count[i] < row_count[pivot]))
+					pivot = i;
+		} else {
+			for(uint i = 0; i < m; i++)
+				if(!pivoted[i] && !is_zero(w[i]) && (pivot == m || row_count[i] < row_count[pivot]))
+					pivot = i;
+		}
+		if(pivot == m)
+			return false;		// singular
+
+		step_col[k] = pos;
+		step_row[k] = pivot;
+		pivoted[pivot] = 1;
+		U_diag[k] = w[pivot];
+
+		for(uint t = 0; t < k; t++)
+			if(!is_zero(w[step_row[t]]))
+				U[k].push_back({ t, w[step_row[t]] });
+
+		for(uint i = 0; i < m; i++)
+			if(!pivoted[i] && !is_zero(w[i]))
+				L[k].push_back({ i, w[i] / U_diag[k] });
+
+		std::fill(w.begin(), w.end(), eT(0));
+	}
+	return true;
+}
+
+template<typename eT>
+void BasisLU<eT>::ftran(std::vector<eT>& x) const {
+	// E
+	for(uint t = 0; t < m; t++) {
+		const eT& xt = x[step_row[t]];
+		if(is_zero(xt)) continue;
+		for(auto& [row, l] : L[t])
+			x[row] -= l * xt;
+	}
+
+	// U z = P^T x, backwards. U is stored by column, so once z_k is known it is removed from the other rows
+	std::vector<eT> z(m);
+	for(uint k = m; k-- > 0; ) {
+		z[k] = x[step_row[k]] / U_diag[k];
+		if(is_zero(z[k])) continue;
+		for(auto& [t, u] : U[k])
+			x[step_row[t]] -= u * z[k];
+	}
+
+	// Q
+	for(uint k = 0; k < m; k++)
+		x[step_col[k]] = z[k];
+
+	// etas, in order
+	for(auto& eta : etas) {
+		eT& xp = x[eta.p];
+		xp /= eta.pivot;
+		if(is_zero(xp)) continue;
+		for(auto& [i, a] : eta.col)
+			x[i] -= a * xp;
+	}
+}
+
+template<typename eT>
+void BasisLU<eT>::btran(std::vector<eT>& y) const {
+	// etas, in reverse order: only the p-th component changes
+	for(uint e = etas.size(); e-- > 0; ) {
+		auto& eta = etas[e];
+		eT& yp = y[eta.p];
+		for(auto& [i, a] : eta.col)
+			yp -= y[i] * a;
+		yp /= eta.pivot;
+	}
+
+	// U^T v = Q^T y, forwards
+	std::vector<eT> v(m);
+	for(uint k = 0; k < m; k++) {
+		eT s = y[step_col[k]];
+		for(auto& [t, u] : U[k])
+			s -= u * v[t];
+		v[k] = s / U_diag[k];
+	}
+
+	// y = E^T P v
+	for(uint k = 0; k < m; k++)
+		y[step_row[k]] = v[k];
+
+	for(uint t = m; t-- > 0; ) {
+		eT& yt = y[step_row[t]];
+		for(auto& [row, l] : L[t])
+			yt -= l * y[row];
+	}
+}
+
+template<typename eT>
+void BasisLU<eT>::update(uint p, const std::vector<eT>& alpha) {
+	Eta eta;
+	eta.p = p;
+	eta.pivot = alpha[p];
+	for(uint i = 0; i < m; i++)
+		if(i != p && !is_zero(alpha[i]))
+			eta.col.push_back({ i, alpha[i] });
+	etas.push_back(std::move(eta));
+}
+
+} // namespace lp
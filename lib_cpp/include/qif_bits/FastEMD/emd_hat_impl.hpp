@@ -475,6 +475,43 @@ struct emd_hat_impl<double,FLOW_TYPE> {
     }
     
 }; // emd_hat_impl<double>
+
+// (qif) float is computed in double (via the integer conversion above), which is more robust than running the flow
+// network in float precision.
+template<FLOW_TYPE_T FLOW_TYPE>
+struct emd_hat_impl<float,FLOW_TYPE> {
+
+    typedef float NUM_T;
+
+    NUM_T operator()(
+        const std::vector<NUM_T>& POrig, const std::vector<NUM_T>& QOrig,
+        const std::vector<NUM_T>& P, const std::vector<NUM_T>& Q,
+        const std::vector< std::vector<NUM_T> >& C,
+        NUM_T extra_mass_penalty,
+        std::vector< std::vector<NUM_T> >* F) {
+
+    const NODE_T N= P.size();
+    std::vector< std::vector<double> > dC(N), dF;
+    for (NODE_T i= 0; i<N; ++i) dC[i].assign(C[i].begin(), C[i].end());
+    if (FLOW_TYPE!=NO_FLOW) {
+        dF.resize(N);
+        for (NODE_T i= 0; i<N; ++i) dF[i].assign((*F)[i].begin(), (*F)[i].end());
+    }
+
+    double dist= emd_hat_impl<double,FLOW_TYPE>()(
+        std::vector<double>(POrig.begin(), POrig.end()), std::vector<double>(QOrig.begin(), QOrig.end()),
+        std::vector<double>(P.begin(), P.end()), std::vector<double>(Q.begin(), Q.end()),
+        dC, extra_mass_penalty, &dF);
+
+    if (FLOW_TYPE!=NO_FLOW) {
+        for (NODE_T i= 0; i<N; ++i)
+            for (NODE_T j= 0; j<N; ++j)
+                (*F)[i][j]= static_cast<NUM_T>(dF[i][j]);
+    }
+    return static_cast<NUM_T>(dist);
+    }
+
+}; // emd_hat_impl<float>
 //----------------------------------------------------------------------------------------
 #endif
 
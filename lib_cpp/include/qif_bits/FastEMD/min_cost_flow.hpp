@@ -9,6 +9,13 @@
 #include "EMD_DEFS.hpp"
 
 //------------------------------------------------------------------------------
+// (qif) largest value of NUM_T, used as infinite distance. Types without std::numeric_limits (eg. rationals) should
+// specialize it.
+template<typename NUM_T>
+struct num_max {
+    static NUM_T value() { return std::numeric_limits<NUM_T>::max(); }
+};
+
 template<typename NUM_T>
 struct edge {
     edge(NODE_T to, NUM_T cost) : _to(to), _cost(cost) {}
@@ -117,18 +124,12 @@ public:
             }} // it
         }} // from
         
-        // Max supply TODO:demand?, given U?, optimization-> min out of demand,supply
-        NUM_T U= 0;
-        {for (NODE_T i=0; i<_num_nodes; ++i) {
-            if (e[i]>U) U= e[i];
-        }}
-        NUM_T delta= static_cast<NUM_T>(pow(2.0l,ceil(log(static_cast<long double>(U))/log(2.0))));
-
-        
+        // (qif) the delta-scaling phase is disabled, delta is simply the max supply of each iteration. The initial
+        // delta computed via pow/log is removed, so that NUM_T does not need conversions from/to long double.
+        NUM_T delta;
 
         std::vector< NUM_T > d(_num_nodes);
         std::vector< NODE_T > prev(_num_nodes);
-        delta= 1;
         //while (delta>=1) {
         
             // delta-scaling phase
@@ -283,14 +284,14 @@ private:
         {for (NODE_T i=0; i<from; ++i) {
             Q[j]._to= i;
             _nodes_to_Q[i]= j;
-            Q[j]._dist= std::numeric_limits<NUM_T>::max();
+            Q[j]._dist= num_max<NUM_T>::value();
             ++j;
         }}
 
         {for (NODE_T i=from+1; i<_num_nodes; ++i) {
             Q[j]._to= i;
             _nodes_to_Q[i]= j;
-            Q[j]._dist= std::numeric_limits<NUM_T>::max();
+            Q[j]._dist= num_max<NUM_T>::value();
             ++j;
         }}
         //----------------------------------------------------------------
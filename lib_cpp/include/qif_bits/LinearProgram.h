@@ -26,27 +26,290 @@ namespace lp {
 
 using std::string;
 
-// Use a map <col, row> => value for sparse arrays. Put column first so that
-// the lexicographic order used by map is top-to-bottom/left-to-right
-// (this is for uniformity with QuadraticProgram, not really needed here)
-template<typename eT> using Sparse = std::map<std::pair<uint,uint>,eT>;
-
 // emulate enums with strings, it's easier
 #undef ERROR	// MSVC adds this
-namespace Status { const auto OPTIMAL = "OPTIMAL", INFEASIBLE = "INFEASIBLE", UNBOUNDED = "UNBOUNDED", INFEASIBLE_OR_UNBOUNDED = "INFEASIBLE_OR_UNBOUNDED", ERROR = "ERROR"; }
+namespace Status { const auto OPTIMAL = "OPTIMAL", INFEASIBLE = "INFEASIBLE", UNBOUNDED = "UNBOUNDED", INFEASIBLE_OR_UNBOUNDED = "INFEASIBLE_OR_UNBOUNDED", INTERRUPTED = "INTERRUPTED", ERROR = "ERROR"; }
 namespace Method { const auto AUTO = "AUTO", SIMPLEX_PRIMAL = "SIMPLEX_PRIMAL", SIMPLEX_DUAL = "SIMPLEX_DUAL", INTERIOR = "INTERIOR"; }					// AUTO: whatever is best
-namespace Solver { const auto AUTO = "AUTO", INTERNAL = "INTERNAL", GLPK = "GLPK", GLOP = "GLOP", CLP = "CLP", GUROBI = "GUROBI", CPLEX = "CPLEX"; }	// for the each application
+namespace Solver { const auto AUTO = "AUTO", INTERNAL = "INTERNAL", HYBRID = "HYBRID", GLPK = "GLPK", GLOP = "GLOP", CLP = "CLP", GUROBI = "GUROBI", CPLEX = "CPLEX", EXTERNAL = "EXTERNAL", PORTFOLIO = "PORTFOLIO"; }	// for the each application
 namespace MsgLevel { const auto OFF = "OFF", ERR = "ERR", ON = "ON", ALL = "ALL"; }
+namespace Pricing { const auto AUTO = "AUTO", BLAND = "BLAND", DEVEX = "DEVEX"; }									// for the internal simplex
+namespace SolutionFormat { const auto AUTO = "AUTO", HIGHS = "HIGHS", CBC = "CBC", PLAIN = "PLAIN"; }					// of external solvers
+
+// status of a variable/constraint in a simplex basis. Kept per var/con, so we use chars instead of strings
+namespace BasisStatus { const char BASIC = 'B', AT_LOWER = 'L', AT_UPPER = 'U', FREE = 'F', FIXED = 'S'; }
+
+
+// Memory (in bytes) of the phases of a solve (see Stats):
+//  build:        the program itself (bounds, objective, pending coefficients)
+//  canonicalize: peak of the compression of the coefficients to CSC (the pending entries are sorted into a second
+//                array) and of the presolve (copies of the bounds, the CSR rows)
+//  setup:        the program plus the reduced one of the presolve and the solver's copy (GLPK's ia/ja/ar arrays and
+//                matrix, the ortools model, the canonical clone and LU factors of the internal solver)
+// estimate_memory gives them from the size of a program, before building it, from the sizes of the arrays involved.
+// They are only estimates: the solvers' internals are approximated per non-zero/row/column, and rats are counted at
+// their inline size (not their limbs).
+//
+struct MemoryEstimate {
+	uint64_t build = 0, canonicalize = 0, setup = 0;
+
+	uint64_t peak() const { return std::max({ build, canonicalize, setup }); }
+};
+
+// Instrumentation of a single solve, filled by solve() when instrument is set (opt-in). Times are in seconds:
+//  build:        from the creation of the program (or the end of the previous solve) until solve(), ie the time spent
+//                creating variables and constraints
+//  canonicalize: compression of the coefficients to CSC, and conversion to canonical form (internal solver)
+//  setup:        loading the program into the solver
+//  solve:        the solver itself
+//  extract:      reading back the solution and the basis
+//
+struct Stats {
+	string solver;					// solver actually used (AUTO resolved)
+	string portfolio_winner;		// Solver::PORTFOLIO: the entry that won
+	string status;
+	uint n_var = 0, n_con = 0;
+	uint64_t nnz = 0;				// non-zero constraint coefficients
+	int64_t iterations = -1;		// simplex/ADMM iterations, -1 if not reported by the solver
+	double build = 0, canonicalize = 0, setup = 0, solve = 0, extract = 0;
+	MemoryEstimate memory;			// build is measured (the program's arrays when solve() starts), the rest estimated
+
+	double total() const { return build + canonicalize + setup + solve + extract; }
+};
+
+// Stats of the last instrumented solve (in any thread), for programs that are built internally, eg by the mechanism
+// builders. Copies, so it is safe to call while other threads are solving.
+//
+inline std::mutex& last_stats_mutex() {
+	static std::mutex m;
+	return m;
+}
+inline Stats& last_stats_ref() {
+	static Stats stats;
+	return stats;
+}
+inline Stats last_stats() {
+	std::lock_guard<std::mutex> lock(last_stats_mutex());
+	return last_stats_ref();
+}
+inline void set_last_stats(const Stats& stats) {
+	std::lock_guard<std::mutex> lock(last_stats_mutex());
+	last_stats_ref() = stats;
+}
+
+// Wins of each entry of Solver::PORTFOLIO solves, per instance family (see LinearProgram::family). A program of a
+// family with recorded wins and solver AUTO runs the entry that won most often (the first one in case of ties).
+// The wins of rational programs are kept apart (rational = true), floating-point winners would lose exactness.
+//
+inline std::mutex& portfolio_wins_mutex() {
+	static std::mutex m;
+	return m;
+}
+inline std::map<std::pair<string, bool>, std::map<string, uint>>& portfolio_wins_ref() {
+	static std::map<std::pair<string, bool>, std::map<string, uint>> wins;
+	return wins;
+}
+inline std::map<string, uint> portfolio_wins(const string& family, bool rational = false) {
+	std::lock_guard<std::mutex> lock(portfolio_wins_mutex());
+	auto it = portfolio_wins_ref().find({ family, rational });
+	return it == portfolio_wins_ref().end() ? std::map<string, uint>() : it->second;
+}
+inline void record_portfolio_win(const string& family, const string& entry, bool rational = false) {
+	std::lock_guard<std::mutex> lock(portfolio_wins_mutex());
+	portfolio_wins_ref()[{ family, rational }][entry]++;
+}
+inline string portfolio_best(const string& family, bool rational = false) {
+	string best;
+	uint most = 0;
+	for(auto& [entry, wins] : portfolio_wins(family, rational))
+		if(wins > most) {
+			best = entry;
+			most = wins;
+		}
+	return best;
+}
+inline void clear_portfolio_wins() {
+	std::lock_guard<std::mutex> lock(portfolio_wins_mutex());
+	portfolio_wins_ref().clear();
+}
+
+// GLPK keeps its environment in a global (unless it is built with thread-local storage) and glpk() frees it after each
+// solve, so GLPK solves are serialised, in all threads of the process (including the GLPK entries of a portfolio).
+//
+inline std::mutex& glpk_mutex() {
+	static std::mutex m;
+	return m;
+}
+
+// The threads of portfolio entries that lost their race, still finishing in the background. They are joined when
+// they are done (at the next portfolio solve), or at exit. The statics they use are created first, so that they are
+// destroyed after the join.
+//
+class PortfolioThreads {
+	public:
+		PortfolioThreads() {
+			glpk_mutex();
+			last_stats_mutex();
+			last_stats_ref();
+		}
+		PortfolioThreads(const PortfolioThreads&) = delete;
+		PortfolioThreads& operator=(const PortfolioThreads&) = delete;
+
+		~PortfolioThreads() {
+			for(auto& [t, done] : threads)
+				t.join();
+		}
+
+		void add(std::thread t, std::shared_ptr<std::atomic<bool>> done) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for(auto it = threads.begin(); it != threads.end(); )
+				if(*it->second) {
+					it->first.join();
+					it = threads.erase(it);
+				} else
+					++it;
+			threads.emplace_back(std::move(t), std::move(done));
+		}
+
+	private:
+		std::mutex mutex;
+		std::list<std::pair<std::thread, std::shared_ptr<std::atomic<bool>>>> threads;
+};
+
+inline PortfolioThreads& portfolio_threads() {
+	static PortfolioThreads threads;
+	return threads;
+}
+
+// Cancellation of running solves. All copies of a token share the same flag, so a token given to a program (or to
+// run_async) can be cancelled from any thread. A default-constructed token is inactive: it is never cancelled and
+// costs nothing to check.
+//
+class CancelToken {
+	public:
+		static CancelToken create() {
+			CancelToken token;
+			token.flag = std::make_shared<std::atomic<bool>>(false);
+			return token;
+		}
+
+		bool active() const		{ return bool(flag); }
+		bool cancelled() const	{ return flag && flag->load(std::memory_order_relaxed); }
+		void cancel() {
+			if(!flag)
+				throw std::runtime_error("cannot cancel an inactive token, use CancelToken::create()");
+			*flag = true;
+		}
+
+	private:
+		std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// Limits of a solve (0: no limit). time_limit is in seconds from the start of solve(), iteration_limit counts the
+// simplex/interior/ADMM iterations of the solver. memory_limit (bytes) bounds the estimated peak memory of the solve
+// (see MemoryEstimate), it is checked while the program is built and again by solve(), which throw a
+// std::runtime_error as soon as the estimate for the program so far exceeds it.
+//
+struct SolveOptions {
+	double time_limit = 0;
+	int64_t iteration_limit = 0;
+	CancelToken cancel;
+	uint64_t memory_limit = 0;
+};
 
+// The options of the calling thread, used as the initial limits of every program created in it. This is how the
+// limits reach the programs built internally (eg. by the mechanism builders): set them with ScopedOptions, or run
+// the whole computation with run_async. Programs built by parallel::for_each workers do not inherit them.
+//
+inline SolveOptions& thread_options() {
+	thread_local SolveOptions options;
+	return options;
+}
+
+class ScopedOptions {
+	public:
+		explicit ScopedOptions(const SolveOptions& options) : prev(thread_options()) { thread_options() = options; }
+		~ScopedOptions() { thread_options() = prev; }
+
+		ScopedOptions(const ScopedOptions&) = delete;
+		ScopedOptions& operator=(const ScopedOptions&) = delete;
+
+	private:
+		SolveOptions prev;
+};
+
+// Runs f() in a new thread with the given options, eg.
+//   auto token = lp::CancelToken::create();
+//   auto res = lp::run_async([&] { return mechanism::d_privacy::min_loss_given_d(pi, n, d, loss); }, { 60, 0, token });
+//   ...
+//   token.cancel();		// or wait for res.get()
+// A builder whose solve is interrupted returns the best feasible solution found (if any, see LinearProgram::solve).
+//
+template<typename F>
+auto run_async(F f, const SolveOptions& options = SolveOptions()) {
+	return std::async(std::launch::async, [f = std::move(f), options]() mutable {
+		ScopedOptions scope(options);
+		return f();
+	});
+}
 
 class Defaults {
 	public:
+		static bool instrument;
 		static bool presolve;
 		static string msg_level;
 		static string method;
 		static string solver;
+		static string pricing;
+		static string external_command;
+		static string external_format;
+		static std::vector<string> portfolio;
 };
 
+// Estimated memory of solving a program of n_var variables, n_con constraints and nnz constraint coefficients with
+// solver (not AUTO, see LinearProgram::actual_solver), see MemoryEstimate.
+//
+template<typename eT>
+MemoryEstimate estimate_memory(uint64_t n_var, uint64_t n_con, uint64_t nnz, const string& solver, bool presolve = true) {
+	const uint64_t E = sizeof(eT), I = sizeof(uint), nv = n_var, nc = n_con;
+	const uint64_t model = nv * 3 * E + nc * 2 * E;				// objective and bounds
+	const uint64_t triplets = nnz * SparseBuilder<eT>::entry_bytes();
+	const uint64_t csc = nnz * (I + E) + (nv + 1) * I;
+	const uint64_t pre = presolve ? (nv + nc) * (2 * E + 2 * I + 1) + nv * E + csc : 0;		// bounds, counters, CSR rows
+
+	// the copy of an external solver, per non-zero and per row/column
+	auto external = [&](const string& s) -> uint64_t {
+		return s == Solver::GLPK
+			? nnz * (2 * I + 8 + 56 + 24) + (nv + nc) * 200		// ia/ja/ar, GLPK's matrix elements, the simplex's copies
+			: nnz * 64 + (nv + nc) * 250;						// ortools' model and the solver's own matrix
+	};
+
+	uint64_t copy;
+	if(solver == Solver::INTERNAL) {
+		// canonical clone (one slack per constraint) and the LU factors of the basis
+		copy = model + (nv + nc) * 3 * E + 2 * (nnz + nc) * (I + E);
+	} else if(solver == Solver::HYBRID) {
+		// the double program and its solver, then the exact LU factors of the basis
+		#ifdef QIF_USE_ORTOOLS
+		const string s = Solver::GLOP;
+		#else
+		const string s = Solver::GLPK;
+		#endif
+		copy = nv * 24 + nc * 16 + nnz * (I + 8) + external(s) + (nnz + nc) * (I + E);
+	} else if(solver == Solver::EXTERNAL) {
+		copy = 0;			// streamed to a file, the solver runs in its own process
+	} else if(solver == Solver::PORTFOLIO) {
+		throw std::runtime_error("the memory of a portfolio depends on its entries, use LinearProgram::estimate_memory");
+	} else {
+		copy = external(solver);
+	}
+
+	MemoryEstimate res;
+	res.build = model + triplets;
+	res.canonicalize = model + std::max({ 2 * triplets, triplets + csc, csc + pre });
+	res.setup = model + csc + (presolve ? pre + model + csc : 0) + copy;
+	return res;
+}
+
 // Solve the linear program
 // {min/max} dot(c,x)
 // subject to lb <= A x <= ub
@@ -66,13 +329,101 @@ class LinearProgram {
 		bool presolve = Defaults::presolve;
 		string status;
 		string msg_level = Defaults::msg_level;
+		string pricing = Defaults::pricing;
+		bool instrument = Defaults::instrument;
+		Stats stats;						// of the last solve, if instrument is set
+
+		// Limits (see SolveOptions), initially those of the calling thread. When a limit is reached or cancel is
+		// cancelled, solve() returns false with status INTERRUPTED. If the solver had found a feasible (non-optimal)
+		// solution by then, it is kept (has_solution() is true): the internal primal simplex in phase 2, GLPK's simplex
+		// and ortools. GLPK checks cancel only before starting (it has no callback during the simplex), the time limit
+		// is enforced by GLPK itself.
+		double time_limit = thread_options().time_limit;
+		int64_t iteration_limit = thread_options().iteration_limit;
+		CancelToken cancel = thread_options().cancel;
+		uint64_t memory_limit = thread_options().memory_limit;
+
+		// Solver::EXTERNAL runs external_command in a shell, after writing the program in MPS format to a temporary
+		// file. The command should read {model} and write a solution to {solution} ({time_limit} is replaced by the
+		// seconds left, 0 if unlimited). The paths are substituted already quoted for the shell, so the placeholders
+		// should not be quoted themselves, eg.
+		//   highs --model_file {model} --solution_file {solution}
+		//   cbc {model} solve solu {solution}
+		//   gurobi_cl ResultFile={solution} {model}
+		//   ssh solver-host 'cat > m.mps && highs --model_file m.mps --solution_file s.sol >&2 && cat s.sol' < {model} > {solution}
+		// The solution is read with read_solution in external_format (a SolutionFormat). AUTO takes it from the name
+		// of the command: HIGHS for highs, CBC for cbc, PLAIN for anything else (eg. gurobi_cl, or the ssh example,
+		// which needs HIGHS to be set explicitly). cancel and iteration_limit cannot interrupt the solver process.
+		string external_command = Defaults::external_command;
+		string external_format = Defaults::external_format;
+
+		// Solver::PORTFOLIO races several backends, each on its own copy of the program in its own thread. The first
+		// to reach a conclusive status (OPTIMAL, or a proof of infeasibility/unboundedness) wins: its result is kept
+		// and the others are cancelled. Entries are "SOLVER" or "SOLVER:METHOD", eg. { "GLOP", "GLPK:INTERIOR" },
+		// empty for all the available backends (HYBRID and INTERNAL for rat, a single GLPK entry since GLPK solves
+		// are serialised, see glpk_mutex). portfolio_winner is the entry that won the last solve (empty if none). It
+		// is logged with msg_level, and recorded in the wins of family (if not empty, see portfolio_wins) so that
+		// later programs of the same family with solver AUTO run it directly. Losers that cannot be interrupted (GLPK
+		// during the simplex, the external solver) finish in the background on their own copy, which is freed when
+		// they do, and their threads are joined later (see PortfolioThreads), at the latest at exit.
+		std::vector<string> portfolio = Defaults::portfolio;
+		string family;
+		string portfolio_winner;
 
 		bool solve();
+
+		// The program in (free) MPS or CPLEX LP format, written as it is streamed (the model is never copied to a
+		// single string, except by to_mps). Variables are named X1, X2, ..., constraints R1, R2, .... The file can
+		// also be a named pipe, to feed a solver running concurrently.
+		void write_mps(std::ostream& out);
+		void write_mps(const string& filename);
+		void write_lp(std::ostream& out);
+		void write_lp(const string& filename);
 		string to_mps();
 
+		// Replaces the program with one read from a free MPS file: ROWS, COLUMNS, RHS, RANGES, BOUNDS and OBJSENSE
+		// sections, names without spaces. The first N row is the objective (its RHS, a constant, is ignored), other N
+		// rows become free constraints. Integer markers and bounds (BV, LI, UI) are not supported.
+		void read_mps(std::istream& in);
+		void read_mps(const string& filename);
+
+		// Reads a solution written by an external solver, variables named as by write_mps, in the given SolutionFormat
+		// (the one of external_format if not given):
+		//   HIGHS  the "Model status" line gives the status, the "name value" lines up to the rows, duals or basis
+		//          give the primal values
+		//   CBC    the first line gives the status ("Optimal - objective value ...", "Stopped on time - ..."), then
+		//          "index name value reduced_cost" lines
+		//   PLAIN  "name value" lines and # comments (Gurobi .sol), OPTIMAL if there are any values
+		// Missing variables are 0 (CBC omits them). The status is INTERRUPTED if the solver was stopped by a limit (the
+		// values, if any, are kept as a feasible solution). Returns true if OPTIMAL.
+		bool read_solution(std::istream& in, const string& format);
+		bool read_solution(std::istream& in) { return read_solution(in, solution_format()); }
+		string solution_format() const;
+
+		// solve() in a new thread. The program should not be used (or destroyed) until the future is ready.
+		std::future<bool> solve_async() { return std::async(std::launch::async, [this] { return solve(); }); }
+
 		eT objective();
 		inline eT solution(Var x)	{ return sol(x); }
 		inline Col<eT> solution()	{ return sol; };
+		bool has_solution() const	{ return !sol.empty(); }	// optimal, or feasible if INTERRUPTED
+
+		// Sensitivity analysis. If sensitivity is set, an optimal solve also computes the duals y and the reduced
+		// costs d = c - A^T y: dual(con) is the shadow price of a constraint, the change of the objective per unit
+		// increase of its active bound (0 if neither bound is active), reduced_cost(var) the same for the active bound
+		// of a variable. They come from GLPK (simplex and interior), GLOP/CLP, and from the optimal basis of the
+		// internal simplex and of the hybrid solver (exact for rat). Not available from the internal interior method
+		// and the external solver. The presolve of solve() only recovers the primal solution, so it is skipped.
+		bool sensitivity = false;
+		inline eT dual(Con con)				{ return con_duals(con); }
+		inline Col<eT> duals()				{ return con_duals; }
+		inline eT reduced_cost(Var var)		{ return var_reduced_costs(var); }
+		inline Col<eT> reduced_costs()		{ return var_reduced_costs; }
+		bool has_duals() const				{ return !var_reduced_costs.empty(); }
+
+		// the basis of the last optimal simplex solve, one BasisStatus per variable/constraint (empty if none)
+		const std::vector<char>& var_basis_status() const	{ return var_basis; }
+		const std::vector<char>& con_basis_status() const	{ return con_basis; }
 
 		void clear();
 		void from_matrix(const arma::SpMat<eT>& A, const Col<eT>& b, const Col<eT>& c, const Col<char>& sense = {}, bool non_negative = true);
@@ -86,14 +437,153 @@ class LinearProgram {
 
 		void set_obj_coeff(Var var, eT coeff, bool add = false);
 		void set_con_coeff(Con cons, Var var, eT coeff, bool add = false);
+		void reserve_con_coeffs(size_t n) {											// hint for the number of set_con_coeff calls
+			check_memory(n_var, n_con, con_coeff.nnz() + con_coeff.n_pending() + n);
+			con_coeff.reserve(n);
+		}
+
+		// Parallel construction of constraints, for large programs. A ConBlock has the same make_con/set_con_coeff
+		// API as the program, with constraint indexes local to the block.
+		// make_cons_parallel(n_blocks, f) calls f(b, block) for every b in [0, n_blocks), concurrently, then
+		// appends the blocks to the program in order, so the result is the same as calling f sequentially on the
+		// program itself. Returns the index (in the program) of the first constraint of each block.
+		// f must only touch its own block: no user callbacks (they might not be thread-safe, eg. python functions),
+		// their values should be computed beforehand.
+		class ConBlock {
+			public:
+				Con make_con(eT lb, eT ub);
+				void set_con_coeff(Con con, Var var, eT coeff, bool add = false);
+				void reserve_con_coeffs(size_t n)	{ con_coeff.reserve(n); }
+
+			private:
+				uint n_con = 0;
+				std::vector<eT> con_lb, con_ub;
+				SparseBuilder<eT> con_coeff;
+
+				friend class LinearProgram;
+		};
+
+		template<typename F>
+		std::vector<Con> make_cons_parallel(uint n_blocks, F f);
+
+		// In-place modification of an existing program, eg. for parameter sweeps. Instead of rebuilding the program
+		// for every value, modify the few bounds/coefficients that change and solve again.
+		void set_var_bounds(Var var, eT lb, eT ub);
+		void set_con_bounds(Con con, eT lb, eT ub);
+
+		// Warm start: if true, the optimal basis of the previous solve (simplex with GLPK, GLOP or CLP) is used as the
+		// starting basis of the next one, so re-solving a slightly modified program takes only a few pivots.
+		// Variables/constraints added after the last solve start as non-basic/basic respectively. With GLPK the
+		// presolver is skipped when a basis is available, since it ignores the starting basis. The presolve done by
+		// solve() itself (see presolved_solve) is not used at all when warm_start is set.
+		bool warm_start = false;
+		void clear_basis();
+
+		// Estimated memory of solving a program of the given size with the current settings (eg. to size a job before
+		// building it), or this program as built so far. See MemoryEstimate.
+		MemoryEstimate estimate_memory(uint64_t n_var, uint64_t n_con, uint64_t nnz) const {
+			auto s = actual_solver();
+			if(s != Solver::PORTFOLIO)
+				return lp::estimate_memory<eT>(n_var, n_con, nnz, s, presolve && !warm_start);
+
+			// the program and its presolve (EXTERNAL has no copy), plus the entries, which run concurrently, each on
+			// its own copy of the (reduced) program
+			MemoryEstimate res = lp::estimate_memory<eT>(n_var, n_con, nnz, Solver::EXTERNAL, presolve && !warm_start);
+			for(auto& [s2, m2] : portfolio_entries()) {
+				(void)m2;
+				res.setup += lp::estimate_memory<eT>(n_var, n_con, nnz, s2, false).setup;
+			}
+			return res;
+		}
+		MemoryEstimate estimate_memory() const {
+			return estimate_memory(n_var, n_con, con_coeff.nnz() + con_coeff.n_pending());
+		}
+
+		// Throws if the estimated memory of the program grown to the given size exceeds memory_limit. The building
+		// methods check it every check_period vars/cons (and 64 * check_period coefficients), builders of large
+		// programs call it with the final size before generating the constraints.
+		void check_memory(uint64_t n_var, uint64_t n_con, uint64_t nnz) const {
+			if(memory_limit == 0)
+				return;
+			uint64_t peak = estimate_memory(n_var, n_con, nnz).peak();
+			if(peak > memory_limit)
+				throw std::runtime_error("LP memory limit exceeded: estimated peak of " + std::to_string(peak >> 20) + " MiB for " +
+					std::to_string(n_var) + " vars, " + std::to_string(n_con) + " cons and " + std::to_string(nnz) + " nnz (limit " +
+					std::to_string(memory_limit >> 20) + " MiB)");
+		}
+
+		// The solver used by solve() (AUTO resolved), and whether it can be warm-started
+		string actual_solver() const;
+		// The entries of Solver::PORTFOLIO (see portfolio) as (solver, method) pairs, method empty to keep this->method
+		std::vector<std::pair<string, string>> portfolio_entries() const;
+
+		bool supports_warm_start() const {
+			auto s = actual_solver();
+			return method != Method::INTERIOR && (s == Solver::GLPK || s == Solver::GLOP || s == Solver::CLP);
+		}
 
 	protected:
 		Col<eT> sol;			// solution
+		Col<eT> con_duals, var_reduced_costs;		// if sensitivity is set
+
+		// basis of the last optimal simplex solve, one BasisStatus per var/con. Empty if not available.
+		std::vector<char> var_basis, con_basis;
+		char start_var_status(Var var) const { return var < var_basis.size() ? var_basis[var] : BasisStatus::AT_LOWER; }
+		char start_con_status(Con con) const { return con < con_basis.size() ? con_basis[con] : BasisStatus::BASIC; }
+		bool use_basis() const { return warm_start && !var_basis.empty(); }
+
+		// start of the current instrumentation phase, lap(phase) adds the time since then to phase
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point lap_start = Clock::now();
+		void lap(double& phase) {
+			if(!instrument) return;
+			auto now = Clock::now();
+			phase += std::chrono::duration<double>(now - lap_start).count();
+			lap_start = now;
+		}
+
+		// start of the last solve() (time_limit is counted from here), and whether a limit has been reached
+		Clock::time_point solve_start = Clock::now();
+		double time_left() const {
+			return time_limit > 0 ? time_limit - std::chrono::duration<double>(Clock::now() - solve_start).count() : infinity<double>();
+		}
+		bool interrupted(int64_t iterations) const {
+			return cancel.cancelled() || (iteration_limit > 0 && iterations >= iteration_limit) || time_left() <= 0;
+		}
+		template<typename eT2>
+		void copy_limits(const LinearProgram<eT2>& lp) {
+			time_limit = lp.time_limit;
+			iteration_limit = lp.iteration_limit;
+			cancel = lp.cancel;
+			solve_start = lp.solve_start;
+			memory_limit = 0;			// internal programs are part of the estimate of the original one
+		}
+
+		static const uint check_period = 4096;
+		void check_memory() const {
+			check_memory(n_var, n_con, con_coeff.nnz() + con_coeff.n_pending());
+		}
+
+		// memory allocated by the program's own arrays
+		uint64_t model_bytes() const {
+			return (obj_coeff.capacity() + var_lb.capacity() + var_ub.capacity() + con_lb.capacity() + con_ub.capacity()) * sizeof(eT)
+				+ con_coeff.bytes() + var_basis.capacity() + con_basis.capacity();
+		}
 
+		bool run_solver(const string& s);
+		bool presolved_solve(const string& s);
 		bool glpk();
 		bool ortools();
 		bool internal_solver();
+		bool hybrid();
+		bool external_solver();
+		bool portfolio_solver();
+		string portfolio_auto() const;
+		bool verify_basis(const std::vector<char>& vb, const std::vector<char>& cb);
+		bool compute_duals();
+		void basis_from_canonical(const LinearProgram<eT>& clp);
 		bool simplex();
+		bool interior();
 
 		void to_canonical_form();
 		Col<eT> original_solution();
@@ -103,12 +593,14 @@ class LinearProgram {
 			 n_con = 0;						// number of constraints
 
 		std::vector<eT> obj_coeff;			// coefficients for the objective function
-		Sparse<eT> con_coeff;				// coefficients for the constraints: <row,col> => val
+		SparseBuilder<eT> con_coeff;		// coefficients for the constraints (row = con, col = var), compressed in solve()
 		std::vector<eT> var_lb, var_ub,		// variables lower/upper bounds
 						con_lb, con_ub;		// constraints lower/upper
 
 		// info for transforming solution to the original one (see canonical_form, original_solution)
 		std::vector< std::tuple<int,eT,eT> > var_transform;
+
+		template<typename> friend class LinearProgram;		// hybrid() accesses the double program
 };
 
 
@@ -144,6 +636,8 @@ typename LinearProgram<eT>::Var LinearProgram<eT>::make_var(eT lb, eT ub) {
 	var_lb.push_back(lb);
 	var_ub.push_back(ub);
 	obj_coeff.push_back(eT(0));
+	if(memory_limit > 0 && (n_var + 1) % check_period == 0)
+		check_memory();
 	return n_var++;
 }
 
@@ -176,6 +670,8 @@ typename LinearProgram<eT>::Con LinearProgram<eT>::make_con(eT lb, eT ub) {
 
 	con_lb.push_back(lb);
 	con_ub.push_back(ub);
+	if(memory_limit > 0 && (n_con + 1) % check_period == 0)
+		check_memory();
 	return n_con++;
 }
 
@@ -194,13 +690,77 @@ void LinearProgram<eT>::set_con_coeff(Con con, Var var, eT coeff, bool add) {
 	if(equal<eT>(coeff, eT(0)))
 		return;
 
-	auto key = std::pair(var, con);	// <col, row>
-	if(add && con_coeff.count(key))
-		con_coeff[key] += coeff;
-	else
-		con_coeff[key] = coeff;
+	con_coeff.set(con, var, coeff, add);
+	if(memory_limit > 0 && con_coeff.n_pending() % (64 * check_period) == 0)
+		check_memory();
+}
+
+template<typename eT>
+inline
+typename LinearProgram<eT>::Con LinearProgram<eT>::ConBlock::make_con(eT lb, eT ub) {
+	if(ub == infinity<eT>() && lb == -ub)
+		throw std::runtime_error("trying to add unconstrained constraint");
+
+	con_lb.push_back(lb);
+	con_ub.push_back(ub);
+	return n_con++;
+}
+
+template<typename eT>
+inline
+void LinearProgram<eT>::ConBlock::set_con_coeff(Con con, Var var, eT coeff, bool add) {
+	if(equal<eT>(coeff, eT(0)))
+		return;
+
+	con_coeff.set(con, var, coeff, add);
+}
+
+template<typename eT>
+template<typename F>
+std::vector<typename LinearProgram<eT>::Con> LinearProgram<eT>::make_cons_parallel(uint n_blocks, F f) {
+	std::vector<ConBlock> blocks(n_blocks);
+	parallel::for_each(n_blocks, [&](uint b) { f(b, blocks[b]); });
+
+	// merge, the bounds sequentially and the coefficients in parallel
+	std::vector<Con> first(n_blocks);
+	std::vector<SparseBuilder<eT>> coeffs(n_blocks);
+	for(uint b = 0; b < n_blocks; b++) {
+		first[b] = n_con;
+		n_con += blocks[b].n_con;
+		con_lb.insert(con_lb.end(), blocks[b].con_lb.begin(), blocks[b].con_lb.end());
+		con_ub.insert(con_ub.end(), blocks[b].con_ub.begin(), blocks[b].con_ub.end());
+		coeffs[b] = std::move(blocks[b].con_coeff);
+	}
+	blocks.clear();
+	con_coeff.append(coeffs, first);
+	check_memory();
+
+	return first;
+}
+
+template<typename eT>
+inline
+void LinearProgram<eT>::set_var_bounds(Var var, eT lb, eT ub) {
+	var_lb.at(var) = lb;
+	var_ub.at(var) = ub;
+}
+
+template<typename eT>
+inline
+void LinearProgram<eT>::set_con_bounds(Con con, eT lb, eT ub) {
+	if(ub == infinity<eT>() && lb == -ub)
+		throw std::runtime_error("trying to set unconstrained constraint");
+
+	con_lb.at(con) = lb;
+	con_ub.at(con) = ub;
 }
 
+template<typename eT>
+inline
+void LinearProgram<eT>::clear_basis() {
+	var_basis.clear();
+	con_basis.clear();
+}
 
 template<typename eT>
 void LinearProgram<eT>::clear() {
@@ -210,7 +770,9 @@ void LinearProgram<eT>::clear() {
 	var_ub.clear();
 	con_lb.clear();
 	con_ub.clear();
+	clear_basis();
 	n_var = n_con = 0;
+	lap_start = Clock::now();
 }
 
 // input program in matrix form
@@ -243,7 +805,8 @@ void LinearProgram<eT>::from_matrix(const arma::SpMat<eT>& A, const Col<eT>& b,
 	for(uint var = 0; var < n_var; var++) {
 		obj_coeff.push_back(c[var]);
 	}
-	
+
+	con_coeff.reserve(A.n_nonzero);
 	auto end = A.end();
 	for(auto c = A.begin(); c != end; ++c) {		// c++ throws weird warning, ++c doesn't!
 		set_con_coeff(c.row(), c.col(), *c);
@@ -251,12 +814,22 @@ void LinearProgram<eT>::from_matrix(const arma::SpMat<eT>& A, const Col<eT>& b,
 }
 
 template<typename eT>
-bool LinearProgram<eT>::solve() {
-	// AUTO: internal for rat, GLPK for Interior, CLP if available, otherwise GLPK
+string LinearProgram<eT>::actual_solver() const {
+	// AUTO: the entry that won most portfolios of the family (if any, see portfolio_auto), hybrid for rat (internal if no floating solver
+	// is available), GLPK for Interior, CLP if available, otherwise GLPK
 	auto s = solver;
+	if(s == Solver::AUTO) {
+		string best = portfolio_auto();
+		if(!best.empty())
+			return best.substr(0, best.find(':'));
+	}
 	if(s == Solver::AUTO) {
 		if(is_rat) {
+			#if defined(QIF_USE_ORTOOLS) || defined(QIF_USE_GLPK)
+			s = Solver::HYBRID;
+			#else
 			s = Solver::INTERNAL;
+			#endif
 		} else if(method == Method::INTERIOR) {
 			#ifdef QIF_USE_GLPK
 			s = Solver::GLPK;
@@ -273,34 +846,439 @@ bool LinearProgram<eT>::solve() {
 			#endif
 		}
 	}
-	
+	return s;
+}
+
+template<typename eT>
+bool LinearProgram<eT>::solve() {
+	QIF_TRACE_SPAN("lp::solve");
+
+	// AUTO in a family with portfolio wins: run the winning entry, with its method (unless one is set) and its
+	// solver (ortools() reads it). Both are restored on return.
+	struct Restore {
+		LinearProgram& lp;
+		string solver, method;
+		~Restore() { lp.solver = solver; lp.method = method; }
+	} restore { *this, solver, method };
+	if(solver == Solver::AUTO) {
+		string best = portfolio_auto();
+		if(!best.empty()) {
+			auto colon = best.find(':');
+			solver = best.substr(0, colon);
+			if(colon != string::npos && method == Method::AUTO)
+				method = best.substr(colon + 1);
+		}
+	}
+
+	auto s = actual_solver();
 	if(msg_level != MsgLevel::OFF)
 		std::cerr << "Solving LP with solver: " << s << "\n";
 
+	stats = Stats();
+	lap(stats.build);
+	sol.reset();
+	portfolio_winner.clear();
+	con_duals.reset();
+	var_reduced_costs.reset();
+	solve_start = Clock::now();
+
+	check_memory();
+	if(instrument) {
+		stats.memory = estimate_memory();
+		stats.memory.build = model_bytes();
+	}
+
+	// all solvers read the coefficients in CSC form
+	con_coeff.compress(n_var);
+	lap(stats.canonicalize);
+
+	bool res;
+	if(interrupted(0)) {
+		status = Status::INTERRUPTED;		// cancelled before starting
+		res = false;
+	} else {
+		res = presolve && !warm_start && !sensitivity ? presolved_solve(s) : run_solver(s);
+	}
+
+	if(instrument) {
+		stats.solver = s;
+		stats.portfolio_winner = portfolio_winner;
+		stats.status = status;
+		stats.n_var = n_var;
+		stats.n_con = n_con;
+		stats.nnz = con_coeff.nnz();
+		set_last_stats(stats);
+
+		if(msg_level != MsgLevel::OFF)
+			std::cerr << "LP " << n_var << "x" << n_con << " (" << stats.nnz << " nnz), " << status << ", " << stats.iterations << " iterations, "
+				<< "build " << stats.build << "s, canonicalize " << stats.canonicalize << "s, setup " << stats.setup << "s, solve " << stats.solve
+				<< "s, extract " << stats.extract << "s, ~" << (stats.memory.peak() >> 20) << " MiB peak\n";
+	}
+	lap_start = Clock::now();		// the next build phase starts here
+
+	return res;
+}
+
+template<typename eT>
+bool LinearProgram<eT>::run_solver(const string& s) {
 	return
 		s == Solver::GLPK ? glpk() :
 		s == Solver::INTERNAL ? internal_solver() :
+		s == Solver::HYBRID ? hybrid() :
+		s == Solver::EXTERNAL ? external_solver() :
+		s == Solver::PORTFOLIO ? portfolio_solver() :
 		ortools();		// make sure that AUTO in ortools() is treated in the same way as here!
 }
 
-// internal solver, uses simplex() after cloning and converting to canonical form. Mostly useful for rats
+// Presolve, done by solve() before calling any solver if presolve is set (and warm_start is not). Repeated until
+// nothing changes:
+// - fixed variables (lb == ub) are substituted in the constraints
+// - empty constraints are removed (or the program is infeasible)
+// - singleton constraints  lb <= a x <= ub  become bounds of x
+// - constraint bounds implied by the variable bounds (min/max activity) are dropped, a constraint left without
+//   bounds is removed
+// - variables appearing in no constraint are fixed at their best bound
+// - duplicate constraints (equal up to a scalar, found by hashing their normalized coefficients) are merged
+// The reduced program is solved by solver s (with its own presolver, if it has one) and the solution is extended to
+// the removed variables. Only the primal solution is recovered, not the basis, so it never runs when warm-starting.
+//
+template<typename eT>
+bool LinearProgram<eT>::presolved_solve(const string& s) {
+	const eT inf = infinity<eT>();
+	const eT sign = maximize ? eT(-1) : eT(1);		// for minimizing sign * obj
+	auto& A = con_coeff;
+	assert(A.is_compressed());
+
+	std::vector<eT> lb(var_lb), ub(var_ub), clb(con_lb), cub(con_ub);
+	std::vector<char> col_alive(n_var, 1), row_alive(n_con, 1);
+	std::vector<uint> col_count(n_var, 0), row_count(n_con, 0);		// alive entries of each column/row
+	Col<eT> value = arma::zeros<Col<eT>>(n_var);						// of the removed variables
+
+	// rows of A (CSR, explicit zeros skipped), entries sorted by column
+	std::vector<uint> row_ptr(n_con + 1, 0), row_col;
+	std::vector<eT> row_val;
+	for(uint k = 0; k < A.values.size(); k++)
+		if(A.values[k] != eT(0))
+			row_ptr[A.row_ind[k] + 1]++;
+	for(uint i = 0; i < n_con; i++)
+		row_ptr[i + 1] += row_ptr[i];
+	row_col.resize(row_ptr[n_con]);
+	row_val.resize(row_ptr[n_con]);
+	{
+		std::vector<uint> next(row_ptr.begin(), row_ptr.end() - 1);
+		for(uint j = 0; j < n_var; j++)
+			for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+				if(A.values[k] != eT(0)) {
+					uint p = next[A.row_ind[k]]++;
+					row_col[p] = j;
+					row_val[p] = A.values[k];
+					col_count[j]++;
+					row_count[A.row_ind[k]]++;
+				}
+	}
+
+	bool infeasible = false;
+
+	// intersect [l, u] with [l2, u2]
+	auto intersect = [&](eT& l, eT& u, const eT& l2, const eT& u2) {
+		if(l2 > l) l = l2;
+		if(u2 < u) u = u2;
+		if(l > u) {
+			if(less_than(u, l))
+				infeasible = true;
+			else
+				u = l;		// equal up to rounding
+		}
+	};
+	// bounds of x given  l <= a x <= u
+	auto divide = [&](const eT& l, const eT& u, const eT& a, eT& res_l, eT& res_u) {
+		if(a > eT(0)) {
+			res_l = l == -inf ? -inf : l / a;
+			res_u = u ==  inf ?  inf : u / a;
+		} else {
+			res_l = u ==  inf ? -inf : u / a;
+			res_u = l == -inf ?  inf : l / a;
+		}
+	};
+	auto fix_var = [&](uint j, const eT& v) {
+		col_alive[j] = 0;
+		value(j) = v;
+		for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++) {
+			uint i = A.row_ind[k];
+			if(!row_alive[i] || A.values[k] == eT(0)) continue;
+			row_count[i]--;
+			if(v != eT(0)) {
+				if(clb[i] != -inf) clb[i] -= A.values[k] * v;
+				if(cub[i] !=  inf) cub[i] -= A.values[k] * v;
+			}
+		}
+	};
+	auto remove_con = [&](uint i) {
+		row_alive[i] = 0;
+		for(uint p = row_ptr[i]; p < row_ptr[i+1]; p++)
+			if(col_alive[row_col[p]])
+				col_count[row_col[p]]--;
+	};
+	auto same_coeffs = [&](uint r, uint i, const eT& ratio) {	// row i == ratio * row r (alive entries)
+		uint p = row_ptr[r], q = row_ptr[i];
+		while(true) {
+			while(p < row_ptr[r+1] && !col_alive[row_col[p]]) p++;
+			while(q < row_ptr[i+1] && !col_alive[row_col[q]]) q++;
+			if(p == row_ptr[r+1] || q == row_ptr[i+1])
+				return p == row_ptr[r+1] && q == row_ptr[i+1];
+			if(row_col[p] != row_col[q] || !equal(row_val[q], ratio * row_val[p]))
+				return false;
+			p++; q++;
+		}
+	};
+	auto first_alive = [&](uint i) {
+		uint p = row_ptr[i];
+		while(!col_alive[row_col[p]]) p++;
+		return p;
+	};
+
+	for(bool changed = true; changed && !infeasible; ) {
+		changed = false;
+
+		for(uint j = 0; j < n_var; j++) {
+			if(col_alive[j] && lb[j] == ub[j]) {
+				fix_var(j, lb[j]);
+				changed = true;
+			}
+		}
+
+		for(uint i = 0; i < n_con && !infeasible; i++) {
+			if(!row_alive[i]) continue;
+
+			if(row_count[i] == 0) {
+				if(less_than(cub[i], eT(0)) || less_than(eT(0), clb[i]))
+					infeasible = true;
+				remove_con(i);
+				changed = true;
+
+			} else if(row_count[i] == 1) {
+				uint p = first_alive(i);
+				uint j = row_col[p];
+				eT l, u;
+				divide(clb[i], cub[i], row_val[p], l, u);
+				intersect(lb[j], ub[j], l, u);
+				remove_con(i);
+				changed = true;
+
+			} else {
+				// min/max of the activity given the variable bounds
+				eT min_act(0), max_act(0);
+				bool min_inf = false, max_inf = false;
+				for(uint p = row_ptr[i]; p < row_ptr[i+1]; p++) {
+					uint j = row_col[p];
+					if(!col_alive[j]) continue;
+					const eT& a = row_val[p];
+					const eT& lo = a > eT(0) ? lb[j] : ub[j];
+					const eT& hi = a > eT(0) ? ub[j] : lb[j];
+					if(lo == -inf || lo == inf) min_inf = true; else min_act += a * lo;
+					if(hi == -inf || hi == inf) max_inf = true; else max_act += a * hi;
+				}
+				if((!min_inf && cub[i] != inf && less_than(cub[i], min_act)) || (!max_inf && clb[i] != -inf && less_than(max_act, clb[i])))
+					infeasible = true;
+				if(!min_inf && clb[i] != -inf && less_than_or_eq(clb[i], min_act))
+					clb[i] = -inf;
+				if(!max_inf && cub[i] != inf && less_than_or_eq(max_act, cub[i]))
+					cub[i] = inf;
+				if(clb[i] == -inf && cub[i] == inf) {
+					remove_con(i);
+					changed = true;
+				}
+			}
+		}
+
+		for(uint j = 0; j < n_var; j++) {
+			if(!col_alive[j] || col_count[j] != 0) continue;
+
+			// the best bound, if finite (otherwise the solver will find the program unbounded, if it is feasible)
+			eT c = sign * obj_coeff[j];
+			eT v = c > eT(0) ? lb[j] :
+				   c < eT(0) ? ub[j] :
+				   lb[j] != -inf && lb[j] > eT(0) ? lb[j] :
+				   ub[j] !=  inf && ub[j] < eT(0) ? ub[j] :
+				   eT(0);
+			if(v != -inf && v != inf) {
+				fix_var(j, v);
+				changed = true;
+			}
+		}
+
+		// duplicate constraints, only when the simpler reductions are done
+		if(changed || infeasible) continue;
+
+		std::unordered_map<uint64_t, std::vector<uint>> buckets;
+		for(uint i = 0; i < n_con && !infeasible; i++) {
+			if(!row_alive[i]) continue;
+
+			// hash of the columns and of the coefficients divided by the first one (rounded to float, candidates are
+			// compared exactly, or up to the usual tolerance for floats)
+			uint p0 = first_alive(i);
+			uint64_t h = 0xcbf29ce484222325ULL;
+			for(uint p = p0; p < row_ptr[i+1]; p++) {
+				if(!col_alive[row_col[p]]) continue;
+				float ratio = float(to_double(row_val[p]) / to_double(row_val[p0]));
+				uint32_t bits;
+				std::memcpy(&bits, &ratio, sizeof(bits));
+				h = (h ^ row_col[p]) * 0x100000001b3ULL;
+				h = (h ^ bits) * 0x100000001b3ULL;
+			}
+
+			auto& bucket = buckets[h];
+			bool merged = false;
+			for(uint r : bucket) {
+				eT ratio = row_val[p0] / row_val[first_alive(r)];
+				if(!same_coeffs(r, i, ratio)) continue;
+
+				// clb_i <= ratio * (row r) x <= cub_i
+				eT l, u;
+				divide(clb[i], cub[i], ratio, l, u);
+				intersect(clb[r], cub[r], l, u);
+				remove_con(i);
+				merged = changed = true;
+				break;
+			}
+			if(!merged)
+				bucket.push_back(i);
+		}
+	}
+
+	if(infeasible) {
+		status = Status::INFEASIBLE;
+		return false;
+	}
+
+	// the reduced program
+	LinearProgram<eT> red;
+	red.maximize = maximize;
+	red.method = method;
+	red.solver = s;
+	red.presolve = presolve;		// for the solver's own presolver
+	red.msg_level = msg_level;
+	red.pricing = pricing;
+	red.instrument = instrument;
+	red.external_command = external_command;
+	red.external_format = external_format;
+	red.portfolio = portfolio;
+	red.family = family;
+	red.copy_limits(*this);
+
+	std::vector<uint> new_var(n_var);
+	for(uint j = 0; j < n_var; j++) {
+		if(!col_alive[j]) continue;
+		new_var[j] = red.make_var(lb[j], ub[j]);
+		red.set_obj_coeff(new_var[j], obj_coeff[j]);
+	}
+	for(uint i = 0; i < n_con; i++) {
+		if(!row_alive[i]) continue;
+		Con c = red.make_con(clb[i], cub[i]);
+		for(uint p = row_ptr[i]; p < row_ptr[i+1]; p++)
+			if(col_alive[row_col[p]])
+				red.set_con_coeff(c, new_var[row_col[p]], row_val[p]);
+	}
+	red.con_coeff.compress(red.n_var);
+
+	if(msg_level != MsgLevel::OFF)
+		std::cerr << "Presolve: " << n_var << "x" << n_con << " -> " << red.n_var << "x" << red.n_con << "\n";
+	lap(stats.canonicalize);
+
+	bool res;
+	if(red.n_con == 0) {
+		// all remaining variables have an infinite best bound
+		status = red.n_var == 0 ? Status::OPTIMAL : Status::UNBOUNDED;
+		res = red.n_var == 0;
+	} else {
+		red.lap_start = Clock::now();
+		res = red.run_solver(s);
+		status = red.status;
+		portfolio_winner = red.portfolio_winner;
+		stats.iterations = red.stats.iterations;
+		stats.canonicalize += red.stats.canonicalize;
+		stats.setup += red.stats.setup;
+		stats.solve += red.stats.solve;
+		stats.extract += red.stats.extract;
+		lap_start = Clock::now();
+	}
+
+	if(res || red.has_solution()) {		// also a feasible solution of an interrupted solve
+		sol = value;
+		for(uint j = 0; j < n_var; j++)
+			if(col_alive[j])
+				sol(j) = red.sol(new_var[j]);
+	}
+	lap(stats.extract);
+
+	return res;
+}
+
+// internal solver, uses simplex() (or interior() for Method::INTERIOR) after cloning and converting to canonical
+// form. Mostly useful for rats
 //
 template<typename eT>
 inline
 bool LinearProgram<eT>::internal_solver() {
 
-	if(method != Method::AUTO && method != Method::SIMPLEX_PRIMAL)
-		throw std::runtime_error("internal solver only supports simplex_primal method");
+	const bool is_interior = method == Method::INTERIOR;
+	if constexpr (std::is_same<eT, rat>::value)
+		if(is_interior)
+			throw std::runtime_error("the internal interior point method is only available for floating types");
 
 	LinearProgram<eT> lp(*this);	// clone
+	lp.sol.reset();
+	lp.memory_limit = 0;			// part of the estimate of solve()
 	lp.to_canonical_form();
+	lap(stats.canonicalize);
 
-	bool res = lp.simplex();
+	bool res;
+	if constexpr (std::is_same<eT, rat>::value)
+		res = lp.simplex();
+	else
+		res = is_interior ? lp.interior() : lp.simplex();
 	status = lp.status;
+	stats.iterations = std::max<int64_t>(stats.iterations, 0) + lp.stats.iterations;	// hybrid: added to the float iterations
+	lap(stats.solve);
 
-	if(res)
+	if(res || lp.has_solution())		// also a feasible solution of an interrupted solve
 		sol = lp.original_solution();
 
+	if(res && !is_interior) {
+		basis_from_canonical(lp);
+		if(sensitivity)
+			compute_duals();
+	}
+
+	if(res && is_interior) {
+		// Crossover: the interior solution lies (approximately) in the optimal face. Fixing the variables that are at
+		// one of their bounds leaves a program with few free variables, whose vertices are vertices of the original
+		// one, and the primal simplex finds an optimal one in a few pivots. If it fails (numerically), the interior
+		// solution is kept.
+		LinearProgram<eT> vlp(*this);
+		vlp.method = Method::SIMPLEX_PRIMAL;
+		vlp.memory_limit = 0;
+		vlp.instrument = false;
+		vlp.stats = Stats();
+		const eT inf = infinity<eT>();
+		const eT at_bound = eT(1e-7);
+
+		for(uint x = 0; x < n_var; x++) {
+			eT lb = var_lb[x], ub = var_ub[x];
+			if(lb != -inf && sol(x) - lb <= at_bound * (eT(1) + abs(lb)))
+				vlp.var_ub[x] = lb;
+			else if(ub != inf && ub - sol(x) <= at_bound * (eT(1) + abs(ub)))
+				vlp.var_lb[x] = ub;
+		}
+
+		if(vlp.internal_solver()) {
+			sol = vlp.sol;
+			stats.iterations += vlp.stats.iterations;
+		}
+		lap(stats.solve);
+	}
+	lap(stats.extract);
+
 	return res;
 }
 
@@ -314,6 +1292,13 @@ bool LinearProgram<eT>::glpk() {
 	throw std::runtime_error("glpk not available");
 #else
 
+	// one GLPK solve at a time (see glpk_mutex), and no need to start if cancelled while waiting
+	std::lock_guard<std::mutex> glpk_lock(glpk_mutex());
+	if(interrupted(0)) {
+		status = Status::INTERRUPTED;
+		return false;
+	}
+
 	// create problem
 	glp_prob *lp = wrapper::glp_create_prob();
 
@@ -349,7 +1334,7 @@ bool LinearProgram<eT>::glpk() {
 	//
 	wrapper::glp_add_rows(lp, n_con);
 
-	int size = con_coeff.size();
+	int size = con_coeff.nnz();
 
 	std::vector<int>	ia(size+1),
 						ja(size+1);
@@ -369,33 +1354,58 @@ bool LinearProgram<eT>::glpk() {
 		wrapper::glp_set_row_bnds(lp, i+1, type, to_double(lb), to_double(ub));
 	}
 
-	// loop over non-zero elements of sparse array
-	int index = 1;
-	for(auto& [key, val] : con_coeff) {
-		auto& [col, row] = key;
-		ia[index] = row + 1;
-		ja[index] = col + 1;
-		ar[index] = to_double(val);
-		index++;
+	// the CSC arrays are already in the right order
+	for(uint j = 0, index = 1; j < n_var; j++) {
+		for(uint k = con_coeff.col_ptr[j]; k < con_coeff.col_ptr[j+1]; k++, index++) {
+			ia[index] = con_coeff.row_ind[k] + 1;
+			ja[index] = j + 1;
+			ar[index] = to_double(con_coeff.values[k]);
+		}
 	}
 
 	wrapper::glp_load_matrix(lp, size, &ia[0], &ja[0], &ar[0]);
+	lap(stats.setup);
 
 	std::map<string,int> glp_msg_levs = { { MsgLevel::OFF, GLP_MSG_OFF }, { MsgLevel::ERR, GLP_MSG_ERR }, { MsgLevel::ON, GLP_MSG_ON }, { MsgLevel::ALL, GLP_MSG_ALL } };
 	const int msg_lev = glp_msg_levs[msg_level];
 
+	// glpk's basis statuses, in the same order as BasisStatus::{BASIC, AT_LOWER, AT_UPPER, FREE, FIXED}
+	const string our_stats = { BasisStatus::BASIC, BasisStatus::AT_LOWER, BasisStatus::AT_UPPER, BasisStatus::FREE, BasisStatus::FIXED };
+	const int glp_stats[] = { GLP_BS, GLP_NL, GLP_NU, GLP_NF, GLP_NS };
+	auto to_glp   = [&](char st) -> int  { return glp_stats[our_stats.find(st)]; };
+	auto from_glp = [&](int st) -> char  { return our_stats[std::find(glp_stats, glp_stats + 5, st) - glp_stats]; };
+
 	// solve
 	const bool is_interior = method == Method::INTERIOR;
 	if(!is_interior) {	// simplex primal/dual
+		// starting basis. Non-basic statuses that don't match the (possibly changed) bounds are corrected by glpk
+		const bool warm = use_basis();
+		if(warm) {
+			for(uint j = 0; j < n_var; j++)
+				wrapper::glp_set_col_stat(lp, j+1, to_glp(start_var_status(j)));
+			for(uint i = 0; i < n_con; i++)
+				wrapper::glp_set_row_stat(lp, i+1, to_glp(start_con_status(i)));
+		}
+
 		glp_smcp opt;
 		wrapper::glp_init_smcp(&opt);
 		opt.meth = method == Method::SIMPLEX_PRIMAL ? GLP_PRIMAL : GLP_DUALP;	// DUALP: use dual, switch to primal if it fails. DUALP is also set if method == AUTO
 		opt.msg_lev = msg_lev;							// debug info sent to terminal, default off
-		opt.presolve = presolve ? GLP_ON : GLP_OFF;		// use presolver
+		opt.presolve = presolve && !warm ? GLP_ON : GLP_OFF;	// use presolver (it ignores the starting basis)
+		if(time_limit > 0)
+			opt.tm_lim = int(std::min(std::max(time_left(), 0.0) * 1000, double(std::numeric_limits<int>::max())));	// ms
+		if(iteration_limit > 0)
+			opt.it_lim = int(std::min<int64_t>(iteration_limit, std::numeric_limits<int>::max()));
 
 		//glp_scale_prob(lp, GLP_SF_AUTO);	// scaling is done by the presolver
 		int glp_res = wrapper::glp_simplex(lp, &opt);
 
+		// the previous basis might be singular for the modified program, restart from the standard one
+		if(warm && (glp_res == GLP_EBADB || glp_res == GLP_ESING || glp_res == GLP_ECOND)) {
+			wrapper::glp_std_basis(lp);
+			glp_res = wrapper::glp_simplex(lp, &opt);
+		}
+
 		int glp_status = wrapper::glp_get_status(lp);
 		int glp_dual_st = wrapper::glp_get_dual_stat(lp);
 
@@ -405,9 +1415,11 @@ bool LinearProgram<eT>::glpk() {
 		//   while all statuses are GLP_UNDEF
 		// - if we know that the dual problem is infeasible, then the primal has to be infeasible OR unbounded
 		//   although we might not know which one
+		// - with a time/iteration limit the current basis might be feasible, its solution is kept (GLP_FEAS)
 		//
 		status =
 			glp_status == GLP_OPT								? Status::OPTIMAL :
+			glp_res == GLP_ETMLIM || glp_res == GLP_EITLIM		? Status::INTERRUPTED :
 			glp_status == GLP_NOFEAS || glp_res == GLP_ENOPFS	? Status::INFEASIBLE :
 			glp_status == GLP_UNBND								? Status::UNBOUNDED :
 			glp_dual_st == GLP_NOFEAS || glp_res == GLP_ENODFS	? Status::INFEASIBLE_OR_UNBOUNDED :
@@ -430,17 +1442,47 @@ bool LinearProgram<eT>::glpk() {
 			glp_status == GLP_NOFEAS? Status::INFEASIBLE_OR_UNBOUNDED :
 									  Status::ERROR;
 	}
+	if(!is_interior)
+		stats.iterations = wrapper::glp_get_it_cnt(lp);
+	lap(stats.solve);
+
+	// feasible solution of an interrupted simplex
+	if(status == Status::INTERRUPTED && wrapper::glp_get_prim_stat(lp) == GLP_FEAS) {
+		sol.set_size(n_var);
+		for(uint j = 0; j < n_var; j++)
+			sol.at(j) = wrapper::glp_get_col_prim(lp, j+1);
+	}
 
 	// get optimal solution
 	if(status == Status::OPTIMAL) {
 		sol.set_size(n_var);
 		for(uint j = 0; j < n_var; j++)
 			sol.at(j) = is_interior ? wrapper::glp_ipt_col_prim(lp, j+1) : wrapper::glp_get_col_prim(lp, j+1);
+
+		// store the basis for warm starting the next solve
+		if(!is_interior) {
+			var_basis.resize(n_var);
+			con_basis.resize(n_con);
+			for(uint j = 0; j < n_var; j++)
+				var_basis[j] = from_glp(wrapper::glp_get_col_stat(lp, j+1));
+			for(uint i = 0; i < n_con; i++)
+				con_basis[i] = from_glp(wrapper::glp_get_row_stat(lp, i+1));
+		}
+
+		if(sensitivity) {
+			con_duals.set_size(n_con);
+			var_reduced_costs.set_size(n_var);
+			for(uint i = 0; i < n_con; i++)
+				con_duals.at(i) = is_interior ? wrapper::glp_ipt_row_dual(lp, i+1) : wrapper::glp_get_row_dual(lp, i+1);
+			for(uint j = 0; j < n_var; j++)
+				var_reduced_costs.at(j) = is_interior ? wrapper::glp_ipt_col_dual(lp, j+1) : wrapper::glp_get_col_dual(lp, j+1);
+		}
 	}
 
 	// clean
 	wrapper::glp_delete_prob(lp);
 	wrapper::glp_free_env();
+	lap(stats.extract);
 
 	return status == Status::OPTIMAL;
 
@@ -513,10 +1555,9 @@ bool LinearProgram<eT>::ortools() {
 	for(uint c = 0; c < n_con; c++)
 		cons[c] = orsolver.MakeRowConstraint(val(con_lb[c]), val(con_ub[c]));
 
-	for(auto& [key, value] : con_coeff) {
-		auto& [col, row] = key;
-		cons[row]->SetCoefficient(vars[col], val(value));
-	}
+	for(uint x = 0; x < n_var; x++)
+		for(uint k = con_coeff.col_ptr[x]; k < con_coeff.col_ptr[x+1]; k++)
+			cons[con_coeff.row_ind[k]]->SetCoefficient(vars[x], val(con_coeff.values[k]));
 
 	// set params
 	MPSolverParameters param;
@@ -527,37 +1568,396 @@ bool LinearProgram<eT>::ortools() {
 	);
 	param.SetIntegerParam(MPSolverParameters::PRESOLVE, presolve ? MPSolverParameters::PRESOLVE_ON : MPSolverParameters::PRESOLVE_OFF);
 
+	// ortools' basis statuses, in the same order as BasisStatus::{BASIC, AT_LOWER, AT_UPPER, FREE, FIXED}
+	const string our_stats = { BasisStatus::BASIC, BasisStatus::AT_LOWER, BasisStatus::AT_UPPER, BasisStatus::FREE, BasisStatus::FIXED };
+	const MPSolver::BasisStatus or_stats[] = { MPSolver::BASIC, MPSolver::AT_LOWER_BOUND, MPSolver::AT_UPPER_BOUND, MPSolver::FREE, MPSolver::FIXED_VALUE };
+	auto to_or   = [&](char st) -> MPSolver::BasisStatus { return or_stats[our_stats.find(st)]; };
+	auto from_or = [&](MPSolver::BasisStatus st) -> char { return our_stats[std::find(or_stats, or_stats + 5, st) - or_stats]; };
+
+	const bool is_interior = method == Method::INTERIOR;
+	if(use_basis() && !is_interior) {
+		std::vector<MPSolver::BasisStatus> var_st(n_var), con_st(n_con);
+		for(uint x = 0; x < n_var; x++)
+			var_st[x] = to_or(start_var_status(x));
+		for(uint c = 0; c < n_con; c++)
+			con_st[c] = to_or(start_con_status(c));
+		orsolver.SetStartingLpBasis(var_st, con_st);
+	}
+
 	if(msg_level == MsgLevel::OFF)
 		orsolver.SuppressOutput();
 	else
 		orsolver.EnableOutput();
 
-	// go
+	// limits. The iteration limit is only available for GLOP
+	if(time_limit > 0)
+		orsolver.set_time_limit(int64_t(std::max(time_left(), 0.0) * 1000));	// ms
+	if(iteration_limit > 0 && ptype == MPSolver::GLOP_LINEAR_PROGRAMMING)
+		orsolver.SetSolverSpecificParametersAsString("max_number_of_iterations: " + std::to_string(iteration_limit));
+
+	lap(stats.setup);
+
+	// go. With an active cancel token, a watcher thread interrupts the solver when it is cancelled (repeatedly, in
+	// case it happens before Solve starts). The guard stops and joins it on every exit, also if Solve throws.
+	struct Watcher {
+		std::atomic<bool> done { false };
+		std::thread thread;
+		void stop() {
+			done = true;
+			if(thread.joinable())
+				thread.join();
+		}
+		~Watcher() { stop(); }
+	} watcher;
+	if(cancel.active())
+		watcher.thread = std::thread([&] {
+			while(!watcher.done) {
+				if(cancel.cancelled())
+					orsolver.InterruptSolve();
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		});
+
 	auto result_status = orsolver.Solve(param);
+	watcher.stop();
+	stats.iterations = orsolver.iterations();
+	lap(stats.solve);
 
 	status =
 		result_status == MPSolver::OPTIMAL    ? Status::OPTIMAL :
 		result_status == MPSolver::INFEASIBLE ? Status::INFEASIBLE :
 		result_status == MPSolver::UNBOUNDED  ? Status::UNBOUNDED :
+		result_status == MPSolver::FEASIBLE || interrupted(stats.iterations) ? Status::INTERRUPTED :
 		Status::ERROR;
 
+	// feasible solution of an interrupted solve
+	if(result_status == MPSolver::FEASIBLE) {
+		sol.set_size(n_var);
+		for(uint x = 0; x < n_var; x++)
+			sol(x) = vars[x]->solution_value();
+	}
+
 	if(status == Status::OPTIMAL) {
 		sol.set_size(n_var);
 		for(uint x = 0; x < n_var; x++)
 			sol(x) = vars[x]->solution_value();
+
+		// store the basis for warm starting the next solve
+		if(!is_interior) {
+			var_basis.resize(n_var);
+			con_basis.resize(n_con);
+			for(uint x = 0; x < n_var; x++)
+				var_basis[x] = from_or(vars[x]->basis_status());
+			for(uint c = 0; c < n_con; c++)
+				con_basis[c] = from_or(cons[c]->basis_status());
+		}
+
+		if(sensitivity) {
+			con_duals.set_size(n_con);
+			var_reduced_costs.set_size(n_var);
+			for(uint c = 0; c < n_con; c++)
+				con_duals(c) = cons[c]->dual_value();
+			for(uint x = 0; x < n_var; x++)
+				var_reduced_costs(x) = vars[x]->reduced_cost();
+		}
 	}
+	lap(stats.extract);
 
 	return status == Status::OPTIMAL;
 
 #endif // QIF_USE_ORTOOLS
 }
 
+// Hybrid solver, for rat. Solves the double version of the program with the fast floating solver, then takes its
+// optimal basis and verifies it exactly: the basic solution is computed in eT with a single (sparse) factorization of
+// the basis, and checked for primal and dual feasibility. If the basis is optimal the solution is exact, otherwise
+// (or if the double program is not solved to optimality) we fall back to the internal rational simplex.
+//
+template<typename eT>
+bool LinearProgram<eT>::hybrid() {
+	if(!is_rat)
+		throw std::runtime_error("hybrid solver is only useful for rat");
+
+	const eT inf = infinity<eT>();
+	auto to_d = [&](const eT& v) -> double {
+		return v == inf ? infinity<double>() : v == -inf ? -infinity<double>() : to_double(v);
+	};
+	auto to_d_vec = [&](const std::vector<eT>& v) {
+		std::vector<double> res(v.size());
+		for(uint i = 0; i < v.size(); i++)
+			res[i] = to_d(v[i]);
+		return res;
+	};
+
+	con_coeff.compress(n_var);
+
+	LinearProgram<double> flp;
+	flp.maximize = maximize;
+	flp.method = method == Method::INTERIOR ? Method::AUTO : method;	// we need a basis
+	flp.presolve = presolve;
+	flp.msg_level = msg_level;
+	flp.instrument = instrument;
+	flp.copy_limits(*this);
+	flp.n_var = n_var;
+	flp.n_con = n_con;
+	flp.obj_coeff = to_d_vec(obj_coeff);
+	flp.var_lb = to_d_vec(var_lb);
+	flp.var_ub = to_d_vec(var_ub);
+	flp.con_lb = to_d_vec(con_lb);
+	flp.con_ub = to_d_vec(con_ub);
+	flp.con_coeff.col_ptr = con_coeff.col_ptr;
+	flp.con_coeff.row_ind = con_coeff.row_ind;
+	for(auto& v : con_coeff.values)
+		flp.con_coeff.values.push_back(to_double(v));
+	lap(stats.setup);
+
+	bool flp_res = flp.run_solver(flp.actual_solver());		// not solve(), its presolve does not keep the basis we need
+	stats.iterations = flp.stats.iterations;
+	lap(stats.solve);
+
+	// the limits apply to the whole solve, don't continue with the internal solver (the floating solution, if any,
+	// is kept as it is)
+	if(flp.status == Status::INTERRUPTED) {
+		status = Status::INTERRUPTED;
+		if(flp.has_solution()) {
+			sol.set_size(n_var);
+			for(uint j = 0; j < n_var; j++)
+				sol(j) = eT(flp.sol(j));
+		}
+		return false;
+	}
+
+	bool verified = flp_res && !flp.var_basis.empty() && verify_basis(flp.var_basis, flp.con_basis);
+	lap(stats.extract);
+	if(verified) {
+		status = Status::OPTIMAL;
+		var_basis = flp.var_basis;
+		con_basis = flp.con_basis;
+		if(sensitivity)
+			compute_duals();		// exact, from the verified basis
+		return true;
+	}
+
+	if(msg_level != MsgLevel::OFF)
+		std::cerr << "Hybrid LP: basis not verified, falling back to the internal solver\n";
+
+	return internal_solver();
+}
+
+// Computes the basic solution for the given basis statuses, and stores it in sol if it is optimal.
+//
+template<typename eT>
+bool LinearProgram<eT>::verify_basis(const std::vector<char>& vb, const std::vector<char>& cb) {
+	const eT inf = infinity<eT>();
+	const auto& A = con_coeff;
+	assert(A.is_compressed());
+
+	// the basic solution: non-basic variables are at a bound, non-basic constraints are active
+	Col<eT> x = arma::zeros<Col<eT>>(n_var);
+	std::vector<uint> basic_vars;
+	std::vector<int> active_index(n_con, -1);		// index of each non-basic constraint in the basis matrix
+	std::vector<eT> rhs;
+
+	for(uint j = 0; j < n_var; j++) {
+		char st = vb[j];
+		if(st == BasisStatus::BASIC) {
+			basic_vars.push_back(j);
+			continue;
+		}
+		x(j) = st == BasisStatus::AT_UPPER ? var_ub[j] : st == BasisStatus::FREE ? eT(0) : var_lb[j];
+		if(x(j) == inf || x(j) == -inf || (st == BasisStatus::FIXED && var_lb[j] != var_ub[j]))
+			return false;
+	}
+	for(uint i = 0; i < n_con; i++) {
+		char st = cb[i];
+		if(st == BasisStatus::BASIC) continue;
+
+		eT b = st == BasisStatus::AT_UPPER ? con_ub[i] : con_lb[i];
+		if(st == BasisStatus::FREE || b == inf || b == -inf || (st == BasisStatus::FIXED && con_lb[i] != con_ub[i]))
+			return false;
+
+		active_index[i] = rhs.size();
+		rhs.push_back(b);
+	}
+
+	const uint m = basic_vars.size();
+	if(rhs.size() != m)
+		return false;
+
+	// A_{active, basic} x_B = b_active - A_{active, non-basic} x_N
+	for(uint j = 0; j < n_var; j++)
+		if(vb[j] != BasisStatus::BASIC && x(j) != eT(0))
+			for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+				if(active_index[A.row_ind[k]] >= 0)
+					rhs[active_index[A.row_ind[k]]] -= A.values[k] * x(j);
+
+	BasisLU<eT> lu;
+	bool ok = lu.factorize(m, [&](uint pos, typename BasisLU<eT>::SpVec& out) {
+		uint j = basic_vars[pos];
+		for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+			if(active_index[A.row_ind[k]] >= 0)
+				out.push_back({ uint(active_index[A.row_ind[k]]), A.values[k] });
+	});
+	if(!ok)
+		return false;
+
+	lu.ftran(rhs);
+	for(uint pos = 0; pos < m; pos++)
+		x(basic_vars[pos]) = rhs[pos];
+
+	// primal feasibility
+	std::vector<eT> activity(n_con, eT(0));
+	for(uint j = 0; j < n_var; j++) {
+		if(x(j) < var_lb[j] || x(j) > var_ub[j])
+			return false;
+		if(x(j) != eT(0))
+			for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+				activity[A.row_ind[k]] += A.values[k] * x(j);
+	}
+	for(uint i = 0; i < n_con; i++)
+		if(activity[i] < con_lb[i] || activity[i] > con_ub[i])
+			return false;
+
+	// dual feasibility, checked for minimization (so the costs are negated when maximizing).
+	// y^T A_{active, basic} = c_B, reduced costs d = c - A^T y
+	const eT sign = maximize ? eT(-1) : eT(1);
+	std::vector<eT> y(m);
+	for(uint pos = 0; pos < m; pos++)
+		y[pos] = sign * obj_coeff[basic_vars[pos]];
+	lu.btran(y);
+
+	for(uint i = 0; i < n_con; i++) {
+		int r = active_index[i];
+		if(r < 0 || cb[i] == BasisStatus::FIXED) continue;
+		if(cb[i] == BasisStatus::AT_LOWER ? y[r] < eT(0) : y[r] > eT(0))
+			return false;
+	}
+	for(uint j = 0; j < n_var; j++) {
+		char st = vb[j];
+		if(st == BasisStatus::BASIC || st == BasisStatus::FIXED) continue;
+
+		eT d = sign * obj_coeff[j];
+		for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+			if(active_index[A.row_ind[k]] >= 0)
+				d -= y[active_index[A.row_ind[k]]] * A.values[k];
+
+		if(st == BasisStatus::AT_LOWER ? d < eT(0) : st == BasisStatus::AT_UPPER ? d > eT(0) : d != eT(0))
+			return false;
+	}
+
+	sol = x;
+	return true;
+}
+
+// Duals and reduced costs from the basis (var_basis, con_basis): y solves  y^T A_{active, basic} = c_B  on the
+// non-basic (active) constraints and is 0 on the basic ones, d = c - A^T y. Computed in eT with a single
+// factorization of the basis, as in verify_basis, so they are exact for rat. Returns false (no duals) if the basis
+// is not square or singular.
+//
+template<typename eT>
+bool LinearProgram<eT>::compute_duals() {
+	const auto& A = con_coeff;
+	assert(A.is_compressed());
+	if(var_basis.size() != n_var || con_basis.size() != n_con)
+		return false;
+
+	std::vector<uint> basic_vars;
+	std::vector<int> active_index(n_con, -1);		// index of each non-basic constraint in the basis matrix
+	uint n_active = 0;
+	for(uint j = 0; j < n_var; j++)
+		if(var_basis[j] == BasisStatus::BASIC)
+			basic_vars.push_back(j);
+	for(uint i = 0; i < n_con; i++)
+		if(con_basis[i] != BasisStatus::BASIC)
+			active_index[i] = n_active++;
+
+	const uint m = basic_vars.size();
+	if(n_active != m)
+		return false;
+
+	std::vector<eT> y(m);
+	if(m > 0) {
+		BasisLU<eT> lu;
+		bool ok = lu.factorize(m, [&](uint pos, typename BasisLU<eT>::SpVec& out) {
+			uint j = basic_vars[pos];
+			for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+				if(active_index[A.row_ind[k]] >= 0)
+					out.push_back({ uint(active_index[A.row_ind[k]]), A.values[k] });
+		});
+		if(!ok)
+			return false;
+
+		for(uint pos = 0; pos < m; pos++)
+			y[pos] = obj_coeff[basic_vars[pos]];
+		lu.btran(y);
+	}
+
+	con_duals = arma::zeros<Col<eT>>(n_con);
+	for(uint i = 0; i < n_con; i++)
+		if(active_index[i] >= 0)
+			con_duals(i) = y[active_index[i]];
+
+	var_reduced_costs.set_size(n_var);
+	for(uint j = 0; j < n_var; j++) {
+		eT d = obj_coeff[j];
+		for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+			if(active_index[A.row_ind[k]] >= 0)
+				d -= y[active_index[A.row_ind[k]]] * A.values[k];
+		var_reduced_costs(j) = var_basis[j] == BasisStatus::BASIC ? eT(0) : d;
+	}
+	return true;
+}
+
+// The basis of this program from the optimal basis of its canonical form clp (see to_canonical_form, simplex),
+// following the same transformations: a free variable is basic if either of its two parts is, an upper-bounded one
+// is at its upper bound when its (negated) canonical variable is at 0, and a constraint is basic if its slack (or its
+// auxiliary) is, and active at the bound given by the slack's bound otherwise.
+//
+template<typename eT>
+void LinearProgram<eT>::basis_from_canonical(const LinearProgram<eT>& clp) {
+	const eT inf = infinity<eT>();
+	const auto& cb = clp.var_basis;
+	var_basis.resize(n_var);
+	con_basis.resize(n_con);
+
+	uint next = n_var;			// the variables added by to_canonical_form: negative parts of free variables, then slacks
+	for(uint x = 0; x < n_var; x++) {
+		const eT &lb = var_lb[x], &ub = var_ub[x];
+		const char st = cb[x];
+		if(lb == -inf && ub == inf)
+			var_basis[x] = st == BasisStatus::BASIC || cb[next++] == BasisStatus::BASIC ? BasisStatus::BASIC : BasisStatus::FREE;
+		else if(st == BasisStatus::BASIC)
+			var_basis[x] = BasisStatus::BASIC;
+		else if(lb == ub)
+			var_basis[x] = BasisStatus::FIXED;
+		else if(lb == -inf)
+			var_basis[x] = BasisStatus::AT_UPPER;
+		else
+			var_basis[x] = st;
+	}
+	for(uint c = 0; c < n_con; c++) {
+		const eT &lb = con_lb[c], &ub = con_ub[c];
+		const bool aux_basic = clp.con_basis[c] == BasisStatus::BASIC;
+		if(lb == -inf) {
+			const char st = cb[next++];
+			con_basis[c] = aux_basic || st == BasisStatus::BASIC ? BasisStatus::BASIC : BasisStatus::AT_UPPER;
+		} else if(ub == inf || lb != ub) {
+			const char st = cb[next++];						// a x - s = lb, s in [0, ub - lb]
+			con_basis[c] = aux_basic || st == BasisStatus::BASIC ? BasisStatus::BASIC : st;
+		} else {
+			con_basis[c] = aux_basic ? BasisStatus::BASIC : BasisStatus::FIXED;
+		}
+	}
+}
+
 
 // transform the progarm in canonical form:
 //        min  dot(c,x)
 // subject to  A x == b
-//               x >= 0
-// b must be >= 0.
+//          0 <= x <= u
+// b must be >= 0. Upper bounds are kept as variable bounds (u is infinity for variables without one), which the
+// simplex handles implicitly, so doubly bounded variables (eg. channel entries in [0,1]) and ranged constraints do
+// not add rows.
 //
 template<typename eT>
 void LinearProgram<eT>::to_canonical_form() {
@@ -568,7 +1968,12 @@ void LinearProgram<eT>::to_canonical_form() {
 	if(var_transform.size() != 0)
 		throw std::runtime_error("var_transform already set");
 
-	// in canonical form, all variable bounds should be [0, infty]
+	// The coefficients are processed in CSC form, so the entries of each variable (column) are contiguous. New
+	// entries are set as usual and merged by the next compress().
+	auto& A = con_coeff;
+	A.compress(n_var);
+
+	// in canonical form, all variable bounds should be [0, u]
 	// we need to do various transformations, in the following we denote by x* the value of x in the original program
 	//
 	for(uint x = 0; x < n_var_orig; x++) {
@@ -589,11 +1994,8 @@ void LinearProgram<eT>::to_canonical_form() {
 			set_obj_coeff(xnew, -obj_coeff[x]);
 			
 			// and for every coeff c of x in constraints, we need to add -c to xnew
-			for(auto& [key, val] : con_coeff) {
-				auto& [col, row] = key;
-				if(col == x)
-					set_con_coeff(row, xnew, -val);
-			}
+			for(uint k = A.col_ptr[x]; k < A.col_ptr[x+1]; k++)
+				set_con_coeff(A.row_ind[k], xnew, -A.values[k]);
 
 		} else if(lb == -inf) {
 			// upper bounded variable, we set x = ub - x* (x* = ub - x)
@@ -601,57 +2003,37 @@ void LinearProgram<eT>::to_canonical_form() {
 
 			obj_coeff[x] *= -1;
 
-			for(auto& [key, val] : con_coeff) {
-				auto& [col, row] = key;
+			for(uint k = A.col_ptr[x]; k < A.col_ptr[x+1]; k++) {
+				uint row = A.row_ind[k];
+				eT& val = A.values[k];
+
 				// a <= c x* <= b becomes a <= c(ub-x) <= b, so we need to subtract c*ub from lower/upper bound and then change sign of c
-				if(col == x) {
-					if(con_lb[row] != -inf)
-						con_lb[row] -= val * ub;
-					if(con_ub[row] != inf)
-						con_ub[row] -= val * ub;
+				if(con_lb[row] != -inf)
+					con_lb[row] -= val * ub;
+				if(con_ub[row] != inf)
+					con_ub[row] -= val * ub;
 
-					val *= -1;
-				}
+				val *= -1;
 			}
 
 		} else { // lb != inf
 			// lower or doubly bounded variable, we set x = x* - lb  (x* = x + lb)
 			var_transform.push_back(std::tuple(-1, eT(1), lb));
 
-			for(auto& [key, val] : con_coeff) {
-				auto& [col, row] = key;
-				// a <= c x* <= b becomes a <= c(x+lb) <= b, so we need to subtract c*lb from lower/upper bound
-				if(col == x) {
-					if(con_lb[row] != -inf)
-						con_lb[row] -= val * lb;
-					if(con_ub[row] != inf)
-						con_ub[row] -= val * lb;
-				}
-			}
+			for(uint k = A.col_ptr[x]; k < A.col_ptr[x+1]; k++) {
+				uint row = A.row_ind[k];
+				eT val = A.values[k];
 
-			// if an upper bound x* <= ub exists, it bocomes x+lb <= ub so we add a new constraint x <= ub - lb
-			if(ub != inf) {
-				uint con = make_con(-inf, ub - lb);
-				set_con_coeff(con, x, eT(1));
+				// a <= c x* <= b becomes a <= c(x+lb) <= b, so we need to subtract c*lb from lower/upper bound
+				if(con_lb[row] != -inf)
+					con_lb[row] -= val * lb;
+				if(con_ub[row] != inf)
+					con_ub[row] -= val * lb;
 			}
-		}
-	}
-
-	// for every constraint lb <= cx <= ub with lb != ub, change ub to infty and add a separate consraint cx <= ub
-	for(uint c = 0; c < n_con; c++) {
-		eT lb = con_lb[c];
-		eT ub = con_ub[c];
-
-		if(lb != -inf && ub != inf && lb != ub) {
-			con_ub[c] = inf;
-
-			uint newc = make_con(-inf, ub);
 
-			for(auto& [key, val] : con_coeff) {
-				auto& [col, row] = key;
-				if(row == c)
-					set_con_coeff(newc, col, val);
-			}
+			// an upper bound x* <= ub becomes x <= ub - lb
+			if(ub != inf)
+				var_ub[x] = ub - lb;
 		}
 	}
 
@@ -667,29 +2049,30 @@ void LinearProgram<eT>::to_canonical_form() {
 			uint xnew = make_var(eT(0), inf);
 			set_con_coeff(c, xnew, eT(1));
 
-		} else if(ub == inf) {
-			// lower bound, subtract slack newx to make equal
+		} else if(ub == inf || lb != ub) {
+			// lower bound (or range lb <= cx <= ub), subtract slack newx in [0, ub-lb] to make equal
 			con_ub[c] = lb;
 
-			uint xnew = make_var(eT(0), inf);
+			uint xnew = make_var(eT(0), ub == inf ? inf : ub - lb);
 			set_con_coeff(c, xnew, eT(-1));
 		}
 	}
 
 	// invert constraints with negative constants
+	std::vector<char> invert(n_con, 0);
 	for(uint c = 0; c < n_con; c++) {
 
 		if(less_than(con_ub[c], eT(0))) {
 			con_lb[c] *= -1;
 			con_ub[c] *= -1;
-
-			for(auto& [key, val] : con_coeff) {
-				auto row = std::get<1>(key);
-				if(row == c)
-					val *= -1;
-			}
+			invert[c] = 1;
 		}
 	}
+	A.compress(n_var);
+	A.for_each([&](uint row, uint, eT& val) {
+		if(invert[row])
+			val *= -1;
+	});
 
 	// canonical form is minimizing
 	if(maximize) {
@@ -704,104 +2087,330 @@ void LinearProgram<eT>::to_canonical_form() {
 // Solve the linear program in canonical form
 //        min  dot(c,x)
 // subject to  A x == b
-//               x >= 0
+//          0 <= x <= u
 // b must be >= 0.
 // 
 // This is mainly to be used with rats
 //
-// The algorithm is the two-phase primal revised simplex method.
-// In the first phase auxiliaries are created which we eliminate
-// until we have a basis consisting solely of actual variables.
-// This is pretty much the "textbook algorithm", and shouldn't
-// be used for anything that matters. It doesn't exploit sparsity
-// at all. You could use it with floating points but it wouldn't 
-// work for anything except the most simple problem due to accumulated
-// errors and the comparisons with zero.
+// The algorithm is the revised simplex method with bounded variables: a non-basic variable is at its lower (0) or
+// upper bound, so upper bounds never become rows. The basic variables are x_B = B^-1 (b - A_U u_U), U being the
+// non-basic variables at their upper bound. Two variants:
+// - primal (Method::SIMPLEX_PRIMAL or AUTO): two phases. In the first phase auxiliaries are created which we
+//   eliminate until we have a basis consisting solely of actual variables. In the ratio test the entering variable
+//   can reach its own upper bound first, it then simply moves to that bound (bound flip) without a pivot.
+// - dual (Method::SIMPLEX_DUAL): starts from the basis of the auxiliaries fixed at 0, which is dual feasible when
+//   every variable with a negative cost has an upper bound (eg. minimization with non-negative costs, or channel
+//   entries in [0,1]) and moves it to the upper bound. It needs no first phase: each iteration chooses the most
+//   infeasible basic variable to leave, and the entering one by the dual ratio test. If the starting basis is not
+//   dual feasible the primal simplex is used.
+//
+// The basis is kept as a sparse LU factorization with eta updates (see
+// BasisLU), refactorized every refactor_period pivots, and A is only
+// accessed through its CSC columns. So the cost of an iteration depends
+// on the non-zeros of A and of the factors, not on n_con * n_var.
+//
+// Pricing (choice of the entering variable, primal):
+// - Pricing::BLAND: the first variable with a reduced cost of the right sign. Never cycles.
+// - Pricing::DEVEX (or AUTO): the largest reduced cost relative to an approximate
+//   steepest-edge weight, usually much fewer iterations. Bland's rule is used
+//   during long sequences of degenerate pivots, to avoid cycling.
+// Devex weights are heuristic so they are kept as doubles, also for rats.
+// The dual simplex similarly switches to smallest-index choices after many degenerate pivots.
 //
 // Summary of the algorithm:
 // https://ocw.mit.edu/courses/sloan-school-of-management/15-093j-optimization-methods-fall-2009/lecture-notes/MIT15_093J_F09_lec04.pdf
 //
 template<typename eT>
 bool LinearProgram<eT>::simplex() {
-	using arma::zeros;
-	using arma::ones;
-	using arma::eye;
-	using arma::uvec;
+	const uint m = n_con,
+			   n = n_var;
+	const uint refactor_period = 100;
+	const uint max_degenerate = 50;			// switch to Bland after so many consecutive degenerate pivots
+	const bool devex = pricing != Pricing::BLAND;
+	const eT inf = infinity<eT>();
+
+	assert(!maximize);
+	for(uint i = 0; i < m; i++)
+		assert(!less_than(con_lb[i], eT(0)));
+
+	// columns 0..n-1 are the variables, n..n+m-1 the auxiliaries (identity)
+	auto& A = con_coeff;
+	A.compress(n);
 
-	// write program in matrix form
-	const Col<eT> b = con_lb;
-	const Row<eT> c = obj_coeff;
-	Mat<eT> A = zeros<Mat<eT>>(n_con, n_var);	// use a dense matrix. The current algorithm doesn't use sparsity anyway, and operations on SpMat are much slower
+	auto for_col = [&](uint j, auto f) {
+		if(j < n) {
+			for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+				f(A.row_ind[k], A.values[k]);
+		} else {
+			f(j - n, eT(1));
+		}
+	};
+	auto dot_col = [&](const std::vector<eT>& y, uint j) -> eT {
+		eT s(0);
+		for_col(j, [&](uint row, const eT& val) {
+			if(y[row] != eT(0))
+				s += y[row] * val;
+		});
+		return s;
+	};
 
-	for(auto& [key, val] : con_coeff) {
-		auto& [col, row] = key;
-		A(row, col) = val;
+	std::vector<uint> basic(m);				// basic variable at each position of the basis
+	std::vector<char> is_basic(n + m, 0);
+	std::vector<char> at_upper(n + m, 0);	// non-basic variable at its upper bound
+	std::vector<eT> xB;						// values of the basic variables
+
+	// upper bound of each variable. The auxiliaries are unbounded in the primal phase one, and fixed at 0 in the
+	// dual simplex (so they leave the basis and never enter it again).
+	bool dual = method == Method::SIMPLEX_DUAL;
+	std::vector<eT> upper(var_ub);
+	upper.resize(n + m, dual ? eT(0) : inf);
+
+	// Intialize by setting basis = auxiliaries.
+	for(uint i = 0; i < m; i++) {
+		basic[i] = n + i;
+		is_basic[n + i] = 1;
 	}
+	bool phase_one = !dual;
 
-	assert(!maximize);
-	for(uint i = 0; i < n_con; i++)
-		assert(!less_than(b.at(i), eT(0)));
-	
-	uint n_con = this->n_con;		// to update locally
-
-	Row<char> is_basic	= zeros<Row<char>>(n_var + n_con);
-	uvec basic			= zeros<uvec>(n_con);				// indices of current basis
-	Mat<eT> Binv		= eye<Mat<eT>>(n_con, n_con);		// inverse of basis matrix
-	Row<eT> cB			= ones<Row<eT>>(n_con);				// costs of basic variables
-	sol					= zeros<Col<eT>>(n_var + n_con);	// current solution
-
-	Col<eT> BinvAs;
-
-	// Intialize phase one of RSM by setting basis = auxiliaries.
-	basic = arma::linspace<uvec>(n_var, n_var + n_con - 1, n_con); // n_var..n_var+n_con-1
-	is_basic.tail(n_con).fill(1);
-	sol.tail(n_con) = b;
-	bool phase_one = true;
-
-	auto pivot = [&](uint leaving, uint entering) -> void {
-		// Update solution.
-		eT ratio = sol(basic(leaving)) / BinvAs(leaving);
-		sol(basic) -= ratio * BinvAs;
-		sol(entering) = ratio;
-
-		// Update basis inverse. Pivot on the `leaving' row, last col of [ Binv | BinvAs ]
-		// Add to each row a multiple of Binv.row(leaving), so that the last col
-		// becomes the identity vector with 1 on 'leaving'-row.
-		//
-		Binv.row(leaving) /= BinvAs(leaving);		// now the leaving row is normalized, there's 1 in the last col
-		for(uint r = 0; r < n_con; r++)
-			if(r != leaving)		// all rows except leaving row
-				Binv.row(r) -= BinvAs(r) * Binv.row(leaving);
+	auto cost = [&](uint j) -> eT {
+		return phase_one ? eT(j >= n ? 1 : 0) : j < n ? obj_coeff[j] : eT(0);
+	};
+
+	// dual simplex: the starting basis B = I has reduced costs d_j = c_j, so the variables with c_j < 0 must start at
+	// their upper bound. If one has no upper bound, use the primal simplex.
+	if(dual) {
+		for(uint j = 0; j < n && dual; j++) {
+			if(less_than(obj_coeff[j], eT(0))) {
+				if(upper[j] == inf)
+					dual = false;
+				else
+					at_upper[j] = 1;
+			}
+		}
+		if(!dual) {
+			std::fill(at_upper.begin(), at_upper.end(), 0);
+			std::fill(upper.begin() + n, upper.end(), inf);
+			phase_one = true;
+		}
+	}
+
+	BasisLU<eT> lu;
+	auto refactor = [&]() -> bool {
+		bool ok = lu.factorize(m, [&](uint pos, typename BasisLU<eT>::SpVec& out) {
+			for_col(basic[pos], [&](uint row, const eT& val) { out.push_back({ row, val }); });
+		});
+		if(ok) {
+			// recompute the solution, this also removes accumulated errors for floating types
+			xB = con_lb;
+			for(uint j = 0; j < n + m; j++)
+				if(at_upper[j])
+					for_col(j, [&](uint row, const eT& val) { xB[row] -= val * upper[j]; });
+			lu.ftran(xB);
+		}
+		return ok;
+	};
+	auto column = [&](uint j) {				// B^-1 A_j
+		std::vector<eT> alpha(m, eT(0));
+		for_col(j, [&](uint row, const eT& val) { alpha[row] = val; });
+		lu.ftran(alpha);
+		return alpha;
+	};
+	auto row = [&](uint p) {				// p-th row of B^-1
+		std::vector<eT> rho(m, eT(0));
+		rho[p] = eT(1);
+		lu.btran(rho);
+		return rho;
+	};
+	auto duals = [&]() {					// y = c_B B^-1
+		std::vector<eT> y(m);
+		for(uint i = 0; i < m; i++)
+			y[i] = cost(basic[i]);
+		lu.btran(y);
+		return y;
+	};
+	auto value = [&](uint j) -> eT {		// value of a non-basic variable
+		return at_upper[j] ? upper[j] : eT(0);
+	};
+	auto abs = [](const eT& v) -> eT { return v < eT(0) ? -v : v; };
+
+	// Devex weights, and a double copy of A to update them
+	std::vector<double> weight(n, 1.0), A_d;
+	if(devex && !dual)
+		for(auto& v : A.values)
+			A_d.push_back(to_double(v));
+
+	uint n_degenerate = 0;
+
+	// The variable at position p of the basis leaves (at its upper bound if leave_upper), q enters changing by
+	// delta (so x_B changes by -delta alpha). alpha = B^-1 A_q
+	auto pivot = [&](uint p, uint q, const std::vector<eT>& alpha, const eT& delta, bool leave_upper) -> bool {
+		if(delta != eT(0)) {
+			for(uint i = 0; i < m; i++) {
+				if(alpha[i] != eT(0))
+					xB[i] -= delta * alpha[i];
+				if constexpr (std::is_floating_point<eT>::value)
+					if(xB[i] < 0 && equal(xB[i], eT(0)))
+						xB[i] = 0;
+			}
+		}
+		xB[p] = value(q) + delta;
+
+		uint leaving = basic[p];
+		is_basic[leaving] = 0;
+		at_upper[leaving] = leave_upper;
+		is_basic[q] = 1;
+		at_upper[q] = 0;
+		basic[p] = q;
+
+		if(lu.n_updates() + 1 >= refactor_period)
+			return refactor();
+		lu.update(p, alpha);
+		return true;
+	};
 
-		// ... and variable status flags
-		is_basic(basic(leaving)) = 0;
-		is_basic(entering) = 1;
-		cB(leaving) = phase_one ? eT(0) : c(entering);
-		basic(leaving) = entering;
+	// the non-basic q moves to its other bound (bound flip), no basis change
+	auto flip = [&](uint q, const std::vector<eT>& alpha) {
+		eT delta = at_upper[q] ? -upper[q] : upper[q];
+		for(uint i = 0; i < m; i++)
+			if(alpha[i] != eT(0))
+				xB[i] -= delta * alpha[i];
+		at_upper[q] = !at_upper[q];
+		n_degenerate = 0;
 	};
 
-	// Begin simplex iterations
-	while(true) {
+	if(!refactor())
+		throw std::runtime_error("shouldn't arrive here");		// the initial basis is the identity
+
+	stats.iterations = 0;
+
+	// Dual simplex iterations. Bounds are checked with a (relative) tolerance, rats are exact.
+	const eT feas_tol = def_md<eT>;
+	bool stopped = false;			// a limit was reached (checked before each pivot)
+	while(dual) {
+		// leaving variable: the most infeasible basic one (the first one when degenerate pivots repeat)
+		const bool bland = n_degenerate >= max_degenerate;
+		uint leaving = m;
+		eT worst(0);
+		bool to_upper = false;
+		for(uint i = 0; i < m; i++) {
+			eT infeas;
+			bool up;
+			if(less_than(xB[i], eT(0), feas_tol, feas_tol)) {
+				infeas = -xB[i];
+				up = false;
+			} else if(upper[basic[i]] != inf && less_than(upper[basic[i]], xB[i], feas_tol, feas_tol)) {
+				infeas = xB[i] - upper[basic[i]];
+				up = true;
+			} else {
+				continue;
+			}
+			if(leaving == m || (bland ? basic[i] < basic[leaving] : worst < infeas)) {
+				leaving = i;
+				worst = infeas;
+				to_upper = up;
+			}
+		}
+
+		// primal feasible: optimal
+		if(leaving == m) {
+			status = Status::OPTIMAL;
+			break;
+		}
+		if(interrupted(stats.iterations)) {
+			status = Status::INTERRUPTED;
+			stopped = true;
+			break;
+		}
+
+		// dual ratio test. x_r = beta_r - sum_j alpha_rj x_j should increase (to 0) or decrease (to u_r). A non-basic
+		// x_j can move if it is not fixed, the direction is increasing at the lower bound, decreasing at the upper.
+		// Among those that move x_r in the right direction, the entering one minimizes |d_j / alpha_rj|, so that all
+		// reduced costs keep their sign. Ties are broken by the largest |alpha_rj| (or the smallest index).
+		auto y = duals();
+		auto rho = row(leaving);
+		uint entering = n;
+		eT min_ratio(0), best_alpha(0);
+		for(uint j = 0; j < n; j++) {
+			if(is_basic[j] || upper[j] == eT(0)) continue;
+
+			eT a = dot_col(rho, j);
+			if(equal(a, eT(0))) continue;
+			bool decreases_r = at_upper[j] ? a < eT(0) : a > eT(0);		// moving x_j away from its bound decreases x_r
+			if(decreases_r != to_upper) continue;
+
+			eT d = abs(cost(j) - dot_col(y, j)),
+			   ratio = d / abs(a);
+			bool better = entering == n || less_than(ratio, min_ratio);
+			if(!better && equal(ratio, min_ratio))
+				better = bland ? false : best_alpha < abs(a);
+			if(better) {
+				entering = j;
+				min_ratio = ratio;
+				best_alpha = abs(a);
+			}
+		}
+
+		// the row cannot be made feasible
+		if(entering == n) {
+			status = Status::INFEASIBLE;
+			break;
+		}
+
+		// x_r moves to its violated bound
+		auto alpha = column(entering);
+		eT delta = (xB[leaving] - (to_upper ? upper[basic[leaving]] : eT(0))) / alpha[leaving];
+
+		stats.iterations++;
+		n_degenerate = equal(min_ratio, eT(0)) ? n_degenerate + 1 : 0;		// dual degenerate: the objective does not change
+		if(!pivot(leaving, entering, alpha, delta, to_upper)) {
+			status = Status::ERROR;		// numerically singular basis
+			break;
+		}
+	}
+
+	// Primal simplex iterations
+	while(!dual && !stopped) {
 		// Calculate dual solution...
-		Row<eT> pi = cB * Binv;
+		auto y = duals();
 
 		// Use it to calculate the reduced costs of the variables. Don't
 		// calculate for auxiliaries - they can't re-enter the basis.
-		Row<eT> rc = (phase_one ? zeros<Row<eT>>(n_var) : c) - pi * A;
-		uint entering;
-		for(entering = 0; entering < n_var; entering++)					// crazy: using arma::index_min causes linker to complain about gmp symbols, even if rat is not used
-			if(!is_basic(entering) && less_than(rc(entering), eT(0)))	// NOTE: Bland's rule, use the first index, to guarantee no cycles
+		// A variable can enter if its reduced cost is negative at the lower bound (it increases), or positive at
+		// the upper bound (it decreases). Fixed variables never enter.
+		const bool bland = !devex || n_degenerate >= max_degenerate;
+		uint entering = n;
+		double best = 0;
+		for(uint j = 0; j < n; j++) {
+			if(is_basic[j] || upper[j] == eT(0)) continue;
+
+			eT rc = cost(j) - dot_col(y, j);
+			if(at_upper[j] ? !less_than(eT(0), rc) : !less_than(rc, eT(0))) continue;
+
+			if(bland) {
+				entering = j;		// use the first index, to guarantee no cycles
 				break;
+			}
+			double rc_d = to_double(rc),
+				   score = rc_d * rc_d / weight[j];
+			if(entering == n || score > best) {
+				entering = j;
+				best = score;
+			}
+		}
 
 		// If we couldn't find a variable with a negative reduced cost, 
 		// we terminate this phase because we are at optimality for this
 		// phase - not necessarily optimal for the actual problem.
-		// std::cout << entering << "\n";
-		if(entering == n_var) {
+		if(entering == n) {
 			if(phase_one) {
 				phase_one = false;
 				// Check objective - if 0, we are OK
-				if(less_than(eT(0), accu(sol.tail(n_con)))) {
+				eT aux_sum(0);
+				for(uint i = 0; i < m; i++)
+					if(basic[i] >= n)
+						aux_sum += xB[i];
+
+				if(less_than(eT(0), aux_sum)) {
 					// If any auxiliary still nonzero, we couldn't find a feasible
 					// basis without auxiliaries.
 					status = Status::INFEASIBLE;
@@ -811,37 +2420,26 @@ bool LinearProgram<eT>::simplex() {
 				// IMPORTANT: this fixes a bug in RationalSimplex.jl
 				// if an artificial variable is still left in the basis (with 0 value) we need to drive it out
 				// before starting Phase 2. Otherwise the artificial variable might become > 0 in the future!
-				uvec keep = ones<uvec>(n_con);
-
-				for(uint i = 0; i < n_con; i++) {
-					if(basic(i) < n_var) continue; // non-artificial
-
-					// Rule: check for non-zero elements in the i-th row of Binv*A
-					Row<eT> t = Binv.row(i) * A;
-					for(entering = 0; entering < n_var; entering++)
-						if(!is_basic(entering) && !equal(t(entering), eT(0)))
+				// If the row of B^-1 A is all zero the constraint is redundant; the auxiliary then stays in the
+				// basis at 0, and the ratio test below makes it leave as soon as it would change.
+				for(uint p = 0; p < m; p++) {
+					if(basic[p] < n) continue; // non-artificial
+
+					auto rho = row(p);
+					for(uint j = 0; j < n; j++) {
+						if(!is_basic[j] && !equal(dot_col(rho, j), eT(0))) {
+							// found non-zero element, pivot on that (degenerate, x_j keeps its value)
+							if(!pivot(p, j, column(j), eT(0), false)) {
+								status = Status::ERROR;
+								return false;
+							}
 							break;
-
-					if(entering == n_var) {
-						// all elements are zero so constraint i is redundant, mark to delete
-						keep(i) = 0;
-					} else {
-						// found non-zero element (entering), pivot on that
-						BinvAs = Binv * A.col(entering);
-						pivot(i, entering);
+						}
 					}
 				}
 
-				// remove marked constraints
-				auto keep_i = arma::find(keep);
-				if(size(keep_i).n_rows != n_con) {
-					A = A.rows(keep_i);
-					Binv = Binv.submat(keep_i, keep_i);
-					basic = basic(keep_i);
-					n_con = A.n_rows;
-				}
-
-				cB = c(basic).t();
+				n_degenerate = 0;
+				std::fill(weight.begin(), weight.end(), 1.0);
 				continue; // start phase 2
 
 			} else {
@@ -849,37 +2447,391 @@ bool LinearProgram<eT>::simplex() {
 				break;
 			}
 		}
+		if(interrupted(stats.iterations)) {
+			status = Status::INTERRUPTED;
+			stopped = true;
+			break;
+		}
 
 		// Calculate how the solution will change when our new
-		// variable enters the basis and increases from 0
-		BinvAs = Binv * A.col(entering);
+		// variable moves away from its bound (dir = +1 increasing from 0, -1 decreasing from u)
+		auto alpha = column(entering);
+		const eT dir = at_upper[entering] ? eT(-1) : eT(1);
 
 		// Perform a "ratio test" on each variable to determine
-		// which will reach 0 first
-		uint leaving = n_con;
+		// which will reach a bound first (0 if x_i decreases, u_i if
+		// it increases). Ties are broken by the smallest
+		// index (Bland) or the largest pivot (Devex, more stable).
+		uint leaving = m;
+		bool leave_upper = false;
 		eT min_ratio(0);
-		for(uint j = 0; j < n_con; j++) {
-			if(less_than(eT(0), BinvAs(j))) {
-				eT ratio = sol(basic(j)) / BinvAs(j);
-				if(less_than(ratio, min_ratio) || leaving == n_con) {
-					min_ratio = ratio;
-					leaving = j;
-				}
+		for(uint i = 0; i < m; i++) {
+			eT ratio, rate = dir * alpha[i];		// x_i decreases by rate per unit of movement
+			bool up = false;
+			if(!phase_one && basic[i] >= n && !equal(alpha[i], eT(0)))
+				ratio = eT(0);		// auxiliary of a redundant constraint, must leave (at 0) before it changes
+			else if(less_than(eT(0), rate))
+				ratio = xB[i] / rate;
+			else if(less_than(rate, eT(0)) && upper[basic[i]] != inf) {
+				ratio = (upper[basic[i]] - xB[i]) / -rate;
+				up = true;
+			} else
+				continue;
+
+			bool better = leaving == m || less_than(ratio, min_ratio);
+			if(!better && equal(ratio, min_ratio))
+				better = bland ? basic[i] < basic[leaving] : abs(alpha[leaving]) < abs(alpha[i]);
+			if(better) {
+				min_ratio = ratio;
+				leaving = i;
+				leave_upper = up;
 			}
 		}
 
+		// the entering variable reaches its other bound first
+		if(upper[entering] != inf && (leaving == m || !less_than(min_ratio, upper[entering]))) {
+			stats.iterations++;
+			flip(entering, alpha);
+			continue;
+		}
+
 		// If no variable will leave basis, then we have an 
 		// unbounded problem.
-		if(leaving == n_con) {
+		if(leaving == m) {
 			status = Status::UNBOUNDED;
 			break;
 		}
 
+		// Devex reference weights: w_j = max(w_j, (alpha_pj / alpha_pq)^2 w_q), where alpha_p. is the leaving row of B^-1 A
+		if(devex) {
+			auto rho = row(leaving);
+			std::vector<double> rho_d(m);
+			for(uint i = 0; i < m; i++)
+				rho_d[i] = to_double(rho[i]);
+
+			double w_q = weight[entering],
+				   a_pq = to_double(alpha[leaving]);
+			for(uint j = 0; j < n; j++) {
+				if(is_basic[j] || j == entering) continue;
+
+				double a_pj = 0;
+				for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+					a_pj += rho_d[A.row_ind[k]] * A_d[k];
+				a_pj /= a_pq;
+				weight[j] = std::max(weight[j], a_pj * a_pj * w_q);
+			}
+			if(basic[leaving] < n)
+				weight[basic[leaving]] = std::max(w_q / (a_pq * a_pq), 1.0);
+		}
+
 		// ready to pivot
-		pivot(leaving, entering);
+		stats.iterations++;
+		n_degenerate = equal(min_ratio, eT(0)) ? n_degenerate + 1 : 0;
+		if(!pivot(leaving, entering, alpha, dir * min_ratio, leave_upper)) {
+			status = Status::ERROR;		// numerically singular basis
+			break;
+		}
+	}
+
+	// the solution: basic values, and the bounds of the non-basic variables at their upper bound. When interrupted,
+	// the basic solution of the primal phase 2 is feasible (not optimal), there is no feasible one otherwise.
+	if(status != Status::OPTIMAL && !(stopped && !dual && !phase_one))
+		return false;
+
+	sol = arma::zeros<Col<eT>>(n);
+	for(uint j = 0; j < n; j++)
+		if(!is_basic[j] && at_upper[j])
+			sol(j) = upper[j];
+	for(uint i = 0; i < m; i++)
+		if(basic[i] < n)
+			sol(basic[i]) = xB[i];
+
+	// the optimal basis, of this (canonical) program. An auxiliary left in the basis (at 0, the constraint is
+	// redundant) makes its constraint basic, otherwise the constraints are active (see basis_from_canonical).
+	if(status == Status::OPTIMAL) {
+		var_basis.resize(n);
+		con_basis.resize(m);
+		for(uint j = 0; j < n; j++)
+			var_basis[j] = is_basic[j] ? BasisStatus::BASIC : at_upper[j] ? BasisStatus::AT_UPPER : BasisStatus::AT_LOWER;
+		for(uint i = 0; i < m; i++)
+			con_basis[i] = is_basic[n + i] ? BasisStatus::BASIC : BasisStatus::AT_LOWER;
+	}
+
+	return status == Status::OPTIMAL;
+}
+
+
+// Interior point method (Method::INTERIOR with the internal solver, floating types only)
+// Solves the program in canonical form (see simplex) with Mehrotra's predictor-corrector primal-dual method.
+// With slacks s = u - x for the variables having an upper bound, the primal/dual pair is
+//   A x = b,  x + s = u,  x, s >= 0          A^T y + z - w = c,  z, w >= 0
+// and each iteration solves the normal equations  A Theta A^T dy = r,  Theta = (Z/X + W/S)^-1,  with a sparse
+// Cholesky factorization (see SparseCholesky). The ordering and the structure of the factor are computed once, so
+// an iteration costs a numeric factorization and two solves. Variables fixed at 0 are left out. Everything is
+// computed in double.
+//
+// The result is an interior point of the optimal face, not a vertex, internal_solver() then crosses over to a basic
+// solution. There is no infeasibility certificate: diverging or stalling iterates are reported as
+// INFEASIBLE_OR_UNBOUNDED.
+//
+template<typename eT>
+bool LinearProgram<eT>::interior() {
+	const uint m = n_con,
+			   n = n_var;
+	const uint max_iter = 200;
+	const double tol = 1e-8,				// relative residuals and duality gap at an optimal solution
+				 tol_accept = 1e-6,			// accepted if the iterations stop making progress
+				 eta = 0.99,				// fraction of the maximum step to the boundary
+				 diverged = 1e12,
+				 inf = std::numeric_limits<double>::infinity();
+
+	assert(!maximize);
+
+	auto& A = con_coeff;
+	A.compress(n);
+
+	std::vector<double> b(m), c(n), u(n), a_val(A.values.size());
+	std::vector<char> active(n), has_u(n);
+	for(uint i = 0; i < m; i++)
+		b[i] = to_double(con_lb[i]);
+	for(uint j = 0; j < n; j++) {
+		c[j] = to_double(obj_coeff[j]);
+		u[j] = var_ub[j] == infinity<eT>() ? inf : to_double(var_ub[j]);
+		active[j] = u[j] > 0;
+		has_u[j] = active[j] && u[j] != inf;
+	}
+	for(uint k = 0; k < a_val.size(); k++)
+		a_val[k] = to_double(A.values[k]);
+
+	// rows of A (CSR), for forming the columns of the normal matrix
+	std::vector<uint> row_ptr(m + 1, 0), row_col(a_val.size());
+	std::vector<double> row_val(a_val.size());
+	for(uint k = 0; k < a_val.size(); k++)
+		row_ptr[A.row_ind[k] + 1]++;
+	for(uint i = 0; i < m; i++)
+		row_ptr[i + 1] += row_ptr[i];
+	{
+		std::vector<uint> next(row_ptr.begin(), row_ptr.end() - 1);
+		for(uint j = 0; j < n; j++)
+			for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++) {
+				uint p = next[A.row_ind[k]]++;
+				row_col[p] = j;
+				row_val[p] = a_val[k];
+			}
+	}
+
+	auto mult = [&](const std::vector<double>& v) {		// A v
+		std::vector<double> res(m, 0.0);
+		for(uint j = 0; j < n; j++)
+			if(active[j] && v[j] != 0)
+				for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+					res[A.row_ind[k]] += a_val[k] * v[j];
+		return res;
+	};
+	auto mult_t = [&](const std::vector<double>& y) {	// A^T y
+		std::vector<double> res(n, 0.0);
+		for(uint j = 0; j < n; j++)
+			if(active[j])
+				for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+					res[j] += a_val[k] * y[A.row_ind[k]];
+		return res;
+	};
+	auto norm = [](const std::vector<double>& v) {
+		double res = 0;
+		for(double e : v)
+			res = std::max(res, std::abs(e));
+		return res;
+	};
+
+	// structure of A A^T: rows sharing a column
+	SparseCholesky chol;
+	{
+		std::vector<std::vector<uint>> pattern(m);
+		for(uint j = 0; j < n; j++)
+			if(active[j])
+				for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+					for(uint l = k + 1; l < A.col_ptr[j+1]; l++)
+						pattern[A.row_ind[k]].push_back(A.row_ind[l]);
+		chol.analyze(m, pattern);
+	}
+
+	// starting point, well inside the bounds
+	std::vector<double> x(n, 0.0), s(n, 0.0), z(n, 0.0), w(n, 0.0), y(m, 0.0);
+	uint n_comp = 0;
+	const double c_scale = std::max(1.0, norm(c));
+	for(uint j = 0; j < n; j++) {
+		if(!active[j]) continue;
+		x[j] = has_u[j] ? std::min(1.0, u[j] / 2) : 1.0;
+		z[j] = c_scale;
+		n_comp++;
+		if(has_u[j]) {
+			s[j] = u[j] - x[j];
+			w[j] = c_scale;
+			n_comp++;
+		}
+	}
+
+	const double b_norm = norm(b);
+	std::vector<double> theta(n, 0.0), rb, rc, ru(n, 0.0);
+
+	// Newton direction for the complementarity targets x z = rxz, s w = rsw (given as the residuals rxz - x z)
+	auto direction = [&](const std::vector<double>& rxz, const std::vector<double>& rsw,
+						 std::vector<double>& dx, std::vector<double>& dy, std::vector<double>& dz, std::vector<double>& ds, std::vector<double>& dw) {
+		std::vector<double> rho(n, 0.0), t(n, 0.0);
+		for(uint j = 0; j < n; j++) {
+			if(!active[j]) continue;
+			rho[j] = rc[j] - rxz[j] / x[j];
+			if(has_u[j])
+				rho[j] += (rsw[j] - w[j] * ru[j]) / s[j];
+			t[j] = theta[j] * rho[j];
+		}
+		dy = mult(t);
+		for(uint i = 0; i < m; i++)
+			dy[i] += rb[i];
+		chol.solve(dy);
+
+		std::vector<double> aty = mult_t(dy);
+		dx.assign(n, 0.0); dz.assign(n, 0.0); ds.assign(n, 0.0); dw.assign(n, 0.0);
+		for(uint j = 0; j < n; j++) {
+			if(!active[j]) continue;
+			dx[j] = theta[j] * (aty[j] - rho[j]);
+			dz[j] = (rxz[j] - z[j] * dx[j]) / x[j];
+			if(has_u[j]) {
+				ds[j] = ru[j] - dx[j];
+				dw[j] = (rsw[j] - w[j] * ds[j]) / s[j];
+			}
+		}
+	};
+	// largest step in [0, 1] keeping v + alpha dv >= 0
+	auto max_step = [&](const std::vector<double>& v, const std::vector<double>& dv, const std::vector<double>& v2, const std::vector<double>& dv2) {
+		double alpha = 1;
+		for(uint j = 0; j < n; j++) {
+			if(!active[j]) continue;
+			if(dv[j] < 0)
+				alpha = std::min(alpha, -v[j] / dv[j]);
+			if(has_u[j] && dv2[j] < 0)
+				alpha = std::min(alpha, -v2[j] / dv2[j]);
+		}
+		return alpha;
+	};
+
+	std::vector<double> dx, dy, dz, ds, dw, rxz(n, 0.0), rsw(n, 0.0);
+	status = Status::INFEASIBLE_OR_UNBOUNDED;
+	stats.iterations = 0;
+
+	// the iterate with the smallest error, in case the residuals stop decreasing (eg. ill-conditioned normal equations
+	// close to the optimum)
+	std::vector<double> best_x;
+	double best_err = inf;
+	uint best_iter = 0;
+
+	for(uint iter = 0; ; iter++) {
+		// residuals
+		rb = mult(x);
+		for(uint i = 0; i < m; i++)
+			rb[i] = b[i] - rb[i];
+		rc = mult_t(y);
+		double mu = 0, p_obj = 0, d_obj = 0;
+		for(uint i = 0; i < m; i++)
+			d_obj += b[i] * y[i];
+		for(uint j = 0; j < n; j++) {
+			if(!active[j]) { rc[j] = 0; continue; }
+			rc[j] = c[j] - rc[j] - z[j] + w[j];
+			mu += x[j] * z[j];
+			p_obj += c[j] * x[j];
+			if(has_u[j]) {
+				ru[j] = u[j] - x[j] - s[j];
+				mu += s[j] * w[j];
+				d_obj -= u[j] * w[j];
+			}
+		}
+		mu = n_comp > 0 ? mu / n_comp : 0;
+
+		double err = std::max({
+			norm(rb) / (1 + b_norm),
+			norm(ru) / (1 + b_norm),
+			norm(rc) / c_scale,
+			std::abs(p_obj - d_obj) / (1 + std::abs(p_obj)),
+		});
+		if(err < best_err) {
+			best_x = x;
+			best_err = err;
+			best_iter = iter;
+		}
+		if(err <= tol)
+			break;
+		if(interrupted(stats.iterations)) {
+			status = Status::INTERRUPTED;		// the iterates are not feasible, no solution
+			return false;
+		}
+		if(iter == max_iter || (best_err <= tol_accept && iter > best_iter + 10) || !std::isfinite(mu) || norm(x) > diverged * (1 + b_norm) || norm(y) > diverged * c_scale)
+			break;
+
+		stats.iterations++;
+
+		for(uint j = 0; j < n; j++)
+			if(active[j])
+				theta[j] = 1 / (z[j] / x[j] + (has_u[j] ? w[j] / s[j] : 0));
+		chol.factorize([&](uint i, std::vector<std::pair<uint,double>>& out) {
+			for(uint p = row_ptr[i]; p < row_ptr[i+1]; p++) {
+				uint j = row_col[p];
+				if(!active[j]) continue;
+				double f = row_val[p] * theta[j];
+				for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+					out.push_back({ A.row_ind[k], f * a_val[k] });
+			}
+		});
+
+		// predictor (affine scaling direction)
+		for(uint j = 0; j < n; j++) {
+			rxz[j] = -x[j] * z[j];
+			rsw[j] = -s[j] * w[j];
+		}
+		direction(rxz, rsw, dx, dy, dz, ds, dw);
+		double alpha_p = max_step(x, dx, s, ds),
+			   alpha_d = max_step(z, dz, w, dw);
+
+		double mu_aff = 0;
+		for(uint j = 0; j < n; j++)
+			if(active[j])
+				mu_aff += (x[j] + alpha_p * dx[j]) * (z[j] + alpha_d * dz[j]) +
+						  (has_u[j] ? (s[j] + alpha_p * ds[j]) * (w[j] + alpha_d * dw[j]) : 0);
+		mu_aff /= n_comp;
+		double sigma = std::pow(mu_aff / mu, 3);
+
+		// corrector, towards the central path with the second order term of the predictor
+		for(uint j = 0; j < n; j++) {
+			rxz[j] = sigma * mu - x[j] * z[j] - dx[j] * dz[j];
+			rsw[j] = sigma * mu - s[j] * w[j] - ds[j] * dw[j];
+		}
+		direction(rxz, rsw, dx, dy, dz, ds, dw);
+		alpha_p = std::min(1.0, eta * max_step(x, dx, s, ds));
+		alpha_d = std::min(1.0, eta * max_step(z, dz, w, dw));
+
+		if(alpha_p < 1e-12 && alpha_d < 1e-12)
+			break;		// stalled
+
+		for(uint j = 0; j < n; j++) {
+			x[j] += alpha_p * dx[j];
+			s[j] += alpha_p * ds[j];
+			z[j] += alpha_d * dz[j];
+			w[j] += alpha_d * dw[j];
+		}
+		for(uint i = 0; i < m; i++)
+			y[i] += alpha_d * dy[i];
+	}
+
+	if(best_err <= tol_accept) {
+		status = Status::OPTIMAL;
+		x = best_x;
+	} else {
+		return false;
 	}
 
-	sol = sol.head(n_var);		// the solution are the first n vars
+	sol = arma::zeros<Col<eT>>(n);
+	for(uint j = 0; j < n; j++)
+		if(active[j])
+			sol(j) = eT(std::max(0.0, has_u[j] ? std::min(u[j], x[j]) : x[j]));
 
 	return status == Status::OPTIMAL;
 }
@@ -895,70 +2847,772 @@ void LinearProgram<eT>::dump() {
 		<< "obj_coeff: " << Row<eT>(obj_coeff)
 		<< "con_coeff:\n";
 
-	for(auto me : con_coeff)
-		std::cout << "\t" << me.row << ", " << me.row << ", " << me.val << "\n";
+	con_coeff.compress(n_var);
+	con_coeff.for_each([](uint row, uint col, eT& val) {
+		std::cerr << "\t" << row << ", " << col << ", " << val << "\n";
+	});
+
+	std::cerr << "\n";
+}
+
+
+namespace mps_aux {
+
+// number in an MPS/solution file. Values of magnitude >= 1e30 (the usual MPS convention), or inf, are infinite.
+// Decimals are parsed exactly for rat.
+template<typename eT>
+eT parse_number(const string& s) {
+	const double d = std::stod(s);		// throws on garbage
+	if(std::abs(d) >= 1e30)
+		return d > 0 ? infinity<eT>() : -infinity<eT>();
+
+	if constexpr (std::is_same<eT, rat>::value) {
+		// [sign] int [. frac] [e exp] as digits / 10^k
+		size_t p = 0;
+		string sign;
+		if(p < s.size() && (s[p] == '-' || s[p] == '+'))
+			sign = s[p++] == '-' ? "-" : "";
+		string digits;
+		int exp10 = 0;
+		for(; p < s.size() && std::isdigit((unsigned char)s[p]); p++)
+			digits += s[p];
+		if(p < s.size() && s[p] == '.')
+			for(p++; p < s.size() && std::isdigit((unsigned char)s[p]); p++, exp10--)
+				digits += s[p];
+		if(p < s.size() && (s[p] == 'e' || s[p] == 'E')) {
+			size_t used;
+			exp10 += std::stoi(s.substr(p + 1), &used);
+			p += 1 + used;
+		}
+		if(p != s.size() || digits.empty())
+			return rat(d);				// not a plain decimal (eg. hex), use the double
+		digits.erase(0, std::min(digits.find_first_not_of('0'), digits.size() - 1));
+
+		return exp10 >= 0
+			? rat(sign + digits + string(exp10, '0'))
+			: rat(sign + digits + "/1" + string(-exp10, '0'));
+	} else {
+		return eT(d);
+	}
+}
+
+// index of variable "X<j+1>" as written by write_mps, or -1
+inline int64_t var_index(const string& name, uint n_var) {
+	if(name.size() < 2 || name[0] != 'X' || name.size() > 11)
+		return -1;
+	uint64_t j = 0;
+	for(size_t i = 1; i < name.size(); i++) {
+		if(!std::isdigit((unsigned char)name[i]))
+			return -1;
+		j = 10 * j + (name[i] - '0');
+	}
+	return j >= 1 && j <= n_var ? int64_t(j - 1) : -1;
+}
+
+inline std::vector<string> tokens(const string& line) {
+	std::istringstream ls(line);
+	std::vector<string> res;
+	for(string t; ls >> t; )
+		res.push_back(t);
+	return res;
+}
+
+} // namespace mps_aux
+
+// MPS, with rows typed by their bounds: E (lb == ub), L (finite ub, with a range if lb is also finite), G (lb only),
+// N (free). Zero coefficients, RHS and lower bounds are omitted.
+//
+template<typename eT>
+void LinearProgram<eT>::write_mps(std::ostream& out) {
+	QIF_TRACE_SPAN("lp::write_mps");
+	const eT inf = infinity<eT>();
+	con_coeff.compress(n_var);
+	const auto& A = con_coeff;
+
+	auto row_type = [&](uint i) {
+		const bool has_lb = con_lb[i] != -inf, has_ub = con_ub[i] != inf;
+		return has_lb && has_ub && con_lb[i] == con_ub[i] ? 'E' : has_ub ? 'L' : has_lb ? 'G' : 'N';
+	};
+
+	const std::ios::fmtflags flags = out.flags();
+	const std::streamsize precision = out.precision(17);
+
+	out << "NAME PROG\n";
+	if(maximize)
+		out << "OBJSENSE\n    MAX\n";
+
+	out << "ROWS\n N OBJ\n";
+	for(uint i = 0; i < n_con; i++)
+		out << " " << row_type(i) << " R" << i+1 << "\n";
+
+	out << "COLUMNS\n";
+	for(uint j = 0; j < n_var; j++) {
+		bool written = false;
+		if(obj_coeff[j] != eT(0)) {
+			out << " X" << j+1 << " OBJ " << to_double(obj_coeff[j]) << "\n";
+			written = true;
+		}
+		for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+			if(A.values[k] != eT(0)) {
+				out << " X" << j+1 << " R" << A.row_ind[k]+1 << " " << to_double(A.values[k]) << "\n";
+				written = true;
+			}
+		if(!written)
+			out << " X" << j+1 << " OBJ 0\n";		// variables only exist if they appear in COLUMNS
+	}
+
+	out << "RHS\n";
+	for(uint i = 0; i < n_con; i++) {
+		const char t = row_type(i);
+		const eT& rhs = t == 'L' ? con_ub[i] : con_lb[i];
+		if(t != 'N' && rhs != eT(0))
+			out << " RHS R" << i+1 << " " << to_double(rhs) << "\n";
+	}
+
+	out << "RANGES\n";
+	for(uint i = 0; i < n_con; i++)
+		if(row_type(i) == 'L' && con_lb[i] != -inf)
+			out << " RNG R" << i+1 << " " << to_double(con_ub[i] - con_lb[i]) << "\n";
+
+	out << "BOUNDS\n";
+	for(uint j = 0; j < n_var; j++) {
+		const eT& lb = var_lb[j];
+		const eT& ub = var_ub[j];
+
+		if(lb == -inf && ub == inf)
+			out << " FR BND X" << j+1 << "\n";
+		else if(lb == ub)
+			out << " FX BND X" << j+1 << " " << to_double(lb) << "\n";
+		else {
+			if(lb == -inf)
+				out << " MI BND X" << j+1 << "\n";
+			else if(lb != eT(0) || ub < eT(0))		// some readers take a negative UP without LO as lb = -inf
+				out << " LO BND X" << j+1 << " " << to_double(lb) << "\n";
+			if(ub != inf)
+				out << " UP BND X" << j+1 << " " << to_double(ub) << "\n";
+		}
+	}
+	out << "ENDATA\n";
 
-	std::cout  << "\n";
+	out.flags(flags);
+	out.precision(precision);
+	if(!out)
+		throw std::runtime_error("error writing MPS");
 }
 
+template<typename eT>
+void LinearProgram<eT>::write_mps(const string& filename) {
+	std::ofstream out(filename);
+	if(!out)
+		throw std::runtime_error("cannot open " + filename);
+	write_mps(out);
+}
 
 template<typename eT>
 string LinearProgram<eT>::to_mps() {
-	throw std::runtime_error("not implemented");
-
-	// using std::to_string;
-
-	// string s;
-	// s = "NAME PROG\n";
-
-	// // rows
-	// s += "ROWS\n";
-	// s += " N  OBJ\n";	// objective function
-	// for(uint i = 0; i < n_con; i++) {
-	// 	char sense_i = sense.n_rows > i ? sense.at(i) : '<';	// default sense is <
-	// 	string s_sense = sense_i == '<' ? "L" :
-	// 					 sense_i == '>' ? "G" :
-	// 						 			  "E";
-	// 	s += " " + s_sense + " ROW" + to_string(i+1) + "\n";
-	// }
-
-	// // columns
-	// s += "COLUMNS\n";
-	// for(uint j = 0; j < n_var; j++) {
-	// 	s += " X" + to_string(j+1) + " OBJ " + to_string(obj_coeff[j]) + "\n";
-
-	// 	for(uint i = 0; i < n_var; i++)
-	// 		s += " X" + to_string(j+1) + " ROW" + to_string(i+1) + " " + to_string(A.at(i, j)) + "\n";
-	// }
-
-	// // RHS
-	// s += "RHS\n";
-	// for(uint i = 0; i < n_con; i++) {
-	// 	s += " RHS ROW" + to_string(i+1) + " " + to_string(con_ub[i]) + "\n";
-	// }
-
-	// // BOUNDS
-	// eT inf = infinity<eT>();
-	// s += "\nBOUNDS\n";
-	// for(uint j = 0; j < n_var; j++) {
-	// 	eT lb = var_lb[j];
-	// 	eT ub = var_ub[j];
-
-	// 	if(lb == -inf && ub == inf)
-	// 		s += " FR BND X" + to_string(j+1) + "\n";
-	// 	else(lb == ub)
-	// 		s += " FX BND X" + to_string(j+1) + " " + to_string(lb) + "\n";
-	// 	else {
-	// 		if(ub != inf)
-	// 			s += " UP BND X" + to_string(j+1) + " " + to_string(ub) + "\n";
-	// 		else(lb != -inf)
-	// 			s += " LO BND X" + to_string(j+1) + " " + to_string(lb) + "\n";
-	// 	}
-	// }
-
-	// s += "ENDATA\n";
-
-	// return s;
+	std::ostringstream out;
+	write_mps(out);
+	return out.str();
+}
+
+// CPLEX LP format. It has no ranges, a constraint with both bounds is written as two rows R<i> (>= lb) and R<i>_ub
+// (<= ub). Free constraints are omitted.
+//
+template<typename eT>
+void LinearProgram<eT>::write_lp(std::ostream& out) {
+	QIF_TRACE_SPAN("lp::write_lp");
+	const eT inf = infinity<eT>();
+	con_coeff.compress(n_var);
+	const auto& A = con_coeff;
+
+	const std::ios::fmtflags flags = out.flags();
+	const std::streamsize precision = out.precision(17);
+
+	// "+ c X<j>" terms, a few per line (readers limit the line length)
+	uint n_terms;
+	auto term = [&](const eT& c, uint j) {
+		if(n_terms > 0 && n_terms % 8 == 0)
+			out << "\n   ";
+		out << (c < eT(0) ? " - " : " + ") << to_double(c < eT(0) ? eT(-c) : c) << " X" << j+1;
+		n_terms++;
+	};
+
+	out << (maximize ? "Maximize\n" : "Minimize\n") << " obj:";
+	n_terms = 0;
+	for(uint j = 0; j < n_var; j++)
+		if(obj_coeff[j] != eT(0))
+			term(obj_coeff[j], j);
+	if(n_terms == 0 && n_var > 0)
+		out << " 0 X1";
+	out << "\n";
+
+	// rows of A (CSR), the writer needs them in row order
+	std::vector<uint> row_ptr(n_con + 1, 0), row_col;
+	for(uint k = 0; k < A.values.size(); k++)
+		if(A.values[k] != eT(0))
+			row_ptr[A.row_ind[k] + 1]++;
+	for(uint i = 0; i < n_con; i++)
+		row_ptr[i + 1] += row_ptr[i];
+	std::vector<uint> row_pos(row_ptr[n_con]);			// position in A.values of the p-th entry of the rows
+	row_col.resize(row_ptr[n_con]);
+	{
+		std::vector<uint> next(row_ptr.begin(), row_ptr.end() - 1);
+		for(uint j = 0; j < n_var; j++)
+			for(uint k = A.col_ptr[j]; k < A.col_ptr[j+1]; k++)
+				if(A.values[k] != eT(0)) {
+					uint p = next[A.row_ind[k]]++;
+					row_col[p] = j;
+					row_pos[p] = k;
+				}
+	}
+
+	auto write_row = [&](uint i, const string& name, const char* op, const eT& rhs) {
+		out << " " << name << ":";
+		n_terms = 0;
+		for(uint p = row_ptr[i]; p < row_ptr[i+1]; p++)
+			term(A.values[row_pos[p]], row_col[p]);
+		if(n_terms == 0)
+			out << " 0 X1";
+		out << " " << op << " " << to_double(rhs) << "\n";
+	};
+
+	out << "Subject To\n";
+	for(uint i = 0; i < n_con; i++) {
+		const string name = "R" + std::to_string(i+1);
+		const bool has_lb = con_lb[i] != -inf, has_ub = con_ub[i] != inf;
+		if(has_lb && has_ub && con_lb[i] == con_ub[i])
+			write_row(i, name, "=", con_lb[i]);
+		else {
+			if(has_lb)
+				write_row(i, name, ">=", con_lb[i]);
+			if(has_ub)
+				write_row(i, has_lb ? name + "_ub" : name, "<=", con_ub[i]);
+		}
+	}
+
+	out << "Bounds\n";
+	for(uint j = 0; j < n_var; j++) {
+		const eT& lb = var_lb[j];
+		const eT& ub = var_ub[j];
+
+		if(lb == -inf && ub == inf)
+			out << " X" << j+1 << " free\n";
+		else if(lb == ub)
+			out << " X" << j+1 << " = " << to_double(lb) << "\n";
+		else if(lb == -inf)
+			out << " -inf <= X" << j+1 << " <= " << to_double(ub) << "\n";
+		else if(ub == inf) {
+			if(lb != eT(0))
+				out << " X" << j+1 << " >= " << to_double(lb) << "\n";
+		} else
+			out << " " << to_double(lb) << " <= X" << j+1 << " <= " << to_double(ub) << "\n";
+	}
+	out << "End\n";
+
+	out.flags(flags);
+	out.precision(precision);
+	if(!out)
+		throw std::runtime_error("error writing LP");
+}
+
+template<typename eT>
+void LinearProgram<eT>::write_lp(const string& filename) {
+	std::ofstream out(filename);
+	if(!out)
+		throw std::runtime_error("cannot open " + filename);
+	write_lp(out);
+}
+
+template<typename eT>
+void LinearProgram<eT>::read_mps(std::istream& in) {
+	QIF_TRACE_SPAN("lp::read_mps");
+	const eT inf = infinity<eT>();
+
+	clear();
+	maximize = false;			// the MPS default
+
+	std::unordered_map<string, uint> rows, cols;
+	string obj_row, section, line;
+	std::vector<char> row_type, has_range, lb_set;
+	std::vector<eT> rhs, range;
+
+	auto row = [&](const string& name) -> uint {
+		auto it = rows.find(name);
+		if(it == rows.end())
+			throw std::runtime_error("MPS: unknown row " + name);
+		return it->second;
+	};
+	auto col = [&](const string& name) -> uint {
+		auto it = cols.find(name);
+		if(it == cols.end())
+			throw std::runtime_error("MPS: unknown column " + name);
+		return it->second;
+	};
+	// "[set] name value [name value]" lines of RHS and RANGES, calls f(row, value) for rows other than the objective
+	auto for_each_pair = [&](const std::vector<string>& tok, auto f) {
+		for(size_t k = tok.size() % 2; k + 1 < tok.size(); k += 2)
+			if(tok[k] != obj_row)
+				f(row(tok[k]), mps_aux::parse_number<eT>(tok[k+1]));
+	};
+
+	while(std::getline(in, line)) {
+		if(!line.empty() && line.back() == '\r')
+			line.pop_back();
+		auto tok = mps_aux::tokens(line);
+		if(tok.empty() || tok[0][0] == '*')
+			continue;
+
+		if(!std::isspace((unsigned char)line[0])) {			// section header
+			section = tok[0];
+			if(section == "ENDATA")
+				break;
+			else if(section == "OBJSENSE" && tok.size() > 1)
+				maximize = tok[1].rfind("MAX", 0) == 0;
+			else if(section != "NAME" && section != "OBJSENSE" && section != "ROWS" && section != "COLUMNS" &&
+					section != "RHS" && section != "RANGES" && section != "BOUNDS")
+				throw std::runtime_error("MPS: unsupported section " + section);
+			continue;
+		}
+
+		if(section == "OBJSENSE") {
+			maximize = tok[0].rfind("MAX", 0) == 0;
+
+		} else if(section == "ROWS") {
+			if(tok.size() != 2)
+				throw std::runtime_error("MPS: invalid row: " + line);
+			const char t = tok[0][0];
+			if(t == 'N' && obj_row.empty()) {
+				obj_row = tok[1];
+			} else if(t == 'N' || t == 'L' || t == 'G' || t == 'E') {
+				rows[tok[1]] = make_con(-inf, inf);
+				row_type.push_back(t);
+				rhs.push_back(eT(0));
+				range.push_back(eT(0));
+				has_range.push_back(0);
+			} else {
+				throw std::runtime_error("MPS: invalid row type: " + line);
+			}
+
+		} else if(section == "COLUMNS") {
+			if(tok.size() > 1 && tok[1] == "'MARKER'")
+				throw std::runtime_error("MPS: integer variables are not supported");
+			if(tok.size() != 3 && tok.size() != 5)
+				throw std::runtime_error("MPS: invalid column: " + line);
+
+			auto it = cols.find(tok[0]);
+			const uint var = it != cols.end() ? it->second : (cols[tok[0]] = make_var(eT(0), inf));
+			if(it == cols.end())
+				lb_set.push_back(0);
+
+			for(size_t k = 1; k + 1 < tok.size(); k += 2) {
+				const eT v = mps_aux::parse_number<eT>(tok[k+1]);
+				if(tok[k] == obj_row)
+					set_obj_coeff(var, v);
+				else
+					set_con_coeff(row(tok[k]), var, v);
+			}
+
+		} else if(section == "RHS") {
+			for_each_pair(tok, [&](uint i, const eT& v) { rhs[i] = v; });
+
+		} else if(section == "RANGES") {
+			for_each_pair(tok, [&](uint i, const eT& v) { range[i] = v; has_range[i] = 1; });
+
+		} else if(section == "BOUNDS") {
+			const string& t = tok[0];
+			if(t == "BV" || t == "LI" || t == "UI" || t == "SC")
+				throw std::runtime_error("MPS: integer variables are not supported");
+			const bool with_value = t == "UP" || t == "LO" || t == "FX";
+			const size_t n = with_value ? 4 : 3;			// with the (optional) bound set name
+			if(tok.size() != n && tok.size() != n - 1)
+				throw std::runtime_error("MPS: invalid bound: " + line);
+
+			const uint j = col(tok[tok.size() == n ? 2 : 1]);
+			const eT v = with_value ? mps_aux::parse_number<eT>(tok.back()) : eT(0);
+			if(t == "UP") {
+				var_ub[j] = v;
+				if(v < eT(0) && !lb_set[j] && var_lb[j] == eT(0))
+					var_lb[j] = -inf;
+			} else if(t == "LO") {
+				var_lb[j] = v;
+				lb_set[j] = 1;
+			} else if(t == "FX") {
+				var_lb[j] = var_ub[j] = v;
+			} else if(t == "FR") {
+				var_lb[j] = -inf;
+				var_ub[j] = inf;
+			} else if(t == "MI") {
+				var_lb[j] = -inf;
+			} else if(t == "PL") {
+				var_ub[j] = inf;
+			} else {
+				throw std::runtime_error("MPS: invalid bound type: " + line);
+			}
+
+		} else {
+			throw std::runtime_error("MPS: data outside of a section: " + line);
+		}
+	}
+
+	for(uint i = 0; i < n_con; i++) {
+		const eT r = range[i] < eT(0) ? eT(-range[i]) : range[i];
+		switch(row_type[i]) {
+			case 'L': con_lb[i] = has_range[i] ? eT(rhs[i] - r) : -inf;	con_ub[i] = rhs[i];								break;
+			case 'G': con_lb[i] = rhs[i];								con_ub[i] = has_range[i] ? eT(rhs[i] + r) : inf;	break;
+			case 'E':
+				con_lb[i] = has_range[i] && range[i] < eT(0) ? eT(rhs[i] - r) : rhs[i];
+				con_ub[i] = has_range[i] && range[i] > eT(0) ? eT(rhs[i] + r) : rhs[i];
+				break;
+			default: break;			// N: free
+		}
+	}
+}
+
+template<typename eT>
+void LinearProgram<eT>::read_mps(const string& filename) {
+	std::ifstream in(filename);
+	if(!in)
+		throw std::runtime_error("cannot open " + filename);
+	read_mps(in);
+}
+
+template<typename eT>
+string LinearProgram<eT>::solution_format() const {
+	if(external_format != SolutionFormat::AUTO)
+		return external_format;
+
+	// the first word of the command, without its directory
+	auto tok = mps_aux::tokens(external_command);
+	string cmd = tok.empty() ? "" : tok[0].substr(tok[0].find_last_of("/\\") + 1);
+	std::transform(cmd.begin(), cmd.end(), cmd.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	return cmd.rfind("highs", 0) == 0 ? SolutionFormat::HIGHS :
+		   cmd.rfind("cbc",   0) == 0 ? SolutionFormat::CBC :
+		   SolutionFormat::PLAIN;
+}
+
+template<typename eT>
+bool LinearProgram<eT>::read_solution(std::istream& in, const string& format) {
+	if(format != SolutionFormat::HIGHS && format != SolutionFormat::CBC && format != SolutionFormat::PLAIN)
+		throw std::runtime_error("read_solution: unknown format " + format);
+
+	sol = arma::zeros<Col<eT>>(n_var);
+	std::vector<char> seen(n_var, 0);
+	bool any = false;
+
+	auto lower = [](string s) {
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+		return s;
+	};
+	auto trim = [](const string& s) {
+		size_t b = s.find_first_not_of(" \t\r"), e = s.find_last_not_of(" \t\r");
+		return b == string::npos ? string() : s.substr(b, e - b + 1);
+	};
+	// the value of a variable, first one wins. Names that are not variables are ignored.
+	auto set_value = [&](const string& name, const string& value) {
+		int64_t j = mps_aux::var_index(name, n_var);
+		if(j < 0 || seen[j])
+			return;
+		sol(j) = mps_aux::parse_number<eT>(value);
+		seen[j] = 1;
+		any = true;
+	};
+
+	string line;
+	if(format == SolutionFormat::HIGHS) {
+		status = Status::ERROR;
+		bool status_next = false, values = true;
+		while(std::getline(in, line)) {
+			const string l = lower(trim(line));
+			if(l.empty())
+				continue;
+			if(status_next) {
+				status =
+					l == "optimal"                        ? Status::OPTIMAL :
+					l == "infeasible"                     ? Status::INFEASIBLE :
+					l == "unbounded"                      ? Status::UNBOUNDED :
+					l == "primal infeasible or unbounded" ? Status::INFEASIBLE_OR_UNBOUNDED :
+					l.find("limit reached") != string::npos || l == "interrupted by user" ? Status::INTERRUPTED :
+					Status::ERROR;
+				status_next = false;
+			} else if(l == "model status") {
+				status_next = true;
+			} else if(l[0] == '#') {
+				if(l.rfind("# rows", 0) == 0 || l.rfind("# dual", 0) == 0 || l.rfind("# basis", 0) == 0)
+					values = false;
+			} else if(values) {
+				auto tok = mps_aux::tokens(line);
+				if(tok.size() == 2)
+					set_value(tok[0], tok[1]);
+			}
+		}
+
+	} else if(format == SolutionFormat::CBC) {
+		status = Status::ERROR;
+		bool first = true;
+		while(std::getline(in, line)) {
+			const string l = lower(trim(line));
+			if(l.empty())
+				continue;
+			if(first) {
+				const string st = trim(l.substr(0, l.find(" - ")));
+				status =
+					st == "optimal"              ? Status::OPTIMAL :
+					st == "infeasible"           ? Status::INFEASIBLE :
+					st == "unbounded"            ? Status::UNBOUNDED :
+					st.rfind("stopped on", 0) == 0 ? Status::INTERRUPTED :
+					Status::ERROR;
+				first = false;
+				continue;
+			}
+			auto tok = mps_aux::tokens(line);
+			size_t k = !tok.empty() && tok[0] == "**" ? 1 : 0;			// marks infeasible rows/columns
+			if(tok.size() >= k + 3 && std::all_of(tok[k].begin(), tok[k].end(), [](unsigned char c) { return std::isdigit(c); }))
+				set_value(tok[k+1], tok[k+2]);
+		}
+
+	} else {
+		while(std::getline(in, line)) {
+			const string l = trim(line);
+			if(l.empty() || l[0] == '#')
+				continue;
+			auto tok = mps_aux::tokens(l);
+			if(tok.size() != 2)
+				throw std::runtime_error("read_solution: invalid line: " + line);
+			set_value(tok[0], tok[1]);
+		}
+		status = any ? Status::OPTIMAL : Status::ERROR;
+	}
+
+	if(!(status == Status::OPTIMAL || (status == Status::INTERRUPTED && any)))
+		sol.reset();
+	return status == Status::OPTIMAL;
+}
+
+// Solver::EXTERNAL, see external_command
+//
+template<typename eT>
+bool LinearProgram<eT>::external_solver() {
+	if(external_command.empty())
+		throw std::runtime_error("external solver: external_command is not set");
+
+	namespace fs = std::filesystem;
+	std::random_device rd;
+	const string base = (fs::temp_directory_path() / ("qif_lp_" + std::to_string(rd()) + std::to_string(rd()))).string();
+	const string model_file = base + ".mps", sol_file = base + ".sol";
+
+	auto replace_all = [](string s, const string& from, const string& to) {
+		for(size_t p = s.find(from); p != string::npos; p = s.find(from, p + to.size()))
+			s.replace(p, from.size(), to);
+		return s;
+	};
+	// the paths come from TMPDIR and might contain spaces or shell metacharacters
+	auto quote = [&](const string& path) {
+		#ifdef _WIN32
+		return "\"" + path + "\"";					// cmd.exe, " cannot appear in windows paths
+		#else
+		return "'" + replace_all(path, "'", "'\\''") + "'";
+		#endif
+	};
+	const string cmd = replace_all(replace_all(replace_all(external_command,
+		"{model}", quote(model_file)),
+		"{solution}", quote(sol_file)),
+		"{time_limit}", std::to_string(time_limit > 0 ? std::max(0.0, time_left()) : 0.0));
+
+	write_mps(model_file);
+	lap(stats.setup);
+
+	if(msg_level != MsgLevel::OFF)
+		std::cerr << "Running external solver: " << cmd << "\n";
+	const int ret = std::system(cmd.c_str());
+	lap(stats.solve);
+
+	bool res = false;
+	{
+		std::ifstream in(sol_file);
+		if(ret != 0 || !in) {
+			status = Status::ERROR;
+			if(msg_level != MsgLevel::OFF)
+				std::cerr << "External solver failed (exit code " << ret << ")\n";
+		} else {
+			try {
+				res = read_solution(in);
+			} catch(std::exception& e) {			// malformed solution file
+				status = Status::ERROR;
+				sol.reset();
+				if(msg_level != MsgLevel::OFF)
+					std::cerr << "External solver: " << e.what() << "\n";
+			}
+		}
+	}
+
+	std::error_code ec;
+	fs::remove(model_file, ec);
+	fs::remove(sol_file, ec);
+	lap(stats.extract);
+
+	return res;
+}
+
+
+template<typename eT>
+std::vector<std::pair<string, string>> LinearProgram<eT>::portfolio_entries() const {
+	std::vector<string> names = portfolio;
+	if(names.empty()) {
+		// all available backends, only the exact ones for rat
+		if(is_rat) {
+			#if defined(QIF_USE_ORTOOLS) || defined(QIF_USE_GLPK)
+			names.push_back(Solver::HYBRID);
+			#endif
+		} else {
+			#ifdef QIF_USE_ORTOOLS
+			names.insert(names.end(), { Solver::GLOP, Solver::CLP });
+			#endif
+			#ifdef QIF_USE_GLPK
+			names.push_back(Solver::GLPK);		// GLPK solves are serialised, a second entry would only wait
+			#endif
+		}
+		names.push_back(Solver::INTERNAL);
+	}
+
+	std::vector<std::pair<string, string>> res;
+	for(auto& name : names) {
+		auto colon = name.find(':');
+		string s = name.substr(0, colon), m = colon == string::npos ? "" : name.substr(colon + 1);
+		if(s == Solver::PORTFOLIO || s == Solver::AUTO)
+			throw std::runtime_error("invalid portfolio entry: " + name);
+		res.emplace_back(s, m);
+	}
+	return res;
+}
+
+// The entry that AUTO runs: the best of the family's portfolio wins (see portfolio_best), empty if none. For rat the
+// wins are those of rational programs, and only exact winners (internal/hybrid) are used, as when there are no wins.
+//
+template<typename eT>
+string LinearProgram<eT>::portfolio_auto() const {
+	if(family.empty())
+		return "";
+	string best = portfolio_best(family, is_rat);
+	if(is_rat) {
+		string s = best.substr(0, best.find(':'));
+		if(s != Solver::INTERNAL && s != Solver::HYBRID)
+			return "";
+	}
+	return best;
+}
+
+// Solver::PORTFOLIO, see portfolio
+//
+// Every entry solves its own copy of the program (with the caller's limits, cancelled when another entry wins) in its
+// own thread. The state of the race is shared with the threads, so that the losers can outlive this call, their
+// threads are handed to portfolio_threads() which joins them.
+//
+template<typename eT>
+bool LinearProgram<eT>::portfolio_solver() {
+	QIF_TRACE_SPAN("lp::portfolio");
+	auto entries = portfolio_entries();
+
+	struct Race {
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::vector<std::unique_ptr<LinearProgram<eT>>> lps;
+		std::vector<char> done;				// entry k has finished, its program can be read
+		uint finished = 0;
+		int winner = -1;
+		CancelToken cancel = CancelToken::create();
+	};
+	auto race = std::make_shared<Race>();
+	const uint n = entries.size();
+
+	for(uint k = 0; k < n; k++) {
+		auto lp = std::make_unique<LinearProgram<eT>>(*this);
+		lp->solver = entries[k].first;
+		if(!entries[k].second.empty())
+			lp->method = entries[k].second;
+		lp->presolve = false;				// solve() has already presolved this program, if presolve is set
+		lp->msg_level = MsgLevel::OFF;
+		lp->instrument = false;				// only the winner's stats are kept, last_stats is set by the caller
+		lp->family.clear();
+		lp->cancel = race->cancel;
+		lp->time_limit = time_limit > 0 ? std::max(time_left(), 1e-9) : 0;
+		lp->memory_limit = 0;				// part of the estimate of this program
+		race->lps.push_back(std::move(lp));
+	}
+	race->done.assign(n, 0);
+	lap(stats.setup);
+	auto start = Clock::now();
+
+	for(uint k = 0; k < n; k++) {
+		auto thread_done = std::make_shared<std::atomic<bool>>(false);
+		std::thread t([race, k, thread_done] {
+			auto& lp = *race->lps[k];
+			try {
+				lp.solve();
+			} catch(std::exception&) {
+				lp.status = Status::ERROR;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(race->mutex);
+				race->finished++;
+				race->done[k] = 1;
+				if(race->winner < 0 && lp.status != Status::ERROR && lp.status != Status::INTERRUPTED) {
+					race->winner = k;
+					race->cancel.cancel();
+				}
+				race->cv.notify_all();
+			}
+			*thread_done = true;
+		});
+		portfolio_threads().add(std::move(t), thread_done);
+	}
+
+	// wait for a winner (or for all to give up), passing our own cancellation/time limit to the entries
+	std::unique_lock<std::mutex> lock(race->mutex);
+	while(race->winner < 0 && race->finished < n) {
+		race->cv.wait_for(lock, std::chrono::milliseconds(10));
+		if(interrupted(0))
+			race->cancel.cancel();
+	}
+	lap(stats.solve);
+
+	// the result of the winner, otherwise of a finished entry that was interrupted with a feasible solution (the
+	// others may still be running)
+	int k = race->winner;
+	if(k < 0)
+		for(uint i = 0; i < n; i++)
+			if(race->done[i] && race->lps[i]->has_solution())
+				k = i;
+
+	if(k < 0) {
+		status = interrupted(0) ? Status::INTERRUPTED : race->lps[0]->status;
+		return false;
+	}
+
+	// the loser threads have stopped touching their own programs only, the winner is done
+	auto& w = *race->lps[k];
+	status = w.status;
+	sol = std::move(w.sol);
+	con_duals = std::move(w.con_duals);
+	var_reduced_costs = std::move(w.var_reduced_costs);
+	var_basis = std::move(w.var_basis);
+	con_basis = std::move(w.con_basis);
+	stats.iterations = w.stats.iterations;
+
+	if(race->winner >= 0) {
+		portfolio_winner = portfolio.empty()
+			? entries[k].first + (entries[k].second.empty() ? "" : ":" + entries[k].second)
+			: portfolio[k];
+		if(!family.empty())
+			record_portfolio_win(family, portfolio_winner, is_rat);
+		if(msg_level != MsgLevel::OFF)
+			std::cerr << "Portfolio: " << portfolio_winner << " won (" << w.status << ") in "
+				<< std::chrono::duration<double>(Clock::now() - start).count() << "s\n";
+	}
+	lap(stats.extract);
+
+	return status == Status::OPTIMAL;
 }
 
 }
@@ -0,0 +1,23 @@
+
+// Read-only view of a whole file, memory-mapped where mmap is available (otherwise read into memory). The content
+// is accessed in place via data()/size(), without copying, and stays valid for the lifetime of the object.
+//
+class MappedFile {
+	private:
+		const char* ptr = nullptr;
+		size_t len = 0;
+		bool mapped = false;
+		std::string buffer;			// used when the file is not mapped
+
+	public:
+		explicit MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		inline const char* data() const { return ptr; }
+		inline size_t size() const { return len; }
+		inline const char* begin() const { return ptr; }
+		inline const char* end() const { return ptr + len; }
+};
@@ -2,19 +2,38 @@ namespace qp {
 
 using std::string;
 
-// Use a map <col, row> => value for sparse arrays. Put column first so that
-// the lexicographic order used by map is top-to-bottom/left-to-right
-template<typename eT> using Sparse = std::map<std::pair<uint,uint>,eT>;
-
-enum class Status { OPTIMAL, INFEASIBLE, ERROR };
+enum class Status { OPTIMAL, INFEASIBLE, INTERRUPTED, ERROR };
 enum class Method { ADDM };
 
 std::ostream& operator<<(std::ostream& os, const Status& status);
 std::ostream& operator<<(std::ostream& os, const Method& method);
 
+// Instrumentation of a solve, same as for linear programs (see lp::Stats). For OSQP, setup is the construction (or
+// in-place update) of the workspace, including the KKT factorization, and nnz also counts the quadratic coefficients.
+//
+typedef lp::Stats Stats;
+
+inline std::mutex& last_stats_mutex() {
+	static std::mutex m;
+	return m;
+}
+inline Stats& last_stats_ref() {
+	static Stats stats;
+	return stats;
+}
+inline Stats last_stats() {
+	std::lock_guard<std::mutex> lock(last_stats_mutex());
+	return last_stats_ref();
+}
+inline void set_last_stats(const Stats& stats) {
+	std::lock_guard<std::mutex> lock(last_stats_mutex());
+	last_stats_ref() = stats;
+}
+
 
 class Defaults {
 	public:
+		static bool		instrument;
 		static bool		osqp_polish;
 		static bool		osqp_verbose;
 		static double	osqp_alpha;
@@ -43,14 +62,28 @@ class QuadraticProgram {
 		double osqp_alpha = Defaults::osqp_alpha;
 		double osqp_eps_abs = Defaults::osqp_eps_abs;
 		double osqp_eps_rel = Defaults::osqp_eps_rel;
+		bool instrument = Defaults::instrument;
+		Stats stats;							// of the last solve, if instrument is set
+
+		// Limits, as for linear programs (see lp::SolveOptions), initially those of the calling thread. When reached,
+		// solve() returns false with status INTERRUPTED and the last ADMM iterate is kept as the solution (it might
+		// violate the constraints slightly). cancel is only checked before starting, OSQP cannot be interrupted.
+		double time_limit = lp::thread_options().time_limit;
+		int64_t iteration_limit = lp::thread_options().iteration_limit;
+		lp::CancelToken cancel = lp::thread_options().cancel;
+		uint64_t memory_limit = lp::thread_options().memory_limit;		// checked by solve() only
 
 		QuadraticProgram() {}
 
 		bool solve();
 
+		// solve() in a new thread. The program should not be used (or destroyed) until the future is ready.
+		std::future<bool> solve_async() { return std::async(std::launch::async, [this] { return solve(); }); }
+
 		inline eT objective()				{ return obj; }
 		inline eT solution(Var x)			{ return sol(x); }
 		inline Col<eT> solution()			{ return sol; };
+		bool has_solution() const			{ return !sol.empty(); }
 
 		void clear();
 		void from_matrix(const arma::SpMat<eT>&P, const Col<eT>& c, const arma::SpMat<eT>& A, const Col<eT>& l, const Col<eT>& u);
@@ -65,6 +98,32 @@ class QuadraticProgram {
 		void set_obj_coeff(Var var, eT coeff, bool add = false);				// linear part
 		void set_obj_coeff(Var var1, Var var2, eT coeff, bool add = false);		// quadratic part
 		void set_con_coeff(Con cons, Var var, eT coeff, bool add = false);
+		void set_con_bounds(Con con, eT lb, eT ub);
+
+		// Warm start: if true, the OSQP workspace of the previous solve is kept. If only the linear part of the
+		// objective and the constraint bounds changed since then, the workspace is updated in place, so the
+		// factorization of the KKT system is reused, and OSQP starts from the previous primal/dual solution. Any other
+		// change (vars, cons, quadratic or constraint coefficients, settings) rebuilds the workspace, which then still
+		// starts from the previous solution if the sizes are unchanged.
+		bool warm_start = false;
+		void clear_workspace();
+
+		// Estimated memory of solving the program (see lp::MemoryEstimate). setup counts the double copies passed to
+		// OSQP and its workspace: the KKT matrix (P, A and the diagonal) and its LDL factors, taken as twice as dense.
+		lp::MemoryEstimate estimate_memory() const {
+			const uint64_t E = sizeof(eT), I = sizeof(uint), nv = n_var, nc = n_con;
+			const uint64_t nnz = con_coeff.nnz() + con_coeff.n_pending() + obj_coeff_quad.nnz() + obj_coeff_quad.n_pending();
+			const uint64_t model = nv * sizeof(c_float) + nc * 2 * sizeof(c_float);
+			const uint64_t triplets = nnz * SparseBuilder<eT>::entry_bytes();
+			const uint64_t csc = nnz * (I + E) + 2 * (nv + 1) * I;
+			const uint64_t kkt = nnz + nv + nc;
+
+			lp::MemoryEstimate res;
+			res.build = model + triplets;
+			res.canonicalize = model + std::max(2 * triplets, triplets + csc);
+			res.setup = model + csc + nnz * (sizeof(c_int) + sizeof(c_float)) + 3 * kkt * (sizeof(c_int) + sizeof(c_float)) + (nv + nc) * 16 * sizeof(c_float);
+			return res;
+		}
 
 	protected:
 		Col<eT> sol;			// solution
@@ -74,10 +133,40 @@ class QuadraticProgram {
 			 n_con = 0;							// number of constraints
 
 		std::vector<c_float> obj_coeff_lin;		// coefficients for the objective function, linear part
-		Sparse<eT> obj_coeff_quad;				// coefficients for the objective function, quadratic part
-		Sparse<eT> con_coeff;					// coefficients for the constraints
+		SparseBuilder<eT> obj_coeff_quad;		// coefficients for the objective function, quadratic part (upper triangular)
+		SparseBuilder<eT> con_coeff;			// coefficients for the constraints (row = con, col = var)
 		std::vector<c_float> con_lb, con_ub;	// constraints lower/upper
 
+		// OSQP workspace kept between solves when warm_start is set. Copies of the program start without one.
+		struct Workspace {
+			OSQPWorkspace* work = nullptr;
+			std::array<double, 5> settings;		// settings used in osqp_setup
+
+			Workspace() {}
+			Workspace(const Workspace&) {}
+			Workspace& operator=(const Workspace&) { reset(); return *this; }
+			~Workspace() { reset(); }
+
+			void reset() {
+				if(work)
+					wrapper::osqp_cleanup(work);
+				work = nullptr;
+			}
+		} workspace;
+		bool structure_changed = true;			// vars, cons, P or A changed since the workspace was set up
+		std::vector<c_float> prev_x, prev_y;	// primal/dual solution of the last solve (warm_start only)
+
+		// see LinearProgram::lap
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point lap_start = Clock::now();
+		Clock::time_point solve_start = Clock::now();		// time_limit is counted from here
+		void lap(double& phase) {
+			if(!instrument) return;
+			auto now = Clock::now();
+			phase += std::chrono::duration<double>(now - lap_start).count();
+			lap_start = now;
+		}
+
 		bool osqp();
 };
 
@@ -85,6 +174,7 @@ template<typename eT>
 inline
 typename QuadraticProgram<eT>::Var QuadraticProgram<eT>::make_var() {
 	obj_coeff_lin.push_back(0);
+	structure_changed = true;
 	return n_var++;
 }
 
@@ -117,6 +207,7 @@ typename QuadraticProgram<eT>::Con QuadraticProgram<eT>::make_con(eT lb, eT ub)
 
 	con_lb.push_back(lb);
 	con_ub.push_back(ub);
+	structure_changed = true;
 	return n_con++;
 }
 
@@ -139,11 +230,8 @@ void QuadraticProgram<eT>::set_obj_coeff(Var var1, Var var2, eT coeff, bool add)
 	if(var1 > var2)
 		std::swap(var1, var2);
 
-	auto key = std::pair(var2, var1);		// <col, row>
-	if(add && obj_coeff_quad.count(key))
-		obj_coeff_quad[key] += coeff;
-	else
-		obj_coeff_quad[key] = coeff;
+	obj_coeff_quad.set(var1, var2, coeff, add);
+	structure_changed = true;
 }
 
 template<typename eT>
@@ -152,11 +240,26 @@ void QuadraticProgram<eT>::set_con_coeff(Con con, Var var, eT coeff, bool add) {
 	if(equal<eT>(coeff, eT(0)))
 		return;
 
-	auto key = std::pair(var, con);	// <col, row>
-	if(add && con_coeff.count(key))
-		con_coeff[key] += coeff;
-	else
-		con_coeff[key] = coeff;
+	con_coeff.set(con, var, coeff, add);
+	structure_changed = true;
+}
+
+template<typename eT>
+inline
+void QuadraticProgram<eT>::set_con_bounds(Con con, eT lb, eT ub) {
+	if(ub == infinity<eT>() && lb == -ub)
+		throw std::runtime_error("trying to set unconstrained constraint");
+
+	con_lb.at(con) = lb;
+	con_ub.at(con) = ub;
+}
+
+template<typename eT>
+inline
+void QuadraticProgram<eT>::clear_workspace() {
+	workspace.reset();
+	prev_x.clear();
+	prev_y.clear();
 }
 
 template<typename eT>
@@ -166,7 +269,10 @@ void QuadraticProgram<eT>::clear() {
 	con_coeff.clear();
 	con_lb.clear();
 	con_ub.clear();
+	clear_workspace();
+	structure_changed = true;
 	n_var = n_con = 0;
+	lap_start = Clock::now();
 }
 
 // input program in matrix form
@@ -186,6 +292,7 @@ void QuadraticProgram<eT>::from_matrix(const arma::SpMat<eT>&P, const Col<eT>& c
 	if(P.n_rows != n_var || P.n_cols != n_var || c.n_elem != n_var || l.n_elem != n_con || u.n_elem != n_con)
 		throw std::runtime_error("invalid size");
 	
+	obj_coeff_quad.reserve(P.n_nonzero);
 	auto Pend = P.end();
 	for(auto c = P.begin(); c != Pend; ++c) {		// c++ throws weird warning, ++c doesn't!
 		set_obj_coeff(c.row(), c.col(), *c);
@@ -194,6 +301,7 @@ void QuadraticProgram<eT>::from_matrix(const arma::SpMat<eT>&P, const Col<eT>& c
 	using cfv = std::vector<c_float>;
 	obj_coeff_lin = arma::conv_to<cfv>::from(c);
 	
+	con_coeff.reserve(A.n_nonzero);
 	auto Aend = A.end();
 	for(auto c = A.begin(); c != Aend; ++c) {		// c++ throws weird warning, ++c doesn't!
 		set_con_coeff(c.row(), c.col(), *c);
@@ -205,39 +313,63 @@ void QuadraticProgram<eT>::from_matrix(const arma::SpMat<eT>&P, const Col<eT>& c
 
 template<typename eT>
 bool QuadraticProgram<eT>::solve() {
-	return osqp();
+	QIF_TRACE_SPAN("qp::solve");
+	stats = Stats();
+	lap(stats.build);
+	sol.reset();
+	solve_start = Clock::now();
+
+	lp::MemoryEstimate mem = estimate_memory();
+	if(memory_limit > 0 && mem.peak() > memory_limit)
+		throw std::runtime_error("QP memory limit exceeded: estimated peak of " + std::to_string(mem.peak() >> 20) + " MiB for " +
+			std::to_string(n_var) + " vars and " + std::to_string(n_con) + " cons (limit " + std::to_string(memory_limit >> 20) + " MiB)");
+	if(instrument) {
+		stats.memory = mem;
+		stats.memory.build = (obj_coeff_lin.capacity() + con_lb.capacity() + con_ub.capacity()) * sizeof(c_float) + con_coeff.bytes() + obj_coeff_quad.bytes();
+	}
+
+	bool res;
+	if(cancel.cancelled()) {
+		status = Status::INTERRUPTED;
+		res = false;
+	} else {
+		res = osqp();
+	}
+
+	if(instrument) {
+		stats.solver = "OSQP";
+		stats.status =
+			status == Status::OPTIMAL     ? lp::Status::OPTIMAL :
+			status == Status::INFEASIBLE  ? lp::Status::INFEASIBLE :
+			status == Status::INTERRUPTED ? lp::Status::INTERRUPTED :
+			lp::Status::ERROR;
+		stats.n_var = n_var;
+		stats.n_con = n_con;
+		stats.nnz = con_coeff.nnz() + obj_coeff_quad.nnz();
+		set_last_stats(stats);
+	}
+	lap_start = Clock::now();		// the next build phase starts here
+
+	return res;
 }
 
+// copies a compressed SparseBuilder to osqp's csc (same format, different index/value types)
 template<typename eT>
-csc* to_csc(uint n_rows, uint n_cols, const Sparse<eT>& entries) {
-	// Compressed Sparse Column (CSC) format.
-	// https://en.wikipedia.org/wiki/Sparse_matrix#Compressed_sparse_column_(CSC_or_CCS)
-	// val:      array of non-zero values, in top-to-bottom, left-to-right order
-	// row_ind:  for every value, the row index of that value
-	// col_ptr:  for every column, the val index of the first element of that column.
-	//           Plus an extra element at the end, with the size of val
+csc* to_csc(uint n_rows, uint n_cols, const SparseBuilder<eT>& entries) {
+	assert(entries.is_compressed() && entries.n_cols() == n_cols);
 
-	uint n_nonzero = entries.size();
+	uint n_nonzero = entries.nnz();
 
 	c_float* val = (c_float*) malloc(sizeof(c_float) * n_nonzero);
 	c_int* row_ind = (c_int*) malloc(sizeof(c_int) * n_nonzero);
-	c_int* col_ptr = (c_int*) malloc(sizeof(c_int) * n_cols + 1);
-
-	uint cur_col = 0;
-	uint cnt = 0;		// next to update
-	for(auto& [key, value] : entries) {
-		auto& [col, row] = key;
-
-		// first time we see a column, update col_ptr
-		for(; cur_col <= col; cur_col++)	// possibly update previous empty columns
-			col_ptr[cur_col] = cnt;
+	c_int* col_ptr = (c_int*) malloc(sizeof(c_int) * (n_cols + 1));
 
-		val[cnt] = value;
-		row_ind[cnt] = row;
-		cnt++;
+	for(uint k = 0; k < n_nonzero; k++) {
+		val[k] = to_double(entries.values[k]);
+		row_ind[k] = entries.row_ind[k];
 	}
-	for(; cur_col <= n_cols; cur_col++)
-		col_ptr[cur_col] = n_nonzero;
+	for(uint j = 0; j <= n_cols; j++)
+		col_ptr[j] = entries.col_ptr[j];
 
 	return wrapper::csc_matrix(n_rows, n_cols, n_nonzero, val, row_ind, col_ptr);
 }
@@ -256,52 +388,113 @@ bool QuadraticProgram<eT>::osqp() {
 	if(non_negative)
 		throw std::runtime_error("not_implemented");
 
-	// populate data
-	OSQPData* data = (OSQPData *)malloc(sizeof(OSQPData));
-	data->n = n_var;								// number of variables
-	data->m = n_con;								// number of constraints
-	data->q = obj_coeff_lin.data();					// cost function, linear part
-	data->P = to_csc(n_var, n_var, obj_coeff_quad);	// cost function, quadratic part
-	data->A = to_csc(n_con, n_var, con_coeff);		// constraints
-	data->l = con_lb.data();						// lower bounds
-	data->u = con_ub.data();						// upper bounds
-
-	// settings
-	OSQPSettings* settings = (OSQPSettings *)malloc(sizeof(OSQPSettings));
-	wrapper::osqp_set_default_settings(settings);
-	settings->polish = osqp_polish;
-	settings->verbose = osqp_verbose;
-	if(osqp_alpha   >= 0.0) settings->alpha = osqp_alpha;
-	if(osqp_eps_abs >= 0.0) settings->eps_abs = osqp_eps_abs;
-	if(osqp_eps_rel >= 0.0) settings->eps_rel = osqp_eps_rel;
+	const std::array<double, 5> cur_settings = { double(osqp_polish), double(osqp_verbose), osqp_alpha, osqp_eps_abs, osqp_eps_rel };
+
+	if(warm_start && workspace.work && !structure_changed && workspace.settings == cur_settings) {
+		// same P, A and settings, only q, l, u need to be updated (the factorization is kept)
+		if(wrapper::osqp_update_lin_cost(workspace.work, obj_coeff_lin.data()) != 0 ||
+		   wrapper::osqp_update_bounds(workspace.work, con_lb.data(), con_ub.data()) != 0) {
+			status = Status::ERROR;
+			return false;
+		}
+		lap(stats.setup);
+
+	} else {
+		workspace.reset();
+		obj_coeff_quad.compress(n_var);
+		con_coeff.compress(n_var);
+		lap(stats.canonicalize);
+
+		// populate data
+		OSQPData* data = (OSQPData *)malloc(sizeof(OSQPData));
+		data->n = n_var;								// number of variables
+		data->m = n_con;								// number of constraints
+		data->q = obj_coeff_lin.data();					// cost function, linear part
+		data->P = to_csc(n_var, n_var, obj_coeff_quad);	// cost function, quadratic part
+		data->A = to_csc(n_con, n_var, con_coeff);		// constraints
+		data->l = con_lb.data();						// lower bounds
+		data->u = con_ub.data();						// upper bounds
+
+		// settings
+		OSQPSettings* settings = (OSQPSettings *)malloc(sizeof(OSQPSettings));
+		wrapper::osqp_set_default_settings(settings);
+		settings->polish = osqp_polish;
+		settings->verbose = osqp_verbose;
+		if(osqp_alpha   >= 0.0) settings->alpha = osqp_alpha;
+		if(osqp_eps_abs >= 0.0) settings->eps_abs = osqp_eps_abs;
+		if(osqp_eps_rel >= 0.0) settings->eps_rel = osqp_eps_rel;
+
+		// setup (osqp copies the data, so it can be freed right away)
+		c_int err = wrapper::osqp_setup(&workspace.work, data, settings);
+
+		free_csc(data->P);
+		free_csc(data->A);
+		free(data);
+		free(settings);
+
+		if(err != 0) {
+			workspace.reset();
+			status = Status::ERROR;
+			return false;
+		}
+		workspace.settings = cur_settings;
+		structure_changed = false;
+
+		if(warm_start && prev_x.size() == n_var && prev_y.size() == n_con)
+			wrapper::osqp_warm_start(workspace.work, prev_x.data(), prev_y.data());
+		lap(stats.setup);
+	}
+
+	// limits, set on every solve since the workspace might be reused. The time spent so far (setup) is subtracted.
+	OSQPWorkspace* work = workspace.work;
+	OSQPSettings defaults;
+	wrapper::osqp_set_default_settings(&defaults);
+	work->settings->max_iter = iteration_limit > 0 ? c_int(iteration_limit) : defaults.max_iter;
+	#ifdef PROFILING
+	if(time_limit > 0) {
+		double left = time_limit - std::chrono::duration<double>(Clock::now() - solve_start).count();
+		if(left <= 0) {
+			if(!warm_start)
+				workspace.reset();
+			status = Status::INTERRUPTED;
+			return false;
+		}
+		work->settings->time_limit = left;
+	} else {
+		work->settings->time_limit = defaults.time_limit;
+	}
+	#endif
 
 	// solve
-	OSQPWorkspace* work;
-	wrapper::osqp_setup(&work, data, settings);
 	wrapper::osqp_solve(work);
-	// std::cout << "DONE\n";
+	stats.iterations = work->info->iter;
+	lap(stats.solve);
 
 	c_int st = work->info->status_val;
 	status =
 		st == OSQP_SOLVED											? Status::OPTIMAL :
 		st == OSQP_PRIMAL_INFEASIBLE || st == OSQP_DUAL_INFEASIBLE	? Status::INFEASIBLE :
+		st == OSQP_TIME_LIMIT_REACHED || (st == OSQP_MAX_ITER_REACHED && iteration_limit > 0) ? Status::INTERRUPTED :
 		Status::ERROR;
 
-	// get optimal solution
-	if(status == Status::OPTIMAL) {
+	// get the solution (the last iterate if interrupted)
+	if(status == Status::OPTIMAL || status == Status::INTERRUPTED) {
 		sol.set_size(n_var);
 		for(uint j = 0; j < n_var; j++)
 			sol.at(j) = work->solution->x[j];
 
 		obj = work->info->obj_val;
+
+		if(warm_start) {
+			prev_x.assign(work->solution->x, work->solution->x + n_var);
+			prev_y.assign(work->solution->y, work->solution->y + n_con);
+		}
 	}
 
 	// cleanup
-	free_csc(data->P);
-	free_csc(data->A);
-	free(data);
-	free(settings);
-	wrapper::osqp_cleanup(work);
+	if(!warm_start)
+		workspace.reset();
+	lap(stats.extract);
 
 	return status == Status::OPTIMAL;
 }
@@ -0,0 +1,169 @@
+// Accumulator for the sparse coefficient matrices of LinearProgram/QuadraticProgram.
+//
+// Entries are appended as (row, col, value) triplets in a contiguous array (no allocation per entry, as it would
+// happen with a std::map), and are compressed once into Compressed Sparse Column (CSC) format by compress(),
+// typically when solving.
+// https://en.wikipedia.org/wiki/Sparse_matrix#Compressed_sparse_column_(CSC_or_CCS)
+//
+// set(row, col, val, add) has the semantics of a map: the value of an existing entry is replaced, or increased by
+// val if add == true. Duplicates are resolved during compression, in the order in which they were set. Entries can
+// be set after compressing, they are merged with the compressed ones on the next compress().
+//
+template<typename eT>
+class SparseBuilder {
+	public:
+		// CSC form, valid after compress(). values[k] is the entry at row row_ind[k], entries of column j are
+		// at positions col_ptr[j] .. col_ptr[j+1]-1, sorted by row.
+		std::vector<uint> col_ptr = { 0 };
+		std::vector<uint> row_ind;
+		std::vector<eT> values;
+
+		// reserve space for n entries to be set
+		void reserve(size_t n) {
+			triplets.reserve(n);
+		}
+
+		void set(uint row, uint col, eT val, bool add = false) {
+			triplets.push_back({ row, col, val, add });
+		}
+
+		// number of compressed entries
+		size_t nnz() const {
+			return row_ind.size();
+		}
+
+		// number of entries set since the last compress() (duplicates included)
+		size_t n_pending() const {
+			return triplets.size();
+		}
+
+		// memory allocated by the builder, and taken by each pending entry (rats are counted at their inline size)
+		size_t bytes() const {
+			return triplets.capacity() * sizeof(Triplet) + (col_ptr.capacity() + row_ind.capacity()) * sizeof(uint) + values.capacity() * sizeof(eT);
+		}
+		static constexpr size_t entry_bytes() {
+			return sizeof(Triplet);
+		}
+
+		uint n_cols() const {
+			return col_ptr.size() - 1;
+		}
+
+		bool is_compressed() const {
+			return triplets.empty();
+		}
+
+		// builds the CSC form with (at least) n_cols columns
+		void compress(uint n_cols = 0);
+
+		// calls f(row, col, value) for every compressed entry, value is passed by reference so it can be modified
+		template<typename F>
+		void for_each(F f) {
+			for(uint j = 0; j < n_cols(); j++)
+				for(uint k = col_ptr[j]; k < col_ptr[j+1]; k++)
+					f(row_ind[k], j, values[k]);
+		}
+
+		// Appends the pending entries of blocks[b] (built independently, eg. by different threads) with their rows
+		// shifted by row_offset[b]. The copy is done in parallel, and the blocks are cleared.
+		void append(std::vector<SparseBuilder>& blocks, const std::vector<uint>& row_offset);
+
+		void clear() {
+			triplets.clear();
+			col_ptr.assign(1, 0);
+			row_ind.clear();
+			values.clear();
+		}
+
+	private:
+		struct Triplet {
+			uint row, col;
+			eT val;
+			bool add;
+		};
+		std::vector<Triplet> triplets;		// pending entries, not compressed yet
+};
+
+template<typename eT>
+void SparseBuilder<eT>::append(std::vector<SparseBuilder>& blocks, const std::vector<uint>& row_offset) {
+	assert(blocks.size() == row_offset.size());
+
+	std::vector<size_t> start(blocks.size() + 1, triplets.size());
+	for(uint b = 0; b < blocks.size(); b++)
+		start[b+1] = start[b] + blocks[b].triplets.size();
+	triplets.resize(start.back());
+
+	parallel::for_each(blocks.size(), [&](uint b) {
+		auto& src = blocks[b].triplets;
+		for(size_t k = 0; k < src.size(); k++) {
+			triplets[start[b] + k] = src[k];
+			triplets[start[b] + k].row += row_offset[b];
+		}
+		blocks[b].clear();
+		src.shrink_to_fit();
+	});
+}
+
+template<typename eT>
+void SparseBuilder<eT>::compress(uint n_cols) {
+	uint n_old = this->n_cols();
+	for(auto& t : triplets)
+		if(t.col >= n_cols)
+			n_cols = t.col + 1;
+	n_cols = std::max(n_cols, n_old);
+
+	if(triplets.empty()) {
+		col_ptr.resize(n_cols + 1, col_ptr.back());
+		return;
+	}
+
+	// Counting sort by column (stable), with the already compressed entries first, so that the order  in which
+	// entries were set is preserved within each column.
+	std::vector<uint> count(n_cols + 1, 0);
+	for(uint j = 0; j < n_old; j++)
+		count[j+1] += col_ptr[j+1] - col_ptr[j];
+	for(auto& t : triplets)
+		count[t.col+1]++;
+	for(uint j = 0; j < n_cols; j++)
+		count[j+1] += count[j];
+
+	size_t total = count[n_cols];
+	std::vector<Triplet> sorted(total);
+	std::vector<uint> pos(count.begin(), count.end() - 1);
+
+	for(uint j = 0; j < n_old; j++)
+		for(uint k = col_ptr[j]; k < col_ptr[j+1]; k++)
+			sorted[pos[j]++] = { row_ind[k], j, values[k], false };
+	for(auto& t : triplets)
+		sorted[pos[t.col]++] = t;
+
+	triplets.clear();
+	triplets.shrink_to_fit();
+
+	// Sort each column by row (stable, entries are often already sorted), and merge duplicates
+	col_ptr.assign(n_cols + 1, 0);
+	row_ind.clear();
+	values.clear();
+	row_ind.reserve(total);
+	values.reserve(total);
+
+	for(uint j = 0; j < n_cols; j++) {
+		auto first = sorted.begin() + count[j], last = sorted.begin() + count[j+1];
+		auto by_row = [](const Triplet& a, const Triplet& b) { return a.row < b.row; };
+		if(!std::is_sorted(first, last, by_row))
+			std::stable_sort(first, last, by_row);
+
+		for(auto it = first; it != last; ++it) {
+			if(values.size() > col_ptr[j] && row_ind.back() == it->row) {
+				if(it->add)
+					values.back() += it->val;
+				else
+					values.back() = it->val;
+			} else {
+				row_ind.push_back(it->row);
+				values.push_back(it->val);
+			}
+		}
+		col_ptr[j+1] = row_ind.size();
+	}
+}
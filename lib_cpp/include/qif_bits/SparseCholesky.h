@@ -0,0 +1,183 @@
+namespace lp {
+
+// Sparse Cholesky factorization  M(p,p) = L L^T  of a symmetric positive semi-definite n x n matrix M, used for the
+// normal equations A Theta A^T of LinearProgram::interior(). Always in double.
+//
+// analyze() computes a minimum degree ordering p, by eliminating the vertices of the graph of M one by one (the one
+// of smallest current degree first) and connecting the neighbours of each eliminated vertex. The neighbours at the
+// time of elimination are exactly the non-zeros of the corresponding column of L, so this also gives the structure of
+// the factor. It only depends on the pattern of M, so it is done once, and factorize() is called for every new M
+// with the same pattern (left-looking, column by column).
+//
+// Pivots that become too small (eg. M is singular because of redundant constraints) are replaced by a huge value,
+// so the corresponding component of the solution is ~0 instead of the factorization failing.
+//
+class SparseCholesky {
+	public:
+		static constexpr double tiny = 1e-30, huge = 1e128;
+
+		// pattern[i]: the j != i with M(i,j) != 0 (symmetric, duplicates allowed)
+		void analyze(uint n, const std::vector<std::vector<uint>>& pattern);
+
+		// column(j, out) should append the non-zeros of column j of M to out, as (row, value). Any entries with
+		// row i, j in either order can be given (only the lower triangle in the elimination order is used), duplicates
+		// are summed.
+		template<typename ColFunc>
+		void factorize(ColFunc column);
+
+		// solves M x = b in place
+		void solve(std::vector<double>& x) const;
+
+		uint64_t nnz() const {
+			uint64_t res = n;
+			for(auto& r : L_row)
+				res += r.size();
+			return res;
+		}
+
+	private:
+		uint n = 0;
+		std::vector<uint> perm, iperm;					// perm[k]: vertex eliminated at step k, iperm its inverse
+		std::vector<std::vector<uint>> L_row;			// L_row[k]: rows (> k, sorted) of column k of L
+		std::vector<std::vector<double>> L_val;
+		std::vector<std::vector<std::pair<uint,uint>>> row_of;	// row_of[k]: (column j < k, position of k in L_row[j])
+		std::vector<double> diag;
+};
+
+inline
+void SparseCholesky::analyze(uint n, const std::vector<std::vector<uint>>& pattern) {
+	this->n = n;
+
+	// adjacency lists, kept sorted and without duplicates
+	std::vector<std::vector<uint>> adj(n);
+	for(uint i = 0; i < n; i++)
+		for(uint j : pattern[i])
+			if(j != i) {
+				adj[i].push_back(j);
+				adj[j].push_back(i);
+			}
+	for(auto& a : adj) {
+		std::sort(a.begin(), a.end());
+		a.erase(std::unique(a.begin(), a.end()), a.end());
+	}
+
+	std::set<std::pair<uint,uint>> by_degree;		// (degree, vertex) of the vertices not eliminated yet
+	for(uint i = 0; i < n; i++)
+		by_degree.insert({ uint(adj[i].size()), i });
+
+	perm.assign(n, 0);
+	iperm.assign(n, 0);
+	std::vector<std::vector<uint>> nbrs(n);			// neighbours at elimination, in the original numbering
+	std::vector<uint> merged;
+
+	for(uint k = 0; k < n; k++) {
+		auto [degree, v] = *by_degree.begin();
+
+		if(degree == n - k - 1) {
+			// the remaining vertices form a clique, their order does not matter (the rest of the factor is dense)
+			uint k2 = k;
+			for(auto& [d, r] : by_degree) {
+				perm[k2] = r;
+				iperm[r] = k2++;
+			}
+			for(uint k3 = k; k3 < n; k3++)
+				nbrs[k3].assign(perm.begin() + k3 + 1, perm.end());
+			break;
+		}
+
+		by_degree.erase(by_degree.begin());
+		perm[k] = v;
+		iperm[v] = k;
+		nbrs[k] = std::move(adj[v]);
+
+		// remove v and make its neighbours a clique
+		for(uint a : nbrs[k]) {
+			by_degree.erase({ uint(adj[a].size()), a });
+
+			merged.clear();
+			std::set_union(adj[a].begin(), adj[a].end(), nbrs[k].begin(), nbrs[k].end(), std::back_inserter(merged));
+			adj[a].clear();
+			for(uint b : merged)
+				if(b != a && b != v)
+					adj[a].push_back(b);
+
+			by_degree.insert({ uint(adj[a].size()), a });
+		}
+	}
+
+	L_row.assign(n, {});
+	L_val.assign(n, {});
+	row_of.assign(n, {});
+	diag.assign(n, 0);
+	for(uint k = 0; k < n; k++) {
+		for(uint a : nbrs[k])
+			L_row[k].push_back(iperm[a]);
+		std::sort(L_row[k].begin(), L_row[k].end());
+		L_val[k].assign(L_row[k].size(), 0);
+
+		for(uint pos = 0; pos < L_row[k].size(); pos++)
+			row_of[L_row[k][pos]].push_back({ k, pos });
+	}
+}
+
+template<typename ColFunc>
+void SparseCholesky::factorize(ColFunc column) {
+	std::vector<double> w(n, 0.0);
+	std::vector<std::pair<uint,double>> col;
+	double max_diag = 0;
+
+	for(uint k = 0; k < n; k++) {
+		// w = M(k.., k) in the new order
+		col.clear();
+		column(perm[k], col);
+		for(auto& [i, val] : col)
+			if(iperm[i] >= k)
+				w[iperm[i]] += val;
+		max_diag = std::max(max_diag, w[k]);
+
+		// subtract L(k.., j) L(k, j) for the previous columns j having a non-zero in row k
+		for(auto& [j, pos] : row_of[k]) {
+			double l_kj = L_val[j][pos];
+			w[k] -= l_kj * l_kj;
+			for(uint p = pos + 1; p < L_row[j].size(); p++)
+				w[L_row[j][p]] -= L_val[j][p] * l_kj;
+		}
+
+		double d = w[k];
+		w[k] = 0;
+		if(!(d > tiny * std::max(1.0, max_diag)))
+			d = huge;
+		diag[k] = std::sqrt(d);
+
+		for(uint p = 0; p < L_row[k].size(); p++) {
+			uint i = L_row[k][p];
+			L_val[k][p] = w[i] / diag[k];
+			w[i] = 0;
+		}
+	}
+}
+
+inline
+void SparseCholesky::solve(std::vector<double>& x) const {
+	std::vector<double> y(n);
+	for(uint k = 0; k < n; k++)
+		y[k] = x[perm[k]];
+
+	// L y' = y
+	for(uint k = 0; k < n; k++) {
+		y[k] /= diag[k];
+		for(uint p = 0; p < L_row[k].size(); p++)
+			y[L_row[k][p]] -= L_val[k][p] * y[k];
+	}
+	// L^T x = y'
+	for(uint k = n; k-- > 0; ) {
+		for(uint p = 0; p < L_row[k].size(); p++)
+			y[k] -= L_val[k][p] * y[L_row[k][p]];
+		y[k] /= diag[k];
+	}
+
+	for(uint k = 0; k < n; k++)
+		x[perm[k]] = y[k];
+}
+
+} // namespace lp
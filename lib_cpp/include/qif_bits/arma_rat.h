@@ -9,11 +9,15 @@ struct arma_real_only<rat> {
 	typedef rat result;
 };
 
-// use direct_dot_arma (generic dot product implementation) for direct_dot<rat>
+// direct_dot<rat> (used by products of rat matrices), the generic direct_dot_arma creates a temporary for every
+// term, here the sum is accumulated by DotAccumulator (in machine integers while the terms are small)
 //
 template<>
 arma_hot inline rat op_dot::direct_dot<rat>(const uword n_elem, const rat* const A, const rat* const B) {
-	return op_dot::direct_dot_arma<rat>(n_elem, A, B);
+	qif::rat_aux::DotAccumulator acc;
+	for(uword i = 0; i < n_elem; i++)
+		acc.add(A[i], B[i]);
+	return acc.result();
 }
 
 // for abs
@@ -32,7 +36,7 @@ struct is_supported_elem_type<rat> {
 };
 
 // armadillo's memory::acquire/release uses malloc/free for speed, which ignores the constructor
-// We override it to use C++'s new/delete.
+// We override it to use constructed arrays from qif::rat_aux::Pool (cached per thread, instead of new/delete).
 //
 template<>
 inline
@@ -43,21 +47,21 @@ memory::acquire<rat>(const uword n_elem) {
 		( size_t(n_elem) > (std::numeric_limits<size_t>::max() / sizeof(rat)) ),
 		"arma::memory::acquire(): requested size is too large"
 	);
-	return ( new(std::nothrow) rat[n_elem] );
+	return qif::rat_aux::Pool::acquire(n_elem);
 }
 
 template<>
 arma_inline
 void
 memory::release<rat>(rat* mem) {
-	delete [] mem;
+	qif::rat_aux::Pool::release(mem);
 }
 
 template<>
 arma_inline
 void
 memory::release<const rat>(const rat* mem) {
-	delete [] mem;
+	qif::rat_aux::Pool::release(const_cast<rat*>(mem));
 }
 
 // armadillo uses memcpy to copy memory, we can't do that so we manually copy
@@ -0,0 +1,248 @@
+namespace binary {
+
+// Versioned binary format for matrices (Chan, Prob as 1 x n, or any Mat) of double, float or rat, for exchanging
+// them between processes without going through text or Python objects:
+//
+//   64-byte header (MatHeader): magic, version, element type, layout, n_rows, n_cols, data_bytes
+//   data: the elements in column-major order (as armadillo stores them), or row-major if row_major == 1
+//
+// Floating elements are stored raw, so the data can be used in place (see Mapped). A rat is stored as its numerator
+// then its denominator, each as a signed int64 limb count (negative for negative numbers) followed by that many
+// 64-bit limbs, least significant first (the GMP limbs of mp++'s integers).
+//
+namespace aux {
+
+struct MatHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t elem;					// see elem_code
+	uint32_t row_major;				// 1 if the rows (not the columns) are contiguous
+	uint32_t reserved1;
+	uint64_t n_rows, n_cols;
+	uint64_t data_bytes;			// bytes following the header
+	uint64_t reserved2[2];
+};
+static_assert(sizeof(MatHeader) == 64, "the header should be 64 bytes");
+
+const char mat_magic[8] = { 'Q', 'I', 'F', 'M', 'A', 'T', '\0', '\0' };
+const uint32_t mat_version = 1;
+
+template<typename eT>
+constexpr uint32_t elem_code() {
+	if constexpr (std::is_same<eT, double>::value)	return 1;
+	else if constexpr (std::is_same<eT, float>::value)	return 2;
+	else if constexpr (std::is_same<eT, rat>::value)	return 3;
+	else												return 0;
+}
+
+inline
+MatHeader make_header(uint32_t elem, bool row_major, uint64_t n_rows, uint64_t n_cols, uint64_t data_bytes) {
+	MatHeader h {};
+	std::copy(mat_magic, mat_magic + 8, h.magic);
+	h.version = mat_version;
+	h.elem = elem;
+	h.row_major = row_major;
+	h.n_rows = n_rows;
+	h.n_cols = n_cols;
+	h.data_bytes = data_bytes;
+	return h;
+}
+
+inline
+MatHeader read_header(const MappedFile& file, const std::string& filename) {
+	MatHeader h;
+	if(file.size() < sizeof(h))
+		throw std::runtime_error(filename + ": not a matrix file");
+	std::copy(file.begin(), file.begin() + sizeof(h), reinterpret_cast<char*>(&h));
+
+	if(!std::equal(mat_magic, mat_magic + 8, h.magic))
+		throw std::runtime_error(filename + ": not a matrix file");
+	if(h.version != mat_version)
+		throw std::runtime_error(filename + ": unsupported version " + std::to_string(h.version));
+	if(h.elem < 1 || h.elem > 3)
+		throw std::runtime_error(filename + ": unknown element type");
+	if(file.size() - sizeof(h) != h.data_bytes)			// no overflow, data_bytes comes from the file
+		throw std::runtime_error(filename + ": truncated file");
+	return h;
+}
+
+// The number of elements of the matrix in h, checked against its data before anything is allocated: each element
+// takes at least min_bytes (exactly, if exact). Throws if the header is inconsistent, the product overflows or the
+// dimensions do not fit armadillo's uword.
+//
+inline
+uint64_t checked_elems(const MatHeader& h, uint64_t min_bytes, bool exact) {
+	const uint64_t max_dim = std::numeric_limits<arma::uword>::max();
+	if(h.n_rows > max_dim || h.n_cols > max_dim)
+		throw std::runtime_error("invalid matrix size");
+	if(h.n_rows != 0 && h.n_cols > h.data_bytes / min_bytes / h.n_rows)
+		throw std::runtime_error("invalid data size");
+
+	const uint64_t n = h.n_rows * h.n_cols;				// <= data_bytes / min_bytes, no overflow
+	if(n > max_dim || (exact && h.data_bytes != n * min_bytes))
+		throw std::runtime_error("invalid data size");
+	return n;
+}
+
+inline
+void write_integer(std::vector<char>& buf, const mppp::integer<1>& z) {
+	mpz_srcptr m = z.get_mpz_view();
+
+	std::vector<uint64_t> limbs((mpz_sizeinbase(m, 2) + 63) / 64);
+	size_t count = 0;
+	mpz_export(limbs.data(), &count, -1, sizeof(uint64_t), 0, 0, m);
+
+	int64_t n = mpz_sgn(m) < 0 ? -int64_t(count) : int64_t(count);
+	const char* p = reinterpret_cast<const char*>(&n);
+	buf.insert(buf.end(), p, p + sizeof(n));
+	p = reinterpret_cast<const char*>(limbs.data());
+	buf.insert(buf.end(), p, p + count * sizeof(uint64_t));
+}
+
+inline
+mppp::integer<1> read_integer(const char*& p, const char* end) {
+	int64_t n;
+	if(end - p < int64_t(sizeof(n)))
+		throw std::runtime_error("corrupted rational data");
+	std::memcpy(&n, p, sizeof(n));
+	p += sizeof(n);
+
+	// the magnitude of n as unsigned (negating INT64_MIN is undefined), bounded by the bytes left
+	uint64_t count = n < 0 ? uint64_t(0) - uint64_t(n) : uint64_t(n);
+	if(count > uint64_t(end - p) / sizeof(uint64_t))
+		throw std::runtime_error("corrupted rational data");
+
+	mpz_t m;
+	mpz_init(m);
+	mpz_import(m, count, -1, sizeof(uint64_t), 0, 0, p);	// no alignment requirement
+	if(n < 0)
+		mpz_neg(m, m);
+	p += count * sizeof(uint64_t);
+
+	mppp::integer<1> z(m);
+	mpz_clear(m);
+	return z;
+}
+
+template<typename To, typename From>
+inline To convert(const From& x) {
+	if constexpr (std::is_same<To, From>::value)	return x;
+	else if constexpr (std::is_same<From, rat>::value)	return To(to_double(x));
+	else												return To(x);
+}
+
+// Reads the elements stored as From, converting them to eT
+template<typename eT, typename From>
+Mat<eT> read_elems(const MatHeader& h, const char* data) {
+	// a rat takes at least the two limb counts
+	const bool is_rat = std::is_same<From, rat>::value;
+	uint64_t n = checked_elems(h, is_rat ? 2 * sizeof(int64_t) : sizeof(From), !is_rat);
+	Mat<eT> M(h.row_major ? h.n_cols : h.n_rows, h.row_major ? h.n_rows : h.n_cols);
+
+	if constexpr (std::is_same<From, rat>::value) {
+		const char *p = data, *end = data + h.data_bytes;
+		for(uint64_t i = 0; i < n; i++) {
+			mppp::integer<1> num = read_integer(p, end);
+			mppp::integer<1> den = read_integer(p, end);
+			M(i) = convert<eT>(rat(num, den));
+		}
+	} else {
+		const From* src = reinterpret_cast<const From*>(data);
+		for(uint64_t i = 0; i < n; i++)
+			M(i) = convert<eT>(src[i]);
+	}
+
+	if(h.row_major)
+		M = M.t().eval();
+	return M;
+}
+
+} // namespace aux
+
+// Writes M to filename (column-major)
+//
+template<typename eT>
+void save(const std::string& filename, const Mat<eT>& M) {
+	std::ofstream file(filename, std::ios::binary);
+	if(!file)
+		throw std::runtime_error("cannot open " + filename);
+
+	if constexpr (std::is_same<eT, rat>::value) {
+		std::vector<char> buf;
+		for(uint i = 0; i < M.n_elem; i++) {
+			aux::write_integer(buf, M(i).get_num());
+			aux::write_integer(buf, M(i).get_den());
+		}
+		aux::MatHeader h = aux::make_header(aux::elem_code<eT>(), false, M.n_rows, M.n_cols, buf.size());
+		file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		file.write(buf.data(), buf.size());
+
+	} else {
+		aux::MatHeader h = aux::make_header(aux::elem_code<eT>(), false, M.n_rows, M.n_cols, uint64_t(M.n_elem) * sizeof(eT));
+		file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		file.write(reinterpret_cast<const char*>(M.memptr()), M.n_elem * sizeof(eT));
+	}
+
+	if(!file)
+		throw std::runtime_error("cannot write " + filename);
+}
+
+// element type stored in filename (1: double, 2: float, 3: rat)
+//
+inline
+uint32_t elem_type(const std::string& filename) {
+	return aux::read_header(MappedFile(filename), filename).elem;
+}
+
+// Reads a matrix from filename into a new Mat, converting from the stored element type if needed (rat to floating
+// conversions are inexact). Also reads the row-major files written by channel::write_mapped.
+//
+template<typename eT>
+Mat<eT> load(const std::string& filename) {
+	MappedFile file(filename);
+	aux::MatHeader h = aux::read_header(file, filename);
+	const char* data = file.begin() + sizeof(h);
+
+	switch(h.elem) {
+		case 1:  return aux::read_elems<eT, double>(h, data);
+		case 2:  return aux::read_elems<eT, float>(h, data);
+		default: return aux::read_elems<eT, rat>(h, data);
+	}
+}
+
+// Zero-copy loading of a column-major floating matrix: *M is a read-only armadillo view of the mapped file, valid for
+// the lifetime of M (which is neither copyable nor movable). The element type must match the stored one.
+//
+template<typename eT>
+class Mapped {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+
+	private:
+		MappedFile file;
+		const Mat<eT> mat;
+
+		static const Mat<eT> view(const MappedFile& file, const std::string& filename) {
+			aux::MatHeader h = aux::read_header(file, filename);
+			if(h.elem != aux::elem_code<eT>() || h.row_major)
+				throw std::runtime_error(filename + ": not a column-major matrix of this element type");
+			try {
+				aux::checked_elems(h, sizeof(eT), true);
+			} catch(std::runtime_error&) {
+				throw std::runtime_error(filename + ": invalid size");
+			}
+
+			eT* data = reinterpret_cast<eT*>(const_cast<char*>(file.begin() + sizeof(h)));
+			return Mat<eT>(data, h.n_rows, h.n_cols, false, true);
+		}
+
+	public:
+		explicit Mapped(const std::string& filename) : file(filename), mat(view(file, filename)) {}
+
+		Mapped(const Mapped&) = delete;
+		Mapped& operator=(const Mapped&) = delete;
+
+		inline const Mat<eT>& operator*() const { return mat; }
+		inline const Mat<eT>* operator->() const { return &mat; }
+};
+
+} // namespace binary
@@ -6,7 +6,18 @@ namespace channel {
 template<typename eT = eT_def>
 inline
 void normalize(Mat<eT>& C) {
-	C.each_col() /= arma::sum(C, 1);
+	if constexpr (std::is_same<eT, accum_t<eT>>::value) {
+		C.each_col() /= arma::sum(C, 1);
+	} else {
+		// row sums in double, accumulated column by column
+		Col<accum_t<eT>> sums(C.n_rows, arma::fill::zeros);
+		for(uint y = 0; y < C.n_cols; y++) {
+			const eT* col = C.colptr(y);
+			for(uint x = 0; x < C.n_rows; x++)
+				sums.at(x) += col[x];
+		}
+		C.each_col() /= arma::conv_to<Col<eT>>::from(sums);
+	}
 }
 
 template<typename eT = eT_def>
@@ -83,6 +94,54 @@ Chan<eT> deterministic(std::function<uint(uint)> map, uint n_rows, uint n_cols)
 	return C;
 }
 
+// sparse version, constructs the channel directly in sparse form
+template<typename eT = eT_def>
+inline
+SpChan<eT> deterministic_sparse(arma::ucolvec map, uint n_cols) {
+	arma::umat locations(2, map.n_rows);
+	for(uint i = 0; i < map.n_rows; i++) {
+		locations(0, i) = i;
+		locations(1, i) = map(i);
+	}
+	Col<eT> values(map.n_rows);
+	values.fill(eT(1));
+	return SpChan<eT>(locations, values, map.n_rows, n_cols);
+}
+
+// C * deterministic(map, n_cols), ie C post-processed by map, without the matrix product: column y of C is added to
+// column map(y) of the result
+template<typename eT = eT_def>
+inline
+Chan<eT> remap(const Chan<eT>& C, const arma::ucolvec& map, uint n_cols) {
+	if(map.n_elem != C.n_cols)
+		throw std::runtime_error("invalid map size");
+
+	Chan<eT> res(C.n_rows, n_cols, arma::fill::zeros);
+	for(uint y = 0; y < C.n_cols; y++) {
+		if(map(y) >= n_cols)
+			throw std::runtime_error("map value out of range");
+		res.col(map(y)) += C.col(y);
+	}
+	return res;
+}
+
+// builds a sparse matrix with the same non-zero positions as C, with each element C(i,j)
+// replaced by f(i, j, C(i,j)). Elements mapped to zero are removed.
+//
+template<typename eT, typename F>
+inline
+SpChan<eT> _sparse_transform(const SpChan<eT>& C, F f) {
+	arma::umat locations(2, C.n_nonzero);
+	Col<eT> values(C.n_nonzero);
+
+	uint k = 0;
+	for(auto it = C.begin(); it != C.end(); ++it, k++) {
+		locations(0, k) = it.row();
+		locations(1, k) = it.col();
+		values(k) = f(it.row(), it.col(), eT(*it));
+	}
+	return SpChan<eT>(locations, values, C.n_rows, C.n_cols);
+}
 
 template<typename eT = eT_def>
 inline
@@ -110,6 +169,41 @@ void check_prior_size(const Prob<eT>& pi, const Chan<eT>& C) {
 		throw std::runtime_error("invalid prior size");
 }
 
+template<typename eT = eT_def>
+inline
+void check_prior_size(const Prob<eT>& pi, const SpChan<eT>& C) {
+	if(C.n_rows != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+namespace aux {
+
+// channels of at most small_size x small_size are evaluated by measure kernels with compile-time bounds
+constexpr uint small_size = 3;
+
+template<uint N, uint M, typename F>
+bool with_small_size_from(uint n_rows, uint n_cols, F& f) {
+	if(n_rows == N && n_cols == M) {
+		f(std::integral_constant<uint, N>(), std::integral_constant<uint, M>());
+		return true;
+	}
+	if constexpr (M < small_size)
+		return with_small_size_from<N, M + 1>(n_rows, n_cols, f);
+	else if constexpr (N < small_size)
+		return with_small_size_from<N + 1, 1>(n_rows, n_cols, f);
+	else
+		return false;
+}
+
+// If n_rows, n_cols <= small_size, calls f(N, M) with std::integral_constant<uint> arguments (so f can instantiate
+// a kernel for the exact size) and returns true. Otherwise returns false without calling f.
+//
+template<typename F>
+bool with_small_size(uint n_rows, uint n_cols, F f) {
+	return n_rows > 0 && n_cols > 0 && n_rows <= small_size && n_cols <= small_size && with_small_size_from<1, 1>(n_rows, n_cols, f);
+}
+
+} // namespace aux
 
 template<typename eT = eT_def>
 inline bool equal(const Chan<eT>& A, const Chan<eT>& B, const eT& md = def_md<eT>, const eT& mrd = def_mrd<eT>) {
@@ -137,6 +231,34 @@ int compare_columns(const Mat<eT>& A, uint j1, uint j2) {
 	return 0;
 }
 
+// lexicographic order, for sparse matrices. Only the non-zero elements of the two columns are visited.
+template<typename eT = eT_def>
+int compare_columns(const SpChan<eT>& A, uint j1, uint j2) {
+	auto it1 = A.begin_col(j1), end1 = A.end_col(j1);
+	auto it2 = A.begin_col(j2), end2 = A.end_col(j2);
+	eT zero(0);
+
+	while(it1 != end1 || it2 != end2) {
+		// row of the next non-zero element of each column (n_rows if the column is exhausted)
+		uint r1 = it1 != end1 ? it1.row() : A.n_rows;
+		uint r2 = it2 != end2 ? it2.row() : A.n_rows;
+
+		// compare A(r,j1) to A(r,j2) for r = min(r1, r2). One of the two might be zero.
+		uint r = std::min(r1, r2);
+		eT v1 = r1 == r ? eT(*it1) : zero;
+		eT v2 = r2 == r ? eT(*it2) : zero;
+
+		if(less_than(v1, v2))
+			return -1;
+		else if(less_than(v2, v1))
+			return 1;
+
+		if(r1 == r) ++it1;
+		if(r2 == r) ++it2;
+	}
+	return 0;
+}
+
 
 // returns the posterior for a specific output y
 //
@@ -147,19 +269,96 @@ Prob<eT> posterior(const Chan<eT>& C, const Prob<eT>& pi, uint y) {
 }
 
 
+// replaces C by the posteriors produced by C and pi. Each column is turned into the joint and normalized while it is
+// in cache, in a single pass over C.
+//
+template<typename eT = eT_def>
+inline
+void posteriors_inplace(Mat<eT>& C, const Prob<eT>& pi = {}) {
+	if(!pi.is_empty())					// if pi is not given it is assumed to be uniform, so no need to multiply
+		check_prior_size(pi, C);
+
+	const eT* p = pi.is_empty() ? nullptr : pi.memptr();
+	for(uint y = 0; y < C.n_cols; y++) {
+		eT* col = C.colptr(y);
+		eT sum(0);
+		for(uint x = 0; x < C.n_rows; x++) {
+			if(p)
+				col[x] *= p[x];			// the joint
+			sum += col[x];
+		}
+		for(uint x = 0; x < C.n_rows; x++)
+			col[x] /= sum;				// normalized into the posterior
+	}
+}
+
 // returns all posteriors produced by C and pi. The returned matrix has the same
 // size as C, with each column being a posterior
 //
 template<typename eT = eT_def>
 inline
 Mat<eT> posteriors(const Chan<eT>& C, const Prob<eT>& pi = {}) {
-	Mat<eT>res = C;
-	if(!pi.is_empty())					// if pi is not given it is assumed to be uniform, so no need to multiply
-		res.each_col() %= pi.t();		// creates the joint
-	res.each_row() /= arma::sum(res);	// normalizes each column into the posterior
+	Mat<eT> res = C;
+	posteriors_inplace(res, pi);
 	return res;
 }
 
+// The posteriors of C and pi, computed one column at a time when requested, for when only some of them are needed
+// (or they are consumed one at a time) and the full n_rows x n_cols matrix should not be built. C and pi are not
+// copied, they should outlive the view.
+//
+template<typename eT = eT_def>
+class PosteriorView {
+	public:
+		uint n_rows, n_cols;
+
+		PosteriorView(const Chan<eT>& C, const Prob<eT>& pi) : n_rows(C.n_rows), n_cols(C.n_cols), C(C), pi(pi) {
+			check_prior_size(pi, C);
+		}
+
+		// probability of output y
+		eT outer(uint y) const {
+			if(y >= n_cols) throw std::runtime_error("column out of bounds");
+			return arma::dot(C.col(y), pi);
+		}
+
+		// the posterior of output y in res, without allocating if res already has the correct size
+		void col(uint y, Col<eT>& res) const {
+			if(y >= n_cols) throw std::runtime_error("column out of bounds");
+			res = C.col(y) % pi.t();
+			res /= arma::accu(res);
+		}
+
+		Col<eT> col(uint y) const {
+			Col<eT> res;
+			col(y, res);
+			return res;
+		}
+
+		Mat<eT> materialize() const {
+			return posteriors(C, pi);
+		}
+
+	private:
+		const Chan<eT>& C;
+		const Prob<eT>& pi;
+};
+
+
+// sparse version, the returned posteriors are also sparse
+//
+template<typename eT = eT_def>
+inline
+SpChan<eT> posteriors(const SpChan<eT>& C, const Prob<eT>& pi = {}) {
+	// joint (if pi is not given it is assumed to be uniform, so no need to multiply)
+	SpChan<eT> J = pi.is_empty() ? C : _sparse_transform(C, [&](uint x, uint, const eT& v) { return pi(x) * v; });
+
+	Row<eT> out = arma::zeros<Row<eT>>(J.n_cols);
+	for(auto it = J.begin(); it != J.end(); ++it)
+		out(it.col()) += *it;
+
+	return _sparse_transform(J, [&](uint, uint y, const eT& v) { return v / out(y); });
+}
 
 
 // returns the hyper produced by C and pi
@@ -168,15 +367,22 @@ Mat<eT> posteriors(const Chan<eT>& C, const Prob<eT>& pi = {}) {
 template<typename eT = eT_def>
 inline
 std::pair<Prob<eT>,Mat<eT>> hyper(const Chan<eT>& C, const Prob<eT>& pi) {
-	Prob<eT> outer = pi * C;
-	Mat<eT> inners = C;
+	QIF_TRACE_SPAN("channel::hyper");
+	Prob<eT> out = pi * C;
 
-	// remove zero probability columns
-	for(int i = outer.n_elem - 1; i >= 0; i--)	// inverse order to avoid changing the index
-		if(qif::equal(outer(i), eT(0))) {
-			inners.shed_col(i);
-			outer.shed_col(i);
-		}
+	// the index vectors are temporaries, from the current workspace if any
+	workspace::Frame frame;
+	workspace::Buffer<arma::uword> keep_buf(C.n_cols), sorted_buf(C.n_cols);
+
+	// remove zero probability columns (in a single pass, keeping their order)
+	uint n = 0;
+	for(uint y = 0; y < C.n_cols; y++)
+		if(!qif::equal(out(y), eT(0)))
+			keep_buf.memptr()[n++] = y;
+	const arma::uvec keep = keep_buf.col(n);
+
+	Prob<eT> outer = out.cols(keep);
+	Mat<eT> inners = C.cols(keep);
 
 	inners.each_col() %= pi.t();	// creates the joint
 	inners.each_row() /= outer;		// normalizes each column into the posterior
@@ -185,7 +391,9 @@ std::pair<Prob<eT>,Mat<eT>> hyper(const Chan<eT>& C, const Prob<eT>& pi) {
 	// we first sort cols in lexicographic order. Then move the outer probability
 	// of equal columns, and finally delete cols of zero probability
 	//
-	auto sorted = arma::linspace<arma::urowvec>(0, inners.n_cols-1, inners.n_cols);
+	arma::urowvec sorted = sorted_buf.row(n);
+	for(uint i = 0; i < n; i++)
+		sorted(i) = i;
     std::sort(sorted.begin(), sorted.end(), [&inners](uint a, uint b) {
 		return compare_columns(inners, a, b) == -1;		// a < b
     });
@@ -203,56 +411,645 @@ std::pair<Prob<eT>,Mat<eT>> hyper(const Chan<eT>& C, const Prob<eT>& pi) {
 	return { outer, inners };
 }
 
+// sparse version. Contrary to the dense one, columns that are merged with an equal one are removed from the result.
+//
+template<typename eT = eT_def>
+inline
+std::pair<Prob<eT>,SpChan<eT>> hyper(const SpChan<eT>& C, const Prob<eT>& pi) {
+	QIF_TRACE_SPAN("channel::hyper");
+	check_prior_size(pi, C);
+
+	SpChan<eT> post = posteriors(C, pi);
+
+	Prob<eT> out = arma::zeros<Prob<eT>>(C.n_cols);
+	for(auto it = C.begin(); it != C.end(); ++it)
+		out(it.col()) += pi(it.row()) * eT(*it);
+
+	// sort non-zero probability cols in lexicographic order, and merge equal ones
+	std::vector<uint> sorted;
+	for(uint y = 0; y < C.n_cols; y++)
+		if(!qif::equal(out(y), eT(0)))
+			sorted.push_back(y);
+
+	// stable, so the first (in the original order) of equal cols is kept
+	std::stable_sort(sorted.begin(), sorted.end(), [&post](uint a, uint b) {
+		return compare_columns(post, a, b) == -1;		// a < b
+	});
+
+	std::vector<uint> kept;
+	for(uint i = 0; i < sorted.size(); i++) {
+		uint col = sorted[i];
+		if(!kept.empty() && compare_columns(post, kept.back(), col) == 0)
+			out(kept.back()) += out(col);
+		else
+			kept.push_back(col);
+	}
+	std::sort(kept.begin(), kept.end());	// keep the original order of columns
+
+	// build the result from the kept columns
+	uint nnz = 0;
+	for(uint y : kept)
+		nnz += post.col_ptrs[y+1] - post.col_ptrs[y];
+
+	arma::umat locations(2, nnz);
+	Col<eT> values(nnz);
+	Prob<eT> outer(kept.size());
+
+	uint k = 0;
+	for(uint j = 0; j < kept.size(); j++) {
+		outer(j) = out(kept[j]);
+		for(auto it = post.begin_col(kept[j]); it != post.end_col(kept[j]); ++it, k++) {
+			locations(0, k) = it.row();
+			locations(1, k) = j;
+			values(k) = *it;
+		}
+	}
+
+	return { outer, SpChan<eT>(locations, values, C.n_rows, kept.size()) };
+}
+
+
+// A hyper-distribution in compact form: outer(j) is the probability of the inner (posterior) inners.col(j).
+// All inners are distinct and have non-zero probability.
+//
+template<typename eT = eT_def>
+struct Hyper {
+	Prob<eT> outer;
+	Mat<eT> inners;
+};
 
-// returns the reduced form of the channel
+// hash of column j of M, with elements quantised to multiples of quantum (values are first converted to double, so
+// that equal rats have equal hashes)
+//
+template<typename eT>
+inline
+size_t _column_hash(const Mat<eT>& M, uint j, double quantum) {
+	size_t h = 0;
+	for(uint i = 0; i < M.n_rows; i++) {
+		long long q = std::llround(double(M(i, j)) / quantum);
+		h ^= std::hash<long long>()(q) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	}
+	return h;
+}
+
+// Same as hyper, but builds the result in a single pass over C's columns, without sorting. The posterior of each
+// column is bucketed by a hash of its quantised values, and only compared (with tolerance) against the inners
+// in the same bucket, so the cost is O(n_rows * n_cols) on average. Equal inners are merged and zero-probability
+// ones dropped, inners are kept in the order of their first appearance in C.
+//
+// Values that are equal within tolerance but fall on different sides of a quantisation boundary might end up in
+// different buckets, in which case the two inners are not merged. The result is still a correct representation of
+// the same hyper (just not fully reduced).
+//
+// If inner_of is given, (*inner_of)(y) is set to the inner of column y (or to the largest uword for zero-probability
+// columns).
 //
 template<typename eT = eT_def>
 inline
-Chan<eT> reduced(const Chan<eT>& C) {
-	// compute via a hyper constructed on a uniform prior
-	auto [outer, R] = channel::hyper(C, probab::uniform<eT>(C.n_rows));
-	R.each_row() %= outer;
-	normalize(R);
+Hyper<eT> hyper_compact(const Chan<eT>& C, const Prob<eT>& pi, double quantum = 1e-6, arma::uvec* inner_of = nullptr) {
+	QIF_TRACE_SPAN("channel::hyper_compact");
+	check_prior_size(pi, C);
+	if(inner_of)
+		inner_of->set_size(C.n_cols).fill(std::numeric_limits<arma::uword>::max());
+
+	Prob<eT> out = pi * C;
+
+	Hyper<eT> res;
+	res.outer.set_size(C.n_cols);
+	res.inners.set_size(C.n_rows, C.n_cols);		// upper bound, shrinked at the end
+
+	std::unordered_map<size_t, std::vector<uint>> buckets;		// hash => inners with that hash
+	uint k = 0;													// number of distinct inners so far
+
+	for(uint y = 0; y < C.n_cols; y++) {
+		if(qif::equal(out(y), eT(0)))
+			continue;
+
+		// write the posterior in the next free column, it's kept only if it's new
+		res.inners.col(k) = (C.col(y) % pi.t()) / out(y);
+
+		std::vector<uint>& bucket = buckets[_column_hash(res.inners, k, quantum)];
+		bool found = false;
+		for(uint j : bucket) {
+			if(compare_columns(res.inners, j, k) == 0) {
+				res.outer(j) += out(y);
+				if(inner_of)
+					(*inner_of)(y) = j;
+				found = true;
+				break;
+			}
+		}
+		if(!found) {
+			bucket.push_back(k);
+			if(inner_of)
+				(*inner_of)(y) = k;
+			res.outer(k++) = out(y);
+		}
+	}
+
+	res.outer.resize(k);
+	res.inners.resize(C.n_rows, k);
+	return res;
+}
+
+
+// returns the reduced form of the channel: all-zero columns are removed and proportional ones are merged (summed),
+// the remaining columns are kept in the order of their first appearance in C.
+//
+// Done directly in a single pass over the columns, as in hyper_compact: each normalized column is bucketed by a hash
+// of its quantised values and compared (with tolerance) only against the kept columns of the same bucket. The same
+// caveat applies, columns falling on different sides of a quantisation boundary are not merged.
+//
+template<typename eT = eT_def>
+inline
+Chan<eT> reduced(const Chan<eT>& C, double quantum = 1e-6) {
+	QIF_TRACE_SPAN("channel::reduced");
+
+	Mat<eT> normalized(C.n_rows, C.n_cols);		// normalized kept columns, shrinked at the end
+	Row<eT> mass(C.n_cols);						// the sum of the columns merged into each kept one
+
+	std::unordered_map<size_t, std::vector<uint>> buckets;
+	uint k = 0;
+	for(uint y = 0; y < C.n_cols; y++) {
+		eT sum = arma::accu(C.col(y));
+		if(qif::equal(sum, eT(0)))
+			continue;
+
+		normalized.col(k) = C.col(y) / sum;
+		std::vector<uint>& bucket = buckets[_column_hash(normalized, k, quantum)];
+		auto found = std::find_if(bucket.begin(), bucket.end(), [&](uint j) { return compare_columns(normalized, j, k) == 0; });
+		if(found != bucket.end()) {
+			mass(*found) += sum;
+		} else {
+			bucket.push_back(k);
+			mass(k++) = sum;
+		}
+	}
+
+	if(k == 0)
+		return Chan<eT>(C.n_rows, 0);
+	Chan<eT> R = normalized.cols(0, k-1);
+	R.each_row() %= mass.cols(0, k-1);
 	return R;
 }
 
 
-// returns the prior estimate produced by C, given observed output distribution out
+// The result of coarsen: the channel C' = C R, R being the deterministic channel that merges each output y of C into
+// output cluster(y) of C'. Since C' is a post-processing of C, V_g[pi, C'] <= V_g[pi, C] for every gain function, and
+// V_g[pi, C] - V_g[pi, C'] <= g_vuln_bound(G). Both error and max_radius are total variation distances between the
+// posteriors of C and the merged posterior of their cluster (for outputs of non-zero probability).
+//
+template<typename eT = eT_def>
+struct Coarsening {
+	Chan<eT> C;
+	arma::uvec cluster;
+	eT error = eT(0);			// sum_y p(y) tv(post_y, post'_cluster(y)), the bound for the Bayes vulnerability
+	eT max_radius = eT(0);		// max_y tv(post_y, post'_cluster(y))
+
+	// V_g(post) is max_w G.row(w) post^T, a maximum of functions that are Lipschitz wrt the total variation distance,
+	// with constant the range max_x G(w,x) - min_x G(w,x) of the guess
+	eT g_vuln_bound(const Mat<eT>& G) const {
+		eT range(0);
+		for(uint w = 0; w < G.n_rows; w++)
+			range = std::max(range, eT(G.row(w).max() - G.row(w).min()));
+		return error * range;
+	}
+};
+
+namespace aux {
+
+// Weighted k-means (Lloyd's algorithm, k-means++ seeding) of the columns of P, returns the cluster of each column.
+// Distances are computed blockwise as ||p||^2 - 2 p.c + ||c||^2, the blocks in parallel.
+//
+inline
+arma::uvec kmeans(const Mat<double>& P, const Row<double>& weight, uint k, uint max_iter, uint64_t seed) {
+	const uint n = P.n_cols, block = 4096;
+	const Row<double> sq_norms = arma::sum(arma::square(P), 0);
+	rng::Engine gen = rng::stream(seed, 0);
+
+	// samples a column with probability proportional to score
+	auto sample = [&](const Row<double>& score) {
+		double r = rng::randu<double>(gen) * arma::accu(score);
+		for(uint j = 0; j < n; j++)
+			if((r -= score(j)) < 0)
+				return j;
+		return uint(arma::index_max(score));
+	};
+
+	// k-means++: each new center is a column chosen with probability proportional to weight * (distance to the closest center)^2
+	Mat<double> centers(P.n_rows, k);
+	Row<double> dist(n);
+	centers.col(0) = P.col(sample(weight));
+	dist = arma::sum(arma::square(P.each_col() - centers.col(0)), 0);
+	for(uint c = 1; c < k; c++) {
+		centers.col(c) = P.col(sample(weight % dist));
+		dist = arma::min(dist, arma::sum(arma::square(P.each_col() - centers.col(c)), 0));
+	}
+
+	arma::uvec cluster(n, arma::fill::zeros);
+	for(uint iter = 0; iter < max_iter; iter++) {
+		// assignment, blocks are independent
+		const Row<double> c_norms = arma::sum(arma::square(centers), 0);
+		std::atomic<bool> changed(false);
+
+		parallel::for_each((n + block - 1) / block, [&](uint b) {
+			uint first = b * block, last = std::min(n, first + block);
+			Mat<double> D = -2 * P.cols(first, last - 1).t() * centers;
+			D.each_row() += c_norms;
+			for(uint j = first; j < last; j++) {
+				uint c = arma::index_min(D.row(j - first));
+				dist(j) = std::max(0.0, D(j - first, c) + sq_norms(j));
+				if(c != cluster(j) || iter == 0) {
+					cluster(j) = c;
+					changed = true;
+				}
+			}
+		});
+		if(!changed)
+			break;
+
+		// update, each center is the weighted mean of its columns (the merged posterior). An empty cluster gets the
+		// column contributing most to the objective.
+		Mat<double> sums(P.n_rows, k, arma::fill::zeros);
+		Row<double> mass(k, arma::fill::zeros);
+		for(uint j = 0; j < n; j++) {
+			sums.col(cluster(j)) += weight(j) * P.col(j);
+			mass(cluster(j)) += weight(j);
+		}
+		for(uint c = 0; c < k; c++) {
+			if(mass(c) > 0) {
+				centers.col(c) = sums.col(c) / mass(c);
+			} else {
+				uint j = arma::index_max(weight % dist);
+				centers.col(c) = P.col(j);
+				dist(j) = 0;
+			}
+		}
+	}
+	return cluster;
+}
+
+// Grid quantisation of the columns of P: columns in the same cell of side quantum get the same cluster. The quantum
+// is doubled (starting from 1/k) until there are at most k non-empty cells.
+//
+inline
+arma::uvec grid_clusters(const Mat<double>& P, uint k) {
+	arma::uvec cluster(P.n_cols);
+	for(double quantum = 1.0 / k; ; quantum *= 2) {
+		std::map<std::vector<long long>, uint> cells;
+		std::vector<long long> key(P.n_rows);
+		for(uint j = 0; j < P.n_cols && cells.size() <= k; j++) {
+			for(uint i = 0; i < P.n_rows; i++)
+				key[i] = std::llround(P(i, j) / quantum);
+			cluster(j) = cells.emplace(key, cells.size()).first->second;
+		}
+		if(cells.size() <= k)
+			return cluster;
+	}
+}
+
+} // namespace aux
+
+// Lossy version of reduced: merges the outputs of C with close posteriors (under pi) into (at most) n_cols outputs,
+// so that programs and metrics on the result work on a much smaller channel. The error introduced is certified, see
+// Coarsening.
+//
+// method: "kmeans" (weighted k-means of the posteriors, the weight of each being its output probability, with at
+// most max_iter iterations and seeding from seed), or "grid" (posteriors quantised to a grid, coarser and faster).
+// The clustering is computed in double, the result (and its bounds) in eT. Outputs of probability exactly 0 are
+// merged into the first cluster (they carry no mass, so they do not affect the bounds), all others are clustered,
+// however small.
 //
 template<typename eT = eT_def>
 inline
-std::pair<Prob<eT>, uint> iterative_bayesian_update(const Chan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0) {
-	eT almost_zero(1e-6);
+Coarsening<eT> coarsen(const Chan<eT>& C, const Prob<eT>& pi, uint n_cols, const std::string& method = "kmeans", uint max_iter = 100, uint64_t seed = 0) {
+	QIF_TRACE_SPAN("channel::coarsen");
+	check_prior_size(pi, C);
+	if(n_cols == 0)
+		throw std::runtime_error("n_cols should be positive");
+	if(method != "kmeans" && method != "grid")
+		throw std::runtime_error("unknown method: " + method);
+
+	// posteriors of the non-zero probability outputs, in double
+	Prob<eT> out = pi * C;
+	std::vector<uint> kept;
+	for(uint y = 0; y < C.n_cols; y++)
+		if(out(y) != eT(0))
+			kept.push_back(y);
+
+	Mat<double> P(C.n_rows, kept.size());
+	Row<double> weight(kept.size());
+	for(uint j = 0; j < kept.size(); j++) {
+		weight(j) = double(out(kept[j]));
+		for(uint x = 0; x < C.n_rows; x++)
+			P(x, j) = double(pi(x) * C(x, kept[j]) / out(kept[j]));
+	}
+
+	arma::uvec kept_cluster(kept.size());
+	if(kept.size() <= n_cols) {
+		for(uint j = 0; j < kept.size(); j++)
+			kept_cluster(j) = j;
+	} else
+		kept_cluster = method == "grid" ? aux::grid_clusters(P, n_cols) : aux::kmeans(P, weight, n_cols, max_iter, seed);
+
+	// number the non-empty clusters by their first output
+	Coarsening<eT> res;
+	res.cluster.zeros(C.n_cols);
+	std::vector<uint> renumber(C.n_cols, std::numeric_limits<uint>::max());
+	uint k = 0;
+	for(uint j = 0; j < kept.size(); j++) {
+		uint& c = renumber[kept_cluster(j)];
+		if(c == std::numeric_limits<uint>::max())
+			c = k++;
+		res.cluster(kept[j]) = c;
+	}
+	k = std::max(k, 1u);
+
+	res.C.zeros(C.n_rows, k);
+	for(uint y = 0; y < C.n_cols; y++)
+		res.C.col(res.cluster(y)) += C.col(y);
+
+	// the error: distance between each posterior and the merged one, both exactly in eT
+	Prob<eT> out2 = pi * res.C;
+	Mat<eT> merged = res.C;
+	merged.each_col() %= pi.t();
+	for(uint c = 0; c < k; c++)
+		if(out2(c) != eT(0))
+			merged.col(c) /= out2(c);
+
+	for(uint y : kept) {
+		uint c = res.cluster(y);
+		eT tv = arma::accu(arma::abs(Col<eT>(C.col(y) % pi.t()) / out(y) - merged.col(c))) / eT(2);
+		res.error += out(y) * tv;
+		res.max_radius = std::max(res.max_radius, tv);
+	}
+	return res;
+}
+
+// A channel given only by its products with vectors: left(pi, res) computes res = pi C (1 x n_cols) and
+// right(w, res) computes res = (C w^T)^T (1 x n_rows). This is all iterative_bayesian_update needs, and structured
+// channels have much faster products than dense ones (see mechanism::d_privacy::randomized_response_operator).
+//
+template<typename eT>
+struct OperatorChan {
+	typedef std::function<void(const Row<eT>&, Row<eT>&)> Product;
+
+	uint n_rows, n_cols;
+	Product left, right;
+};
+
+// State of iterative_bayesian_update, for checkpointing (see checkpoint.h)
+//
+template<typename eT>
+struct IbuState {
+	typedef eT elem_type;
+
+	Prob<eT> pi;
+	uint count = 0;						// EM steps done
+
+	Col<eT> pack() const {
+		return checkpoint::Writer<eT>().put(pi).put(count).col();
+	}
+	static IbuState unpack(const Mat<eT>& data) {
+		IbuState s;
+		checkpoint::Reader<eT>(data).get(s.pi).get(s.count);
+		return s;
+	}
+};
+
+namespace aux {
+
+template<typename eT>
+inline void left_mul(const Chan<eT>& C, const Row<eT>& pi, Row<eT>& res)			{ res = pi * C; }
+template<typename eT>
+inline void left_mul(const SpChan<eT>& C, const Row<eT>& pi, Row<eT>& res)			{ res = pi * C; }
+template<typename eT>
+inline void left_mul(const OperatorChan<eT>& C, const Row<eT>& pi, Row<eT>& res)	{ C.left(pi, res); }
+
+template<typename eT>
+inline void right_mul(const Chan<eT>& C, const Row<eT>& w, Row<eT>& res)			{ res = (C * w.t()).t(); }
+template<typename eT>
+inline void right_mul(const SpChan<eT>& C, const Row<eT>& w, Row<eT>& res)			{ res = Col<eT>(C * w.t()).t(); }
+template<typename eT>
+inline void right_mul(const OperatorChan<eT>& C, const Row<eT>& w, Row<eT>& res)	{ C.right(w, res); }
+
+// One EM step res = pi % (C (out / pi C)^T)^T, using buf for the intermediate output. If loglik is given, the
+// log-likelihood sum_y out_y log (pi C)_y of pi is stored there (floating types only).
+//
+template<typename eT, typename CT>
+void ibu_step(const CT& C, const Prob<eT>& out, const Prob<eT>& pi, Prob<eT>& res, Row<eT>& buf, eT* loglik = nullptr) {
+	// out_cur[i] == 0 implies out[i] == 0. Since we want to have out[i]/out_cur[i] = 0
+	// in such cases, we use out_cur[i] = 1 to avoid NaNs.
+	const eT almost_zero(1e-6);
+
+	left_mul(C, pi, buf);
+	if constexpr (std::is_floating_point<eT>::value) {
+		if(loglik) {
+			*loglik = 0;
+			for(uint y = 0; y < buf.n_elem; y++)
+				if(out(y) > 0)
+					*loglik += out(y) * std::log(std::max(buf(y), std::numeric_limits<eT>::min()));
+		}
+	}
+	for(uint y = 0; y < buf.n_elem; y++)
+		buf(y) = buf(y) < almost_zero ? out(y) : eT(out(y) / buf(y));
 
+	right_mul(C, buf, res);
+	res %= pi;
+}
+
+template<typename eT>
+eT diff_norm1(const Prob<eT>& a, const Prob<eT>& b) {
+	eT res(0);
+	for(uint i = 0; i < a.n_elem; i++)
+		res += a(i) < b(i) ? eT(b(i) - a(i)) : eT(a(i) - b(i));
+	return res;
+}
+
+template<typename eT, typename CT>
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const CT& C, const Prob<eT>& out, const Prob<eT>& start, eT max_diff, uint max_reps, const std::string& method,
+	const checkpoint::Hook<IbuState<eT>>& hook) {
 	Prob<eT> pi = start.is_empty() ? probab::uniform<eT>(C.n_rows) : start;
+	uint done = 0;
+	if(hook.resume) {
+		pi = hook.resume->pi;
+		done = hook.resume->count;
+	}
 
 	if(C.n_rows != pi.n_cols || C.n_cols != out.n_cols)
 		throw std::runtime_error("invalid sizes");
 
-	for(uint count = 1; ; count++) {
-		// out_cur[i] == 0 implies out[i] == 0. Since we want to have out[i]/out_cur[i] = 0
-		// in such cases, we change change out_cur[i] to 1 to avoid NaNs.
-		arma::Row<eT> out_cur = pi * C;
+	Prob<eT> pi1(C.n_rows), pi2(C.n_rows);
+	Row<eT> buf(C.n_cols);
+
+	uint last_save = done;
+	auto save = [&](uint count) {
+		if(hook.due(count, last_save))
+			hook.save({ pi, count });
+	};
+	// the final estimate is always saved, so that a run stopped by max_reps can be continued
+	auto finish = [&](uint count) -> std::pair<Prob<eT>, uint> {
+		if(hook.every > 0 && hook.save && count != last_save)
+			hook.save({ pi, count });
+		return { pi, count };
+	};
+
+	if(max_reps > 0 && done >= max_reps)
+		return { pi, done };			// resumed from a state past max_reps
+
+	if(method == "em") {
+		for(uint count = done + 1; ; count++) {
+			save(count - 1);
+			ibu_step(C, out, pi, pi1, buf);
+			eT diff = diff_norm1(pi, pi1);
+			pi.swap(pi1);
+
+			if(diff <= max_diff || (max_reps > 0 && count >= max_reps))
+				return finish(count);
+		}
 
-		if constexpr (std::is_same<eT, rat>::value) {
-			// for rat we need to do it in two steps
-			arma::Row<arma::uword> indices = out_cur < almost_zero;
-			out_cur.elem( find(indices) ).ones();
+	} else if(method == "squarem") {
+		if constexpr (!std::is_floating_point<eT>::value) {
+			throw std::runtime_error("squarem is only available for floating types");
 		} else {
-			out_cur.elem( find(out_cur < almost_zero) ).ones();
-		}
+			// SQUAREM (Varadhan and Roland, Scand. J. Statist. 2008), scheme S3: from two EM steps pi -> pi1 -> pi2,
+			// r = pi1 - pi, v = pi2 - pi1 - r, extrapolate to pi - 2 a r + a^2 v with a = -|r|/|v| (a = -1 gives pi2),
+			// shortening the step if needed to stay in the simplex, then do a stabilizing EM step. If the extrapolated point has a lower likelihood
+			// than pi1 we step back to pi2, so the likelihood never decreases (as in EM).
+			Prob<eT> r(C.n_rows), v(C.n_rows);
+			eT loglik1, loglik_ext;
+
+			for(uint count = done; ; ) {
+				save(count);
+				ibu_step(C, out, pi, pi1, buf);
+				ibu_step(C, out, pi1, pi2, buf, &loglik1);
+				count += 2;
+
+				r = pi1 - pi;
+				v = pi2 - pi1 - r;
+				eT nr = arma::norm(r), nv = arma::norm(v);
+				if(nv > eT(0)) {
+					// if the extrapolation leaves the simplex, move a towards -1 (which gives pi2, inside the simplex)
+					eT a = std::min(eT(-1), -nr / nv);
+					for(;;) {
+						pi1 = pi + eT(-2) * a * r + a * a * v;
+						if(a == eT(-1) || pi1.min() >= eT(0))
+							break;
+						a = (a - eT(1)) / eT(2);
+						if(a > eT(-1.01))
+							a = eT(-1);
+					}
+					pi1.transform([](eT p) { return std::max(p, eT(0)); });		// rounding errors at a = -1
+					pi = pi1 / arma::accu(pi1);
+				} else {
+					pi = pi2;
+				}
+
+				ibu_step(C, out, pi, pi1, buf, &loglik_ext);
+				count++;
+				if(loglik_ext < loglik1) {
+					pi = pi2;
+					ibu_step(C, out, pi, pi1, buf);
+					count++;
+				}
 
-		Prob<eT> new_pi = pi % trans(C * trans(out / out_cur));
+				eT diff = diff_norm1(pi, pi1);
+				pi.swap(pi1);
 
-		pi -= new_pi;
-		eT diff = qif::norm1(pi);
-		pi = new_pi;
+				if(diff <= max_diff || (max_reps > 0 && count >= max_reps))
+					return finish(count);
+			}
+		}
 
-		if(diff <= max_diff || count == max_reps)
-			return { pi, count };
+	} else {
+		throw std::runtime_error("unknown method " + method);
 	}
 }
 
+} // namespace aux
+
+// Returns the prior estimate produced by C, given observed output distribution out, and the number of EM steps
+// performed. Starts from start (uniform if empty) and stops when an EM step changes the estimate by at most max_diff
+// (l1), or after max_reps steps (0 for no limit).
+//
+// method "em" is plain EM, "squarem" (floating types) accelerates it by extrapolating along the last two steps, which
+// typically needs an order of magnitude fewer steps on channels with slow convergence (eg large randomized_response
+// or geometric). The sparse and operator versions only use products of C with vectors, so large structured channels
+// need not be stored densely.
+//
+// hook saves and restores the estimate and the number of steps (see checkpoint.h), resume takes precedence over start
+// and max_reps counts also the steps done before resuming.
+//
+template<typename eT = eT_def>
+inline
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const Chan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0, const std::string& method = "em",
+	const checkpoint::Hook<IbuState<eT>>& hook = {}) {
+	return aux::iterative_bayesian_update(C, out, start, max_diff, max_reps, method, hook);
+}
+
+template<typename eT = eT_def>
+inline
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const SpChan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0, const std::string& method = "em",
+	const checkpoint::Hook<IbuState<eT>>& hook = {}) {
+	return aux::iterative_bayesian_update(C, out, start, max_diff, max_reps, method, hook);
+}
+
+template<typename eT = eT_def>
+inline
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const OperatorChan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0, const std::string& method = "em",
+	const checkpoint::Hook<IbuState<eT>>& hook = {}) {
+	return aux::iterative_bayesian_update(C, out, start, max_diff, max_reps, method, hook);
+}
+
+// Estimate of the prior from reports that arrive over time. add() accumulates the observed counts of each output, and
+// estimate() runs iterative_bayesian_update on the current histogram warm-started from the previous estimate, so after
+// a few new reports only a few steps are needed.
+//
+template<typename eT, typename CT = Chan<eT>>
+class StreamingBayesianUpdate {
+	public:
+		CT C;
+		eT max_diff;
+		uint max_reps;
+		std::string method;
+
+		StreamingBayesianUpdate(const CT& C, eT max_diff = eT(1e-6), uint max_reps = 0, const std::string& method = "em")
+			: C(C), max_diff(max_diff), max_reps(max_reps), method(method), counts(arma::zeros<Row<eT>>(C.n_cols)) {}
+
+		void add(uint y, eT count = eT(1)) {
+			if(y >= C.n_cols) throw std::runtime_error("output out of bounds");
+			counts(y) += count;
+			total += count;
+			changed = true;
+		}
+
+		void add(const Row<eT>& c) {
+			if(c.n_cols != C.n_cols) throw std::runtime_error("invalid sizes");
+			counts += c;
+			total += arma::accu(c);
+			changed = true;
+		}
+
+		const Row<eT>& histogram() const { return counts; }
+
+		// current estimate (uniform if no report has been added)
+		const Prob<eT>& estimate() {
+			if(pi.is_empty())
+				pi = probab::uniform<eT>(C.n_rows);
+			if(changed && total > eT(0)) {
+				pi = aux::iterative_bayesian_update(C, Prob<eT>(counts / total), pi, max_diff, max_reps, method, {}).first;
+				changed = false;
+			}
+			return pi;
+		}
+
+	private:
+		Row<eT> counts;
+		eT total = eT(0);
+		bool changed = false;
+		Prob<eT> pi;
+};
+
 
 // Returns a channel X such that A = B X
 // If col_stoch == true then the returned X is column-stochastic
@@ -327,21 +1124,55 @@ Chan<eT> factorize_lp(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch
 template<typename eT = eT_def>
 inline
 void _simplex_project(Chan<eT>& C, bool col_stoch) {
-	if(col_stoch)
-		for(uint j = 0; j < C.n_cols; j++)
-			C.col(j) = metric::optimize::simplex_project((Prob<eT>)C.col(j));
-	else
-		for(uint i = 0; i < C.n_rows; i++)
-			C.row(i) = metric::optimize::simplex_project((Prob<eT>)C.row(i));
+	if constexpr (std::is_floating_point<eT>::value) {
+		// batched projection of contiguous columns, rows are projected as the columns of C^t
+		if(col_stoch) {
+			metric::optimize::simplex_project_cols(C);
+		} else {
+			arma::inplace_trans(C);
+			metric::optimize::simplex_project_cols(C);
+			arma::inplace_trans(C);
+		}
+	} else {
+		if(col_stoch)
+			for(uint j = 0; j < C.n_cols; j++)
+				C.col(j) = metric::optimize::simplex_project((Prob<eT>)C.col(j));
+		else
+			for(uint i = 0; i < C.n_rows; i++)
+				C.row(i) = metric::optimize::simplex_project((Prob<eT>)C.row(i));
+	}
 }
 
 
+// State of factorize_subgrad, for checkpointing (see checkpoint.h)
+//
+template<typename eT>
+struct FactorizeState {
+	typedef eT elem_type;
+
+	uint k = 1;							// next iteration
+	Chan<eT> X, S;
+	eT min, sum1, sum2;
+
+	Col<eT> pack() const {
+		return checkpoint::Writer<eT>().put(k).put(X).put(S).put(min).put(sum1).put(sum2).col();
+	}
+	static FactorizeState unpack(const Mat<eT>& data) {
+		FactorizeState s;
+		checkpoint::Reader<eT>(data).get(s.k).get(s.X).get(s.S).get(s.min).get(s.sum1).get(s.sum2);
+		return s;
+	}
+};
+
 // factorize using a subgradient method.
 // see: http://see.stanford.edu/materials/lsocoee364b/02-subgrad_method_notes.pdf
 //
+// hook saves and restores the state of the iterations (see checkpoint.h)
+//
 template<typename eT = eT_def>
 inline
-Chan<eT> factorize_subgrad(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch = false, const eT max_diff = 1e-4) {
+Chan<eT> factorize_subgrad(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch = false, const eT max_diff = 1e-4,
+	const checkpoint::Hook<FactorizeState<eT>>& hook = {}) {
 	using arma::dot;
 
 	const bool debug = false;
@@ -380,11 +1211,27 @@ Chan<eT> factorize_subgrad(const Chan<eT>& A, const Chan<eT>& B, const bool col_
 	Chan<eT> Z(M, N);
 	Chan<eT> S = arma::zeros<Chan<eT>>(L, N);
 
-	uint k;
+	uint k = 1;
 	eT min(1), bound;
 	eT sum1(- R * R), sum2(0);
 
-	for(k = 1; true; k++) {
+	if(hook.resume) {
+		const FactorizeState<eT>& s = *hook.resume;
+		if(s.X.n_rows != L || s.X.n_cols != N || s.S.n_rows != L || s.S.n_cols != N)
+			throw std::runtime_error("factorize_subgrad: checkpoint of a different problem");
+		k = s.k;
+		X = s.X;
+		S = s.S;
+		min = s.min;
+		sum1 = s.sum1;
+		sum2 = s.sum2;
+	}
+	uint last_save = k;
+
+	for(; true; k++) {
+		if(hook.due(k, last_save))
+			hook.save({ k, X, S, min, sum1, sum2 });
+
 		// compute
 		//    f = max_{i,j} | (B*X)(i,j) - A(i,j) |
 		//      = max_{i,j,sign} sign*((B*X)(i,j) - A(i,j))     (sign in {1,-1})
@@ -467,15 +1314,125 @@ Chan<eT> factorize_subgrad(const Chan<eT>& A, const Chan<eT>& B, const bool col_
 	return X;
 }
 
+// factorize using FISTA (accelerated projected gradient) on f(X) = 1/2 ||B X - A||^2 over stochastic matrices X, with
+// the gradient-based adaptive restart of O'Donoghue & Candes. Both the momentum step and the projection work on the
+// whole matrix at once (see _simplex_project).
+// see: A. Beck, M. Teboulle, A fast iterative shrinkage-thresholding algorithm for linear inverse problems, 2009
+//      B. O'Donoghue, E. Candes, Adaptive restart for accelerated gradient schemes, 2015
+//
+// X is returned as soon as max |B X - A| <= max_diff. Since such an X has f(X) <= M N max_diff^2 / 2, A is reported as
+// non-factorizable (empty result) when the lower bound f(X) - gap(X) exceeds that value, gap being the Frank-Wolfe
+// duality gap. An empty result is also returned if neither happens in max_iter iterations.
+//
+template<typename eT = eT_def>
+inline
+Chan<eT> factorize_fista(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch = false, const eT max_diff = 1e-4, const uint max_iter = 100000) {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+
+	// A: M x N
+	// B: M x L
+	// X: L x N   unknowns
+	//
+	// We work with V whose *columns* are distributions (V = X if col_stoch, X^t otherwise) so that the projection is
+	// done on contiguous memory.
+	//
+	const uint M = A.n_rows,
+			   N = A.n_cols,
+			   L = B.n_cols;
+	if(B.n_rows != M)
+		return {};
+
+	const Mat<eT> H = B.t() * B;					// L x L, the gradient is B^t (B X - A) = H X - B^t A
+	const Mat<eT> BtA = col_stoch ? Mat<eT>(B.t() * A) : Mat<eT>(A.t() * B);
+	const eT lip = arma::max(arma::eig_sym(H));		// Lipschitz constant of the gradient
+	if(!(lip > eT(0)))
+		return {};
+	const eT fail_bound = eT(M) * N * max_diff * max_diff / 2;
+	const uint check_every = 10;					// iterations between the computations of the lower bound
+
+	auto gradient = [&](const Mat<eT>& V) -> Mat<eT> {
+		return col_stoch ? Mat<eT>(H * V - BtA) : Mat<eT>(V * H - BtA);
+	};
+	auto residual = [&](const Mat<eT>& V) -> Mat<eT> {
+		return col_stoch ? Mat<eT>(B * V - A) : Mat<eT>(B * V.t() - A);
+	};
+	auto result = [&](Mat<eT>& V) -> Chan<eT> {
+		if(!col_stoch)
+			arma::inplace_trans(V);
+		return V;
+	};
+
+	// start from the projected least-squares solution, as factorize_subgrad, or the uniform matrix
+	Chan<eT> X;
+	std::ostream nullstream(0);
+	ARMA_SET_CERR(nullstream);
+	arma::solve(X, B, A);
+	ARMA_SET_CERR(std::cerr);
+
+	Mat<eT> V;
+	if(X.n_cols) {
+		V = col_stoch ? X : Mat<eT>(X.t());
+		metric::optimize::simplex_project_cols(V);
+	} else {
+		V.set_size(col_stoch ? L : N, col_stoch ? N : L);
+		V.fill(eT(1) / V.n_rows);
+	}
+
+	Mat<eT> Y = V, V_new;
+	eT t(1);
+
+	for(uint k = 1; max_iter == 0 || k <= max_iter; k++) {
+		V_new = Y - gradient(Y) / lip;
+		metric::optimize::simplex_project_cols(V_new);
+
+		Mat<eT> R = residual(V_new);
+		if(R.is_empty() || arma::abs(R).max() <= max_diff)
+			return result(V_new);
+
+		if(k % check_every == 0) {
+			Mat<eT> G = gradient(V_new);
+			eT f = arma::accu(R % R) / 2;
+			eT gap = arma::accu(G % V_new) - arma::accu(arma::min(G, 0));
+			if(f - gap > fail_bound)
+				return {};
+		}
+
+		// adaptive restart: drop the momentum when it points against the gradient step
+		if(arma::accu((Y - V_new) % (V_new - V)) > eT(0)) {
+			t = 1;
+			Y = V_new;
+		} else {
+			eT t_new = (1 + std::sqrt(1 + 4 * t * t)) / 2;
+			Y = V_new + ((t - 1) / t_new) * (V_new - V);
+			t = t_new;
+		}
+		V.swap(V_new);
+	}
+
+	return {};
+}
+
 // Returns a channel X such that A = B X
+// method: "auto" (factorize_lp for small channels, factorize_subgrad for large floating ones), "lp", "subgrad", "fista"
 //
 template<typename eT = eT_def>
 inline
-Chan<eT> factorize(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch = false) {
+Chan<eT> factorize(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch = false, const std::string& method = "auto") {
+	if(method == "lp")
+		return factorize_lp(A, B, col_stoch);
+	else if(method != "auto" && method != "subgrad" && method != "fista")
+		throw std::runtime_error("invalid method");
+
 	if constexpr (!std::is_same<eT, rat>::value) {
+		if(method == "fista")
+			return factorize_fista(A, B, col_stoch);
+
 		// subgradient is usually facter for larger matrices, but sometimes for small ones it is _very_ slow
-		if (A.n_elem >= 1000)
+		if (method == "subgrad" || A.n_elem >= 1000)
 			return factorize_subgrad(A, B, col_stoch);
+	} else {
+		if(method != "auto")
+			throw std::runtime_error("method " + method + " is only available for floating types");
 	}
 	return factorize_lp(A, B, col_stoch);
 }
@@ -485,10 +1442,10 @@ Chan<eT> factorize(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch =
 //
 template<typename eT = eT_def>
 inline
-Chan<eT> left_factorize(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch = false) {
+Chan<eT> left_factorize(const Chan<eT>& A, const Chan<eT>& B, const bool col_stoch = false, const std::string& method = "auto") {
 	// A = X B if A^t = B^t X^t, so we use factorize asking for an "inversly"-stochastic matrix
 	//
-	Chan<eT> X = factorize((Chan<eT>)A.t(), (Chan<eT>)B.t(), !col_stoch);
+	Chan<eT> X = factorize((Chan<eT>)A.t(), (Chan<eT>)B.t(), !col_stoch, method);
 	arma::inplace_trans(X);
 	return X;
 }
@@ -510,25 +1467,99 @@ std::pair<uint,uint> sample(const Chan<eT>& C, const Prob<eT>& pi) {
 	return { x, y };
 }
 
-// efficient batch sampling via the joint distribution
+// Samples (x, y) pairs from pi and C, using an alias table for pi and one for each row of C (rows with pi(x) = 0 are
+// skipped). Construction is O(n_rows * n_cols), then each pair costs O(1), and output(x, gen) samples from row x alone.
+//
+class Sampler {
+	private:
+		probab::AliasSampler input;
+		std::vector<probab::AliasSampler> rows;
+
+	public:
+		template<typename eT>
+		Sampler(const Chan<eT>& C, const Prob<eT>& pi) : input(pi), rows(C.n_rows) {
+			if(C.n_rows != pi.n_cols) throw std::runtime_error("invalid size");
+
+			parallel::for_each(C.n_rows, [&](uint x) {
+				if(pi(x) != eT(0))
+					rows[x] = probab::AliasSampler(C.row(x));
+			});
+		}
+
+		template<typename G>
+		inline uint output(uint x, G& gen) const {
+			return rows[x](gen);
+		}
+
+		template<typename G>
+		inline std::pair<uint,uint> operator()(G& gen) const {
+			uint x = input(gen);
+			return { x, rows[x](gen) };
+		}
+
+		// n pairs into xs, ys (preallocated), generated in parallel from independent streams of seed
+		void fill(uint* xs, uint* ys, size_t n, uint64_t seed) const {
+			rng::parallel_streams(n, seed, [&](rng::Engine& gen, size_t begin, size_t end) {
+				for(size_t k = begin; k < end; k++)
+					std::tie(xs[k], ys[k]) = (*this)(gen);
+			});
+		}
+
+		// n x 2 matrix, each row is a sampled (x, y)
+		Mat<uint> fill(uint n, uint64_t seed = rng::random_seed()) const {
+			Mat<uint> res(n, 2);
+			fill(res.colptr(0), res.colptr(1), n, seed);
+			return res;
+		}
+};
+
+// efficient batch sampling via alias tables
 template<typename eT = eT_def>
 inline
 Mat<uint> sample(const Chan<eT>& C, const Prob<eT>& pi, uint n) {
-	// build the joint	
-	Mat<eT> J = C;
-	J.each_col() %= pi.t();
+	QIF_TRACE_SPAN("channel::sample");
+	return Sampler(C, pi).fill(n);
+}
+
+// sparse version, only the non-zero elements of row x are visited
+template<typename eT = eT_def>
+inline
+std::pair<uint,uint> sample(const SpChan<eT>& C, const Prob<eT>& pi) {
+	uint x = probab::sample<eT>(pi);
+	eT p = rng::randu<eT>();
+
+	eT accu(0);
+	uint y = 0;
+	for(auto it = C.begin_row(x); it != C.end_row(x); ++it) {
+		y = it.col();
+		if(!less_than(accu += *it, p))
+			break;
+	}
+	return { x, y };
+}
+
+// sparse batch sampling, via the (sparse) joint distribution
+template<typename eT = eT_def>
+inline
+Mat<uint> sample(const SpChan<eT>& C, const Prob<eT>& pi, uint n) {
+	QIF_TRACE_SPAN("channel::sample");
+	// the non-zero elements of the joint, and their positions
+	Row<eT> J(C.n_nonzero);
+	Row<uint> rows(C.n_nonzero), cols(C.n_nonzero);
+
+	uint k = 0;
+	for(auto it = C.begin(); it != C.end(); ++it, k++) {
+		J(k) = pi(it.row()) * eT(*it);
+		rows(k) = it.row();
+		cols(k) = it.col();
+	}
 
-	// sample from it (note that prbab::sample just needs an iterable object, and the sampled indexes are the positions in the iteration)
-	Row<uint> sampled = probab::sample(J, n);
+	Row<uint> sampled = probab::sample<eT>(J, n);
 
 	Mat<uint> res(n, 2);
 	for(uint i = 0; i < n; i++) {
-		// J is iterated by probab::sample column-by-column. The index we get need to be converted to
-		// indexes for i and j
-		//
-		uint joint_i = sampled(i);
-		res(i, 0) = joint_i % J.n_rows;
-		res(i, 1) = joint_i / J.n_rows;
+		res(i, 0) = rows(sampled(i));
+		res(i, 1) = cols(sampled(i));
 	}
 	return res;
 }
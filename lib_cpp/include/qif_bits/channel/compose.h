@@ -1,6 +1,8 @@
 
 namespace channel::compose {
 
+// C(x, y1*C2.n_cols + y2) = C1(x,y1) C2(x,y2)
+//
 template<typename eT>
 inline
 Chan<eT> parallel(const Chan<eT>& C1, const Chan<eT>& C2) {
@@ -8,14 +10,112 @@ Chan<eT> parallel(const Chan<eT>& C1, const Chan<eT>& C2) {
 		throw std::runtime_error("rows mismatch");
 
 	Chan<eT> C(C1.n_rows, C1.n_cols * C2.n_cols);
-	for(uint i = 0; i < C1.n_rows; i++)
 	for(uint j = 0; j < C1.n_cols; j++)
 	for(uint k = 0; k < C2.n_cols; k++)
-		C(i, j*C2.n_cols + k) = C1(i,j) * C2(i,k);
+		C.col(j*C2.n_cols + k) = C1.col(j) % C2.col(k);
 
 	return C;
 }
 
+namespace aux {
+
+// columns of B per parallel task in rat_product
+const uint rat_product_block_cols = 16;
+
+// A * B for rationals. Each element is accumulated by rat_aux::DotAccumulator (in machine integers while the terms are
+// small, zero terms skipped). A is transposed once so that the inner loop reads contiguous memory; columns of B are
+// processed in parallel blocks, each row of A^T being reused for a whole block.
+//
+inline
+Mat<rat> rat_product(const Mat<rat>& A, const Mat<rat>& B) {
+	const Mat<rat> At = A.t();
+	Mat<rat> C = arma::zeros<Mat<rat>>(A.n_rows, B.n_cols);
+
+	uint n_blocks = (B.n_cols + rat_product_block_cols - 1) / rat_product_block_cols;
+	parallel::for_each(n_blocks, [&](uint b) {
+		uint j0 = b * rat_product_block_cols,
+			 j1 = std::min(j0 + rat_product_block_cols, B.n_cols);
+
+		for(uint i = 0; i < A.n_rows; i++) {
+			const rat* a = At.colptr(i);
+			for(uint j = j0; j < j1; j++) {
+				const rat* bj = B.colptr(j);
+				rat_aux::DotAccumulator acc;
+				for(uint k = 0; k < A.n_cols; k++)
+					acc.add(a[k], bj[k]);
+				C.at(i, j) = acc.result();
+			}
+		}
+	});
+	return C;
+}
+
+template<typename eT>
+Mat<eT> product(const Mat<eT>& A, const Mat<eT>& B) {
+	if constexpr (std::is_same<eT, rat>::value)
+		return rat_product(A, B);
+	else
+		return A * B;
+}
+
+// product of Cs[i..j], following the splits computed by cascade
+template<typename eT>
+Mat<eT> chain_product(const std::vector<Chan<eT>>& Cs, const arma::umat& split, uint i, uint j) {
+	if(i == j)
+		return Cs[i];
+	uint s = split(i, j);
+	return product<eT>(chain_product(Cs, split, i, s), chain_product(Cs, split, s+1, j));
+}
+
+} // namespace aux
+
+// Cascade (sequential) composition AB: the output of A is given as input to B
+//
+template<typename eT>
+Chan<eT> cascade(const Chan<eT>& A, const Chan<eT>& B) {
+	if(A.n_cols != B.n_rows)
+		throw std::runtime_error("invalid sizes");
+
+	return aux::product<eT>(A, B);
+}
+
+// Cascade of a chain C_1 ... C_k. The product is associative, so the order of multiplications is chosen to minimize
+// the number of scalar products (the classic matrix-chain dynamic program, O(k^3)). Eg. for a prior-sized 1 x n first
+// factor, the chain is reduced from the left without forming any n x n product.
+//
+template<typename eT>
+Chan<eT> cascade(const std::vector<Chan<eT>>& Cs) {
+	if(Cs.empty())
+		throw std::runtime_error("no channels to compose");
+
+	uint k = Cs.size();
+	std::vector<double> dim(k + 1);				// C_i is dim[i] x dim[i+1]
+	for(uint i = 0; i < k; i++) {
+		if(i > 0 && Cs[i].n_rows != Cs[i-1].n_cols)
+			throw std::runtime_error("invalid sizes");
+		dim[i] = Cs[i].n_rows;
+	}
+	dim[k] = Cs[k-1].n_cols;
+
+	arma::mat cost(k, k, arma::fill::zeros);			// cost(i,j): min cost of C_i ... C_j
+	arma::umat split(k, k, arma::fill::zeros);
+	for(uint len = 1; len < k; len++) {
+		for(uint i = 0; i + len < k; i++) {
+			uint j = i + len;
+			cost(i, j) = arma::datum::inf;
+			for(uint s = i; s < j; s++) {
+				double c = cost(i, s) + cost(s+1, j) + dim[i] * dim[s+1] * dim[j+1];
+				if(c < cost(i, j)) {
+					cost(i, j) = c;
+					split(i, j) = s;
+				}
+			}
+		}
+	}
+
+	return aux::chain_product(Cs, split, 0, k-1);
+}
+
 template<typename eT>
 inline
 Chan<eT> repeated_independent(const Chan<eT>& C, uint n) {
@@ -31,5 +131,127 @@ Chan<eT> repeated_independent(const Chan<eT>& C, uint n) {
 	return Cn;
 }
 
+// Lazy parallel composition of Cs (same column order as parallel), each row is the Kronecker product of the rows of
+// the factors, computed on demand. Measures with LazyChan overloads (bayes_vuln, g_vuln, utility) then only need
+// O(n_cols) memory instead of O(n_rows * n_cols).
+//
+template<typename eT>
+LazyChan<eT> parallel_lazy(const std::vector<Chan<eT>>& Cs) {
+	if(Cs.empty())
+		throw std::runtime_error("no channels to compose");
+
+	uint64_t n_cols = 1;
+	for(auto& C : Cs) {
+		if(C.n_rows != Cs[0].n_rows)
+			throw std::runtime_error("rows mismatch");
+		n_cols *= C.n_cols;
+		if(n_cols > std::numeric_limits<uint>::max())
+			throw std::runtime_error("too many columns");
+	}
+
+	auto factors = std::make_shared<const std::vector<Chan<eT>>>(Cs);
+
+	return LazyChan<eT>(Cs[0].n_rows, n_cols, [factors](uint x, Row<eT>& row) {
+		// the product of the first factors occupies row(0..len-1), each factor expands it in place, going backwards
+		// so that every element is read before being overwritten
+		uint len = 1;
+		row(0) = eT(1);
+		for(auto& C : *factors) {
+			uint m = C.n_cols;
+			for(uint j = len; j-- > 0; ) {
+				eT v = row(j);
+				for(uint k = m; k-- > 0; )
+					row(j*m + k) = v * C(x, k);
+			}
+			len *= m;
+		}
+	});
+}
+
+template<typename eT>
+LazyChan<eT> parallel_lazy(const Chan<eT>& C1, const Chan<eT>& C2) {
+	return parallel_lazy<eT>({ C1, C2 });
+}
+
+template<typename eT>
+LazyChan<eT> repeated_independent_lazy(const Chan<eT>& C, uint n) {
+	if(n == 0)
+		throw std::runtime_error("n should be positive");
+	return parallel_lazy(std::vector<Chan<eT>>(n, C));
+}
+
+// n independent runs of C, with the outputs grouped by type: all sequences (y_1, ..., y_n) with the same count k_y of
+// each output y have the same probability prod_y C(x,y)^k_y, so they are merged into a single column with entries
+// multinomial(n; k) prod_y C(x,y)^k_y. The result is equivalent to repeated_independent(C, n) for Bayes, g- and
+// Shannon vulnerability and leakage (merging identical columns does not change them), but it has
+// binomial(n+m-1, m-1) columns instead of m^n, so the cost is polynomial in n.
+//
+// Columns are the types in decreasing lexicographic order of (k_0, ..., k_{m-1}), starting with k_0 = n. So for n = 1
+// column y is output y (the result is C itself). For floating types the entries are computed in the log domain, so
+// large n does not overflow.
+//
+template<typename eT>
+Chan<eT> repeated_independent_types(const Chan<eT>& C, uint n) {
+	uint m = C.n_cols;
+	if(m == 0)
+		throw std::runtime_error("empty channel");
+
+	// binomial(n+m-1, m-1), computed incrementally (each partial product is itself a binomial, so exact)
+	uint64_t n_types = 1;
+	for(uint i = 1; i < m; i++) {
+		n_types = n_types * (n + i) / i;
+		if(n_types > std::numeric_limits<uint>::max())
+			throw std::runtime_error("too many types");
+	}
+
+	// acc.col(y) holds the accumulated value after choosing k_0, ..., k_{y-1}: the log of prod C(x,y)^k_y / k_y! for
+	// floating types, the product itself for rat. fact(k) is log(k!) or k!
+	constexpr bool is_float = std::is_floating_point<eT>::value;
+	Col<eT> fact(n + 1);
+	fact(0) = eT(is_float ? 0 : 1);
+	for(uint k = 1; k <= n; k++) {
+		if constexpr (is_float)
+			fact(k) = fact(k-1) + eT(std::log(k));
+		else
+			fact(k) = fact(k-1) * eT(k);
+	}
+
+	Mat<eT> logC;
+	if constexpr (is_float)
+		logC = arma::log(C);
+
+	Chan<eT> res(C.n_rows, n_types);
+	Mat<eT> acc(C.n_rows, m + 1);
+	acc.col(0).fill(eT(is_float ? 0 : 1));
+	Col<eT> pow;
+	uint col = 0;
+
+	std::function<void(uint,uint)> rec = [&](uint y, uint rem) {
+		uint k_min = y == m-1 ? rem : 0;			// the last output takes all the remaining runs
+		for(uint k = rem + 1; k-- > k_min; ) {		// k from rem down to k_min
+			if constexpr (is_float) {
+				acc.col(y+1) = acc.col(y) - fact(k);
+				if(k > 0)
+					acc.col(y+1) += eT(k) * logC.col(y);
+			} else {
+				pow = arma::ones<Col<eT>>(C.n_rows);			// C(:,y)^k / k!
+				for(uint i = 0; i < k; i++)
+					pow %= C.col(y);
+				acc.col(y+1) = acc.col(y) % pow / fact(k);
+			}
+
+			if(y < m-1) {
+				rec(y+1, rem - k);
+			} else if constexpr (is_float) {
+				res.col(col++) = arma::exp(acc.col(m) + fact(n));
+			} else {
+				res.col(col++) = acc.col(m) * fact(n);
+			}
+		}
+	};
+	rec(0, n);
+
+	return res;
+}
 
 } // namespace channel::comp
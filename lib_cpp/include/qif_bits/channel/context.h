@@ -0,0 +1,84 @@
+namespace channel {
+
+// A prior pi and channel C shared by several measures (eg a report computing bayes_vuln, g_vuln for many G's, shannon,
+// guessing and l_risk for the same pair). Sizes are checked once, and the uniformity of pi, the joint, the outer
+// distribution, the posteriors and the reduced hyper are computed on first use and then reused by every measure
+// overload taking a PosteriorContext.
+//
+// pi and C are kept by reference, so they must outlive the context. The caches are filled lazily by const methods,
+// so a context should not be used from multiple threads concurrently.
+//
+template<typename eT>
+class PosteriorContext {
+	public:
+		const Prob<eT>& pi;
+		const Chan<eT>& C;
+
+		PosteriorContext(const Prob<eT>& pi, const Chan<eT>& C) : pi(pi), C(C) {
+			check_prior_size(pi, C);
+		}
+
+		// the context keeps references, a temporary would dangle
+		PosteriorContext(Prob<eT>&&, const Chan<eT>&) = delete;
+		PosteriorContext(const Prob<eT>&, Chan<eT>&&) = delete;
+
+		uint n_inputs() const	{ return C.n_rows; }
+		uint n_outputs() const	{ return C.n_cols; }
+
+		bool uniform() const {
+			if(!uniform_)
+				uniform_ = probab::is_uniform(pi);
+			return *uniform_;
+		}
+
+		// diag(pi) C
+		const Mat<eT>& joint() const {
+			if(!joint_) {
+				joint_ = C;
+				if(!uniform())
+					joint_->each_col() %= pi.t();
+				else
+					*joint_ /= eT(int(pi.n_cols));
+			}
+			return *joint_;
+		}
+
+		// pi C (the column sums of the joint)
+		const Prob<eT>& outer() const {
+			if(!outer_)
+				outer_ = Prob<eT>(arma::sum(joint(), 0));
+			return *outer_;
+		}
+
+		// same as channel::posteriors(C, pi)
+		const Mat<eT>& posteriors() const {
+			if(!posteriors_) {
+				posteriors_ = joint();
+				posteriors_->each_row() /= outer();
+			}
+			return *posteriors_;
+		}
+
+		// the reduced hyper: channel::hyper(C, pi) without its zero-probability (merged) inners, so all inners are
+		// distinct and have non-zero probability (as in hyper_compact, but merging exactly equal posteriors)
+		const Hyper<eT>& hyper() const {
+			if(!hyper_) {
+				auto [outer, inners] = channel::hyper(C, pi);
+				std::vector<arma::uword> keep;
+				for(uint j = 0; j < outer.n_cols; j++)
+					if(outer(j) != eT(0))
+						keep.push_back(j);
+				const arma::uvec cols(keep);
+				hyper_ = Hyper<eT>{ outer.cols(cols), inners.cols(cols) };
+			}
+			return *hyper_;
+		}
+
+	private:
+		mutable std::optional<bool> uniform_;
+		mutable std::optional<Mat<eT>> joint_, posteriors_;
+		mutable std::optional<Prob<eT>> outer_;
+		mutable std::optional<Hyper<eT>> hyper_;
+};
+
+} // namespace channel
@@ -0,0 +1,189 @@
+namespace channel {
+
+// Streaming estimator of a channel (and prior) from observed (x, y) pairs, eg logs of (secret, observable) of a deployed
+// system, or the output of channel::sample. Counts are kept in a hash map (only the observed pairs are stored), so the
+// number of inputs/outputs can be large.
+//
+// add(x, y) locks the estimator. For high volumes every producing thread should get its own Shard, whose add is a
+// plain (lock-free) update of the shard's own counts. Shards are merged into the estimator by flush(), which they also
+// call automatically every flush_every pairs and on destruction, so estimates can be read while producers run (they
+// reflect the pairs flushed so far). The estimator must outlive its shards.
+//
+class EmpiricalChannel {
+	public:
+		uint n_rows, n_cols;
+
+		EmpiricalChannel(uint n_rows, uint n_cols) : n_rows(n_rows), n_cols(n_cols), row_counts(n_rows, 0) {
+			if(n_rows == 0 || n_cols == 0) throw std::runtime_error("empty channel");
+		}
+
+		EmpiricalChannel(const EmpiricalChannel&) = delete;
+		EmpiricalChannel& operator=(const EmpiricalChannel&) = delete;
+
+		class Shard {
+			public:
+				static const uint flush_every = 1 << 16;
+
+				explicit Shard(EmpiricalChannel& est) : est(&est) {}
+				Shard(Shard&& other) : est(other.est), counts(std::move(other.counts)), pending(other.pending) { other.est = nullptr; }
+				~Shard() { if(est) flush(); }
+
+				Shard(const Shard&) = delete;
+				Shard& operator=(const Shard&) = delete;
+
+				void add(uint x, uint y, uint64_t count = 1) {
+					est->check(x, y);
+					counts[key(x, y)] += count;
+					if((pending += count) >= flush_every)
+						flush();
+				}
+
+				void flush() {
+					est->merge(counts);
+					counts.clear();
+					pending = 0;
+				}
+
+			private:
+				EmpiricalChannel* est;
+				std::unordered_map<uint64_t, uint64_t> counts;
+				uint64_t pending = 0;
+
+				uint64_t key(uint x, uint y) const { return uint64_t(x) * est->n_cols + y; }
+		};
+
+		Shard shard() { return Shard(*this); }
+
+		void add(uint x, uint y, uint64_t count = 1) {
+			check(x, y);
+			std::lock_guard<std::mutex> lock(mutex);
+			counts[uint64_t(x) * n_cols + y] += count;
+			row_counts[x] += count;
+			total += count;
+		}
+
+		// pairs given as the rows of an n x 2 matrix (as returned by channel::sample), counted in parallel
+		void add(const Mat<uint>& pairs) {
+			if(pairs.n_cols != 2) throw std::runtime_error("pairs should have 2 columns");
+
+			const uint block = 1 << 16;
+			parallel::for_each((pairs.n_rows + block - 1) / block, [&](uint b) {
+				Shard s(*this);
+				for(uint k = b * block; k < std::min(pairs.n_rows, (b + 1) * block); k++)
+					s.add(pairs(k, 0), pairs(k, 1));
+			});
+		}
+
+		uint64_t n_samples() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return total;
+		}
+
+		uint64_t count(uint x, uint y) const {
+			check(x, y);
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = counts.find(uint64_t(x) * n_cols + y);
+			return it == counts.end() ? 0 : it->second;
+		}
+
+		// empirical prior, row counts / total
+		template<typename eT = eT_def>
+		Prob<eT> prior() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			if(total == 0) throw std::runtime_error("no samples");
+
+			Prob<eT> pi(n_rows);
+			for(uint x = 0; x < n_rows; x++)
+				pi(x) = eT(row_counts[x]) / eT(total);
+			return pi;
+		}
+
+		// empirical channel, counts / row counts. Rows of inputs never observed are uniform (so the channel is proper).
+		template<typename eT = eT_def>
+		Chan<eT> channel() const {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			Chan<eT> C(n_rows, n_cols, arma::fill::zeros);
+			for(auto& [k, c] : counts)
+				C(k / n_cols, k % n_cols) = eT(c) / eT(row_counts[k / n_cols]);
+			for(uint x = 0; x < n_rows; x++)
+				if(row_counts[x] == 0)
+					C.row(x).fill(eT(1) / eT(n_cols));
+			return C;
+		}
+
+		// sparse version, rows of inputs never observed are empty
+		template<typename eT = eT_def>
+		SpChan<eT> sparse_channel() const {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			arma::umat locations(2, counts.size());
+			Col<eT> values(counts.size());
+			uint i = 0;
+			for(auto& [k, c] : counts) {
+				locations(0, i) = k / n_cols;
+				locations(1, i) = k % n_cols;
+				values(i++) = eT(c) / eT(row_counts[k / n_cols]);
+			}
+			return SpChan<eT>(locations, values, n_rows, n_cols);
+		}
+
+		struct Estimate {
+			double value, lower, upper;
+		};
+
+		// Posterior Bayes vulnerability of the empirical joint, sum_y max_x count(x,y) / total, ie the success rate of
+		// the best guess for each y over the observed pairs, with a Hoeffding confidence interval at the given level.
+		// Since the guesses are chosen from the same data the estimate is biased upwards for few samples per output.
+		//
+		Estimate bayes_vuln(double confidence = 0.95) const {
+			std::lock_guard<std::mutex> lock(mutex);
+			if(total == 0) throw std::runtime_error("no samples");
+
+			std::vector<uint64_t> col_max(n_cols, 0);
+			for(auto& [k, c] : counts)
+				col_max[k % n_cols] = std::max(col_max[k % n_cols], c);
+
+			uint64_t hits = 0;
+			for(auto m : col_max)
+				hits += m;
+			return interval(double(hits) / total, confidence);
+		}
+
+		// Prior Bayes vulnerability of the empirical prior, max_x row_count(x) / total, same interval
+		Estimate prior_bayes_vuln(double confidence = 0.95) const {
+			std::lock_guard<std::mutex> lock(mutex);
+			if(total == 0) throw std::runtime_error("no samples");
+
+			return interval(double(*std::max_element(row_counts.begin(), row_counts.end())) / total, confidence);
+		}
+
+	private:
+		mutable std::mutex mutex;
+		std::unordered_map<uint64_t, uint64_t> counts;
+		std::vector<uint64_t> row_counts;
+		uint64_t total = 0;
+
+		void check(uint x, uint y) const {
+			if(x >= n_rows || y >= n_cols) throw std::runtime_error("pair out of range");
+		}
+
+		void merge(const std::unordered_map<uint64_t, uint64_t>& shard_counts) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for(auto& [k, c] : shard_counts) {
+				counts[k] += c;
+				row_counts[k / n_cols] += c;
+				total += c;
+			}
+		}
+
+		// value +- sqrt(log(2/delta) / (2 total)), clamped to [0, 1] (mutex held)
+		Estimate interval(double value, double confidence) const {
+			if(!(confidence > 0 && confidence < 1)) throw std::runtime_error("confidence should be in (0, 1)");
+
+			double eps = std::sqrt(std::log(2 / (1 - confidence)) / (2 * double(total)));
+			return { value, std::max(0.0, value - eps), std::min(1.0, value + eps) };
+		}
+};
+
+} // namespace channel
@@ -0,0 +1,102 @@
+namespace channel {
+
+// A channel whose rows are computed on demand. Useful for channels that are too large to store densely, but whose
+// rows can be cheaply computed from some structure (eg. a translation-invariant kernel on a grid).
+// row_func(x, row) should write the x-th row in 'row', which is already allocated with n_cols elements.
+//
+template<typename eT>
+class LazyChan {
+	public:
+		typedef std::function<void(uint, Row<eT>&)> RowFunc;
+
+		uint n_rows, n_cols;
+
+		LazyChan(uint n_rows, uint n_cols, RowFunc row_func) : n_rows(n_rows), n_cols(n_cols), row_func(row_func) {}
+
+		// computes the x-th row in res, without allocating if res already has the correct size
+		void row(uint x, Row<eT>& res) const {
+			if(x >= n_rows) throw std::runtime_error("row out of bounds");
+			res.set_size(n_cols);
+			row_func(x, res);
+		}
+
+		Prob<eT> row(uint x) const {
+			Prob<eT> res;
+			row(x, res);
+			return res;
+		}
+
+		Chan<eT> materialize() const {
+			Chan<eT> C(n_rows, n_cols);
+			Row<eT> r(n_cols);
+			for(uint x = 0; x < n_rows; x++) {
+				row(x, r);
+				C.row(x) = r;
+			}
+			return C;
+		}
+
+	private:
+		RowFunc row_func;
+};
+
+template<typename eT>
+void check_prior_size(const Prob<eT>& pi, const LazyChan<eT>& C) {
+	if(C.n_rows != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+
+// Channel on a width x height grid (cell = y*width + x) that displaces the input by a random vector independent of the
+// input, and clamps the result to the grid. kernel has size (2*height-1) x (2*width-1), and the probability of a
+// displacement by (dx,dy) is kernel(height-1+dy, width-1+dx).
+//
+// Row x is the kernel centered at x, with the mass falling outside the grid folded to the border cells. The mass of
+// each border cell is a rectangle of the kernel, computed in O(1) from a summed-area table, so each row costs
+// O(width*height) instead of O(kernel size).
+//
+template<typename eT>
+LazyChan<eT> grid_kernel(const Mat<eT>& kernel, uint width, uint height) {
+	if(kernel.n_rows != 2*height-1 || kernel.n_cols != 2*width-1)
+		throw std::runtime_error("kernel size should be (2*height-1) x (2*width-1)");
+
+	// summed-area table, sat(r,c) = sum of kernel(0..r-1, 0..c-1). Kept in accum_t, since the differences of large
+	// partial sums that give the border cells would lose the small tail masses in float.
+	typedef accum_t<eT> aT;
+	auto sat = std::make_shared<Mat<aT>>(kernel.n_rows + 1, kernel.n_cols + 1);
+	Mat<aT>& S = *sat;
+	S.row(0).zeros();
+	S.col(0).zeros();
+	for(uint c = 1; c < S.n_cols; c++)
+		for(uint r = 1; r < S.n_rows; r++)
+			S(r, c) = aT(kernel(r-1, c-1)) + S(r-1, c) + S(r, c-1) - S(r-1, c-1);
+
+	auto K = std::make_shared<const Mat<eT>>(kernel);
+
+	return LazyChan<eT>(width * height, width * height, [K, sat, width, height](uint input, Row<eT>& row) {
+		const Mat<eT>& K_ = *K;
+		const Mat<aT>& S = *sat;
+
+		uint cx = width - 1, cy = height - 1;
+		uint in_x = input % width, in_y = input / width;
+
+		// the output (ox,oy) gets the displacements with kernel column in [lo_x(ox), hi_x(ox)] (similarly for rows).
+		// This is the single column cx+ox-in_x, except for the border columns that also get everything outside.
+		auto lo = [](uint o, uint c, uint in)         { return o == 0 ? 0 : c + o - in; };
+		auto hi = [](uint o, uint c, uint in, uint n) { return o == n-1 ? 2*n - 2 : c + o - in; };
+
+		for(uint oy = 0; oy < height; oy++) {
+			uint ry1 = lo(oy, cy, in_y), ry2 = hi(oy, cy, in_y, height);
+
+			for(uint ox = 0; ox < width; ox++) {
+				uint rx1 = lo(ox, cx, in_x), rx2 = hi(ox, cx, in_x, width);
+
+				row(oy * width + ox) = ry1 == ry2 && rx1 == rx2
+					? K_(ry1, rx1)
+					: eT(S(ry2+1, rx2+1) - S(ry1, rx2+1) - S(ry2+1, rx1) + S(ry1, rx1));
+			}
+		}
+	});
+}
+
+} // namespace channel
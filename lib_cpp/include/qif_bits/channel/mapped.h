@@ -0,0 +1,168 @@
+namespace channel {
+
+// A channel stored row-major in a file and memory-mapped, for channels that do not fit in RAM (eg planar_laplace_grid
+// on a 200x200 grid is 40000x40000). Only the pages actually touched are loaded, and the OS can evict them at will.
+//
+// Since rows are contiguous, a block of rows is a zero-copy (read-only) armadillo view of the mapped memory, given as
+// its *transpose* (n_cols x n, one column per row of C). for_each_block visits the whole channel in such blocks, in the
+// calling thread. The measures (bayes_vuln, g_vuln, shannon posterior, utility::expected_distance) and
+// iterative_bayesian_update have overloads that stream over the blocks; lazy() gives a LazyChan for the rest.
+//
+// A MappedChan can also be a view of row-major data already in memory (eg a C-ordered numpy array), which is then
+// used without being copied or transposed.
+//
+template<typename eT>
+class MappedChan {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+
+	public:
+		uint n_rows, n_cols;
+		uint block_rows;				// rows per block in for_each_block
+
+		explicit MappedChan(const std::string& filename) : file(std::make_shared<const MappedFile>(filename)) {
+			binary::aux::MatHeader h = binary::aux::read_header(*file, filename);
+			if(h.elem != binary::aux::elem_code<eT>() || !h.row_major)
+				throw std::runtime_error(filename + ": not a row-major channel of this element type");
+			// the sizes are checked in 64 bits, without overflowing, before they are narrowed to uint
+			const uint64_t max_dim = std::numeric_limits<uint>::max();
+			if(h.n_rows > max_dim || h.n_cols > max_dim)
+				throw std::runtime_error(filename + ": channel too large");
+			if((h.n_rows != 0 && h.n_cols > h.data_bytes / sizeof(eT) / h.n_rows) || h.data_bytes != h.n_rows * h.n_cols * sizeof(eT))
+				throw std::runtime_error(filename + ": invalid size");
+
+			n_rows = h.n_rows;
+			n_cols = h.n_cols;
+			data = reinterpret_cast<const eT*>(file->begin() + sizeof(h));
+			block_rows = std::max<size_t>(1, default_block_bytes / std::max<size_t>(1, size_t(n_cols) * sizeof(eT)));
+		}
+
+		// view of row-major data owned by the caller, which should outlive the channel
+		MappedChan(const eT* data, uint n_rows, uint n_cols) : n_rows(n_rows), n_cols(n_cols), data(data) {
+			block_rows = std::max<size_t>(1, default_block_bytes / std::max<size_t>(1, size_t(n_cols) * sizeof(eT)));
+		}
+
+		// rows first, ..., first+n-1 as a read-only n_cols x n view (no copy)
+		const Mat<eT> rows_t(uint first, uint n) const {
+			if(first > n_rows || n > n_rows - first) throw std::runtime_error("rows out of bounds");
+			return Mat<eT>(const_cast<eT*>(data) + size_t(first) * n_cols, n_cols, n, false, true);
+		}
+
+		void row(uint x, Row<eT>& res) const {
+			if(x >= n_rows) throw std::runtime_error("row out of bounds");
+			res.set_size(n_cols);
+			std::copy(data + size_t(x) * n_cols, data + size_t(x+1) * n_cols, res.memptr());
+		}
+
+		// calls f(first, Bt) for consecutive blocks of rows, Bt being rows_t(first, ...)
+		template<typename F>
+		void for_each_block(F f) const {
+			for(uint first = 0; first < n_rows; first += block_rows) {
+				const Mat<eT> Bt = rows_t(first, std::min(block_rows, n_rows - first));
+				f(first, Bt);
+			}
+		}
+
+		LazyChan<eT> lazy() const {
+			auto self = *this;			// shares the mapping
+			return LazyChan<eT>(n_rows, n_cols, [self](uint x, Row<eT>& row) { self.row(x, row); });
+		}
+
+		Chan<eT> materialize() const {
+			return Chan<eT>(rows_t(0, n_rows).t());
+		}
+
+	private:
+		static const size_t default_block_bytes = 32 << 20;
+
+		std::shared_ptr<const MappedFile> file;
+		const eT* data;
+};
+
+template<typename eT>
+void check_prior_size(const Prob<eT>& pi, const MappedChan<eT>& C) {
+	if(C.n_rows != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+// posteriors (see posteriors for Chan), the result is a regular (column-major) matrix
+//
+template<typename eT>
+Mat<eT> posteriors(const MappedChan<eT>& C, const Prob<eT>& pi = {}) {
+	Mat<eT> res = C.materialize();
+	if(!pi.is_empty()) {
+		check_prior_size(pi, C);
+		res.each_col() %= pi.t();
+	}
+	res.each_row() /= arma::sum(res);
+	return res;
+}
+
+// Writes C in the row-major format read by MappedChan. The LazyChan version writes one row at a time, so channels
+// larger than RAM can be created.
+//
+template<typename eT>
+void write_mapped(const std::string& filename, const LazyChan<eT>& C) {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+
+	std::ofstream file(filename, std::ios::binary);
+	if(!file)
+		throw std::runtime_error("cannot open " + filename);
+
+	binary::aux::MatHeader h = binary::aux::make_header(binary::aux::elem_code<eT>(), true, C.n_rows, C.n_cols, uint64_t(C.n_rows) * C.n_cols * sizeof(eT));
+	file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+	Row<eT> row(C.n_cols);
+	for(uint x = 0; x < C.n_rows; x++) {
+		C.row(x, row);
+		file.write(reinterpret_cast<const char*>(row.memptr()), size_t(C.n_cols) * sizeof(eT));
+	}
+	if(!file)
+		throw std::runtime_error("cannot write " + filename);
+}
+
+template<typename eT>
+void write_mapped(const std::string& filename, const Chan<eT>& C) {
+	write_mapped(filename, LazyChan<eT>(C.n_rows, C.n_cols, [&C](uint x, Row<eT>& row) { row = C.row(x); }));
+}
+
+// Streaming version of iterative_bayesian_update, with a single pass over C per iteration: the new prior of a block
+// of rows only depends on the output of the previous prior, so the output of the new prior is accumulated in the
+// same pass.
+//
+template<typename eT>
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const MappedChan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0) {
+	eT almost_zero(1e-6);
+
+	Prob<eT> pi = start.is_empty() ? probab::uniform<eT>(C.n_rows) : start;
+
+	if(C.n_rows != pi.n_cols || C.n_cols != out.n_cols)
+		throw std::runtime_error("invalid sizes");
+
+	Col<eT> out_cur(C.n_cols, arma::fill::zeros);
+	C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+		out_cur += Bt * pi.cols(first, first + Bt.n_cols - 1).t();
+	});
+
+	Prob<eT> new_pi(C.n_rows);
+	Col<eT> new_out(C.n_cols);
+	for(uint count = 1; ; count++) {
+		out_cur.elem( find(out_cur < almost_zero) ).ones();		// see iterative_bayesian_update
+		Col<eT> ratio = out.t() / out_cur;
+
+		new_out.zeros();
+		C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+			uint last = first + Bt.n_cols - 1;
+			new_pi.cols(first, last) = pi.cols(first, last) % (ratio.t() * Bt);
+			new_out += Bt * new_pi.cols(first, last).t();
+		});
+
+		eT diff = qif::norm1(Prob<eT>(pi - new_pi));
+		pi = new_pi;
+		out_cur = new_out;
+
+		if(diff <= max_diff || count == max_reps)
+			return { pi, count };
+	}
+}
+
+} // namespace channel
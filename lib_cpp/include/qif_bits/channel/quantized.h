@@ -0,0 +1,201 @@
+namespace channel {
+
+// IEEE 754 half precision number (binary16), storage only
+//
+struct half {
+	uint16_t bits;
+};
+
+namespace aux {
+
+// float -> half, rounding to nearest even. Values too large for half become inf.
+inline uint16_t float_to_half(float f) {
+	uint32_t x;
+	std::memcpy(&x, &f, sizeof(x));
+	const uint32_t sign = (x >> 16) & 0x8000;
+	x &= 0x7fffffff;
+
+	if(x >= 0x47800000)									// >= 2^16, or inf/nan
+		return uint16_t(sign | (x > 0x7f800000 ? 0x7e00 : 0x7c00));
+	if(x < 0x38800000) {								// below 2^-14: subnormal half, multiples of 2^-24
+		float a;
+		std::memcpy(&a, &x, sizeof(a));
+		return uint16_t(sign | uint32_t(std::nearbyint(a * 16777216.0f)));
+	}
+	x -= 0x38000000;									// exponent bias 127 -> 15
+	x += 0x0fff + ((x >> 13) & 1);						// round the 13 dropped mantissa bits, ties to even
+	return uint16_t(sign | (x >> 13));
+}
+
+inline float half_to_float(uint16_t h) {
+	const uint32_t sign = uint32_t(h & 0x8000) << 16, e = (h >> 10) & 0x1f, m = h & 0x3ff;
+	if(e == 0) {
+		float r = float(m) * (1.0f / 16777216.0f);
+		return sign ? -r : r;
+	}
+	uint32_t x = sign | (e == 31 ? 0x7f800000 | (m << 13) : ((e + 112) << 23) | (m << 13));
+	float f;
+	std::memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+// How the entries of a row, scaled to [0, range], are stored. error is the maximum absolute difference between a
+// value in [0, range] and its decoding.
+//
+template<typename Q>
+struct Codec {
+	static_assert(std::is_same<Q, uint8_t>::value || std::is_same<Q, uint16_t>::value, "unsupported code type");
+
+	static constexpr double range = double(std::numeric_limits<Q>::max());
+	static constexpr double error = 0.5;
+
+	static Q encode(double v)			{ return Q(std::min(range, std::floor(v + 0.5))); }
+	static float decode(Q q)			{ return float(q); }
+};
+
+template<>
+struct Codec<half> {
+	static constexpr double range = 1;
+	static constexpr double error = 1.0 / 2048 + 1.0 / 33554432;	// half ulp of [0.5, 1] (the largest), plus the
+																	// rounding to float before encoding
+
+	static half encode(double v)		{ return { float_to_half(float(v)) }; }
+	static float decode(half q)			{ return half_to_float(q.bits); }
+};
+
+} // namespace aux
+
+// A channel stored in compressed form: each row x is scaled by scale(x) (its maximum divided by the codec's range)
+// and its entries are stored as 8 or 16-bit integers (Q = uint8_t, uint16_t) or as IEEE half (Q = half), row-major.
+// That is 4-8x less memory than a double channel, and the measures that are limited by memory bandwidth
+// (bayes_vuln::posterior, l_risk/g_vuln::posterior, utility::expected_distance) have overloads that decode the entries
+// while streaming over the rows. Their results differ from the uncompressed ones by at most the bound given by the
+// corresponding *_error function, computed from the per-entry bound max_error(x) of each row.
+//
+// Mechanism channels (planar_laplace_grid, exponential) have rows with a small dynamic range, so a row's scale is a
+// good fit for all its entries. Rows can be encoded one at a time from a LazyChan, so the dense channel is never
+// materialized.
+//
+//     channel::QuantizedChan<double, uint16_t> Q(mechanism::geo_ind::planar_laplace_grid_lazy<double>(100, 100, 1, 0.1));
+//     double V = measure::bayes_vuln::posterior(pi, Q), err = measure::bayes_vuln::posterior_error(pi, Q);
+//
+template<typename eT, typename Q = uint16_t>
+class QuantizedChan {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+	typedef aux::Codec<Q> codec;
+
+	public:
+		uint n_rows, n_cols;
+		uint block_rows = 64;			// rows decoded at once by the block-based kernels
+
+		explicit QuantizedChan(const LazyChan<eT>& C) : n_rows(C.n_rows), n_cols(C.n_cols) {
+			auto codes_ = std::make_shared<std::vector<Q>>(size_t(n_rows) * n_cols);
+			auto scales_ = std::make_shared<std::vector<eT>>(n_rows);
+
+			Row<eT> row;
+			for(uint x = 0; x < n_rows; x++) {
+				C.row(x, row);
+				encode_row(x, row, codes_->data() + size_t(x) * n_cols, (*scales_)[x]);
+			}
+			codes = codes_;
+			scales = scales_;
+		}
+
+		explicit QuantizedChan(const Chan<eT>& C)
+			: QuantizedChan(LazyChan<eT>(C.n_rows, C.n_cols, [&C](uint x, Row<eT>& row) { row = C.row(x); })) {}
+
+		eT scale(uint x) const				{ return (*scales)[x]; }
+
+		// bound to |C(x,y) - decoded C(x,y)| for all y (the codec's error, plus the rounding of the scaling in eT)
+		eT max_error(uint x) const {
+			return scale(x) * eT(codec::error + 2 * codec::range * std::numeric_limits<eT>::epsilon());
+		}
+
+		// max_error for all rows
+		Col<eT> max_errors() const {
+			Col<eT> res(n_rows);
+			for(uint x = 0; x < n_rows; x++)
+				res(x) = max_error(x);
+			return res;
+		}
+
+		// the codes of row x, decoded as scale(x) * codec::decode(codes[y])
+		const Q* row_codes(uint x) const	{ return codes->data() + size_t(x) * n_cols; }
+
+		void row(uint x, Row<eT>& res) const {
+			if(x >= n_rows) throw std::runtime_error("row out of bounds");
+			res.set_size(n_cols);
+			decode(x, res.memptr());
+		}
+
+		// rows first, ..., first+n-1, decoded into res as an n_cols x n matrix (one column per row, as in MappedChan)
+		void rows_t(uint first, uint n, Mat<eT>& res) const {
+			if(first + n > n_rows) throw std::runtime_error("rows out of bounds");
+			res.set_size(n_cols, n);
+			for(uint k = 0; k < n; k++)
+				decode(first + k, res.colptr(k));
+		}
+
+		// calls f(first, Bt) for consecutive blocks of decoded rows, Bt being rows_t(first, ...)
+		template<typename F>
+		void for_each_block(F f) const {
+			Mat<eT> Bt;
+			for(uint first = 0; first < n_rows; first += block_rows) {
+				rows_t(first, std::min(block_rows, n_rows - first), Bt);
+				f(first, Bt);
+			}
+		}
+
+		LazyChan<eT> lazy() const {
+			auto self = *this;			// shares the codes
+			return LazyChan<eT>(n_rows, n_cols, [self](uint x, Row<eT>& row) { self.row(x, row); });
+		}
+
+		Chan<eT> materialize() const {
+			Chan<eT> C(n_rows, n_cols);
+			Row<eT> r;
+			for(uint x = 0; x < n_rows; x++) {
+				row(x, r);
+				C.row(x) = r;
+			}
+			return C;
+		}
+
+		// memory used by the codes and scales
+		size_t bytes() const {
+			return codes->size() * sizeof(Q) + scales->size() * sizeof(eT);
+		}
+
+	private:
+		std::shared_ptr<const std::vector<Q>> codes;
+		std::shared_ptr<const std::vector<eT>> scales;
+
+		void decode(uint x, eT* res) const {
+			const Q* q = row_codes(x);
+			const eT s = scale(x);
+			for(uint y = 0; y < n_cols; y++)
+				res[y] = s * eT(codec::decode(q[y]));
+		}
+
+		static void encode_row(uint x, const Row<eT>& row, Q* q, eT& s) {
+			eT row_max(0);
+			for(uint y = 0; y < row.n_elem; y++) {
+				if(!(row(y) >= eT(0)))
+					throw std::runtime_error("row " + std::to_string(x) + " has negative or nan entries");
+				row_max = std::max(row_max, row(y));
+			}
+			s = row_max / eT(codec::range);
+
+			const double inv = row_max > eT(0) ? codec::range / double(row_max) : 0;
+			for(uint y = 0; y < row.n_elem; y++)
+				q[y] = codec::encode(double(row(y)) * inv);
+		}
+};
+
+template<typename eT, typename Q>
+void check_prior_size(const Prob<eT>& pi, const QuantizedChan<eT, Q>& C) {
+	if(C.n_rows != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+} // namespace channel
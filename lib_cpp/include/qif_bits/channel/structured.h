@@ -0,0 +1,469 @@
+namespace channel {
+
+// Structured channels of the d-privacy mechanisms (see mechanism::d_privacy::randomized_response_chan, geometric_chan,
+// exponential_chan) and deterministic channels (DetChan), stored in O(n) memory instead of n x n. Products with vectors cost O(n), and bayes_vuln,
+// g_vuln/l_risk (for a dense G/L, in O(|W| n)), posterior(C, pi, y), sample and iterative_bayesian_update have
+// overloads that never build the matrix. op() gives an OperatorChan, materialize() the dense channel.
+//
+
+// Randomized response on n values: C(x,x) = diag, C(x,y) = off for x != y. Since C = (diag-off) I + off 1 1^T,
+// C is symmetric and products cost O(n).
+//
+template<typename eT>
+class RRChan {
+	public:
+		uint n_rows, n_cols;
+		eT diag, off;
+
+		RRChan(uint n, eT diag, eT off) : n_rows(n), n_cols(n), diag(diag), off(off) {}
+
+		eT operator()(uint x, uint y) const	{ return x == y ? diag : off; }
+
+		void row(uint x, Row<eT>& res) const {
+			if(x >= n_rows) throw std::runtime_error("row out of bounds");
+			res.set_size(n_cols);
+			res.fill(off);
+			res(x) = diag;
+		}
+
+		void col(uint y, Col<eT>& res) const {
+			if(y >= n_cols) throw std::runtime_error("column out of bounds");
+			res.set_size(n_rows);
+			res.fill(off);
+			res(y) = diag;
+		}
+
+		// res = v C, which is also (C v^T)^T since C is symmetric
+		void left(const Row<eT>& v, Row<eT>& res) const {
+			eT sum = arma::accu(v);
+			res = (diag - off) * v;
+			res += off * sum;
+		}
+		void right(const Row<eT>& v, Row<eT>& res) const	{ left(v, res); }
+
+		Chan<eT> materialize() const {
+			Chan<eT> C(n_rows, n_cols);
+			C.fill(off);
+			C.diag().fill(diag);
+			return C;
+		}
+
+		OperatorChan<eT> op() const {
+			auto self = *this;
+			auto prod = [self](const Row<eT>& v, Row<eT>& res) { self.left(v, res); };
+			return { n_rows, n_cols, prod, prod };
+		}
+
+		// an output of input x, in O(1)
+		template<typename G>
+		uint sample_output(uint x, G& gen) const {
+			if(n_cols == 1 || rng::randu<double>(gen) < to_double(diag))
+				return x;
+			uint y = uint(rng::randu<double>(gen) * (n_cols - 1));		// uniform among the other outputs
+			y = std::min(y, n_cols - 2);
+			return y >= x ? y + 1 : y;
+		}
+};
+
+// Square channel C(x,y) = a_x b_y r^|x-y| on n values, where the column weights b_y are b_mid except for the first
+// and last column (b_first, b_last), and a_x normalizes the rows. This is the truncated geometric (a = 1, larger
+// weights in the border columns, which collect the mass of the truncated tails) and the exponential mechanism for the
+// metric eps |x-y| (b = 1).
+//
+// Products reduce to the filter f(v)_y = sum_x v_x r^|x-y|, computed in O(n) by one forward and one backward pass,
+// and max_x v_x r^|x-y| (for bayes_vuln) similarly.
+//
+template<typename eT>
+class GeometricChan {
+	public:
+		uint n_rows, n_cols;
+		eT r, b_first, b_mid, b_last;
+		Row<eT> a;							// row normalizers
+
+		// if normalize is false, the rows are assumed to be already normalized (a = 1)
+		GeometricChan(uint n, eT r, eT b_first, eT b_mid, eT b_last, bool normalize = true)
+			: n_rows(n), n_cols(n), r(r), b_first(b_first), b_mid(b_mid), b_last(b_last) {
+			if(n < 2) throw std::runtime_error("n should be at least 2");
+
+			rpow.set_size(n);
+			rpow(0) = eT(1);
+			for(uint k = 1; k < n; k++)
+				rpow(k) = rpow(k-1) * r;
+
+			if(normalize) {
+				filter(col_weights(), a);	// a_x = 1 / sum_y b_y r^|x-y|
+				a.transform([](eT z) { return eT(1) / z; });
+			} else {
+				a.ones(n);
+			}
+		}
+
+		eT b(uint y) const					{ return y == 0 ? b_first : y == n_cols-1 ? b_last : b_mid; }
+		eT operator()(uint x, uint y) const	{ return a(x) * b(y) * rpow(x < y ? y - x : x - y); }
+
+		Row<eT> col_weights() const {
+			Row<eT> res(n_cols);
+			res.fill(b_mid);
+			res(0) = b_first;
+			res(n_cols-1) = b_last;
+			return res;
+		}
+
+		void row(uint x, Row<eT>& res) const {
+			if(x >= n_rows) throw std::runtime_error("row out of bounds");
+			res.set_size(n_cols);
+			for(uint y = 0; y < n_cols; y++)
+				res(y) = (*this)(x, y);
+		}
+
+		void col(uint y, Col<eT>& res) const {
+			if(y >= n_cols) throw std::runtime_error("column out of bounds");
+			res.set_size(n_rows);
+			for(uint x = 0; x < n_rows; x++)
+				res(x) = (*this)(x, y);
+		}
+
+		// res = v C
+		void left(const Row<eT>& v, Row<eT>& res) const {
+			filter(Row<eT>(v % a), res);
+			res %= col_weights();
+		}
+
+		// res = (C v^T)^T
+		void right(const Row<eT>& v, Row<eT>& res) const {
+			filter(Row<eT>(v % col_weights()), res);
+			res %= a;
+		}
+
+		// res_y = max_x v_x r^|x-y|, arg_y the maximizing x (the first one on ties)
+		void max_filter(const Row<eT>& v, Row<eT>& res, Row<uint>& arg) const {
+			uint n = v.n_elem;
+			res.set_size(n);
+			arg.set_size(n);
+			for(uint i = 0; i < n; i++) {				// forward: max over x <= y
+				res(i) = v(i);
+				arg(i) = i;
+				if(i > 0 && r * res(i-1) >= res(i)) {
+					res(i) = r * res(i-1);
+					arg(i) = arg(i-1);
+				}
+			}
+			eT acc(0);									// backward: acc = max_{x > i} v_x r^(x-i)
+			uint acc_arg = n;
+			for(uint i = n; i-- > 0; ) {
+				if(acc_arg < n && acc > res(i)) {
+					res(i) = acc;
+					arg(i) = acc_arg;
+				}
+				if(acc_arg == n || v(i) >= acc) {
+					acc = v(i);
+					acc_arg = i;
+				}
+				acc *= r;
+			}
+		}
+
+		Chan<eT> materialize() const {
+			Chan<eT> C(n_rows, n_cols);
+			for(uint y = 0; y < n_cols; y++)
+				for(uint x = 0; x < n_rows; x++)
+					C(x, y) = (*this)(x, y);
+			return C;
+		}
+
+		OperatorChan<eT> op() const {
+			auto self = std::make_shared<const GeometricChan>(*this);
+			return {
+				n_rows, n_cols,
+				[self](const Row<eT>& v, Row<eT>& res) { self->left(v, res); },
+				[self](const Row<eT>& v, Row<eT>& res) { self->right(v, res); },
+			};
+		}
+
+		// an output of input x, in O(1): we choose between y = x, the two border columns and the interior columns on
+		// each side of x (geometrically decreasing weights, sampled by inversion)
+		template<typename G>
+		uint sample_output(uint x, G& gen) const {
+			const uint n = n_cols;
+			const double rd = to_double(r), bm = to_double(b_mid);
+
+			// sum_{k=1}^K r^k, and k in [1, K] with probability ~ r^k
+			auto geo_sum = [rd](uint K) { return rd == 1 ? double(K) : rd * (1 - std::pow(rd, K)) / (1 - rd); };
+			auto geo_sample = [rd, &gen](uint K) -> uint {
+				double u = rng::randu<double>(gen);
+				uint k = rd == 1 ? 1 + uint(u * K) : 1 + uint(std::log(1 - u * (1 - std::pow(rd, K))) / std::log(rd));
+				return std::max(1u, std::min(k, K));
+			};
+
+			uint K_left  = x > 1 ? x - 1 : 0,			// interior columns [1, x-1] and [x+1, n-2]
+				 K_right = x + 2 < n ? n - 2 - x : 0;
+			double mass[5] = {
+				to_double(b(x)),										// y = x
+				x > 0     ? to_double(b_first) * std::pow(rd, x)     : 0,	// y = 0
+				x < n - 1 ? to_double(b_last) * std::pow(rd, n-1-x) : 0,	// y = n-1
+				K_left  ? bm * geo_sum(K_left)  : 0,
+				K_right ? bm * geo_sum(K_right) : 0,
+			};
+			double t = rng::randu<double>(gen) * (mass[0] + mass[1] + mass[2] + mass[3] + mass[4]);
+			uint part = 0;
+			for(; part < 4; part++) {
+				if(t < mass[part]) break;
+				t -= mass[part];
+			}
+			while(mass[part] == 0 && part > 0)		// rounding at the end of the range
+				part--;
+
+			switch(part) {
+				case 0:  return x;
+				case 1:  return 0;
+				case 2:  return n - 1;
+				case 3:  return x - geo_sample(K_left);
+				default: return x + geo_sample(K_right);
+			}
+		}
+
+	private:
+		Row<eT> rpow;						// r^k, k = 0..n-1
+
+		void filter(const Row<eT>& v, Row<eT>& res) const {
+			uint n = v.n_elem;
+			res.set_size(n);
+			eT acc(0);
+			for(uint i = 0; i < n; i++)					// forward: sum over x <= y
+				res(i) = acc = v(i) + r * acc;
+			acc = eT(0);
+			for(uint i = n; i-- > 0; ) {				// backward: sum over x > y
+				res(i) += r * acc;
+				acc = v(i) + r * acc;
+			}
+		}
+};
+
+// Deterministic channel C(x, map(x)) = 1, stored as the output index of each input (the matrix of
+// channel::deterministic(map, n_cols)). Inputs with the same output form a block, so the measures only depend on
+// the partition of the inputs: bayes_vuln sums the largest pi_x of each block, the Shannon leakage is the entropy of
+// the block masses. left is a scatter-add and right a gather, both O(n); compose::cascade with a dense channel is a
+// column scatter-add (C D) or a row gather (D C), without the matrix product.
+//
+template<typename eT>
+class DetChan {
+	public:
+		uint n_rows, n_cols;
+		arma::ucolvec map;
+
+		DetChan(const arma::ucolvec& map, uint n_cols) : n_rows(map.n_elem), n_cols(n_cols), map(map) {
+			for(uint x = 0; x < n_rows; x++)
+				if(map(x) >= n_cols)
+					throw std::runtime_error("map value out of range");
+		}
+
+		// from a dense 0/1 channel, throws if C is not deterministic
+		explicit DetChan(const Chan<eT>& C) : n_rows(C.n_rows), n_cols(C.n_cols), map(C.n_rows) {
+			for(uint x = 0; x < n_rows; x++) {
+				uint ones = 0;
+				for(uint y = 0; y < n_cols; y++) {
+					if(C(x, y) == eT(1)) {
+						map(x) = y;
+						ones++;
+					} else if(C(x, y) != eT(0)) {
+						ones = 2;
+						break;
+					}
+				}
+				if(ones != 1)
+					throw std::runtime_error("channel is not deterministic");
+			}
+		}
+
+		eT operator()(uint x, uint y) const	{ return map(x) == y ? eT(1) : eT(0); }
+
+		void row(uint x, Row<eT>& res) const {
+			if(x >= n_rows) throw std::runtime_error("row out of bounds");
+			res.zeros(n_cols);
+			res(map(x)) = eT(1);
+		}
+
+		void col(uint y, Col<eT>& res) const {
+			if(y >= n_cols) throw std::runtime_error("column out of bounds");
+			res.zeros(n_rows);
+			for(uint x = 0; x < n_rows; x++)
+				if(map(x) == y)
+					res(x) = eT(1);
+		}
+
+		// res = v C, res_y = sum of v_x over the block of y
+		void left(const Row<eT>& v, Row<eT>& res) const {
+			res.zeros(n_cols);
+			for(uint x = 0; x < n_rows; x++)
+				res(map(x)) += v(x);
+		}
+
+		// res = (C v^T)^T, res_x = v_map(x)
+		void right(const Row<eT>& v, Row<eT>& res) const {
+			res.set_size(n_rows);
+			for(uint x = 0; x < n_rows; x++)
+				res(x) = v(map(x));
+		}
+
+		Chan<eT> materialize() const	{ return deterministic<eT>(map, n_cols); }
+		SpChan<eT> sparse() const		{ return deterministic_sparse<eT>(map, n_cols); }
+
+		OperatorChan<eT> op() const {
+			auto self = std::make_shared<const DetChan>(*this);
+			return {
+				n_rows, n_cols,
+				[self](const Row<eT>& v, Row<eT>& res) { self->left(v, res); },
+				[self](const Row<eT>& v, Row<eT>& res) { self->right(v, res); },
+			};
+		}
+
+		template<typename G>
+		uint sample_output(uint x, G&) const	{ return map(x); }
+};
+
+namespace compose {
+
+// A D = remap(A, D.map), O(size of A)
+template<typename eT>
+Chan<eT> cascade(const Chan<eT>& A, const DetChan<eT>& D) {
+	if(A.n_cols != D.n_rows)
+		throw std::runtime_error("invalid channel sizes");
+	return remap(A, D.map, D.n_cols);
+}
+
+// D B: row x is row map(x) of B
+template<typename eT>
+Chan<eT> cascade(const DetChan<eT>& D, const Chan<eT>& B) {
+	if(D.n_cols != B.n_rows)
+		throw std::runtime_error("invalid channel sizes");
+	return B.rows(D.map);
+}
+
+// D1 D2: composition of the maps
+template<typename eT>
+DetChan<eT> cascade(const DetChan<eT>& D1, const DetChan<eT>& D2) {
+	if(D1.n_cols != D2.n_rows)
+		throw std::runtime_error("invalid channel sizes");
+	return DetChan<eT>(arma::ucolvec(D2.map.elem(D1.map)), D2.n_cols);
+}
+
+} // namespace compose
+
+template<typename eT>
+void check_prior_size(const Prob<eT>& pi, const RRChan<eT>& C) {
+	if(C.n_rows != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+template<typename eT>
+void check_prior_size(const Prob<eT>& pi, const GeometricChan<eT>& C) {
+	if(C.n_rows != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+template<typename eT>
+void check_prior_size(const Prob<eT>& pi, const DetChan<eT>& C) {
+	if(C.n_rows != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+// posterior for output y, in O(n)
+//
+template<typename eT>
+Prob<eT> posterior(const RRChan<eT>& C, const Prob<eT>& pi, uint y) {
+	Col<eT> c;
+	C.col(y, c);
+	return (c.t() % pi) / arma::dot(c, pi);
+}
+
+template<typename eT>
+Prob<eT> posterior(const GeometricChan<eT>& C, const Prob<eT>& pi, uint y) {
+	Col<eT> c;
+	C.col(y, c);
+	return (c.t() % pi) / arma::dot(c, pi);
+}
+
+// pi restricted to the block of y
+template<typename eT>
+Prob<eT> posterior(const DetChan<eT>& C, const Prob<eT>& pi, uint y) {
+	Col<eT> c;
+	C.col(y, c);
+	return (c.t() % pi) / arma::dot(c, pi);
+}
+
+template<typename eT>
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const RRChan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0, const std::string& method = "em",
+	const checkpoint::Hook<IbuState<eT>>& hook = {}) {
+	return aux::iterative_bayesian_update(C.op(), out, start, max_diff, max_reps, method, hook);
+}
+
+template<typename eT>
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const GeometricChan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0, const std::string& method = "em",
+	const checkpoint::Hook<IbuState<eT>>& hook = {}) {
+	return aux::iterative_bayesian_update(C.op(), out, start, max_diff, max_reps, method, hook);
+}
+
+template<typename eT>
+std::pair<Prob<eT>, uint> iterative_bayesian_update(const DetChan<eT>& C, const Prob<eT>& out, const Prob<eT>& start = {}, eT max_diff = eT(1e-6), uint max_reps = 0, const std::string& method = "em",
+	const checkpoint::Hook<IbuState<eT>>& hook = {}) {
+	return aux::iterative_bayesian_update(C.op(), out, start, max_diff, max_reps, method, hook);
+}
+
+namespace aux {
+
+// n (x, y) pairs, x from an alias table for pi, y from C.sample_output in O(1)
+template<typename eT, typename CT>
+Mat<uint> sample_structured(const CT& C, const Prob<eT>& pi, uint n, uint64_t seed) {
+	check_prior_size(pi, C);
+
+	probab::AliasSampler input(pi);
+	Mat<uint> res(n, 2);
+	uint* xs = res.colptr(0);
+	uint* ys = res.colptr(1);
+	rng::parallel_streams(n, seed, [&](rng::Engine& gen, size_t begin, size_t end) {
+		for(size_t k = begin; k < end; k++) {
+			xs[k] = input(gen);
+			ys[k] = C.sample_output(xs[k], gen);
+		}
+	});
+	return res;
+}
+
+} // namespace aux
+
+// sample an input, then an output (single pair / n x 2 matrix, as for Chan)
+//
+template<typename eT>
+std::pair<uint,uint> sample(const RRChan<eT>& C, const Prob<eT>& pi) {
+	uint x = probab::sample<eT>(pi);
+	return { x, C.sample_output(x, rng::aux::thread_engine()) };
+}
+
+template<typename eT>
+std::pair<uint,uint> sample(const GeometricChan<eT>& C, const Prob<eT>& pi) {
+	uint x = probab::sample<eT>(pi);
+	return { x, C.sample_output(x, rng::aux::thread_engine()) };
+}
+
+template<typename eT>
+std::pair<uint,uint> sample(const DetChan<eT>& C, const Prob<eT>& pi) {
+	uint x = probab::sample<eT>(pi);
+	return { x, C.map(x) };
+}
+
+template<typename eT>
+Mat<uint> sample(const RRChan<eT>& C, const Prob<eT>& pi, uint n) {
+	return aux::sample_structured(C, pi, n, rng::random_seed());
+}
+
+template<typename eT>
+Mat<uint> sample(const GeometricChan<eT>& C, const Prob<eT>& pi, uint n) {
+	return aux::sample_structured(C, pi, n, rng::random_seed());
+}
+
+template<typename eT>
+Mat<uint> sample(const DetChan<eT>& C, const Prob<eT>& pi, uint n) {
+	return aux::sample_structured(C, pi, n, rng::random_seed());
+}
+
+} // namespace channel
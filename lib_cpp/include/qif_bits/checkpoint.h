@@ -0,0 +1,151 @@
+namespace checkpoint {
+
+// Checkpointing of long-running iterative algorithms (shannon::add_capacity_bounds, games::minmax_hidden_bayes,
+// channel::factorize_subgrad, channel::iterative_bayesian_update). Each of them has a State struct holding everything
+// needed to continue its iterations, and takes an optional Hook<State>: save is called with the current state every
+// `every` iterations, and if resume is set the iterations continue from that state instead of starting over (the
+// other arguments have to be the same as in the run that produced it). Resuming gives the same iterates as an
+// uninterrupted run, up to the time limits, which restart.
+//
+// States are packed into a single column (see Writer/Reader) and stored in the binary format, file() gives a hook
+// that saves to a file and resumes from it if it exists, so a pre-empted run is restarted by just running it again:
+//
+//     auto hook = checkpoint::file<measure::shannon::CapacityState<double>>("capacity.ckpt", 100);
+//     auto [IL, IU, Px] = measure::shannon::add_capacity_bounds(C, md, mrd, max_iter, max_time, true, hook);
+//
+
+template<typename State>
+struct Hook {
+	uint every = 0;								// iterations between calls of save (0: never)
+	std::function<void(const State&)> save;
+	std::optional<State> resume;				// continue from this state
+
+	// true (and last updated) if a state should be saved at iteration iter
+	bool due(uint iter, uint& last) const {
+		if(every == 0 || !save || iter < last + every)
+			return false;
+		last = iter;
+		return true;
+	}
+};
+
+// Flattens scalars, counts and matrices into a single column. Counts are stored as two 16-bit halves, so that they
+// are exact also for float.
+//
+template<typename eT>
+class Writer {
+	public:
+		Writer& put(const eT& x) {
+			data.push_back(x);
+			return *this;
+		}
+		Writer& put(uint n) {
+			data.push_back(eT(n >> 16));
+			data.push_back(eT(n & 0xffff));
+			return *this;
+		}
+		Writer& put(bool b) {
+			return put(uint(b));
+		}
+		Writer& put(const Mat<eT>& M) {
+			put(uint(M.n_rows)).put(uint(M.n_cols));
+			data.insert(data.end(), M.begin(), M.end());
+			return *this;
+		}
+
+		Col<eT> col() const {
+			Col<eT> res(data.size());
+			for(uint i = 0; i < res.n_elem; i++)
+				res(i) = data[i];
+			return res;
+		}
+
+	private:
+		std::vector<eT> data;
+};
+
+template<typename eT>
+class Reader {
+	public:
+		explicit Reader(const Mat<eT>& data) : data(data) {}
+
+		Reader& get(eT& x) {
+			x = next();
+			return *this;
+		}
+		Reader& get(uint& n) {
+			uint hi = to_uint(next());
+			n = (hi << 16) | to_uint(next());
+			return *this;
+		}
+		Reader& get(bool& b) {
+			uint n;
+			get(n);
+			b = n != 0;
+			return *this;
+		}
+		template<typename T, typename = std::enable_if_t<arma::is_Mat<T>::value>>
+		Reader& get(T& M) {
+			uint n_rows, n_cols;
+			get(n_rows).get(n_cols);
+			M.set_size(n_rows, n_cols);
+			for(uint i = 0; i < M.n_elem; i++)
+				M(i) = next();
+			return *this;
+		}
+
+	private:
+		const Mat<eT>& data;
+		uint pos = 0;
+
+		eT next() {
+			if(pos >= data.n_elem)
+				throw std::runtime_error("checkpoint: truncated state");
+			return data(pos++);
+		}
+		static uint to_uint(const eT& x) {
+			if constexpr (std::is_same<eT, rat>::value)
+				return uint(to_double(x));
+			else
+				return uint(x);
+		}
+};
+
+// Writes s to filename (through a temporary file and a rename, so that a crash never leaves a partial checkpoint)
+//
+template<typename State>
+void save(const std::string& filename, const State& s) {
+	namespace fs = std::filesystem;
+	const std::string tmp = filename + ".tmp-" + std::to_string(rng::random_seed());
+	try {
+		binary::save(tmp, Mat<typename State::elem_type>(s.pack()));
+		fs::rename(tmp, filename);
+	} catch(std::exception&) {
+		std::error_code ec;
+		fs::remove(tmp, ec);
+		throw;
+	}
+}
+
+// The state saved in filename, if the file exists
+//
+template<typename State>
+std::optional<State> load(const std::string& filename) {
+	std::error_code ec;
+	if(!std::filesystem::exists(filename, ec))
+		return {};
+	return State::unpack(binary::load<typename State::elem_type>(filename));
+}
+
+// A hook saving the state to filename every `every` iterations, and resuming from it if it exists
+//
+template<typename State>
+Hook<State> file(const std::string& filename, uint every) {
+	Hook<State> res;
+	res.every = every;
+	res.save = [filename](const State& s) { save(filename, s); };
+	res.resume = load<State>(filename);
+	return res;
+}
+
+} // namespace checkpoint
@@ -3,4 +3,6 @@
 //
 #cmakedefine QIF_USE_ORTOOLS
 #cmakedefine QIF_USE_GLPK
+#cmakedefine QIF_USE_CUDA
+#cmakedefine QIF_TRACE
 #cmakedefine QIF_VERSION "@QIF_VERSION@"
@@ -4,6 +4,13 @@ namespace games {
 using std::vector;
 
 
+// f(delta) = max_a sum_y max_x pi(x) sum_d delta(d) Cs[a][d](x,y), the vulnerability of a hidden choice game in which
+// the defender picks channel Cs[a][d] with probability delta(d) and the adversary (knowing delta, not d) picks a.
+// Returns f(delta) and stores a subgradient in subgrad.
+//
+// Adversary actions are evaluated in parallel. For each one, the mixed joint pi(x) sum_d delta(d) Cs[a][d](x,y) is
+// built once, so the inner loops do not allocate.
+//
 template<typename eT>
 eT
 bayes_subgradient(const Prob<eT>& pi, const vector<vector<Chan<eT>>>& Cs, const Prob<eT>& delta, arma::Row<eT>& subgrad) {
@@ -12,66 +19,184 @@ bayes_subgradient(const Prob<eT>& pi, const vector<vector<Chan<eT>>>& Cs, const
 	uint n_rows = Cs[0][0].n_rows;
 	uint n_cols = Cs[0][0].n_cols;
 
-	eT max(-1);
+	vector<eT> vals(n_adv);
+	Mat<eT> grads(n_def, n_adv, arma::fill::zeros);		// subgradient of each adversary action
 
-	for(uint a = 0; a < n_adv; a++) {	// max_a
+	parallel::for_each(n_adv, [&](uint a) {
+		Mat<eT> J = delta(0) * Cs[a][0];
+		for(uint d = 1; d < n_def; d++)
+			J += delta(d) * Cs[a][d];
+		J.each_col() %= pi.t();
 
-		arma::Row<eT> subgrad_temp(n_def);
-		subgrad_temp.fill(0);
 		eT sumy(0);
+		for(uint y = 0; y < n_cols; y++) {	// sum_y
+			uint max_x = 0;
+			for(uint x = 1; x < n_rows; x++)	// max_x
+				if(J(x, y) > J(max_x, y))
+					max_x = x;
+
+			sumy += J(max_x, y);
+			for(uint d = 0; d < n_def; d++)
+				grads(d, a) += pi(max_x) * Cs[a][d](max_x, y);
+		}
+		vals[a] = sumy;
+	});
 
-		for(uint y = 0; y < n_cols; y++) { //sum_y
+	uint max_a = 0;									// max_a
+	for(uint a = 1; a < n_adv; a++)
+		if(vals[a] > vals[max_a])
+			max_a = a;
 
-			arma::Row<eT> subgrad2;
-			eT max2(-1);
+	subgrad = grads.col(max_a).t();
+	return vals[max_a];
+}
 
-			for(uint x = 0; x < n_rows; x++) {
-				arma::Row<eT> subgrad2_temp(n_def);
-				for(uint d = 0; d < n_def; d++)
-					subgrad2_temp(d) = pi(x) * Cs[a][d](x, y);
+// Exact solution of min_delta f(delta) (see bayes_subgradient) as a linear program:
+//   min t   subject to   t >= sum_y u_{a,y}                                 for all a
+//                        u_{a,y} >= sum_d delta(d) pi(x) Cs[a][d](x,y)      for all a, y, x
+//                        delta in the probability simplex
+// with n_adv * n_cols * n_rows constraints, each with n_def+1 coefficients. Fast for small games, and exact for rat.
+//
+template<typename eT>
+std::pair<eT, Prob<eT>>
+minmax_hidden_bayes_lp(const Prob<eT>& pi, const vector<vector<Chan<eT>>>& Cs) {
+	uint n_adv = Cs.size();
+	uint n_def = Cs[0].size();
+	uint n_rows = Cs[0][0].n_rows;
+	uint n_cols = Cs[0][0].n_cols;
+	eT inf = infinity<eT>();
 
-				eT z = arma::cdot(delta, subgrad2_temp);
-				if(z > max2) {
-					max2 = z;
-					subgrad2 = subgrad2_temp;
-				}
-			} // max_x
+	lp::LinearProgram<eT> lp;
+	auto delta = lp.make_vars(n_def, eT(0), eT(1));
+	auto u = lp.make_vars(n_adv, n_cols, eT(0), inf);
+	auto t = lp.make_var(eT(0), inf);
 
-			subgrad_temp += subgrad2;
-			sumy += max2;
-		} // sum_y
+	lp.maximize = false;
+	lp.set_obj_coeff(t, eT(1));
 
-		if(sumy > max) {
-			subgrad = subgrad_temp;
-			max = sumy;
+	auto con = lp.make_con(eT(1), eT(1));			// sum_d delta(d) = 1
+	for(uint d = 0; d < n_def; d++)
+		lp.set_con_coeff(con, delta[d], eT(1));
+
+	lp.reserve_con_coeffs(size_t(n_adv) * n_cols * (n_rows * (n_def + 1) + 1) + n_def);
+	for(uint a = 0; a < n_adv; a++) {
+		con = lp.make_con(eT(0), inf);				// t - sum_y u_{a,y} >= 0
+		lp.set_con_coeff(con, t, eT(1));
+		for(uint y = 0; y < n_cols; y++)
+			lp.set_con_coeff(con, u[a][y], eT(-1));
+
+		for(uint y = 0; y < n_cols; y++) {
+			for(uint x = 0; x < n_rows; x++) {
+				con = lp.make_con(eT(0), inf);		// u_{a,y} - sum_d pi(x) Cs[a][d](x,y) delta(d) >= 0
+				lp.set_con_coeff(con, u[a][y], eT(1));
+				for(uint d = 0; d < n_def; d++)
+					lp.set_con_coeff(con, delta[d], -pi(x) * Cs[a][d](x, y));
+			}
 		}
-	} // max_a
+	}
+
+	if(!lp.solve())
+		throw std::runtime_error("minmax_hidden_bayes_lp: lp should be always solvable");
 
-	return max;
+	Prob<eT> res(n_def);
+	for(uint d = 0; d < n_def; d++)
+		res(d) = lp.solution(delta[d]);
+	return std::pair<eT, Prob<eT>>(lp.objective(), res);
 }
 
+// State of the subgradient methods of minmax_hidden_bayes, for checkpointing (see checkpoint.h)
+//
+template<typename eT>
+struct HiddenBayesState {
+	typedef eT elem_type;
+
+	uint k = 1;								// next iteration
+	Prob<eT> delta, delta_best;
+	eT f_best, l_best, g_max, sum_alpha, sum_c;
+	arma::Row<eT> sum_g;
+
+	Col<eT> pack() const {
+		return checkpoint::Writer<eT>().put(k).put(delta).put(delta_best).put(f_best).put(l_best).put(g_max)
+			.put(sum_alpha).put(sum_c).put(sum_g).col();
+	}
+	static HiddenBayesState unpack(const Mat<eT>& data) {
+		HiddenBayesState s;
+		checkpoint::Reader<eT>(data).get(s.k).get(s.delta).get(s.delta_best).get(s.f_best).get(s.l_best).get(s.g_max)
+			.get(s.sum_alpha).get(s.sum_c).get(s.sum_g);
+		return s;
+	}
+};
+
+// maximum number of constraint coefficients for which method "auto" of minmax_hidden_bayes uses the LP
+const size_t hidden_bayes_lp_max_coeffs = 1 << 20;
+
+// Computes min_delta f(delta) (see bayes_subgradient) with the subgradient method, returning the best f found and the
+// corresponding delta. method is
+//   "auto":      "lp" (exact, see minmax_hidden_bayes_lp) if the program has at most hidden_bayes_lp_max_coeffs
+//                coefficients, otherwise "entropic" for floating types and "euclidean" for rat
+//   "lp":        minmax_hidden_bayes_lp, max_gap and max_iter are ignored
+//   "euclidean": step 0.1/sqrt(k) followed by euclidean projection back to the simplex
+//   "entropic":  mirror descent with the entropy (exponentiated gradient), delta(d) *= exp(-alpha g(d)), normalized,
+//                with alpha = sqrt(2 log n_def) / (G sqrt(k)), G the max |g(d)| seen so far. Stays in the interior of
+//                the simplex without projecting, and usually needs far fewer iterations. Only for floating types.
+//
+// Stops when f_best - l <= max_gap, for a certified lower bound l of the minimum, or after max_iter iterations (0 for
+// no limit). Each subgradient gives a linear minorant f_k + <g_k, delta - delta_k> of f, so their average with the
+// step sizes as weights is also a minorant, and its minimum over the simplex (a min over the vertices) is a lower
+// bound. It is at least as tight as the bound of Boyd's notes (section 3.4), which is derived from it.
+//
+// hook saves and restores the state of the subgradient iterations (see checkpoint.h), it is not used by "lp". max_iter
+// counts also the iterations done before resuming.
+//
 template<typename eT>
 std::pair<eT, Prob<eT>>
-minmax_hidden_bayes(const Prob<eT>& pi, const vector<vector<Chan<eT>>>& Cs) {
+minmax_hidden_bayes(const Prob<eT>& pi, const vector<vector<Chan<eT>>>& Cs, eT max_gap = eT(1e-2), uint max_iter = 0, std::string method = "auto",
+	const checkpoint::Hook<HiddenBayesState<eT>>& hook = {}) {
 
 	uint n_def = Cs[0].size();
+	if(method == "auto") {
+		size_t n_coeffs = size_t(Cs.size()) * Cs[0][0].n_cols * Cs[0][0].n_rows * (n_def + 1);
+		method = n_coeffs <= hidden_bayes_lp_max_coeffs ? "lp" : std::is_floating_point<eT>::value ? "entropic" : "euclidean";
+	}
+	if(method == "lp")
+		return minmax_hidden_bayes_lp(pi, Cs);
 
-	// Notes secton 3.1: R should be such that R >= ||x^1 - x^*||_2. We start from a
-	// uniform, and the farthest we can go is a point distribution, in which case
-	// R = sqrt( n-1 / n^2 + 1 - 1/n ) = sqrt( 1 - 1/n )
-	//
-	const eT R2 = eT(1) - 1/eT(n_def);		// R^2
+	bool entropic = method == "entropic";
+	if(!entropic && method != "euclidean")
+		throw std::runtime_error("invalid method: " + method);
+	if(entropic && !std::is_floating_point<eT>::value)
+		throw std::runtime_error("the entropic method is only available for floating types");
 
 	Prob<eT> delta = probab::uniform<eT>(n_def);		// start from uniform
 	Prob<eT> delta_best;
 	eT f_best = infinity<eT>();
 	eT l_best(0);
-	eT sum1(0), sum2(0), sum3(0);
+	eT g_max(0);
+	eT sum_alpha(0), sum_c(0);						// minorant sum_k alpha_k (f_k + <g_k, delta - delta_k>) is
+	arma::Row<eT> sum_g(n_def, arma::fill::zeros);	// sum_c + <sum_g, delta>
+	arma::Row<eT> g;
+	uint k = 1;
+
+	if(hook.resume) {
+		const HiddenBayesState<eT>& s = *hook.resume;
+		if(s.delta.n_elem != n_def)
+			throw std::runtime_error("minmax_hidden_bayes: checkpoint of a different game");
+		k = s.k;
+		delta = s.delta;
+		delta_best = s.delta_best;
+		f_best = s.f_best;
+		l_best = s.l_best;
+		g_max = s.g_max;
+		sum_alpha = s.sum_alpha;
+		sum_c = s.sum_c;
+		sum_g = s.sum_g;
+	}
+	uint last_save = k;
+
+	for(; max_iter == 0 || k <= max_iter; k++) {
+		if(hook.due(k, last_save))
+			hook.save({ k, delta, delta_best, f_best, l_best, g_max, sum_alpha, sum_c, sum_g });
 
-	for(eT k = 1; true; k++) {
-//		eT alpha = eT(1) / k;						// square summable, see Boyd page 3
-		eT alpha = eT(0.1) / sqrt(k);				// Nonsummable diminishing, see Boyd page 3
-		arma::Row<eT> g;
 		eT f = bayes_subgradient(pi, Cs, delta, g);	// returns f, stores subgrad in g
 
 		// keep the best f/delta
@@ -79,25 +204,41 @@ minmax_hidden_bayes(const Prob<eT>& pi, const vector<vector<Chan<eT>>>& Cs) {
 			f_best = f;
 			delta_best = delta;
 		}
+		if(g.max() == eT(0))
+			break;									// g >= 0, so 0 is a subgradient and delta is optimal
+
+		eT alpha;
+		if constexpr (std::is_floating_point<eT>::value) {
+			g_max = std::max(g_max, g.max());
+			alpha = entropic
+				? std::sqrt(2 * std::log(eT(n_def))) / (g_max * std::sqrt(eT(k)))
+				: eT(0.1) / std::sqrt(eT(k));			// Nonsummable diminishing, see Boyd page 3
+		} else {
+			alpha = eT(1) / k;						// square summable, see Boyd page 3
+		}
 
-		// stopping criterion, see notes Section 3.4
-		sum1 += alpha * f;
-		sum2 += alpha * alpha * arma::cdot(g, g);
-		sum3 += alpha;
-		eT l = (2 * sum1 - R2 - sum2) / (2 * sum3);
-		if(l > l_best) {
+		// stopping criterion
+		sum_alpha += alpha;
+		sum_c += alpha * (f - arma::cdot(g, delta));
+		sum_g += alpha * g;
+		eT l = (sum_c + sum_g.min()) / sum_alpha;
+		if(l > l_best)
 			l_best = l;
-			std::cerr << "\r" << f_best << "   " << (f_best - l_best) << "                 ";
-		}
 
-		if(f_best - l_best < 1e-2)
+		if(f_best - l_best <= max_gap)
 			break;
 
-		// update and project back to the probability simplex
-		delta -= alpha * g;
-		delta = metric::optimize::simplex_project(delta);
+		if(entropic) {
+			if constexpr (std::is_floating_point<eT>::value) {
+				delta %= arma::exp(-alpha * (g - g.min()));	// shifting g does not change the normalized result
+				delta /= arma::accu(delta);
+			}
+		} else {
+			// update and project back to the probability simplex
+			delta -= alpha * g;
+			delta = metric::optimize::simplex_project(delta);
+		}
 	}
-	std::cerr << "\r";
 
 	return std::pair<eT, Prob<eT>>(f_best, delta_best);
 }
@@ -156,12 +297,20 @@ bayes_both_subgradients(
 	return f;
 }
 
+// Saddle point of the game where both players mix: alpha over the adversary actions, delta over the defender ones.
+// Runs max_iter iterations of simultaneous subgradient ascent (alpha) / descent (delta), each followed by a projection
+// back to the simplex, and returns the average strategies (alpha_avg, delta_avg) of all iterations.
+//
 template<typename eT>
-Prob<eT>
+std::pair<Prob<eT>, Prob<eT>>
 minmax_hidden_bayes_both(
 	const Prob<eT>& pi,
-	const vector<vector<Chan<eT>>>& Cs
+	const vector<vector<Chan<eT>>>& Cs,
+	uint max_iter = 1000
 ) {
+	if(max_iter == 0)
+		throw std::runtime_error("max_iter should be positive");
+
 	uint n_adv = Cs.size();
 	uint n_def = Cs[0].size();
 
@@ -170,9 +319,9 @@ minmax_hidden_bayes_both(
 	Prob<eT> alpha_avg(n_adv);
 	Prob<eT> delta_avg(n_def);
 	vector<LargeAvg<eT>> alpha_lavg(n_adv);
-	vector<LargeAvg<eT>> delta_lavg(n_adv);
+	vector<LargeAvg<eT>> delta_lavg(n_def);
 
-	for(eT k = 1; true; k++) {
+	for(uint k = 1; k <= max_iter; k++) {
 //		eT gamma = eT(1) / k;						// square summable, see Boyd page 3
 //		eT gamma = eT(0.1) / sqrt(k);				// Nonsummable diminishing, see Boyd page 3
 		eT gamma = eT(1);
@@ -187,11 +336,6 @@ minmax_hidden_bayes_both(
 		for(uint d = 0; d < n_def; d++)
 			delta_avg(d) = delta_lavg[d].add(delta(d));
 
-		// print
-		arma::Row<eT> g1, g2;		// unused, just to call bayes_both_subgradients
-		eT ff = bayes_both_subgradients(pi, Cs, alpha_avg, delta_avg, g1, g2);
-		std::cout << ff << "\n";
-
 		// update and project back to the probability simplex
 		alpha += gamma * g_a;
 		alpha = metric::optimize::simplex_project(alpha);
@@ -200,7 +344,7 @@ minmax_hidden_bayes_both(
 		delta = metric::optimize::simplex_project(delta);
 	}
 
-	return delta_avg;		// TODO return both averages
+	return std::pair<Prob<eT>, Prob<eT>>(alpha_avg, delta_avg);
 }
 
 
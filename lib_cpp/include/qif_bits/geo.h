@@ -95,6 +95,381 @@ point_to_cell(uint grid_width, eT cell_size = eT(1), Point<eT> corner = Point<eT
 }
 
 
+// Batch versions of cell_to_point / point_to_cell, on coordinates stored as separate arrays (xs, ys). They have no
+// per-point closure call, and point_to_cells has no exceptions: points outside the grid get mask 0 (and cell 0), so
+// the loops are branch-free and vectorize. grid_height == 0 means that the grid is unbounded upwards (as in
+// point_to_cell).
+//
+template<typename eT = eT_def>
+void cells_to_points(
+	const arma::ucolvec& cells,
+	uint grid_width,
+	eT cell_size,
+	Point<eT> corner,
+	Col<eT>& xs,
+	Col<eT>& ys
+) {
+	const uint n = cells.n_elem;
+	xs.set_size(n);
+	ys.set_size(n);
+	for(uint k = 0; k < n; k++) {
+		xs(k) = eT(uint(cells(k)) % grid_width) * cell_size + corner.x;
+		ys(k) = eT(uint(cells(k)) / grid_width) * cell_size + corner.y;
+	}
+}
+
+template<typename eT = eT_def>
+void points_to_cells(
+	const Col<eT>& xs,
+	const Col<eT>& ys,
+	uint grid_width,
+	uint grid_height,
+	eT cell_size,
+	Point<eT> corner,
+	arma::ucolvec& cells,
+	arma::uchar_vec& mask
+) {
+	if(xs.n_elem != ys.n_elem)
+		throw std::runtime_error("xs, ys have different sizes");
+
+	const uint n = xs.n_elem;
+	cells.set_size(n);
+	mask.set_size(n);
+
+	// corner is the center of cell 0, make it the bottom-left corner of cell 0
+	const double x0 = to_double(corner.x) - to_double(cell_size) / 2,
+				 y0 = to_double(corner.y) - to_double(cell_size) / 2,
+				 inv = 1 / to_double(cell_size),
+				 max_i = grid_width,
+				 max_j = grid_height == 0 ? std::numeric_limits<double>::infinity() : double(grid_height);
+
+	for(uint k = 0; k < n; k++) {
+		double i = std::floor((to_double(xs(k)) - x0) * inv),
+			   j = std::floor((to_double(ys(k)) - y0) * inv);
+		bool in = i >= 0 && j >= 0 && i < max_i && j < max_j;
+		mask(k) = in;
+		cells(k) = in ? arma::uword(i) + arma::uword(j) * grid_width : 0;
+	}
+}
+
+// Spatial index of a fixed set of points (eg check-in locations or POIs), for nearest-point and radius queries in
+// euclidean distance. The points are bucketed in a uniform grid of square buckets over their bounding box (by default
+// of a size giving ~2 points per bucket), stored as bucket offsets plus point ids sorted by bucket. nearest() visits
+// the buckets in rings of increasing Chebyshev radius around the query's bucket, and stops as soon as a ring cannot
+// contain anything closer than the best point found; within() only visits the buckets overlapping the query's
+// bounding box. Ties are broken by the smallest point index, so results do not depend on the bucket size.
+//
+template<typename eT = eT_def>
+class SpatialIndex {
+	public:
+		SpatialIndex(const Col<eT>& xs, const Col<eT>& ys, eT bucket_size = eT(0)) {
+			if(xs.n_elem != ys.n_elem)
+				throw std::runtime_error("xs, ys have different sizes");
+			px.resize(xs.n_elem);
+			py.resize(xs.n_elem);
+			for(uint k = 0; k < xs.n_elem; k++) {
+				px[k] = to_double(xs(k));
+				py[k] = to_double(ys(k));
+			}
+			build(to_double(bucket_size));
+		}
+
+		explicit SpatialIndex(const std::vector<Point<eT>>& points, eT bucket_size = eT(0)) {
+			for(auto& p : points) {
+				px.push_back(to_double(p.x));
+				py.push_back(to_double(p.y));
+			}
+			build(to_double(bucket_size));
+		}
+
+		uint size() const { return px.size(); }
+
+		// index of the point closest to p
+		uint nearest(const Point<eT>& p) const {
+			if(px.empty())
+				throw std::runtime_error("empty index");
+
+			const double x = to_double(p.x), y = to_double(p.y);
+			const int bx = bucket(x, min_x, nbx), by = bucket(y, min_y, nby);
+			const int max_r = std::max({ bx, nbx - 1 - bx, by, nby - 1 - by });
+
+			uint best = 0;
+			double best_d2 = std::numeric_limits<double>::infinity();
+			auto visit = [&](int i, int j) {
+				uint b = uint(j) * nbx + uint(i);
+				for(uint k = offsets[b]; k < offsets[b+1]; k++) {
+					uint id = ids[k];
+					double dx = px[id] - x, dy = py[id] - y, d2 = dx * dx + dy * dy;
+					if(d2 < best_d2 || (d2 == best_d2 && id < best)) {
+						best_d2 = d2;
+						best = id;
+					}
+				}
+			};
+
+			for(int r = 0; r <= max_r; r++) {
+				// the points of ring r are at least (r-1) buckets away in x or y
+				double bound = std::max(0, r - 1) * size_b;
+				if(bound * bound > best_d2)
+					break;
+
+				for(int j = std::max(0, by - r); j <= std::min(nby - 1, by + r); j++) {
+					if(j == by - r || j == by + r) {
+						for(int i = std::max(0, bx - r); i <= std::min(nbx - 1, bx + r); i++)
+							visit(i, j);
+					} else {
+						if(bx - r >= 0)  visit(bx - r, j);
+						if(bx + r < nbx) visit(bx + r, j);
+					}
+				}
+			}
+			return best;
+		}
+
+		// nearest for many queries, in parallel
+		arma::ucolvec nearest(const Col<eT>& xs, const Col<eT>& ys) const {
+			if(xs.n_elem != ys.n_elem)
+				throw std::runtime_error("xs, ys have different sizes");
+
+			arma::ucolvec res(xs.n_elem);
+			parallel::for_each(xs.n_elem, [&](uint k) { res(k) = nearest(Point<eT>(xs(k), ys(k))); });
+			return res;
+		}
+
+		// indexes (increasing) of all points at distance at most radius from p
+		std::vector<uint> within(const Point<eT>& p, eT radius) const {
+			std::vector<uint> res;
+			if(px.empty())
+				return res;
+
+			const double x = to_double(p.x), y = to_double(p.y), r = to_double(radius), r2 = r * r;
+			const int i0 = bucket(x - r, min_x, nbx), i1 = bucket(x + r, min_x, nbx),
+					  j0 = bucket(y - r, min_y, nby), j1 = bucket(y + r, min_y, nby);
+
+			for(int j = j0; j <= j1; j++) {
+				for(int i = i0; i <= i1; i++) {
+					uint b = uint(j) * nbx + uint(i);
+					for(uint k = offsets[b]; k < offsets[b+1]; k++) {
+						uint id = ids[k];
+						double dx = px[id] - x, dy = py[id] - y;
+						if(dx * dx + dy * dy <= r2)
+							res.push_back(id);
+					}
+				}
+			}
+			std::sort(res.begin(), res.end());
+			return res;
+		}
+
+	private:
+		std::vector<double> px, py;
+		double min_x = 0, min_y = 0, size_b = 1;
+		int nbx = 1, nby = 1;
+		std::vector<uint> offsets, ids;		// points of bucket b: ids[offsets[b] .. offsets[b+1]-1]
+
+		// bucket coordinate of v, clamped to [0, n-1]
+		inline int bucket(double v, double min_v, int n) const {
+			double b = std::floor((v - min_v) / size_b);
+			return b < 0 ? 0 : b >= n ? n - 1 : int(b);
+		}
+
+		void build(double bucket_size) {
+			const uint n = px.size();
+			if(n > 0) {
+				min_x = *std::min_element(px.begin(), px.end());
+				min_y = *std::min_element(py.begin(), py.end());
+			}
+			double w = n > 0 ? *std::max_element(px.begin(), px.end()) - min_x : 0,
+				   h = n > 0 ? *std::max_element(py.begin(), py.end()) - min_y : 0;
+
+			if(!(bucket_size > 0)) {
+				double area = std::max(w, 1e-12) * std::max(h, 1e-12);
+				bucket_size = std::sqrt(2 * area / std::max(n, 1u));
+			}
+			size_b = bucket_size > 0 && std::isfinite(bucket_size) ? bucket_size : 1;
+
+			const double max_buckets = 4 * double(n) + 16;
+			while(double(uint64_t(w / size_b) + 1) * double(uint64_t(h / size_b) + 1) > max_buckets)
+				size_b *= 2;
+			nbx = int(w / size_b) + 1;
+			nby = int(h / size_b) + 1;
+
+			// counting sort of the points by bucket
+			std::vector<uint> bucket_of(n);
+			offsets.assign(uint(nbx) * nby + 1, 0);
+			for(uint k = 0; k < n; k++) {
+				bucket_of[k] = uint(bucket(py[k], min_y, nby)) * nbx + uint(bucket(px[k], min_x, nbx));
+				offsets[bucket_of[k] + 1]++;
+			}
+			for(uint b = 0; b + 1 < offsets.size(); b++)
+				offsets[b+1] += offsets[b];
+
+			ids.resize(n);
+			std::vector<uint> pos(offsets.begin(), offsets.end() - 1);
+			for(uint k = 0; k < n; k++)
+				ids[pos[bucket_of[k]]++] = k;
+		}
+};
+
+
+// Adaptive discretization of the square [corner, corner + (size, size)], for instance from the density of check-ins:
+// a quadtree whose nodes are split in 4 equal quadrants while they contain more than max_points of the given points
+// and their quadrants would not be smaller than min_size. The leaves play the role of the cells of a uniform grid (in
+// priors, distances and the geo mechanisms over leaves), with small leaves in dense areas and a few large ones in
+// empty areas. Leaves are numbered in depth-first order, quadrants ordered bottom-left, bottom-right, top-left,
+// top-right.
+//
+template<typename eT = eT_def>
+class QuadTree {
+	public:
+		struct Leaf {
+			Point<eT> corner;		// bottom-left
+			eT size;
+			uint depth;
+
+			Point<eT> center() const { return Point<eT>(corner.x + size / 2, corner.y + size / 2); }
+		};
+
+		QuadTree(const std::vector<Point<eT>>& points, eT size, uint max_points, eT min_size, Point<eT> corner = Point<eT>(eT(0), eT(0)))
+			: root_corner(corner), root_size(size) {
+			if(!(size > 0) || !(min_size > 0))
+				throw std::runtime_error("size and min_size must be positive");
+
+			std::vector<Point<eT>> inside_points;
+			for(auto& p : points)
+				if(inside(p))
+					inside_points.push_back(p);
+
+			nodes.push_back(Node());
+			build(0, corner, size, 0, inside_points.begin(), inside_points.end(), max_points, min_size);
+		}
+
+		uint n_leaves() const				{ return leaves.size(); }
+		const Leaf& leaf(uint i) const		{ return leaves.at(i); }
+		eT size() const						{ return root_size; }
+		Point<eT> corner() const			{ return root_corner; }
+
+		uint max_depth() const {
+			uint res = 0;
+			for(auto& l : leaves)
+				res = std::max(res, l.depth);
+			return res;
+		}
+
+		bool inside(const Point<eT>& p) const {
+			return p.x >= root_corner.x && p.y >= root_corner.y && p.x < root_corner.x + root_size && p.y < root_corner.y + root_size;
+		}
+
+		// the leaf containing p
+		uint locate(const Point<eT>& p) const {
+			if(!inside(p))
+				throw std::runtime_error("out of grid area");
+
+			uint node = 0;
+			Point<eT> c = root_corner;
+			eT size = root_size;
+			while(nodes[node].first_child != 0) {
+				size /= 2;
+				bool right = p.x >= c.x + size, top = p.y >= c.y + size;
+				if(right) c.x += size;
+				if(top)   c.y += size;
+				node = nodes[node].first_child + uint(right) + 2 * uint(top);
+			}
+			return nodes[node].leaf;
+		}
+
+		// batch version, points outside get mask 0 (and leaf 0), as in points_to_cells
+		void locate(const Col<eT>& xs, const Col<eT>& ys, arma::ucolvec& res, arma::uchar_vec& mask) const {
+			if(xs.n_elem != ys.n_elem)
+				throw std::runtime_error("xs, ys have different sizes");
+
+			res.set_size(xs.n_elem);
+			mask.set_size(xs.n_elem);
+			parallel::for_each(xs.n_elem, [&](uint k) {
+				Point<eT> p(xs(k), ys(k));
+				mask(k) = inside(p);
+				res(k) = mask(k) ? locate(p) : 0;
+			});
+		}
+
+		// normalized histogram of the leaves of the points (those outside are ignored)
+		Prob<eT> prior(const std::vector<Point<eT>>& points) const {
+			Prob<eT> pi(n_leaves(), arma::fill::zeros);
+			for(auto& p : points)
+				if(inside(p))
+					pi(locate(p)) += eT(1);
+
+			eT total = arma::accu(pi);
+			if(total == eT(0))
+				throw std::runtime_error("empty list");
+			pi /= total;
+			return pi;
+		}
+
+		// euclidean distances between the centers of the leaves
+		Mat<eT> distances() const {
+			const uint n = n_leaves();
+			Mat<eT> D(n, n);
+			for(uint j = 0; j < n; j++) {
+				Point<eT> cj = leaves[j].center();
+				for(uint i = 0; i < n; i++) {
+					Point<eT> ci = leaves[i].center();
+					D(i, j) = std::sqrt((ci.x - cj.x) * (ci.x - cj.x) + (ci.y - cj.y) * (ci.y - cj.y));
+				}
+			}
+			return D;
+		}
+
+		// the same, as a metric on leaf indexes (eg for the LP mechanisms)
+		Metric<eT, uint> metric() const {
+			std::vector<Point<eT>> centers;
+			for(auto& l : leaves)
+				centers.push_back(l.center());
+
+			return [centers](const uint& i, const uint& j) -> eT {
+				eT dx = centers[i].x - centers[j].x, dy = centers[i].y - centers[j].y;
+				return std::sqrt(dx * dx + dy * dy);
+			};
+		}
+
+	private:
+		struct Node {
+			uint first_child = 0;		// the 4 children are consecutive, 0 for leaves (the root is never a child)
+			uint leaf = 0;
+		};
+
+		Point<eT> root_corner;
+		eT root_size;
+		std::vector<Node> nodes;
+		std::vector<Leaf> leaves;
+
+		typedef typename std::vector<Point<eT>>::iterator Iter;
+
+		void build(uint node, Point<eT> c, eT size, uint depth, Iter begin, Iter end, uint max_points, eT min_size) {
+			eT half = size / 2;
+			if(uint(end - begin) <= max_points || half < min_size) {
+				nodes[node].leaf = leaves.size();
+				leaves.push_back(Leaf{ c, size, depth });
+				return;
+			}
+
+			uint first = nodes.size();
+			nodes[node].first_child = first;
+			nodes.resize(first + 4);
+
+			eT mx = c.x + half, my = c.y + half;
+			Iter mid_y  = std::partition(begin, end,   [&](const Point<eT>& p) { return p.y < my; });
+			Iter mid_x0 = std::partition(begin, mid_y, [&](const Point<eT>& p) { return p.x < mx; });
+			Iter mid_x1 = std::partition(mid_y, end,   [&](const Point<eT>& p) { return p.x < mx; });
+
+			build(first,     c,                      half, depth + 1, begin,  mid_x0, max_points, min_size);
+			build(first + 1, Point<eT>(mx, c.y),     half, depth + 1, mid_x0, mid_y,  max_points, min_size);
+			build(first + 2, Point<eT>(c.x, my),     half, depth + 1, mid_y,  mid_x1, max_points, min_size);
+			build(first + 3, Point<eT>(mx, my),      half, depth + 1, mid_x1, end,    max_points, min_size);
+		}
+};
+
+
 // iterate points on infinite grid of given cell_size, starting at (0,0)
 // iterate per ring r, each ring is defined by max{|xd|,|yd|} == r
 //
@@ -185,4 +560,60 @@ class GridWalk {
 };
 
 
+// Offsets (i,j) of the cells of the infinite grid, ring by ring (ring r = the cells with max(|i|,|j|) == r, in the
+// order of GridWalk), with their euclidean norms sqrt(i^2 + j^2). Distances in a grid of any cell_size are
+// cell_size * radius, so one table serves all cell sizes and eps.
+//
+struct RingTable {
+	std::vector<int> i, j;
+	std::vector<double> radius;
+	std::vector<uint> ring_start;		// cells of ring r: [ring_start[r], ring_start[r+1])
+
+	explicit RingTable(uint n_rings) {
+		auto add = [&](int x, int y) {
+			i.push_back(x);
+			j.push_back(y);
+			radius.push_back(std::sqrt(double(x) * x + double(y) * y));
+		};
+
+		ring_start.push_back(0);
+		for(int r = 0; r < int(n_rings); r++) {
+			if(r == 0) {
+				add(0, 0);
+			} else {
+				for(int y = -r;    y <= r;    y++) add( r, y);
+				for(int y = -r;    y <= r;    y++) add(-r, y);
+				for(int x = -r+1;  x <= r-1;  x++) add( x, r);
+				for(int x = -r+1;  x <= r-1;  x++) add( x, -r);
+			}
+			ring_start.push_back(i.size());
+		}
+	}
+
+	uint n_rings() const { return ring_start.size() - 1; }
+};
+
+// tables of up to this many rings are cached (a table of r rings has 4r^2 cells, 16 bytes each, so 64 MiB at 1024)
+inline uint ring_table_max_cached = 1024;
+
+// a RingTable with at least n_rings rings. Tables are built on demand (growing geometrically, up to
+// ring_table_max_cached rings) and shared by all threads; the returned pointer stays valid when the cache is later
+// replaced by a larger table. Larger tables are not cached, they are freed when the caller drops them.
+//
+inline std::shared_ptr<const RingTable> ring_table(uint n_rings) {
+	static std::mutex m;
+	static std::shared_ptr<const RingTable> cache;
+
+	if(n_rings > ring_table_max_cached)
+		return std::make_shared<const RingTable>(n_rings);
+
+	std::lock_guard<std::mutex> lock(m);
+	if(!cache || cache->n_rings() < n_rings) {
+		uint grown = std::min(cache ? 2 * cache->n_rings() : 64u, ring_table_max_cached);
+		cache = std::make_shared<const RingTable>(std::max(n_rings, grown));
+	}
+	return cache;
+}
+
+
 } // namespace geo
@@ -8,11 +8,101 @@ struct Entry {
 	uint locationId;
 };
 
+// A width x height grid of cell_size (meters) cells, centered at center
+struct Grid {
+	latlon center;
+	uint width, height;
+	double cell_size;
+
+	Grid(latlon center, uint width, uint height, double cell_size) : center(center), width(width), height(height), cell_size(cell_size) {}
+};
+
 std::vector<Entry> read_dataset(string filename);
 std::vector<uint> to_grid(const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size);
 prob to_grid_prior(const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size);
 
+// Batched gridding: a single parallel pass over the data computes the cells (or priors) for many grids (eg several
+// cities and grid sizes) at once. The pointer versions take the coordinates as separate (SoA) arrays.
+//
+std::vector<prob> to_grid_prior(const std::vector<Entry>& dataset, const std::vector<Grid>& grids);
+std::vector<std::vector<uint>> to_grid(const double* lat, const double* lon, size_t n, const std::vector<Grid>& grids);
+std::vector<prob> to_grid_prior(const double* lat, const double* lon, size_t n, const std::vector<Grid>& grids);
+
+// Streaming access, without storing the dataset. The file is memory-mapped and parsed in place. for_each_entry calls
+// f, in the calling thread, for every entry in file order. to_grid/to_grid_prior on a filename parse the file in
+// parallel chunks, in a single pass (read_dataset also parses in parallel).
+//
+void for_each_entry(string filename, const std::function<void(const Entry&)>& f);
+std::vector<uint> to_grid(string filename, latlon center, uint width, uint height, double cell_size);
+prob to_grid_prior(string filename, latlon center, uint width, uint height, double cell_size);
+
+// Binary columnar cache of a dataset: a 64-byte header followed by the lat, lon (double), userId, locationId (uint32)
+// columns, and optionally the grid cell of each entry (UINT32_MAX outside the grid) for the grid recorded in the
+// header. read_columns memory-maps the file, so the columns are used in place without any parsing or copying.
+//
+struct Columns {
+	size_t size = 0;
+	const double *lat = nullptr, *lon = nullptr;
+	const uint32_t *userId = nullptr, *locationId = nullptr;
+
+	// grid parameters and precomputed cells (cell == nullptr if the file has no grid)
+	const uint32_t* cell = nullptr;
+	latlon center;
+	uint width = 0, height = 0;
+	double cell_size = 0;
+
+	std::shared_ptr<const MappedFile> file;		// keeps the mapping alive
+
+	bool has_grid(latlon center, uint width, uint height, double cell_size) const;
+};
+
+void write_columns(string filename, const std::vector<Entry>& dataset);
+void write_columns(string filename, const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size);
+Columns read_columns(string filename);
+
+// uses the precomputed cells when the grid matches the one in the file
+std::vector<uint> to_grid(const Columns& data, latlon center, uint width, uint height, double cell_size);
+prob to_grid_prior(const Columns& data, latlon center, uint width, uint height, double cell_size);
+
+// Per-user reports in a single streaming pass (see pipeline.h): parse -> project (to the cells of grid) -> per-user
+// histogram -> measure(pi), pi being the distribution of the user's check-ins inside the grid. The stages run on their
+// own threads, connected by bounded queues, so memory stays bounded for any number of users. report is called (in a
+// single thread, not in file order) for every user with at least min_checkins check-ins in the grid. measure is
+// called concurrently from measure_threads threads (0: parallel::n_threads()), so it must be thread-safe.
+//
+// The check-ins of a user are assumed to be contiguous in the file (as in the Gowalla dataset), a user appearing again
+// later gets a separate report.
+//
+struct UserReport {
+	uint userId;
+	uint n_checkins;				// in the grid
+	std::vector<double> values;		// returned by measure
+};
+
+struct ReportOptions {
+	size_t batch_size = 1 << 14;	// entries per batch (batches are cut at user boundaries)
+	uint queue_capacity = 8;		// batches per queue
+	uint project_threads = 2;
+	uint measure_threads = 0;
+	uint min_checkins = 1;
+};
+
+typedef std::function<std::vector<double>(const prob&)> UserMeasure;
+
+void user_reports(string filename, const Grid& grid, const UserMeasure& measure, const std::function<void(const UserReport&)>& report, const ReportOptions& opt = {});
+
+// against a fixed mechanism C (grid.width * grid.height rows): the values are the prior and posterior Bayes
+// vulnerabilities of the user
+void user_reports(string filename, const Grid& grid, const chan& C, const std::function<void(const UserReport&)>& report, const ReportOptions& opt = {});
+
 // TODO: extract the main projection functionality to geo::project_dummy
 std::vector<point> project_dummy(const std::vector<Entry>& dataset, latlon center, double width, double height);
 
+// Adaptive grids: a quadtree over the size x size (meters) square centered at center (in the coordinates of
+// project_dummy), refined while a node has more than max_points check-ins and its quadrants are at least min_size
+// meters. to_quadtree_prior is the distribution of the check-ins over its leaves.
+//
+geo::QuadTree<double> to_quadtree(const std::vector<Entry>& dataset, latlon center, double size, uint max_points, double min_size);
+prob to_quadtree_prior(const std::vector<Entry>& dataset, latlon center, const geo::QuadTree<double>& tree);
+
 } // namespace gowalla
@@ -0,0 +1,132 @@
+namespace gpu {
+
+// Optional CUDA backend, compiled in when cmake finds the CUDA toolkit (QIF_USE_CUDA in config.h, kernels in
+// src/gpu.cu). DeviceChan keeps a copy of a float/double channel in device memory, and provides its products with
+// vectors and the batched posterior sum_y opt_w (G diag(pi_k) C)_{w,y}. The latter runs as one cuBLAS GEMM per block
+// of stacked priors followed by a max/min reduction on the device, so only G, the priors and the results are
+// transferred.
+//
+// The large dense computations of the library use it transparently (g_vuln/l_risk posteriors of many priors and
+// shannon::add_capacity_bounds), when the backend is enabled and the work is at least min_flops, since smaller
+// problems are dominated by the transfers. The channel is uploaded once per call. Without CUDA (or a device)
+// available() is false and everything runs on the CPU. Setting the QIF_GPU environment variable to 0 disables the
+// backend by default.
+//
+
+namespace aux {
+
+#ifdef QIF_USE_CUDA
+// implemented in src/gpu.cu, on column-major host arrays (keep the signatures in sync)
+int device_count();
+std::shared_ptr<void> upload(const float* C, uint n_rows, uint n_cols);
+std::shared_ptr<void> upload(const double* C, uint n_rows, uint n_cols);
+void left(const void* dC, uint n_rows, uint n_cols, const float* v, float* res);		// res = v C
+void left(const void* dC, uint n_rows, uint n_cols, const double* v, double* res);
+void right(const void* dC, uint n_rows, uint n_cols, const float* v, float* res);		// res = C v
+void right(const void* dC, uint n_rows, uint n_cols, const double* v, double* res);
+void posterior_batch(const void* dC, uint n_rows, uint n_cols, const float* G, uint n_w, const float* Pis, uint n_k, bool minimize, float* res);
+void posterior_batch(const void* dC, uint n_rows, uint n_cols, const double* G, uint n_w, const double* Pis, uint n_k, bool minimize, double* res);
+#else
+inline int device_count() { return 0; }
+
+template<typename eT>
+std::shared_ptr<void> upload(const eT*, uint, uint) { throw std::runtime_error("qif was built without CUDA support"); }
+template<typename eT>
+void left(const void*, uint, uint, const eT*, eT*) {}
+template<typename eT>
+void right(const void*, uint, uint, const eT*, eT*) {}
+template<typename eT>
+void posterior_batch(const void*, uint, uint, const eT*, uint, const eT*, uint, bool, eT*) {}
+#endif
+
+inline std::atomic<int>& enabled_ref() {
+	static std::atomic<int> e = [] {
+		const char* env = std::getenv("QIF_GPU");
+		return env && std::string(env) == "0" ? 0 : -1;		// -1: not set, enabled if available
+	}();
+	return e;
+}
+
+template<typename eT>
+constexpr bool supported = std::is_same<eT, float>::value || std::is_same<eT, double>::value;
+
+} // namespace aux
+
+inline bool available() {
+	static const bool res = aux::device_count() > 0;
+	return res;
+}
+
+inline void set_enabled(bool enabled) {
+	aux::enabled_ref() = enabled;
+}
+
+inline bool enabled() {
+	int e = aux::enabled_ref();
+	return e != 0 && available();
+}
+
+// problems with fewer flops stay on the CPU
+inline double min_flops = 1e8;
+
+// true if a computation of the given flops on eT should run on the device
+template<typename eT>
+bool use(double flops) {
+	if constexpr (aux::supported<eT>)
+		return flops >= min_flops && enabled();
+	else
+		return false;
+}
+
+template<typename eT>
+class DeviceChan {
+	public:
+		uint n_rows, n_cols;
+
+		explicit DeviceChan(const Chan<eT>& C) : n_rows(C.n_rows), n_cols(C.n_cols) {
+			if constexpr (aux::supported<eT>)
+				data = aux::upload(C.memptr(), n_rows, n_cols);
+			else
+				throw std::runtime_error("DeviceChan: only float and double are supported");
+		}
+
+		void left(const Row<eT>& v, Row<eT>& res) const {
+			if(v.n_cols != n_rows)
+				throw std::runtime_error("invalid vector size");
+			res.set_size(n_cols);
+			if constexpr (aux::supported<eT>)
+				aux::left(data.get(), n_rows, n_cols, v.memptr(), res.memptr());
+		}
+
+		void right(const Row<eT>& w, Row<eT>& res) const {
+			if(w.n_cols != n_cols)
+				throw std::runtime_error("invalid vector size");
+			res.set_size(n_rows);
+			if constexpr (aux::supported<eT>)
+				aux::right(data.get(), n_rows, n_cols, w.memptr(), res.memptr());
+		}
+
+		// sum_y opt_w (G diag(pi_k) C)_{w,y} for each row pi_k of Pis, opt is max (or min if minimize == true)
+		Col<eT> posterior_batch(const Mat<eT>& G, const Mat<eT>& Pis, bool minimize = false) const {
+			if(G.n_cols != n_rows || Pis.n_cols != n_rows)
+				throw std::runtime_error("invalid matrix sizes");
+
+			Col<eT> res(Pis.n_rows, arma::fill::zeros);
+			if constexpr (aux::supported<eT>)
+				if(G.n_rows > 0 && Pis.n_rows > 0)
+					aux::posterior_batch(data.get(), n_rows, n_cols, G.memptr(), G.n_rows, Pis.memptr(), Pis.n_rows, minimize, res.memptr());
+			return res;
+		}
+
+		channel::OperatorChan<eT> op() const {
+			auto self = *this;		// shares the device buffer
+			return { n_rows, n_cols,
+				[self](const Row<eT>& v, Row<eT>& res) { self.left(v, res); },
+				[self](const Row<eT>& w, Row<eT>& res) { self.right(w, res); } };
+		}
+
+	private:
+		std::shared_ptr<void> data;
+};
+
+} // namespace gpu
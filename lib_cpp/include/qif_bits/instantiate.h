@@ -0,0 +1,42 @@
+// Explicit instantiations of the heaviest templates, compiled once into libqif (src/instantiate.cpp). Every program
+// including <qif> sees them as extern templates, so it links against the library's copies instead of instantiating
+// (and optimizing) them again in each translation unit. Calls can still be inlined, the declarations only suppress
+// the out-of-line copies. Define QIF_NO_EXTERN_TEMPLATES before including <qif> to instantiate everything locally
+// (eg. when linking against a libqif built from a different version of the headers).
+//
+// Included after arma_rat.h, since instantiating the classes for rat needs its specializations.
+//
+// QIF_INSTANTIATIONS(I) calls I(declaration) for every instantiation, the list is shared by the extern declarations
+// below and the definitions in src/instantiate.cpp.
+//
+
+// double, float and rat
+#define QIF_INSTANTIATIONS_ALL(eT, I) \
+	I(class lp::LinearProgram<eT>) \
+	I(class metric::Kantorovich<eT>) \
+	I(eT measure::bayes_vuln::posterior<eT>(const Prob<eT>&, const Chan<eT>&)) \
+	I(eT measure::g_vuln::posterior<eT>(const Mat<eT>&, const Prob<eT>&, const Chan<eT>&)) \
+	I(eT measure::l_risk::posterior<eT>(const Mat<eT>&, const Prob<eT>&, const Chan<eT>&)) \
+	I(eT utility::expected_distance<eT>(const Mat<eT>&, const Prob<eT>&, const Chan<eT>&))
+
+// double and float only
+#define QIF_INSTANTIATIONS_NATIVE(eT, I) \
+	I(class qp::QuadraticProgram<eT>) \
+	I(eT measure::shannon::posterior<eT>(const Prob<eT>&, const Chan<eT>&)) \
+	I(std::pair<eT, Prob<eT>> measure::shannon::add_capacity<eT>(const Chan<eT>&, eT, eT, const checkpoint::Hook<measure::shannon::CapacityState<eT>>&)) \
+	I(Chan<eT> mechanism::d_privacy::geometric<eT>(uint, eT, uint, int, int)) \
+	I(Chan<eT> mechanism::d_privacy::exponential<eT>(uint, Metric<eT, uint>, uint)) \
+	I(Chan<eT> mechanism::geo_ind::planar_laplace_grid<eT>(uint, uint, eT, eT, const std::string&))
+
+#define QIF_INSTANTIATIONS(I) \
+	QIF_INSTANTIATIONS_ALL(double, I) \
+	QIF_INSTANTIATIONS_ALL(float, I) \
+	QIF_INSTANTIATIONS_ALL(rat, I) \
+	QIF_INSTANTIATIONS_NATIVE(double, I) \
+	QIF_INSTANTIATIONS_NATIVE(float, I)
+
+#ifndef QIF_NO_EXTERN_TEMPLATES
+	#define QIF_EXTERN_TEMPLATE(...) extern template __VA_ARGS__;
+	QIF_INSTANTIATIONS(QIF_EXTERN_TEMPLATE)
+	#undef QIF_EXTERN_TEMPLATE
+#endif
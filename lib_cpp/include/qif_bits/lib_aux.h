@@ -82,6 +82,13 @@ inline eT infinity() {
 }
 
 
+// Type in which sums of eT values are accumulated: float channels are read as float but summed in double (the error
+// of a float sum of n terms grows with n), other types are summed in themselves.
+//
+template<typename eT>
+using accum_t = typename std::conditional<std::is_same<eT, float>::value, double, eT>::type;
+
+
 // errors close to 1 are translated by log2 to errors close to 0, which are harder to test
 inline float log2(float a) {
 	return equal(a, 1.0f) ? 0 : std::log2(a);
@@ -116,7 +123,8 @@ struct real_ops {
 	}
 };
 
-// precise sum using Kahan algorithm (https://en.wikipedia.org/wiki/Kahan_summation_algorithm)
+// precise sum using Neumaier's variant of the Kahan algorithm (https://en.wikipedia.org/wiki/Kahan_summation_algorithm),
+// which is also exact when a term is larger than the running sum. Strictly sequential, see CompensatedSum for loops.
 //
 template<typename eT>
 class LargeSum {
@@ -126,17 +134,91 @@ class LargeSum {
 
 	public:
 	inline eT add(eT n) {
-		eT y = n - c; 		// So far, so good: c is zero.
-		eT t = val + y;		// Alas, val is big, y small, so low-order digits of y are lost.
-		c = (t - val) - y;	// (t - val) recovers the high-order part of y; subtracting y recovers -(low part of y)
-		return val = t;		// Algebraically, c should always be zero. Beware eagerly optimising compilers!
+		if constexpr (std::is_same<eT, rat>::value) {
+			val += n;
+		} else {
+			eT t = val + n;
+			c += std::abs(val) >= std::abs(n) ? (val - t) + n : (n - t) + val;	// low-order digits lost in t
+			val = t;
+		}
+		return value();
 	}
 
 	inline eT value() {
-		return val;
+		return val + c;
 	}
 };
 
+// Compensated sum with several independent lanes, each one a LargeSum. Consecutive terms go to consecutive lanes, so
+// the lanes do not depend on each other and the loops of add/add_each vectorize; value() combines the lanes, again
+// compensated. Same accuracy as LargeSum, at close to the speed of a plain sum. rats are exact, so they are summed
+// directly.
+//
+template<typename eT, uint lanes = 8>
+class CompensatedSum {
+	private:
+	std::array<eT, lanes> s{}, c{};
+	uint next = 0;		// lane of the next single term
+
+	static inline void two_sum(eT& s, eT& c, eT x) {
+		eT t = s + x;
+		c += std::abs(s) >= std::abs(x) ? (s - t) + x : (x - t) + s;
+		s = t;
+	}
+
+	public:
+	inline void add(eT x) {
+		if constexpr (std::is_same<eT, rat>::value) {
+			s[0] += x;
+		} else {
+			two_sum(s[next], c[next], x);
+			next = (next + 1) % lanes;
+		}
+	}
+
+	// adds term(0), ..., term(n-1)
+	template<typename F>
+	inline void add_each(size_t n, F term) {
+		if constexpr (std::is_same<eT, rat>::value) {
+			for(size_t i = 0; i < n; i++)
+				s[0] += term(i);
+		} else {
+			const size_t n_full = n - n % lanes;
+			for(size_t i = 0; i < n_full; i += lanes)
+				for(uint l = 0; l < lanes; l++)
+					two_sum(s[l], c[l], term(i + l));
+			for(size_t i = n_full; i < n; i++)
+				add(term(i));
+		}
+	}
+
+	inline void add(const eT* p, size_t n) {
+		add_each(n, [p](size_t i) { return p[i]; });
+	}
+
+	inline eT value() const {
+		if constexpr (std::is_same<eT, rat>::value) {
+			return s[0];
+		} else {
+			eT sum(0), comp(0);
+			for(uint l = 0; l < lanes; l++) {
+				two_sum(sum, comp, s[l]);
+				comp += c[l];
+			}
+			return sum + comp;
+		}
+	}
+};
+
+// compensated version of arma::accu
+//
+template<typename eT>
+inline eT compensated_accu(const Mat<eT>& X) {
+	CompensatedSum<eT> sum;
+	sum.add(X.memptr(), X.n_elem);
+	return sum.value();
+}
+
 // iterative mean (http://www.heikohoffmann.de/htmlthesis/node134.html)
 //
 template<typename eT>
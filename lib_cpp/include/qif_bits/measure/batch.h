@@ -0,0 +1,146 @@
+namespace measure::batch {
+
+// Evaluation of several measures of many candidate channels at once, eg to rank mechanisms. Measures that read the
+// same data are fused into a single pass over each channel: for every column the maximum (bayes_vuln::mult_capacity),
+// the minimum over the support of pi (g_vuln::add_capacity, 1-spanning Vg's) and, for d_privacy::smallest_epsilon,
+// the log of the column (stored transposed, as d_privacy::aux::log_rows) are computed together. smallest_epsilon then
+// compares the rows of log(C) against the distances of d, which are evaluated once per channel size, in the calling
+// thread (d need not be thread-safe). shannon::add_capacity runs Blahut-Arimoto separately. Channels are evaluated in
+// parallel (the parallel loops inside the measures then run sequentially), and need not have the same size.
+//
+//     batch::Options<double> opt;
+//     opt.d = metric::euclidean<double, uint>();
+//     auto table = batch::evaluate(Cs, { batch::Measure::mult_capacity, batch::Measure::smallest_epsilon }, opt);
+//     arma::uvec best = table.rank(batch::Measure::mult_capacity);       // least leaking first
+//
+
+enum class Measure {
+	mult_capacity,			// bayes_vuln::mult_capacity(C)
+	g_add_capacity,			// g_vuln::add_capacity(pi, C) over 1-spanning Vg's
+	shannon_capacity,		// shannon::add_capacity(C, md, mrd).first
+	smallest_epsilon,		// d_privacy::smallest_epsilon(C, d, d_chain)
+};
+
+inline std::string to_string(Measure m) {
+	switch(m) {
+		case Measure::mult_capacity:		return "mult_capacity";
+		case Measure::g_add_capacity:		return "g_add_capacity";
+		case Measure::shannon_capacity:		return "shannon_capacity";
+		case Measure::smallest_epsilon:		return "smallest_epsilon";
+	}
+	throw std::runtime_error("invalid measure");
+}
+
+template<typename eT>
+struct Options {
+	Prob<eT> pi;											// g_add_capacity only depends on its support (empty: all inputs)
+	Metric<eT, uint> d;										// required by smallest_epsilon
+	Chainable<uint> d_chain = metric::never_chainable<uint>;
+	eT md = def_md<eT>, mrd = def_mrd<eT>;					// shannon_capacity
+};
+
+// values(i, k) is measures[k] of the i-th channel
+//
+template<typename eT>
+struct Table {
+	std::vector<Measure> measures;
+	Mat<eT> values;
+
+	// the values of m for all channels
+	Col<eT> column(Measure m) const {
+		for(uint k = 0; k < measures.size(); k++)
+			if(measures[k] == m)
+				return values.col(k);
+		throw std::runtime_error("measure " + to_string(m) + " was not evaluated");
+	}
+
+	// channel indexes sorted by m, smallest first (for all these measures: least leaking first). Stable, so ties keep
+	// the order of the channels.
+	arma::uvec rank(Measure m, bool descending = false) const {
+		return arma::stable_sort_index(column(m), descending ? "descend" : "ascend");
+	}
+};
+
+namespace aux {
+
+// mult_capacity and g_add_capacity in a single pass over the columns of C, also filling L = d_privacy::aux::log_rows(C)
+// if L != nullptr
+template<typename eT>
+std::pair<eT, eT> column_pass(const Chan<eT>& C, const std::vector<uint>& support, Mat<eT>* L) {
+	if(L)
+		L->set_size(C.n_cols, C.n_rows);
+
+	CompensatedSum<eT> sum_max, sum_min;
+	for(uint y = 0; y < C.n_cols; y++) {
+		const eT* col = C.colptr(y);
+		eT max(0), min(1);
+		for(uint x = 0; x < C.n_rows; x++) {
+			if(col[x] > max)
+				max = col[x];
+			if(L)
+				L->at(y, x) = col[x] > eT(0) ? std::log(col[x]) : d_privacy::aux::log_zero<eT>;
+		}
+		for(uint x : support)
+			if(col[x] < min)
+				min = col[x];
+		sum_max.add(max);
+		sum_min.add(min);
+	}
+	return { sum_max.value(), 1 - sum_min.value() };
+}
+
+} // namespace aux
+
+template<typename eT>
+Table<eT> evaluate(const std::vector<Chan<eT>>& Cs, const std::vector<Measure>& measures, const Options<eT>& opt = {}) {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+	QIF_TRACE_SPAN("measure::batch::evaluate");
+
+	auto wanted = [&](Measure m) { return std::find(measures.begin(), measures.end(), m) != measures.end(); };
+	if(wanted(Measure::smallest_epsilon) && !opt.d)
+		throw std::runtime_error("smallest_epsilon requires a metric d");
+
+	const bool extrema = wanted(Measure::mult_capacity) || wanted(Measure::g_add_capacity),
+			   epsilon = wanted(Measure::smallest_epsilon);
+
+	// distances of the pairs of inputs, for each size of channel
+	std::map<uint, Mat<eT>> distances;
+	if(epsilon)
+		for(auto& C : Cs)
+			if(!distances.count(C.n_rows))
+				distances[C.n_rows] = d_privacy::aux::pair_distances<eT>(C.n_rows, opt.d, opt.d_chain);
+
+	Table<eT> res;
+	res.measures = measures;
+	res.values.set_size(Cs.size(), measures.size());
+
+	parallel::for_each(Cs.size(), [&](uint i) {
+		const Chan<eT>& C = Cs[i];
+		std::map<Measure, eT> value;
+
+		if(extrema || epsilon) {
+			std::vector<uint> support;
+			if(extrema) {
+				if(!opt.pi.is_empty())
+					channel::check_prior_size(opt.pi, C);
+				for(uint x = 0; x < C.n_rows; x++)
+					if(opt.pi.is_empty() || !equal(opt.pi(x), eT(0)))
+						support.push_back(x);
+			}
+
+			Mat<eT> L;
+			std::tie(value[Measure::mult_capacity], value[Measure::g_add_capacity]) = aux::column_pass(C, support, epsilon ? &L : nullptr);
+			if(epsilon)
+				value[Measure::smallest_epsilon] = d_privacy::aux::smallest_epsilon_log(L, distances.at(C.n_rows));
+		}
+		if(wanted(Measure::shannon_capacity))
+			value[Measure::shannon_capacity] = shannon::add_capacity(C, opt.md, opt.mrd).first;
+
+		for(uint k = 0; k < measures.size(); k++)
+			res.values(i, k) = value.at(measures[k]);
+	});
+
+	return res;
+}
+
+} // namespace measure::batch
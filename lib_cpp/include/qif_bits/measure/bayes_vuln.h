@@ -5,12 +5,62 @@ eT prior(const Prob<eT>& pi) {
 	return arma::max(pi);
 }
 
+namespace aux {
+
+// N x M kernel for small channels, C in column-major order. The loops have constant bounds and are unrolled.
+template<uint N, uint M, typename eT>
+eT small_posterior(const eT* pi, const eT* C) {
+	eT sum(0);
+	for(uint y = 0; y < M; y++) {
+		eT col_max = pi[0] * C[y*N];
+		for(uint x = 1; x < N; x++)
+			if(eT j = pi[x] * C[y*N + x]; j > col_max)
+				col_max = j;
+		sum += col_max;
+	}
+	return sum;
+}
+
+} // namespace aux
+
 //sum y max x pi(x) C[x,y]
 //
 template<typename eT>
 eT posterior(const Prob<eT>& pi, const Chan<eT>& C) {
 	channel::check_prior_size(pi, C);
-		
+
+	eT res;
+
+	// rat: in machine integers over a common denominator, when nothing overflows (see rat_aux.h)
+	if constexpr (std::is_same<eT, rat>::value)
+		if(rat_aux::bayes_posterior(pi.memptr(), C.memptr(), C.n_rows, C.n_cols, res))
+			return res;
+
+	if(channel::aux::with_small_size(C.n_rows, C.n_cols, [&](auto N, auto M) { res = aux::small_posterior<decltype(N)::value, decltype(M)::value>(pi.memptr(), C.memptr()); }))
+		return res;
+
+	// float: the column maxima are read directly from C (no |X| x |Y| joint) and summed in double
+	//
+	if constexpr (!std::is_same<eT, accum_t<eT>>::value) {
+		std::vector<accum_t<eT>> col_max(C.n_cols);
+		auto run = [&](uint y) {
+			const eT* col = C.colptr(y);
+			eT m(0);
+			for(uint x = 0; x < C.n_rows; x++)
+				m = std::max(m, pi.at(x) * col[x]);
+			col_max[y] = m;
+		};
+		if(uint64_t(C.n_elem) < (1 << 16))
+			for(uint y = 0; y < C.n_cols; y++)
+				run(y);
+		else
+			parallel::for_each(C.n_cols, run);
+		accum_t<eT> sum(0);
+		for(auto m : col_max)
+			sum += m;
+		return eT(sum);
+	}
+
 	// Use the joint formulation: V[pi, C] = sum_y max_w J_{w,y}
 	//
 	if(probab::is_uniform(pi))		// common case that can be optimized
@@ -19,6 +69,184 @@ eT posterior(const Prob<eT>& pi, const Chan<eT>& C) {
 		return arma::accu(arma::max(C.each_col() % trans(pi)));
 }
 
+// target number of elements of the running column maxima in the batch posterior
+const uint batch_max_elems = 1 << 20;
+
+// Batch version, computes the posterior vulnerability for many priors at once (one per row of Pis).
+// For a block of priors we keep the column maxima M(k,y) = max_x Pis(k,x) C(x,y), updated with one
+// outer product Pis.col(x) * C.row(x) for each x.
+//
+template<typename eT>
+Col<eT> posterior(const Mat<eT>& Pis, const Chan<eT>& C) {
+	if(C.n_rows != Pis.n_cols)
+		throw std::runtime_error("invalid prior size");
+
+	const uint block = std::max(1u, batch_max_elems / std::max(1u, (uint)C.n_cols));	// priors per block
+
+	Col<eT> res(Pis.n_rows);
+	Mat<eT> M;
+	for(uint k0 = 0; k0 < Pis.n_rows; k0 += block) {
+		uint k1 = std::min(k0 + block, Pis.n_rows) - 1;
+
+		M.zeros(k1 - k0 + 1, C.n_cols);
+		for(uint x = 0; x < C.n_rows; x++)
+			M = arma::max(M, Pis.submat(k0, x, k1, x) * C.row(x));
+
+		res.rows(k0, k1) = arma::sum(M, 1);
+	}
+	return res;
+}
+
+// Sparse version, in O(nnz) time
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const SpChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	eT sum(0);
+	for(uint y = 0; y < C.n_cols; y++) {
+		eT col_max(0);
+		for(auto it = C.begin_col(y); it != C.end_col(y); ++it)
+			if(eT j = pi(it.row()) * eT(*it); j > col_max)
+				col_max = j;
+		sum += col_max;
+	}
+	return sum;
+}
+
+// Same for a lazy channel, rows are computed one at a time so only O(n_cols) memory is needed
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const channel::LazyChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	Row<eT> col_max = arma::zeros<Row<eT>>(C.n_cols), row;
+	for(uint x = 0; x < C.n_rows; x++) {
+		if(pi(x) == eT(0))
+			continue;
+
+		C.row(x, row);
+		for(uint y = 0; y < C.n_cols; y++)
+			if(eT j = pi(x) * row(y); j > col_max(y))
+				col_max(y) = j;
+	}
+	return arma::accu(col_max);
+}
+
+// Same for a memory-mapped channel, processed in blocks of rows
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const channel::MappedChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	Col<eT> col_max = arma::zeros<Col<eT>>(C.n_cols);
+	C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+		for(uint k = 0; k < Bt.n_cols; k++)
+			if(eT p = pi(first + k); p != eT(0))
+				col_max = arma::max(col_max, p * Bt.col(k));
+	});
+	return arma::accu(col_max);
+}
+
+// Same for a quantized channel, the codes are decoded while streaming over the rows
+//
+template<typename eT, typename Q>
+eT posterior(const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	channel::check_prior_size(pi, C);
+	typedef channel::aux::Codec<Q> codec;
+
+	std::vector<eT> col_max(C.n_cols, eT(0));
+	for(uint x = 0; x < C.n_rows; x++) {
+		const eT s = pi(x) * C.scale(x);
+		if(s == eT(0))
+			continue;
+
+		const Q* q = C.row_codes(x);
+		for(uint y = 0; y < C.n_cols; y++)
+			col_max[y] = std::max(col_max[y], s * eT(codec::decode(q[y])));
+	}
+	eT sum(0);
+	for(const eT& m : col_max)
+		sum += m;
+	return sum;
+}
+
+// Bound to the difference between posterior(pi, C) and the posterior vulnerability of the uncompressed channel: each
+// column maximum is off by at most max_x pi(x) C.max_error(x)
+//
+template<typename eT, typename Q>
+eT posterior_error(const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	channel::check_prior_size(pi, C);
+
+	eT m(0);
+	for(uint x = 0; x < C.n_rows; x++)
+		m = std::max(m, pi(x) * C.max_error(x));
+	return C.n_cols * m;
+}
+
+// Randomized response in O(n): the maximum of column y is either diag pi_y or off times the largest other pi_x
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const channel::RRChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	uint top = pi.index_max();
+	eT first = pi(top), second(0);
+	for(uint x = 0; x < pi.n_cols; x++)
+		if(x != top && pi(x) > second)
+			second = pi(x);
+
+	eT sum(0);
+	for(uint y = 0; y < C.n_cols; y++)
+		sum += std::max(C.diag * pi(y), C.off * (y == top ? second : first));
+	return sum;
+}
+
+// Geometric-type channels in O(n): max_x pi_x a_x b_y r^|x-y| = b_y max_filter(pi % a)_y
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const channel::GeometricChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	Row<eT> col_max;
+	Row<uint> arg;
+	C.max_filter(Row<eT>(pi % C.a), col_max, arg);
+	return arma::accu(col_max % C.col_weights());
+}
+
+// Deterministic channels in O(n): sum over the blocks of the largest pi_x
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const channel::DetChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	Row<eT> block_max = arma::zeros<Row<eT>>(C.n_cols);
+	for(uint x = 0; x < C.n_rows; x++)
+		if(pi(x) > block_max(C.map(x)))
+			block_max(C.map(x)) = pi(x);
+	return arma::accu(block_max);
+}
+
+// Shared (pi, C), see channel::PosteriorContext
+//
+template<typename eT>
+eT posterior(const channel::PosteriorContext<eT>& ctx) {
+	if(ctx.uniform())
+		return arma::accu(arma::max(ctx.C)) / (int)ctx.pi.n_cols;
+	else
+		return arma::accu(arma::max(ctx.joint()));
+}
+
+template<typename eT>
+eT add_leakage(const channel::PosteriorContext<eT>& ctx) {
+	return posterior(ctx) - prior(ctx.pi);
+}
+
+template<typename eT>
+eT mult_leakage(const channel::PosteriorContext<eT>& ctx) {
+	return posterior(ctx) / prior(ctx.pi);
+}
+
 template<typename eT>
 eT add_leakage(const Prob<eT>& pi, const Chan<eT>& C) {
 	return posterior(pi, C) - prior(pi);
@@ -52,6 +280,263 @@ arma::ucolvec strategy(const Prob<eT>& pi, const Chan<eT>& C) {
 	return strategy;
 }
 
+template<typename eT>
+arma::ucolvec strategy(const Prob<eT>& pi, const channel::RRChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	if(C.n_cols == 1)
+		return arma::zeros<arma::ucolvec>(1);
+
+	// ties are broken towards the smallest x, as in the dense version
+	uint top = pi.index_max(), second_x = top == 0 ? 1 : 0;
+	for(uint x = 0; x < pi.n_cols; x++)
+		if(x != top && pi(x) > pi(second_x))
+			second_x = x;
+
+	arma::ucolvec strategy(C.n_cols);
+	for(uint y = 0; y < C.n_cols; y++) {
+		uint other = y == top ? second_x : top;
+		eT d = C.diag * pi(y), o = C.off * pi(other);
+		strategy(y) = d > o || (d == o && y < other) ? y : other;
+	}
+	return strategy;
+}
+
+template<typename eT>
+arma::ucolvec strategy(const Prob<eT>& pi, const channel::GeometricChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	Row<eT> col_max;
+	Row<uint> arg;
+	C.max_filter(Row<eT>(pi % C.a), col_max, arg);
+	return arma::conv_to<arma::ucolvec>::from(arg.t());
+}
+
+// the first x of largest pi_x in each block (0 if the block has no mass, as in the dense version)
+template<typename eT>
+arma::ucolvec strategy(const Prob<eT>& pi, const channel::DetChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	arma::ucolvec strategy = arma::zeros<arma::ucolvec>(C.n_cols);
+	Row<eT> block_max = arma::zeros<Row<eT>>(C.n_cols);
+	for(uint x = 0; x < C.n_rows; x++) {
+		uint y = C.map(x);
+		if(pi(x) > block_max(y)) {
+			block_max(y) = pi(x);
+			strategy(y) = x;
+		}
+	}
+	return strategy;
+}
+
+// Maintains posterior(pi, C) while single entries, rows or columns of C change (eg in a local search over channels).
+// For every column y the two largest entries of the joint J = diag(pi) C are kept (with their rows), so changing
+// J(x,y) costs O(1) unless the column maximum drops below the second largest value, in which case the column is
+// rescanned in O(n). A row change thus costs O(m) typically, instead of O(n m) for posterior from scratch.
+//
+template<typename eT>
+class IncrementalPosterior {
+	public:
+		IncrementalPosterior(const Prob<eT>& pi, const Chan<eT>& C) : pi(pi), C(C), top(C.n_cols) {
+			channel::check_prior_size(pi, C);
+			for(uint y = 0; y < C.n_cols; y++)
+				rescan(y);
+			recompute_sum();
+		}
+
+		eT value() const					{ return sum; }
+		const Chan<eT>& channel() const		{ return C; }
+
+		void set(uint x, uint y, const eT& v) {
+			C(x, y) = v;
+			update(x, y);
+		}
+
+		void set_row(uint x, const Row<eT>& row) {
+			if(row.n_elem != C.n_cols) throw std::runtime_error("invalid row size");
+			C.row(x) = row;
+			for(uint y = 0; y < C.n_cols; y++)
+				update(x, y);
+		}
+
+		void set_col(uint y, const Col<eT>& col) {
+			if(col.n_elem != C.n_rows) throw std::runtime_error("invalid column size");
+			sum -= top[y].first;
+			C.col(y) = col;
+			rescan(y);
+			sum += top[y].first;
+		}
+
+		// changes pi(x), which scales row x of the joint. pi need not sum to 1 (see Monitor). O(m) if pi(x) increases,
+		// a decrease also rescans (in O(n)) the columns where row x falls below the top-2, so O(n m) in the worst case.
+		void set_prior(uint x, const eT& p) {
+			if(x >= pi.n_cols) throw std::runtime_error("invalid prior index");
+			pi(x) = p;
+			for(uint y = 0; y < C.n_cols; y++)
+				update(x, y);
+		}
+
+		const Prob<eT>& prior() const		{ return pi; }
+
+		// value() recomputed from the column maxima, to discard the rounding errors accumulated by the updates
+		void recompute_sum() {
+			sum = eT(0);
+			for(auto& t : top)
+				sum += t.first;
+		}
+
+		// all column maxima rescanned, in O(n m)
+		void recompute() {
+			for(uint y = 0; y < C.n_cols; y++)
+				rescan(y);
+			recompute_sum();
+		}
+
+	private:
+		struct Top2 {
+			eT first, second;
+			uint arg_first, arg_second;
+		};
+
+		Prob<eT> pi;
+		Chan<eT> C;
+		std::vector<Top2> top;
+		eT sum;
+
+		void rescan(uint y) {
+			Top2& t = top[y];
+			t = { eT(-1), eT(-1), 0, 0 };			// below any entry of the joint
+			for(uint x = 0; x < C.n_rows; x++) {
+				eT j = pi(x) * C(x, y);
+				if(j > t.first) {
+					t.second = t.first;
+					t.arg_second = t.arg_first;
+					t.first = j;
+					t.arg_first = x;
+				} else if(j > t.second) {
+					t.second = j;
+					t.arg_second = x;
+				}
+			}
+		}
+
+		// J(x,y) changed
+		void update(uint x, uint y) {
+			Top2& t = top[y];
+			eT j = pi(x) * C(x, y), old_max = t.first;
+
+			if(x == t.arg_first) {
+				if(j >= t.second)
+					t.first = j;
+				else
+					rescan(y);
+			} else if(x == t.arg_second) {
+				if(j > t.first) {
+					std::swap(t.arg_first, t.arg_second);
+					t.second = t.first;
+					t.first = j;
+				} else if(j >= t.second) {
+					t.second = j;
+				} else {
+					rescan(y);						// the new second largest may be any other row
+				}
+			} else if(j > t.first) {
+				t.second = t.first;
+				t.arg_second = t.arg_first;
+				t.first = j;
+				t.arg_first = x;
+			} else if(j > t.second) {
+				t.second = j;
+				t.arg_second = x;
+			}
+			sum += t.first - old_max;
+		}
+};
+
+// Online leakage of a fixed channel C under a prior that changes a few cells at a time, eg. a population prior built
+// from a histogram of check-ins (gowalla::to_grid_prior) that receives new events. The prior is given by unnormalized
+// weights (counts). Since the vulnerabilities are homogeneous in the prior, the unnormalized joint diag(w) C is
+// maintained by an IncrementalPosterior and divided by the total weight. Increasing a weight (eg. a new check-in)
+// costs O(m) instead of O(n m) for recomputing posterior from scratch. Decreasing w_x is O(m) plus an O(n) rescan of
+// each column where x was one of the two largest entries of the joint and falls below the other ones (O(n m) in the
+// worst case, eg. if x is the top row of every column), and of the weights if w_x was the maximum one (kept for the
+// prior vulnerability).
+//
+// The updates accumulate rounding errors (for floating types), so every resync_every updates (0: never) all maxima and
+// sums are recomputed exactly, in O(n m).
+//
+template<typename eT>
+class Monitor {
+	public:
+		Monitor(const Chan<eT>& C, const Prob<eT>& weights, uint resync_every = 1 << 16)
+			: inc(weights, C), resync_every(resync_every) {
+			for(auto& w : weights)
+				if(w < eT(0)) throw std::runtime_error("negative weight");
+			resync();
+			if(total <= eT(0)) throw std::runtime_error("zero total weight");
+		}
+
+		// w(x) += d
+		void add(uint x, const eT& d) {
+			set(x, weight(x) + d);
+		}
+
+		// w(x) = v
+		void set(uint x, const eT& v) {
+			if(v < eT(0)) throw std::runtime_error("negative weight");
+			const eT old = weight(x);
+			inc.set_prior(x, v);
+			total += v - old;
+
+			if(v >= max_w) {
+				max_w = v;
+				arg_max = x;
+			} else if(x == arg_max) {
+				rescan_prior();
+			}
+
+			if(resync_every > 0 && ++n_updates >= resync_every)
+				resync();
+		}
+
+		// w(cells(i)) += delta(i) for all i, in O(|cells| m) for non-negative deltas
+		void add(const arma::ucolvec& cells, const Col<eT>& delta) {
+			if(cells.n_elem != delta.n_elem) throw std::runtime_error("invalid delta size");
+			for(uint i = 0; i < cells.n_elem; i++)
+				add(cells(i), delta(i));
+		}
+
+		eT weight(uint x) const				{ return inc.prior()(x); }
+		const Prob<eT>& weights() const		{ return inc.prior(); }
+		eT total_weight() const				{ return total; }
+		Prob<eT> prior_dist() const			{ return inc.prior() / total; }
+
+		// bayes_vuln::prior/posterior/leakage for the normalized prior
+		eT prior() const					{ return max_w / total; }
+		eT posterior() const				{ return inc.value() / total; }
+		eT mult_leakage() const				{ return inc.value() / max_w; }
+		eT add_leakage() const				{ return posterior() - prior(); }
+
+		// exact recomputation of all maxima and sums, in O(n m)
+		void resync() {
+			inc.recompute();
+			total = arma::accu(inc.prior());
+			rescan_prior();
+			n_updates = 0;
+		}
+
+	private:
+		IncrementalPosterior<eT> inc;
+		uint resync_every, n_updates = 0;
+		eT total, max_w;
+		uint arg_max;
+
+		void rescan_prior() {
+			arg_max = inc.prior().index_max();
+			max_w = inc.prior()(arg_max);
+		}
+};
+
 // upper bound to cap_b(n), from the recurrence formula and the bound for cap_2(n)
 // see Geoffrey's POST paper
 //
@@ -1,43 +1,218 @@
 
 namespace measure::d_privacy {
 
+namespace aux {
+	// Fast path of is_private/smallest_epsilon for floating point channels. mult_total_variation(C_x1, C_x2) is
+	// max_y |log C_x1,y - log C_x2,y|, so we take the log of C once (transposed, so that every row is contiguous)
+	// and compare rows with a branch-free loop that the compiler can vectorize, instead of copying two rows and
+	// calling the metric for every pair. Zeros are mapped to the large finite log_zero instead of -inf, so that two
+	// zeros give diff 0, and a zero against a non-zero gives a diff above -log_zero/2, which is mapped to infinity.
+	//
+	template<typename eT>
+	const eT log_zero = -std::numeric_limits<eT>::max() / 4;
+
+	template<typename eT>
+	Mat<eT> log_rows(const Chan<eT>& C) {
+		Mat<eT> L = C.t();
+		L.transform([](eT v) -> eT { return v > eT(0) ? std::log(v) : log_zero<eT>; });
+		return L;
+	}
+
+	// mult_total_variation of rows x1, x2 of C, L = log_rows(C)
+	template<typename eT>
+	inline eT log_row_diff(const Mat<eT>& L, uint x1, uint x2) {
+		const eT* a = L.colptr(x1);
+		const eT* b = L.colptr(x2);
+
+		eT res(0);
+		for(uint y = 0; y < L.n_rows; y++) {
+			eT diff = std::abs(a[y] - b[y]);
+			res = res < diff ? diff : res;
+		}
+		return res > -log_zero<eT> / 2 ? infinity<eT>() : res;
+	}
+
+	// D(x2, x1) = d(x1, x2) for all x1 < x2, NaN for chainable pairs which are redundant to check.
+	// d and d_chain might not be thread-safe (eg. python functions), so they are evaluated here in the calling
+	// thread. D is only read by the parallel loops.
+	//
+	template<typename eT, typename DM>
+	Mat<eT> pair_distances(uint n, const DM& d, const Chainable<uint>& d_chain) {
+		Mat<eT> D(n, n);
+		for(uint x1 = 0; x1 < n; x1++)
+			for(uint x2 = x1+1; x2 < n; x2++)
+				D(x2, x1) = d_chain(x1, x2) ? std::numeric_limits<eT>::quiet_NaN() : eT(d(x1, x2));
+		return D;
+	}
+
+	template<typename eT, typename DM>
+	bool is_private_log(const Chan<eT>& C, const DM& d, const Chainable<uint>& d_chain) {
+		uint n = C.n_rows;
+		Mat<eT> L = log_rows(C);
+		Mat<eT> D = pair_distances<eT>(n, d, d_chain);
+
+		std::atomic<bool> priv(true);
+		parallel::for_each(n, [&](uint x1) {
+			for(uint x2 = x1+1; x2 < n && priv; x2++) {
+				eT dist = D(x2, x1);
+				if(!std::isnan(dist) && !less_than_or_eq(log_row_diff(L, x1, x2), dist))
+					priv = false;
+			}
+		});
+		return priv;
+	}
+
+	// L = log_rows(C), D = pair_distances(C.n_rows, d, d_chain), both can be computed by the caller (see batch.h)
+	template<typename eT>
+	eT smallest_epsilon_log(const Mat<eT>& L, const Mat<eT>& D) {
+		uint n = L.n_cols;
+		Col<eT> row_max(n, arma::fill::zeros);		// max ratio of each x1 over all x2 > x1
+		parallel::for_each(n, [&](uint x1) {
+			eT res(0);
+			for(uint x2 = x1+1; x2 < n; x2++) {
+				eT dist = D(x2, x1);
+				if(std::isnan(dist)) continue;
+
+				eT ratio = log_row_diff(L, x1, x2) / dist;
+				if(less_than(res, ratio))
+					res = ratio;
+			}
+			row_max(x1) = res;
+		});
+
+		eT res(0);
+		for(eT r : row_max)
+			if(less_than(res, r))
+				res = r;
+		return res;
+	}
+
+	template<typename eT, typename DM>
+	eT smallest_epsilon_log(const Chan<eT>& C, const DM& d, const Chainable<uint>& d_chain) {
+		return smallest_epsilon_log(log_rows(C), pair_distances<eT>(C.n_rows, d, d_chain));
+	}
+} // namespace aux
+
+// d can be a Metric<eT,uint> or any metric callable on uint (eg. a metric::expr expression, which is inlined).
+// Pairs of inputs for which d_chain is true are skipped (see metric.h, chainable pairs are redundant to check).
+// For floating point channels a dedicated parallel kernel on log(C) is used, for the others
+// metric::is_lipschitz_parallel.
+//
+template<typename eT, typename DM = Metric<eT, uint>>
+bool is_private(const Chan<eT>& C, const DM& d, const Chainable<uint>& d_chain = metric::never_chainable<uint>) {
+
+	if constexpr (std::is_floating_point<eT>::value)
+		return aux::is_private_log(C, d, d_chain);
+	else
+		return metric::is_lipschitz_parallel<eT,uint,Prob<eT>>(
+			[&](uint x) -> Prob<eT> { return C.row(x); },
+			d,
+			metric::mult_total_variation<eT, Prob<eT>>(),
+			range<uint>(0, C.n_rows),
+			d_chain
+		);
+}
+
+template<typename eT, typename DM = Metric<eT, uint>>
+eT smallest_epsilon(const Chan<eT>& C, const DM& d, const Chainable<uint>& d_chain = metric::never_chainable<uint>) {
+
+	if constexpr (std::is_floating_point<eT>::value)
+		return aux::smallest_epsilon_log(C, d, d_chain);
+	else
+		return metric::lipschitz_constant<eT,uint,Prob<eT>>(
+			[&](uint x) -> Prob<eT> { return C.row(x); },
+			d,
+			metric::mult_total_variation<eT, Prob<eT>>(),
+			range<uint>(0, C.n_rows),
+			d_chain
+		);
+}
+
+// This is the "d-vulnerability" function, who's max-case capacity coincides with the smallest epsilon of d-privacy:
+// max_{i,j} |log pi(i) - log pi(j)| / d(i, j).
+//
+// log(pi) is computed once, and d, d_chain are evaluated in the calling thread (see aux::pair_distances), after which
+// the pairs are compared in parallel. Pairs for which d_chain is true are skipped: on a tight chain the log-ratio of
+// the endpoints is at most the sum of the log-ratios of the steps, so the max is attained on a step.
+// For metrics on a line or on a grid, prior_line and prior_grid only visit the adjacent pairs.
+//
+template<typename eT, typename DM = Metric<eT, uint>>
+eT prior(const Prob<eT>& pi, const DM& d, const Chainable<uint>& d_chain = metric::never_chainable<uint>) {
+	uint n = pi.n_cols;
+	Row<eT> lp = arma::log(pi);
+	Mat<eT> D = aux::pair_distances<eT>(n, d, d_chain);
+
+	// max ratio of each i over all j > i. Chainable pairs have NaN distance, and equal probabilities at distance 0 a
+	// NaN ratio, which are ignored by the comparison.
+	//
+	Col<eT> row_max(n, arma::fill::zeros);
+	parallel::for_each(n, [&](uint i) {
+		const eT* Di = D.colptr(i);
+		eT li = lp(i), res(0);
+		for(uint j = i+1; j < n; j++) {
+			eT ratio = std::abs(li - lp(j)) / Di[j];
+			res = res < ratio ? ratio : res;
+		}
+		row_max(i) = res;
+	});
+
+	eT res(0);
+	for(eT r : row_max)
+		if(less_than(res, r))
+			res = r;
+	return res;
+}
+
+// prior(pi, d) for d(i, j) = |pos(i) - pos(j)|, inputs at arbitrary positions on a line. After sorting the inputs by
+// position, every pair is chained by the adjacent ones, so only these are compared, in O(n log n).
+//
 template<typename eT>
-bool is_private(const Chan<eT>& C, Metric<eT, uint> d) {
-
-	return metric::is_lipschitz<eT,uint,Prob<eT>>(
-		[&](uint x) -> Prob<eT> { return C.row(x); },
-		d,
-		metric::mult_total_variation<eT, Prob<eT>>(),
-		range<uint>(0, C.n_rows)
-	);
+eT prior_line(const Prob<eT>& pi, const Row<eT>& pos) {
+	if(pos.n_cols != pi.n_cols) throw std::runtime_error("pos should have the same size as pi");
+
+	arma::uvec order = arma::sort_index(pos);
+	eT res(0);
+	for(uint k = 1; k < order.n_elem; k++) {
+		uint i = order(k-1), j = order(k);
+		eT ratio = std::abs(std::log(pi(i)) - std::log(pi(j))) / (pos(j) - pos(i));
+		if(less_than(res, ratio))
+			res = ratio;
+	}
+	return res;
 }
 
+// inputs at distance step from each other, same as prior(pi, step * euclidean<eT,uint>()), in O(n)
 template<typename eT>
-eT smallest_epsilon(const Chan<eT>& C, Metric<eT, uint> d) {
-
-	return metric::lipschitz_constant<eT,uint,Prob<eT>>(
-		[&](uint x) -> Prob<eT> { return C.row(x); },
-		d,
-		metric::mult_total_variation<eT, Prob<eT>>(),
-		range<uint>(0, C.n_rows)
-	);
+eT prior_line(const Prob<eT>& pi, eT step = eT(1)) {
+	eT res(0);
+	for(uint i = 1; i < pi.n_cols; i++) {
+		eT ratio = std::abs(std::log(pi(i-1)) - std::log(pi(i))) / step;
+		if(less_than(res, ratio))
+			res = ratio;
+	}
+	return res;
 }
 
-// This is the "d-vulnerability" function, who's max-case capacity coincides with the smallest epsilon of d-privacy
+// inputs are the cells of a grid of the given width (cell i is (i%width, i/width)), with the manhattan distance
+// between cells of size step, same as prior(pi, metric::grid_manhattan(width, height, step)). Only the horizontal
+// and vertical neighbours are compared, in O(n).
 //
 template<typename eT>
-eT prior(const Prob<eT>& pi, Metric<eT, uint> d) {
+eT prior_grid(const Prob<eT>& pi, uint width, eT step = eT(1)) {
+	if(width == 0 || pi.n_cols % width != 0) throw std::runtime_error("the size of pi should be a multiple of width");
 
+	Row<eT> lp = arma::log(pi);
 	eT res(0);
+	auto check = [&](uint i, uint j) {
+		eT ratio = std::abs(lp(i) - lp(j)) / step;
+		if(less_than(res, ratio))
+			res = ratio;
+	};
 	for(uint i = 0; i < pi.n_cols; i++) {
-		for(uint j = i+1; j < pi.n_cols; j++) {
-			// chainable elements are redundant to check
-			// if(d.chainable(i, j)) continue;
-
-			eT ratio = std::abs(std::log(pi(i)) - std::log(pi(j))) / d(i, j);
-			if(less_than(res, ratio))
-				res = ratio;
-		}
+		if(i % width + 1 < width)
+			check(i, i + 1);
+		if(i + width < pi.n_cols)
+			check(i, i + width);
 	}
 	return res;
 }
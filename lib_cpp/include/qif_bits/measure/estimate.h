@@ -0,0 +1,195 @@
+namespace measure::estimate {
+
+// Monte-Carlo estimation of posterior Bayes/g-vulnerability, for channels that are only available as a sampler
+// sampler(x, gen) returning an output y of secret x (eg compositions too large to materialize, or programs given as
+// functions). See bayes_vuln and g_vuln below.
+//
+// The estimator is stratified by secret: every round draws round(n pi(x)) outputs for each x (at least one if
+// pi(x) > 0) instead of sampling x from pi, which removes the variance due to the secret. Each round uses two batches:
+//  - training samples, accumulated over rounds, from which the best guess for each observed y is chosen
+//    (the plug-in estimate, which is biased upwards, is computed from them too),
+//  - fresh evaluation samples, on which the success of these guesses is measured. Since the guesses do not depend
+//    on them, this is an unbiased estimate of the vulnerability of the guessing strategy (a lower bound of the true
+//    vulnerability, to which it converges), with a normal confidence interval from the per-stratum variances.
+// The number of samples doubles every round, until the interval is narrower than target_width or max_samples is
+// reached. Strata are sampled in parallel from independent streams of seed, so results only depend on the seed
+// (the sampler is called concurrently, so it must be thread-safe).
+//
+
+typedef std::function<uint(uint, rng::Engine&)> Sampler;
+
+struct Options {
+	double target_width = 0.01;						// full width of the confidence interval
+	double confidence = 0.95;
+	uint64_t initial_samples = 10000;				// per batch, in the first round
+	uint64_t max_samples = 100000000;				// total, over all rounds and both batches
+	uint64_t seed = 0;								// 0: random
+};
+
+struct Result {
+	double value, lower, upper;						// evaluation estimate and its confidence interval
+	double plugin;									// plug-in estimate on the training samples (biased upwards)
+	uint64_t n_samples;								// total samples drawn
+	uint n_rounds;
+};
+
+// sampler of a dense channel, through channel::Sampler's alias tables
+template<typename eT>
+Sampler chan_sampler(const Chan<eT>& C, const Prob<eT>& pi) {
+	auto s = std::make_shared<channel::Sampler>(C, pi);
+	return [s](uint x, rng::Engine& gen) { return s->output(x, gen); };
+}
+
+namespace aux {
+
+template<typename eT>
+Row<double> to_double_row(const Row<eT>& v) {
+	Row<double> res(v.n_elem);
+	for(uint i = 0; i < v.n_elem; i++)
+		res(i) = to_double(v(i));
+	return res;
+}
+
+// z with P(|N(0,1)| <= z) = confidence
+inline
+double normal_quantile(double confidence) {
+	if(!(confidence > 0 && confidence < 1)) throw std::runtime_error("confidence should be in (0, 1)");
+
+	double lo = 0, hi = 40;
+	for(uint i = 0; i < 200; i++) {
+		double mid = (lo + hi) / 2;
+		(std::erfc(mid / std::sqrt(2.0)) > 1 - confidence ? lo : hi) = mid;
+	}
+	return (lo + hi) / 2;
+}
+
+// gain(w, x) is the gain of guess w for secret x, best_guess(v) returns argmax_w sum_x v_x gain(w, x) for a
+// sparse v given as (x, v_x) pairs.
+template<typename Gain, typename BestGuess>
+Result run(const Row<double>& pi, const Sampler& sampler, const Options& opt, Gain gain, BestGuess best_guess, uint default_guess) {
+	const uint n = pi.n_elem;
+	const uint64_t seed = opt.seed ? opt.seed : rng::random_seed();
+	const double z = normal_quantile(opt.confidence);
+
+	// training: per output y, the counts of each secret
+	std::unordered_map<uint, std::unordered_map<uint, uint64_t>> train;
+	std::vector<uint64_t> train_n(n, 0);
+
+	Result res { 0, 0, 1, 0, 0, 0 };
+	std::vector<std::vector<uint>> ys(n);		// outputs of the current batch, per stratum
+
+	auto draw = [&](uint64_t batch, uint64_t stream_base) {
+		parallel::for_each(n, [&](uint x) {
+			uint64_t m = pi(x) > 0 ? std::max<uint64_t>(1, uint64_t(std::llround(batch * pi(x)))) : 0;
+			rng::Engine gen = rng::stream(seed, stream_base + x);
+			ys[x].resize(m);
+			for(auto& y : ys[x])
+				y = sampler(x, gen);
+		});
+		for(uint x = 0; x < n; x++)
+			res.n_samples += ys[x].size();
+	};
+
+	for(uint64_t batch = opt.initial_samples; ; batch *= 2) {
+		uint64_t stream_base = uint64_t(res.n_rounds) * 2 * n;
+		res.n_rounds++;
+
+		// training batch
+		draw(batch, stream_base);
+		for(uint x = 0; x < n; x++) {
+			for(uint y : ys[x])
+				train[y][x]++;
+			train_n[x] += ys[x].size();
+		}
+
+		// guesses and plug-in estimate: the posterior gain of y is max_w sum_x pi(x) (count(x,y) / n_x) gain(w, x)
+		std::unordered_map<uint, uint> guess;
+		res.plugin = 0;
+		std::vector<std::pair<uint, double>> v;
+		for(auto& [y, cnt] : train) {
+			v.clear();
+			for(auto& [x, c] : cnt)
+				v.push_back({ x, pi(x) * double(c) / double(train_n[x]) });
+			uint w = best_guess(v);
+			guess[y] = w;
+			for(auto& [x, vx] : v)
+				res.plugin += vx * gain(w, x);
+		}
+
+		// evaluation batch: mean and variance of gain(guess(y), x) in every stratum
+		draw(batch, stream_base + n);
+		double value = 0, var = 0;
+		for(uint x = 0; x < n; x++) {
+			if(ys[x].empty())
+				continue;
+			double sum = 0, sum2 = 0;
+			for(uint y : ys[x]) {
+				auto it = guess.find(y);
+				double g = gain(it == guess.end() ? default_guess : it->second, x);
+				sum += g;
+				sum2 += g * g;
+			}
+			double m = ys[x].size(), mean = sum / m, s2 = m > 1 ? std::max(0.0, (sum2 - m * mean * mean) / (m - 1)) : 0;
+			value += pi(x) * mean;
+			var += pi(x) * pi(x) * s2 / m;
+		}
+
+		double half = z * std::sqrt(var);
+		res.value = value;
+		res.lower = value - half;
+		res.upper = value + half;
+
+		if(2 * half <= opt.target_width || res.n_samples + 4 * batch > opt.max_samples)
+			return res;
+	}
+}
+
+} // namespace aux
+
+// posterior Bayes vulnerability sum_y max_x pi(x) C(x,y), comparable to bayes_vuln::posterior(pi, C)
+//
+template<typename eT>
+Result bayes_vuln(const Prob<eT>& pi, const Sampler& sampler, const Options& opt = {}) {
+	const Row<double> pi_d = aux::to_double_row(pi);
+
+	return aux::run(pi_d, sampler, opt,
+		[](uint w, uint x) { return w == x ? 1.0 : 0.0; },
+		[](const std::vector<std::pair<uint, double>>& v) {
+			auto best = std::max_element(v.begin(), v.end(), [](auto& a, auto& b) { return a.second < b.second || (a.second == b.second && a.first > b.first); });
+			return best->first;
+		},
+		pi_d.index_max());
+}
+
+template<typename eT>
+Result bayes_vuln(const Prob<eT>& pi, const Chan<eT>& C, const Options& opt = {}) {
+	return bayes_vuln(pi, chan_sampler(C, pi), opt);
+}
+
+// posterior g-vulnerability sum_y max_w sum_x pi(x) C(x,y) G(w,x), comparable to g_vuln::posterior(G, pi, C)
+//
+template<typename eT>
+Result g_vuln(const Mat<eT>& G, const Prob<eT>& pi, const Sampler& sampler, const Options& opt = {}) {
+	g_vuln::check_g_size(G, pi);
+	const Row<double> pi_d = aux::to_double_row(pi);
+	Mat<double> G_d(G.n_rows, G.n_cols);
+	for(uint i = 0; i < G.n_elem; i++)
+		G_d(i) = to_double(G(i));
+
+	return aux::run(pi_d, sampler, opt,
+		[&](uint w, uint x) { return G_d(w, x); },
+		[&](const std::vector<std::pair<uint, double>>& v) {
+			Col<double> score = arma::zeros<Col<double>>(G_d.n_rows);
+			for(auto& [x, vx] : v)
+				score += vx * G_d.col(x);
+			return uint(score.index_max());
+		},
+		uint(Col<double>(G_d * pi_d.t()).index_max()));
+}
+
+template<typename eT>
+Result g_vuln(const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C, const Options& opt = {}) {
+	return g_vuln(G, pi, chan_sampler(C, pi), opt);
+}
+
+} // namespace measure::estimate
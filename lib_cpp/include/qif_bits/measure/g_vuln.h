@@ -33,6 +33,249 @@ eT prior(const Metric<eT, uint>& g, const Prob<eT>& pi) {
 	return prior(metric::to_distance_matrix(g, pi.n_cols), pi);
 }
 
+template<typename eT>
+eT prior(const metric::CachedMetric<eT>& g, const Prob<eT>& pi) {
+	return prior(metric::to_distance_matrix(g, pi.n_cols), pi);
+}
+
+namespace aux {
+
+template<typename eT>
+void check_grid_size(const metric::GridMetric<eT>& g, const Prob<eT>& pi) {
+	if(g.n_cells() != pi.n_cols)
+		throw std::runtime_error("invalid prior size");
+}
+
+// opt_w sum_x g(w,x) pi(x) for a grid metric g (the guesses are the cells), by a single FFT convolution
+//
+template<typename eT>
+eT grid_prior(const metric::GridMetric<eT>& g, const Prob<eT>& pi, bool minimize) {
+	check_grid_size(g, pi);
+
+	Col<double> v = arma::conv_to<Col<double>>::from(pi.t());
+	metric::GridConvolution(g).apply(v.memptr(), v.memptr());
+	return eT(minimize ? v.min() : v.max());
+}
+
+// columns of C per task in grid_posterior
+const uint grid_posterior_block = 16;
+
+// sum_y opt_w sum_x g(w,x) J(x,y) for a grid metric g, computed by the FFT convolution of each column of the joint with
+// the kernel of g. If strategy is not null, the optimal guess for each y is also stored there. Columns are processed
+// in parallel, unless armadillo uses FFTW.
+//
+template<typename eT>
+eT grid_posterior(const metric::GridMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C, bool minimize, arma::ucolvec* strategy = nullptr) {
+	check_grid_size(g, pi);
+	channel::check_prior_size(pi, C);
+
+	const uint n = C.n_rows;
+	const metric::GridConvolution conv(g);
+	Col<double> opt(C.n_cols, arma::fill::zeros);
+	if(strategy)
+		strategy->zeros(C.n_cols);
+
+	auto run_block = [&](uint b) {
+		std::vector<double> v(n);
+		uint y1 = std::min((b + 1) * grid_posterior_block, C.n_cols);
+		for(uint y = b * grid_posterior_block; y < y1; y++) {
+			bool empty = true;
+			for(uint x = 0; x < n; x++) {
+				v[x] = to_double(pi(x)) * to_double(C(x, y));
+				empty = empty && v[x] == 0;
+			}
+			if(empty)
+				continue;			// opt_w 0 = 0
+
+			conv.apply(v.data(), v.data());
+			uint best = 0;
+			for(uint w = 1; w < n; w++)
+				if(minimize ? v[w] < v[best] : v[w] > v[best])
+					best = w;
+
+			opt(y) = v[best];
+			if(strategy)
+				strategy->at(y) = best;
+		}
+	};
+	uint n_blocks = (C.n_cols + grid_posterior_block - 1) / grid_posterior_block;
+	#ifdef ARMA_USE_FFTW3
+	for(uint b = 0; b < n_blocks; b++)
+		run_block(b);
+	#else
+	parallel::for_each(n_blocks, run_block);
+	#endif
+
+	return eT(arma::accu(opt));
+}
+
+} // namespace aux
+
+// grid-metric versions (see metric::GridMetric), by FFT convolution. For rat the distance matrix is used.
+//
+template<typename eT>
+eT prior(const metric::GridMetric<eT>& g, const Prob<eT>& pi) {
+	if constexpr (std::is_same<eT, rat>::value)
+		return prior(metric::to_distance_matrix(g, pi.n_cols), pi);
+	else
+		return aux::grid_prior(g, pi, false);
+}
+
+namespace aux {
+
+// number of columns of C processed at once by fused_posterior
+const uint posterior_panel_cols = 64;
+
+// sum_y opt_w sum_x G[w,x] pi[x] C[x,y] for an N x M channel (column-major), with constant inner bounds. For each w
+// the M values are computed in registers, so nothing is allocated.
+//
+template<uint N, uint M, typename eT>
+eT small_posterior(const Mat<eT>& G, const eT* pi, const eT* C, bool minimize) {
+	eT opt[M];
+	eT gpi[N];
+	for(uint w = 0; w < G.n_rows; w++) {
+		for(uint x = 0; x < N; x++)
+			gpi[x] = G.at(w, x) * pi[x];
+		for(uint y = 0; y < M; y++) {
+			eT v = gpi[0] * C[y*N];
+			for(uint x = 1; x < N; x++)
+				v += gpi[x] * C[y*N + x];
+			if(w == 0 || (minimize ? v < opt[y] : v > opt[y]))
+				opt[y] = v;
+		}
+	}
+	eT sum(0);
+	for(uint y = 0; y < M; y++)
+		sum += opt[y];
+	return sum;
+}
+
+// columns y0..y1 of C as a matrix using C's own memory (the columns are contiguous), without copying
+//
+template<typename eT>
+Mat<eT> col_panel(const Mat<eT>& C, uint y0, uint y1) {
+	return Mat<eT>(const_cast<eT*>(C.colptr(y0)), C.n_rows, y1 - y0 + 1, false, true);
+}
+
+// sum of the max (or min if minimize == true) of each column of GJ, 0 if GJ has no rows
+//
+template<typename eT, typename M>
+eT col_opt_sum(const M& GJ, bool minimize) {
+	eT sum(0);
+	if(GJ.n_rows > 0)
+		for(uint y = 0; y < GJ.n_cols; y++)
+			sum += minimize ? GJ.col(y).min() : GJ.col(y).max();
+	return sum;
+}
+
+// Computes sum_y opt_w (G J)_{w,y}, where J = diag(pi) C is the joint and opt is max (or min if minimize == true).
+// C is processed in panels of posterior_panel_cols columns, so only a |X| x panel part of the joint and a |W| x panel
+// part of the product exist at any time, instead of the full |X| x |Y| joint and |W| x |Y| product. The panels come
+// from the current workspace, if any.
+//
+template<typename eT>
+eT fused_posterior(const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C, bool minimize = false) {
+	eT res;
+	if constexpr (std::is_same<eT, rat>::value)		// in machine integers, see rat_aux.h
+		if(rat_aux::g_posterior(G.memptr(), G.n_rows, pi.memptr(), C.memptr(), C.n_rows, C.n_cols, minimize, res))
+			return res;
+
+	if(G.n_rows > 0 && channel::aux::with_small_size(C.n_rows, C.n_cols, [&](auto N, auto M) { res = small_posterior<decltype(N)::value, decltype(M)::value>(G, pi.memptr(), C.memptr(), minimize); }))
+		return res;
+
+	const bool uniform = probab::is_uniform(pi);		// common case, no need to form the joint
+	const uint panel = std::min(posterior_panel_cols, C.n_cols);
+
+	workspace::Frame frame;
+	workspace::Buffer<eT> pi_buf(uniform ? 0 : pi.n_cols), J_buf(uniform ? 0 : size_t(C.n_rows) * panel), GJ_buf(size_t(G.n_rows) * panel);
+	Col<eT> pi_t = pi_buf.col(uniform ? 0 : pi.n_cols);
+	if(!uniform)
+		pi_t = pi.t();
+
+	accum_t<eT> sum(0);								// float panels are summed in double
+	for(uint y0 = 0; y0 < C.n_cols; y0 += posterior_panel_cols) {
+		uint y1 = std::min(y0 + posterior_panel_cols, C.n_cols) - 1;
+
+		Mat<eT> GJ = GJ_buf.mat(G.n_rows, y1 - y0 + 1);
+		if(uniform) {
+			GJ = G * col_panel(C, y0, y1);
+		} else {
+			Mat<eT> J = J_buf.mat(C.n_rows, y1 - y0 + 1);
+			J = C.cols(y0, y1);
+			J.each_col() %= pi_t;
+			GJ = G * J;
+		}
+		sum += col_opt_sum<eT>(GJ, minimize);
+	}
+
+	return eT(uniform ? sum / (int)pi.n_cols : sum);
+}
+
+// target number of rows of the stacked gain matrix in fused_posterior_batch
+const uint batch_stacked_rows = 2048;
+
+// Batch version of fused_posterior, for many priors (one per row of Pis). The matrices G diag(pi_k) for a block of
+// priors are stacked vertically, so that a single GEMM per panel of C computes G J_k for all priors of the block.
+// Large batches run on the GPU, if available (see gpu.h).
+//
+template<typename eT>
+Col<eT> fused_posterior_batch(const Mat<eT>& G, const Mat<eT>& Pis, const Chan<eT>& C, bool minimize = false) {
+	const uint n_w = G.n_rows;
+	const uint block = std::min(std::max(1u, batch_stacked_rows / std::max(1u, n_w)), std::max(1u, Pis.n_rows));	// priors per block
+
+	Col<eT> res = arma::zeros<Col<eT>>(Pis.n_rows);
+	if(n_w == 0)
+		return res;
+
+	if(gpu::use<eT>(2.0 * Pis.n_rows * n_w * C.n_elem))
+		return gpu::DeviceChan<eT>(C).posterior_batch(G, Pis, minimize);
+
+	const uint panel = std::min(posterior_panel_cols, C.n_cols);
+
+	workspace::Frame frame;
+	workspace::Buffer<eT> S_buf(size_t(block) * n_w * G.n_cols), SC_buf(size_t(block) * n_w * panel);
+
+	for(uint k0 = 0; k0 < Pis.n_rows; k0 += block) {
+		uint k1 = std::min(k0 + block, Pis.n_rows);
+
+		Mat<eT> S = S_buf.mat((k1 - k0) * n_w, G.n_cols);
+		for(uint k = k0; k < k1; k++)
+			for(uint x = 0; x < G.n_cols; x++)
+				S.col(x).subvec((k-k0) * n_w, (k-k0+1) * n_w - 1) = G.col(x) * Pis(k, x);
+
+		for(uint y0 = 0; y0 < C.n_cols; y0 += posterior_panel_cols) {
+			uint y1 = std::min(y0 + posterior_panel_cols, C.n_cols) - 1;
+
+			Mat<eT> SC = SC_buf.mat(S.n_rows, y1 - y0 + 1);
+			SC = S * col_panel(C, y0, y1);
+			for(uint k = k0; k < k1; k++)
+				res(k) += col_opt_sum<eT>(SC.rows((k-k0) * n_w, (k-k0+1) * n_w - 1), minimize);
+		}
+	}
+
+	return res;
+}
+
+// sum_y opt_w (G J)_{w,y} for an already computed joint J, in panels of posterior_panel_cols columns
+//
+template<typename eT>
+eT joint_posterior(const Mat<eT>& G, const Mat<eT>& J, bool minimize = false) {
+	workspace::Frame frame;
+	workspace::Buffer<eT> GJ_buf(size_t(G.n_rows) * std::min(posterior_panel_cols, J.n_cols));
+
+	eT sum(0);
+	for(uint y0 = 0; y0 < J.n_cols; y0 += posterior_panel_cols) {
+		uint y1 = std::min(y0 + posterior_panel_cols, J.n_cols) - 1;
+
+		Mat<eT> GJ = GJ_buf.mat(G.n_rows, y1 - y0 + 1);
+		GJ = G * col_panel(J, y0, y1);
+		sum += col_opt_sum<eT>(GJ, minimize);
+	}
+	return sum;
+}
+
+} // namespace aux
+
 // sum_y max_w sum_x pi[x] C[x, y] G[w, x]
 //
 template<typename eT>
@@ -40,12 +283,9 @@ eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C) {
 	check_g_size(G, pi);
 	channel::check_prior_size(pi, C);
 
-	// Use the joint formulation: Vg[pi, C] = sum_y max_w (GJ)_{w,y}
+	// Use the joint formulation: Vg[pi, C] = sum_y max_w (GJ)_{w,y}, computed panel by panel
 	//
-	if(probab::is_uniform(pi))		// common case that can be optimized
-		return arma::accu(arma::max( G * C )) / (int)pi.n_cols;
-	else
-		return arma::accu(arma::max( G * (C.each_col() % trans(pi)) ));
+	return aux::fused_posterior(G, pi, C);
 }
 
 template<typename eT>
@@ -53,6 +293,253 @@ eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const Chan<eT>& C) {
 	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+eT posterior(const metric::CachedMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT posterior(const metric::GridMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	if constexpr (std::is_same<eT, rat>::value)
+		return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+	else
+		return aux::grid_posterior(g, pi, C, false);
+}
+
+// Batch version, computes the posterior vulnerability for many priors at once (one per row of Pis)
+//
+template<typename eT>
+Col<eT> posterior(const Mat<eT>& G, const Mat<eT>& Pis, const Chan<eT>& C) {
+	if(G.n_cols != Pis.n_cols || C.n_rows != Pis.n_cols)
+		throw std::runtime_error("invalid prior size");
+
+	return aux::fused_posterior_batch(G, Pis, C);
+}
+
+template<typename eT>
+Col<eT> posterior(const Metric<eT, uint>& g, const Mat<eT>& Pis, const Chan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, Pis.n_cols), Pis, C);
+}
+
+template<typename eT>
+Col<eT> posterior(const metric::CachedMetric<eT>& g, const Mat<eT>& Pis, const Chan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, Pis.n_cols), Pis, C);
+}
+
+// Sparse version. Each column of G*J is computed separately from the non-zero elements of the corresponding
+// column of C, in O(|W| nnz) time and O(|W|) extra memory.
+//
+template<typename eT>
+eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const SpChan<eT>& C) {
+	check_g_size(G, pi);
+	channel::check_prior_size(pi, C);
+
+	eT sum(0);
+	Col<eT> GJ_col(G.n_rows);
+	for(uint y = 0; y < C.n_cols; y++) {
+		if(C.col_ptrs[y] == C.col_ptrs[y+1])		// empty column, contributes max_w 0 = 0
+			continue;
+
+		GJ_col.zeros();
+		for(auto it = C.begin_col(y); it != C.end_col(y); ++it)
+			GJ_col += G.col(it.row()) * eT(pi(it.row()) * eT(*it));
+		sum += arma::max(GJ_col);
+	}
+	return sum;
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const SpChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT posterior(const metric::CachedMetric<eT>& g, const Prob<eT>& pi, const SpChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+// Memory-mapped version. G J is accumulated over blocks of rows of C, as sum_blocks G_block diag(pi_block) C_block,
+// in O(|W| |Y|) memory.
+//
+template<typename eT>
+eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const channel::MappedChan<eT>& C) {
+	check_g_size(G, pi);
+	channel::check_prior_size(pi, C);
+
+	Mat<eT> GJ = arma::zeros<Mat<eT>>(G.n_rows, C.n_cols), Gp;
+	C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+		uint last = first + Bt.n_cols - 1;
+		Gp = G.cols(first, last);
+		Gp.each_row() %= pi.cols(first, last);
+		GJ += Gp * Bt.t();
+	});
+	return arma::accu(arma::max(GJ, 0));
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const channel::MappedChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+// Lazy version. G J is accumulated one row of C at a time, in O(|W| |Y|) memory (C itself is never stored).
+//
+template<typename eT>
+eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const channel::LazyChan<eT>& C) {
+	check_g_size(G, pi);
+	channel::check_prior_size(pi, C);
+
+	Mat<eT> GJ = arma::zeros<Mat<eT>>(G.n_rows, C.n_cols);
+	Row<eT> row;
+	for(uint x = 0; x < C.n_rows; x++) {
+		if(pi(x) == eT(0))
+			continue;
+
+		C.row(x, row);
+		GJ += Col<eT>(G.col(x) * pi(x)) * row;
+	}
+	return arma::accu(arma::max(GJ, 0));
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const channel::LazyChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+namespace aux {
+
+// sum_y opt_w (G J)_{w,y} for a quantized channel, G J is accumulated over blocks of decoded rows (as for MappedChan)
+//
+template<typename eT, typename Q>
+eT quantized_posterior(const Mat<eT>& G, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C, bool minimize) {
+	check_g_size(G, pi);
+	channel::check_prior_size(pi, C);
+
+	Mat<eT> GJ = arma::zeros<Mat<eT>>(G.n_rows, C.n_cols), Gp;
+	C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+		uint last = first + Bt.n_cols - 1;
+		Gp = G.cols(first, last);
+		Gp.each_row() %= pi.cols(first, last);
+		GJ += Gp * Bt.t();
+	});
+	return arma::accu(minimize ? Row<eT>(arma::min(GJ, 0)) : Row<eT>(arma::max(GJ, 0)));
+}
+
+// bound to the change of sum_y opt_w (G J)_{w,y} due to the quantization: entry (w,y) of G J is off by at most
+// sum_x |G(w,x)| pi(x) C.max_error(x), and so is the optimum of each column
+//
+template<typename eT, typename Q>
+eT quantized_posterior_error(const Mat<eT>& G, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	check_g_size(G, pi);
+	channel::check_prior_size(pi, C);
+
+	return C.n_cols * arma::max(arma::abs(G) * (pi.t() % C.max_errors()));
+}
+
+// sum_y opt_w (G J)_{w,y} for a structured channel (channel::RRChan, channel::GeometricChan, channel::DetChan): row w of G J is
+// (G_w % pi) C, a left product of O(n), so the total cost is O(|W| n) and C is never stored. Rows are processed in
+// parallel, each thread keeping its own running opt_w.
+//
+template<typename eT, typename CT>
+eT structured_posterior(const Mat<eT>& G, const Prob<eT>& pi, const CT& C, bool minimize) {
+	check_g_size(G, pi);
+	channel::check_prior_size(pi, C);
+
+	const uint n_threads = std::max(1u, std::min(parallel::n_threads(), G.n_rows));
+	std::vector<Row<eT>> opt(n_threads);
+	parallel::for_each(n_threads, [&](uint t) {
+		Row<eT> v, row;
+		for(uint w = t; w < G.n_rows; w += n_threads) {
+			v = G.row(w) % pi;
+			C.left(v, row);
+			if(opt[t].is_empty())
+				opt[t] = row;
+			else
+				opt[t] = minimize ? arma::min(opt[t], row) : arma::max(opt[t], row);
+		}
+	});
+
+	Row<eT> res;
+	for(auto& o : opt)
+		if(!o.is_empty())
+			res = res.is_empty() ? o : minimize ? Row<eT>(arma::min(res, o)) : Row<eT>(arma::max(res, o));
+	return arma::accu(res);
+}
+
+} // namespace aux
+
+// Structured channels (see channel/structured.h), in O(|W| n) time and O(n) memory per thread
+//
+template<typename eT>
+eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const channel::RRChan<eT>& C) {
+	return aux::structured_posterior(G, pi, C, false);
+}
+
+template<typename eT>
+eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const channel::GeometricChan<eT>& C) {
+	return aux::structured_posterior(G, pi, C, false);
+}
+
+template<typename eT>
+eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const channel::DetChan<eT>& C) {
+	return aux::structured_posterior(G, pi, C, false);
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const channel::RRChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const channel::GeometricChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const channel::DetChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+// Quantized channels (see channel::QuantizedChan). posterior_error bounds the difference from the posterior
+// vulnerability of the uncompressed channel.
+//
+template<typename eT, typename Q>
+eT posterior(const Mat<eT>& G, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	return aux::quantized_posterior(G, pi, C, false);
+}
+
+template<typename eT, typename Q>
+eT posterior(const Metric<eT, uint>& g, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	return posterior(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT, typename Q>
+eT posterior_error(const Mat<eT>& G, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	return aux::quantized_posterior_error(G, pi, C);
+}
+
+// Shared (pi, C), see channel::PosteriorContext. Uses the cached joint, so for many G's the joint is built only once.
+//
+template<typename eT>
+eT posterior(const Mat<eT>& G, const channel::PosteriorContext<eT>& ctx) {
+	check_g_size(G, ctx.pi);
+	return aux::joint_posterior(G, ctx.joint());
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& g, const channel::PosteriorContext<eT>& ctx) {
+	return posterior(metric::to_distance_matrix(g, ctx.pi.n_cols), ctx);
+}
+
+template<typename eT>
+eT add_leakage(const Mat<eT>& G, const channel::PosteriorContext<eT>& ctx) {
+	return posterior(G, ctx) - prior(G, ctx.pi);
+}
+
+template<typename eT>
+eT mult_leakage(const Mat<eT>& G, const channel::PosteriorContext<eT>& ctx) {
+	return posterior(G, ctx) / prior(G, ctx.pi);
+}
+
 template<typename eT>
 eT add_leakage(const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C) {
 	return posterior(G, pi, C) - prior(G, pi);
@@ -63,6 +550,16 @@ eT add_leakage(const Metric<eT, uint>& g, const Prob<eT>& pi, const Chan<eT>& C)
 	return add_leakage(metric::to_distance_matrix(g, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+eT add_leakage(const metric::CachedMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	return add_leakage(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT add_leakage(const metric::GridMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	return posterior(g, pi, C) - prior(g, pi);
+}
+
 template<typename eT>
 eT mult_leakage(const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C) {
 	return posterior(G, pi, C) / prior(G, pi);
@@ -73,16 +570,78 @@ eT mult_leakage(const Metric<eT, uint>& g, const Prob<eT>& pi, const Chan<eT>& C
 	return mult_leakage(metric::to_distance_matrix(g, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+eT mult_leakage(const metric::CachedMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	return mult_leakage(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT mult_leakage(const metric::GridMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	return posterior(g, pi, C) / prior(g, pi);
+}
+
+namespace aux {
+
+const uint strategy_block = 256;
+
+// res(y, k) = argmax_w (or argmin) of (G diag(priors.row(k)) C)(w, y), for all outputs y and priors k (the first one
+// in case of ties). The columns priors.row(k)' % C.col(y) of all pairs (k, y) are gathered in blocks of
+// strategy_block, each block is multiplied by G with a single GEMM and the argmax of each column of the product is
+// taken right away, so only a |W| x strategy_block product is stored at any time. Blocks are processed in parallel.
+//
+template<typename eT>
+arma::umat strategy_kernel(const Mat<eT>& G, const Mat<eT>& priors, const Chan<eT>& C, bool minimize) {
+	check_g_size(G, priors);
+	if(C.n_rows != priors.n_cols)
+		throw std::runtime_error("invalid prior size");
+
+	const uint n = C.n_rows, m = C.n_cols, n_pairs = m * priors.n_rows;
+	arma::umat res(m, priors.n_rows);
+
+	const uint n_blocks = (n_pairs + strategy_block - 1) / strategy_block;
+	parallel::for_each(n_blocks, [&](uint b) {
+		const uint t0 = b * strategy_block, t1 = std::min(t0 + strategy_block, n_pairs);
+		Mat<eT> J(n, t1 - t0);
+		for(uint t = t0; t < t1; t++) {
+			const uint k = t / m, y = t % m;
+			for(uint x = 0; x < n; x++)
+				J(x, t - t0) = priors(k, x) * C(x, y);
+		}
+
+		const Mat<eT> GJ = G * J;
+		for(uint j = 0; j < GJ.n_cols; j++) {
+			uint best = 0;
+			for(uint w = 1; w < GJ.n_rows; w++)
+				if(minimize ? GJ(w, j) < GJ(best, j) : GJ(best, j) < GJ(w, j))
+					best = w;
+			res((t0 + j) % m, (t0 + j) / m) = best;
+		}
+	});
+
+	return res;
+}
+
+} // namespace aux
+
 template<typename eT>
 arma::ucolvec strategy(const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C) {
 	check_g_size(G, pi);
 	channel::check_prior_size(pi, C);
 
-	arma::ucolvec strategy(C.n_cols);
-	for(uint y = 0; y < C.n_cols; y++)
-		(G * (trans(pi) % C.col(y))).max( strategy.at(y) );
+	return aux::strategy_kernel(G, Mat<eT>(pi), C, false).col(0);
+}
+
+// The optimal strategies for many priors (one per row of priors) at once, column k is strategy(G, priors.row(k), C).
+// Much faster than calling strategy for each prior, see aux::strategy_kernel.
+//
+template<typename eT>
+arma::umat strategies(const Mat<eT>& G, const Mat<eT>& priors, const Chan<eT>& C) {
+	return aux::strategy_kernel(G, priors, C, false);
+}
 
-	return strategy;
+template<typename eT>
+arma::umat strategies(const Metric<eT, uint>& g, const Mat<eT>& priors, const Chan<eT>& C) {
+	return strategies(metric::to_distance_matrix(g, priors.n_cols), priors, C);
 }
 
 template<typename eT>
@@ -90,6 +649,185 @@ arma::ucolvec strategy(const Metric<eT, uint>& g, const Prob<eT>& pi, const Chan
 	return strategy(metric::to_distance_matrix(g, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+arma::ucolvec strategy(const metric::CachedMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	return strategy(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+arma::ucolvec strategy(const metric::GridMetric<eT>& g, const Prob<eT>& pi, const Chan<eT>& C) {
+	if constexpr (std::is_same<eT, rat>::value) {
+		return strategy(metric::to_distance_matrix(g, pi.n_cols), pi, C);
+	} else {
+		arma::ucolvec res;
+		aux::grid_posterior(g, pi, C, false, &res);
+		return res;
+	}
+}
+
+
+// Maintains posterior(G, pi, C) (or l_risk::posterior if minimize == true) while entries, rows or columns of C change,
+// eg in a local search over channels. The product GJ = G diag(pi) C is kept, a change of row x of C adds the rank-one
+// term pi(x) G.col(x) (new - old) to it, so updating (and re-optimizing every column over w) costs O(|W| m) instead of
+// O(|W| n m). value_with_row evaluates a candidate row without applying it, at the same cost.
+//
+template<typename eT>
+class IncrementalPosterior {
+	public:
+		IncrementalPosterior(const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C, bool minimize = false)
+			: G(G), pi(pi), C(C), minimize(minimize) {
+			check_g_size(G, pi);
+			channel::check_prior_size(pi, C);
+			recompute();
+		}
+
+		eT value() const					{ return sum; }
+		const Chan<eT>& channel() const		{ return C; }
+
+		void set(uint x, uint y, const eT& v) {
+			GJ.col(y) += G.col(x) * (pi(x) * (v - C(x, y)));
+			C(x, y) = v;
+			sum += reoptimize(y);
+		}
+
+		void set_row(uint x, const Row<eT>& row) {
+			if(row.n_elem != C.n_cols) throw std::runtime_error("invalid row size");
+			GJ += Col<eT>(G.col(x) * pi(x)) * Row<eT>(row - C.row(x));
+			C.row(x) = row;
+			for(uint y = 0; y < C.n_cols; y++)
+				sum += reoptimize(y);
+		}
+
+		void set_col(uint y, const Col<eT>& col) {
+			if(col.n_elem != C.n_rows) throw std::runtime_error("invalid column size");
+			C.col(y) = col;
+			GJ.col(y) = G * (col % pi.t());
+			sum += reoptimize(y);
+		}
+
+		// changes pi(x), adding (p - pi(x)) G.col(x) C.row(x) to GJ, in O(|W| m). pi need not sum to 1 (see Monitor).
+		void set_prior(uint x, const eT& p) {
+			if(x >= pi.n_cols) throw std::runtime_error("invalid prior index");
+			GJ += Col<eT>(G.col(x) * (p - pi(x))) * Row<eT>(C.row(x));
+			pi(x) = p;
+			for(uint y = 0; y < C.n_cols; y++)
+				sum += reoptimize(y);
+		}
+
+		const Prob<eT>& prior() const		{ return pi; }
+		const Mat<eT>& gain() const			{ return G; }
+
+		// value() if row x of C was replaced by row
+		eT value_with_row(uint x, const Row<eT>& row) const {
+			if(row.n_elem != C.n_cols) throw std::runtime_error("invalid row size");
+			const Col<eT> g = G.col(x) * pi(x);
+			eT res(0);
+			for(uint y = 0; y < C.n_cols; y++) {
+				const eT d = row(y) - C(x, y);
+				eT o = GJ(0, y) + g(0) * d;
+				for(uint w = 1; w < G.n_rows; w++) {
+					eT v = GJ(w, y) + g(w) * d;
+					if(minimize ? v < o : v > o)
+						o = v;
+				}
+				res += o;
+			}
+			return res;
+		}
+
+		// GJ recomputed from scratch, to discard the rounding errors accumulated by the updates
+		void recompute() {
+			Mat<eT> J = C;
+			J.each_col() %= pi.t();
+			GJ = G * J;
+			col_opt = minimize ? Row<eT>(arma::min(GJ, 0)) : Row<eT>(arma::max(GJ, 0));
+			sum = arma::accu(col_opt);
+		}
+
+	private:
+		Mat<eT> G;
+		Prob<eT> pi;
+		Chan<eT> C;
+		bool minimize;
+		Mat<eT> GJ;
+		Row<eT> col_opt;
+		eT sum;
+
+		// recomputes the optimum of column y, returns its change
+		eT reoptimize(uint y) {
+			eT o = minimize ? GJ.col(y).min() : GJ.col(y).max(),
+			   diff = o - col_opt(y);
+			col_opt(y) = o;
+			return diff;
+		}
+};
+
+// g-vulnerability version of bayes_vuln::Monitor: leakage of a fixed channel C under a prior given by unnormalized
+// weights that change a few cells at a time (l_risk if minimize == true). An IncrementalPosterior keeps
+// G diag(w) C, and G w is kept for the prior vulnerability, so changing a weight costs O(|W| m) instead of O(|W| n m).
+// Every resync_every updates (0: never) everything is recomputed exactly.
+//
+template<typename eT>
+class Monitor {
+	public:
+		Monitor(const Mat<eT>& G, const Chan<eT>& C, const Prob<eT>& weights, bool minimize = false, uint resync_every = 1 << 12)
+			: inc(G, weights, C, minimize), minimize(minimize), resync_every(resync_every) {
+			for(auto& w : weights)
+				if(w < eT(0)) throw std::runtime_error("negative weight");
+			resync();
+			if(total <= eT(0)) throw std::runtime_error("zero total weight");
+		}
+
+		// w(x) += d
+		void add(uint x, const eT& d) {
+			set(x, weight(x) + d);
+		}
+
+		// w(x) = v
+		void set(uint x, const eT& v) {
+			if(v < eT(0)) throw std::runtime_error("negative weight");
+			const eT d = v - weight(x);
+			inc.set_prior(x, v);
+			Gw += inc.gain().col(x) * d;
+			total += d;
+
+			if(resync_every > 0 && ++n_updates >= resync_every)
+				resync();
+		}
+
+		// w(cells(i)) += delta(i) for all i
+		void add(const arma::ucolvec& cells, const Col<eT>& delta) {
+			if(cells.n_elem != delta.n_elem) throw std::runtime_error("invalid delta size");
+			for(uint i = 0; i < cells.n_elem; i++)
+				add(cells(i), delta(i));
+		}
+
+		eT weight(uint x) const				{ return inc.prior()(x); }
+		const Prob<eT>& weights() const		{ return inc.prior(); }
+		eT total_weight() const				{ return total; }
+		Prob<eT> prior_dist() const			{ return inc.prior() / total; }
+
+		// g_vuln (or l_risk) prior/posterior/leakage for the normalized prior
+		eT prior() const					{ return (minimize ? Gw.min() : Gw.max()) / total; }
+		eT posterior() const				{ return inc.value() / total; }
+		eT mult_leakage() const				{ return posterior() / prior(); }
+		eT add_leakage() const				{ return posterior() - prior(); }
+
+		// exact recomputation, in O(|W| n m)
+		void resync() {
+			inc.recompute();
+			Gw = inc.gain() * inc.prior().t();
+			total = arma::accu(inc.prior());
+			n_updates = 0;
+		}
+
+	private:
+		IncrementalPosterior<eT> inc;
+		bool minimize;
+		uint resync_every, n_updates = 0;
+		Col<eT> Gw;
+		eT total;
+};
 
 // additive capacity for fixed pi and g ranging over 1-spanning Vg's (larger class, default) or
 // 1-spanning g's (if one_spanning_g == true)
@@ -112,24 +850,32 @@ eT add_capacity(const Prob<eT>& pi, const Chan<eT>& C, bool one_spanning_g = fal
 		// metric::convex_separation_quasi<eT, Prob<eT>>();
 		Prob<eT> outer = pi * C;
 
+		CompensatedSum<eT> sum;
 		for(uint y = 0; y < outer.n_elem; y++)
 			if(!equal(outer(y), eT(0)))		// ignore 0 prob outputs
-				res += outer(y) * tv(pi, channel::posterior(C, pi, y));
+				sum.add(outer(y) * tv(pi, channel::posterior(C, pi, y)));
+		res = sum.value();
 
-		
 	} else {
 		// For the larger class of 1-spanning Vg's, the capacity only depends on the support of pi and is
 		// equal to 1 - the sum of column minima (including only rows in the support of pi).
 		// The same result can also be obtained via the Kantorovich above, replacing tv with convex_separation_quasi.
 		// 
-		res = 1;
-		for(uint y = 0; y < C.n_cols; y++) {
+		std::vector<uint> support;
+		for(uint x = 0; x < C.n_rows; x++)
+			if(!equal(pi(x), eT(0)))
+				support.push_back(x);
+
+		CompensatedSum<eT> sum;
+		sum.add_each(C.n_cols, [&](size_t y) {
 			eT min(1);
-			for(uint x = 0; x < C.n_rows; x++)
-				if(!equal(pi(x), eT(0)) && C(x,y) < min)
-					min = C(x,y);
-			res -= min;
-		}
+			const eT* col = C.colptr(y);
+			for(uint x : support)
+				if(col[x] < min)
+					min = col[x];
+			return min;
+		});
+		res = 1 - sum.value();
 	}
 
 	return res;
@@ -273,4 +1019,9 @@ std::tuple<Prob<eT>,Chan<eT>,eT,eT> g_to_bayes(const Metric<eT, uint>& g, const
 	return g_to_bayes(metric::to_distance_matrix(g, pi.n_cols), pi);
 }
 
+template<typename eT>
+std::tuple<Prob<eT>,Chan<eT>,eT,eT> g_to_bayes(const metric::CachedMetric<eT>& g, const Prob<eT>& pi) {
+	return g_to_bayes(metric::to_distance_matrix(g, pi.n_cols), pi);
+}
+
 } // namespace g_vuln
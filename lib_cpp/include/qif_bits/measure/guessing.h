@@ -1,28 +1,181 @@
 
 namespace measure::guessing {
 
+namespace aux {
+
+// Sorts v in decreasing order. For large float/double vectors of non-negative values, by an LSD radix sort of their
+// bits (which are ordered as the values), using tmp as scratch; passes over bytes that are equal in all keys (eg the
+// high bytes of the exponent, for probabilities) are skipped.
+//
 template<typename eT>
-eT prior(const Prob<eT>& pi) {
-	Prob<eT> sorted = sort(pi);
+void sort_desc(std::vector<eT>& v, std::vector<eT>& tmp) {
+	if constexpr (std::is_floating_point<eT>::value) {
+		typedef typename std::conditional<sizeof(eT) == 8, uint64_t, uint32_t>::type Key;
+		const size_t n = v.size();
+		if(n >= 256) {
+			auto key = [](eT x) { Key k; std::memcpy(&k, &x, sizeof(k)); return ~k; };		// ~: decreasing order
+			tmp.resize(n);
 
-	eT sum(0);
-	for(uint x = 1; x <= sorted.n_cols; ++x) {
-		sum += x * sorted.at(sorted.n_cols - x);
+			uint count[sizeof(Key)][256] = {};
+			for(eT x : v) {
+				Key k = key(x);
+				for(uint d = 0; d < sizeof(Key); d++)
+					count[d][(k >> (8 * d)) & 0xff]++;
+			}
+
+			for(uint d = 0; d < sizeof(Key); d++) {
+				if(count[d][(key(v[0]) >> (8 * d)) & 0xff] == n)
+					continue;
+				uint pos = 0;
+				for(uint& c : count[d]) {
+					uint next = pos + c;
+					c = pos;
+					pos = next;
+				}
+				for(eT x : v)
+					tmp[count[d][(key(x) >> (8 * d)) & 0xff]++] = x;
+				v.swap(tmp);
+			}
+			return;
+		}
 	}
+	std::sort(v.begin(), v.end(), std::greater<eT>());
+}
+
+// sum_i (i+1) v_(i) over the entries of v sorted in decreasing order (v is reordered)
+template<typename eT>
+eT guess_sum(std::vector<eT>& v, std::vector<eT>& tmp) {
+	sort_desc(v, tmp);
+
+	eT sum(0);
+	for(uint i = 0; i < v.size(); i++)
+		sum += eT(i + 1) * v[i];
+	return sum;
+}
+
+// same with at most k guesses: sum_{i<k} (i+1) v_(i) + k (sum v - sum_{i<k} v_(i)), ie the guesser stops after k
+// attempts. Only the k largest entries are sorted (nth_element, then a sort of k elements).
+//
+template<typename eT>
+eT guess_sum_k(std::vector<eT>& v, uint k) {
+	if(k < v.size())
+		std::nth_element(v.begin(), v.begin() + k, v.end(), std::greater<eT>());
+	uint n = std::min<size_t>(k, v.size());
+	std::sort(v.begin(), v.begin() + n, std::greater<eT>());
+
+	eT sum(0), rest(0);
+	for(uint i = 0; i < n; i++)
+		sum += eT(i + 1) * v[i];
+	for(uint i = n; i < v.size(); i++)
+		rest += v[i];
+	return sum + eT(k) * rest;
+}
+
+// sum_y f(v_y), v_y the positive entries of column y given by fill(y, v) (v is empty when called). Columns are
+// processed in parallel blocks and summed in column order. The scratch buffers are per thread and kept across calls,
+// the per-column results come from the current workspace, if any.
+//
+template<typename eT, typename Fill, typename F>
+eT sum_columns(uint n_cols, Fill fill, F f) {
+	const uint block = 64;
+
+	workspace::Frame frame;
+	workspace::Buffer<eT> res_buf(n_cols);
+	eT* res = res_buf.memptr();
+
+	parallel::for_each((n_cols + block - 1) / block, [&](uint b) {
+		thread_local std::vector<eT> v, tmp;
+		for(uint y = b * block; y < std::min(n_cols, (b + 1) * block); y++) {
+			v.clear();
+			fill(y, v);
+			res[y] = f(v, tmp);
+		}
+	});
+
+	eT sum(0);
+	for(uint y = 0; y < n_cols; y++)
+		sum += res[y];
 	return sum;
 }
 
+template<typename eT>
+void push_positive(std::vector<eT>& v, const Prob<eT>& pi, const Chan<eT>& C, uint y) {
+	const eT* col = C.colptr(y);
+	for(uint x = 0; x < C.n_rows; x++)
+		if(col[x] > 0 && pi.at(x) > 0)
+			v.push_back(pi.at(x) * col[x]);
+}
+
+} // namespace aux
+
+// G(pi) = sum_i i pi_(i), pi_(i) the i-th largest probability (zero entries, guessed last, don't contribute)
+//
+template<typename eT>
+eT prior(const Prob<eT>& pi) {
+	std::vector<eT> v, tmp;
+	for(const eT& p : pi)
+		if(p > 0)
+			v.push_back(p);
+	return aux::guess_sum(v, tmp);
+}
+
+// sum_y G(pi % C[-,y]), without forming the (mostly sparse) columns: only their positive entries are collected in
+// per-thread buffers and sorted, in parallel over y.
+//
 template<typename eT>
 eT posterior(const Prob<eT>& pi, const Chan<eT>& C) {
 	channel::check_prior_size(pi, C);
 
-	eT result(0);
-	for(uint y = 0; y < C.n_cols; y++) {
-		//create the vector vy = pi(1)* C[1,y] ... pi(x)* C[x,y]
-		Prob<eT> vy = pi % arma::trans(C.col(y));
-		result += prior<eT>(vy);
-	}
-	return result;
+	return aux::sum_columns<eT>(C.n_cols,
+		[&](uint y, std::vector<eT>& v) { aux::push_positive(v, pi, C, y); },
+		[](std::vector<eT>& v, std::vector<eT>& tmp) { return aux::guess_sum(v, tmp); });
+}
+
+// Shared (pi, C), see channel::PosteriorContext. The columns of the cached joint are the vectors vy.
+//
+template<typename eT>
+eT posterior(const channel::PosteriorContext<eT>& ctx) {
+	const Mat<eT>& J = ctx.joint();
+
+	return aux::sum_columns<eT>(J.n_cols,
+		[&](uint y, std::vector<eT>& v) {
+			for(const eT& el : J.col(y))
+				if(el > 0)
+					v.push_back(el);
+		},
+		[](std::vector<eT>& v, std::vector<eT>& tmp) { return aux::guess_sum(v, tmp); });
+}
+
+// Guessing with at most k attempts: the expected number of guesses of an adversary who stops after k of them,
+// sum_{i<=k} i pi_(i) + k sum_{i>k} pi_(i). Equal to prior(pi) for k >= n.
+//
+template<typename eT>
+eT prior_k(const Prob<eT>& pi, uint k) {
+	std::vector<eT> v;
+	for(const eT& p : pi)
+		if(p > 0)
+			v.push_back(p);
+	return aux::guess_sum_k(v, k);
+}
+
+// sum_y G_k(pi % C[-,y])
+template<typename eT>
+eT posterior_k(const Prob<eT>& pi, const Chan<eT>& C, uint k) {
+	channel::check_prior_size(pi, C);
+
+	return aux::sum_columns<eT>(C.n_cols,
+		[&](uint y, std::vector<eT>& v) { aux::push_positive(v, pi, C, y); },
+		[k](std::vector<eT>& v, std::vector<eT>&) { return aux::guess_sum_k(v, k); });
+}
+
+template<typename eT>
+eT add_leakage(const channel::PosteriorContext<eT>& ctx) {
+	return prior(ctx.pi) - posterior(ctx);
+}
+
+template<typename eT>
+eT mult_leakage(const channel::PosteriorContext<eT>& ctx) {
+	return prior(ctx.pi) / posterior(ctx);
 }
 
 template<typename eT>
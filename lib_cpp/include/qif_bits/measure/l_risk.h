@@ -13,9 +13,28 @@ eT prior(const Metric<eT, uint>& l, const Prob<eT>& pi) {
 	return prior(metric::to_distance_matrix(l, pi.n_cols), pi);
 }
 
+template<typename eT>
+eT prior(const metric::CachedMetric<eT>& l, const Prob<eT>& pi) {
+	return prior(metric::to_distance_matrix(l, pi.n_cols), pi);
+}
+
+// grid-metric versions, see g_vuln
+template<typename eT>
+eT prior(const metric::GridMetric<eT>& l, const Prob<eT>& pi) {
+	if constexpr (std::is_same<eT, rat>::value)
+		return prior(metric::to_distance_matrix(l, pi.n_cols), pi);
+	else
+		return g_vuln::aux::grid_prior(l, pi, true);
+}
+
+// sum_y min_w sum_x pi[x] C[x, y] L[w, x], computed directly with min (no need to negate L)
+//
 template<typename eT>
 eT posterior(const Mat<eT>& L, const Prob<eT>& pi, const Chan<eT>& C) {
-	return eT(-1) * g_vuln::posterior<eT>(eT(-1) * L, pi, C);
+	g_vuln::check_g_size(L, pi);
+	channel::check_prior_size(pi, C);
+
+	return g_vuln::aux::fused_posterior(L, pi, C, true);
 }
 
 template<typename eT>
@@ -23,6 +42,112 @@ eT posterior(const Metric<eT, uint>& l, const Prob<eT>& pi, const Chan<eT>& C) {
 	return posterior(metric::to_distance_matrix(l, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+eT posterior(const metric::CachedMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	return posterior(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT posterior(const metric::GridMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	if constexpr (std::is_same<eT, rat>::value)
+		return posterior(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+	else
+		return g_vuln::aux::grid_posterior(l, pi, C, true);
+}
+
+// Structured channels (see channel/structured.h), in O(|W| n) time
+//
+template<typename eT>
+eT posterior(const Mat<eT>& L, const Prob<eT>& pi, const channel::RRChan<eT>& C) {
+	return g_vuln::aux::structured_posterior(L, pi, C, true);
+}
+
+template<typename eT>
+eT posterior(const Mat<eT>& L, const Prob<eT>& pi, const channel::GeometricChan<eT>& C) {
+	return g_vuln::aux::structured_posterior(L, pi, C, true);
+}
+
+template<typename eT>
+eT posterior(const Mat<eT>& L, const Prob<eT>& pi, const channel::DetChan<eT>& C) {
+	return g_vuln::aux::structured_posterior(L, pi, C, true);
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& l, const Prob<eT>& pi, const channel::RRChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& l, const Prob<eT>& pi, const channel::GeometricChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& l, const Prob<eT>& pi, const channel::DetChan<eT>& C) {
+	return posterior(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+// Quantized channels, the codes are decoded in blocks of rows (see channel::QuantizedChan). posterior_error bounds
+// the difference from the posterior risk of the uncompressed channel.
+//
+template<typename eT, typename Q>
+eT posterior(const Mat<eT>& L, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	return g_vuln::aux::quantized_posterior(L, pi, C, true);
+}
+
+template<typename eT, typename Q>
+eT posterior(const Metric<eT, uint>& l, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	return posterior(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+template<typename eT, typename Q>
+eT posterior_error(const Mat<eT>& L, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+	return g_vuln::aux::quantized_posterior_error(L, pi, C);
+}
+
+// Shared (pi, C), see channel::PosteriorContext
+//
+template<typename eT>
+eT posterior(const Mat<eT>& L, const channel::PosteriorContext<eT>& ctx) {
+	g_vuln::check_g_size(L, ctx.pi);
+	return g_vuln::aux::joint_posterior(L, ctx.joint(), true);
+}
+
+template<typename eT>
+eT posterior(const Metric<eT, uint>& l, const channel::PosteriorContext<eT>& ctx) {
+	return posterior(metric::to_distance_matrix(l, ctx.pi.n_cols), ctx);
+}
+
+template<typename eT>
+eT add_leakage(const Mat<eT>& L, const channel::PosteriorContext<eT>& ctx) {
+	return prior(L, ctx.pi) - posterior(L, ctx);
+}
+
+template<typename eT>
+eT mult_leakage(const Mat<eT>& L, const channel::PosteriorContext<eT>& ctx) {
+	return prior(L, ctx.pi) / posterior(L, ctx);
+}
+
+// Batch version, computes the posterior risk for many priors at once (one per row of Pis)
+//
+template<typename eT>
+Col<eT> posterior(const Mat<eT>& L, const Mat<eT>& Pis, const Chan<eT>& C) {
+	if(L.n_cols != Pis.n_cols || C.n_rows != Pis.n_cols)
+		throw std::runtime_error("invalid prior size");
+
+	return g_vuln::aux::fused_posterior_batch(L, Pis, C, true);
+}
+
+template<typename eT>
+Col<eT> posterior(const Metric<eT, uint>& l, const Mat<eT>& Pis, const Chan<eT>& C) {
+	return posterior(metric::to_distance_matrix(l, Pis.n_cols), Pis, C);
+}
+
+template<typename eT>
+Col<eT> posterior(const metric::CachedMetric<eT>& l, const Mat<eT>& Pis, const Chan<eT>& C) {
+	return posterior(metric::to_distance_matrix(l, Pis.n_cols), Pis, C);
+}
+
 template<typename eT>
 eT add_leakage(const Mat<eT>& L, const Prob<eT>& pi, const Chan<eT>& C) {
 	return prior(L, pi) - posterior(L, pi, C);
@@ -33,6 +158,16 @@ eT add_leakage(const Metric<eT, uint>& l, const Prob<eT>& pi, const Chan<eT>& C)
 	return add_leakage(metric::to_distance_matrix(l, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+eT add_leakage(const metric::CachedMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	return add_leakage(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT add_leakage(const metric::GridMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	return prior(l, pi) - posterior(l, pi, C);
+}
+
 template<typename eT>
 eT mult_leakage(const Mat<eT>& L, const Prob<eT>& pi, const Chan<eT>& C) {
 	return prior(L, pi) / posterior(L, pi, C);
@@ -43,9 +178,34 @@ eT mult_leakage(const Metric<eT, uint>& l, const Prob<eT>& pi, const Chan<eT>& C
 	return mult_leakage(metric::to_distance_matrix(l, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+eT mult_leakage(const metric::CachedMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	return mult_leakage(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+eT mult_leakage(const metric::GridMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	return prior(l, pi) / posterior(l, pi, C);
+}
+
 template<typename eT>
 arma::ucolvec strategy(const Mat<eT>& L, const Prob<eT>& pi, const Chan<eT>& C) {
-	return g_vuln::strategy<eT>(eT(-1) * L, pi, C);
+	g_vuln::check_g_size(L, pi);
+	channel::check_prior_size(pi, C);
+
+	return g_vuln::aux::strategy_kernel(L, Mat<eT>(pi), C, true).col(0);
+}
+
+// The optimal strategies for many priors (one per row of priors), see g_vuln::strategies
+//
+template<typename eT>
+arma::umat strategies(const Mat<eT>& L, const Mat<eT>& priors, const Chan<eT>& C) {
+	return g_vuln::aux::strategy_kernel(L, priors, C, true);
+}
+
+template<typename eT>
+arma::umat strategies(const Metric<eT, uint>& l, const Mat<eT>& priors, const Chan<eT>& C) {
+	return strategies(metric::to_distance_matrix(l, priors.n_cols), priors, C);
 }
 
 template<typename eT>
@@ -53,6 +213,22 @@ arma::ucolvec strategy(const Metric<eT, uint>& l, const Prob<eT>& pi, const Chan
 	return strategy(metric::to_distance_matrix(l, pi.n_cols), pi, C);
 }
 
+template<typename eT>
+arma::ucolvec strategy(const metric::CachedMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	return strategy(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+}
+
+template<typename eT>
+arma::ucolvec strategy(const metric::GridMetric<eT>& l, const Prob<eT>& pi, const Chan<eT>& C) {
+	if constexpr (std::is_same<eT, rat>::value) {
+		return strategy(metric::to_distance_matrix(l, pi.n_cols), pi, C);
+	} else {
+		arma::ucolvec res;
+		g_vuln::aux::grid_posterior(l, pi, C, true, &res);
+		return res;
+	}
+}
+
 template<typename eT>
 eT add_capacity(const Prob<eT>& pi, const Chan<eT>& C, bool one_spanning_g = false) {
 	return g_vuln::add_capacity(pi, C, one_spanning_g);
@@ -1,17 +1,165 @@
-
 namespace measure::shannon {
 
-// H(X) = - sum_x pi[x] log2(pi[x])
+namespace aux {
+
+inline std::atomic<bool>& fast_log2_flag() {
+	static std::atomic<bool> b(false);
+	return b;
+}
+
+// log2 of a positive double, with absolute error below 2e-9. We write a = 2^k m with m in [sqrt(2)/2, sqrt(2)), k
+// obtained by subtracting the bits of sqrt(2)/2 from those of a, and log2(m) = 2/ln(2) atanh(s), s = (m-1)/(m+1),
+// |s| < 0.172, from the first 5 terms of the series of atanh. Only integer and arithmetic operations (no branches or
+// table lookups), so loops calling it are vectorised by the compiler, unlike loops calling std::log2.
+//
+inline double fast_log2(double a) {
+	uint64_t bits;
+	std::memcpy(&bits, &a, sizeof(bits));
+	int64_t k = (int64_t(bits) - int64_t(0x3fe6a09e667f3bcd)) >> 52;
+	bits -= uint64_t(k) << 52;
+	double m;
+	std::memcpy(&m, &bits, sizeof(m));
+
+	double s = (m - 1) / (m + 1), s2 = s * s;
+	return double(k) + s * 2.8853900817779268 * (1 + s2 * (1.0/3 + s2 * (1.0/5 + s2 * (1.0/7 + s2 * (1.0/9)))));
+}
+
+// -p log2(p) for p >= 0 (0 for p = 0). The fast version replaces 0 by 1 (and drops the sign of -0) with integer
+// operations, since a floating point comparison prevents vectorisation.
+//
+template<typename eT, bool fast>
+inline eT entropy_term(eT p) {
+	if constexpr (fast && !std::is_same<eT, rat>::value) {
+		double v = double(p);
+		uint64_t bits;
+		std::memcpy(&bits, &v, sizeof(bits));
+		bits &= ~(uint64_t(1) << 63);
+		bits += uint64_t(bits == 0) * 0x3ff0000000000000;		// bits of 1.0
+		std::memcpy(&v, &bits, sizeof(v));
+		return -p * eT(fast_log2(v));
+
+	} else {
+		return p > 0 ? eT(-p * qif::log2(p)) : eT(0);
+	}
+}
+
+// - sum_i p[i] log2(p[i]) over n contiguous elements. Summed in independent lanes, since the compiler does not reorder
+// a single floating point sum (and the loop would not be vectorised).
+//
+template<typename eT, bool fast>
+eT entropy_sum(const eT* p, size_t n) {
+	const size_t lanes = 8;
+	accum_t<eT> acc[lanes] = {};
+	size_t i = 0;
+	for(; i + lanes <= n; i += lanes)
+		for(size_t j = 0; j < lanes; j++)
+			acc[j] += entropy_term<eT, fast>(p[i + j]);
+	for(; i < n; i++)
+		acc[0] += entropy_term<eT, fast>(p[i]);
+
+	accum_t<eT> sum = 0;
+	for(size_t j = 0; j < lanes; j++)
+		sum += acc[j];
+	return eT(sum);
+}
+
+// H(Y|X) = sum_x pi[x] H(C[x,-]), read directly from the column-major storage of C: for a block of rows, the entropy
+// of each row is accumulated column by column (so the inner loop runs over contiguous elements). Blocks are processed
+// in parallel, each row's sum is computed by a single thread in a fixed order, so the result is deterministic.
+//
+template<typename eT, bool fast>
+eT cond_entropy(const Prob<eT>& pi, const Chan<eT>& C) {
+	const uint block = 256;
+	const uint n_blocks = (C.n_rows + block - 1) / block;
+	std::vector<accum_t<eT>> h(C.n_rows, accum_t<eT>(0));
+
+	auto run = [&](uint b) {
+		uint first = b * block, n = std::min(C.n_rows - first, block);
+		accum_t<eT>* hb = h.data() + first;
+		for(uint y = 0; y < C.n_cols; y++) {
+			const eT* col = C.colptr(y) + first;
+			for(uint i = 0; i < n; i++)
+				hb[i] += entropy_term<eT, fast>(col[i]);
+		}
+	};
+	if(uint64_t(C.n_elem) < (1 << 16))
+		for(uint b = 0; b < n_blocks; b++)
+			run(b);
+	else
+		parallel::for_each(n_blocks, run);
+
+	accum_t<eT> Hyx = 0;
+	for(uint x = 0; x < C.n_rows; x++)
+		Hyx += pi.at(x) * h[x];
+	return eT(Hyx);
+}
+
+// the output distribution pi C. For float every column is summed in double (in parallel), instead of a float GEMV.
 //
 template<typename eT>
-eT prior(const Prob<eT>& pi) {
-	eT sum_x = 0;
-	for(uint x = 0; x < pi.n_cols; x++) {
-		eT el = pi.at(x);
-		sum_x -= el > 0 ? el * qif::log2(el) : 0;
+Prob<eT> outer(const Prob<eT>& pi, const Chan<eT>& C) {
+	if constexpr (std::is_same<eT, accum_t<eT>>::value) {
+		return pi * C;
+	} else {
+		Prob<eT> out(C.n_cols);
+		auto run = [&](uint y) {
+			const eT* col = C.colptr(y);
+			accum_t<eT> sum(0);
+			for(uint x = 0; x < C.n_rows; x++)
+				sum += accum_t<eT>(pi.at(x)) * col[x];
+			out.at(y) = eT(sum);
+		};
+		if(uint64_t(C.n_elem) < (1 << 16))
+			for(uint y = 0; y < C.n_cols; y++)
+				run(y);
+		else
+			parallel::for_each(C.n_cols, run);
+		return out;
 	}
+}
 
-	return sum_x;
+// H(Y|X) + H(X) - H(Y) for an N x M channel (column-major), with constant loop bounds
+template<uint N, uint M, typename eT, bool fast>
+eT small_posterior(const eT* pi, const eT* C) {
+	eT Hyx(0), Hx(0), Hy(0);
+	for(uint x = 0; x < N; x++) {
+		eT h(0);
+		for(uint y = 0; y < M; y++)
+			h += entropy_term<eT, fast>(C[y*N + x]);
+		Hyx += pi[x] * h;
+		Hx += entropy_term<eT, fast>(pi[x]);
+	}
+	for(uint y = 0; y < M; y++) {
+		eT out(0);
+		for(uint x = 0; x < N; x++)
+			out += pi[x] * C[y*N + x];
+		Hy += entropy_term<eT, fast>(out);
+	}
+	return Hyx + Hx - Hy;
+}
+
+// calls f with std::true_type if fast_log2 is enabled (and eT is real)
+template<typename eT, typename F>
+auto dispatch(F f) {
+	if(!std::is_same<eT, rat>::value && fast_log2_flag())
+		return f(std::true_type());
+	else
+		return f(std::false_type());
+}
+
+} // namespace aux
+
+// Approximate log2 in the entropy computations of double/float (not rat) values, see aux::fast_log2. The error of
+// log2 is below 2e-9 (absolute), so the error of an entropy is below 2e-9 bits. Disabled by default, global.
+//
+inline void set_fast_log2(bool enabled)	{ aux::fast_log2_flag() = enabled; }
+inline bool get_fast_log2()				{ return aux::fast_log2_flag(); }
+
+// H(X) = - sum_x pi[x] log2(pi[x])
+//
+template<typename eT>
+eT prior(const Prob<eT>& pi) {
+	return aux::dispatch<eT>([&](auto fast) { return aux::entropy_sum<eT, decltype(fast)::value>(pi.memptr(), pi.n_elem); });
 }
 
 // computes H(X|Y)
@@ -25,11 +173,81 @@ template<typename eT>
 eT posterior(const Prob<eT>& pi, const Chan<eT>& C) {
 	channel::check_prior_size(pi, C);
 
+	eT res;
+	if(channel::aux::with_small_size(C.n_rows, C.n_cols, [&](auto N, auto M) {
+		res = aux::dispatch<eT>([&](auto fast) { return aux::small_posterior<decltype(N)::value, decltype(M)::value, eT, decltype(fast)::value>(pi.memptr(), C.memptr()); });
+	}))
+		return res;
+
+	eT Hyx = aux::dispatch<eT>([&](auto fast) { return aux::cond_entropy<eT, decltype(fast)::value>(pi, C); });
+	return Hyx + prior<eT>(pi) - prior<eT>(aux::outer(pi, C));
+}
+
+// sparse version, same formula computed in O(nnz)
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const SpChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
 	eT Hyx = 0;
-	for(uint x = 0; x < C.n_rows; x++)
-		Hyx += pi.at(x) * prior<eT>(C.row(x));
+	Prob<eT> out = arma::zeros<Prob<eT>>(C.n_cols);
+	for(auto it = C.begin(); it != C.end(); ++it) {
+		eT el = *it;
+		if(el > 0) {
+			Hyx -= pi.at(it.row()) * el * qif::log2(el);
+			out.at(it.col()) += pi.at(it.row()) * el;
+		}
+	}
+
+	return Hyx + prior<eT>(pi) - prior<eT>(out);
+}
+
+// memory-mapped version, same formula computed over blocks of rows (each row of C is a contiguous column of Bt)
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const channel::MappedChan<eT>& C) {
+	channel::check_prior_size(pi, C);
+
+	eT Hyx = 0;
+	Col<eT> out = arma::zeros<Col<eT>>(C.n_cols);
+	C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+		uint last = first + Bt.n_cols - 1;
+		for(uint k = 0; k < Bt.n_cols; k++)
+			Hyx += pi.at(first + k) * aux::dispatch<eT>([&](auto fast) { return aux::entropy_sum<eT, decltype(fast)::value>(Bt.colptr(k), Bt.n_rows); });
+		out += Bt * pi.cols(first, last).t();
+	});
+
+	return Hyx + prior<eT>(pi) - prior<eT>(Prob<eT>(out.t()));
+}
+
+// deterministic version in O(n): H(Y|X) = 0, so H(X|Y) = H(X) - H(Y) and the leakage is the entropy of the
+// block masses
+//
+template<typename eT>
+eT posterior(const Prob<eT>& pi, const channel::DetChan<eT>& C) {
+	channel::check_prior_size(pi, C);
 
-	return Hyx + prior<eT>(pi) - prior<eT>(pi * C);
+	Row<eT> out;
+	C.left(pi, out);
+	return prior<eT>(pi) - prior<eT>(Prob<eT>(out));
+}
+
+// Shared (pi, C), see channel::PosteriorContext. Same formula, H(Y) from the cached outer distribution.
+//
+template<typename eT>
+eT posterior(const channel::PosteriorContext<eT>& ctx) {
+	eT Hyx = aux::dispatch<eT>([&](auto fast) { return aux::cond_entropy<eT, decltype(fast)::value>(ctx.pi, ctx.C); });
+	return Hyx + prior<eT>(ctx.pi) - prior<eT>(ctx.outer());
+}
+
+template<typename eT>
+eT add_leakage(const channel::PosteriorContext<eT>& ctx) {
+	return prior(ctx.pi) - posterior(ctx);
+}
+
+template<typename eT>
+eT mult_leakage(const channel::PosteriorContext<eT>& ctx) {
+	return prior(ctx.pi) / posterior(ctx);
 }
 
 template<typename eT>
@@ -42,41 +260,213 @@ eT mult_leakage(const Prob<eT>& pi, const Chan<eT>& C) {
 	return prior(pi) / posterior(pi, C);
 }
 
-//Blahut-Arimoto Algorithm
+// State of add_capacity_bounds, for checkpointing (see checkpoint.h)
 //
 template<typename eT>
-std::pair<eT,Prob<eT>> add_capacity(const Chan<eT>& C, eT md = def_md<eT>, eT mrd = def_mrd<eT>) {
-	uint m = C.n_rows;
-	uint n = C.n_cols;
+struct CapacityState {
+	typedef eT elem_type;
 
-	Prob<eT> F(m), Py(m);
-	Prob<eT> Px = probab::uniform<eT>(m);
+	uint n_iter = 0;
+	Prob<eT> Px, P2, best_Px;			// next iterate, last plain iterate (with accelerate) and prior achieving best_IL
+	eT best_IL, best_IU, prev_IL;
+
+	Col<eT> pack() const {
+		return checkpoint::Writer<eT>().put(n_iter).put(Px).put(P2).put(best_Px).put(best_IL).put(best_IU).put(prev_IL).col();
+	}
+	static CapacityState unpack(const Mat<eT>& data) {
+		CapacityState s;
+		checkpoint::Reader<eT>(data).get(s.n_iter).get(s.Px).get(s.P2).get(s.best_Px).get(s.best_IL).get(s.best_IU).get(s.prev_IL);
+		return s;
+	}
+};
 
-	while(1) {
-		// Py = output dist
-		Py = Px * C;
+// Blahut-Arimoto Algorithm, returning IL <= capacity <= IU and the prior achieving IL.
+//
+// For any prior Px, with F_x = exp(D(C_x || Px C)), IL = I(Px) = Px.log2(F) <= capacity <= IU = log2(max F) (F_x is
+// infinite if C_x has mass on an output of probability 0 under Px, then IU is infinite). IL is the best I(Px) over
+// the iterates, so it is the leakage of the returned prior. Iterations
+// stop when IL, IU are equal (wrt md, mrd), or after max_iter iterations, or after max_time seconds. In the latter
+// cases [IL, IU] is still a certified interval for the capacity.
+//
+// Each iteration is a single matrix-vector product with C (the sum_y C_xy log C_xy part is precomputed), sparse if C
+// is sparse enough (on the GPU for large dense ones, see gpu.h). With accelerate, the iterations are extrapolated with SQUAREM (Varadhan and Roland, Simple and
+// globally convergent methods for accelerating the convergence of any EM algorithm, Scand J Stat 2008), which
+// usually reduces the number of iterations by an order of magnitude. The bounds are valid for any prior, so
+// extrapolated priors need no safeguard for correctness, only for progress (if IL decreases, we fall back to the
+// plain iterates).
+//
+// hook saves and restores the state of the iterations (see checkpoint.h), max_iter counts also the iterations done
+// before resuming.
+//
+template<typename eT>
+std::tuple<eT,eT,Prob<eT>> add_capacity_bounds(
+	const Chan<eT>& C,
+	eT md = def_md<eT>,
+	eT mrd = def_mrd<eT>,
+	uint max_iter = std::numeric_limits<uint>::max(),
+	double max_time = std::numeric_limits<double>::infinity(),
+	bool accelerate = true,
+	const checkpoint::Hook<CapacityState<eT>>& hook = {}
+) {
+	uint m = C.n_rows;
+	auto start = std::chrono::steady_clock::now();
 
-		// update F
+	// h_x = sum_y C_xy log C_xy, so that log F = h - C log(Py)   (NOTE: e-base log, not 2-base!)
+	Col<eT> h(m, arma::fill::zeros);
+	size_t nnz = 0;
+	for(uint j = 0; j < C.n_cols; j++) {
 		for(uint i = 0; i < m; i++) {
-			eT s = 0;
-			for(uint j = 0; j < n; j++) {
-				eT el = C.at(i, j);
-				s += el > 0 ? el * log(el / Py.at(j)) : 0;		// NOTE: this is e-base log, not 2-base!
+			eT el = C.at(i, j);
+			if(el > 0) {
+				h.at(i) += el * std::log(el);
+				nnz++;
 			}
-			F.at(i) = exp(s);
 		}
+	}
 
-		// check stop condition
-		eT d = dot(F, Px);
-		eT IL = qif::log2(d);
-		eT IU = qif::log2(max(F));
+	// sparse copy of C, if it pays off, otherwise a device copy for large channels (see gpu.h)
+	bool sparse = nnz < 0.1 * C.n_elem;
+	arma::SpMat<eT> C_sp;
+	std::optional<gpu::DeviceChan<eT>> C_dev;
+	if(sparse)
+		C_sp = arma::SpMat<eT>(C);
+	else if(gpu::use<eT>(4.0 * C.n_elem))
+		C_dev.emplace(C);
 
-		if(equal(IU, IL, md, mrd))
-			return { IL, Px };
+	// Px C and C v, the two products of each step
+	auto left = [&](const Prob<eT>& Px) -> Prob<eT> {
+		Prob<eT> res;
+		if(C_dev)
+			C_dev->left(Px, res);
+		else
+			res = sparse ? Prob<eT>(Px * C_sp) : Prob<eT>(Px * C);
+		return res;
+	};
+	auto right = [&](const Col<eT>& v) -> Col<eT> {
+		if(C_dev) {
+			Row<eT> res;
+			C_dev->right(v.t(), res);
+			return res.t();
+		}
+		return sparse ? Col<eT>(C_sp * v) : Col<eT>(C * v);
+	};
+
+	// bounds at Px, and the next iterate
+	auto step = [&](const Prob<eT>& Px, eT& il, eT& iu) -> Prob<eT> {
+		Prob<eT> Py = left(Px);
+
+		// Outputs with Py_y = 0 are 0 in all rows with Px_x > 0, their log is replaced by 0 so that those rows get
+		// their exact F. A row with Px_x = 0 reaching such an output has F_x = inf (so IU is infinite), its iterate
+		// stays 0 anyway.
+		Col<eT> log_Py = arma::log(Py.t());
+		arma::uvec zero = arma::find(Py.t() <= eT(0));
+		bool inf_row = false;
+		if(!zero.is_empty()) {
+			log_Py.elem(zero).zeros();
+			Col<eT> ind(Py.n_elem, arma::fill::zeros);
+			ind.elem(zero).ones();
+			inf_row = right(ind).max() > eT(0);
+		}
+
+		Col<eT> log_F = h - right(log_Py);
+		Prob<eT> F = arma::exp(log_F.t());
+		eT d = arma::dot(F, Px);
+		il = eT(arma::dot(Px, log_F) / std::log(eT(2)));
+		iu = inf_row ? infinity<eT>() : eT(qif::log2(F.max()));
+		return Px % F / d;		// % is element-wise mult
+	};
+
+	Prob<eT> Px = probab::uniform<eT>(m);
+	Prob<eT> best_Px = Px;
+	eT best_IL = -infinity<eT>(), best_IU = infinity<eT>();
+	eT prev_IL = -infinity<eT>();
+	Prob<eT> P1, P2;
+	uint n_iter = 0;
+
+	if(hook.resume) {
+		const CapacityState<eT>& s = *hook.resume;
+		if(s.Px.n_elem != m)
+			throw std::runtime_error("add_capacity_bounds: checkpoint of a different channel");
+		n_iter = s.n_iter;
+		Px = s.Px;
+		P2 = s.P2;
+		best_Px = s.best_Px;
+		best_IL = s.best_IL;
+		best_IU = s.best_IU;
+		prev_IL = s.prev_IL;
+	}
+	uint last_save = n_iter;
+	auto save = [&]() {
+		if(hook.due(n_iter, last_save))
+			hook.save({ n_iter, Px, P2, best_Px, best_IL, best_IU, prev_IL });
+	};
+
+	// evaluates the bounds at Px, returns true if we should stop
+	eT IL, IU;
+	auto eval = [&](const Prob<eT>& Px, Prob<eT>& next) -> bool {
+		next = step(Px, IL, IU);
+		n_iter++;
+
+		if(IL > best_IL) {
+			best_IL = IL;
+			best_Px = Px;
+		}
+		best_IU = std::min(best_IU, IU);
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return equal(best_IU, best_IL, md, mrd) || n_iter >= max_iter || elapsed >= max_time;
+	};
+
+	if(!accelerate) {
+		while(!eval(Px, P1)) {
+			Px = P1;
+			save();
+		}
+		return { best_IL, best_IU, best_Px };
+	}
+
+	while(true) {
+		save();
+		if(eval(Px, P1)) break;
+
+		// safeguard: if the extrapolated prior is worse than the previous plain iterate, restart from P2
+		if(IL < prev_IL) {
+			Px = P2;
+			if(eval(Px, P1)) break;
+		}
+
+		if(eval(P1, P2)) break;
+		prev_IL = best_IL;
+
+		// SQUAREM (SqS3 step length)
+		Prob<eT> r = P1 - Px,
+				 v = P2 - 2 * P1 + Px;
+		eT norm_v = arma::norm(v);
+		if(norm_v == eT(0)) {
+			Px = P2;
+			continue;
+		}
+		eT alpha = std::min(-arma::norm(r) / norm_v, eT(-1));
+		Prob<eT> P = Px - 2 * alpha * r + alpha * alpha * v;
+
+		// stay in the interior of the simplex (BA never recovers from Px_x = 0)
+		arma::uvec neg = arma::find(P <= eT(0));
+		P.elem(neg) = P2.elem(neg) / 2;
+		P /= arma::accu(P);
 
-		// update Px
-		Px %= F / d;		// % is element-wise mult
+		Px = P.is_finite() ? P : P2;
 	}
+
+	return { best_IL, best_IU, best_Px };
+}
+
+// capacity (up to md, mrd) and the prior achieving it
+//
+template<typename eT>
+std::pair<eT,Prob<eT>> add_capacity(const Chan<eT>& C, eT md = def_md<eT>, eT mrd = def_mrd<eT>, const checkpoint::Hook<CapacityState<eT>>& hook = {}) {
+	auto [IL, IU, Px] = add_capacity_bounds(C, md, mrd, std::numeric_limits<uint>::max(), std::numeric_limits<double>::infinity(), true, hook);
+	(void)IU;
+	return { IL, Px };
 }
 
 } // measure::shannon
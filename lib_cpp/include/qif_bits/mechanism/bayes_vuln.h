@@ -21,6 +21,19 @@ Chan<eT> min_loss_given_max_vuln(
 	return g_vuln::min_loss_given_max_vuln(pi, n_cols, pi.n_elem, max_vuln, g_id<eT>, loss, hard_max_loss);
 }
 
+// Sweep version, one mechanism for each max_vulns(i), see g_vuln::min_loss_given_max_vuln
+//
+template<typename eT>
+std::vector<Chan<eT>> min_loss_given_max_vuln(
+	const Prob<eT>& pi,
+	uint n_cols,
+	const Col<eT>& max_vulns,
+	Metric<eT, uint> loss,
+	eT hard_max_loss = infinity<eT>()	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+) {
+	return g_vuln::min_loss_given_max_vuln(pi, n_cols, pi.n_elem, max_vulns, g_id<eT>, loss, hard_max_loss);
+}
+
 // Returns the mechanism having the smallest Bayes vulnerabiliy given the E[loss] <= max_loss constraint.
 // Same as mechanism::g_vuln::min_vuln_given_max_loss for the identity gain function, but faster to construct the LP.
 //
@@ -37,13 +50,38 @@ Chan<eT> min_vuln_given_max_loss(
 	return g_vuln::min_vuln_given_max_loss(pi, n_cols, pi.n_elem, max_loss, g_id<eT>, loss, hard_max_loss);
 }
 
-// Returns the row that, when added to C (to obtain C'), it minimizes the
-// posterior vulnerability of C'. p is the prior probability of the new row.
-// pi are the probabilities of C's rows (should sum up to 1-p, not 1!)
+// Sweep version, one mechanism for each max_losses(i), see g_vuln::min_vuln_given_max_loss
 //
-template<typename eT = eT_def>
-inline
-Prob<eT> min_vuln_for_row(const Prob<eT>& pi, eT p, const Chan<eT>& C) {
+template<typename eT>
+std::vector<Chan<eT>> min_vuln_given_max_loss(
+	const Prob<eT>& pi,
+	uint n_cols,
+	const Col<eT>& max_losses,
+	Metric<eT, uint> loss,
+	eT hard_max_loss = infinity<eT>()	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+) {
+	return g_vuln::min_vuln_given_max_loss(pi, n_cols, pi.n_elem, max_losses, g_id<eT>, loss, hard_max_loss);
+}
+
+// The (V, E[loss]) frontier, see g_vuln::frontier
+//
+template<typename eT>
+g_vuln::Frontier<eT> frontier(
+	const Prob<eT>& pi,
+	uint n_cols,
+	Metric<eT, uint> loss,
+	eT hard_max_loss = infinity<eT>()	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+) {
+	return g_vuln::frontier(pi, n_cols, pi.n_elem, g_id<eT>, loss, hard_max_loss);
+}
+
+namespace aux {
+
+// min_vuln_for_row as a linear program, 2N variables (the row q and z_y = max_x pi[x] C'[x,y]). Used when the
+// water-filling of min_vuln_for_row does not apply (p < 0).
+//
+template<typename eT>
+Prob<eT> min_vuln_for_row_lp(const Prob<eT>& pi, eT p, const Chan<eT>& C) {
 	uint N = C.n_cols;
 	eT inf = infinity<eT>();
 
@@ -83,8 +121,8 @@ Prob<eT> min_vuln_for_row(const Prob<eT>& pi, eT p, const Chan<eT>& C) {
 
 	// solve program
 	//
-	if(!lp.solve())
-		throw std::runtime_error("min_vuln_for_row: lp should be always solvable");
+	if(!lp.solve() && !lp.has_solution())		// feasible but not optimal if interrupted
+		throw std::runtime_error(lp.status == lp::Status::INTERRUPTED ? "min_vuln_for_row: interrupted" : "min_vuln_for_row: lp should be always solvable");
 
 	// reconstruct q from solution
 	//
@@ -95,5 +133,48 @@ Prob<eT> min_vuln_for_row(const Prob<eT>& pi, eT p, const Chan<eT>& C) {
 	return row;
 }
 
+} // namespace aux
+
+// Returns the row that, when added to C (to obtain C'), it minimizes the
+// posterior vulnerability of C'. p is the prior probability of the new row.
+// pi are the probabilities of C's rows (should sum up to 1-p, not 1!)
+//
+// With m_y = max_x pi[x] C[x,y] the problem is  min sum_y max(m_y, p row[y])  s.t. row sums to 1. Output y takes
+// up to m_y / p of the row for free, and any mass above that costs p per unit wherever it goes. So we fill the outputs
+// in decreasing order of m_y (fewest non-zeros), and put what is left over on the first one. O(N log N), exact for
+// rats. The LP (aux::min_vuln_for_row_lp) is only used for p < 0 or a C without columns.
+//
+template<typename eT = eT_def>
+inline
+Prob<eT> min_vuln_for_row(const Prob<eT>& pi, eT p, const Chan<eT>& C) {
+	uint N = C.n_cols;
+	if(N == 0 || p < eT(0))
+		return aux::min_vuln_for_row_lp(pi, p, C);
+
+	arma::Row<eT> maxes = C.n_rows > 0 ? arma::Row<eT>(arma::max(C.each_col() % pi.t(), 0)) : arma::zeros<arma::Row<eT>>(N);
+
+	std::vector<uint> order(N);
+	for(uint y = 0; y < N; y++)
+		order[y] = y;
+	std::stable_sort(order.begin(), order.end(), [&](uint a, uint b) { return maxes(b) < maxes(a); });
+
+	Prob<eT> row(N, arma::fill::zeros);
+	if(p == eT(0)) {
+		row(order[0]) = eT(1);		// no cost at all
+		return row;
+	}
+	eT left(1);
+	for(uint y : order) {
+		eT cap = maxes(y) / p;
+		if(!(eT(0) < cap) || left == eT(0))
+			break;
+		row(y) = cap < left ? cap : left;
+		left -= row(y);
+	}
+	row(order[0]) += left;
+
+	return row;
+}
+
 
 } // namespace mechanism::bayes_vuln
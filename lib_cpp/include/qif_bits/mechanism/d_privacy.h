@@ -75,6 +75,7 @@ geometric(uint n_rows, eT epsilon = eT(1), uint n_cols = 0, int first_x = 0, int
 template<typename eT>
 Chan<eT>
 exponential(uint n_rows, Metric<eT, uint> d, uint n_cols = 0) {
+	QIF_TRACE_SPAN("d_privacy::exponential");
 	if(n_cols == 0) n_cols = n_rows;
 
 	Chan<eT> C = distance_matrix(n_rows, n_cols, eT(1)/2 * d);
@@ -83,6 +84,29 @@ exponential(uint n_rows, Metric<eT, uint> d, uint n_cols = 0) {
 	return C;
 }
 
+// exponential mechanism for a precomputed distance matrix D (eg. eps * to_distance_matrix of metric::graph), without
+// calling a metric per entry: C(x,y) proportional to exp(-D(x,y)/2)
+//
+template<typename eT>
+Chan<eT>
+exponential(const Mat<eT>& D) {
+	QIF_TRACE_SPAN("d_privacy::exponential");
+	Chan<eT> C(D.n_rows, D.n_cols);
+	for(uint i = 0; i < D.n_elem; i++) {
+		eT expon = -D(i) / eT(2);
+		C(i) = qif::exp(expon);
+	}
+	channel::normalize(C);
+
+	return C;
+}
+
+template<typename eT>
+Chan<eT>
+exponential(uint n_rows, const metric::CachedMetric<eT>& d, uint n_cols = 0) {
+	return exponential(metric::to_distance_matrix(d, n_rows, n_cols));
+}
+
 template<typename eT>
 Chan<eT>
 randomized_response(uint n_rows, eT epsilon = 1.0, uint n_cols = 0) {
@@ -98,6 +122,196 @@ randomized_response(uint n_rows, eT epsilon = 1.0, uint n_cols = 0) {
 	return C;
 }
 
+// Structured versions of the square mechanisms (see channel/structured.h), stored in O(n) memory, with O(n)
+// products, bayes_vuln, posterior for a single output and O(1) sampling per pair. materialize() gives the same
+// matrix as the dense constructor.
+
+// randomized_response(n, epsilon): C(x,x) = 1/z, C(x,y) = e/z otherwise, with e = exp(-epsilon), z = 1 + (n-1)e
+//
+template<typename eT>
+channel::RRChan<eT>
+randomized_response_chan(uint n, eT epsilon = 1.0) {
+	eT mexp = -epsilon,
+	   e = qif::exp(mexp),
+	   z = eT(1) + eT(n-1) * e;
+	return { n, eT(1) / z, e / z };
+}
+
+// geometric(n, epsilon) (square, no offsets): C(x,y) = l_y r^|x-y| with r = exp(-epsilon)
+//
+template<typename eT>
+channel::GeometricChan<eT>
+geometric_chan(uint n, eT epsilon = eT(1)) {
+	eT mexp = -epsilon,
+	   r = qif::exp(mexp),
+	   c = qif::exp(epsilon),
+	   lambda_f = c / (c + eT(1)),
+	   lambda_m = (c - eT(1)) / (c + eT(1));
+	return { n, r, lambda_f, lambda_m, lambda_f, false };
+}
+
+// exponential(n, d) for the line metric d(x,y) = epsilon |x-y|: C(x,y) = a_x r^|x-y| with r = exp(-epsilon/2)
+//
+template<typename eT>
+channel::GeometricChan<eT>
+exponential_chan(uint n, eT epsilon = eT(1)) {
+	eT mexp = -epsilon / eT(2),
+	   r = qif::exp(mexp);
+	return { n, r, eT(1), eT(1), eT(1), true };
+}
+
+// randomized_response(n, epsilon) as an OperatorChan (eg for iterative_bayesian_update), never stored
+//
+template<typename eT>
+channel::OperatorChan<eT>
+randomized_response_operator(uint n, eT epsilon = 1.0) {
+	return randomized_response_chan(n, epsilon).op();
+}
+
+// geometric(n, epsilon) (square, no offsets) as an OperatorChan, products cost O(n)
+//
+template<typename eT>
+channel::OperatorChan<eT>
+geometric_operator(uint n, eT epsilon = eT(1)) {
+	return geometric_chan(n, epsilon).op();
+}
+
+// Samples outputs of exponential(n_rows, d, n_cols) one input at a time, without building the channel (eg for
+// sanitizing a stream of values over a large domain). Depending on the structure of d:
+//  - any metric: Gumbel-max over the outputs, y = argmax_y -d(x,y)/2 + Gumbel noise, in O(n_cols) time and O(1)
+//    memory per query. After cache_normalizers() (O(n_rows n_cols) once, O(n_rows) memory) a single uniform draw is
+//    inverted instead, which avoids n_cols logarithms per query.
+//  - grid metric: the offset (dx, dy) is drawn from an alias table over all (2 width - 1) x (2 height - 1) offsets,
+//    rejecting those that leave the grid. Expected O(1) per query (at least a quarter of the mass lies inside the
+//    grid for a kernel decreasing in |dx|, |dy|), the table is shared by all queries.
+//  - line(n, epsilon) / discrete(n, epsilon): the metrics epsilon |x-y| and epsilon [x != y], sampled in O(1) by
+//    channel::GeometricChan / channel::RRChan.
+// Draws are computed in double.
+//
+template<typename eT>
+class ExponentialSampler {
+	public:
+		uint n_rows, n_cols;
+
+		ExponentialSampler(uint n_rows, Metric<eT, uint> d, uint n_cols = 0)
+			: n_rows(n_rows), n_cols(n_cols == 0 ? n_rows : n_cols), kind(Kind::generic), d(d) {}
+
+		explicit ExponentialSampler(const metric::GridMetric<eT>& g)
+			: n_rows(g.n_cells()), n_cols(g.n_cells()), kind(Kind::grid), width(g.width), height(g.height) {
+			uint w2 = 2 * width - 1, h2 = 2 * height - 1;
+			arma::rowvec weight(w2 * h2);
+			for(uint j = 0; j < h2; j++)
+				for(uint i = 0; i < w2; i++)
+					weight(i + j * w2) = std::exp(-to_double(g.kernel(int(i) - int(width - 1), int(j) - int(height - 1))) / 2);
+			offsets = probab::AliasSampler(weight);
+		}
+
+		static ExponentialSampler line(uint n, eT epsilon) {
+			ExponentialSampler s(n, Kind::line);
+			s.geom = std::make_shared<const channel::GeometricChan<eT>>(exponential_chan(n, epsilon));
+			return s;
+		}
+
+		// exponential for epsilon [x != y] is randomized_response with epsilon/2
+		static ExponentialSampler discrete(uint n, eT epsilon) {
+			ExponentialSampler s(n, Kind::discrete);
+			s.rr = std::make_shared<const channel::RRChan<eT>>(randomized_response_chan(n, epsilon / eT(2)));
+			return s;
+		}
+
+		// computes the normalizer Z_x = sum_y exp(-d(x,y)/2) of every input (generic metrics only, no-op otherwise)
+		void cache_normalizers() {
+			if(kind != Kind::generic)
+				return;
+			norm.set_size(n_rows);
+			parallel::for_each(n_rows, [&](uint x) {
+				double z = 0;
+				for(uint y = 0; y < n_cols; y++)
+					z += weight(x, y);
+				norm(x) = z;
+			});
+		}
+
+		template<typename G>
+		uint operator()(uint x, G& gen) const {
+			if(x >= n_rows) throw std::runtime_error("input out of range");
+
+			switch(kind) {
+				case Kind::line:     return geom->sample_output(x, gen);
+				case Kind::discrete: return rr->sample_output(x, gen);
+				case Kind::grid:     return sample_grid(x, gen);
+				default:             return norm.is_empty() ? sample_gumbel(x, gen) : sample_inverse(x, gen);
+			}
+		}
+
+		uint operator()(uint x) const {
+			return (*this)(x, rng::aux::thread_engine());
+		}
+
+		// one output for each input in xs, generated in parallel from independent streams of seed
+		Row<uint> sample(const Row<uint>& xs, uint64_t seed = rng::random_seed()) const {
+			Row<uint> res(xs.n_elem);
+			rng::parallel_streams(xs.n_elem, seed, [&](rng::Engine& gen, size_t begin, size_t end) {
+				for(size_t k = begin; k < end; k++)
+					res(k) = (*this)(xs(k), gen);
+			});
+			return res;
+		}
+
+	private:
+		enum class Kind { generic, grid, line, discrete };
+
+		Kind kind;
+		Metric<eT, uint> d;
+		arma::rowvec norm;											// cached Z_x (generic)
+		uint width = 0, height = 0;
+		probab::AliasSampler offsets;								// grid
+		std::shared_ptr<const channel::GeometricChan<eT>> geom;		// line
+		std::shared_ptr<const channel::RRChan<eT>> rr;				// discrete
+
+		ExponentialSampler(uint n, Kind kind) : n_rows(n), n_cols(n), kind(kind) {}
+
+		double weight(uint x, uint y) const {
+			return std::exp(-to_double(d(x, y)) / 2);
+		}
+
+		template<typename G>
+		uint sample_gumbel(uint x, G& gen) const {
+			uint best = 0;
+			double best_val = -std::numeric_limits<double>::infinity();
+			for(uint y = 0; y < n_cols; y++) {
+				double u = rng::randu<double>(gen);
+				double val = -to_double(d(x, y)) / 2 - std::log(-std::log(u));
+				if(val > best_val) {
+					best_val = val;
+					best = y;
+				}
+			}
+			return best;
+		}
+
+		template<typename G>
+		uint sample_inverse(uint x, G& gen) const {
+			double t = rng::randu<double>(gen) * norm(x);
+			for(uint y = 0; y < n_cols; y++)
+				if((t -= weight(x, y)) < 0)
+					return y;
+			return n_cols - 1;										// rounding
+		}
+
+		template<typename G>
+		uint sample_grid(uint x, G& gen) const {
+			int cx = x % width, cy = x / width, w2 = 2 * width - 1;
+			while(true) {
+				int o = offsets(gen),
+					yx = cx - (o % w2 - int(width - 1)),			// d(x, y) = kernel(x - y)
+					yy = cy - (o / w2 - int(height - 1));
+				if(yx >= 0 && yx < int(width) && yy >= 0 && yy < int(height))
+					return yx + yy * width;
+			}
+		}
+};
+
 template<typename eT>
 Chan<eT>
 tight_constraints(uint n, Metric<eT, uint> d) {
@@ -195,69 +409,253 @@ exact_distance(uint n, Metric<eT, uint> d) {
 namespace aux {
 	// auxiliary functions used by min_loss_given_d, hidden from the outside
 
-	template<typename eT>
-	Chan<eT> min_loss_given_d_all(
+	// The program of min_loss_given_d_all for the given constrained pairs (x,x',coeff), over the orbits of G
+	//
+	template<typename eT, typename L>
+	Chan<eT> min_loss_given_d_lp(
 		const Prob<eT>& pi,
-		uint n_cols,
-		Metric<eT, uint> d_priv,
-		Metric<eT, uint> loss,
-		Chainable<uint> d_priv_ch = metric::never_chainable<uint>,	// which inputs are chainable
-		eT inf = eT(std::log(1e200))	// ignore large distances to avoid numerical instability. infinity<eT>() could be used to disable
+		uint N,
+		const L& loss,
+		const std::vector<std::tuple<uint, uint, eT>>& pairs,
+		const symmetry::Group& G
 	) {
-		uint M = pi.n_cols,
-			N = n_cols;
+		uint M = pi.n_cols;
 
-		// C: M x N   unknowns
-		// We have M x N variables
+		// C: M x N   unknowns, one variable per orbit of (x,y) (M x N variables without symmetries)
 		lp::LinearProgram<eT> lp;
-		auto vars = lp.make_vars(M, N, 0, 1);
+		auto [orbit, n_orbits] = G.pair_orbits(M, N);
+		auto var = [&, &orbit = orbit](uint x, uint y) { return orbit[size_t(x) * N + y]; };
+		lp.make_vars(n_orbits, 0, 1);
 
 		// cost function: minimize sum_xy pi_x C_xy loss(x,y)
 		lp.maximize = false;
 		for(uint x = 0; x < M; x++)
 			for(uint y = 0; y < N; y++)
-				lp.set_obj_coeff(vars[x][y], pi(x) * loss(x, y));
-
-		// Build equations for C_xy <= exp(eps d_priv(x,x')) C_x'y
-		//
-		for(uint x1 = 0; x1 < M; x1++) {
-		for(uint x2 = 0; x2 < M; x2++) {
-			if(x1 == x2 || d_priv_ch(x1, x2)) continue;			// constraints for chainable inputs are redundant
-			if(!less_than(d_priv(x1, x2), inf)) continue;		// inf distance, i.e. no constraint
-
-			for(uint y = 0; y < N; y++) {
-				auto con = lp.make_con(-infinity<eT>(), 0);
-
-				lp.set_con_coeff(con, vars[x1][y], 1);
-				lp.set_con_coeff(con, vars[x2][y], - std::exp(d_priv(x1, x2)));
+				lp.set_obj_coeff(var(x, y), pi(x) * loss(x, y), true);
+
+		// The constraints themselves are generated in parallel, each block handles a range of pairs. Stop before
+		// generating them if the program would exceed the memory limit (see lp::SolveOptions).
+		size_t n_pairs = pairs.size();
+		uint n_blocks = std::min<size_t>(n_pairs, 4 * parallel::n_threads());
+		lp.check_memory(n_orbits, n_pairs * N + M, 2 * n_pairs * N + uint64_t(M) * N);
+
+		lp.make_cons_parallel(n_blocks, [&](uint b, auto& block) {
+			size_t first = b * n_pairs / n_blocks,
+				   last = (b + 1) * n_pairs / n_blocks;
+			block.reserve_con_coeffs(2 * (last - first) * N);
+
+			for(size_t i = first; i < last; i++) {
+				auto& [x1, x2, coeff] = pairs[i];
+				for(uint y = 0; y < N; y++) {
+					if(!G.is_rep(x1, x2, y))			// same constraint as a previous y (symmetries fixing x1, x2)
+						continue;
+					auto con = block.make_con(-infinity<eT>(), 0);
+
+					block.set_con_coeff(con, var(x1, y), 1, true);		// added: both can be the same orbit
+					block.set_con_coeff(con, var(x2, y), coeff, true);
+				}
 			}
-		}}
+		});
 
-		// equalities for summing up to 1
+		// equalities for summing up to 1, one per orbit of inputs
 		//
 		for(uint x = 0; x < M; x++) {
+			if(!G.is_rep(x))
+				continue;
 			auto con = lp.make_con(1, 1);
 
 			// coeff 1 for variable C[x,y]
 			for(uint y = 0; y < N; y++)
-				lp.set_con_coeff(con, vars[x][y], 1);
+				lp.set_con_coeff(con, var(x, y), 1, true);
 		}
 
-		// solve program
+		// solve program (an interrupted solve might still give a feasible mechanism, see lp::SolveOptions)
 		//
-		if(!lp.solve())
+		if(!lp.solve() && !lp.has_solution())
 			return Chan<eT>();
 
-		// reconstrict channel from solution
+		// reconstrict channel from solution, expanding the orbits
 		//
 		Chan<eT> C(M, N);
 		for(uint x = 0; x < M; x++)
 			for(uint y = 0; y < N; y++)
-				C(x, y) = lp.solution(vars[x][y]);
+				C(x, y) = lp.solution(var(x, y));
 
 		return C;
 	}
 
+	// The connected components of the graph on M inputs with the given pairs as edges (union-find), as the component
+	// (0, 1, ...) of each input, numbered in the order of their smallest input, and the number of components.
+	//
+	template<typename eT>
+	std::pair<std::vector<uint>, uint> components(uint M, const std::vector<std::tuple<uint, uint, eT>>& pairs) {
+		std::vector<uint> parent(M);
+		for(uint x = 0; x < M; x++)
+			parent[x] = x;
+
+		auto find = [&](uint x) {
+			while(parent[x] != x)
+				x = parent[x] = parent[parent[x]];		// path halving
+			return x;
+		};
+		for(auto& p : pairs) {
+			uint r1 = find(std::get<0>(p)), r2 = find(std::get<1>(p));
+			if(r1 != r2)
+				parent[std::max(r1, r2)] = std::min(r1, r2);
+		}
+
+		// the root of each component is its smallest input, so it is found before the other inputs
+		std::vector<uint> comp(M);
+		uint n_comps = 0;
+		for(uint x = 0; x < M; x++) {
+			uint r = find(x);
+			comp[x] = r == x ? n_comps++ : comp[r];
+		}
+		return { comp, n_comps };
+	}
+
+	// min_loss_given_d_all with the inputs split into components without constraints between them, one program per
+	// component (its rows of C, all N columns) solved in parallel. The loss is evaluated beforehand, in the calling
+	// thread, since it might not be safe to call concurrently (eg. a python function). The workers get the solve
+	// options of the calling thread (see lp::thread_options). Returns an empty channel if any component fails.
+	//
+	template<typename eT, typename L>
+	Chan<eT> min_loss_given_d_components(
+		const Prob<eT>& pi,
+		uint N,
+		const L& loss,
+		const std::vector<std::tuple<uint, uint, eT>>& pairs,
+		const std::vector<uint>& comp,
+		uint n_comps
+	) {
+		uint M = pi.n_cols;
+
+		// the inputs of each component, and the index of each input in its component
+		std::vector<std::vector<uint>> rows(n_comps);
+		std::vector<uint> local(M);
+		for(uint x = 0; x < M; x++) {
+			local[x] = rows[comp[x]].size();
+			rows[comp[x]].push_back(x);
+		}
+
+		// the pairs, in local indexes (both inputs of a pair are in the same component)
+		std::vector<std::vector<std::tuple<uint, uint, eT>>> comp_pairs(n_comps);
+		for(auto& [x1, x2, coeff] : pairs)
+			comp_pairs[comp[x1]].emplace_back(local[x1], local[x2], coeff);
+
+		// the loss of the rows of each component
+		std::vector<Mat<eT>> losses(n_comps);
+		for(uint k = 0; k < n_comps; k++) {
+			losses[k].set_size(rows[k].size(), N);
+			for(uint i = 0; i < rows[k].size(); i++)
+				for(uint y = 0; y < N; y++)
+					losses[k](i, y) = loss(rows[k][i], y);
+		}
+
+		const lp::SolveOptions options = lp::thread_options();
+		std::vector<Chan<eT>> sub(n_comps);
+
+		parallel::for_each(n_comps, [&](uint k) {
+			lp::ScopedOptions scope(options);
+
+			Prob<eT> sub_pi(rows[k].size());
+			for(uint i = 0; i < rows[k].size(); i++)
+				sub_pi(i) = pi(rows[k][i]);			// not normalized, the objective is the sum over all components
+
+			const Mat<eT>& Lk = losses[k];
+			sub[k] = min_loss_given_d_lp<eT>(sub_pi, N, [&](uint i, uint y) { return Lk(i, y); }, comp_pairs[k], symmetry::Group());
+		});
+
+		// stitch the rows of the components together
+		Chan<eT> C(M, N);
+		for(uint k = 0; k < n_comps; k++) {
+			if(sub[k].is_empty())
+				return Chan<eT>();
+			for(uint i = 0; i < rows[k].size(); i++)
+				C.row(rows[k][i]) = sub[k].row(i);
+		}
+		return C;
+	}
+
+	// d_priv, loss can be Metric<eT,uint> or any metric callables (eg. metric::expr expressions, which are inlined)
+	//
+	// With symmetries (and a square channel), the permutations leaving pi, loss, d_priv and d_priv_ch invariant are
+	// detected and the program is built over the orbits of the pairs (x,y), see symmetry.h. The invariance of d_priv
+	// is checked on the pairs that get a constraint (for metrics with neighbours, these are assumed to be all pairs
+	// of finite distance).
+	//
+	template<typename eT, typename DP = Metric<eT, uint>, typename L = Metric<eT, uint>>
+	Chan<eT> min_loss_given_d_all(
+		const Prob<eT>& pi,
+		uint n_cols,
+		const DP& d_priv,
+		const L& loss,
+		Chainable<uint> d_priv_ch = metric::never_chainable<uint>,	// which inputs are chainable
+		eT inf = eT(std::log(1e200)),	// ignore large distances to avoid numerical instability. infinity<eT>() could be used to disable
+		const std::vector<std::vector<uint>>& symmetries = {}		// candidate symmetries of the inputs, see symmetry.h
+	) {
+		uint M = pi.n_cols,
+			N = n_cols;
+
+		symmetry::Group G;
+		if(!symmetries.empty() && N == M) {
+			G = symmetry::Group(M, symmetries);
+			G.restrict_invariant(pi, loss);
+		}
+
+		// Build equations for C_xy <= exp(eps d_priv(x,x')) C_x'y
+		// First collect the pairs (x,x') that need constraints, with their coefficient
+		//
+		std::vector<std::tuple<uint, uint, eT>> pairs;
+		auto add_pair = [&](uint x1, uint x2) {
+			if(x1 == x2 || d_priv_ch(x1, x2)) return;			// constraints for chainable inputs are redundant
+
+			eT dist = d_priv(x1, x2);
+			if(!less_than(dist, inf)) return;					// inf distance, i.e. no constraint
+
+			eT coeff = - std::exp(dist);
+			pairs.emplace_back(x1, x2, coeff);
+		};
+
+		for(uint x1 = 0; x1 < M; x1++) {
+			if constexpr (metric::expr::has_neighbours<DP>::value) {
+				// the metric knows its non-chainable pairs, so O(M k) instead of O(M^2) constraints
+				for(uint x2 : d_priv.neighbours(x1))
+					if(x2 < M)
+						add_pair(x1, x2);
+			} else {
+				for(uint x2 = 0; x2 < M; x2++)
+					add_pair(x1, x2);
+			}
+		}
+
+		// keep the symmetries mapping constrained pairs to constrained pairs with the same coefficient, then a single
+		// pair of each orbit (the constraints of the others are the same in the orbit variables)
+		if(!G.trivial()) {
+			G.restrict([&](const std::vector<uint>& s) {
+				for(auto& [x1, x2, coeff] : pairs)
+					if(d_priv_ch(s[x1], s[x2]) || !equal<eT>(coeff, - std::exp(d_priv(s[x1], s[x2]))))
+						return false;
+				return true;
+			});
+			pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [&](auto& p) { return !G.is_rep(std::get<0>(p), std::get<1>(p)); }), pairs.end());
+		}
+
+		// Without constraints between them, groups of inputs (the connected components of the constrained pairs, eg.
+		// separate districts, or a metric thresholded with metric::threshold_inf) give independent programs: the rows
+		// of C in a component only appear in its own constraints, and the objective is a sum over the rows. The
+		// components are then solved separately, in parallel, instead of a single block-diagonal program. With
+		// symmetries the whole program is kept, since the group can map components to each other.
+		//
+		if(G.trivial()) {
+			auto [comp, n_comps] = components(M, pairs);
+			if(n_comps > 1)
+				return min_loss_given_d_components<eT>(pi, N, loss, pairs, comp, n_comps);
+		}
+
+		return min_loss_given_d_lp<eT>(pi, N, loss, pairs, G);
+	}
+
 	// Distance-besed variables, one for every pair (d,y)
 	//
 	template<typename eT>
@@ -326,9 +724,9 @@ namespace aux {
 				lp.set_con_coeff(con, vars[DI(x,y)][y], 1, true);
 		}
 
-		// solve program
+		// solve program (an interrupted solve might still give a feasible mechanism, see lp::SolveOptions)
 		//
-		if(!lp.solve())
+		if(!lp.solve() && !lp.has_solution())
 			return Chan<eT>();
 
 		// reconstrict channel from solution
@@ -407,9 +805,9 @@ namespace aux {
 				lp.set_con_coeff(con, vars[DI(x,y)], 1, true);
 		}
 
-		// solve program
+		// solve program (an interrupted solve might still give a feasible mechanism, see lp::SolveOptions)
 		//
-		if(!lp.solve())
+		if(!lp.solve() && !lp.has_solution())
 			return Chan<eT>();
 
 		// reconstrict channel from solution
@@ -424,24 +822,31 @@ namespace aux {
 
 } // aux
 
-// Returns the mechanism having the min expected loss (utility) wrt pi and loss, given the d_priv constraint
+// Returns the mechanism having the min expected loss (utility) wrt pi and loss, given the d_priv constraint.
+// d_priv, loss can also be metric::expr expressions (or any metric callables), inlined when vars == "all"
 //
-template<typename eT>
+// symmetries: candidate permutations of the inputs (eg. symmetry::grid(width, height) for inputs on a grid, with a
+// grid metric), the ones leaving the program invariant are used to reduce it (vars == "all" and n_cols == M
+// only), see symmetry.h. The result is an optimal mechanism that is itself invariant.
+//
+template<typename eT, typename DP = Metric<eT, uint>, typename L = Metric<eT, uint>>
 Chan<eT> min_loss_given_d(
 	const Prob<eT>& pi,
 	uint n_cols,
-	Metric<eT, uint> d_priv,
-	Metric<eT, uint> loss,
+	const DP& d_priv,
+	const L& loss,
 	std::string vars = "all",		// Which probabilities are variables: all | dist | dist_strict
 	Chainable<uint> d_priv_ch = metric::never_chainable<uint>,	// which inputs are chainable
-	eT inf = eT(std::log(1e200))	// ignore large distances to avoid numerical instability. infinity<eT>() could be used to disable
+	eT inf = eT(std::log(1e200)),	// ignore large distances to avoid numerical instability. infinity<eT>() could be used to disable
+	const std::vector<std::vector<uint>>& symmetries = {}
 ) {
+	QIF_TRACE_SPAN("d_privacy::min_loss_given_d");
 	if(vars == "all")
-		return aux::min_loss_given_d_all        (pi, n_cols, d_priv, loss, d_priv_ch, inf);
+		return aux::min_loss_given_d_all<eT>       (pi, n_cols, d_priv, loss, d_priv_ch, inf, symmetries);
 	else if(vars == "dist")
-		return aux::min_loss_given_d_dist       (pi, n_cols, d_priv, loss);
+		return aux::min_loss_given_d_dist<eT>      (pi, n_cols, d_priv, loss);
 	else if(vars == "dist_strict")
-		return aux::min_loss_given_d_dist_strict(pi, n_cols, d_priv, loss);
+		return aux::min_loss_given_d_dist_strict<eT>(pi, n_cols, d_priv, loss);
 	else
 		throw std::runtime_error("invalid vars: " + vars);
 }
@@ -3,17 +3,166 @@
 
 namespace mechanism::g_vuln {
 
-// Returns the mechanism having the smallest E[loss] given the Vg(pi,C) <= max_vuln constraint
+namespace aux {
+
+	// piG(w,x) = pi_x g(w,x), the gain is evaluated once here
+	//
+	template<typename eT>
+	Mat<eT> pi_gain(const Prob<eT>& pi, uint n_guesses, const Metric<eT, uint>& gain) {
+		Mat<eT> piG(n_guesses, pi.n_cols);
+		for(uint x = 0; x < pi.n_cols; x++)
+			for(uint w = 0; w < n_guesses; w++)
+				piG(w, x) = pi(x) * gain(w, x);
+		return piG;
+	}
+
+	// Adds all the constraints  vuln_y >= sum_x pi_x C_x,y g(w,x)  for each y,w. They are generated in parallel (each
+	// block handles a range of guesses), from the precomputed piG, so that gain is not called from the workers.
+	// With a symmetry group (program over orbits, see symmetry.h), only one (y,w) of each orbit is added; the
+	// variables of several C_x,y can then be the same, so coefficients are added.
+	//
+	template<typename eT>
+	void add_vuln_cons(lp::LinearProgram<eT>& lp, const Mat<eT>& piG,
+		const std::vector< std::list<std::pair<uint,uint>> >& vars, const std::vector<uint>& vuln_y,
+		const symmetry::Group& G = symmetry::Group()) {
+
+		uint n_guesses = piG.n_rows,
+			 M = piG.n_cols;
+		uint n_blocks = std::min(n_guesses, 4 * parallel::n_threads());
+		const uint skip = uint(-1);		// (y,w) not the representative of its orbit
+
+		lp.make_cons_parallel(n_blocks, [&](uint b, auto& block) {
+			for(uint w = b * n_guesses / n_blocks; w < (b + 1) * n_guesses / n_blocks; w++) {
+				// Store the constraints (y,w) for _this_ w. If for a specific combination (y,w) we have forall x:(C_xy = 0 OR pi_x g(w,x) = 0),
+				// the RHS of the constraint is 0 so we can completely remove the constraint, since vuln_y >= 0 is set anyway! So we
+				// store the constraints in a map, we might only have a few of them for this w.
+				//
+				std::unordered_map<uint,uint> cons;
+
+				// IMPORTANT: optimize for the case where most pi_x*g(w,x) are zero! So we have w,x in the outer loops
+				for(uint x = 0; x < M; x++) {
+					const eT& g = piG(w, x);
+					if(equal(g, eT(0)))		// nothing to do if 0
+						continue;
+
+					for(auto& [y, var] : vars[x]) {
+						auto [it, is_new] = cons.try_emplace(y, 0);
+						if(is_new) {
+							if(G.is_rep(y, w)) {
+								it->second = block.make_con(-infinity<eT>(), eT(0));
+								block.set_con_coeff(it->second, vuln_y[y], eT(-1));
+							} else {
+								it->second = skip;
+							}
+						}
+						if(it->second != skip)
+							block.set_con_coeff(it->second, var, g, true);
+					}
+				}
+			}
+		});
+	}
+
+	// Lazy generation of the constraints  vuln_y >= sum_x pi_x C_x,y g(w,x)  (cutting planes). Most of the
+	// n_guesses x n_cols constraints are not tight at the optimum, so we start with the best guess of the prior for
+	// each y, and after each solve add, for each y, the most violated constraint. The violations are found from the
+	// single product  piG * C,  where piG(w,x) = pi_x g(w,x). We stop when no constraint is violated, the solution is
+	// then optimal for the full program.
+	//
+	template<typename eT>
+	class LazyVulnCons {
+		public:
+			LazyVulnCons(lp::LinearProgram<eT>& lp, const Prob<eT>& pi, uint n_guesses, const Metric<eT, uint>& gain,
+				const std::vector< std::list<std::pair<uint,uint>> >& vars, const std::vector<uint>& vuln_y)
+				: lp(lp), vars(vars), vuln_y(vuln_y), piG(pi_gain(pi, n_guesses, gain)), var_of(pi.n_cols, std::vector<int>(vuln_y.size(), -1)) {
+
+				// gain is evaluated once (in pi_gain), so it is never called again while solving
+				for(uint x = 0; x < pi.n_cols; x++)
+					for(auto& [y, var] : vars[x])
+						var_of[x][y] = var;
+
+				// initial constraints: the best guess for the prior, for every y
+				Col<eT> prior_gain = arma::sum(piG, 1);
+				uint best = 0;
+				for(uint w = 1; w < n_guesses; w++)
+					if(less_than(prior_gain(best), prior_gain(w)))
+						best = w;
+				for(uint y = 0; y < vuln_y.size(); y++)
+					add(y, best);
+			}
+
+			bool solve() {
+				uint M = piG.n_cols, N = vuln_y.size();
+				while(true) {
+					if(!lp.solve())
+						return false;
+
+					Mat<eT> C(M, N, arma::fill::zeros);
+					for(uint x = 0; x < M; x++)
+						for(auto& [y, var] : vars[x])
+							C(x, y) = lp.solution(var);
+
+					Mat<eT> V = piG * C;		// V(w,y) = sum_x pi_x C_x,y g(w,x)
+
+					bool violated = false;
+					for(uint y = 0; y < N; y++) {
+						uint w_max = 0;
+						for(uint w = 1; w < V.n_rows; w++)
+							if(less_than(V(w_max, y), V(w, y)))
+								w_max = w;
+
+						if(less_than(lp.solution(vuln_y[y]), V(w_max, y)) && add(y, w_max))
+							violated = true;
+					}
+					if(!violated)
+						return true;
+				}
+			}
+
+		private:
+			lp::LinearProgram<eT>& lp;
+			const std::vector< std::list<std::pair<uint,uint>> >& vars;
+			const std::vector<uint>& vuln_y;
+			Mat<eT> piG;
+			std::vector<std::vector<int>> var_of;		// var_of[x][y]: variable of C_x,y, -1 if forced to 0
+			std::set<std::pair<uint,uint>> added;		// (y,w) constraints already in the program
+
+			// adds the (y,w) constraint, returns false if it was already there
+			bool add(uint y, uint w) {
+				if(!added.insert(std::pair(y, w)).second)
+					return false;
+
+				auto con = lp.make_con(-infinity<eT>(), eT(0));
+				lp.set_con_coeff(con, vuln_y[y], eT(-1));
+				for(uint x = 0; x < piG.n_cols; x++)
+					if(var_of[x][y] >= 0)
+						lp.set_con_coeff(con, var_of[x][y], piG(w, x), true);		// zeros are skipped, orbit variables added
+				return true;
+			}
+	};
+
+} // namespace aux
+
+// Returns the mechanisms having the smallest E[loss] given the Vg(pi,C) <= max_vulns(i) constraint, one for each i.
+// Only the bound of the vulnerability constraint changes for each value, so the program is built once and
+// re-solved, warm-started from the previous basis. Empty channels are returned for infeasible values.
+//
+// If duals is given it receives the dual of the vulnerability constraint for each value: the slope of the
+// loss/vulnerability frontier at max_vulns(i) (<= 0, the loss saved per unit of extra vulnerability), so the effect of
+// a small change of the threshold is known without re-solving. 0 for infeasible values, and if the solver provides no
+// duals (see LinearProgram::sensitivity).
 //
 template<typename eT>
-Chan<eT> min_loss_given_max_vuln(
+std::vector<Chan<eT>> min_loss_given_max_vuln(
 	const Prob<eT>& pi,
 	uint n_cols,
 	uint n_guesses,
-	eT max_vuln,
+	const Col<eT>& max_vulns,
 	Metric<eT, uint> gain,
 	Metric<eT, uint> loss,
-	eT hard_max_loss = infinity<eT>()	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+	eT hard_max_loss = infinity<eT>(),	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+	bool lazy_constraints = false,		// generate the vulnerability constraints lazily, see aux::LazyVulnCons
+	Col<eT>* duals = nullptr			// if given, duals(i) = d E[loss] / d max_vulns(i), see below
 ) {
 	uint M = pi.n_cols,
 		 N = n_cols;
@@ -45,36 +194,20 @@ Chan<eT> min_loss_given_max_vuln(
 	// the actual vulnerability constraint:
 	//    sum_y vuln_y <= max_vuln
 	//
-	auto max_vuln_con = lp.make_con(-infinity<eT>(), max_vuln);
+	auto max_vuln_con = lp.make_con(-infinity<eT>(), eT(0));		// the bound is set for each value below
 	for(uint y = 0; y < N; y++)
 		lp.set_con_coeff(max_vuln_con, vuln_y[y], eT(1));
 
 	// For each variable to really represent the max_w ..., we need to set constraints:
 	//    vuln_y >= sum_x pi_x C_x,y g(w,x)     for each y,w
 	//
-	for(uint w = 0; w < n_guesses; w++) {
-		// Store the constraints (y,w) for _this_ w. If for a specific combination (y,w) we have forall x:(C_xy = 0 OR pi_x g(w,x) = 0),
-		// the RHS of the constraint is 0 so we can completely remove the constraint, since vuln_y >= 0 is set anyway! So we
-		// store the constraints in a map, we might only have a few of them for this w.
-		//
-		std::unordered_map<uint,uint> cons;
-
-		// IMPORTANT: optimize for the case where most pi_x*g(w,x) are zero! So we have w,x in the outer loops
-		for(uint x = 0; x < M; x++) {
-			eT g = pi(x) * gain(w, x); 
-			if(equal(g, eT(0)))		// nothing to do if 0
-				continue;
-
-			for(auto& [y, var] : vars[x]) {
-				auto& con = cons[y];
-				if(!con) {									// 0 always means "new in the map", because "max_vuln_con" above has already taken the 0 constrain index
-					con = lp.make_con(-infinity<eT>(), eT(0));
-					lp.set_con_coeff(con, vuln_y[y], eT(-1));
-				}
-				lp.set_con_coeff(con, var, g);
-			}
-		}
-	}
+	// (with lazy_constraints they are added while solving, for all values)
+	//
+	std::unique_ptr<aux::LazyVulnCons<eT>> lazy;
+	if(lazy_constraints)
+		lazy = std::make_unique<aux::LazyVulnCons<eT>>(lp, pi, n_guesses, gain, vars, vuln_y);
+	else
+		aux::add_vuln_cons(lp, aux::pi_gain(pi, n_guesses, gain), vars, vuln_y);
 
 	// equalities for summing up to 1
 	//
@@ -88,116 +221,442 @@ Chan<eT> min_loss_given_max_vuln(
 		}
 	}
 
-	// solve program
+	// solve the program for each value, reconstructing the channel from the solution
 	//
-	if(!lp.solve())
-		return Chan<eT>();
+	lp.warm_start = true;
+	lp.sensitivity = duals != nullptr;
+	std::vector<Chan<eT>> res;
+	if(duals)
+		duals->zeros(max_vulns.n_elem);
+
+	for(uint i = 0; i < max_vulns.n_elem; i++) {
+		lp.set_con_bounds(max_vuln_con, -infinity<eT>(), max_vulns(i));
+
+		Chan<eT> C;
+		if(lazy ? lazy->solve() : (lp.solve() || lp.has_solution())) {		// also a feasible solution if interrupted
+			C.zeros(M, N);
+			for(uint x = 0; x < M; x++)
+				for(auto& [y, var] : vars[x])
+					C(x, y) = lp.solution(var);
+		}
+		if(duals && lp.has_duals())
+			(*duals)(i) = lp.dual(max_vuln_con);
+		res.push_back(C);
+	}
 
-	// reconstrict channel from solution
-	//
-	Chan<eT> C(M, N, arma::fill::zeros);
-	for(uint x = 0; x < M; x++)
-		for(auto& [y, var] : vars[x])
-			C(x, y) = lp.solution(var);
+	return res;
+}
 
-	return C;
+// Returns the mechanism having the smallest E[loss] given the Vg(pi,C) <= max_vuln constraint
+//
+template<typename eT>
+Chan<eT> min_loss_given_max_vuln(
+	const Prob<eT>& pi,
+	uint n_cols,
+	uint n_guesses,
+	eT max_vuln,
+	Metric<eT, uint> gain,
+	Metric<eT, uint> loss,
+	eT hard_max_loss = infinity<eT>(),	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+	bool lazy_constraints = false		// generate the vulnerability constraints lazily, see aux::LazyVulnCons
+) {
+	return min_loss_given_max_vuln(pi, n_cols, n_guesses, Col<eT>({ max_vuln }), gain, loss, hard_max_loss, lazy_constraints)[0];
 }
 
-// Returns the mechanism having the smallest Vg[pi,C] given the E[loss] <= max_loss constraint
+// Returns the mechanisms having the smallest Vg[pi,C] given the E[loss] <= max_losses(i) constraint, one for each i.
+// As in min_loss_given_max_vuln, the program is built once and re-solved with a warm start for each value, and
+// duals(i) receives the slope of the frontier at max_losses(i) (the vulnerability per unit of extra loss, <= 0).
+//
+// symmetries: candidate permutations of the inputs (eg. symmetry::grid(width, height)), also applied to outputs and
+// guesses (so only used if n_cols == n_guesses == M). The ones leaving pi, gain and loss invariant reduce the program
+// to one variable per orbit of (x,y) and one vulnerability constraint per orbit of (y,w), see symmetry.h.
 //
 template<typename eT>
-Chan<eT> min_vuln_given_max_loss(
+std::vector<Chan<eT>> min_vuln_given_max_loss(
 	const Prob<eT>& pi,
 	uint n_cols,
 	uint n_guesses,
-	eT max_loss,
+	const Col<eT>& max_losses,
 	Metric<eT, uint> gain,
 	Metric<eT, uint> loss,
-	eT hard_max_loss = infinity<eT>()	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+	eT hard_max_loss = infinity<eT>(),	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+	bool lazy_constraints = false,		// generate the vulnerability constraints lazily, see aux::LazyVulnCons
+	const std::vector<std::vector<uint>>& symmetries = {},
+	Col<eT>* duals = nullptr			// if given, duals(i) = d Vg / d max_losses(i), see below
 ) {
+	QIF_TRACE_SPAN("g_vuln::min_vuln_given_max_loss");
 	uint M = pi.n_cols,
 		 N = n_cols;
 
+	symmetry::Group G;
+	if(!symmetries.empty() && N == M && n_guesses == M) {
+		G = symmetry::Group(M, symmetries);
+		G.restrict_invariant(pi, loss);
+		G.restrict_invariant(pi, gain);
+	}
+
 	// C: M x N   unknowns, except those with loss(x,y) > hard_max_loss
-	// We have (at most) M x N variables
+	// We have (at most) M x N variables, one per orbit of (x,y) with symmetries (loss is invariant, so whole orbits
+	// are forced to 0)
 	lp::LinearProgram<eT> lp;
 
 	std::vector< std::list<std::pair<uint,uint>> > vars(M);	// vars[x] is a list of <y, var>
+	auto [orbit, n_orbits] = G.pair_orbits(M, N);
+	std::vector<int> orbit_var(n_orbits, -1);
 
 	for(uint x = 0; x < M; x++)
 		for(uint y = 0; y < N; y++)
-			if(less_than_or_eq(loss(x, y), hard_max_loss))
-				vars[x].push_back(std::pair(y, lp.make_var(eT(0), eT(1))));
+			if(less_than_or_eq(loss(x, y), hard_max_loss)) {
+				int& var = orbit_var[orbit[size_t(x) * N + y]];
+				if(var < 0)
+					var = lp.make_var(eT(0), eT(1));
+				vars[x].push_back(std::pair(y, uint(var)));
+			}
 
 	// loss constraint: sum_xy pi_x C_xy loss(x,y) <= max_loss
-	auto max_loss_con = lp.make_con(-infinity<eT>(), max_loss);
+	auto max_loss_con = lp.make_con(-infinity<eT>(), eT(0));		// the bound is set for each value below
 	for(uint x = 0; x < M; x++)
 		for(auto& [y, var] : vars[x])
-			lp.set_con_coeff(max_loss_con, var, pi(x) * loss(x, y));
+			lp.set_con_coeff(max_loss_con, var, pi(x) * loss(x, y), true);
 
 	// Objective function:
 	//    minimize sum_y vuln_y	
 	// using auxiliary variables:
 	//    vuln_y  =  max_w sum_x pi_x C_x,y g(w,x)  =  p(y) Vg(delta^y)
 	//
-	auto vuln_y = lp.make_vars(n_cols, eT(0));		// p(y) Vg(delta^y) >= 0 so this is safe, and useful (see below)
+	// (one per orbit of y with symmetries)
+	//
+	std::vector<uint> vuln_y(N);
+	for(uint y = 0; y < N; y++)
+		vuln_y[y] = G.is_rep(y) ? lp.make_var(eT(0)) : vuln_y[G.rep(y)];		// p(y) Vg(delta^y) >= 0 so this is safe, and useful (see below)
 
 	lp.maximize = false;
 	for(uint y = 0; y < N; y++)
-		lp.set_obj_coeff(vuln_y[y], eT(1));
+		lp.set_obj_coeff(vuln_y[y], eT(1), true);
 
 	// For each aux variable to really represent the max_w ..., we need to set constraints:
 	//    vuln_y >= sum_x pi_x C_x,y g(w,x)     for each y,w
 	//
-	for(uint w = 0; w < n_guesses; w++) {
-		// Store the constraints (y,w) for _this_ w. If for a specific combination (y,w) we have forall x:(C_xy = 0 OR pi_x g(w,x) = 0),
-		// the RHS of the constraint is 0 so we can completely remove the constraint, since vuln_y >= 0 is set anyway! So we
-		// store the constraints in a map, we might only have a few of them for this w.
-		//
-		std::unordered_map<uint,uint> cons;
-
-		// IMPORTANT: optimize for the case where most pi_x*g(w,x) are zero! So we have w,x in the outer loops
-		for(uint x = 0; x < M; x++) {
-			eT g = pi(x) * gain(w, x); 
-			if(equal(g, eT(0)))		// nothing to do if 0
-				continue;
-
-			for(auto& [y, var] : vars[x]) {
-				auto& con = cons[y];
-				if(!con) {									// 0 always means "new in the map", because "max_loss_con" above has already taken the 0 constrain index
-					con = lp.make_con(-infinity<eT>(), eT(0));
-					lp.set_con_coeff(con, vuln_y[y], eT(-1));
-				}
-				lp.set_con_coeff(con, var, g);
-			}
-		}
-	}
+	// (with lazy_constraints they are added while solving, for all values)
+	//
+	std::unique_ptr<aux::LazyVulnCons<eT>> lazy;
+	if(lazy_constraints)
+		lazy = std::make_unique<aux::LazyVulnCons<eT>>(lp, pi, n_guesses, gain, vars, vuln_y);
+	else
+		aux::add_vuln_cons(lp, aux::pi_gain(pi, n_guesses, gain), vars, vuln_y, G);
 
-	// equalities for summing up to 1
+	// equalities for summing up to 1, one per orbit of x
 	//
 	for(uint x = 0; x < M; x++) {
+		if(!G.is_rep(x))
+			continue;
 		auto con = lp.make_con(eT(1), eT(1));
 
 		// coeff 1 for variable C[x,y]
 		for(auto& [y, var] : vars[x]) {
 			(void)y; // avoid unused warning
-			lp.set_con_coeff(con, var, eT(1));
+			lp.set_con_coeff(con, var, eT(1), true);
 		}
 	}
 
-	// solve program
+	// solve the program for each value, reconstructing the channel from the solution
 	//
-	if(!lp.solve())
-		return Chan<eT>();
+	lp.warm_start = true;
+	lp.sensitivity = duals != nullptr;
+	std::vector<Chan<eT>> res;
+	if(duals)
+		duals->zeros(max_losses.n_elem);
+
+	for(uint i = 0; i < max_losses.n_elem; i++) {
+		lp.set_con_bounds(max_loss_con, -infinity<eT>(), max_losses(i));
+
+		Chan<eT> C;
+		if(lazy ? lazy->solve() : (lp.solve() || lp.has_solution())) {		// also a feasible solution if interrupted
+			C.zeros(M, N);
+			for(uint x = 0; x < M; x++)
+				for(auto& [y, var] : vars[x])
+					C(x, y) = lp.solution(var);
+		}
+		if(duals && lp.has_duals())
+			(*duals)(i) = lp.dual(max_loss_con);
+		res.push_back(C);
+	}
+
+	return res;
+}
 
-	// reconstrict channel from solution
+// Returns the mechanism having the smallest Vg[pi,C] given the E[loss] <= max_loss constraint
+//
+template<typename eT>
+Chan<eT> min_vuln_given_max_loss(
+	const Prob<eT>& pi,
+	uint n_cols,
+	uint n_guesses,
+	eT max_loss,
+	Metric<eT, uint> gain,
+	Metric<eT, uint> loss,
+	eT hard_max_loss = infinity<eT>(),	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+	bool lazy_constraints = false,		// generate the vulnerability constraints lazily, see aux::LazyVulnCons
+	const std::vector<std::vector<uint>>& symmetries = {}	// candidate symmetries, see the vector version
+) {
+	return min_vuln_given_max_loss(pi, n_cols, n_guesses, Col<eT>({ max_loss }), gain, loss, hard_max_loss, lazy_constraints, symmetries)[0];
+}
+
+// The privacy-utility frontier of g-vulnerability and E[loss]: the function f(v) = min { E[loss] : Vg(pi,C) <= v }
+// is convex and piecewise linear, and mixing the optimal mechanisms of two adjacent breakpoints gives an optimal
+// mechanism for every v in between. So the breakpoints and their mechanisms describe the solutions of both
+// min_loss_given_max_vuln and min_vuln_given_max_loss for all thresholds.
+//
+template<typename eT>
+class Frontier {
+	public:
+		Col<eT> vulns, losses;				// breakpoints, vulns increasing and losses decreasing
+		std::vector<Chan<eT>> mechanisms;	// optimal mechanism of each breakpoint
+
+		// optimal mechanism given Vg(pi,C) <= max_vuln, empty if infeasible
+		Chan<eT> min_loss_given_max_vuln(eT max_vuln) const {
+			if(vulns.is_empty() || less_than(max_vuln, vulns(0)))
+				return Chan<eT>();
+			if(!less_than(max_vuln, vulns(vulns.n_elem - 1)))
+				return mechanisms.back();
+			return mix(vulns, max_vuln);
+		}
+
+		// optimal mechanism given E[loss] <= max_loss, empty if infeasible
+		Chan<eT> min_vuln_given_max_loss(eT max_loss) const {
+			if(losses.is_empty() || less_than(max_loss, losses(losses.n_elem - 1)))
+				return Chan<eT>();
+			if(!less_than(max_loss, losses(0)))
+				return mechanisms.front();
+			return mix(losses, max_loss);
+		}
+
+	private:
+		// mixes the mechanisms of the two breakpoints k, k+1 with t between v(k) and v(k+1)
+		Chan<eT> mix(const Col<eT>& v, eT t) const {
+			for(uint k = 0; k + 1 < v.n_elem; k++) {
+				if((t - v(k)) * (t - v(k + 1)) > eT(0))
+					continue;
+				eT lambda = (t - v(k)) / (v(k + 1) - v(k));
+				return Chan<eT>((eT(1) - lambda) * mechanisms[k] + lambda * mechanisms[k + 1]);
+			}
+			return mechanisms.back();		// not reached
+		}
+};
+
+namespace aux {
+
+	// The program of min_loss_given_max_vuln/min_vuln_given_max_loss with both the loss and the vulnerability as
+	// (bounded) constraints, and the objective  w_loss E[loss] + w_vuln Vg  set at every solve.
 	//
-	Chan<eT> C(M, N, arma::fill::zeros);
-	for(uint x = 0; x < M; x++)
-		for(auto& [y, var] : vars[x])
-			C(x, y) = lp.solution(var);
+	template<typename eT>
+	class FrontierProgram {
+		public:
+			struct Point {
+				bool ok = false;
+				eT vuln, loss;					// of the mechanism (not of the auxiliary variables)
+				Chan<eT> C;
+			};
+
+			lp::LinearProgram<eT> lp;
+
+			FrontierProgram(const Prob<eT>& pi, uint n_cols, const Mat<eT>& piG, const Mat<eT>& piL, eT hard_max_loss, const Mat<eT>& L)
+				: piG(piG), piL(piL), vars(pi.n_cols) {
+
+				uint M = pi.n_cols;
+
+				for(uint x = 0; x < M; x++)
+					for(uint y = 0; y < n_cols; y++)
+						if(less_than_or_eq(L(x, y), hard_max_loss))
+							vars[x].push_back(std::pair(y, lp.make_var(eT(0), eT(1))));
+
+				lp.maximize = false;
+				vuln_y = lp.make_vars(n_cols, eT(0));
+
+				// loss/vuln constraints. Unbounded rows are not allowed, so "no bound" is an upper bound satisfied by
+				// all mechanisms:  E[loss] <= sum_x max_y pi_x loss(x,y),  sum_y vuln_y <= sum_x max(0, max_w pi_x g(w,x))
+				max_loss_cap = max_vuln_cap = eT(0);
+				for(uint x = 0; x < M; x++) {
+					eT ml = piL(x, 0), mv = eT(0);
+					for(uint y = 1; y < n_cols; y++)
+						ml = qif::max(ml, piL(x, y));
+					for(uint w = 0; w < piG.n_rows; w++)
+						mv = qif::max(mv, piG(w, x));
+					max_loss_cap += ml;
+					max_vuln_cap += mv;
+				}
+				max_loss_cap = relax(max_loss_cap);
+				max_vuln_cap = relax(max_vuln_cap);
+
+				loss_con = lp.make_con(-infinity<eT>(), max_loss_cap);
+				for(uint x = 0; x < M; x++)
+					for(auto& [y, var] : vars[x])
+						lp.set_con_coeff(loss_con, var, piL(x, y));
+
+				vuln_con = lp.make_con(-infinity<eT>(), max_vuln_cap);
+				for(uint y = 0; y < n_cols; y++)
+					lp.set_con_coeff(vuln_con, vuln_y[y], eT(1));
+
+				add_vuln_cons(lp, piG, vars, vuln_y);
+
+				for(uint x = 0; x < M; x++) {
+					auto con = lp.make_con(eT(1), eT(1));
+					for(auto& [y, var] : vars[x]) {
+						(void)y; // avoid unused warning
+						lp.set_con_coeff(con, var, eT(1));
+					}
+				}
+			}
+
+			// minimizes w_loss E[loss] + w_vuln Vg subject to Vg <= max_vuln, E[loss] <= max_loss
+			Point solve(eT w_loss, eT w_vuln, eT max_vuln = infinity<eT>(), eT max_loss = infinity<eT>()) {
+				for(uint x = 0; x < vars.size(); x++)
+					for(auto& [y, var] : vars[x])
+						lp.set_obj_coeff(var, w_loss * piL(x, y));
+				for(auto var : vuln_y)
+					lp.set_obj_coeff(var, w_vuln);
+				lp.set_con_bounds(vuln_con, -infinity<eT>(), max_vuln == infinity<eT>() ? max_vuln_cap : max_vuln);
+				lp.set_con_bounds(loss_con, -infinity<eT>(), max_loss == infinity<eT>() ? max_loss_cap : max_loss);
+
+				Point p;
+				if(!(p.ok = lp.solve()))
+					return p;
+
+				p.C.zeros(piL.n_rows, piL.n_cols);
+				p.loss = eT(0);
+				for(uint x = 0; x < vars.size(); x++) {
+					for(auto& [y, var] : vars[x]) {
+						p.C(x, y) = lp.solution(var);
+						p.loss += piL(x, y) * p.C(x, y);
+					}
+				}
+				p.vuln = arma::accu(arma::max(Mat<eT>(piG * p.C), 0));
+				return p;
+			}
+
+			// bound slightly above the optimal value v of a previous solve, so that it remains feasible for floats
+			static eT relax(eT v) {
+				return v + def_md<eT> * (eT(1) + qif::abs(v));
+			}
+
+		private:
+			Mat<eT> piG, piL;
+			std::vector< std::list<std::pair<uint,uint>> > vars;	// vars[x] is a list of <y, var>
+			std::vector<uint> vuln_y;
+			uint loss_con, vuln_con;
+			eT max_loss_cap, max_vuln_cap;
+	};
+
+} // namespace aux
+
+// Computes all breakpoints of the (Vg, E[loss]) frontier, see Frontier.
+//
+// The breakpoints are found by a dichotomic search: starting from the two end points (min Vg, then min E[loss] among
+// those, and vice versa), for every pair (a, b) of adjacent breakpoints found so far the program is solved with the
+// objective normal to the segment ab. Either the optimum lies strictly below the segment, and is a new breakpoint, or
+// ab is an edge of the frontier. So k breakpoints take 2k+1 solves, of the same program with a different objective.
+// With a solver that can be warm-started (GLPK, GLOP, CLP simplex) one program is re-solved from the previous basis,
+// otherwise the segments of each round are solved in parallel, each on its own copy of the program.
+//
+template<typename eT>
+Frontier<eT> frontier(
+	const Prob<eT>& pi,
+	uint n_cols,
+	uint n_guesses,
+	Metric<eT, uint> gain,
+	Metric<eT, uint> loss,
+	eT hard_max_loss = infinity<eT>()	// C[x,y] is forced to 0 if loss(x,y) > hard_max_loss
+) {
+	typedef typename aux::FrontierProgram<eT>::Point Point;
+
+	// gain/loss are evaluated once here, so they are never called from the workers
+	uint M = pi.n_cols;
+	Mat<eT> L(M, n_cols), piL(M, n_cols);
+	for(uint y = 0; y < n_cols; y++) {
+		for(uint x = 0; x < M; x++) {
+			L(x, y) = loss(x, y);
+			piL(x, y) = pi(x) * L(x, y);
+		}
+	}
+	aux::FrontierProgram<eT> prog(pi, n_cols, aux::pi_gain(pi, n_guesses, gain), piL, hard_max_loss, L);
+
+	const bool warm = prog.lp.supports_warm_start();
+	prog.lp.warm_start = warm;
+
+	// end points, lexicographic optima
+	Frontier<eT> res;
+	Point p = prog.solve(eT(0), eT(1));
+	if(!p.ok)
+		return res;		// no mechanism satisfies hard_max_loss
+	std::vector<Point> points;
+	points.push_back(prog.solve(eT(1), eT(0), prog.relax(p.vuln)));
+	p = prog.solve(eT(1), eT(0));
+	points.push_back(prog.solve(eT(0), eT(1), infinity<eT>(), prog.relax(p.loss)));
+
+	if(!points[0].ok || !points[1].ok)
+		throw std::runtime_error("frontier: end points should be feasible");
+
+	// weighted objective normal to the segment ab (a of smaller vuln and larger loss), constant along ab, normalized
+	// so that tolerances are meaningful
+	auto weights = [&](const Point& a, const Point& b) {
+		eT w_loss = b.vuln - a.vuln, w_vuln = a.loss - b.loss, s = w_loss + w_vuln;
+		return std::pair(w_loss / s, w_vuln / s);
+	};
+	const eT tol = def_md<eT>;
+
+	// only segments of positive length are searched (a point found on a or b is not a new breakpoint)
+	auto proper = [&](const Point& a, const Point& b) {
+		return less_than(a.vuln, b.vuln, tol, tol) && less_than(b.loss, a.loss, tol, tol);
+	};
+
+	std::vector<std::pair<uint,uint>> segments;
+	if(proper(points[0], points[1]))
+		segments.push_back({ 0, 1 });
+	else
+		points.pop_back();		// a single optimal point
+
+	while(!segments.empty()) {
+		std::vector<Point> found(segments.size());
+		auto solve = [&](uint i, aux::FrontierProgram<eT>& pr) {
+			auto [w_loss, w_vuln] = weights(points[segments[i].first], points[segments[i].second]);
+			found[i] = pr.solve(w_loss, w_vuln);
+		};
+		if(warm) {
+			for(uint i = 0; i < segments.size(); i++)
+				solve(i, prog);
+		} else {
+			parallel::for_each(segments.size(), [&](uint i) {
+				aux::FrontierProgram<eT> copy(prog);
+				solve(i, copy);
+			});
+		}
+
+		std::vector<std::pair<uint,uint>> next;
+		for(uint i = 0; i < segments.size(); i++) {
+			auto [ia, ib] = segments[i];
+			auto [w_loss, w_vuln] = weights(points[ia], points[ib]);
+			const Point& q = found[i];
+			if(q.ok && less_than(w_loss * q.loss + w_vuln * q.vuln, w_loss * points[ia].loss + w_vuln * points[ia].vuln, tol, tol)
+					&& proper(points[ia], q) && proper(q, points[ib])) {
+				points.push_back(q);
+				uint iq = points.size() - 1;
+				next.push_back({ ia, iq });
+				next.push_back({ iq, ib });
+			}
+		}
+		segments = next;
+	}
 
-	return C;
+	std::sort(points.begin(), points.end(), [](const Point& a, const Point& b) { return a.vuln < b.vuln; });
+
+	res.vulns.set_size(points.size());
+	res.losses.set_size(points.size());
+	for(uint k = 0; k < points.size(); k++) {
+		res.vulns(k) = points[k].vuln;
+		res.losses(k) = points[k].loss;
+		res.mechanisms.push_back(points[k].C);
+	}
+	return res;
 }
 
 } // namespace mechanism::g_vuln
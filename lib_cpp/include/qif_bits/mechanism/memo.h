@@ -0,0 +1,263 @@
+namespace mechanism::memo {
+
+// On-disk memoisation of expensive mechanism constructions. The functions of this namespace have the same arguments
+// as the corresponding constructors; the result is stored in the cache directory (see set_dir) in the binary format of
+// binary::save, under a hash of the constructor's name, the element type and all arguments (metrics are hashed through
+// their distance matrices), and later calls with the same arguments read it back (through an mmap'ed file) instead of
+// recomputing it. The hash also includes the library version and cache_version, so results of older code are never
+// returned.
+//
+// Files are written to a temporary name and then renamed, so concurrent runs never see partial files (at worst both
+// compute the result). Caching is best-effort: an unreadable file is recomputed, a failed write only loses the cache.
+// With an empty directory (the default, unless the QIF_CACHE_DIR environment variable is set) nothing is cached.
+//
+
+// Part of every key. Bump it whenever a memoised constructor (or anything it uses) changes its results, so that files
+// cached by the previous code are ignored.
+//
+const uint cache_version = 2;
+
+namespace aux {
+
+inline std::string& dir_ref() {
+	static std::string dir = [] {
+		const char* env = std::getenv("QIF_CACHE_DIR");
+		return std::string(env ? env : "");
+	}();
+	return dir;
+}
+
+inline std::mutex& dir_mutex() {
+	static std::mutex m;
+	return m;
+}
+
+} // namespace aux
+
+inline void set_dir(const std::string& dir) {
+	std::lock_guard<std::mutex> lock(aux::dir_mutex());
+	aux::dir_ref() = dir;
+}
+
+inline std::string get_dir() {
+	std::lock_guard<std::mutex> lock(aux::dir_mutex());
+	return aux::dir_ref();
+}
+
+// 128-bit hash (two independent 64-bit FNV-1a/multiply-xorshift lanes) of a sequence of values
+//
+class Key {
+	public:
+		explicit Key(const std::string& name) { add(name); }
+
+		Key& add_bytes(const void* data, size_t n) {
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			for(size_t i = 0; i < n; i++) {
+				h1 = (h1 ^ p[i]) * 0x100000001b3ULL;
+				h2 = (h2 ^ p[i]) * 0x9e3779b97f4a7c15ULL;
+				h2 ^= h2 >> 29;
+			}
+			return *this;
+		}
+
+		Key& add(uint64_t v)				{ return add_bytes(&v, sizeof(v)); }
+		Key& add(uint v)					{ return add(uint64_t(v)); }
+		Key& add(bool v)					{ return add(uint64_t(v)); }
+		Key& add(double v)					{ return add_bytes(&v, sizeof(v)); }
+		Key& add(float v)					{ return add(double(v)); }
+		Key& add(const rat& v)				{ return add(v.to_string()); }
+		Key& add(const std::string& s)		{ add(uint64_t(s.size())); return add_bytes(s.data(), s.size()); }
+		Key& add(const char* s)				{ return add(std::string(s)); }
+
+		template<typename eT>
+		Key& add(const Mat<eT>& M) {
+			add(uint64_t(M.n_rows));
+			add(uint64_t(M.n_cols));
+			if constexpr (std::is_same<eT, rat>::value) {
+				for(const rat& v : M)
+					add(v);
+			} else {
+				add_bytes(M.memptr(), M.n_elem * sizeof(eT));
+			}
+			return *this;
+		}
+
+		std::string hex() const {
+			char buf[33];
+			std::snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)h1, (unsigned long long)h2);
+			return buf;
+		}
+
+	private:
+		uint64_t h1 = 0xcbf29ce484222325ULL, h2 = 0x84222325cbf29ce4ULL;
+};
+
+// Mat<eT> returned by compute(), read from the cache if the key has been computed before. An empty result (the way
+// the LP-based constructors report failure) is not stored, so the next call tries again.
+//
+template<typename eT, typename F>
+Mat<eT> cached(const Key& key, F compute) {
+	namespace fs = std::filesystem;
+
+	const std::string dir = get_dir();
+	if(dir.empty())
+		return compute();
+
+	const fs::path path = fs::path(dir) / (key.hex() + ".bin");
+
+	std::error_code ec;
+	if(fs::exists(path, ec)) {
+		try {
+			if(binary::elem_type(path.string()) == binary::aux::elem_code<eT>()) {
+				Mat<eT> M = binary::load<eT>(path.string());
+				if(!M.is_empty())
+					return M;
+			}
+		} catch(std::exception&) {
+			// unreadable or corrupt (eg. left by a crash, bad_alloc/length_error from a damaged header), recompute
+			// and overwrite
+		}
+	}
+
+	Mat<eT> M = compute();
+	if(M.is_empty())
+		return M;
+
+	// unique temporary name in the same directory, so that the rename is atomic
+	std::ostringstream tmp_name;
+	tmp_name << key.hex() << ".tmp-" << std::hash<std::thread::id>()(std::this_thread::get_id()) << "-" << rng::random_seed();
+	const fs::path tmp = fs::path(dir) / tmp_name.str();
+
+	try {
+		fs::create_directories(dir);
+		binary::save(tmp.string(), M);
+		fs::rename(tmp, path);
+	} catch(std::exception&) {
+		fs::remove(tmp, ec);
+	}
+	return M;
+}
+
+namespace aux {
+
+template<typename eT>
+Key key(const std::string& name) {
+	Key k(name);
+	k.add(uint(binary::aux::elem_code<eT>()));
+	k.add(cache_version);
+	#ifdef QIF_VERSION
+	k.add(QIF_VERSION);
+	#endif
+	return k;
+}
+
+template<typename eT, typename D>
+Mat<eT> metric_matrix(const D& d, uint n_rows, uint n_cols) {
+	Mat<eT> M(n_rows, n_cols);
+	for(uint j = 0; j < n_cols; j++)
+		for(uint i = 0; i < n_rows; i++)
+			M(i, j) = d(i, j);
+	return M;
+}
+
+// true if the LPs of this thread have limits (see lp::SolveOptions). An interrupted solve can give a non-optimal
+// mechanism, which should not be cached, so the LP-based constructors are not memoised then.
+inline bool lp_limited() {
+	const lp::SolveOptions& opt = lp::thread_options();
+	return opt.time_limit > 0 || opt.iteration_limit > 0 || opt.cancel.active();
+}
+
+} // namespace aux
+
+// memoised geo_ind::planar_laplace_grid
+//
+template<typename eT>
+Chan<eT> planar_laplace_grid(uint width, uint height, eT step, eT epsilon, const std::string& method = "miser") {
+	Key key = aux::key<eT>("geo_ind::planar_laplace_grid");
+	key.add(width).add(height).add(step).add(epsilon).add(method);
+
+	return cached<eT>(key, [&] { return geo_ind::planar_laplace_grid<eT>(width, height, step, epsilon, method); });
+}
+
+// memoised geo_ind::planar_geometric_grid
+//
+template<typename eT>
+Chan<eT> planar_geometric_grid(uint width, uint height, eT step, eT epsilon) {
+	Key key = aux::key<eT>("geo_ind::planar_geometric_grid");
+	key.add(width).add(height).add(step).add(epsilon);
+
+	return cached<eT>(key, [&] { return geo_ind::planar_geometric_grid<eT>(width, height, step, epsilon); });
+}
+
+// memoised d_privacy::exponential. The distance matrix is built once, hashed, and used to construct the mechanism.
+//
+template<typename eT>
+Chan<eT> exponential(uint n_rows, Metric<eT, uint> d, uint n_cols = 0) {
+	if(n_cols == 0) n_cols = n_rows;
+	Mat<eT> D = aux::metric_matrix<eT>(d, n_rows, n_cols);
+
+	Key key = aux::key<eT>("d_privacy::exponential");
+	key.add(D);
+
+	return cached<eT>(key, [&] { return d_privacy::exponential<eT>(D); });
+}
+
+// memoised d_privacy::min_loss_given_d. d_priv_ch is hashed through its value on all pairs of inputs, and the LP
+// solver/method defaults are part of the key (they can select different optimal mechanisms).
+//
+template<typename eT, typename DP = Metric<eT, uint>, typename L = Metric<eT, uint>>
+Chan<eT> min_loss_given_d(
+	const Prob<eT>& pi,
+	uint n_cols,
+	const DP& d_priv,
+	const L& loss,
+	std::string vars = "all",
+	Chainable<uint> d_priv_ch = metric::never_chainable<uint>,
+	eT inf = eT(std::log(1e200))
+) {
+	if(aux::lp_limited())
+		return d_privacy::min_loss_given_d<eT>(pi, n_cols, d_priv, loss, vars, d_priv_ch, inf);
+
+	uint n_rows = pi.n_cols;
+	Mat<eT> chain(n_rows, n_rows);
+	for(uint j = 0; j < n_rows; j++)
+		for(uint i = 0; i < n_rows; i++)
+			chain(i, j) = eT(d_priv_ch(i, j) ? 1 : 0);
+
+	Key key = aux::key<eT>("d_privacy::min_loss_given_d");
+	key.add(pi).add(n_cols)
+		.add(aux::metric_matrix<eT>(d_priv, n_rows, std::max(n_rows, n_cols)))
+		.add(aux::metric_matrix<eT>(loss, n_rows, n_cols))
+		.add(vars).add(chain).add(inf)
+		.add(lp::Defaults::solver).add(lp::Defaults::method);
+
+	return cached<eT>(key, [&] { return d_privacy::min_loss_given_d<eT>(pi, n_cols, d_priv, loss, vars, d_priv_ch, inf); });
+}
+
+// memoised g_vuln::min_vuln_given_max_loss
+//
+template<typename eT>
+Chan<eT> min_vuln_given_max_loss(
+	const Prob<eT>& pi,
+	uint n_cols,
+	uint n_guesses,
+	eT max_loss,
+	Metric<eT, uint> gain,
+	Metric<eT, uint> loss,
+	eT hard_max_loss = infinity<eT>(),
+	bool lazy_constraints = false
+) {
+	if(aux::lp_limited())
+		return g_vuln::min_vuln_given_max_loss<eT>(pi, n_cols, n_guesses, max_loss, gain, loss, hard_max_loss, lazy_constraints);
+
+	Key key = aux::key<eT>("g_vuln::min_vuln_given_max_loss");
+	key.add(pi).add(n_cols).add(n_guesses).add(max_loss)
+		.add(aux::metric_matrix<eT>(gain, n_guesses, pi.n_cols))
+		.add(aux::metric_matrix<eT>(loss, pi.n_cols, n_cols))
+		.add(hard_max_loss).add(lazy_constraints)
+		.add(lp::Defaults::solver).add(lp::Defaults::method);
+
+	return cached<eT>(key, [&] { return g_vuln::min_vuln_given_max_loss<eT>(pi, n_cols, n_guesses, max_loss, gain, loss, hard_max_loss, lazy_constraints); });
+}
+
+} // namespace mechanism::memo
@@ -11,202 +11,371 @@ int bound(int val, int min_val, int max_val);
 
 // -- For sampling -----------------------------------------------
 
-// sample from a planar geometric centered at (0,0) (if origin is different, just add it to the result)
+// normalization coefficient of the planar geometric, 1 / sum_{cells z} exp(-eps |z|), summed over the rings of
+// geo::ring_table (ring r contributes exp(-eps * cell_size * radius) for its 8r cells, computed with a vectorized exp)
+// until a whole ring does not change the result at all
 //
 template<typename eT = eT_def>
 eT
 _planar_geometric_coeff(eT cell_size, eT eps) {
-	LargeSum<eT> sum;
-	Point<eT> zero(0,0);
-	auto d = eps * metric::euclidean<double, Point<eT>>();
+	const double a = to_double(eps) * to_double(cell_size);
+	CompensatedSum<eT> sum;
+	arma::vec probs;
 
 	eT coeff_cur(0);
-	for(Point<eT> p : GridWalk<eT>(cell_size)) {
-		eT prob = exp<eT>(-d(p, zero));
-		sum.add(prob);
+	auto table = geo::ring_table(64);
+	for(uint r = 0; ; r++) {
+		if(r == table->n_rings())
+			table = geo::ring_table(2 * r);
+
+		uint start = table->ring_start[r], n = table->ring_start[r+1] - start;
+		const arma::vec radius(const_cast<double*>(table->radius.data()) + start, n, false, true);
+		probs = arma::exp(-a * radius);
+
+		if constexpr (std::is_same<eT, double>::value) {
+			sum.add(probs.memptr(), n);
+		} else {
+			sum.add_each(n, [&](size_t k) { return eT(probs[k]); });
+		}
 
-		// stop if adding a new value does not change the result at all
+		// relative comparison: for small eps the coefficient itself is below the default tolerances
 		eT coeff_new(1 / sum.value());
-		if(equal(coeff_new, coeff_cur))
+		if(equal(coeff_new, coeff_cur, eT(0), def_mrd<eT> * coeff_new))
 			break;
 		coeff_cur = coeff_new;
 	}
 	return coeff_cur;
 }
 
+// Sampler for the planar geometric centered at (0,0), with O(1) expected cost per sample and O(1) memory.
+//
+// Exact rejection sampling on the lattice: the proposal has probability proportional to x^r, for the Chebyshev ring
+// r = max(|i|,|j|) of cell (i,j) and x = exp(-eps * cell_size), so it dominates the target exp(-eps * cell_size * |(i,j)|).
+// Under the proposal, ring 0 has probability 1/Z with Z = 1 + 8x/(1-x)^2, otherwise r-1 is the sum of two geometric
+// variables, and the cell is uniform among the 8r cells of ring r. A cell is accepted with probability
+// exp(-eps * cell_size * (|(i,j)| - r)). The overall acceptance rate is at least ~pi/4, so on average fewer than
+// 1.3 proposals are needed, and no normalization coefficient or CDF is needed at all.
+//
 template<typename eT = eT_def>
-Point<eT>
-planar_geometric_sample(eT cell_size, eT eps) {
-	auto euclid = metric::euclidean<double, Point<eT>>();
-	double coeff = _planar_geometric_coeff<eT>(cell_size, eps);
+class PlanarGeometricSampler {
+	private:
+		eT cell_size;
+		double a, p0;
+
+		// geometric on {0, 1, ...} with parameter 1-exp(-a)
+		template<typename G>
+		inline uint geometric(G& gen) const {
+			return uint(std::floor(-std::log1p(-rng::randu<double>(gen)) / a));
+		}
+
+	public:
+		PlanarGeometricSampler(eT cell_size, eT eps) : cell_size(cell_size) {
+			a = to_double(eps) * to_double(cell_size);
+			if(!(a > 0)) throw std::runtime_error("eps * cell_size must be positive");
+
+			double x = std::exp(-a);
+			p0 = 1 / (1 + 8 * x / ((1 - x) * (1 - x)));
+		}
+
+		template<typename G>
+		Point<eT> operator()(G& gen) const {
+			while(true) {
+				if(rng::randu<double>(gen) < p0)
+					return Point<eT>(0, 0);
+
+				int r = 1 + geometric(gen) + geometric(gen);
+
+				// uniform among the 8r cells of the ring, each side [-r, r-1] rotated by 90 degrees
+				uint idx = uint(((gen() >> 32) * uint64_t(8 * r)) >> 32);
+				int k = int(idx % (2 * r)) - r, i, j;
+				switch(idx / (2 * r)) {
+					case 0:  i =  r; j =  k; break;
+					case 1:  i = -k; j =  r; break;
+					case 2:  i = -r; j = -k; break;
+					default: i =  k; j = -r;
+				}
 
-	eT p = rng::randu<eT>();
-	LargeSum<eT> accu;
-	uint cnt = 0;
-	Point<eT> zero(0,0);
+				if(rng::randu<double>(gen) < std::exp(-a * (std::sqrt(double(i) * i + double(j) * j) - r)))
+					return Point<eT>(i * cell_size, j * cell_size);
+			}
+		}
 
-	for(Point<eT> z : GridWalk<eT>(cell_size)) {
-		eT prob = coeff * exp<eT>(-eps * euclid(z, zero));
-		accu.add(prob);
+		Point<eT> operator()() const {
+			return (*this)(rng::aux::thread_engine());
+		}
 
-		if(accu.value() > p)
-			return z;
+		// n samples into res (preallocated), generated in parallel from independent streams of seed
+		void fill(Point<eT>* res, size_t n, uint64_t seed) const {
+			rng::parallel_streams(n, seed, [&](rng::Engine& gen, size_t begin, size_t end) {
+				for(size_t k = begin; k < end; k++)
+					res[k] = (*this)(gen);
+			});
+		}
 
-		if(cnt++ == 1e8)
-			throw std::runtime_error("infinite loop?");
-	}
-	return Point<eT>(0,0);		// unreachable, just avoid the warning
+		std::vector<Point<eT>> fill(uint n, uint64_t seed = rng::random_seed()) const {
+			std::vector<Point<eT>> res(n);
+			fill(res.data(), n, seed);
+			return res;
+		}
+};
+
+template<typename eT = eT_def>
+Point<eT>
+planar_geometric_sample(eT cell_size, eT eps) {
+	return PlanarGeometricSampler<eT>(cell_size, eps)();
 }
 
 // efficient batch sampling
 template<typename eT = eT_def>
 std::vector<Point<eT>>
 planar_geometric_sample(eT cell_size, eT eps, uint n) {
-	auto euclid = metric::euclidean<double, Point<eT>>();
-	double coeff = _planar_geometric_coeff<eT>(cell_size, eps);
-
-	// we need n numbers uniformly sampled in [0,1]. Sort them and keep the indexes of the sorted list in 'order'
-	Row<eT> ps(n);
-	ps.randu();
-	arma::uvec order = arma::sort_index(ps);
-
-	// single grid walk for all samples
-	GridWalk<eT> gw(cell_size);
-	auto gw_it = gw.begin();
-
-	LargeSum<eT> accu;
-	accu.add(coeff);		// gw points at the first element (x itself), so accu should contain its probability (= coeff)!
-	uint cnt = 0;
-	Point<eT> zero(0,0);
-	std::vector<Point<eT>> res(n);
-
-	// sample n elements. 
-	for(uint i = 0; i < n; i++) {
-		// we need to visit elements in sorted order of p
-		eT p = ps(order(i));
-
-		while(less_than(accu.value(), p)) {
-			++gw_it;	// first increment, to get the probability of the new point
-			eT prob = coeff * exp<eT>(-eps * euclid(*gw_it, zero));
-			accu.add(prob);
-			if(cnt++ == 1e8)
-				throw std::runtime_error("infinite loop?");
-		}
-
-		// place the result in the same position in res as p was in ps.
-		res[order(i)] = *gw_it;
-	}
-
-	return res;
+	return PlanarGeometricSampler<eT>(cell_size, eps).fill(n);
 }
 
 
 
 // -- For computing the channel matrix -----------------------------------------------
 
+// The kernel of planar_geometric_grid for a fixed (step, epsilon), reused across grid sizes (eg. in sweeps over the
+// size). Every cell of the kernel is a sum of k(si,sj) = exp(-epsilon a_step |(si,sj)|) over a rectangle of
+// [0, far_away]^2, read in O(1) from a suffix-sum table. The table is kept, and rebuilt (at least doubling) only when a
+// larger far_away is needed, so the sums over a smaller far_away are read from the same table and a sweep costs about
+// as much as its largest grid. A kernel should not be used by several threads at once.
+//
 template<typename eT>
-Mat<eT>
-grid_summation(uint width, uint height, eT step, eT epsilon) {
-	if(width % 2 == 0 || height % 2 == 0) throw std::runtime_error("width/height must by odd");
-	if(width == 1 || height == 1) throw std::runtime_error("width/height must be > 1");
+class GeometricGridKernel {
+	public:
+		GeometricGridKernel(eT step, eT epsilon) : epsilon(epsilon * (step / eT(a_step))) {}		// see summation
 
-	// same trick changing step and epsilon. Not sure if it's really useful
-	//
-	double a_step = 1;
-	epsilon *= step / a_step;								// we _multiply_ epsilon by the same factor used to _divide_ step. i.e. when a_step < step then epsilon is increased
+		// Same as grid_summation(width, height, step, epsilon)
+		Mat<eT> summation(uint width, uint height) {
+			if(width % 2 == 0 || height % 2 == 0) throw std::runtime_error("width/height must by odd");
+			if(width == 1 || height == 1) throw std::runtime_error("width/height must be > 1");
 
-	Mat<eT> m = arma::zeros<Mat<eT>>(height, width);		// rows = height, cols = width,  point (x,y) has index (cy+y, cx+x)
+			Mat<eT> m = arma::zeros<Mat<eT>>(height, width);		// rows = height, cols = width,  point (x,y) has index (cy+y, cx+x)
 
-	int cx = (width-1)/2;									// corner x index
-	int cy = (height-1)/2;									// corner y index
-	const double grid_bound = (max(cx, cy) + 0.5) * a_step;	// boundary of the grid
+			int cx = (width-1)/2;									// corner x index
+			int cy = (height-1)/2;									// corner y index
+			const double grid_bound = (max(cx, cy) + 0.5) * a_step;	// boundary of the grid
 
-	// we set the limit of integration to the distance in which 1-1e-6 of the
-	// probability is included (and at least as big as the grid boundary)
-	const int far_away = max(inverse_cumulative_gamma(epsilon, 1-1e-6), grid_bound) / a_step;
+			// we set the limit of integration to the distance in which 1-1e-6 of the
+			// probability is included (and at least as big as the grid boundary)
+			const int far_away = max(inverse_cumulative_gamma(epsilon, 1-1e-6), grid_bound) / a_step;
 
-	if(debug) {
-		cerr << "integration epsilon: " << epsilon << "\n";
-		cerr << "far_away: " << far_away << "\n";
-		cerr << "grid_bound: " << grid_bound << "\n";
-	}
+			if(debug) {
+				cerr << "integration epsilon: " << epsilon << "\n";
+				cerr << "far_away: " << far_away << "\n";
+				cerr << "grid_bound: " << grid_bound << "\n";
+			}
 
-	int c = 0;
-	for(int i = 0; i <= cx; i++) {
-		for(int j = i; j <= cy; j++) {
-			// summation from (i,j) = (end_i, end_j)
-			int end_i = i == cx ? far_away : i;
-			int end_j = j == cy ? far_away : j;
-
-			// summation
-			eT prob(0);
-
-			for(int si = i; si <= end_i; si++)
-				for(int sj = j; sj <= end_j; sj++)
-					prob += std::exp( - epsilon * a_step * std::sqrt(si*si + sj*sj) );
-
-			c++;
-
-			// due to symmetry, the value is copied in up to 8 cells.
-			// a point (x,y) has index (cy+y, cx+x)
-			// i.e. the (-cx,-cy) corner has index (0,0)
-			m(cy+j,cx+i) =
-			m(cy+j,cx-i) =
-			m(cy-j,cx+i) =
-			m(cy-j,cx-i) = prob;
-
-			if(j <= cx && i <= cy)		// if width != height these might fall outside the grid
-				m(cy+i,cx+j) =
-				m(cy+i,cx-j) =
-				m(cy-i,cx+j) =
-				m(cy-i,cx-j) = prob;
-		}
-	}
-	m /= arma::accu(m);
+			extend(far_away + 2);
 
-	if(debug)
-		cerr << "summations " << c << "\n";
+			// sum of k over [i, end_i] x [j, end_j]
+			auto rect = [&](int i, int end_i, int j, int end_j) -> double {
+				return tail(j, i) - tail(j, end_i+1) - tail(end_j+1, i) + tail(end_j+1, end_i+1);
+			};
 
-	return m;
-}
+			// with O(1) per cell there is no need for the 8-fold symmetry (which only holds for square grids), each cell of
+			// the x, y >= 0 quadrant is copied to its 4 mirror images. A point (x,y) has index (cy+y, cx+x), i.e. the (-cx,-cy)
+			// corner has index (0,0)
+			//
+			parallel::for_each(cx + 1, [&](uint i) {
+				for(int j = 0; j <= cy; j++) {
+					// summation from (i,j) = (end_i, end_j)
+					int end_i = int(i) == cx ? far_away : i;
+					int end_j = j == cy ? far_away : j;
+
+					m(cy+j,cx+i) =
+					m(cy+j,cx-i) =
+					m(cy-j,cx+i) =
+					m(cy-j,cx-i) = eT(rect(i, end_i, j, end_j));
+				}
+			});
+			m /= arma::accu(m);
 
+			return m;
+		}
 
-template<typename eT>
-Chan<eT>
-planar_geometric_grid(uint width, uint height, eT step, eT epsilon) {
+		// planar_geometric_grid(width, height, step, epsilon) and its lazy version, from the kernel
+		channel::LazyChan<eT> grid_lazy(uint width, uint height) {
+			return channel::grid_kernel(summation(2*width-1, 2*height-1), width, height);
+		}
+		Chan<eT> grid(uint width, uint height) {
+			QIF_TRACE_SPAN("geo_ind::GeometricGridKernel::grid");
+			return grid_lazy(width, height).materialize();
+		}
 
-	int size = width * height;
+		// side of the current suffix-sum table (0 before the first summation)
+		uint table_size() const { return tail.n_rows; }
+
+	private:
+		// same trick changing step and epsilon. Not sure if it's really useful
+		static constexpr double a_step = 1;
+
+		eT epsilon;							// we _multiply_ epsilon by the same factor used to _divide_ step
+		arma::mat tail;
+
+		// Makes the table at least F x F. The suffix-sum table is T(i,j) = sum_{si >= i, sj >= j} k(si,sj) over
+		// [0, F-2]^2, T(i,j) being stored at tail(j,i), so that the per-i passes are contiguous. Suffix (rather than
+		// prefix) sums keep the small tail terms from being absorbed by the large ones near the origin.
+		//
+		void extend(uint F) {
+			if(tail.n_rows >= F)
+				return;
+			F = std::max<uint>(F, 2 * tail.n_rows);
+
+			const double eps_d = to_double(epsilon) * a_step;
+			tail.set_size(F, F);
+			parallel::for_each(F, [&](uint i) {
+				double* col = tail.colptr(i);
+				col[F-1] = 0;
+				for(uint j = F-1; j-- > 0; )
+					col[j] = (i == F-1 ? 0 : std::exp(-eps_d * std::sqrt(double(i)*i + double(j)*j))) + col[j+1];
+			});
+			for(uint i = F-1; i-- > 0; )
+				tail.col(i) += tail.col(i+1);
+
+			if(debug)
+				cerr << "suffix-sum table " << F << " x " << F << "\n";
+		}
+};
 
-	Chan<eT> C = arma::zeros<Mat<eT>>(size, size);
+template<typename eT>
+Mat<eT>
+grid_summation(uint width, uint height, eT step, eT epsilon) {
+	return GeometricGridKernel<eT>(step, epsilon).summation(width, height);
+}
 
-	int cx = width - 1;
-	int cy = height - 1;
 
+// Row-on-demand version of planar_geometric_grid, for grids too large to store the channel densely.
+//
+template<typename eT>
+channel::LazyChan<eT>
+planar_geometric_grid_lazy(uint width, uint height, eT step, eT epsilon) {
+	// the big matrix is a kernel giving the probability of each displacement, the channel is
+	// obtained by centering it at the input and folding the part outside the grid to the borders
 	Mat<eT> big_matrix = grid_summation(2*width-1, 2*height-1, step, epsilon);
+	return channel::grid_kernel(big_matrix, width, height);
+}
 
-	// we loop over the small grid, the current element is the chanel input
-	//
-	for(uint input_x = 0; input_x < width; input_x++) {
-		for(uint input_y = 0; input_y < height; input_y++) {
-			uint input = input_y * width + input_x;
-
-			// we put this element in the center of the big grid
-			// we loop over the big grid, and add this probability to
-			// the closest point in the small grid
-			//
-			for(int x = -cx; x <= cx; x++) {
-				uint output_x = bound(input_x + x, 0, width-1);
+template<typename eT>
+Chan<eT>
+planar_geometric_grid(uint width, uint height, eT step, eT epsilon) {
+	QIF_TRACE_SPAN("geo_ind::planar_geometric_grid");
+	return planar_geometric_grid_lazy(width, height, step, epsilon).materialize();
+}
 
-				for(int y = -cy; y <= cy; y++) {
-					uint output_y = bound(input_y + y, 0, height-1);
-					uint output = output_y * width + output_x;
+// Planar geometric over the leaves of a QuadTree. Noise from the planar geometric on the lattice of the smallest
+// leaves (step = size / 2^max_depth) is added to the center of leaf x, and the output is the leaf containing the
+// result. As in planar_geometric_grid, the part outside the tree's square is folded to the leaves on its border, so
+// with all leaves of the same size this is exactly planar_geometric_grid.
+//
+// The center of a leaf of more than one lattice cell is a lattice corner, so its offsets to the lattice cells are
+// half-integers. The kernel's mass over the lattice cells of a leaf is read in O(1) from one of two suffix-sum tables
+// (integer and half-integer offsets, built as in grid_summation), so the construction costs O(n^2 + F^2) for n leaves
+// and F x F tables, instead of O((W H)^2) for the uniform grid of the smallest leaves.
+//
+// F > 2^max_depth, so trees deeper than planar_geometric_quadtree_max_depth are rejected (the default 12 allows
+// 4096 x 4096 lattices, with tables of about 270MB).
+//
+inline uint planar_geometric_quadtree_max_depth = 12;
 
-					C(input, output) += big_matrix(cy+y, cx+x);
-				}
+template<typename eT>
+Chan<eT>
+planar_geometric_quadtree(const geo::QuadTree<eT>& T, eT epsilon) {
+	if(T.max_depth() > std::min(planar_geometric_quadtree_max_depth, 30u))
+		throw std::runtime_error("quadtree too deep for planar_geometric_quadtree (depth " + std::to_string(T.max_depth()) + ")");
+
+	const uint n = T.n_leaves();
+	const uint N = 1u << T.max_depth();							// lattice cells per side
+	const double step = to_double(T.size()) / N,
+				 eps_d = to_double(epsilon) * step;
+
+	// as in grid_summation, offsets up to far_away (which includes 1-1e-6 of the mass) are considered
+	const int far_away = int(max(inverse_cumulative_gamma(eps_d, 1-1e-6), N - 0.5));
+	const uint F = far_away + 2;
+
+	// tables[h]: suffix sums of k(i + h/2, j + h/2), the value for (i,j) stored at (j,i)
+	std::array<arma::mat, 2> tables;
+	parallel::for_each(2, [&](uint t) {
+		const double o = t * 0.5;
+		arma::mat& tail = tables[t];
+		tail.set_size(F, F);
+		for(uint i = 0; i < F; i++) {
+			double* col = tail.colptr(i);
+			col[F-1] = 0;
+			for(uint j = F-1; j-- > 0; ) {
+				double dx = i + o, dy = j + o;
+				col[j] = (i == F-1 ? 0 : std::exp(-eps_d * std::sqrt(dx*dx + dy*dy))) + col[j+1];
 			}
 		}
+		for(uint i = F-1; i-- > 0; )
+			tail.col(i) += tail.col(i+1);
+	});
+
+	// lattice coordinates of the leaves, first cell and number of cells per side
+	std::vector<int> lx(n), ly(n), ln(n);
+	for(uint k = 0; k < n; k++) {
+		auto& l = T.leaf(k);
+		lx[k] = int(std::lround((to_double(l.corner.x) - to_double(T.corner().x)) / step));
+		ly[k] = int(std::lround((to_double(l.corner.y) - to_double(T.corner().y)) / step));
+		ln[k] = int(std::lround(to_double(l.size) / step));
 	}
 
+	// The offsets m (i.e. m + 1/2 if half) in [m0, m1] of one dimension, as at most two ranges of table indexes
+	// (negative offsets are mirrored), restricted to [0, far_away]. Returns the number of ranges.
+	auto pieces = [&](int m0, int m1, bool half, std::array<std::pair<int,int>, 2>& res) -> uint {
+		uint c = 0;
+		auto add = [&](int lo, int hi) {
+			hi = std::min(hi, far_away);
+			if(lo <= hi)
+				res[c++] = { lo, hi };
+		};
+		if(m1 >= 0)
+			add(std::max(m0, 0), m1);
+		if(m0 <= -1) {
+			int neg_hi = std::min(m1, -1);		// m in [m0, neg_hi], mirrored to -m (or -m-1 if half)
+			if(half)
+				add(-neg_hi - 1, -m0 - 1);
+			else
+				add(-neg_hi, -m0);
+		}
+		return c;
+	};
+
+	Chan<eT> C(n, n);
+	parallel::for_each(n, [&](uint x) {
+		const bool half = ln[x] > 1;
+		const arma::mat& tail = tables[half];
+		const int bx = lx[x] + ln[x] / 2, by = ly[x] + ln[x] / 2;		// cell m = 0 (the one at offset 0 or +1/2)
+
+		auto rect = [&](int i, int end_i, int j, int end_j) -> double {
+			return tail(j, i) - tail(j, end_i+1) - tail(end_j+1, i) + tail(end_j+1, end_i+1);
+		};
+
+		std::array<std::pair<int,int>, 2> px, py;
+		Row<double> row(n);
+		for(uint y = 0; y < n; y++) {
+			// lattice cells of leaf y, the border ones extended up to far_away
+			int x0 = lx[y] - bx, x1 = lx[y] + ln[y] - 1 - bx,
+				y0 = ly[y] - by, y1 = ly[y] + ln[y] - 1 - by;
+			if(lx[y] == 0)				x0 = -far_away - 1;
+			if(lx[y] + ln[y] == int(N))	x1 =  far_away + 1;
+			if(ly[y] == 0)				y0 = -far_away - 1;
+			if(ly[y] + ln[y] == int(N))	y1 =  far_away + 1;
+
+			uint cx = pieces(x0, x1, half, px), cy = pieces(y0, y1, half, py);
+			double sum = 0;
+			for(uint a = 0; a < cx; a++)
+				for(uint b = 0; b < cy; b++)
+					sum += rect(px[a].first, px[a].second, py[b].first, py[b].second);
+			row(y) = sum;
+		}
+		row /= arma::accu(row);
+		for(uint y = 0; y < n; y++)
+			C(x, y) = eT(row(y));
+	});
+
 	return C;
 }
 
@@ -6,10 +6,42 @@ using std::max;
 const int integration_calls = 50000;		// how many times to call the function for each integration
 const bool debug = false;
 
-double planar_laplace_pdf(double *x, size_t, void *);
+double planar_laplace_pdf(double *x, size_t, void *params);
 double inverse_cumulative_gamma(double epsilon, double p);
 int bound(int val, int min_val, int max_val);
+
+// Reentrant context for integrating the planar laplace pdf over rectangles. Each context has its own rng, miser state
+// and quadrature workspaces, so different contexts can be used concurrently (a single context should not be shared
+// between threads).
+//
+// integrate uses MISER Monte-Carlo integration, while integrate_quadrature uses (deterministic) nested adaptive
+// Gauss-Kronrod quadrature, which is both faster and more accurate for the smooth planar laplace pdf.
+//
+class IntegrationContext {
+	public:
+		IntegrationContext();
+		IntegrationContext(unsigned long seed);
+		~IntegrationContext();
+
+		IntegrationContext(const IntegrationContext&) = delete;
+		IntegrationContext& operator=(const IntegrationContext&) = delete;
+
+		void set_seed(unsigned long seed);
+		double integrate(double epsilon, const arma::vec& a, const arma::vec& b, int calls = integration_calls);
+		double integrate_quadrature(double epsilon, const arma::vec& a, const arma::vec& b);
+
+	private:
+		// gsl_rng*, gsl_monte_miser_state* and gsl_integration_workspace*, kept opaque so that gsl's headers
+		// are only needed in the .cpp
+		void* rng;
+		void* state;
+		void* outer_ws;
+		void* inner_ws;
+};
+
+// integrates using a per-thread context, safe to call from multiple threads
 double integrate_laplace(double epsilon, const arma::vec& a, const arma::vec& b, int calls = integration_calls);
+double integrate_laplace_quadrature(double epsilon, const arma::vec& a, const arma::vec& b);
 
 
 // sample from a planar laplace centered at (0,0) (if origin is different, just add it to the result)
@@ -27,11 +59,114 @@ planar_laplace_sample(eT epsilon) {
 	return Point<eT>::from_polar(r, theta);
 }
 
+// Lambert W_{-1}(x) for x in [-1/e, 0), without calls to gsl and without branches, so that loops over it can be
+// vectorized: a series (close to -1/e) or asymptotic (close to 0) initial guess, refined by a fixed number of Halley
+// iterations. The relative error is ~1e-15, except very close to -1/e where W is ill-conditioned.
+//
+inline
+double lambert_wm1(double x) {
+	const double e = arma::Datum<double>::e;
+	double p = -std::sqrt(std::max(0.0, 2 * (1 + e * x))),
+		   w_series = -1 + p * (1 + p * (-1.0/3 + p * (11.0/72))),
+		   l1 = std::log(-x),
+		   l2 = std::log(-l1),
+		   w = x < -0.25 ? w_series : l1 - l2 + l2 / l1;
+
+	for(uint it = 0; it < 4; it++) {
+		double ew = std::exp(w),
+			   f = w * ew - x,
+			   den = ew * (w + 1) - (w + 2) * f / (2 * w + 2);
+		w -= f == 0 || den == 0 ? 0 : f / den;
+	}
+	return w;
+}
+
+// inverse_cumulative_gamma for many probabilities at once, via lambert_wm1
+//
+inline
+arma::vec inverse_cumulative_gamma(double epsilon, const arma::vec& p) {
+	arma::vec res(p.n_elem);
+	for(uint i = 0; i < p.n_elem; i++)
+		res(i) = -(lambert_wm1((p(i) - 1) / arma::Datum<double>::e) + 1) / epsilon;
+	return res;
+}
+
+namespace aux {
+
+const uint sample_block = 256;
+
+// n samples of the planar laplace centered at (0,0), generated in parallel from independent streams of seed.
+// Each block of sample_block points first draws all its uniforms, then computes radii and angles in a branch-free
+// loop, and passes the coordinates to emit(first, count, xs, ys).
+//
+template<typename F>
+void planar_laplace_blocks(double epsilon, size_t n, uint64_t seed, F emit) {
+	const double two_pi = 2 * arma::Datum<double>::pi, e = arma::Datum<double>::e;
+
+	rng::parallel_streams(n, seed, [&](rng::Engine& gen, size_t begin, size_t end) {
+		double u[sample_block], v[sample_block], xs[sample_block], ys[sample_block];
+
+		for(size_t first = begin; first < end; first += sample_block) {
+			uint count = std::min<size_t>(sample_block, end - first);
+			for(uint i = 0; i < count; i++) {
+				u[i] = rng::randu<double>(gen);
+				v[i] = rng::randu<double>(gen);
+			}
+			for(uint i = 0; i < count; i++) {
+				double r = -(lambert_wm1((v[i] - 1) / e) + 1) / epsilon,
+					   theta = u[i] * two_pi;
+				xs[i] = r * std::cos(theta);
+				ys[i] = r * std::sin(theta);
+			}
+			emit(first, count, xs, ys);
+		}
+	});
+}
+
+} // namespace aux
+
+// efficient batch sampling: n x 2 matrix, columns are the x and y coordinates (so each coordinate is contiguous)
+//
+template<typename eT = eT_def>
+Mat<eT>
+planar_laplace_sample(eT epsilon, uint n, uint64_t seed = rng::random_seed()) {
+	Mat<eT> res(n, 2);
+	eT* xs = res.colptr(0);
+	eT* ys = res.colptr(1);
+
+	aux::planar_laplace_blocks(to_double(epsilon), n, seed, [&](size_t first, uint count, const double* bx, const double* by) {
+		for(uint i = 0; i < count; i++) {
+			xs[first + i] = eT(bx[i]);
+			ys[first + i] = eT(by[i]);
+		}
+	});
+	return res;
+}
+
+// batch sampling snapped to a grid: the cells to_cell(origin + noise) (eg to_cell = geo::point_to_cell(...)),
+// computed in the same pass, without storing the points
+//
+template<typename eT = eT_def>
+Row<uint>
+planar_laplace_sample(eT epsilon, uint n, const std::function<uint(const Point<eT>&)>& to_cell, const Point<eT>& origin = Point<eT>(eT(0), eT(0)), uint64_t seed = rng::random_seed()) {
+	Row<uint> res(n);
+
+	aux::planar_laplace_blocks(to_double(epsilon), n, seed, [&](size_t first, uint count, const double* bx, const double* by) {
+		for(uint i = 0; i < count; i++)
+			res(first + i) = to_cell(Point<eT>(origin.x + eT(bx[i]), origin.y + eT(by[i])));
+	});
+	return res;
+}
+
+// Integrates the planar laplace pdf over every cell of a width x height grid centered at (0,0).
+// method is either "miser" (Monte-Carlo) or "quadrature" (deterministic Gauss-Kronrod).
+//
 template<typename eT>
 Mat<eT>
-grid_integration(uint width, uint height, eT step, eT epsilon) {
+grid_integration(uint width, uint height, eT step, eT epsilon, const std::string& method = "miser") {
 	if(width % 2 == 0 || height % 2 == 0) throw std::runtime_error("width/height must by odd");
 	if(width == 1 || height == 1) throw std::runtime_error("width/height must be > 1");
+	if(method != "miser" && method != "quadrature") throw std::runtime_error("invalid method: " + method);
 
 	// integration is in theory more accurate when the area of integration is small.
 	// In our case, we can simply scale down distances by adjusting epsilon
@@ -40,7 +175,7 @@ grid_integration(uint width, uint height, eT step, eT epsilon) {
 	// (Kostas: in practice I didn't see any difference, but still it seems a good idea to use a small step)
 	//
 	double a_step = 1;
-	epsilon *= step / a_step;								// we _multiply_ epsilon by the same factor used to _divide_ step. i.e. when a_step < step then epsilon is increased
+	const double a_epsilon = to_double(epsilon) * to_double(step) / a_step;	// we _multiply_ epsilon by the same factor used to _divide_ step. i.e. when a_step < step then epsilon is increased (in double, also for float)
 
 	Mat<eT> m = arma::zeros<Mat<eT>>(height, width);		// rows = height, cols = width,  point (x,y) has index (cy+y, cx+x)
 
@@ -50,48 +185,71 @@ grid_integration(uint width, uint height, eT step, eT epsilon) {
 
 	// we set the limit of integration to the distance in which 0.9999 of the
 	// probability is included (and at least as big as the grid boundary)
-	const double far_away = max(inverse_cumulative_gamma(epsilon, 0.9999), grid_bound);
+	const double far_away = max(inverse_cumulative_gamma(a_epsilon, 0.9999), grid_bound);
 
 	if(debug) {
-		cerr << "integration epsilon: " << epsilon << "\n";
+		cerr << "integration epsilon: " << a_epsilon << "\n";
 		cerr << "far_away: " << far_away << "\n";
 		cerr << "grid_bound: " << grid_bound << "\n";
 	}
 
-	int c = 0;
-	for(int i = 0; i <= cx; i++) {
-		for(int j = i; j <= cy; j++) {
-			// get integration rectangle
-			arma::vec a = {
-				(i - 0.5) * a_step,
-				(j - 0.5) * a_step
-			};
-			arma::vec b = {
-				i == cx ? far_away : a(0) + a_step,
-				j == cy ? far_away : a(1) + a_step,
-			};
-
-			// integrate. we use more calls when we go outside the grid boundary
-			bool out_of_bound = !less_than_or_eq(b(0), grid_bound) || !less_than_or_eq(b(1), grid_bound);
-			int calls = integration_calls * (out_of_bound ? 10 : 1);
-
-			eT prob = integrate_laplace(epsilon, a, b, calls);
-			c++;
-
-			// due to symmetry, the value is copied in up to 8 cells.
-			// a point (x,y) has index (cy+y, cx+x)
-			// i.e. the (-cx,-cy) corner has index (0,0)
-			m(cy+j,cx+i) =
-			m(cy+j,cx-i) =
-			m(cy-j,cx+i) =
-			m(cy-j,cx-i) = prob;
-
-			if(j <= cx && i <= cy)		// if width != height these might fall outside the grid
-				m(cy+i,cx+j) =
-				m(cy+i,cx-j) =
-				m(cy-i,cx+j) =
-				m(cy-i,cx-j) = prob;
+	// list of all (i,j) rectangles that need to be integrated, the rest are obtained by symmetry
+	std::vector<std::pair<int,int>> rects;
+	for(int i = 0; i <= cx; i++)
+		for(int j = i; j <= cy; j++)
+			rects.push_back({ i, j });
+
+	// integrate all rectangles in parallel. Each rectangle uses an rng seeded by its index, so the
+	// result does not depend on the number of threads or the order in which rectangles are processed.
+	//
+	std::vector<double> probs(rects.size());
+
+	parallel::for_each(rects.size(), [&](uint k) {
+		thread_local IntegrationContext ctx;
+		ctx.set_seed(k + 1);
+
+		auto [i, j] = rects[k];
+
+		// get integration rectangle
+		arma::vec a = {
+			(i - 0.5) * a_step,
+			(j - 0.5) * a_step
+		};
+		arma::vec b = {
+			i == cx ? far_away : a(0) + a_step,
+			j == cy ? far_away : a(1) + a_step,
+		};
+
+		if(method == "quadrature") {
+			probs[k] = ctx.integrate_quadrature(a_epsilon, a, b);
+			return;
 		}
+
+		// integrate. we use more calls when we go outside the grid boundary
+		bool out_of_bound = !less_than_or_eq(b(0), grid_bound) || !less_than_or_eq(b(1), grid_bound);
+		int calls = integration_calls * (out_of_bound ? 10 : 1);
+
+		probs[k] = ctx.integrate(a_epsilon, a, b, calls);
+	});
+
+	uint c = rects.size();
+	for(uint k = 0; k < c; k++) {
+		auto [i, j] = rects[k];
+		eT prob = probs[k];
+
+		// due to symmetry, the value is copied in up to 8 cells.
+		// a point (x,y) has index (cy+y, cx+x)
+		// i.e. the (-cx,-cy) corner has index (0,0)
+		m(cy+j,cx+i) =
+		m(cy+j,cx-i) =
+		m(cy-j,cx+i) =
+		m(cy-j,cx-i) = prob;
+
+		if(j <= cx && i <= cy)		// if width != height these might fall outside the grid
+			m(cy+i,cx+j) =
+			m(cy+i,cx-j) =
+			m(cy-i,cx+j) =
+			m(cy-i,cx-j) = prob;
 	}
 	if(debug)
 		cerr << "integrations " << c << "\n";
@@ -99,41 +257,177 @@ grid_integration(uint width, uint height, eT step, eT epsilon) {
 	return m;
 }
 
+// Row-on-demand version of planar_laplace_grid, for grids too large to store the channel densely.
+//
+template<typename eT>
+channel::LazyChan<eT>
+planar_laplace_grid_lazy(uint width, uint height, eT step, eT epsilon, const std::string& method = "miser") {
+	// the big matrix is a kernel giving the probability of each displacement, the channel is
+	// obtained by centering it at the input and folding the part outside the grid to the borders
+	Mat<eT> big_matrix = grid_integration(2*width-1, 2*height-1, step, epsilon, method);
+	return channel::grid_kernel(big_matrix, width, height);
+}
+
 template<typename eT>
 Chan<eT>
-planar_laplace_grid(uint width, uint height, eT step, eT epsilon) {
+planar_laplace_grid(uint width, uint height, eT step, eT epsilon, const std::string& method = "miser") {
+	QIF_TRACE_SPAN("geo_ind::planar_laplace_grid");
+	return planar_laplace_grid_lazy(width, height, step, epsilon, method).materialize();
+}
+
+// The kernel of planar_laplace_grid for a fixed (step, epsilon), reused across grid sizes (eg. in sweeps over the size).
+// The interior cells of the kernel are unit squares that do not depend on the size, so they are integrated once and
+// cached, a larger kernel only integrates its new interior cells. The border cells, integrated up to far_away (which
+// grows with the grid), are the only ones computed again for every size, so a sweep costs about as much as its
+// largest grid. integration(width, height) is the same as grid_integration (exactly, with the quadrature and a square
+// kernel), except that the miser rng of each cell is seeded by its position, so that its value does not
+// depend on the sizes requested before. A kernel should not be used by several threads at once.
+//
+template<typename eT>
+class LaplaceGridKernel {
+	public:
+		LaplaceGridKernel(eT step, eT epsilon, const std::string& method = "miser") : step(step), epsilon(epsilon), method(method) {
+			if(method != "miser" && method != "quadrature") throw std::runtime_error("invalid method: " + method);
+		}
+
+		Mat<eT> integration(uint width, uint height) {
+			if(width % 2 == 0 || height % 2 == 0) throw std::runtime_error("width/height must by odd");
+			if(width == 1 || height == 1) throw std::runtime_error("width/height must be > 1");
+
+			// as in grid_integration
+			const double a_step = 1;
+			const double a_epsilon = to_double(epsilon) * to_double(step) / a_step;
+			const int cx = (width-1)/2, cy = (height-1)/2;
+			const double grid_bound = (max(cx, cy) + 0.5) * a_step;
+			const double far_away = max(inverse_cumulative_gamma(a_epsilon, 0.9999), grid_bound);
+
+			// grow the cache, inner(p,q) (p <= q) is the unit cell (p,q), or NaN if not integrated yet
+			const uint n = max(cx, cy);
+			if(inner.n_rows < n) {
+				uint old = inner.n_rows;
+				inner.resize(n, n);
+				inner.cols(old, n-1).fill(arma::datum::nan);
+				if(old > 0)
+					inner.submat(old, 0, n-1, old-1).fill(arma::datum::nan);
+			}
 
-	int size = width * height;
+			// the rectangles to integrate: missing interior cells, then the border cells (i, cy) and (cx, j). Since the
+			// pdf is symmetric, (cx, j) is the same as (j, cy) for square kernels, it is only computed if cx != cy.
+			struct Task { int p, q; arma::vec a, b; unsigned long seed; bool border; };
+			std::vector<Task> tasks;
+			auto unit = [&](int i, int j) { return arma::vec { (i - 0.5) * a_step, (j - 0.5) * a_step }; };
+
+			for(int q = 0; q < int(n); q++)
+				for(int p = 0; p <= q; p++)
+					if((p < cx && q < cy) || (p < cy && q < cx))
+						if(std::isnan(inner(p, q)))
+							tasks.push_back({ p, q, unit(p, q), arma::vec(unit(p, q) + a_step), 1 + uint64_t(q) * (q+1) / 2 + p, false });
+
+			const uint first_border = tasks.size();
+			for(int i = 0; i <= cx; i++)				// (i, cy), including the corner
+				tasks.push_back({ i, cy, unit(i, cy), { i == cx ? far_away : (i + 0.5) * a_step, far_away }, (1ul << 31) + i, true });
+			if(cx != cy)
+				for(int j = 0; j < cy; j++)				// (cx, j)
+					tasks.push_back({ cx, j, unit(cx, j), { far_away, (j + 0.5) * a_step }, (1ul << 31) + cx + 1 + j, true });
+
+			parallel::for_each(tasks.size(), [&](uint k) {
+				thread_local IntegrationContext ctx;
+				Task& t = tasks[k];
+				double v;
+				if(method == "quadrature") {
+					v = ctx.integrate_quadrature(a_epsilon, t.a, t.b);
+				} else {
+					ctx.set_seed(t.seed);
+					v = ctx.integrate(a_epsilon, t.a, t.b, integration_calls * (t.border ? 10 : 1));
+				}
+				t.a(0) = v;				// result, a is no longer needed
+			});
+			n_done += tasks.size();
+
+			for(uint k = 0; k < first_border; k++)
+				inner(tasks[k].p, tasks[k].q) = tasks[k].a(0);
+
+			// border values, indexed by position along the border: border_y[i] is (i, cy), border_x[j] is (cx, j)
+			std::vector<double> border_y(cx + 1), border_x(cy);
+			for(uint k = first_border; k < tasks.size(); k++)
+				(tasks[k].q == cy ? border_y[tasks[k].p] : border_x[tasks[k].q]) = tasks[k].a(0);
+			if(cx == cy)
+				for(int j = 0; j < cy; j++)
+					border_x[j] = border_y[j];
+
+			// each cell of the x, y >= 0 quadrant is copied to its 4 mirror images, a point (x,y) has index (cy+y, cx+x)
+			Mat<eT> m(height, width);
+			for(int i = 0; i <= cx; i++)
+				for(int j = 0; j <= cy; j++) {
+					eT prob = eT(j == cy ? border_y[i] : i == cx ? border_x[j] : inner(std::min(i, j), std::max(i, j)));
+					m(cy+j,cx+i) =
+					m(cy+j,cx-i) =
+					m(cy-j,cx+i) =
+					m(cy-j,cx-i) = prob;
+				}
+			return m;
+		}
 
-	Chan<eT> C = arma::zeros<Mat<eT>>(size, size);
+		// planar_laplace_grid(width, height, step, epsilon, method) and its lazy version, from the kernel
+		channel::LazyChan<eT> grid_lazy(uint width, uint height) {
+			return channel::grid_kernel(integration(2*width-1, 2*height-1), width, height);
+		}
+		Chan<eT> grid(uint width, uint height) {
+			QIF_TRACE_SPAN("geo_ind::LaplaceGridKernel::grid");
+			return grid_lazy(width, height).materialize();
+		}
 
-	int cx = width - 1;
-	int cy = height - 1;
+		// number of rectangles integrated so far
+		size_t n_integrations() const { return n_done; }
 
-	Mat<eT> big_matrix = grid_integration(2*width-1, 2*height-1, step, epsilon);
+	private:
+		eT step, epsilon;
+		std::string method;
+		arma::mat inner;
+		size_t n_done = 0;
+};
 
-	// we loop over the small grid, the current element is the chanel input
-	//
-	for(uint input_x = 0; input_x < width; input_x++) {
-		for(uint input_y = 0; input_y < height; input_y++) {
-			uint input = input_y * width + input_x;
-
-			// we put this element in the center of the big grid
-			// we loop over the big grid, and add this probability to
-			// the closest point in the small grid
-			//
-			for(int x = -cx; x <= cx; x++) {
-				uint output_x = bound(input_x + x, 0, width-1);
-
-				for(int y = -cy; y <= cy; y++) {
-					uint output_y = bound(input_y + y, 0, height-1);
-					uint output = output_y * width + output_x;
-
-					C(input, output) += big_matrix(cy+y, cx+x);
-				}
-			}
+
+// Planar laplace over the leaves of a QuadTree: C(x,y) is the probability that the noise added to the center of leaf
+// x falls in leaf y, integrated over the leaf's square with the deterministic quadrature. As in planar_laplace_grid,
+// the part outside the tree's square is folded to the leaves on its border (their squares are extended up to a
+// distance that includes 1-1e-9 of the mass), and the rows are normalized to absorb the integration error. Costs n^2
+// integrations for n leaves.
+//
+template<typename eT>
+Chan<eT>
+planar_laplace_quadtree(const geo::QuadTree<eT>& T, eT epsilon) {
+	const uint n = T.n_leaves();
+	const double eps = to_double(epsilon),
+				 x0 = to_double(T.corner().x), y0 = to_double(T.corner().y),
+				 x1 = x0 + to_double(T.size()), y1 = y0 + to_double(T.size()),
+				 far_away = inverse_cumulative_gamma(eps, 1-1e-9) + to_double(T.size());
+
+	const double tol = 1e-9 * to_double(T.size());
+	auto on = [&](double v, double border) { return std::abs(v - border) <= tol; };
+
+	Chan<eT> C(n, n);
+	parallel::for_each(n, [&](uint x) {
+		const Point<eT> c = T.leaf(x).center();
+		const double cx = to_double(c.x), cy = to_double(c.y);
+
+		arma::vec a(2), b(2);
+		Row<double> row(n);
+		for(uint y = 0; y < n; y++) {
+			auto& l = T.leaf(y);
+			double lx0 = to_double(l.corner.x), ly0 = to_double(l.corner.y),
+				   lx1 = lx0 + to_double(l.size), ly1 = ly0 + to_double(l.size);
+
+			a(0) = (on(lx0, x0) ? x0 - far_away : lx0) - cx;
+			a(1) = (on(ly0, y0) ? y0 - far_away : ly0) - cy;
+			b(0) = (on(lx1, x1) ? x1 + far_away : lx1) - cx;
+			b(1) = (on(ly1, y1) ? y1 + far_away : ly1) - cy;
+			row(y) = integrate_laplace_quadrature(eps, a, b);
 		}
-	}
+		row /= arma::accu(row);
+		for(uint y = 0; y < n; y++)
+			C(x, y) = eT(row(y));
+	});
 
 	return C;
 }
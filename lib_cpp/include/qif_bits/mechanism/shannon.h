@@ -40,47 +40,138 @@ Chan<eT> max_entropy_given_same_loss(const Prob<eT>& pi, Prob<eT> out, Metric<eT
 	}
 }
 
-// TODO: clean this up. is it really faster? does it work?
+// A channel whose row x is non-zero only on the contiguous columns first(x), ..., first(x) + len(x) - 1, stored
+// row-by-row in val (row x starts at val(ptr(x)), ptr has n_rows+1 entries). Memory is O(n_rows * band).
+//
 template<typename eT>
-void max_entropy_for_same_loss_fast(const Prob<eT>& pi, Prob<eT>& out, Metric<eT,uint> loss, eT md = def_md<eT>, eT mrd = def_mrd<eT>) {
+class BandedChan {
+	public:
+		uint n_rows, n_cols;
+		arma::Col<uint> first, ptr;
+		Col<eT> val;
+
+		BandedChan(uint n_rows, uint n_cols) : n_rows(n_rows), n_cols(n_cols), first(n_rows), ptr(n_rows + 1) {}
+
+		inline uint len(uint x) const { return ptr(x+1) - ptr(x); }
+
+		inline eT operator()(uint x, uint y) const {
+			return y >= first(x) && y < first(x) + len(x) ? val(ptr(x) + y - first(x)) : eT(0);
+		}
+
+		// the value (pi C) of the output distribution
+		Prob<eT> output(const Prob<eT>& pi) const {
+			Prob<eT> out(n_cols, arma::fill::zeros);
+			for(uint x = 0; x < n_rows; x++)
+				for(uint k = 0, y = first(x); k < len(x); k++, y++)
+					out(y) += pi(x) * val(ptr(x) + k);
+			return out;
+		}
+
+		Chan<eT> to_chan() const {
+			Chan<eT> C(n_rows, n_cols, arma::fill::zeros);
+			for(uint x = 0; x < n_rows; x++)
+				for(uint k = 0; k < len(x); k++)
+					C(x, first(x) + k) = val(ptr(x) + k);
+			return C;
+		}
+
+		arma::SpMat<eT> to_sparse() const {
+			arma::umat loc(2, val.n_elem);
+			for(uint x = 0; x < n_rows; x++)
+				for(uint k = 0; k < len(x); k++) {
+					loc(0, ptr(x) + k) = x;
+					loc(1, ptr(x) + k) = first(x) + k;
+				}
+			return arma::SpMat<eT>(loc, val, n_rows, n_cols);
+		}
+};
+
+// Band-limited variant of max_entropy_given_same_loss, for losses that are "banded" as in 1D data (ages, locations on
+// a line, etc): each row loss(x, .) is assumed unimodal in y (non-increasing then non-decreasing), with the minimum
+// moving monotonically with x. Entries with loss(x,y) > min_y loss(x,y) + cutoff are treated as 0, the default cutoff
+// dropping all entries of the kernel exp(-loss) below machine precision (relative to the row's maximum).
+//
+// The band of each row is detected by walking from the minimum of the previous row, so loss is called O(n * band)
+// times (plus n_cols times for the first row), and the iteration uses O(n * band) memory and time per step, instead
+// of O(n_rows * n_cols). The result is returned as a BandedChan.
+//
+template<typename eT>
+BandedChan<eT> max_entropy_given_same_loss_banded(
+	const Prob<eT>& pi,
+	Prob<eT> out,
+	Metric<eT,uint> loss,
+	eT cutoff = -std::log(std::numeric_limits<eT>::epsilon()),
+	eT md = def_md<eT>,
+	eT mrd = def_mrd<eT>
+) {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
 
 	uint n_rows = pi.n_elem;
 	uint n_cols = out.n_elem;
-	// Mat<eT> C = mechanism::distance_matrix(n_rows, n_cols, dist);
-	uint window = 10;
-	Prob<eT> temp(2 * window + 1);
+	if(n_rows == 0 || n_cols == 0) throw std::runtime_error("empty input");
 
-	// uint cnt = 1;
-	// while(cnt < 1000) {
-		Prob<eT> new_out(n_cols);
-		new_out.fill(0);
+	// detect the bands, and store the kernel exp(-loss) scaled by its row maximum (the scaling cancels in the row
+	// normalization below).
+	//
+	BandedChan<eT> C(n_rows, n_cols);
+	std::vector<eT> kernel;
+	uint y0 = 0;
+	for(uint x = 0; x < n_rows; x++) {
+		// minimum of row x, a full scan for the first row, a local descent from the previous minimum afterwards
+		eT min_l = loss(x, y0);
+		if(x == 0) {
+			for(uint y = 1; y < n_cols; y++) {
+				eT l = loss(x, y);
+				if(l < min_l) { min_l = l; y0 = y; }
+			}
+		} else {
+			for(eT l; y0 + 1 < n_cols && (l = loss(x, y0 + 1)) <= min_l; y0++)
+				min_l = l;
+			for(eT l; y0 > 0 && (l = loss(x, y0 - 1)) < min_l; y0--)
+				min_l = l;
+		}
 
-		// row-by-row to avoid constructing a new channel each time
+		uint lo = y0, hi = y0;
+		while(lo > 0 && loss(x, lo - 1) - min_l <= cutoff) lo--;
+		while(hi + 1 < n_cols && loss(x, hi + 1) - min_l <= cutoff) hi++;
+
+		C.first(x) = lo;
+		C.ptr(x) = kernel.size();
+		for(uint y = lo; y <= hi; y++) {
+			eT expon = min_l - loss(x, y);
+			kernel.push_back(qif::exp(expon));
+		}
+	}
+	C.ptr(n_rows) = kernel.size();
+	const Col<eT> K(kernel);
+	C.val.set_size(K.n_elem);
+
+	// C(x,y) = K(x,y) out(y) / sum_y K(x,y) out(y)
+	auto update = [&]() {
 		for(uint x = 0; x < n_rows; x++) {
-			temp.fill(0);
-			uint z = 0;
-			for(uint y = (x > window ? x-window : 0); y < n_cols && y <= x + window; y++) {
-				temp(z++) = out(y) * qif::exp(-loss(x,y));
-				// if(cnt == 1)
-				// 	std::cout << x << ", " << y << ", " << out(y) << ", " << loss(x,y) << ", " << exp(-loss(x,y))  << "\n";
-			}
-			// if(cnt == 1) std::cout << temp << "\n";
-			temp /= arma::accu(temp);
-			z = 0;
-			for(uint y = (x > window ? x-window : 0); y < n_cols && y <= x + window; y++) {
-				new_out(y) += pi(x) * temp(z++);
-			}
+			uint p = C.ptr(x), f = C.first(x), l = C.len(x);
+			eT sum = 0;
+			for(uint k = 0; k < l; k++)
+				sum += C.val(p + k) = K(p + k) * out(f + k);
+			for(uint k = 0; k < l; k++)
+				C.val(p + k) /= sum;
 		}
-		// new_out /= arma::accu(new_out);
+	};
+
+	while(true) {
+		update();
+		Prob<eT> new_out = C.output(pi);
 
 		bool done = true;
-		for(uint y = 0; y < n_cols; y++)
-			done = done && equal(out(y), new_out(y), md, mrd);
+		for(uint y = 0; y < n_cols && done; y++)
+			done = equal(out(y), new_out(y), md, mrd);
 
 		out = new_out;
-		// cnt++; if(done) std::cout << cnt << " iterations\n";
-		if(done) return;
-	// }
+		if(done) {
+			update();
+			return C;
+		}
+	}
 }
 
 } // mechanism::shannon
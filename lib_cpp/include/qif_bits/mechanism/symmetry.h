@@ -0,0 +1,189 @@
+// Symmetry reduction of mechanism design programs
+//
+// A permutation s of the inputs such that pi(s(x)) = pi(x), d_priv(s(x), s(x')) = d_priv(x, x'),
+// loss(s(x), s(y)) = loss(x, y), (and similarly for the gain), acting on outputs and guesses as on inputs, maps
+// feasible channels to feasible channels with the same objective: C'(s(x), s(y)) = C(x, y). The program is convex, so
+// averaging an optimal solution over the group of such permutations gives an optimal solution that is invariant,
+// C(s(x), s(y)) = C(x, y). The program can thus be restricted to invariant channels, with one variable per orbit of
+// pairs (x,y) and one constraint per orbit of constraints, and the channel is expanded from the orbit
+// representatives afterwards. For a square grid with symmetric pi and metrics this is up to 8x fewer variables and
+// constraints.
+//
+// The mechanism builders take candidate permutations (eg. grid(width, height)), close them under composition (the
+// orbits are only meaningful for a group) and keep the ones that leave their program invariant, so passing any
+// permutations of the right size is safe.
+//
+
+namespace mechanism::symmetry {
+
+// The isometries of a width x height grid as permutations of the cells (cell i is (i % width, i / width), as in
+// metric::grid): the 8 symmetries of the square, or the 4 that map a rectangle to itself. The identity is first.
+//
+inline std::vector<std::vector<uint>> grid(uint width, uint height) {
+	std::vector<std::vector<uint>> res;
+	const bool square = width == height;
+
+	// (x,y) -> (sx x' , sy y') with x',y' possibly swapped (transposition only for squares)
+	for(int transpose = 0; transpose <= (square ? 1 : 0); transpose++)
+		for(int flip_x = 0; flip_x <= 1; flip_x++)
+			for(int flip_y = 0; flip_y <= 1; flip_y++) {
+				std::vector<uint> s(width * height);
+				for(uint i = 0; i < s.size(); i++) {
+					uint x = i % width, y = i / width;
+					if(transpose)
+						std::swap(x, y);
+					if(flip_x) x = width - 1 - x;
+					if(flip_y) y = height - 1 - y;
+					s[i] = y * width + x;
+				}
+				res.push_back(s);
+			}
+	return res;
+}
+
+// A group of permutations of {0, ..., n-1}, acting on the inputs, outputs and guesses of a program (which are then
+// in the same set, so n_cols == n_guesses == n). The orbit of an element/pair/triple is represented by its smallest
+// (lexicographically) member. The identity is always the first permutation, and it is never indexed, so the trivial
+// group works for any sizes.
+//
+// The group generated by the candidates is used (eg. the 90 degree rotation alone gives all 4 rotations), which is
+// required for the orbits to be correct. It should be small, more than max_size permutations throw.
+//
+class Group {
+	public:
+		std::vector<std::vector<uint>> perms;
+
+		static const uint max_size = 1024;
+
+		explicit Group(uint n = 0) : perms(1), n(n) {}
+
+		// the group generated by the given permutations (each of size n)
+		Group(uint n, const std::vector<std::vector<uint>>& candidates) : Group(n) {
+			std::vector<std::vector<uint>> gens;
+			for(auto& s : candidates) {
+				if(s.size() != n)
+					throw std::runtime_error("symmetry of the wrong size");
+				if(!is_permutation(s))
+					throw std::runtime_error("symmetry is not a permutation");
+				if(!is_identity(s))
+					gens.push_back(s);
+			}
+			if(gens.empty())
+				return;
+
+			// closure: every element times every generator, until nothing new appears (for finite groups this also
+			// gives the inverses)
+			perms[0].resize(n);
+			for(uint i = 0; i < n; i++)
+				perms[0][i] = i;
+			std::set<std::vector<uint>> seen { perms[0] };
+			std::vector<uint> c(n);
+			for(uint k = 0; k < perms.size(); k++) {
+				for(auto& g : gens) {
+					for(uint i = 0; i < n; i++)
+						c[i] = g[perms[k][i]];
+					if(seen.insert(c).second) {
+						if(perms.size() == max_size)
+							throw std::runtime_error("symmetry group too large");
+						perms.push_back(c);
+					}
+				}
+			}
+		}
+
+		uint size() const		{ return perms.size(); }
+		bool trivial() const	{ return perms.size() == 1; }
+
+		// Keeps only the permutations s (other than the identity) with pred(s). If pred is the invariance of some
+		// function, the permutations kept are still a group (if the candidates were).
+		template<typename P>
+		void restrict(P pred) {
+			perms.erase(std::remove_if(perms.begin() + 1, perms.end(), [&](const std::vector<uint>& s) { return !pred(s); }), perms.end());
+		}
+
+		uint rep(uint x) const {
+			uint r = x;
+			for(uint k = 1; k < perms.size(); k++)
+				r = std::min(r, perms[k][x]);
+			return r;
+		}
+
+		bool is_rep(uint x) const {
+			for(uint k = 1; k < perms.size(); k++)
+				if(perms[k][x] < x)
+					return false;
+			return true;
+		}
+		bool is_rep(uint x, uint y) const {
+			for(uint k = 1; k < perms.size(); k++) {
+				auto& s = perms[k];
+				if(std::pair(s[x], s[y]) < std::pair(x, y))
+					return false;
+			}
+			return true;
+		}
+		bool is_rep(uint x, uint x2, uint y) const {
+			for(uint k = 1; k < perms.size(); k++) {
+				auto& s = perms[k];
+				if(std::tuple(s[x], s[x2], s[y]) < std::tuple(x, x2, y))
+					return false;
+			}
+			return true;
+		}
+
+		// The orbit (0, 1, ...) of each pair (x,y), x < n_rows, y < n_cols, stored at x * n_cols + y, and the number
+		// of orbits. For the trivial group, the orbit of (x,y) is x * n_cols + y.
+		std::pair<std::vector<uint>, uint> pair_orbits(uint n_rows, uint n_cols) const {
+			std::vector<uint> orbit(size_t(n_rows) * n_cols);
+			uint n_orbits = 0;
+			for(uint x = 0; x < n_rows; x++)
+				for(uint y = 0; y < n_cols; y++) {
+					// the representative precedes (x,y), so its orbit is already known
+					uint rx = x, ry = y;
+					for(uint k = 1; k < perms.size(); k++) {
+						auto& s = perms[k];
+						if(std::pair(s[x], s[y]) < std::pair(rx, ry))
+							std::tie(rx, ry) = std::pair(s[x], s[y]);
+					}
+					orbit[size_t(x) * n_cols + y] = rx == x && ry == y ? n_orbits++ : orbit[size_t(rx) * n_cols + ry];
+				}
+			return { orbit, n_orbits };
+		}
+
+		// restrict to the permutations leaving pi and f(x,y) (x,y < n) invariant
+		template<typename eT, typename F>
+		void restrict_invariant(const Prob<eT>& pi, const F& f) {
+			restrict([&](const std::vector<uint>& s) {
+				for(uint x = 0; x < n; x++)
+					if(!equal(pi(s[x]), pi(x)))
+						return false;
+				for(uint x = 0; x < n; x++)
+					for(uint y = 0; y < n; y++)
+						if(!equal<eT>(f(s[x], s[y]), f(x, y)))
+							return false;
+				return true;
+			});
+		}
+
+	private:
+		uint n;
+
+		static bool is_permutation(const std::vector<uint>& s) {
+			std::vector<bool> hit(s.size(), false);
+			for(uint v : s) {
+				if(v >= s.size() || hit[v])
+					return false;
+				hit[v] = true;
+			}
+			return true;
+		}
+
+		static bool is_identity(const std::vector<uint>& s) {
+			for(uint i = 0; i < s.size(); i++)
+				if(s[i] != i)
+					return false;
+			return true;
+		}
+};
+
+} // namespace mechanism::symmetry
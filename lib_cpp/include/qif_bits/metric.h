@@ -192,21 +192,269 @@ from_distance_matrix(Mat<R>& M) {
 	};
 }
 
+// The n_rows x n_cols matrix of d(i, j). Symmetry is not assumed, unless symmetric is true, in which case (for square
+// matrices) d is only called for i <= j and the result mirrored. If parallel is true the columns are filled by the
+// threads of parallel::for_each, so d must be safe to call concurrently (this is not the default, since eg. python
+// functions are not).
+//
 template<typename R = R_def>
 Mat<R>
-to_distance_matrix(Metric<R, uint> d, uint n_rows, uint n_cols = 0) {
+to_distance_matrix(Metric<R, uint> d, uint n_rows, uint n_cols = 0, bool symmetric = false, bool parallel = false) {
 
 	if(n_cols == 0)
 		n_cols = n_rows;
+	symmetric = symmetric && n_rows == n_cols;
 	Mat<R> Dist(n_rows, n_cols);
 
-	for(uint i = 0; i < n_rows; i++)
+	auto fill_col = [&](uint j) {
+		R* col = Dist.colptr(j);
+		for(uint i = 0; i < (symmetric ? j + 1 : n_rows); i++)
+			col[i] = d(i, j);
+	};
+	if(parallel)
+		parallel::for_each(n_cols, fill_col);
+	else
+		for(uint j = 0; j < n_cols; j++)
+			fill_col(j);
+
+	if(symmetric)
 		for(uint j = 0; j < n_cols; j++)
-			Dist(i, j) = d(i, j);		// don't assume symmetry
+			for(uint i = 0; i < j; i++)
+				Dist(j, i) = Dist(i, j);
 
 	return Dist;
 }
 
+// Closed-form distance matrices of the built-in metrics on uint, computed with broadcast arithmetic over the indexes
+// (no call per cell): step * euclidean<R,uint>() (|i - j| step, which is also the manhattan distance on a line) and
+// discrete<R,uint>().
+//
+template<typename R = R_def>
+Mat<R>
+euclidean_matrix(uint n_rows, uint n_cols = 0, R step = R(1)) {
+	if(n_cols == 0)
+		n_cols = n_rows;
+
+	Col<R> pos(std::max(n_rows, n_cols));
+	for(uint i = 0; i < pos.n_elem; i++)
+		pos(i) = R(i) * step;
+	return arma::abs(arma::repmat(pos.head(n_rows), 1, n_cols) - arma::repmat(pos.head(n_cols).t(), n_rows, 1));
+}
+
+template<typename R = R_def>
+Mat<R>
+discrete_matrix(uint n_rows, uint n_cols = 0) {
+	if(n_cols == 0)
+		n_cols = n_rows;
+
+	Mat<R> Dist(n_rows, n_cols, arma::fill::ones);
+	Dist.diag().zeros();
+	return Dist;
+}
+
+
+template<typename R> class Kantorovich;
+
+// A metric on uint that caches the distance matrices produced by to_distance_matrix. Copies of a CachedMetric
+// share the same cache, so the matrix for each (n_rows, n_cols) is built once and then reused by all
+// copies (the metric's identity is the handle). The Metric overloads of g_vuln, l_risk and kantorovich_fastemd
+// have CachedMetric versions that use the cached matrix directly. It can also be used as a plain Metric<R,uint>.
+//
+// kantorovich(n) similarly caches the FastEMD engine for the n x n matrix (the matrix in FastEMD's form, and its
+// integer scaling for floats), used by kantorovich_fastemd.
+//
+// The cache is protected by a mutex, references returned by matrix() and kantorovich() remain valid while the handle
+// exists (and until clear()).
+// A CachedMetric can also be constructed from a precomputed square distance matrix D (eg. metric::graph), then
+// d(a, b) = D(a, b) and matrix(n) returns D itself.
+//
+template<typename R = R_def>
+class CachedMetric {
+	public:
+		explicit CachedMetric(Metric<R, uint> d) : state(std::make_shared<State>()) {
+			state->d = d;
+		}
+
+		explicit CachedMetric(Mat<R> D) : state(std::make_shared<State>()) {
+			auto base = std::make_shared<const Mat<R>>(std::move(D));
+			state->base = base;
+			state->d = [base](const uint& a, const uint& b) -> R { return (*base)(a, b); };
+		}
+
+		R operator()(const uint& a, const uint& b) const {
+			return state->d(a, b);
+		}
+
+		const Mat<R>& matrix(uint n_rows, uint n_cols = 0) const {
+			if(n_cols == 0)
+				n_cols = n_rows;
+
+			if(state->base && state->base->n_rows == n_rows && state->base->n_cols == n_cols)
+				return *state->base;
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+
+			auto it = state->cache.find({ n_rows, n_cols });
+			if(it == state->cache.end())
+				it = state->cache.emplace(std::make_pair(n_rows, n_cols), to_distance_matrix<R>(state->d, n_rows, n_cols)).first;
+			return it->second;
+		}
+
+		const Kantorovich<R>& kantorovich(uint n) const;
+
+		void clear() {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->cache.clear();
+			state->engines.clear();
+		}
+
+	private:
+		struct State {
+			Metric<R, uint> d;
+			std::shared_ptr<const Mat<R>> base;				// precomputed matrix, if any
+			std::mutex mutex;
+			std::map<std::pair<uint,uint>, Mat<R>> cache;		// std::map never moves its elements
+			std::map<uint, std::shared_ptr<const Kantorovich<R>>> engines;
+		};
+		std::shared_ptr<State> state;
+};
+
+template<typename R = R_def>
+CachedMetric<R>
+cached(Metric<R, uint> d) {
+	return CachedMetric<R>(d);
+}
+
+template<typename R = R_def>
+const Mat<R>&
+to_distance_matrix(const CachedMetric<R>& d, uint n_rows, uint n_cols = 0) {
+	return d.matrix(n_rows, n_cols);
+}
+
+
+// A translation-invariant metric on the cells of a width x height grid (cell i is (i%width, i/width), as in grid()):
+// d(a, b) = kernel(a_x - b_x, a_y - b_y). Gain/loss functions g(w,x) = f(d(w,x)) of a grid metric are also grid
+// metrics (see transform). It can be used as a plain Metric<R,uint>.
+//
+// For such functions the inner product of g_vuln/l_risk, sum_x g(w,x) J(x,y), is a 2D convolution of each column of
+// the joint with the kernel. The GridMetric overloads of g_vuln::{prior,posterior,strategy} and
+// l_risk::{prior,posterior,strategy} compute it by FFT (see GridConvolution) in O(n log n) per column, instead of
+// building the n x n distance matrix and spending O(n^2) per column.
+//
+template<typename R = R_def>
+class GridMetric {
+	public:
+		uint width, height;
+		std::function<R(int, int)> kernel;
+
+		GridMetric(uint width, uint height, std::function<R(int, int)> kernel) : width(width), height(height), kernel(kernel) {}
+
+		R operator()(const uint& a, const uint& b) const {
+			return kernel(int(a % width) - int(b % width), int(a / width) - int(b / width));
+		}
+
+		uint n_cells() const { return width * height; }
+
+		// the grid metric f(d(a, b))
+		GridMetric transform(std::function<R(R)> f) const {
+			auto k = kernel;
+			return GridMetric(width, height, [=](int dx, int dy) -> R { return f(k(dx, dy)); });
+		}
+};
+
+// euclidean/manhattan distance between the cells' centers, cells have size step x step
+template<typename R = R_def>
+GridMetric<R>
+grid_euclidean(uint width, uint height, R step = R(1)) {
+	return GridMetric<R>(width, height, [=](int dx, int dy) -> R {
+		return step * R(std::sqrt(double(dx) * dx + double(dy) * dy));
+	});
+}
+
+template<typename R = R_def>
+GridMetric<R>
+grid_manhattan(uint width, uint height, R step = R(1)) {
+	return GridMetric<R>(width, height, [=](int dx, int dy) -> R {
+		return step * R(std::abs(dx) + std::abs(dy));
+	});
+}
+
+// Since d is translation-invariant, the kernel is evaluated once per offset (about 4 n_cells calls, in the calling
+// thread), and the matrix is then filled in parallel from this table (closed form, for grid_euclidean/grid_manhattan).
+//
+template<typename R = R_def>
+Mat<R>
+to_distance_matrix(const GridMetric<R>& d, uint n_rows, uint n_cols = 0) {
+	if(n_cols == 0)
+		n_cols = n_rows;
+	if(n_rows > d.n_cells() || n_cols > d.n_cells())
+		return to_distance_matrix<R>(Metric<R, uint>(d), n_rows, n_cols);		// not only cells, no table
+
+	// K(dx + width-1, dy + height-1) = kernel(dx, dy)
+	const int w = d.width, h = d.height;
+	Mat<R> K(2*w - 1, 2*h - 1);
+	for(int dy = 1-h; dy < h; dy++)
+		for(int dx = 1-w; dx < w; dx++)
+			K(dx + w-1, dy + h-1) = d.kernel(dx, dy);
+
+	Mat<R> Dist(n_rows, n_cols);
+	parallel::for_each(n_cols, [&](uint j) {
+		int jx = j % w, jy = j / w;
+		R* col = Dist.colptr(j);
+		for(uint i = 0; i < n_rows; i++)
+			col[i] = K(int(i % w) - jx + w-1, int(i / w) - jy + h-1);
+	});
+	return Dist;
+}
+
+// Convolution with the kernel of a GridMetric d: apply(v, res) computes res(w) = sum_x d(w, x) v(x) for all cells w.
+// The kernel is zero-padded to (at least) (2 width - 1) x (2 height - 1), so the circular convolution computed by the
+// FFT equals the linear one on the grid, and its FFT is computed once in the constructor. The padded sizes are
+// products of 2, 3, 5 (fast FFT sizes). Computations are in double (apply is const, and safe to call concurrently if
+// armadillo doesn't use FFTW, whose planner is not thread-safe).
+//
+class GridConvolution {
+	public:
+		template<typename R>
+		explicit GridConvolution(const GridMetric<R>& d) : width(d.width), height(d.height) {
+			n1 = fast_size(2 * width - 1);
+			n2 = fast_size(2 * height - 1);
+
+			arma::mat k(n1, n2, arma::fill::zeros);
+			for(int dy = 1 - int(height); dy < int(height); dy++)
+				for(int dx = 1 - int(width); dx < int(width); dx++)
+					k((dx + n1) % n1, (dy + n2) % n2) = to_double(d.kernel(dx, dy));
+			K = arma::fft2(k);
+		}
+
+		// v, res: width*height elements (res can be the same as v)
+		void apply(const double* v, double* res) const {
+			const arma::mat V(const_cast<double*>(v), width, height, false, true);
+			arma::cx_mat F = arma::fft2(V, n1, n2);
+			F %= K;
+			const arma::mat conv = arma::real(arma::ifft2(F));
+
+			for(uint j = 0; j < height; j++)
+				for(uint i = 0; i < width; i++)
+					res[i + j * width] = conv(i, j);
+		}
+
+	private:
+		uint width, height, n1, n2;
+		arma::cx_mat K;		// FFT of the padded kernel
+
+		static uint fast_size(uint n) {
+			for(uint m = std::max(n, 1u); ; m++) {
+				uint r = m;
+				for(uint p : { 2u, 3u, 5u })
+					while(r % p == 0)
+						r /= p;
+				if(r == 1)
+					return m;
+			}
+		}
+};
+
 
 // Compose a metric on T2, and function f:T1->T2, into a metric on T1
 //
@@ -417,18 +665,504 @@ kantorovich_lp(Metric<R, uint> d) {
 	};
 }
 
+// The transportation problem between a and b with an m x n cost matrix C (not necessarily square or a metric) as a
+// linear program. Infinite costs are allowed: those cells get no variable, and the result is infinite if the mass
+// cannot be transported through the others. This is the fallback of kantorovich_simplex.
+//
+template<typename R>
+R transport_lp(const Mat<R>& C, const Prob<R>& a, const Prob<R>& b) {
+	if(C.n_rows != a.n_cols || C.n_cols != b.n_cols)
+		throw std::runtime_error("size mismatch");
+
+	lp::LinearProgram<R> lp;
+	lp.maximize = false;
+
+	std::vector<typename lp::LinearProgram<R>::Con> row_con(C.n_rows), col_con(C.n_cols);
+	for(uint i = 0; i < C.n_rows; i++)
+		row_con[i] = lp.make_con(a(i), a(i));
+	for(uint j = 0; j < C.n_cols; j++)
+		col_con[j] = lp.make_con(b(j), b(j));
+
+	for(uint j = 0; j < C.n_cols; j++)
+		for(uint i = 0; i < C.n_rows; i++) {
+			if(C(i, j) == infinity<R>())
+				continue;					// x_ij = 0
+			auto var = lp.make_var(R(0), infinity<R>());
+			lp.set_obj_coeff(var, C(i, j));
+			lp.set_con_coeff(row_con[i], var, R(1));
+			lp.set_con_coeff(col_con[j], var, R(1));
+		}
+
+	if(lp.solve())
+		return lp.objective();
+	if(lp.status == lp::Status::INFEASIBLE || lp.status == lp::Status::INFEASIBLE_OR_UNBOUNDED)	// costs are >= 0
+		return infinity<R>();
+	throw std::runtime_error("transportation program failed");
+}
+
+// Kantorovich engine, for computing many distances with the same ground metric d on {0, ..., n-1} via FastEMD.
+//
+// The distance matrix is built once in the constructor (so d is never called after that, nor from other threads),
+// and kept in the form required by FastEMD. For double and float it is also converted once to the scaled integer matrix
+// used internally by FastEMD (emd_hat_impl<double> converts the whole matrix on every call), the scaling being done in
+// double. distances() computes a batch
+// of distances in parallel.
+//
+// It assumes that d is a metric! R can be double, float or rat (see kantorovich_fastemd below).
+//
+template<typename R = R_def>
+class Kantorovich {
+	public:
+		typedef std::pair<Prob<R>, Prob<R>> ProbPair;
+
+		Kantorovich(Metric<R, uint> d, uint n) : Kantorovich(to_distance_matrix<R>(d, n)) {}
+		Kantorovich(const CachedMetric<R>& d, uint n) : Kantorovich(d.matrix(n)) {}
+		explicit Kantorovich(const Mat<R>& D);
+
+		uint n() const { return dist.size(); }
+
+		R operator()(const Prob<R>& a, const Prob<R>& b) const;
+		Col<R> distances(const std::vector<ProbPair>& pairs) const;
+
+	private:
+		typedef long long int Int;						// same as emd_hat_impl<double>
+		static constexpr double mult_factor = 1000000;	// same as emd_hat_impl<double>
+
+		std::vector<std::vector<R>> dist;
+		std::vector<std::vector<Int>> int_dist;			// dist * dist_factor, rounded (double/float only)
+		double max_dist = 0;
+		double dist_factor = 0;
+};
+
+template<typename R>
+Kantorovich<R>::Kantorovich(const Mat<R>& D) : dist(D.n_rows) {
+	if(D.n_rows != D.n_cols)
+		throw std::runtime_error("distance matrix should be square");
+
+	for(uint i = 0; i < D.n_rows; i++)
+		dist[i] = arma::conv_to<std::vector<R>>::from(D.row(i));
+
+	if constexpr (std::is_floating_point<R>::value) {
+		if(!D.empty())
+			max_dist = double(D.max());
+		if(max_dist > 0) {
+			dist_factor = mult_factor / max_dist;
+			int_dist.resize(D.n_rows);
+			for(uint i = 0; i < D.n_rows; i++) {
+				int_dist[i].resize(D.n_cols);
+				for(uint j = 0; j < D.n_cols; j++)
+					int_dist[i][j] = static_cast<Int>(std::floor(double(D(i, j)) * dist_factor + 0.5));
+			}
+		}
+	}
+}
+
+template<typename R>
+const Kantorovich<R>& CachedMetric<R>::kantorovich(uint n) const {
+	const Mat<R>& D = matrix(n);		// takes the lock itself
+
+	std::lock_guard<std::mutex> lock(state->mutex);
+	auto& engine = state->engines[n];
+	if(!engine)
+		engine = std::make_shared<const Kantorovich<R>>(D);
+	return *engine;
+}
+
+template<typename R>
+R Kantorovich<R>::operator()(const Prob<R>& a, const Prob<R>& b) const {
+	QIF_TRACE_SPAN("metric::kantorovich");
+	if(a.n_cols != n() || b.n_cols != n()) throw std::runtime_error("size mismatch");
+
+	if constexpr (std::is_floating_point<R>::value) {
+		// Same as emd_hat_gd_metric<double>, with the distances already converted
+		if(max_dist == 0)
+			return R(0);
+
+		double sum_a = 0, sum_b = 0;
+		for(uint i = 0; i < n(); i++) {
+			sum_a += a(i);
+			sum_b += b(i);
+		}
+		double max_sum = std::max(sum_a, sum_b),
+			   min_sum = std::min(sum_a, sum_b),
+			   prob_factor = mult_factor / max_sum;
+		auto to_int = [&](double v) { return static_cast<Int>(std::floor(v * prob_factor + 0.5)); };
+
+		// pre-flow the 0-cost edges (d is a metric)
+		std::vector<Int> ia(n()), ib(n()), ip(n()), iq(n());
+		for(uint i = 0; i < n(); i++) {
+			double ai = a(i), bi = b(i), m = std::min(ai, bi);
+			ia[i] = to_int(ai);
+			ib[i] = to_int(bi);
+			ip[i] = to_int(ai - m);
+			iq[i] = to_int(bi - m);
+		}
+
+		Int res = fastemd::emd_hat_impl<Int, fastemd::NO_FLOW>()(ia, ib, ip, iq, int_dist, 0, nullptr);
+		return R(res / prob_factor / dist_factor + (max_sum - min_sum) * max_dist);
+
+	} else {
+		auto a_v = arma::conv_to<std::vector<R>>::from(a);
+		auto b_v = arma::conv_to<std::vector<R>>::from(b);
+		return fastemd::emd_hat_gd_metric<R>()(a_v, b_v, dist);
+	}
+}
+
+template<typename R>
+Col<R> Kantorovich<R>::distances(const std::vector<ProbPair>& pairs) const {
+	Col<R> res(pairs.size());
+	parallel::for_each(pairs.size(), [&](uint i) {
+		res(i) = (*this)(pairs[i].first, pairs[i].second);
+	});
+	return res;
+}
+
+// Transportation simplex, for the Kantorovich distance between a distribution a on m points and b on n points,
+// given an m x n matrix C of non-negative costs (C does not need to be a metric, nor square). This is the network
+// simplex on the bipartite graph of the problem: the basis is a spanning tree of the m+n nodes (m+n-1 cells, some
+// possibly with zero flow), and each pivot computes the potentials on the tree, enters the cell of most negative
+// reduced cost and moves flow around the cycle that it closes. The initial basis is given by Vogel's approximation
+// (or the north-west corner rule if vogel = false, cheaper to build but usually needing many more pivots). Only the
+// supports of a and b take part in the problem.
+//
+// Infinite costs are allowed (the mass cannot be moved between the two points): such cells have the lexicographic cost
+// (1, 0) instead of (0, C(i,j)), so the simplex first minimises the mass moved through them, and the distance is
+// infinite if some mass remains there at the optimum.
+//
+// The buffers (costs, tree, potentials, paths) are kept between calls, so a single object can solve many problems
+// without allocating (one object per thread, solve() is not const). solve() returns false if max_iter pivots were not
+// enough (degenerate pivots can cycle under rounding), in which case the caller should fall back to the LP.
+//
+template<typename R = R_def>
+class TransportSimplex {
+	public:
+		uint max_iter = 0;		// 0 means 10 m n
+		bool vogel = true;
+
+		bool solve(const Mat<R>& C, const Prob<R>& a, const Prob<R>& b);
+		R objective() const { return obj; }
+
+	private:
+		struct Cell { uint i, j; R flow; };
+
+		uint m = 0, n = 0;							// size of the supports
+		Mat<R> cost;								// C on the supports, with 0 on infinite cells
+		std::vector<char> inf_cost;					// inf_cost[i + j*m]: C(i,j) is infinite
+		bool has_inf = false;
+		std::vector<R> ra, rb;						// masses on the supports
+
+		std::vector<Cell> basis;
+		std::vector<std::vector<uint>> adj;			// node => basic cells, rows are nodes 0..m-1, columns m..m+n-1
+		std::vector<R> pot, pot_inf;				// u_i for rows, v_j for columns, for the two parts of the costs
+		std::vector<uint> parent, stack, path;		// parent[v]: cell through which v was reached by traverse()
+		std::vector<char> seen;
+		R obj = R(0);
+
+		uint other(uint c, uint v) const { return v < m ? m + basis[c].j : basis[c].i; }
+		void add_cell(uint i, uint j, R flow);
+		void link(uint c);
+		void unlink(uint c);
+		void north_west();
+		void vogel_basis();
+		void traverse(uint root, uint target);
+		void potentials();
+};
+
+template<typename R>
+void TransportSimplex<R>::add_cell(uint i, uint j, R flow) {
+	basis.push_back({ i, j, std::max(R(0), flow) });
+	link(basis.size() - 1);
+}
+
+template<typename R>
+void TransportSimplex<R>::link(uint c) {
+	adj[basis[c].i].push_back(c);
+	adj[m + basis[c].j].push_back(c);
+}
+
+template<typename R>
+void TransportSimplex<R>::unlink(uint c) {
+	for(uint v : { basis[c].i, m + basis[c].j }) {
+		auto& l = adj[v];
+		l.erase(std::find(l.begin(), l.end(), c));
+	}
+}
+
+// each step exhausts a row or a column (never both, so that the m+n-1 cells form a tree)
+//
+template<typename R>
+void TransportSimplex<R>::north_west() {
+	R sa = ra[0], sb = rb[0];
+	for(uint i = 0, j = 0; ; ) {
+		R x = std::min(sa, sb);
+		add_cell(i, j, x);
+		sa -= x;
+		sb -= x;
+
+		if(i == m-1 && j == n-1)
+			break;
+		if(j == n-1 || (i < m-1 && sa <= sb))
+			sa = ra[++i];
+		else
+			sb = rb[++j];
+	}
+}
+
+// Vogel's approximation: repeatedly take the row or column with the largest difference between its two cheapest
+// remaining cells, fill its cheapest cell, and remove the row or the column (only one) that gets exhausted. Infinite
+// cells count as 1 + twice the largest finite cost. Each step costs O(m n).
+//
+template<typename R>
+void TransportSimplex<R>::vogel_basis() {
+	R big(0);
+	for(auto& c : cost)
+		if(c > big)
+			big = c;
+	big = 2 * big + 1;
+	auto key = [&](uint i, uint j) -> R { return inf_cost[i + j*m] ? big : cost(i, j); };
+
+	std::vector<R> sa(ra), sb(rb);
+	std::vector<char> row_done(m, 0), col_done(n, 0);
+	uint rows_left = m, cols_left = n;
+
+	while(rows_left > 1 && cols_left > 1) {
+		R best_pen = R(-1);
+		uint bi = 0, bj = 0;
+
+		// penalty of a line: difference of its two cheapest remaining cells, whose position is kept in (bi,bj)
+		auto scan = [&](uint len, auto done, auto cell) {
+			for(uint k = 0; k < len; k++) {
+				if(done(k))
+					continue;
+				R min1(0), min2(0);
+				uint arg = 0, cnt = 0;
+				cell(k, [&](uint i, uint j) {
+					R c = key(i, j);
+					if(cnt++ == 0 || c < min1) {
+						min2 = cnt == 1 ? c : min1;
+						min1 = c;
+						arg = i + j * m;
+					} else if(cnt == 2 || c < min2) {
+						min2 = c;
+					}
+				});
+				if(min2 - min1 > best_pen) {
+					best_pen = min2 - min1;
+					bi = arg % m;
+					bj = arg / m;
+				}
+			}
+		};
+		scan(m, [&](uint i) { return row_done[i]; }, [&](uint i, auto f) { for(uint j = 0; j < n; j++) if(!col_done[j]) f(i, j); });
+		scan(n, [&](uint j) { return col_done[j]; }, [&](uint j, auto f) { for(uint i = 0; i < m; i++) if(!row_done[i]) f(i, j); });
+
+		R x = std::min(sa[bi], sb[bj]);
+		add_cell(bi, bj, x);
+		sa[bi] -= x;
+		sb[bj] -= x;
+		if(sa[bi] <= sb[bj]) {
+			row_done[bi] = 1;
+			rows_left--;
+		} else {
+			col_done[bj] = 1;
+			cols_left--;
+		}
+	}
+
+	// a single row or column is left, it gets all the remaining mass
+	for(uint i = 0; i < m; i++)
+		for(uint j = 0; j < n; j++)
+			if(!row_done[i] && !col_done[j])
+				add_cell(i, j, rows_left == 1 ? sb[j] : sa[i]);
+}
+
+// depth-first traversal of the tree from root, setting parent[] for the nodes it reaches, until target is found
+//
+template<typename R>
+void TransportSimplex<R>::traverse(uint root, uint target) {
+	std::fill(seen.begin(), seen.end(), 0);
+	stack.clear();
+	stack.push_back(root);
+	seen[root] = 1;
+
+	while(!stack.empty()) {
+		uint v = stack.back();
+		stack.pop_back();
+		if(v == target)
+			return;
+
+		for(uint c : adj[v]) {
+			uint w = other(c, v);
+			if(!seen[w]) {
+				seen[w] = 1;
+				parent[w] = c;
+				stack.push_back(w);
+			}
+		}
+	}
+}
+
+// u_i + v_j = cost(i,j) on all basic cells (separately for the finite and infinite parts), with u_0 = 0. The traversal
+// visits each node after its parent.
+//
+template<typename R>
+void TransportSimplex<R>::potentials() {
+	std::fill(seen.begin(), seen.end(), 0);
+	stack.clear();
+	stack.push_back(0);
+	seen[0] = 1;
+	pot[0] = pot_inf[0] = R(0);
+
+	while(!stack.empty()) {
+		uint v = stack.back();
+		stack.pop_back();
+
+		for(uint c : adj[v]) {
+			uint w = other(c, v), i = basis[c].i, j = basis[c].j;
+			if(!seen[w]) {
+				seen[w] = 1;
+				pot[w] = cost(i, j) - pot[v];
+				pot_inf[w] = R(inf_cost[i + j*m]) - pot_inf[v];
+				stack.push_back(w);
+			}
+		}
+	}
+}
+
+template<typename R>
+bool TransportSimplex<R>::solve(const Mat<R>& C, const Prob<R>& a, const Prob<R>& b) {
+	QIF_TRACE_SPAN("metric::transport_simplex");
+	if(C.n_rows != a.n_cols || C.n_cols != b.n_cols)
+		throw std::runtime_error("size mismatch");
+
+	// restrict to the supports
+	std::vector<uint> rows, cols;
+	ra.clear();
+	rb.clear();
+	for(uint i = 0; i < a.n_cols; i++)
+		if(a(i) > R(0)) {
+			rows.push_back(i);
+			ra.push_back(a(i));
+		}
+	for(uint j = 0; j < b.n_cols; j++)
+		if(b(j) > R(0)) {
+			cols.push_back(j);
+			rb.push_back(b(j));
+		}
+
+	m = rows.size();
+	n = cols.size();
+	obj = R(0);
+	basis.clear();
+	if(m == 0 || n == 0)
+		return true;
+
+	cost.set_size(m, n);
+	inf_cost.assign(m * n, 0);
+	has_inf = false;
+	R tol(0);
+	for(uint j = 0; j < n; j++)
+		for(uint i = 0; i < m; i++) {
+			const R& c = C(rows[i], cols[j]);
+			if(c == infinity<R>()) {
+				cost(i, j) = R(0);
+				inf_cost[i + j*m] = 1;
+				has_inf = true;
+			} else {
+				cost(i, j) = c;
+				if(c > tol)
+					tol = c;
+			}
+		}
+	tol *= def_mrd<R>;		// entering cells need a reduced cost below -tol (0 for rat)
+
+	adj.resize(m + n);
+	for(auto& l : adj)
+		l.clear();
+	pot.resize(m + n);
+	pot_inf.resize(m + n);
+	parent.resize(m + n);
+	seen.resize(m + n);
+
+	if(vogel)
+		vogel_basis();
+	else
+		north_west();
+
+	uint limit = max_iter > 0 ? max_iter : 10 * m * n;
+	for(uint it = 0; ; it++) {
+		potentials();
+
+		// lexicographic (infinite part first) most negative reduced cost. The infinite parts are integers.
+		R best = -tol, best_inf(0);
+		uint ei = m, ej = 0;
+		for(uint j = 0; j < n; j++) {
+			const R v_j = pot[m + j], v_inf_j = pot_inf[m + j];
+			for(uint i = 0; i < m; i++) {
+				R r_inf = has_inf ? R(inf_cost[i + j*m]) - pot_inf[i] - v_inf_j : R(0);
+				if(r_inf > best_inf)
+					continue;
+				R r = cost(i, j) - pot[i] - v_j;
+				if(r_inf < best_inf || r < best) {
+					best_inf = r_inf;
+					best = r;
+					ei = i;
+					ej = j;
+				}
+			}
+		}
+		if(ei == m)
+			break;			// optimal
+		if(it == limit)
+			return false;
+
+		// The cycle closed by (ei,ej) is the tree path from column ej to row ei, its cells alternately lose
+		// (even positions) and gain flow. The leaving cell is the first losing one of minimum flow.
+		traverse(ei, m + ej);
+		path.clear();
+		for(uint v = m + ej; v != ei; v = other(parent[v], v))
+			path.push_back(parent[v]);
+
+		uint leave = path[0];
+		for(uint k = 2; k < path.size(); k += 2)
+			if(basis[path[k]].flow < basis[leave].flow)
+				leave = path[k];
+
+		R theta = basis[leave].flow;
+		for(uint k = 0; k < path.size(); k++) {
+			R& f = basis[path[k]].flow;
+			f = k % 2 ? f + theta : std::max(R(0), f - theta);
+		}
+
+		unlink(leave);
+		basis[leave] = { ei, ej, theta };
+		link(leave);
+	}
+
+	accum_t<R> sum(0);
+	for(auto& c : basis) {
+		if(inf_cost[c.i + c.j*m] && !equal(c.flow, R(0))) {
+			obj = infinity<R>();			// some mass cannot be moved
+			return true;
+		}
+		sum += accum_t<R>(c.flow) * accum_t<R>(cost(c.i, c.j));
+	}
+	obj = R(sum);
+	return true;
+}
+
 // kantorovich using the FastEMD algorithm from:
 // http://ofirpele.droppages.com//ICCV2009.pdf
 // https://dl.dropboxusercontent.com/s/i5g3a8tqsm2hcpl/FastEMD-3.1.zip?dl=0
 //
 // It assumes that d is a metric!
-// Only T = double is supported. (emd_hat_fb_metric works with: int, long int, long long int, double)
-//
-// TODO: the double implementation is via ints, see: emd_hat_impl<double,FLOW_TYPE> in emd_hat_impl.hpp.
-//       we could do the same to support float, rat
+// Supported types: double and float are computed via ints, see emd_hat_impl<double,FLOW_TYPE> in emd_hat_impl.hpp
+// (float is converted to double). rat runs the flow network directly in exact arithmetic (emd_hat_impl<rat> in <qif>).
 // 
 // (Note: an alternative algorithm: jorlin.scripts.mit.edu/docs/publications/26-faster strongly polynomial.pdf)
 //
+// Each call builds the distance matrix, use the Kantorovich engine above to compute many distances.
+//
 template<typename R = R_def, typename T>
 Metric<R, T>
 kantorovich_fastemd(Metric<R, uint> d) {
@@ -438,24 +1172,250 @@ kantorovich_fastemd(Metric<R, uint> d) {
 	return [d](const T& a, const T& b) -> R {
 		if(a.n_cols != b.n_cols) throw std::runtime_error("size mismatch");
 
-		typedef std::vector<R> vec;
+		return Kantorovich<R>(d, a.n_cols)(a, b);
+	};
+}
 
-		// create distance matrix
-		auto Dist = to_distance_matrix<R>(d, a.n_cols);
+// same, using the engine cached by d (the distance matrix is neither rebuilt nor converted on each call)
+//
+template<typename R = R_def, typename T>
+Metric<R, T>
+kantorovich_fastemd(const CachedMetric<R>& d) {
+	static_assert(is_Prob<T>::value, "only defined on probability distributions");
+	static_assert(std::is_same<R, typename T::elem_type>::value, "result and prob element type should be the same");
+
+	return [d](const T& a, const T& b) -> R {
+		if(a.n_cols != b.n_cols) throw std::runtime_error("size mismatch");
 
-		std::vector<vec> Dist_v( a.n_cols );
-		for(uint i = 0; i < a.n_cols; i++)
-			Dist_v[i] = arma::conv_to<vec>::from(Dist.row(i));
-		Dist.clear();
+		return d.kantorovich(a.n_cols)(a, b);
+	};
+}
+
+// kantorovich through the transportation simplex (see TransportSimplex), for any non-negative d (not necessarily a
+// metric), including infinite distances (the result is infinite if the mass cannot be transported). Falls back to the
+// LP (transport_lp, which also handles infinite distances) if the simplex does not converge.
+//
+template<typename R = R_def, typename T>
+Metric<R, T>
+kantorovich_simplex(Metric<R, uint> d) {
+	static_assert(is_Prob<T>::value, "only defined on probability distributions");
+	static_assert(std::is_same<R, typename T::elem_type>::value, "result and prob element type should be the same");
 
-		auto a_v = arma::conv_to<vec>::from(a);
-		auto b_v = arma::conv_to<vec>::from(b);
+	return [d](const T& a, const T& b) -> R {
+		if(a.n_cols != b.n_cols) throw std::runtime_error("size mismatch");
 
-		return fastemd::emd_hat_gd_metric<R>()(a_v, b_v, Dist_v);
+		thread_local TransportSimplex<R> simplex;
+		Mat<R> D = to_distance_matrix<R>(d, a.n_cols);
+		return simplex.solve(D, a, b)
+			? simplex.objective()
+			: transport_lp<R>(D, a, b);
 	};
 }
 
-//  kantorovich. use FastEMD for doubles, LP for all others
+// same, using the cached distance matrix of d
+//
+template<typename R = R_def, typename T>
+Metric<R, T>
+kantorovich_simplex(const CachedMetric<R>& d) {
+	static_assert(is_Prob<T>::value, "only defined on probability distributions");
+	static_assert(std::is_same<R, typename T::elem_type>::value, "result and prob element type should be the same");
+
+	return [d](const T& a, const T& b) -> R {
+		if(a.n_cols != b.n_cols) throw std::runtime_error("size mismatch");
+
+		thread_local TransportSimplex<R> simplex;
+		return simplex.solve(d.matrix(a.n_cols), a, b)
+			? simplex.objective()
+			: transport_lp<R>(d.matrix(a.n_cols), a, b);
+	};
+}
+
+// Entropic-regularised approximation of the Kantorovich distance (Sinkhorn's algorithm), for supports too large for
+// FastEMD or the LP. Only for floating types, and d does not need to be a metric. See:
+// Cuturi, Sinkhorn Distances: Lightspeed Computation of Optimal Transport, NIPS 2013
+// Altschuler et al, Near-linear time approximation algorithms for optimal transport via Sinkhorn iteration, NIPS 2017
+//
+// Sinkhorn's iterations only give an approximation, so bounds() returns a certified interval [lower, upper] for each
+// distance: upper is the cost of a feasible transport plan (the Sinkhorn plan, rounded to the exact marginals as in
+// Altschuler et al), and lower the value of a feasible dual solution (the Sinkhorn potentials, made feasible by a
+// c-transform). The gap shrinks with reg.
+//
+// The distances of many pairs are computed together: the scaling vectors of all pairs are the columns of two
+// matrices, so each iteration is a single matrix product with the kernel (one BLAS GEMM, vectorised and offloadable).
+// With log_domain, the iterations are done on the potentials with log-sum-exp (slower, but stable for small reg).
+//
+template<typename R = R_def>
+class Sinkhorn {
+	static_assert(std::is_floating_point<R>::value, "only defined for floating types");
+
+	public:
+		R reg = R(1e-2);			// regulariser, relative to the largest distance
+		R tol = R(1e-6);			// stop when the marginals are matched within tol (l1 error)
+		uint max_iter = 10000;
+		bool log_domain = false;
+
+		Sinkhorn(Metric<R, uint> d, uint n) : Sinkhorn(to_distance_matrix<R>(d, n)) {}
+		Sinkhorn(const CachedMetric<R>& d, uint n) : Sinkhorn(d.matrix(n)) {}
+		explicit Sinkhorn(const Mat<R>& C) : C(C) {}
+
+		// bounds on the distances between a = A.row(i) and b = B.row(i), for each i
+		std::pair<Col<R>,Col<R>> bounds(const Mat<R>& A, const Mat<R>& B) const;
+
+		// upper bound on the distance (the cost of a feasible plan)
+		R operator()(const Prob<R>& a, const Prob<R>& b) const {
+			return bounds(a, b).second(0);
+		}
+
+	private:
+		Mat<R> C;
+
+		void scale(const Mat<R>& A, const Mat<R>& B, R eps, Mat<R>& F, Mat<R>& G) const;
+		void scale_log(const Mat<R>& A, const Mat<R>& B, R eps, Mat<R>& F, Mat<R>& G) const;
+
+		// P(x,y) = exp((f_x + g_y - C(x,y)) / eps)
+		Mat<R> plan(const Col<R>& f, const Col<R>& g, R eps) const {
+			Mat<R> P = C.each_col() - f;
+			P.each_row() -= g.t();
+			return arma::exp(P * (-1 / eps));
+		}
+};
+
+// Computes the potentials F (n_rows x k), G (n_cols x k) for all pairs, in the kernel domain. The scalings are
+// u = exp(F/eps), v = exp(G/eps), and the Sinkhorn plan for pair i is diag(u_i) K diag(v_i), with K = exp(-C/eps).
+//
+template<typename R>
+void Sinkhorn<R>::scale(const Mat<R>& A, const Mat<R>& B, R eps, Mat<R>& F, Mat<R>& G) const {
+	Mat<R> K = arma::exp(-C / eps);
+	Mat<R> a = A.t(), b = B.t();		// marginals as columns
+	Mat<R> U(C.n_rows, A.n_rows, arma::fill::ones), V(C.n_cols, A.n_rows, arma::fill::ones);
+
+	for(uint it = 0; it < max_iter; it++) {
+		U = a / (K * V);
+		V = b / (K.t() * U);
+
+		// after updating V the column marginals are exact, check the rows
+		Mat<R> err = arma::abs(U % (K * V) - a);
+		if(err.has_nan() || arma::max(arma::sum(err, 0)) <= tol)
+			break;
+	}
+
+	F = eps * arma::log(U);
+	G = eps * arma::log(V);
+}
+
+// Same in the log domain, F(x,i) = -eps log sum_y exp((G(y,i) - C(x,y)) / eps) + eps log a_x(i), and similarly for G
+//
+template<typename R>
+void Sinkhorn<R>::scale_log(const Mat<R>& A, const Mat<R>& B, R eps, Mat<R>& F, Mat<R>& G) const {
+	Mat<R> log_a = arma::log(A.t()), log_b = arma::log(B.t());
+	Mat<R> Ct = C.t();
+	F.zeros(C.n_rows, A.n_rows);
+	G.zeros(C.n_cols, A.n_rows);
+
+	// softmin_y (D(x,y) - g_y) for each x, with the max subtracted so that exp doesn't overflow
+	auto softmin = [&](const Mat<R>& D, const Col<R>& g) -> Col<R> {
+		Mat<R> M = D.each_row() - g.t();
+		M *= -1 / eps;
+		Col<R> m = arma::max(M, 1);
+		Col<R> res = -eps * (m + arma::log(arma::sum(arma::exp(M.each_col() - m), 1)));
+		res.elem(arma::find_nonfinite(m)).fill(infinity<R>());		// no finite term
+		return res;
+	};
+
+	for(uint it = 0; it < max_iter; it++) {
+		R err(0);
+		for(uint i = 0; i < A.n_rows; i++) {
+			F.col(i) = softmin(C,  G.col(i)) + eps * log_a.col(i);
+			G.col(i) = softmin(Ct, F.col(i)) + eps * log_b.col(i);
+
+			// after updating G the column marginals are exact, check the rows
+			err = std::max(err, R(arma::accu(arma::abs(arma::sum(plan(F.col(i), G.col(i), eps), 1) - A.row(i).t()))));
+		}
+		if(err <= tol)
+			break;
+	}
+}
+
+template<typename R>
+std::pair<Col<R>,Col<R>> Sinkhorn<R>::bounds(const Mat<R>& A, const Mat<R>& B) const {
+	QIF_TRACE_SPAN("metric::sinkhorn");
+	if(A.n_rows != B.n_rows || A.n_cols != C.n_rows || B.n_cols != C.n_cols)
+		throw std::runtime_error("size mismatch");
+
+	uint k = A.n_rows;
+	Col<R> lower(k, arma::fill::zeros), upper(k, arma::fill::zeros);
+
+	R max_C = C.empty() ? R(0) : C.max();
+	if(max_C <= R(0))
+		return { lower, upper };
+
+	R eps = reg * max_C;
+	Mat<R> F, G;
+	if(log_domain)
+		scale_log(A, B, eps, F, G);
+	else
+		scale(A, B, eps, F, G);
+
+	parallel::for_each(k, [&](uint i) {
+		Row<R> a = A.row(i), b = B.row(i);
+		Col<R> f = F.col(i), g = G.col(i);
+
+		// plan, rounded to the exact marginals (Altschuler et al, Algorithm 2). The plan is computed from the
+		// potentials, entries out of the support have -inf potential, they get 0 mass.
+		Mat<R> P = plan(f, g, eps);
+		P.elem(arma::find_nonfinite(P)).zeros();
+
+		Col<R> x = a.t() / arma::sum(P, 1);
+		x.elem(arma::find_nonfinite(x)).ones();
+		P.each_col() %= arma::clamp(x, R(0), R(1));
+
+		Row<R> y = b / arma::sum(P, 0);
+		y.elem(arma::find_nonfinite(y)).ones();
+		P.each_row() %= arma::clamp(y, R(0), R(1));
+
+		Col<R> err_a = a.t() - arma::sum(P, 1);
+		Row<R> err_b = b - arma::sum(P, 0);
+		R err_norm = arma::accu(arma::abs(err_a));
+		if(err_norm > R(0))
+			P += err_a * err_b / err_norm;
+
+		upper(i) = arma::accu(P % C);
+
+		// feasible dual: keep f on the support of a, and set g to its c-transform, g_y = min_x C(x,y) - f_x
+		arma::uvec supp = arma::find(a > R(0));
+		Col<R> f_supp = f.elem(supp);
+		if(supp.empty() || !f_supp.is_finite())
+			return;		// no lower bound better than 0
+		Mat<R> C_supp = C.rows(supp);
+		Row<R> g_feas = arma::min(C_supp.each_col() - f_supp, 0);
+		R dual = arma::dot(Col<R>(a.elem(supp)), f_supp) + arma::dot(b, g_feas);
+		lower(i) = std::max(R(0), std::min(dual, upper(i)));
+	});
+
+	return { lower, upper };
+}
+
+// kantorovich through Sinkhorn's algorithm, returns the upper bound of the certified interval (see Sinkhorn)
+//
+template<typename R = R_def, typename T>
+Metric<R, T>
+kantorovich_sinkhorn(Metric<R, uint> d, R reg = R(1e-2), R tol = R(1e-6), bool log_domain = false) {
+	static_assert(is_Prob<T>::value, "only defined on probability distributions");
+	static_assert(std::is_same<R, typename T::elem_type>::value, "result and prob element type should be the same");
+
+	return [d, reg, tol, log_domain](const T& a, const T& b) -> R {
+		if(a.n_cols != b.n_cols) throw std::runtime_error("size mismatch");
+
+		Sinkhorn<R> sink(d, a.n_cols);
+		sink.reg = reg;
+		sink.tol = tol;
+		sink.log_domain = log_domain;
+		return sink(a, b);
+	};
+}
+
+//  kantorovich. use the transportation simplex when the distributions have the same element type as the metric (d
+//  does not need to be a metric, see kantorovich_fastemd and the Kantorovich engine for metrics), LP for all others
 //
 template<typename R = R_def, typename T>
 inline
@@ -463,89 +1423,200 @@ Metric<R, T>
 kantorovich(Metric<R, uint> d) {
 	static_assert(is_Prob<T>::value, "only defined on probability distributions");
 
-	if constexpr (std::is_same<T, prob>::value) {
-		return kantorovich_fastemd<double, prob>(d);
+	if constexpr (std::is_same<T, Prob<R>>::value) {
+		return kantorovich_simplex<R, T>(d);
 
 	} else {
 		return kantorovich_lp<R, T>(d);
 	}
 }
 
-// multiplicative kantorovich through linear programming
-//
 template<typename R = R_def, typename T>
+inline
 Metric<R, T>
-mult_kantorovich(Metric<R, uint> d) {
+kantorovich(const CachedMetric<R>& d) {
 	static_assert(is_Prob<T>::value, "only defined on probability distributions");
 
-	// we need to solve 2 linear programs, with the role of a, b exchanged. one_side solves one of them.
-	//
-	auto one_side = [d](const T& a, const T& b) -> R {
-		static_assert(std::is_same<R, typename T::elem_type>::value, "result and prob element type should be the same");
+	if constexpr (std::is_same<T, Prob<R>>::value) {
+		return kantorovich_simplex<R, T>(d);
 
-		uint n = a.n_cols;
-		if(n != b.n_cols) throw std::runtime_error("size mismatch");
+	} else {
+		return kantorovich_lp<R, T>(d);
+	}
+}
 
-		// linear program for the transportation problem
-		// vars:     x_ij, r_i, z >= 0    forall i,j
-		// minimize  z
-		// s.t.      sum_j x_ij             - r_i           = a[i]  forall i
-		//           sum_i x_ij exp(d(i,j)) - r_j - b[j] z <= 0     forall j
-		//
-		lp::LinearProgram<R> lp;
+// Multiplicative Kantorovich engine, for computing many distances with the same ground metric d on {0, ..., n-1}.
+//
+// Each side of the distance (see mult_kantorovich below) is a generalised flow problem, min z s.t. a can be moved to
+// b*z with the flow on (i,j) multiplied by exp(d(i,j)). Its dual is a much smaller program over the "exp-Lipschitz"
+// cone C = { v >= 0 : v_i <= exp(d(i,j)) v_j }, namely z = max { a.v / b.v : v in C }, and both sides share the same
+// cone (only a and b are exchanged). The engine computes the exp-cost matrix once, keeps only the cone constraints
+// that are not implied by the triangle inequality through a third element (for a metric on a line, only the n-1
+// pairs of neighbours are kept), and solves the ratio problem by Dinkelbach's iterations, max (a - z b).v over
+// C n { sum v <= 1 }, where only the objective changes. The programs of the two sides are kept between calls and
+// warm-started, so repeated calls only take a few simplex pivots; the two sides are solved concurrently.
+//
+// Infinite distances (some mass of a cannot reach the support of b through finite distances) are detected directly.
+// The object is not thread-safe (one engine per thread). Only for floating types.
+//
+template<typename R = R_def>
+class MultKantorovich {
+	static_assert(std::is_floating_point<R>::value, "only defined for floating types");
 
-		auto vars_x = lp.make_vars(n, n, R(0), infinity<R>());
-		auto vars_r = lp.make_vars(n, R(0), infinity<R>());
-		auto var_z = lp.make_var(0, infinity<R>());
+	public:
+		uint max_iter = 100;		// Dinkelbach iterations per side
 
-		lp.maximize = false;
-		lp.set_obj_coeff(var_z, 1);
+		MultKantorovich(Metric<R, uint> d, uint n) : MultKantorovich(to_distance_matrix<R>(d, n)) {}
+		MultKantorovich(const CachedMetric<R>& d, uint n) : MultKantorovich(d.matrix(n)) {}
+		explicit MultKantorovich(const Mat<R>& D);
 
-		// s.t.      sum_j x_ij             - r_i           = a[i]  forall i
-		for(uint i = 0; i < n; i++) {
-			auto con = lp.make_con(a[i], a[i]);
+		uint n() const { return W.n_rows; }
 
-			lp.set_con_coeff(con, vars_r[i], -1);
+		R operator()(const Prob<R>& a, const Prob<R>& b);
 
-			for(uint j = 0; j < n; j++) {
-				// when m(i,j) == inf, it forces the x_ij variable to be 0. We capture the same effect
-				// by leaving the coefficients of x_ij to be 0. So all (in)equalities behave as if x_ij was fixed to 0.
-				R dist = d(i, j);
-				if(!equal(dist, infinity<R>()))
-					lp.set_con_coeff(con, vars_x[i][j], 1);
-			}
-		}
+	private:
+		Mat<R> W;											// exp(D)
+		std::vector<std::vector<uint>> pred;				// pred[j]: i such that v_i <= W(i,j) v_j is kept
+		lp::LinearProgram<R> lps[2];						// one per side, same constraints
+		std::vector<typename lp::LinearProgram<R>::Var> vars[2];
 
-		//           sum_i x_ij exp(d(i,j)) - r_j - b[j] z <= 0     forall j
+		R side(uint s, const Prob<R>& a, const Prob<R>& b);
+};
+
+template<typename R>
+MultKantorovich<R>::MultKantorovich(const Mat<R>& D) : pred(D.n_rows) {
+	if(D.n_rows != D.n_cols)
+		throw std::runtime_error("distance matrix should be square");
+
+	uint n = D.n_rows;
+	W = arma::exp(D);
+
+	// (i,j) is implied by (i,k), (k,j) if d(i,k) + d(k,j) <= d(i,j) with both positive (so both are strictly smaller
+	// than d(i,j), and by induction implied by kept constraints themselves)
+	std::vector<std::vector<char>> keep(n, std::vector<char>(n, 0));
+	parallel::for_each(n, [&](uint i) {
 		for(uint j = 0; j < n; j++) {
-			auto con = lp.make_con(-infinity<R>(), 0);
+			if(i == j || !std::isfinite(W(i, j)))
+				continue;
+			bool implied = false;
+			for(uint k = 0; k < n && !implied; k++)
+				implied = k != i && k != j && D(i, k) > R(0) && D(k, j) > R(0) && D(i, k) + D(k, j) <= D(i, j);
+			keep[i][j] = !implied;
+		}
+	});
+	for(uint i = 0; i < n; i++)
+		for(uint j = 0; j < n; j++)
+			if(keep[i][j])
+				pred[j].push_back(i);
 
-			lp.set_con_coeff(con, vars_r[j], -1);
-			lp.set_con_coeff(con, var_z, - b[j]);
+	// max (a - z b).v  s.t.  v_i - W(i,j) v_j <= 0 for the kept (i,j),  sum_i v_i <= 1,  v >= 0
+	for(uint s = 0; s < 2; s++) {
+		auto& lp = lps[s];
+		lp.maximize = true;
+		lp.warm_start = true;
+		vars[s] = lp.make_vars(n, R(0), infinity<R>());
 
-			for(uint i = 0; i < n; i++) {
-				// ignore inf again, see comment above
-				R dist = d(i, j);
-				if(!equal(dist, infinity<R>()))
-					lp.set_con_coeff(con, vars_x[i][j], std::exp(dist));
+		for(uint j = 0; j < n; j++) {
+			for(uint i : pred[j]) {
+				auto con = lp.make_con(-infinity<R>(), R(0));
+				lp.set_con_coeff(con, vars[s][i], R(1));
+				lp.set_con_coeff(con, vars[s][j], -W(i, j));
 			}
 		}
+		auto con = lp.make_con(-infinity<R>(), R(1));
+		for(uint i = 0; i < n; i++)
+			lp.set_con_coeff(con, vars[s][i], R(1));
+	}
+}
 
-		// an infeasible problem means that there's no finite z to satisfy it, so the distance is infinite
-		return lp.solve()
-			? std::log(lp.objective())
-			: infinity<R>();
-	};
+// log max { a.v / b.v : v in C }
+//
+template<typename R>
+R MultKantorovich<R>::side(uint s, const Prob<R>& a, const Prob<R>& b) {
+	uint n = this->n();
+
+	// Infinite if a has mass on some i that cannot reach the support of b (then v = 1 outside the elements that can
+	// reach it, 0 on them, is in C with b.v = 0 < a.v)
+	std::vector<char> reach(n, 0);
+	std::vector<uint> stack;
+	for(uint j = 0; j < n; j++)
+		if(b(j) > R(0)) {
+			reach[j] = 1;
+			stack.push_back(j);
+		}
+	while(!stack.empty()) {
+		uint j = stack.back();
+		stack.pop_back();
+		for(uint i : pred[j])
+			if(!reach[i]) {
+				reach[i] = 1;
+				stack.push_back(i);
+			}
+	}
+	for(uint i = 0; i < n; i++)
+		if(!reach[i] && a(i) > R(0))
+			return infinity<R>();
+
+	// Dinkelbach, starting from z = 1 (v = 1 is in C). Each step gives the ratio of a vertex, strictly increasing
+	// until the optimum.
+	auto& lp = lps[s];
+	R z = R(1);
+	for(uint it = 0; it < max_iter; it++) {
+		for(uint i = 0; i < n; i++)
+			lp.set_obj_coeff(vars[s][i], a(i) - z * b(i));
+		if(!lp.solve())
+			throw std::runtime_error("MultKantorovich: LP failed, this shouldn't happen");
+
+		R av(0), bv(0);
+		for(uint i = 0; i < n; i++) {
+			R v_i = lp.solution(vars[s][i]);
+			av += a(i) * v_i;
+			bv += b(i) * v_i;
+		}
+		if(bv <= R(0))
+			break;
+		R z_new = av / bv;
+		if(!(z_new > z))
+			break;
+		z = z_new;
+	}
+	return std::log(z);
+}
+
+template<typename R>
+R MultKantorovich<R>::operator()(const Prob<R>& a, const Prob<R>& b) {
+	QIF_TRACE_SPAN("metric::mult_kantorovich");
+	if(a.n_cols != n() || b.n_cols != n()) throw std::runtime_error("size mismatch");
 
-	return [one_side](const T& a, const T& b) -> R {
-		// solve both programs and keep the max
-		return std::max(one_side(a, b), one_side(b, a));
+	R res[2];
+	parallel::for_each(2, [&](uint s) {
+		res[s] = s == 0 ? side(0, a, b) : side(1, b, a);
+	});
+	return std::max(res[0], res[1]);
+}
+
+// multiplicative kantorovich, through the MultKantorovich engine (use the engine directly for many distances)
+//
+template<typename R = R_def, typename T>
+Metric<R, T>
+mult_kantorovich(Metric<R, uint> d) {
+	static_assert(is_Prob<T>::value, "only defined on probability distributions");
+	static_assert(std::is_same<R, typename T::elem_type>::value, "result and prob element type should be the same");
+
+	return [d](const T& a, const T& b) -> R {
+		if(a.n_cols != b.n_cols) throw std::runtime_error("size mismatch");
+
+		return MultKantorovich<R>(d, a.n_cols)(a, b);
 	};
 }
 
-template<typename R = R_def, typename A, typename B, typename D>
+// f: A -> B is Lipschitz wrt da, db if db(f(a1), f(a2)) <= da(a1, a2) for all a1, a2 in domain.
+// f, da, db can be any callables (eg. lambdas or metric::expr expressions), which are then inlined in the loop.
+// R, A, B cannot be deduced from such callables and need to be given explicitly, eg.  is_lipschitz<eT,uint,Prob<eT>>(...)
+//
+template<typename R = R_def, typename A, typename B, typename D, typename F, typename DA, typename DB>
 bool
-is_lipschitz(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const D& domain, Chainable<A> da_chain = never_chainable<A>) {
+is_lipschitz(const F& f, const DA& da, const DB& db, const D& domain, const Chainable<A>& da_chain = never_chainable<A>) {
 
 	for(auto a1 = domain.begin(); a1 != domain.end(); a1++) {
 		auto a2 = a1;
@@ -553,16 +1624,84 @@ is_lipschitz(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const D& dom
 			// chainable elements are redundant to check
 			if(da_chain(*a1, *a2)) continue;
 
-			if(!less_than_or_eq(db(f(*a1), f(*a2)), da(*a1, *a2)))
+			if(!less_than_or_eq(R(db(f(*a1), f(*a2))), R(da(*a1, *a2))))
 				return false;
 		}
 	}
 	return true;
 }
 
+// std::function version, R, A, B are deduced
 template<typename R = R_def, typename A, typename B, typename D>
+bool
+is_lipschitz(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const D& domain, Chainable<A> da_chain = never_chainable<A>) {
+	return is_lipschitz<R, A, B, D, std::function<B(A)>, Metric<R,A>, Metric<R,B>>(f, da, db, domain, da_chain);
+}
+
+namespace aux {
+	const uint lipschitz_block = 1 << 16;		// pairs collected before each parallel check
+	const uint lipschitz_chunk = 256;			// pairs per parallel task
+}
+
+// Parallel version of is_lipschitz, for large domains. f is evaluated once per element (its results are cached), and
+// the pairs are checked in blocks: the calling thread collects the pairs that are not chainable (the edges of the
+// chainability graph of da_chain) together with their da distance, and the db distances of the block are then
+// compared across threads, stopping all of them at the first violation. f, da and da_chain are only called from the
+// calling thread (they might not be thread-safe, eg. python functions), db is called concurrently.
+//
+template<typename R = R_def, typename A, typename B, typename D, typename F, typename DA, typename DB>
+bool
+is_lipschitz_parallel(const F& f, const DA& da, const DB& db, const D& domain, const Chainable<A>& da_chain = never_chainable<A>) {
+	std::vector<A> elems(domain.begin(), domain.end());
+	std::vector<B> images;
+	images.reserve(elems.size());
+	for(const A& a : elems)
+		images.push_back(f(a));
+
+	struct Pair { uint i, j; R dist; };
+	std::vector<Pair> block;
+	std::atomic<bool> ok(true);
+
+	auto check_block = [&]() {
+		uint n_chunks = (block.size() + aux::lipschitz_chunk - 1) / aux::lipschitz_chunk;
+		parallel::for_each(n_chunks, [&](uint c) {
+			uint end = std::min<size_t>(block.size(), (c + 1) * aux::lipschitz_chunk);
+			for(uint k = c * aux::lipschitz_chunk; k < end && ok; k++) {
+				const Pair& p = block[k];
+				if(!less_than_or_eq(R(db(images[p.i], images[p.j])), p.dist))
+					ok = false;
+			}
+		});
+		block.clear();
+		return bool(ok);
+	};
+
+	uint n = elems.size();
+	for(uint i = 0; i < n; i++) {
+		for(uint j = i+1; j < n; j++) {
+			// chainable elements are redundant to check
+			if(da_chain(elems[i], elems[j])) continue;
+
+			block.push_back({ i, j, R(da(elems[i], elems[j])) });
+			if(block.size() == aux::lipschitz_block && !check_block())
+				return false;
+		}
+	}
+	return check_block();
+}
+
+// std::function version, R, A, B are deduced
+template<typename R = R_def, typename A, typename B, typename D>
+bool
+is_lipschitz_parallel(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const D& domain, Chainable<A> da_chain = never_chainable<A>) {
+	return is_lipschitz_parallel<R, A, B, D, std::function<B(A)>, Metric<R,A>, Metric<R,B>>(f, da, db, domain, da_chain);
+}
+
+// The smallest L such that f is L-Lipschitz wrt da, db. As in is_lipschitz, f, da, db can be any callables.
+//
+template<typename R = R_def, typename A, typename B, typename D, typename F, typename DA, typename DB>
 R
-lipschitz_constant(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const D& domain, Chainable<A> da_chain = never_chainable<A>) {
+lipschitz_constant(const F& f, const DA& da, const DB& db, const D& domain, const Chainable<A>& da_chain = never_chainable<A>) {
 
 	R res(0);
 	for(auto a1 = domain.begin(); a1 != domain.end(); a1++) {
@@ -571,7 +1710,7 @@ lipschitz_constant(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const
 			// chainable elements are redundant to check
 			if(da_chain(*a1, *a2)) continue;
 
-			R ratio = db(f(*a1), f(*a2)) / da(*a1, *a2);
+			R ratio = R(db(f(*a1), f(*a2))) / R(da(*a1, *a2));
 			if(less_than(res, ratio))
 				res = ratio;
 		}
@@ -579,6 +1718,13 @@ lipschitz_constant(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const
 	return res;
 }
 
+// std::function version, R, A, B are deduced
+template<typename R = R_def, typename A, typename B, typename D>
+R
+lipschitz_constant(std::function<B(A)> f, Metric<R,A> da, Metric<R,B> db, const D& domain, Chainable<A> da_chain = never_chainable<A>) {
+	return lipschitz_constant<R, A, B, D, std::function<B(A)>, Metric<R,A>, Metric<R,B>>(f, da, db, domain, da_chain);
+}
+
 } // namespace metric
 
 // operator *, should be in the same namespace as Metric<R,T>
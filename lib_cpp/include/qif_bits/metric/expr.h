@@ -0,0 +1,343 @@
+// inlinable metric expressions
+
+namespace metric::expr {
+
+// Metric<R,T> is a std::function, so every combinator (scale, min, compose, grid, ...) adds an indirect call and a
+// copy of the wrapped metric. The metrics in this namespace are instead plain function objects, and combining them
+// produces a single concrete type, eg. the type of  eps * grid<double>(width)  is Scale<Grid<Euclidean<...>>>. Calls
+// to such a metric are inlined by the compiler, which matters in loops evaluating the metric O(n^2) times.
+//
+// All expressions derive from Expr<Derived, R, T> (CRTP) and are callables R(const T&, const T&), so they can be
+// passed anywhere a Metric<R,T> is expected; the std::function is then the type-erased fallback. Functions that are
+// templated on the metric type (metric::is_lipschitz, metric::lipschitz_constant, d_privacy's min_loss_given_d, ...)
+// use the expression directly. A Metric<R,T> can be used inside an expression via from(d).
+//
+// Some expressions also report their neighbourhood structure: d.neighbours(a) returns (a superset of) the elements b
+// such that a, b are _not_ chainable (see the note on chainable() in metric.h). For instance for manhattan on a grid
+// these are the (at most 8) adjacent cells. Functions that only need the non-chainable pairs (eg. d_privacy's
+// min_loss_given_d) detect this via has_neighbours<D> and skip all other pairs, without calling a chainable function.
+// neighbours() can return elements outside the domain of interest (eg. larger than the number of inputs), the caller
+// should filter them.
+//
+template<typename D, typename = void>
+struct has_neighbours : std::false_type {};
+
+template<typename D>
+struct has_neighbours<D, std::void_t<decltype(std::declval<const D&>().neighbours(std::declval<const typename D::arg_type&>()))>>
+	: std::true_type {};
+
+template<typename Derived, typename R, typename T>
+struct Expr {
+	typedef R result_type;
+	typedef T arg_type;
+
+	const Derived& derived() const {
+		return static_cast<const Derived&>(*this);
+	}
+
+	// type-erased version
+	Metric<R, T> erase() const {
+		return Metric<R, T>(derived());
+	}
+};
+
+template<typename R, typename T>
+struct Euclidean : Expr<Euclidean<R, T>, R, T> {
+	R operator()(const T& a, const T& b) const {
+		if constexpr (is_Point<T>::value) {
+			auto v1 = abs_diff(a.x, b.x),
+				 v2 = abs_diff(a.y, b.y);
+			return R(std::sqrt(v1*v1 + v2*v2));
+		} else {
+			return R(abs_diff(a, b));
+		}
+	}
+
+	// on uint's only consecutive elements are not chainable (same as euclidean_chain)
+	template<typename T2 = T, typename = std::enable_if_t<std::is_same<T2, uint>::value>>
+	std::vector<uint> neighbours(const uint& a) const {
+		if(a == 0)
+			return { 1 };
+		return { a - 1, a + 1 };
+	}
+};
+
+template<typename R, typename T>
+struct Manhattan : Expr<Manhattan<R, T>, R, T> {
+	static_assert(is_Point<T>::value, "manhattan needs Points");
+
+	R operator()(const T& a, const T& b) const {
+		return R(abs_diff(a.x, b.x) + abs_diff(a.y, b.y));
+	}
+
+	// on discrete Points only the 8 adjacent ones are not chainable (same as manhattan_chain)
+	template<typename T2 = T, typename = std::enable_if_t<std::is_same<T2, Point<uint>>::value>>
+	std::vector<T> neighbours(const T& a) const {
+		std::vector<T> res;
+		for(uint y = a.y == 0 ? 0 : a.y - 1; y <= a.y + 1; y++)
+			for(uint x = a.x == 0 ? 0 : a.x - 1; x <= a.x + 1; x++)
+				if(x != a.x || y != a.y)
+					res.push_back(T(x, y));
+		return res;
+	}
+};
+
+template<typename R, typename T>
+struct Discrete : Expr<Discrete<R, T>, R, T> {
+	R operator()(const T& a, const T& b) const {
+		return R(equal(a, b) ? 0 : 1);
+	}
+};
+
+// wraps a Metric<R,T> (no inlining of course, but allows mixing with other expressions)
+template<typename R, typename T>
+struct Function : Expr<Function<R, T>, R, T> {
+	Metric<R, T> d;
+
+	explicit Function(Metric<R, T> d) : d(d) {}
+
+	R operator()(const T& a, const T& b) const {
+		return d(a, b);
+	}
+};
+
+template<typename D>
+struct Scale : Expr<Scale<D>, typename D::result_type, typename D::arg_type> {
+	using R = typename D::result_type;
+	using T = typename D::arg_type;
+
+	D d;
+	R coeff;
+
+	Scale(const D& d, R coeff) : d(d), coeff(coeff) {}
+
+	R operator()(const T& a, const T& b) const {
+		// separate treatment of 0 allows to scale by infinity and still get d(x,x) == 0
+		R r = d(a, b);
+		if(r != R(0)) r *= coeff;
+		return r;
+	}
+
+	// scaling preserves tight chains
+	template<typename D2 = D, typename = std::enable_if_t<has_neighbours<D2>::value>>
+	auto neighbours(const T& a) const {
+		return d.neighbours(a);
+	}
+};
+
+template<typename D1, typename D2>
+struct Min : Expr<Min<D1, D2>, typename D1::result_type, typename D1::arg_type> {
+	using R = typename D1::result_type;
+	using T = typename D1::arg_type;
+
+	D1 d1;
+	D2 d2;
+
+	Min(const D1& d1, const D2& d2) : d1(d1), d2(d2) {}
+
+	R operator()(const T& a, const T& b) const {
+		R r1 = d1(a, b);
+		R r2 = d2(a, b);
+		return less_than(r1, r2) ? r1 : r2;
+	}
+};
+
+template<typename D1, typename D2>
+struct Max : Expr<Max<D1, D2>, typename D1::result_type, typename D1::arg_type> {
+	using R = typename D1::result_type;
+	using T = typename D1::arg_type;
+
+	D1 d1;
+	D2 d2;
+
+	Max(const D1& d1, const D2& d2) : d1(d1), d2(d2) {}
+
+	R operator()(const T& a, const T& b) const {
+		R r1 = d1(a, b);
+		R r2 = d2(a, b);
+		return less_than(r1, r2) ? r2 : r1;
+	}
+};
+
+template<typename D>
+struct Mirror : Expr<Mirror<D>, typename D::result_type, typename D::arg_type> {
+	using R = typename D::result_type;
+	using T = typename D::arg_type;
+
+	D d;
+
+	explicit Mirror(const D& d) : d(d) {}
+
+	R operator()(const T& a, const T& b) const {
+		return d(b, a);
+	}
+
+	template<typename D2 = D, typename = std::enable_if_t<has_neighbours<D2>::value>>
+	auto neighbours(const T& a) const {
+		return d.neighbours(a);
+	}
+};
+
+template<typename D>
+struct Threshold : Expr<Threshold<D>, typename D::result_type, typename D::arg_type> {
+	using R = typename D::result_type;
+	using T = typename D::arg_type;
+
+	D d;
+	R thres;
+
+	Threshold(const D& d, R thres) : d(d), thres(thres) {}
+
+	R operator()(const T& a, const T& b) const {
+		R r = d(a, b);
+		return less_than(r, thres) ? r : thres;
+	}
+};
+
+template<typename D>
+struct ThresholdInf : Expr<ThresholdInf<D>, typename D::result_type, typename D::arg_type> {
+	using R = typename D::result_type;
+	using T = typename D::arg_type;
+
+	D d;
+	R thres;
+
+	ThresholdInf(const D& d, R thres) : d(d), thres(thres) {}
+
+	R operator()(const T& a, const T& b) const {
+		R r = d(a, b);
+		return less_than_or_eq(r, thres) ? r : infinity<R>();
+	}
+};
+
+// d( f(a), f(b) ), where d is a metric on T2 and f: T1 -> T2 any callable
+template<typename D, typename F, typename T1>
+struct Compose : Expr<Compose<D, F, T1>, typename D::result_type, T1> {
+	using R = typename D::result_type;
+
+	D d;
+	F f;
+
+	Compose(const D& d, const F& f) : d(d), f(f) {}
+
+	R operator()(const T1& a, const T1& b) const {
+		return d(f(a), f(b));
+	}
+};
+
+// d on the cells of a grid of the given width, cell i is the point (i%width, i/width). Same as metric::grid.
+template<typename D>
+struct Grid : Expr<Grid<D>, typename D::result_type, uint> {
+	using R = typename D::result_type;
+	static_assert(std::is_same<typename D::arg_type, Point<uint>>::value, "grid needs a metric on Point<uint>");
+
+	D d;
+	uint width;
+
+	Grid(const D& d, uint width) : d(d), width(width) {}
+
+	R operator()(const uint& a, const uint& b) const {
+		return d(Point<uint>(a % width, a / width), Point<uint>(b % width, b / width));
+	}
+
+	// the neighbours of the cell's point that are inside the grid's width
+	template<typename D2 = D, typename = std::enable_if_t<has_neighbours<D2>::value>>
+	std::vector<uint> neighbours(const uint& a) const {
+		std::vector<uint> res;
+		for(auto& p : d.neighbours(Point<uint>(a % width, a / width)))
+			if(p.x < width)
+				res.push_back(p.y * width + p.x);
+		return res;
+	}
+};
+
+
+// factories, with the same names and arguments as the corresponding Metric functions in namespace metric
+//
+template<typename R = R_def, typename T>
+Euclidean<R, T>
+euclidean() {
+	return Euclidean<R, T>();
+}
+
+template<typename R = R_def, typename T>
+Manhattan<R, T>
+manhattan() {
+	return Manhattan<R, T>();
+}
+
+template<typename R = R_def, typename T>
+Discrete<R, T>
+discrete() {
+	return Discrete<R, T>();
+}
+
+template<typename R, typename T>
+Function<R, T>
+from(const Metric<R, T>& d) {
+	return Function<R, T>(d);
+}
+
+template<typename D, typename R, typename T>
+Scale<D>
+scale(const Expr<D, R, T>& d, R coeff) {
+	return Scale<D>(d.derived(), coeff);
+}
+
+template<typename D1, typename D2, typename R, typename T>
+Min<D1, D2>
+min(const Expr<D1, R, T>& d1, const Expr<D2, R, T>& d2) {
+	return Min<D1, D2>(d1.derived(), d2.derived());
+}
+
+template<typename D1, typename D2, typename R, typename T>
+Max<D1, D2>
+max(const Expr<D1, R, T>& d1, const Expr<D2, R, T>& d2) {
+	return Max<D1, D2>(d1.derived(), d2.derived());
+}
+
+template<typename D, typename R, typename T>
+Mirror<D>
+mirror(const Expr<D, R, T>& d) {
+	return Mirror<D>(d.derived());
+}
+
+template<typename D, typename R, typename T>
+Threshold<D>
+threshold(const Expr<D, R, T>& d, R thres) {
+	return Threshold<D>(d.derived(), thres);
+}
+
+template<typename D, typename R, typename T>
+ThresholdInf<D>
+threshold_inf(const Expr<D, R, T>& d, R thres) {
+	return ThresholdInf<D>(d.derived(), thres);
+}
+
+// T1 (the domain of f) cannot be deduced from a generic callable, so it has to be given, eg. compose<uint>(d, f)
+template<typename T1, typename D, typename R, typename T2, typename F>
+Compose<D, F, T1>
+compose(const Expr<D, R, T2>& d, const F& f) {
+	return Compose<D, F, T1>(d.derived(), f);
+}
+
+template<typename D, typename R>
+Grid<D>
+grid(uint width, const Expr<D, R, Point<uint>>& d) {
+	return Grid<D>(d.derived(), width);
+}
+
+template<typename R = R_def>
+Grid<Euclidean<R, Point<uint>>>
+grid(uint width) {
+	return Grid<Euclidean<R, Point<uint>>>(Euclidean<R, Point<uint>>(), width);
+}
+
+// eps * d, found by ADL
+template<typename D, typename R, typename T>
+Scale<D>
+operator*(R coeff, const Expr<D, R, T>& d) {
+	return Scale<D>(d.derived(), coeff);
+}
+
+} // namespace metric::expr
@@ -0,0 +1,125 @@
+// shortest-path metrics on weighted graphs
+
+namespace metric {
+
+// A weighted graph on vertices 0..n_vertices-1, stored as adjacency lists, for building the shortest-path metric of
+// eg. a road network (elastic mechanisms) or a semantic map. Weights should be non-negative.
+//
+template<typename R = R_def>
+class Graph {
+	public:
+		struct Edge {
+			uint to;
+			R weight;
+		};
+
+		uint n_vertices;
+		std::vector<std::vector<Edge>> adj;
+
+		explicit Graph(uint n_vertices) : n_vertices(n_vertices), adj(n_vertices) {}
+
+		void add_edge(uint u, uint v, R weight, bool directed = false) {
+			if(u >= n_vertices || v >= n_vertices) throw std::runtime_error("vertex out of range");
+			if(weight < R(0)) throw std::runtime_error("negative weight");
+
+			adj[u].push_back({ v, weight });
+			if(!directed)
+				adj[v].push_back({ u, weight });
+		}
+
+		uint n_edges() const {
+			uint n = 0;
+			for(auto& a : adj)
+				n += a.size();
+			return n;
+		}
+
+		// The graph with an edge u -> v of weight W(u, v) for every finite W(u, v) > 0 (other entries mean no edge)
+		static Graph from_weights(const Mat<R>& W) {
+			if(W.n_rows != W.n_cols) throw std::runtime_error("W should be square");
+
+			Graph g(W.n_rows);
+			for(uint v = 0; v < W.n_cols; v++)
+				for(uint u = 0; u < W.n_rows; u++)
+					if(W(u, v) > R(0) && W(u, v) != infinity<R>())
+						g.add_edge(u, v, W(u, v), true);
+			return g;
+		}
+
+		// The cells of a width x height grid (cell i is (i%width, i/width), as in metric::grid), each connected to its
+		// horizontal/vertical neighbours with weight step (and to the diagonal ones with weight sqrt(2) step, if
+		// diagonals is true).
+		//
+		static Graph grid(uint width, uint height, R step = R(1), bool diagonals = false) {
+			Graph g(width * height);
+			R diag = R(std::sqrt(2.0)) * step;
+			for(uint y = 0; y < height; y++) {
+				for(uint x = 0; x < width; x++) {
+					uint i = y * width + x;
+					if(x + 1 < width)					g.add_edge(i, i + 1, step);
+					if(y + 1 < height)					g.add_edge(i, i + width, step);
+					if(diagonals && y + 1 < height) {
+						if(x + 1 < width)				g.add_edge(i, i + width + 1, diag);
+						if(x > 0)						g.add_edge(i, i + width - 1, diag);
+					}
+				}
+			}
+			return g;
+		}
+
+		// dist(source, v) for all vertices v, infinity for unreachable ones (Dijkstra with a binary heap)
+		Col<R> distances_from(uint source) const {
+			Col<R> dist(n_vertices);
+			dijkstra(source, dist.memptr());
+			return dist;
+		}
+
+		// D(u, v) = dist(u, v), by running Dijkstra from every source in parallel, O(n m log n) in total
+		Mat<R> distances() const {
+			Mat<R> D(n_vertices, n_vertices);
+			parallel::for_each(n_vertices, [&](uint s) {
+				dijkstra(s, D.colptr(s));		// column s: distances from s
+			});
+			arma::inplace_trans(D);				// row u: distances from u (same matrix for undirected graphs)
+			return D;
+		}
+
+	private:
+		void dijkstra(uint source, R* dist) const {
+			if(source >= n_vertices) throw std::runtime_error("vertex out of range");
+
+			std::fill(dist, dist + n_vertices, infinity<R>());
+			dist[source] = R(0);
+
+			typedef std::pair<R, uint> Item;
+			std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+			queue.push({ R(0), source });
+
+			while(!queue.empty()) {
+				auto [du, u] = queue.top();
+				queue.pop();
+				if(dist[u] < du)
+					continue;		// stale entry
+
+				for(const Edge& e : adj[u]) {
+					R dv = du + e.weight;
+					if(dv < dist[e.to]) {
+						dist[e.to] = dv;
+						queue.push({ dv, e.to });
+					}
+				}
+			}
+		}
+};
+
+// The shortest-path metric of g, computed once (see Graph::distances) and kept as a distance matrix, so the measures
+// and mechanisms with CachedMetric overloads use the matrix directly, and any other function taking a metric gets an
+// O(1) lookup per call.
+//
+template<typename R = R_def>
+CachedMetric<R>
+graph(const Graph<R>& g) {
+	return CachedMetric<R>(g.distances());
+}
+
+} // namespace metric
@@ -2,9 +2,323 @@
 
 namespace metric::optimize {
 
+// Computes the (euclidean) projection of vector x \in R^n onto the
+// n-simplex. That is, finds the point of the simplex that is closer  to x.
+// Uses the algorithm of:
+//    http://www.springerlink.com/content/q1636371674m36p1/
+//
+template<typename eT = eT_def>
+inline
+Prob<eT> simplex_project(Prob<eT> x) {
+	uint n = x.n_cols;
+	Row<char> done(n);
+	done.fill(0);
+
+	while(true) {
+		eT t = (arma::accu(x)-1)/n;
+		uint n1 = 0;
+
+		for(uint i = 0; i < x.n_cols; i++) {
+			if(done(i)) continue;
+
+			x(i) -= t;
+			if(eT(0) > x(i)) {
+				x(i) = eT(0);
+				done(i) = 1;
+				n1++;
+			}
+		}
+
+		if(n1 == 0) break;		// no negative elements
+		n -= n1;
+	}
+
+	return x;
+}
+
+// Projection of y (n elements) onto the simplex, written to x (which can be equal to y), using the sort-free
+// algorithm of:
+//    L. Condat, Fast projection onto the simplex and the l1 ball, Mathematical Programming 158 (2016)
+// which finds the threshold tau (x = max(y - tau, 0)) in observed linear time. aux is a buffer of n elements.
+//
+template<typename eT>
+inline
+void simplex_project_condat(const eT* y, eT* x, uint n, eT* aux) {
+	if(n == 0) return;
+
+	// first pass: candidate elements (those > tau) are kept in aux, elements dropped when tau jumps are re-checked below
+	int len = 1, len_old = -1, start = 0;
+	eT tau = (aux[0] = y[0]) - eT(1);
+	for(uint i = 1; i < n; i++) {
+		if(y[i] > tau) {
+			aux[len] = y[i];
+			tau += (y[i] - tau) / eT(len - len_old);
+			if(tau <= y[i] - eT(1)) {
+				tau = y[i] - eT(1);
+				len_old = len - 1;
+			}
+			len++;
+		}
+	}
+	if(len_old >= 0) {
+		len -= ++len_old;
+		start = len_old;
+		while(--len_old >= 0)
+			if(aux[len_old] > tau) {
+				aux[--start] = aux[len_old];
+				tau += (aux[start] - tau) / eT(++len);
+			}
+	}
+
+	// remove the candidates <= tau until none is left
+	eT* a = aux + start;
+	do {
+		len_old = len - 1;
+		len = 0;
+		for(int i = 0; i <= len_old; i++) {
+			if(a[i] > tau)
+				a[len++] = a[i];
+			else
+				tau += (tau - a[i]) / eT(len_old - i + len);
+		}
+	} while(len <= len_old);
+
+	for(uint i = 0; i < n; i++)
+		x[i] = y[i] > tau ? y[i] - tau : eT(0);
+}
+
+// Projects every column of X onto the simplex (the whole matrix at once, columns are contiguous so no copies are
+// made), in parallel for large matrices.
+//
+template<typename eT>
+inline
+void simplex_project_cols(Mat<eT>& X) {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+
+	const uint n = X.n_rows;
+	const uint per_task = std::max<uint>(1, (1 << 14) / std::max<uint>(1, n));		// ~16k elements per task
+	const uint n_tasks = (X.n_cols + per_task - 1) / per_task;
+
+	auto task = [&](uint k) {
+		std::vector<eT> aux(n);
+		for(uint j = k * per_task; j < std::min(X.n_cols, (k+1) * per_task); j++)
+			simplex_project_condat(X.colptr(j), X.colptr(j), n, aux.data());
+	};
+	if(n_tasks > 1)
+		parallel::for_each(n_tasks, task);
+	else if(n_tasks == 1)
+		task(0);
+}
+
+namespace aux {
+
+// l1 distance between arrays of n elements. For floating types independent accumulators are used, so that the loop
+// vectorizes.
+//
+template<typename eT>
+inline
+eT l1_dist(const eT* a, const eT* b, uint n) {
+	if constexpr (std::is_floating_point<eT>::value) {
+		eT s[4] = {};
+		uint i = 0;
+		for(; i + 4 <= n; i += 4)
+			for(uint k = 0; k < 4; k++)
+				s[k] += std::abs(a[i+k] - b[i+k]);
+		for(; i < n; i++)
+			s[0] += std::abs(a[i] - b[i]);
+		return (s[0] + s[1]) + (s[2] + s[3]);
+	} else {
+		using std::abs;
+		eT s(0);
+		for(uint i = 0; i < n; i++)
+			s += abs(a[i] - b[i]);
+		return s;
+	}
+}
+
+// Max l1 distance between a column of At and a column of Bt (the rows of A, B, transposed so that they are
+// contiguous), or between two distinct columns of At if same == true (Bt is then ignored).
+//
+// Pairs are pruned via the triangle inequality, d(a,b) <= d(a,p) + d(p,b), for two pivots p obtained by farthest-point
+// steps (which also give the initial pair, a lower bound of the result). Columns of At and Bt are sorted by their
+// distance to the first pivot, so the bound is decreasing in the inner loop, which stops as soon as the bound cannot
+// beat the current max; the bound of the second pivot skips single pairs. The outer loop runs in parallel.
+//
+template<typename eT>
+std::tuple<eT,uint,uint> l1_max_pruned(const Mat<eT>& At, const Mat<eT>& Bt_, bool same) {
+	const Mat<eT>& Bt = same ? At : Bt_;
+	const uint m = At.n_rows, nA = At.n_cols, nB = Bt.n_cols;
+	if(nA == 0 || nB == 0)
+		return { eT(0), 0, 0 };
+
+	// distances of X's columns to p, returns the farthest
+	auto distances = [&](const Mat<eT>& X, const eT* p, std::vector<eT>& d) -> uint {
+		d.resize(X.n_cols);
+		uint far = 0;
+		for(uint i = 0; i < X.n_cols; i++) {
+			d[i] = l1_dist(X.colptr(i), p, m);
+			if(less_than(d[far], d[i]))
+				far = i;
+		}
+		return far;
+	};
+	std::vector<eT> dA1, dB1, dA2, dB2, tmp;
+	uint b1 = distances(Bt, At.colptr(0), tmp);			// pivot 1: Bt col b1
+	uint a1 = distances(At, Bt.colptr(b1), dA1);		// pivot 2: At col a1
+	distances(Bt, Bt.colptr(b1), dB1);
+	distances(At, At.colptr(a1), dA2);
+	if(same) {
+		dB2 = dA2;
+	} else {
+		distances(Bt, At.colptr(a1), dB2);
+	}
+
+	auto sorted = [](const std::vector<eT>& d) {
+		std::vector<uint> order(d.size());
+		for(uint i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&](uint i, uint j) { return d[i] > d[j]; });
+		return order;
+	};
+	const std::vector<uint> orderA = sorted(dA1), orderB = same ? orderA : sorted(dB1);
+
+	std::mutex mutex;
+	eT best = dA1[a1];
+	uint best_a = a1, best_b = b1;
+
+	parallel::for_each(nA, [&](uint ii) {
+		const uint a = orderA[ii];
+		const uint first = same ? ii + 1 : 0;
+		if(first >= nB)
+			return;
+
+		eT cur;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			cur = best;
+		}
+		uint cur_b = nB;
+
+		for(uint jj = first; jj < nB; jj++) {
+			const uint b = orderB[jj];
+			if(!less_than(cur, eT(dA1[a] + dB1[b])))
+				break;
+			if(!less_than(cur, eT(dA2[a] + dB2[b])))
+				continue;
+
+			eT d = l1_dist(At.colptr(a), Bt.colptr(b), m);
+			if(less_than(cur, d)) {
+				cur = d;
+				cur_b = b;
+			}
+		}
+
+		if(cur_b < nB) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if(less_than(best, cur)) {
+				best = cur;
+				best_a = a;
+				best_b = cur_b;
+			}
+		}
+	});
+
+	if(same && best_a > best_b)
+		std::swap(best_a, best_b);
+	return { best, best_a, best_b };
+}
+
+// The max over sign vectors coeff in {-1,1}^m of the linf diameter of { C * coeff } (see l1_diameter), for C = A, or of
+// the max distance between A * coeff and B * coeff if B != nullptr. The sign vectors are visited in Gray-code order,
+// so consecutive ones differ in a single coordinate and C * coeff is updated in O(n) from the previous one.
+// Since the complement of coeff gives -C * coeff, with the same diameter, only coeff with coeff(m-1) = 1 are needed.
+//
+template<typename eT>
+std::tuple<eT,uint,uint> linf_embedding_max(const Chan<eT>& A, const Chan<eT>* B) {
+	const uint m = A.n_cols;
+	if(m == 0 || A.n_rows == 0 || (B && B->n_rows == 0))
+		return { eT(0), 0, 0 };
+	if(m > 64)
+		throw std::runtime_error("too many columns for the linf method");
+
+	const eT two(2);
+	const uint refresh = 1 << 10;		// floating types: recompute C * coeff every refresh steps, to avoid drift
+
+	Col<eT> coeff(m);
+	coeff.fill(eT(1));
+	Col<eT> tA = A * coeff, tB;
+	if(B)
+		tB = *B * coeff;
+
+	eT res(0);
+	uint res_x1 = 0, res_x2 = 0;
+	const uint64_t n_steps = uint64_t(1) << (m - 1);
+
+	for(uint64_t k = 1; ; k++) {
+		if(!B) {
+			if(eT d = arma::range(tA); less_than(res, d)) {
+				res = d;
+				res_x1 = arma::index_min(tA);
+				res_x2 = arma::index_max(tA);
+			}
+		} else {
+			uint a_min = arma::index_min(tA), a_max = arma::index_max(tA), b_min = arma::index_min(tB), b_max = arma::index_max(tB);
+			if(eT d = tA(a_max) - tB(b_min); less_than(res, d)) {
+				res = d;
+				res_x1 = a_max;
+				res_x2 = b_min;
+			}
+			if(eT d = tB(b_max) - tA(a_min); less_than(res, d)) {
+				res = d;
+				res_x1 = a_min;
+				res_x2 = b_max;
+			}
+		}
+
+		if(k == n_steps)
+			break;
+
+		// the k-th Gray code differs from the previous one in the lowest set bit of k
+		uint g = 0;
+		while(!((k >> g) & 1))
+			g++;
+
+		auto update = [&](const Chan<eT>& C, Col<eT>& t) {
+			if(coeff(g) > eT(0))
+				for(uint x = 0; x < C.n_rows; x++)
+					t(x) -= two * C(x, g);
+			else
+				for(uint x = 0; x < C.n_rows; x++)
+					t(x) += two * C(x, g);
+		};
+		update(A, tA);
+		if(B)
+			update(*B, tB);
+		coeff(g) = -coeff(g);
+
+		if constexpr (std::is_floating_point<eT>::value) {
+			if(k % refresh == 0) {
+				tA = A * coeff;
+				if(B)
+					tB = *B * coeff;
+			}
+		}
+	}
+
+	return { res, res_x1, res_x2 };
+}
+
+} // namespace aux
+
 // Computes the l1-diameter of the set of C's rows.
 // Returns also the rows that produce the diameter.
 //
+// Methods:
+//  "direct": all pairs of rows
+//  "pruned": pairs pruned by triangle-inequality bounds, in parallel (see aux::l1_max_pruned). Much faster when
+//            few rows are close to the diameter
+//  "linf":   via an embedding in Linf^(2^m), m being the number of columns (usable for small m only)
+//
 template<typename eT = eT_def>
 std::tuple<eT,uint,uint> l1_diameter(const Chan<eT>& C, std::string method = "direct") {
 	eT diam(0);
@@ -24,7 +338,11 @@ std::tuple<eT,uint,uint> l1_diameter(const Chan<eT>& C, std::string method = "di
 				}
 			}
 		}
-	
+
+	} else if(method == "pruned") {
+		const Mat<eT> Ct = C.t();
+		std::tie(diam, res_x1, res_x2) = aux::l1_max_pruned(Ct, Ct, true);
+
 	} else if(method == "linf") {
 		// Computes the diameter by embeding C's rows in Rinf^d where d = 2^m (m is n_cols).
 		// The embedding phi(x) in R^d of a vector x in R^m has one coordinate for every bitstring b in {0,1}^m.
@@ -33,29 +351,7 @@ std::tuple<eT,uint,uint> l1_diameter(const Chan<eT>& C, std::string method = "di
 		// In Linf, the diamater is simply given by max_i (max_x x_i - min_x x_i). So for each coordinate b, we need to
 		// compute { phi(x)_b }_x, then compute the max - min, and finally keep the maximum of those.
 		//
-		eT one(1);
-
-		arma::Col<eT> coeff(C.n_cols);	// we only keep the coeff vector (b is implicit)
-		coeff.fill(one);				// start with b = 00..0, coeff = (1,...,1)
-
-		// we have a loop for every value of b. The loop finishes when b becomes 11..1, in which case
-		// the update loop (which stops at the first 0) will finish all steps and i will become C.n_cols
-		uint i = 0;
-		while(i < C.n_cols) {
-			// with a single multiplication we get cdot(coeff, row) for all rows.
-			// we need to compute max-min, and update diam if the new value is bigger
-			auto trans = C * coeff;
-			if(eT d = arma::range(trans); less_than(diam, d)) {
-				diam = d;
-				res_x1 = arma::index_min(trans);
-				res_x2 = arma::index_max(trans);
-			}
-
-			// compute the coeff for the next value of b. For b we would need to change 0s to 1s and vice versa, until we find the first 0 (which became 1).
-			// In coeff, this translates changing 1s to -1s and vice versa, until we find the first -1 (which became 1).
-			for(i = 0; i < C.n_cols && (coeff(i) *= -one) > eT(0); i++)
-				;
-		}
+		std::tie(diam, res_x1, res_x2) = aux::linf_embedding_max<eT>(C, nullptr);
 
 	} else {
 		throw std::runtime_error("invalid method: " + method);
@@ -66,11 +362,15 @@ std::tuple<eT,uint,uint> l1_diameter(const Chan<eT>& C, std::string method = "di
 
 // Computes the max l1-distance between the rows of A and B.
 // Returns also the rows that produce the max distance.
+// Methods as in l1_diameter.
 //
 template<typename eT = eT_def>
 std::tuple<eT,uint,uint> l1_max_distance(const Chan<eT>& A, const Chan<eT>& B, std::string method = "direct") {
 	eT maxdist(0);
-	uint res_x1, res_x2;
+	uint res_x1 = 0, res_x2 = 0;
+
+	if(A.n_cols != B.n_cols)
+		throw std::runtime_error("invalid sizes");
 
 	if(method == "direct") {
 		auto l1 = qif::metric::l1<eT, Prob<eT>>();
@@ -87,8 +387,14 @@ std::tuple<eT,uint,uint> l1_max_distance(const Chan<eT>& A, const Chan<eT>& B, s
 			}
 		}
 
+	} else if(method == "pruned") {
+		std::tie(maxdist, res_x1, res_x2) = aux::l1_max_pruned<eT>(A.t(), B.t(), false);
+
+	} else if(method == "linf") {
+		// as in l1_diameter, the max distance in Linf is max_b (max_a phi(a)_b - min_b phi(b)_b) (or vice versa)
+		std::tie(maxdist, res_x1, res_x2) = aux::linf_embedding_max<eT>(A, &B);
+
 	} else {
-		// TODO: implement linf method like for the diameter
 		throw std::runtime_error("invalid method: " + method);
 	}
 
@@ -124,6 +430,225 @@ std::pair<eT,Prob<eT>> l2_min_enclosing_ball(const Chan<eT>& C) {
 	return { mb.radius(), q };
 }
 
+// l2_min_enclosing_ball for many channels, in parallel
+//
+template<typename eT = eT_def>
+inline
+std::vector<std::pair<eT,Prob<eT>>> l2_min_enclosing_ball(const std::vector<Chan<eT>>& Cs) {
+	std::vector<std::pair<eT,Prob<eT>>> res(Cs.size());
+	parallel::for_each(Cs.size(), [&](uint i) {
+		res[i] = l2_min_enclosing_ball(Cs[i]);
+	});
+	return res;
+}
+
+namespace aux {
+
+// simplex_l1_min_enclosing_ball via a first-order method (floating types only)
+const double l1_meb_tol = 1e-6;			// stop when the duality gap is at most this
+const uint l1_meb_auto_elems = 10000;		// "auto" uses the first-order method for channels with at least that many elements
+const uint l1_meb_stage_iters = 300;		// iterations per smoothing stage
+const uint l1_meb_max_stages = 30;
+
+// Lower bound on min_q max_x |C_x - q|_1 (q in the simplex) given by any lam in the simplex over rows:
+//   min_q sum_x lam_x |C_x - q|_1 = max_mu  sum_y min_{q_y in [0,1]} (sum_x lam_x |C_xy - q_y| + mu q_y) - mu
+// (mu is the multiplier of sum_y q_y = 1). The inner minimum is attained at a lam-weighted (1-mu)/2 quantile of
+// column y, and the function of mu is concave with its max in [-1,1], so it is maximized by golden section search.
+//
+template<typename eT>
+eT l1_meb_lower_bound(const Chan<eT>& C, const Col<eT>& lam) {
+	const eT min_weight = eT(1e-12) * arma::max(lam);
+	const arma::uvec rows = arma::find(lam > min_weight);
+	if(rows.is_empty())
+		return eT(0);
+
+	// values of each column (on the support of lam) sorted, with their weights
+	const uint n = rows.n_elem;
+	std::vector<std::pair<eT,eT>> cols(size_t(n) * C.n_cols);
+	eT total(0);
+	for(uint i = 0; i < n; i++)
+		total += lam(rows(i));
+	for(uint y = 0; y < C.n_cols; y++) {
+		auto col = cols.begin() + size_t(y) * n;
+		for(uint i = 0; i < n; i++)
+			col[i] = { C(rows(i), y), lam(rows(i)) / total };
+		std::sort(col, col + n);
+	}
+
+	auto phi = [&](eT mu) {
+		const eT tau = (1 - mu) / 2;
+		eT res = -mu;
+		for(uint y = 0; y < C.n_cols; y++) {
+			auto col = cols.begin() + size_t(y) * n;
+			eT cum(0), q = col[n-1].first;
+			for(uint i = 0; i < n; i++)
+				if((cum += col[i].second) >= tau) {
+					q = col[i].first;
+					break;
+				}
+			q = std::min(eT(1), std::max(eT(0), q));
+
+			eT h = mu * q;
+			for(uint i = 0; i < n; i++)
+				h += col[i].second * std::abs(col[i].first - q);
+			res += h;
+		}
+		return res;
+	};
+
+	const eT ratio(0.3819660112501051);		// golden section
+	eT a(-1), b(1);
+	for(uint k = 0; k < 60; k++) {
+		eT m1 = a + ratio * (b - a), m2 = b - ratio * (b - a);
+		if(phi(m1) < phi(m2))
+			a = m1;
+		else
+			b = m2;
+	}
+	return phi((a + b) / 2);
+}
+
+// First-order method for simplex_l1_min_enclosing_ball:
+//
+// - The objective max_x |C_x - q|_1 is smoothed (the max via log-sum-exp with parameter mu, |.| via the huber function
+//   with parameter mu/N) and minimized over the simplex with FISTA (with adaptive restart), in stages of decreasing mu.
+//   Distances and gradients are computed in parallel over blocks of rows (the max-distance oracle).
+// - At the end of each stage, the softmax weights of the rows give a lower bound (l1_meb_lower_bound), and the method
+//   stops when the gap to the best value found is at most l1_meb_tol.
+// - If the stages end without reaching the tolerance, the rows close to the max at the best q are solved exactly with
+//   lp_solve (a much smaller LP, whose value is also a lower bound), adding rows violated by its solution until the
+//   gap is closed.
+//
+template<typename eT, typename LP>
+std::pair<eT,Prob<eT>> l1_meb_first_order(const Chan<eT>& C, LP lp_solve) {
+	static_assert(std::is_floating_point<eT>::value, "only defined for floating types");
+
+	const uint M = C.n_rows, N = C.n_cols;
+	const Mat<eT> Ct = C.t();						// rows of C as contiguous columns
+	const uint block = std::max<uint>(1, (1 << 14) / std::max<uint>(1, N));
+	const uint n_blocks = (M + block - 1) / block;
+
+	// exact distances
+	auto distances = [&](const Col<eT>& q) {
+		Col<eT> d(M);
+		parallel::for_each(n_blocks, [&](uint b) {
+			for(uint x = b * block; x < std::min(M, (b+1) * block); x++)
+				d(x) = l1_dist(Ct.colptr(x), q.memptr(), N);
+		});
+		return d;
+	};
+
+	// gradient of the smoothed objective at q, and the softmax weights of the rows
+	Col<eT> d(M), lam(M);
+	Mat<eT> partial(N, n_blocks);
+	auto gradient = [&](const Col<eT>& q, eT mu, eT nu) -> Col<eT> {
+		parallel::for_each(n_blocks, [&](uint b) {
+			for(uint x = b * block; x < std::min(M, (b+1) * block); x++) {
+				const eT* c = Ct.colptr(x);
+				eT s(0);
+				for(uint y = 0; y < N; y++) {
+					eT t = std::abs(c[y] - q(y));
+					s += t <= nu ? t * t / (2 * nu) : t - nu / 2;
+				}
+				d(x) = s;
+			}
+		});
+		lam = arma::exp((d - d.max()) / mu);
+		lam /= arma::accu(lam);
+
+		parallel::for_each(n_blocks, [&](uint b) {
+			eT* g = partial.colptr(b);
+			std::fill(g, g + N, eT(0));
+			for(uint x = b * block; x < std::min(M, (b+1) * block); x++) {
+				if(lam(x) == eT(0))
+					continue;
+				const eT* c = Ct.colptr(x);
+				for(uint y = 0; y < N; y++)
+					g[y] += lam(x) * std::min(eT(1), std::max(eT(-1), (q(y) - c[y]) / nu));
+			}
+		});
+		return arma::sum(partial, 1);
+	};
+
+	// start from the average of the rows, projected (it's already in the simplex if C is a channel)
+	Col<eT> q = arma::mean(C, 0).t();
+	simplex_project_cols(q);
+
+	Col<eT> best_q = q;
+	eT best = distances(best_q).max(), lower(0);
+	eT mu = best / 10;
+
+	for(uint stage = 0; stage < l1_meb_max_stages && best - lower > l1_meb_tol; stage++) {
+		const eT nu = mu / N;
+		const eT step = eT(1) / (eT(1) / nu + eT(N) / mu);		// 1 / Lipschitz constant of the gradient
+
+		Col<eT> y = best_q, q_old = best_q;
+		eT t(1);
+		for(uint k = 0; k < l1_meb_stage_iters; k++) {
+			q = y - step * gradient(y, mu, nu);
+			simplex_project_cols(q);
+
+			if(arma::dot(y - q, q - q_old) > eT(0)) {				// adaptive restart
+				t = 1;
+				y = q;
+			} else {
+				eT t_new = (1 + std::sqrt(1 + 4 * t * t)) / 2;
+				y = q + ((t - 1) / t_new) * (q - q_old);
+				t = t_new;
+			}
+			q_old = q;
+		}
+
+		if(eT f = distances(q).max(); f < best) {
+			best = f;
+			best_q = q;
+		}
+		gradient(best_q, mu, nu);								// softmax weights at best_q
+		lower = std::max(lower, l1_meb_lower_bound(C, lam));
+
+		// next mu: the smoothing error (mu log M) should be below the current gap
+		mu = std::max(std::min(mu / 2, (best - lower) / (2 * std::log(eT(M) + 1))), eT(1e-12));
+	}
+
+	// close the gap exactly on a subset of rows
+	if(best - lower > l1_meb_tol) {
+		d = distances(best_q);
+		std::vector<uint> rows;
+		for(uint x = 0; x < M; x++)
+			if(d(x) >= best - 2 * (best - lower))
+				rows.push_back(x);
+
+		while(true) {
+			auto [r, sub_q] = lp_solve((Chan<eT>)C.rows(arma::conv_to<arma::uvec>::from(rows)));
+			lower = std::max(lower, r);
+
+			d = distances(sub_q.t());
+			if(eT f = d.max(); f < best) {
+				best = f;
+				best_q = sub_q.t();
+			}
+			if(best - lower <= l1_meb_tol)
+				break;
+
+			// add the (at most N) most violated rows
+			arma::uvec order = arma::sort_index(d, "descend");
+			uint added = 0;
+			std::set<uint> have(rows.begin(), rows.end());
+			for(uint i = 0; i < order.n_elem && added < std::max<uint>(1, N) && d(order(i)) > r + l1_meb_tol; i++)
+				if(have.insert(order(i)).second) {
+					rows.push_back(order(i));
+					added++;
+				}
+			if(added == 0)
+				break;			// no violated row, sub_q is optimal up to the LP's precision
+		}
+	}
+
+	return { best, best_q.t() };
+}
+
+} // namespace aux
+
 // Computes the probability distribution q that minimizes the max l1-distance from those in C.
 // Note: this is different than the l1-SEB in the whole R^n. The result is not guaranteed to be in the
 //       convex hull of C's rows, so we have to explicitly constraint q to be in the probability simplex.
@@ -131,13 +656,34 @@ std::pair<eT,Prob<eT>> l2_min_enclosing_ball(const Chan<eT>& C) {
 // The radius and the vector q are returned.
 // in_conv_hull forces solution to be within the convex hull of C's rows (only for the "lp" method)
 //
+// Methods:
+//  "lp":    a linear program with M*N auxiliary variables
+//  "linf":  a linear program via an embedding in Linf^(2^N) (usable for small N only)
+//  "fo":    a first-order method, up to a duality gap of 1e-6 (see aux::l1_meb_first_order), floating types only
+//  "auto":  "fo" for large floating channels, "lp" otherwise
+//
 template<typename eT = eT_def>
 inline
-std::pair<eT,Prob<eT>> simplex_l1_min_enclosing_ball(const Chan<eT>& C, std::string method = "lp", bool in_conv_hull = false) {
+std::pair<eT,Prob<eT>> simplex_l1_min_enclosing_ball(const Chan<eT>& C, std::string method = "auto", bool in_conv_hull = false) {
 	uint M = C.n_rows,
 		 N = C.n_cols;
 	eT inf = infinity<eT>();
 
+	if(method == "auto")
+		method = std::is_floating_point<eT>::value && !in_conv_hull && C.n_elem >= aux::l1_meb_auto_elems ? "fo" : "lp";
+
+	if(method == "fo") {
+		if constexpr (std::is_floating_point<eT>::value) {
+			if(in_conv_hull)
+				throw std::runtime_error("in_conv_hull not supported for the fo method");
+			if(M == 0)
+				throw std::runtime_error("empty channel");
+			return aux::l1_meb_first_order(C, [](const Chan<eT>& sub) { return simplex_l1_min_enclosing_ball(sub, "lp"); });
+		} else {
+			throw std::runtime_error("the fo method is only available for floating types");
+		}
+	}
+
 	// q: N variables
 	lp::LinearProgram<eT> lp;
 	auto vars = lp.make_vars(N, eT(0), eT(1));
@@ -220,7 +766,7 @@ std::pair<eT,Prob<eT>> simplex_l1_min_enclosing_ball(const Chan<eT>& C, std::str
 		auto z = lp.make_var(eT(-2), eT(2));
 
 		arma::Col<eT> coeff(N);			// we only keep the coeff vector (b is implicit)
-		coeff.fill(eT(0));				// start with b = 00..0, coeff = (1,...,1)
+		coeff.fill(eT(1));				// start with b = 00..0, coeff = (1,...,1)
 
 		for(uint i = 0; i < N; ) {
 			// with a single multiplication we get cdot(coeff, row) for all rows.
@@ -266,38 +812,4 @@ std::pair<eT,Prob<eT>> simplex_l1_min_enclosing_ball(const Chan<eT>& C, std::str
 	return { lp.objective(), q };
 }
 
-// Computes the (euclidean) projection of vector x \in R^n onto the
-// n-simplex. That is, finds the point of the simplex that is closer  to x.
-// Uses the algorithm of:
-//    http://www.springerlink.com/content/q1636371674m36p1/
-//
-template<typename eT = eT_def>
-inline
-Prob<eT> simplex_project(Prob<eT> x) {
-	uint n = x.n_cols;
-	Row<char> done(n);
-	done.fill(0);
-
-	while(true) {
-		eT t = (arma::accu(x)-1)/n;
-		uint n1 = 0;
-
-		for(uint i = 0; i < x.n_cols; i++) {
-			if(done(i)) continue;
-
-			x(i) -= t;
-			if(eT(0) > x(i)) {
-				x(i) = eT(0);
-				done(i) = 1;
-				n1++;
-			}
-		}
-
-		if(n1 == 0) break;		// no negative elements
-		n -= n1;
-	}
-
-	return x;
-}
-
 } // namespace metric::optimize
\ No newline at end of file
@@ -0,0 +1,299 @@
+// BLAS threading control. The functions of OpenBLAS/MKL are declared weak, so they are null unless the BLAS that
+// armadillo links against actually provides them.
+//
+#if defined(__GNUC__) && !defined(_WIN32)
+extern "C" {
+	void openblas_set_num_threads(int) __attribute__((weak));
+	int openblas_get_num_threads() __attribute__((weak));
+	int openblas_set_num_threads_local(int) __attribute__((weak));		// OpenBLAS >= 0.3.27
+	void MKL_Set_Num_Threads(int) __attribute__((weak));
+	int MKL_Set_Num_Threads_Local(int) __attribute__((weak));
+}
+#define QIF_WEAK_BLAS
+#endif
+
+namespace parallel {
+
+namespace aux {
+
+// number of threads set by set_num_threads (0: one per hardware thread), and the per-thread override of ScopedThreads
+inline std::atomic<uint>& global_threads() {
+	static std::atomic<uint> n(0);
+	return n;
+}
+inline uint& scoped_threads() {
+	thread_local uint n = 0;
+	return n;
+}
+// true while the thread runs a job of the pool (or the caller's share of it), nested for_each calls are then sequential
+inline bool& in_parallel() {
+	thread_local bool b = false;
+	return b;
+}
+
+inline void blas_set_local_threads(int n) {
+	#ifdef QIF_WEAK_BLAS
+	if(MKL_Set_Num_Threads_Local)
+		MKL_Set_Num_Threads_Local(n);		// per-thread in MKL, 0 restores the global setting
+	#endif
+	(void)n;
+}
+
+// The global OpenBLAS setting, shared by blas_set_threads and BlasSerial. While a BlasSerial holds it at 1, a
+// set_n_threads only records the value, which BlasSerial restores at the end.
+//
+struct BlasGlobal {
+	std::mutex mutex;
+	bool serial = false;
+	int restore = 0;
+};
+inline BlasGlobal& blas_global() {
+	static BlasGlobal g;
+	return g;
+}
+
+inline void blas_set_threads(int n) {
+	#ifdef QIF_WEAK_BLAS
+	if(openblas_set_num_threads) {
+		BlasGlobal& g = blas_global();
+		std::lock_guard<std::mutex> lock(g.mutex);
+		if(g.serial)
+			g.restore = n;
+		else
+			openblas_set_num_threads(n);
+	}
+	if(MKL_Set_Num_Threads)
+		MKL_Set_Num_Threads(n);
+	#endif
+	(void)n;
+}
+
+// While for_each runs, the BLAS calls made by the workers are single-threaded, otherwise every worker would start its
+// own BLAS threads. The workers set this once, per thread (see Pool::worker); BlasSerial does it for the calling
+// thread, during the loop. MKL and OpenBLAS >= 0.3.27 have a per-thread setting. Older OpenBLAS versions only have a
+// global one, which BlasSerial then sets to 1 during the loop and restores afterwards. BLAS calls made by other threads
+// of the application at the same time also run single-threaded. The global change is serialised with set_n_threads
+// (see BlasGlobal), so a new thread count is never lost.
+//
+class BlasSerial {
+	public:
+		BlasSerial() {
+			#ifdef QIF_WEAK_BLAS
+			if(openblas_set_num_threads_local) {
+				prev_local = openblas_set_num_threads_local(1);
+			} else if(openblas_get_num_threads && openblas_set_num_threads) {
+				BlasGlobal& g = blas_global();
+				std::lock_guard<std::mutex> lock(g.mutex);
+				g.serial = true;
+				g.restore = openblas_get_num_threads();
+				openblas_set_num_threads(1);
+			}
+			#endif
+			blas_set_local_threads(1);
+		}
+		~BlasSerial() {
+			#ifdef QIF_WEAK_BLAS
+			if(openblas_set_num_threads_local) {
+				if(prev_local > 0)
+					openblas_set_num_threads_local(prev_local);
+			} else if(openblas_get_num_threads && openblas_set_num_threads) {
+				BlasGlobal& g = blas_global();
+				std::lock_guard<std::mutex> lock(g.mutex);
+				g.serial = false;
+				if(g.restore > 0)
+					openblas_set_num_threads(g.restore);
+			}
+			#endif
+			blas_set_local_threads(0);
+		}
+
+		BlasSerial(const BlasSerial&) = delete;
+		BlasSerial& operator=(const BlasSerial&) = delete;
+
+	private:
+		int prev_local = 0;
+};
+
+// Persistent worker threads, created on first use and reused by every for_each (starting threads costs tens of
+// microseconds, more than many of the loops take). The pool serves one job at a time: a for_each started while
+// another one is running (from a different thread) runs sequentially instead of waiting.
+//
+class Pool {
+	public:
+		static Pool& instance() {
+			static Pool pool;
+			return pool;
+		}
+
+		// runs work() in the calling thread and in n_helpers pool threads, returns after all of them finished.
+		// false if the pool is busy (nothing is run).
+		bool run(uint n_helpers, const std::function<void()>& work) {
+			std::unique_lock<std::mutex> busy(run_mutex, std::try_to_lock);
+			if(!busy)
+				return false;
+			BlasSerial blas;			// under run_mutex, so only one loop at a time changes the global OpenBLAS setting
+
+			while(threads.size() < n_helpers) {
+				uint index = threads.size();
+				threads.emplace_back([this, index] { worker(index); });
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				job = &work;
+				participants = n_helpers;
+				running = n_helpers;
+				generation++;
+			}
+			work_cv.notify_all();
+
+			{
+				InParallel guard;
+				work();
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			done_cv.wait(lock, [this] { return running == 0; });
+			job = nullptr;
+			return true;
+		}
+
+		~Pool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+			work_cv.notify_all();
+			for(auto& thread : threads)
+				thread.join();
+		}
+
+	private:
+		struct InParallel {
+			InParallel()  { in_parallel() = true; }
+			~InParallel() { in_parallel() = false; }
+		};
+
+		std::mutex run_mutex, mutex;
+		std::condition_variable work_cv, done_cv;
+		std::vector<std::thread> threads;
+		const std::function<void()>* job = nullptr;
+		uint participants = 0, running = 0;
+		uint64_t generation = 0;
+		bool stop = false;
+
+		Pool() {}
+
+		void worker(uint index) {
+			InParallel guard;
+			blas_set_local_threads(1);
+			#ifdef QIF_WEAK_BLAS
+			if(openblas_set_num_threads_local)
+				openblas_set_num_threads_local(1);
+			#endif
+
+			uint64_t seen = 0;
+			while(true) {
+				const std::function<void()>* cur;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					work_cv.wait(lock, [&] { return stop || (generation != seen && index < participants); });
+					if(stop)
+						return;
+					seen = generation;
+					cur = job;
+				}
+
+				(*cur)();
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if(--running == 0)
+					done_cv.notify_one();
+			}
+		}
+};
+
+} // namespace aux
+
+// Number of threads used by the parallel routines of the library: the ScopedThreads override of the calling thread
+// if any, otherwise the value of set_num_threads, by default one per hardware thread.
+//
+inline
+uint n_threads() {
+	uint n = aux::scoped_threads();
+	if(n == 0)
+		n = aux::global_threads();
+	if(n == 0)
+		n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+// Sets the number of threads of the library (0: one per hardware thread). The threads of OpenBLAS/MKL, used outside
+// the parallel routines, are set to the same number.
+//
+inline
+void set_n_threads(uint n) {
+	aux::global_threads() = n;
+	aux::blas_set_threads(n_threads());
+}
+
+// Overrides the number of threads for the calling thread while in scope, eg ScopedThreads single(1) to run a block
+// sequentially.
+//
+class ScopedThreads {
+	public:
+		explicit ScopedThreads(uint n) : prev(aux::scoped_threads()) { aux::scoped_threads() = n; }
+		~ScopedThreads() { aux::scoped_threads() = prev; }
+
+		ScopedThreads(const ScopedThreads&) = delete;
+		ScopedThreads& operator=(const ScopedThreads&) = delete;
+
+	private:
+		uint prev;
+};
+
+// Calls f(i) for every i in [0, n), distributing the indexes over n_threads() threads of the pool (the calling thread
+// included). Indexes are handed out dynamically, so uneven workloads are balanced. f must be safe to call
+// concurrently for different indexes. Calls nested in f, or made while the pool is busy, run sequentially.
+// The first exception thrown by f (if any) is rethrown in the calling thread, after all workers have stopped.
+//
+template<typename F>
+void for_each(uint n, F f) {
+	uint n_workers = aux::in_parallel() ? 1 : std::min(n_threads(), n);
+	auto sequential = [&]() {
+		for(uint i = 0; i < n; i++)
+			f(i);
+	};
+	if(n_workers <= 1)
+		return sequential();
+
+	std::atomic<uint> next(0);
+	std::atomic<bool> failed(false);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	std::function<void()> worker = [&]() {
+		for(uint i; !failed && (i = next++) < n; ) {
+			try {
+				f(i);
+			} catch(...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if(!failed)
+					error = std::current_exception();
+				failed = true;
+			}
+		}
+	};
+
+	if(!aux::Pool::instance().run(n_workers - 1, worker))
+		return sequential();
+
+	if(error)
+		std::rethrow_exception(error);
+}
+
+} // namespace parallel
+
+// library-level shortcuts
+inline void set_num_threads(uint n)	{ parallel::set_n_threads(n); }
+inline uint get_num_threads()		{ return parallel::n_threads(); }
@@ -0,0 +1,239 @@
+namespace pipeline {
+
+// Streaming pipelines: a source, any number of stages and a sink, connected by bounded queues, each running on its own
+// threads. Items flow through the pipeline as they are produced, so memory is bounded by the capacities of the
+// queues (times the item size), whatever the length of the stream. Items should be batches (eg. a few thousand
+// records), so that the cost of a queue operation is negligible.
+//
+//     pipeline::Queue<Batch> parsed(16);
+//     pipeline::Queue<Result> results(16);
+//     pipeline::Pipeline p;
+//     p.source(parsed, [&](auto& emit) { ... emit(std::move(batch)); ... });
+//     p.stage(parsed, results, 4, [&](Batch&& b) { return process(b); });        // 4 threads
+//     p.sink(results, [&](Result&& r) { write(r); });
+//     p.run();
+//
+// A stage with several threads processes its items concurrently, so its function must be safe to call concurrently,
+// and the order of the items is not preserved after it. The parallel routines of the library (parallel::for_each)
+// run sequentially inside the pipeline threads, the pipeline itself being the parallelism.
+//
+// If a source, stage or sink throws, all queues are cancelled, the other threads stop at their next queue operation,
+// and run() rethrows the first exception.
+//
+
+// Bounded multi-producer multi-consumer queue, lock-free (D. Vyukov's array queue): each cell has a sequence number
+// telling whether it is free for the push of its turn or full for the pop of its turn, producers and consumers claim
+// turns with a CAS on their own counter. The blocking push/pop spin briefly and then back off to short sleeps.
+//
+// The queue is closed when its last producer is done (see add_producers), pop then drains it and returns false.
+//
+template<typename T>
+class Queue {
+	public:
+		explicit Queue(size_t capacity) {
+			size_t n = 2;
+			while(n < capacity)
+				n *= 2;
+			mask = n - 1;
+			cells.reset(new Cell[n]);
+			for(size_t i = 0; i < n; i++)
+				cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+
+		Queue(const Queue&) = delete;
+		Queue& operator=(const Queue&) = delete;
+
+		size_t capacity() const { return mask + 1; }
+
+		// moves v into the queue, false if it is full
+		bool try_push(T& v) {
+			size_t pos = tail.load(std::memory_order_relaxed);
+			while(true) {
+				Cell& c = cells[pos & mask];
+				size_t seq = c.seq.load(std::memory_order_acquire);
+				intptr_t diff = intptr_t(seq) - intptr_t(pos);
+				if(diff == 0) {
+					if(tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						c.data = std::move(v);
+						c.seq.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				} else if(diff < 0) {
+					return false;								// the cell still holds the item of the previous round
+				} else {
+					pos = tail.load(std::memory_order_relaxed);	// another producer took the turn
+				}
+			}
+		}
+
+		// moves the next item into v, false if the queue is empty
+		bool try_pop(T& v) {
+			size_t pos = head.load(std::memory_order_relaxed);
+			while(true) {
+				Cell& c = cells[pos & mask];
+				size_t seq = c.seq.load(std::memory_order_acquire);
+				intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+				if(diff == 0) {
+					if(head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						v = std::move(c.data);
+						c.seq.store(pos + mask + 1, std::memory_order_release);
+						return true;
+					}
+				} else if(diff < 0) {
+					return false;
+				} else {
+					pos = head.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// waits for room, false if the queue was cancelled
+		bool push(T v) {
+			for(uint k = 0; !cancelled.load(std::memory_order_relaxed); k++) {
+				if(try_push(v))
+					return true;
+				backoff(k);
+			}
+			return false;
+		}
+
+		// waits for an item, false if the queue is closed and empty, or cancelled
+		bool pop(T& v) {
+			for(uint k = 0; !cancelled.load(std::memory_order_relaxed); k++) {
+				if(try_pop(v))
+					return true;
+				if(closed.load(std::memory_order_acquire))
+					return try_pop(v);			// pushes completed before the close
+				backoff(k);
+			}
+			return false;
+		}
+
+		// Producers register before starting, and call producer_done when finished, the last one closes the queue
+		void add_producers(uint n)	{ producers += n; }
+		void producer_done() {
+			if(--producers == 0)
+				closed.store(true, std::memory_order_release);
+		}
+
+		void cancel() { cancelled = true; }
+
+	private:
+		struct Cell {
+			std::atomic<size_t> seq;
+			T data;
+		};
+
+		std::unique_ptr<Cell[]> cells;
+		size_t mask;
+		alignas(64) std::atomic<size_t> head { 0 };
+		alignas(64) std::atomic<size_t> tail { 0 };
+		alignas(64) std::atomic<uint> producers { 0 };
+		std::atomic<bool> closed { false }, cancelled { false };
+
+		static void backoff(uint k) {
+			if(k < 64)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+};
+
+class Pipeline {
+	public:
+		Pipeline() = default;
+		Pipeline(const Pipeline&) = delete;
+		Pipeline& operator=(const Pipeline&) = delete;
+
+		// f(emit) produces the stream, calling emit(item) for each item. emit returns false if the pipeline was
+		// cancelled, f should then return.
+		template<typename Out, typename F>
+		Pipeline& source(Queue<Out>& out, F f) {
+			out.add_producers(1);
+			add_cancel(out);
+			threads.push_back([this, &out, f]() mutable {
+				auto emit = [&out](Out item) { return out.push(std::move(item)); };
+				guarded([&]() { f(emit); });
+				out.producer_done();
+			});
+			return *this;
+		}
+
+		// n_threads threads (0: parallel::n_threads()) calling f(In&&), returning the Out item for the next stage
+		template<typename In, typename Out, typename F>
+		Pipeline& stage(Queue<In>& in, Queue<Out>& out, uint n_threads, F f) {
+			if(n_threads == 0)
+				n_threads = parallel::n_threads();
+			out.add_producers(n_threads);
+			add_cancel(in);
+			add_cancel(out);
+			for(uint t = 0; t < n_threads; t++)
+				threads.push_back([this, &in, &out, f]() mutable {
+					guarded([&]() {
+						In item;
+						while(in.pop(item))
+							if(!out.push(f(std::move(item))))
+								break;
+					});
+					out.producer_done();
+				});
+			return *this;
+		}
+
+		// a single thread calling f(In&&) for every item reaching the end of the pipeline
+		template<typename In, typename F>
+		Pipeline& sink(Queue<In>& in, F f) {
+			add_cancel(in);
+			threads.push_back([this, &in, f]() mutable {
+				guarded([&]() {
+					In item;
+					while(in.pop(item))
+						f(std::move(item));
+				});
+			});
+			return *this;
+		}
+
+		// runs all threads until the stream is exhausted, rethrows the first exception of any of them
+		void run() {
+			std::vector<std::thread> running;
+			for(auto& body : threads)
+				running.emplace_back([&body]() {
+					parallel::ScopedThreads serial(1);
+					body();
+				});
+			for(auto& t : running)
+				t.join();
+			threads.clear();
+
+			if(error)
+				std::rethrow_exception(error);
+		}
+
+	private:
+		std::vector<std::function<void()>> threads;
+		std::vector<std::function<void()>> cancels;
+		std::exception_ptr error;
+		std::mutex error_mutex;
+
+		template<typename T>
+		void add_cancel(Queue<T>& q) {
+			cancels.push_back([&q]() { q.cancel(); });
+		}
+
+		template<typename B>
+		void guarded(B body) {
+			try {
+				body();
+			} catch(...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if(!error) {
+					error = std::current_exception();
+					for(auto& cancel : cancels)
+						cancel();
+				}
+			}
+		}
+};
+
+} // namespace pipeline
@@ -105,37 +105,87 @@ uint sample(const T& pi) {
 	return pi.n_cols - 1;
 }
 
-// sample multiple samples efficiently (with a single iteration over pi)
+// Walker's alias method (in Vose's variant): O(n) construction, then O(1) per draw, for any iterable pi (not necessarily
+// normalized). Thresholds are kept as doubles (also for rats). A draw uses a single 64-bit number from the generator
+// (eg rng::Engine): its high 32 bits select an element i, its low 32 bits choose between i and alias[i].
 //
-template<typename eT = eT_def, typename T = Prob<eT>>
-inline
-Row<uint> sample(const T& pi, uint n) {
-	// we need n numbers uniformly sampled in [0,1]. Sort them and keep the indexes of the sorted list in 'order'
-	Row<eT> ps(n);
-	ps.randu();
-	arma::uvec order = arma::sort_index(ps);
+class AliasSampler {
+	private:
+		std::vector<double> threshold;		// scaled to [0, 2^32]
+		std::vector<uint> alias;
+
+	public:
+		AliasSampler() {}
+
+		template<typename T>
+		explicit AliasSampler(const T& pi) {
+			std::vector<double> q;
+			double total = 0;
+			for(auto pi_it = pi.begin(); pi_it != pi.end(); ++pi_it) {
+				q.push_back(to_double(*pi_it));
+				total += q.back();
+			}
+			uint n = q.size();
+			if(n == 0 || !(total > 0)) throw std::runtime_error("cannot sample from an empty distribution");
+
+			std::vector<uint> small, large;
+			for(uint i = 0; i < n; i++) {
+				q[i] *= n / total;
+				(q[i] < 1 ? small : large).push_back(i);
+			}
+
+			threshold.assign(n, 1);
+			alias.resize(n);
+			for(uint i = 0; i < n; i++)
+				alias[i] = i;
+
+			while(!small.empty() && !large.empty()) {
+				uint s = small.back(), l = large.back();
+				small.pop_back();
+				threshold[s] = q[s];
+				alias[s] = l;
+				if((q[l] -= 1 - q[s]) < 1) {
+					large.pop_back();
+					small.push_back(l);
+				}
+			}
+			// whatever remains has q == 1 up to rounding, so it keeps threshold 1
+
+			for(auto& t : threshold)
+				t *= 4294967296.0;
+		}
 
-	eT accu(0);
-	int cur = -1;
-	auto pi_it = pi.begin();	// single iteration over pi for all samples
-	Row<uint> res(n);
-
-	// sample n elements. 
-	for(uint i = 0; i < n; i++) {
-		// we need to visit elements in sorted order of p
-		eT p = ps(order(i));
-
-		while(less_than(accu, p) && pi_it != pi.end()) {
-			accu += *pi_it;
-			pi_it++;
-			cur++;
+		inline uint n() const { return threshold.size(); }
+
+		template<typename G>
+		inline uint operator()(G& gen) const {
+			uint64_t r = gen();
+			uint i = uint(((r >> 32) * n()) >> 32);
+			return double(r & 0xffffffff) < threshold[i] ? i : alias[i];
 		}
 
-		// place the result in the same position in res as p was in ps.
-		res(order(i)) = cur;
-	}
+		// n draws into res (preallocated), generated in parallel from independent streams of seed
+		void fill(uint* res, size_t n, uint64_t seed) const {
+			rng::parallel_streams(n, seed, [&](rng::Engine& gen, size_t begin, size_t end) {
+				for(size_t k = begin; k < end; k++)
+					res[k] = (*this)(gen);
+			});
+		}
 
-	return res;
+		Row<uint> fill(uint n, uint64_t seed = rng::random_seed()) const {
+			Row<uint> res(n);
+			fill(res.memptr(), n, seed);
+			return res;
+		}
+};
+
+// sample multiple samples efficiently, via an alias table
+//
+template<typename eT = eT_def, typename T = Prob<eT>>
+inline
+Row<uint> sample(const T& pi, uint n) {
+	QIF_TRACE_SPAN("probab::sample");
+	return AliasSampler(pi).fill(n);
 }
 
 template<typename eT = eT_def>
@@ -0,0 +1,338 @@
+namespace rat_aux {
+
+// Performance helpers for rat (mppp::rational<1>).
+//
+// mp++ already stores integers of one limb inline (no allocation), what dominates rat arithmetic is the
+// canonicalization (gcd) after every operation, and the allocation of the matrices themselves (rat is not trivially
+// constructible, so arma_rat.h cannot use malloc). Two things are provided here:
+//
+//  - DotAccumulator: exact sums of products a_i b_i, kept in 128-bit machine integers while the operands have
+//    int64 numerators/denominators (the common case for channels from randomized_response, geometric with
+//    rational epsilons, deterministic, ...), falling back to mppp only on overflow.
+//  - Integer fast paths for the Bayes and g-vulnerability: the prior, channel (and gain) are rescaled to int64
+//    numerators over a common denominator, maxima and sums are computed in 128-bit integers, and a single rat is built
+//    at the end. They report failure if a denominator or an intermediate value overflows, the callers then use the
+//    mppp arithmetic.
+//  - Pool: a per-thread cache of rat arrays, used by arma_rat.h for memory::acquire/release.
+//
+
+// numerator and denominator of x, if both fit in int64
+inline
+bool get_small(const rat& x, int64_t& num, int64_t& den) {
+	return mppp::get(num, x.get_num()) && mppp::get(den, x.get_den());
+}
+
+#ifdef __SIZEOF_INT128__
+
+__extension__ typedef __int128 wide;			// __extension__: no -pedantic warning
+__extension__ typedef unsigned __int128 uwide;
+
+inline
+uwide gcd(uwide a, uwide b) {
+	while(b != 0) {
+		uwide t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+inline
+rat to_rat(wide num, wide den) {
+	// mppp::integer is built from two 64-bit halves, to avoid depending on mp++'s optional __int128 support
+	auto to_int = [](wide x) {
+		uwide u = x < 0 ? -uwide(x) : uwide(x);
+		mppp::integer<1> z(uint64_t(u >> 64));
+		z <<= 64;
+		z += uint64_t(u);
+		return x < 0 ? mppp::integer<1>(-z) : z;
+	};
+	return rat(to_int(num), to_int(den));	// canonicalizes
+}
+
+class DotAccumulator {
+	private:
+		wide num = 0, den = 1;					// part of the sum with small terms, reduced, den > 0
+		rat big, prod;							// part that overflowed (in mppp), product buffer
+
+		// num/den += pn/pd, false on overflow (the sum is then unchanged)
+		bool add_small(wide pn, wide pd) {
+			wide g = wide(gcd(uwide(den), uwide(pd))), n1, n2, d;
+			if(__builtin_mul_overflow(num, pd / g, &n1) ||
+			   __builtin_mul_overflow(pn, den / g, &n2) ||
+			   __builtin_add_overflow(n1, n2, &n1) ||
+			   __builtin_mul_overflow(den / g, pd, &d))
+				return false;
+
+			g = wide(gcd(n1 < 0 ? -uwide(n1) : uwide(n1), uwide(d)));		// g > 0 since d > 0
+			num = n1 / g;
+			den = d / g;
+			return true;
+		}
+
+	public:
+		// sum += a * b
+		void add(const rat& a, const rat& b) {
+			if(a.get_num().is_zero() || b.get_num().is_zero())
+				return;
+
+			int64_t an, ad, bn, bd;
+			if(get_small(a, an, ad) && get_small(b, bn, bd)) {
+				wide pn = wide(an) * bn, pd = wide(ad) * bd;		// cannot overflow
+				if(add_small(pn, pd))
+					return;
+
+				// move the small part to big and restart from zero, where adding pn/pd cannot overflow
+				mppp::add(big, big, to_rat(num, den));
+				num = 0;
+				den = 1;
+				add_small(pn, pd);
+				return;
+			}
+
+			mppp::mul(prod, a, b);
+			mppp::add(big, big, prod);
+		}
+
+		rat result() const {
+			return num == 0 ? big : big + to_rat(num, den);
+		}
+};
+
+// Common denominator form of the n rationals x: x[i] = num[i] / den, den > 0 being the lcm of their denominators.
+// False if some numerator/denominator does not fit in int64.
+//
+inline
+bool common_den(const rat* x, size_t n, std::vector<int64_t>& num, int64_t& den) {
+	int64_t xn, xd;
+	den = 1;
+	for(size_t i = 0; i < n; i++) {
+		if(!get_small(x[i], xn, xd))
+			return false;
+		if(den % xd != 0) {
+			int64_t g = int64_t(gcd(uwide(den), uwide(xd)));
+			if(__builtin_mul_overflow(den / g, xd, &den))
+				return false;
+		}
+	}
+
+	num.resize(n);
+	for(size_t i = 0; i < n; i++) {
+		get_small(x[i], xn, xd);
+		if(__builtin_mul_overflow(xn, den / xd, &num[i]))
+			return false;
+	}
+	return true;
+}
+
+// sum_y max_x pi[x] C[x,y], C being n_rows x n_cols in column-major order. The terms a_x c_xy of the numerators are
+// products of int64, so they fit in 128 bits, only the sum can overflow.
+//
+inline
+bool bayes_posterior(const rat* pi, const rat* C, uint n_rows, uint n_cols, rat& res) {
+	std::vector<int64_t> a, c;
+	int64_t p, q;
+	if(n_rows == 0 || !common_den(pi, n_rows, a, p) || !common_den(C, size_t(n_rows) * n_cols, c, q))
+		return false;
+
+	wide sum = 0;
+	for(uint y = 0; y < n_cols; y++) {
+		const int64_t* col = &c[size_t(y) * n_rows];
+		wide m = wide(a[0]) * col[0];
+		for(uint x = 1; x < n_rows; x++)
+			m = std::max(m, wide(a[x]) * col[x]);
+		if(__builtin_add_overflow(sum, m, &sum))
+			return false;
+	}
+	res = to_rat(sum, wide(p) * q);
+	return true;
+}
+
+// sum_y opt_w sum_x G[w,x] pi[x] C[x,y] (opt is max, or min if minimize), G being n_guesses x n_rows and C n_rows x
+// n_cols, both in column-major order. The products G[w,x] pi[x] are first combined in int64 numerators.
+//
+inline
+bool g_posterior(const rat* G, uint n_guesses, const rat* pi, const rat* C, uint n_rows, uint n_cols, bool minimize, rat& res) {
+	std::vector<int64_t> g, a, c;
+	int64_t r, p, q;
+	wide den;
+	if(n_guesses == 0 || !common_den(G, size_t(n_guesses) * n_rows, g, r) || !common_den(pi, n_rows, a, p) ||
+	   !common_den(C, size_t(n_rows) * n_cols, c, q) || __builtin_mul_overflow(wide(r) * p, wide(q), &den))
+		return false;
+
+	// GP[w,x] = g_wx a_x, column-major
+	std::vector<int64_t> GP(size_t(n_guesses) * n_rows);
+	for(uint x = 0; x < n_rows; x++)
+		for(uint w = 0; w < n_guesses; w++)
+			if(__builtin_mul_overflow(g[size_t(x) * n_guesses + w], a[x], &GP[size_t(x) * n_guesses + w]))
+				return false;
+
+	std::vector<wide> acc(n_guesses);
+	wide sum = 0;
+	for(uint y = 0; y < n_cols; y++) {
+		std::fill(acc.begin(), acc.end(), wide(0));
+		for(uint x = 0; x < n_rows; x++) {
+			int64_t cxy = c[size_t(y) * n_rows + x];
+			if(cxy == 0)
+				continue;
+			const int64_t* gp = &GP[size_t(x) * n_guesses];
+			for(uint w = 0; w < n_guesses; w++)
+				if(__builtin_add_overflow(acc[w], wide(gp[w]) * cxy, &acc[w]))
+					return false;
+		}
+		wide opt = minimize ? *std::min_element(acc.begin(), acc.end()) : *std::max_element(acc.begin(), acc.end());
+		if(__builtin_add_overflow(sum, opt, &sum))
+			return false;
+	}
+	res = to_rat(sum, den);
+	return true;
+}
+
+#else
+
+// no 128-bit integers, plain in-place accumulation
+class DotAccumulator {
+	private:
+		rat sum, prod;
+
+	public:
+		void add(const rat& a, const rat& b) {
+			if(a.get_num().is_zero() || b.get_num().is_zero())
+				return;
+			mppp::mul(prod, a, b);
+			mppp::add(sum, sum, prod);
+		}
+
+		rat result() const {
+			return sum;
+		}
+};
+
+// no 128-bit integers, the callers use the mppp arithmetic
+inline bool bayes_posterior(const rat*, const rat*, uint, uint, rat&)						{ return false; }
+inline bool g_posterior(const rat*, uint, const rat*, const rat*, uint, uint, bool, rat&)	{ return false; }
+
+#endif
+
+// Per-thread cache of rat arrays. Sizes up to max_elems are rounded up to a power of two (at least min_elems), and for
+// each size at most max_cached released arrays are kept, with their elements still constructed, so a matrix allocation
+// is most of the time a pop from a list instead of new[] (plus the construction of every element). The arrays kept by
+// a thread take at most max_cached_bytes (not counting the limbs of large elements), others are freed.
+// Arrays released by a different thread than the one that acquired them simply move to that thread's cache.
+//
+class Pool {
+	public:
+		static constexpr size_t max_cached_bytes = size_t(64) << 20;
+
+	private:
+		static constexpr size_t min_elems = 16, max_elems = size_t(1) << 20, max_cached = 8;
+		static constexpr uint n_classes = 17;					// 16, 32, ..., max_elems
+
+		struct alignas(std::max_align_t) Header {
+			size_t cap;
+			Header* next;
+		};
+
+		Header* free_list[n_classes] = {};
+		size_t n_free[n_classes] = {};
+		size_t cached_bytes = 0;
+
+		static uint class_of(size_t cap) {
+			uint c = 0;
+			for(size_t s = min_elems; s < cap; s <<= 1)
+				c++;
+			return c;
+		}
+		static rat* data(Header* h)				{ return reinterpret_cast<rat*>(h + 1); }
+		static Header* header(rat* mem)			{ return reinterpret_cast<Header*>(mem) - 1; }
+
+		static void destroy(Header* h) {
+			rat* mem = data(h);
+			for(size_t i = 0; i < h->cap; i++)
+				mem[i].~rat();
+			::operator delete(h);
+		}
+
+		// set when the thread's pool is destroyed (trivially destructible, so still valid afterwards), arrays released
+		// later (eg by static matrices at exit) are then freed directly
+		static bool& dead() {
+			thread_local bool d = false;
+			return d;
+		}
+
+		static Pool& local() {
+			thread_local Pool pool;
+			return pool;
+		}
+
+		~Pool() {
+			dead() = true;
+			for(uint c = 0; c < n_classes; c++)
+				while(Header* h = free_list[c]) {
+					free_list[c] = h->next;
+					destroy(h);
+				}
+		}
+
+	public:
+		// n elements, all equal to 0 (as with new[])
+		static rat* acquire(size_t n) {
+			size_t cap = min_elems;
+			while(cap < n && cap <= max_elems)
+				cap <<= 1;
+			if(cap > max_elems)
+				cap = n;									// not cached, no rounding
+
+			if(cap <= max_elems && !dead()) {
+				Pool& pool = local();
+				auto& free_list = pool.free_list;
+				auto& n_free = pool.n_free;
+				uint c = class_of(cap);
+				if(Header* h = free_list[c]) {
+					free_list[c] = h->next;
+					n_free[c]--;
+					pool.cached_bytes -= cap * sizeof(rat);
+					rat* mem = data(h);
+					for(size_t i = 0; i < n; i++)
+						mem[i] = 0;
+					return mem;
+				}
+			}
+
+			void* raw = ::operator new(sizeof(Header) + cap * sizeof(rat), std::nothrow);
+			if(!raw)
+				return nullptr;
+			Header* h = new(raw) Header { cap, nullptr };
+			rat* mem = data(h);
+			for(size_t i = 0; i < cap; i++)
+				new(mem + i) rat();
+			return mem;
+		}
+
+		static void release(rat* mem) {
+			if(!mem)
+				return;
+			Header* h = header(mem);
+			if(h->cap <= max_elems && !dead()) {
+				Pool& pool = local();
+				auto& free_list = pool.free_list;
+				auto& n_free = pool.n_free;
+				uint c = class_of(h->cap);
+				if(n_free[c] < max_cached && pool.cached_bytes + h->cap * sizeof(rat) <= max_cached_bytes) {
+					h->next = free_list[c];
+					free_list[c] = h;
+					n_free[c]++;
+					pool.cached_bytes += h->cap * sizeof(rat);
+					return;
+				}
+			}
+			destroy(h);
+		}
+
+		// bytes of the arrays kept by the calling thread
+		static size_t retained() {
+			return dead() ? 0 : local().cached_bytes;
+		}
+};
+
+} // namespace rat_aux
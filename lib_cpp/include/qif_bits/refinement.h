@@ -1,128 +1,629 @@
 
 namespace refinement {
 
+namespace aux {
+
+// random priors (besides the uniform) used by the Bayes vulnerability screen, and the tolerance of the screen for
+// floating types, matching the one of factorize_subgrad (so that the screen never refutes what factorize accepts)
+const uint screen_priors = 4;
+const double screen_md = 1e-4;
+
+// Bayes vulnerability of C under the uniform and screen_priors fixed pseudo-random priors
+template<typename eT>
+Row<eT> screen_values(const Chan<eT>& C) {
+	Row<eT> res(screen_priors + 1);
+	res(0) = measure::bayes_vuln::posterior(probab::uniform<eT>(C.n_rows), C);
+
+	for(uint k = 1; k <= screen_priors; k++) {
+		rng::Engine gen = rng::stream(0x5c4ee11, k);		// independent of the global seed, for reproducibility
+		Prob<eT> pi(C.n_rows);
+		for(uint x = 0; x < C.n_rows; x++)
+			pi(x) = eT(rng::randu<double>(gen));
+		pi /= arma::accu(pi);
+		res(k) = measure::bayes_vuln::posterior(pi, C);
+	}
+	return res;
+}
+
+// Necessary conditions on the supports for B = A X (X a channel): every column A_y used in B_z = sum_y X_yz A_y has
+// supp(A_y) in supp(B_z), so the union of such A_y must cover supp(B_z), and every non-zero A_y has to fit in some B_z
+// (its row of X sums to 1). Only meaningful with exact arithmetic.
+//
+template<typename eT>
+bool supports_compatible(const Chan<eT>& A, const Chan<eT>& B) {
+	uint n_words = (A.n_rows + 63) / 64;
+	auto supports = [n_words](const Chan<eT>& C) {
+		std::vector<uint64_t> S(size_t(C.n_cols) * n_words, 0);
+		for(uint j = 0; j < C.n_cols; j++)
+			for(uint x = 0; x < C.n_rows; x++)
+				if(C(x, j) != eT(0))
+					S[size_t(j) * n_words + x / 64] |= uint64_t(1) << (x % 64);
+		return S;
+	};
+	std::vector<uint64_t> SA = supports(A), SB = supports(B);
+
+	auto contained = [&](uint y, uint z) {
+		for(uint w = 0; w < n_words; w++)
+			if(SA[size_t(y) * n_words + w] & ~SB[size_t(z) * n_words + w])
+				return false;
+		return true;
+	};
+	auto is_zero = [n_words](const std::vector<uint64_t>& S, uint j) {
+		for(uint w = 0; w < n_words; w++)
+			if(S[size_t(j) * n_words + w])
+				return false;
+		return true;
+	};
+
+	std::vector<bool> used(A.n_cols, false);
+	std::vector<uint64_t> cover(n_words);
+	for(uint z = 0; z < B.n_cols; z++) {
+		std::fill(cover.begin(), cover.end(), 0);
+		for(uint y = 0; y < A.n_cols; y++) {
+			if(!is_zero(SA, y) && contained(y, z)) {
+				used[y] = true;
+				for(uint w = 0; w < n_words; w++)
+					cover[w] |= SA[size_t(y) * n_words + w];
+			}
+		}
+		for(uint w = 0; w < n_words; w++)
+			if(cover[w] != SB[size_t(z) * n_words + w])
+				return false;
+	}
+	for(uint y = 0; y < A.n_cols; y++)
+		if(!used[y] && !is_zero(SA, y))
+			return false;
+	return true;
+}
+
+// Decides refined_by(A, B) when one of the cheap tests applies, given the screen_values of A and B:
+// - false if B has larger Bayes vulnerability than A under some screened prior (or, for rat, incompatible supports)
+// - true if B is A itself or has a single column (no interference)
+// and returns nothing otherwise.
+//
+template<typename eT>
+std::optional<bool> screen(const Chan<eT>& A, const Chan<eT>& B, const Row<eT>& values_A, const Row<eT>& values_B) {
+	if(A.n_rows != B.n_rows)
+		throw std::runtime_error("invalid sizes");
+
+	const eT md = std::is_floating_point<eT>::value ? eT(screen_md) : eT(0);
+	for(uint k = 0; k < values_A.n_elem; k++)
+		if(!less_than_or_eq(values_B(k), values_A(k), md, eT(0)))
+			return false;
+
+	if constexpr (std::is_same<eT, rat>::value)
+		if(!supports_compatible(A, B))
+			return false;
+
+	if(B.n_cols == 1 || (A.n_cols == B.n_cols && channel::equal(A, B)))
+		return true;
+
+	return std::nullopt;
+}
+
+} // namespace aux
+
 // true if A is refined by B (i.e. A's leakage is >= B's)
 //
+// Cheap necessary conditions (Bayes vulnerability under a few priors, column supports for rat) are checked first, and
+// often refute refinement without solving the LP of factorize.
+//
 template<typename eT = eT_def>
 inline
 bool refined_by(const Chan<eT>& A, const Chan<eT>& B) {
+	if(auto res = aux::screen(A, B, aux::screen_values(A), aux::screen_values(B)))
+		return *res;
+
 	// true if AX = B for some X
 	auto X = channel::factorize(B, A);
 	return !X.empty();
 }
 
+namespace aux {
 
-// same as refined_by(A, B), using the method of projecting B to { AR | R } (via quadratic programming)
-// - if false, a counter-example G is given
-//   (i.e. a gain function such that A leaks strictly less than B for the uniform prior)
-// - also, the remapping channel R that minimizes the euclidean distance between AR and B is returned.
-//   When the function returns true, then AR = B holds.
-//
-// Note1: It should be possible to do the same thing by projecting wrt the manhattan norm (see Boyd 8.1.2).
-//        This can be done via LP so it will likely be faster
-// Note2: refined_by is equivalent to add_metric(uni, A, B) == 0, so this also gives an LP solution, but
-//        it turns out to be much slower than the projection method (although the latter is done via QP).
+// hash of the dimensions and contents of M (-0 and 0 hash the same)
+template<typename eT>
+uint64_t content_hash(const Mat<eT>& M) {
+	uint64_t h = 0xcbf29ce484222325 ^ ((uint64_t(M.n_rows) << 32) | M.n_cols);
+	auto mix = [&h](uint64_t v) { h ^= v + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2); };
+
+	for(uint i = 0; i < M.n_elem; i++) {
+		if constexpr (std::is_same<eT, rat>::value) {
+			mix(std::hash<rat>()(M(i)));
+		} else {
+			double v = M(i) == eT(0) ? 0.0 : double(M(i));
+			uint64_t bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			mix(bits);
+		}
+	}
+	return h;
+}
+
+// true if A and B have the same dimensions and elements (-0 and 0 are equal, as in content_hash)
+template<typename eT>
+bool same_contents(const Mat<eT>& A, const Mat<eT>& B) {
+	if(A.n_rows != B.n_rows || A.n_cols != B.n_cols)
+		return false;
+	for(uint i = 0; i < A.n_elem; i++)
+		if(!(A(i) == B(i)))
+			return false;
+	return true;
+}
+
+// maximum number of pairs kept by RefinementCache, the oldest ones are evicted first
+inline size_t refinement_cache_max_entries = 1 << 16;
+
+// Results of refined_by for pairs of channels, shared by all calls of lattice in the process. Entries are looked up by
+// (content_hash(A), content_hash(B)), and the channels themselves are kept (shared by all the entries of a channel) to
+// be compared on a hash match, so a collision never gives a wrong answer. At most refinement_cache_max_entries pairs
+// are kept.
 //
 template<typename eT>
-bool refined_by(const Chan<eT>& A, const Chan<eT>& B, Mat<eT>& G, Chan<eT>& R) {
-	if(A.n_rows != B.n_rows)
-		throw std::runtime_error("invalid sizes");
+class RefinementCache {
+	public:
+		typedef std::shared_ptr<const Chan<eT>> ChanPtr;
 
-	uint Cr = B.n_rows;
-	uint Cc = B.n_cols;
-	uint Rr = A.n_cols;
-	uint Rc = B.n_cols;
+		static RefinementCache& instance() {
+			static RefinementCache cache;
+			return cache;
+		}
 
-	// We want to find the point C=AR that is closest (in euclidean distance) to B.
-	// If it's B itself then B refines A, otherwise G=(B-C)^T is the gain function we want.
-	//
-	// The (squared) euclidean distance between C and B can be written as ("." is the dot product)
-	//   |C-B|_2^2 = (C-B).(C-B) = C.C -2B.C + B.B
-	// B.B is constant so we need to minimize C.C -2B.C
-	//
-	// We have 2 types of variables:
-	// - entries of C (Cr x Cc), constrained by C=AR
-	// - entries of R (Rr x Rc), constrained to form a channel
+		std::optional<bool> find(uint64_t ha, uint64_t hb, const Chan<eT>& A, const Chan<eT>& B) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto range = results.equal_range({ ha, hb });
+			for(auto it = range.first; it != range.second; ++it)
+				if(same_contents(*it->second.A, A) && same_contents(*it->second.B, B))
+					return it->second.result;
+			return std::nullopt;
+		}
 
-	qp::QuadraticProgram<eT> qp;
+		void insert(uint64_t ha, uint64_t hb, const ChanPtr& A, const ChanPtr& B, bool result) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if(refinement_cache_max_entries == 0)
+				return;
+			while(results.size() >= refinement_cache_max_entries) {
+				results.erase(order.front());
+				order.pop_front();
+			}
+			order.push_back(results.insert({ { ha, hb }, Entry{ A, B, result } }));
+		}
 
-	auto C = qp.make_vars(Cr, Cc);
-	auto RR = qp.make_vars(Rr, Rc);			// RR to distringuish from param R
+		size_t size() {
+			std::lock_guard<std::mutex> lock(mutex);
+			return results.size();
+		}
 
-	// constraints for C
-	for(uint x = 0; x < Cr; x++) {
-		for(uint z = 0; z < Cc; z++) {
-			// We need to add the constraint: C_xz - sum_y A_xy R_yz = 0
-			// C_xz has coeff 1, each R_yz has coeff - Axy, and the bounds are 0
-			//
-			auto con = qp.make_con(0, 0);
-			qp.set_con_coeff(con, C[x][z], 1);	// coeff of C_xz
+		void clear() {
+			std::lock_guard<std::mutex> lock(mutex);
+			results.clear();
+			order.clear();
+		}
 
-			for(uint y = 0; y < Rr; y++)
-				qp.set_con_coeff(con, RR[y][z], -A(x,y));	// coeff of R_yz
+	private:
+		struct Entry {
+			ChanPtr A, B;
+			bool result;
+		};
+		typedef std::multimap<std::pair<uint64_t, uint64_t>, Entry> Map;
+
+		std::mutex mutex;
+		Map results;
+		std::deque<typename Map::iterator> order;		// insertion order, for eviction
+};
+
+// Decides B = A X for a fixed A and many B. The LP (variables X, constraint coefficients from A) only depends on A
+// and the number of columns of B, which enters only via the constraint bounds; so it is built once and re-solved with
+// new bounds and a warm-started basis for each B of the same size. Large floating channels go through factorize
+// (subgradient), exactly as in refined_by.
+//
+template<typename eT>
+class Factorizer {
+	private:
+		const Chan<eT>& A;
+		lp::LinearProgram<eT> lp;
+		std::vector<std::vector<uint>> eq_cons;		// eq_cons[m][n]: constraint sum_r A(m,r) X(r,n) = B(m,n)
+		uint n_cols = 0;							// columns of the current LP (0: not built)
+
+		void build(uint N) {
+			uint M = A.n_rows, R = A.n_cols;
+			lp.clear();
+			lp.warm_start = true;
+			lp.clear_basis();
+
+			auto vars = lp.make_vars(R, N, eT(0), eT(1));
+			eq_cons.assign(M, std::vector<uint>(N));
+			for(uint m = 0; m < M; m++) {
+				for(uint n = 0; n < N; n++) {
+					eq_cons[m][n] = lp.make_con(eT(0), eT(0));
+					for(uint r = 0; r < R; r++)
+						lp.set_con_coeff(eq_cons[m][n], vars[r][n], A(m, r));
+				}
+			}
+			for(uint r = 0; r < R; r++) {
+				auto con = lp.make_con(eT(1), eT(1));
+				for(uint n = 0; n < N; n++)
+					lp.set_con_coeff(con, vars[r][n], eT(1));
+			}
+			n_cols = N;
 		}
-	}
 
-	// constraints for R
-	for(uint y = 0; y < Rr; y++) {
-		for(uint z = 0; z < Rc; z++) {
-			// We need to add the constraint: 0 <= R_yz <= 1
-			// R_yz has coeff 1, and the bounds are 0,1
-			//
-			auto con = qp.make_con(0, 1);
-			qp.set_con_coeff(con, RR[y][z], 1);
+	public:
+		explicit Factorizer(const Chan<eT>& A) : A(A) {}
+
+		bool operator()(const Chan<eT>& B) {
+			if(B.n_rows != A.n_rows)
+				return false;
+			if constexpr (!std::is_same<eT, rat>::value)
+				if(B.n_elem >= 1000)
+					return !channel::factorize(B, A).empty();
+
+			if(n_cols != B.n_cols)
+				build(B.n_cols);
+			for(uint m = 0; m < B.n_rows; m++)
+				for(uint n = 0; n < B.n_cols; n++)
+					lp.set_con_bounds(eq_cons[m][n], B(m, n), B(m, n));
+			return lp.solve();
 		}
+};
+
+// Square matrix of bits, rows stored as 64-bit words
+class BitMatrix {
+	private:
+		uint n_words;
+		std::vector<uint64_t> bits;
+
+	public:
+		explicit BitMatrix(uint n) : n_words((n + 63) / 64), bits(size_t(n) * n_words, 0) {}
+
+		bool get(uint i, uint j) const	{ return bits[size_t(i) * n_words + j / 64] >> (j % 64) & 1; }
+		void set(uint i, uint j)		{ bits[size_t(i) * n_words + j / 64] |= uint64_t(1) << (j % 64); }
+
+		// true if row i of this and row j of other have a common bit
+		bool intersects(uint i, const BitMatrix& other, uint j) const {
+			for(uint w = 0; w < n_words; w++)
+				if(bits[size_t(i) * n_words + w] & other.bits[size_t(j) * n_words + w])
+					return true;
+			return false;
+		}
+};
+
+// LPs of a lattice are solved concurrently only if the LP backend is thread-safe (GLPK is not, in general)
+#ifdef QIF_USE_GLPK
+const bool lattice_parallel_lp = false;
+#else
+const bool lattice_parallel_lp = true;
+#endif
 
-		// We need to add the constraint: sum_z R_yz = 1
-		// each R_yz has coeff 1, and the bounds are both 1
-		auto con = qp.make_con(1, 1);
+} // namespace aux
 
-		for(uint z = 0; z < Rc; z++)
-			qp.set_con_coeff(con, RR[y][z], 1);
+// The refinement relation among a set of channels, as a DAG:
+// - refined(i,j) = 1 iff Cs[i] is refined by Cs[j] (reflexive and transitive)
+// - cls(i) is the equivalence class of Cs[i] (channels refining each other), classes numbered by first appearance
+// - edges are the Hasse diagram on the classes: (a, b) if class a is refined by class b, with no class in between
+//
+struct Lattice {
+	arma::umat refined;
+	arma::uvec cls;
+	std::vector<std::pair<uint,uint>> edges;
+};
+
+// Computes the Lattice of Cs, with much fewer LPs than n^2 calls of refined_by:
+// - channels with the same contents are only processed once
+// - the screens of refined_by (with values computed once per channel) run in parallel over all pairs
+// - remaining pairs are first decided by transitivity when possible: i <= k <= j implies i <= j, while k <= i with
+//   k !<= j, or j <= k with i !<= k, implies i !<= j. Channels are processed in decreasing order of (uniform) Bayes
+//   vulnerability, so that the facts needed for these deductions tend to be known early
+// - the LPs of a fixed Cs[i] reuse the same program (see aux::Factorizer), rows are processed in parallel
+// - results are cached across calls, keyed by the contents of the channels (aux::RefinementCache)
+//
+template<typename eT>
+Lattice lattice(const std::vector<Chan<eT>>& Cs) {
+	uint N = Cs.size();
+
+	// distinct channels (compared on a hash match)
+	std::vector<uint64_t> hashes(N);
+	parallel::for_each(N, [&](uint i) { hashes[i] = aux::content_hash(Cs[i]); });
+
+	std::vector<uint> rep_of(N), reps;
+	std::map<uint64_t, std::vector<uint>> with_hash;		// the reps of each hash
+	for(uint i = 0; i < N; i++) {
+		auto& candidates = with_hash[hashes[i]];
+		auto it = std::find_if(candidates.begin(), candidates.end(), [&](uint a) { return aux::same_contents(Cs[reps[a]], Cs[i]); });
+		if(it == candidates.end()) {
+			candidates.push_back(reps.size());
+			rep_of[i] = reps.size();
+			reps.push_back(i);
+		} else
+			rep_of[i] = *it;
 	}
+	uint n = reps.size();
+
+	std::vector<Row<eT>> values(n);
+	parallel::for_each(n, [&](uint a) { values[a] = aux::screen_values(Cs[reps[a]]); });
+
+	// representatives in decreasing Bayes vulnerability
+	std::vector<uint> perm(n);
+	for(uint a = 0; a < n; a++)
+		perm[a] = a;
+	std::stable_sort(perm.begin(), perm.end(), [&](uint a, uint b) { return values[b](0) < values[a](0); });
+
+	// known facts, T/F(a,b): rep a is/isn't refined by rep b, Tt/Ft their transposes
+	aux::BitMatrix T(n), Tt(n), F(n), Ft(n);
+	std::mutex facts_mutex;
+	auto record = [&](uint a, uint b, bool r) {
+		if(r) { T.set(a, b); Tt.set(b, a); }
+		else  { F.set(a, b); Ft.set(b, a); }
+	};
+	auto known = [&](uint a, uint b) { return T.get(a, b) || F.get(a, b); };
+
+	// screens and cache, in parallel, each task writes to its own row, then facts are recorded serially
+	auto& cache = aux::RefinementCache<eT>::instance();
+
+	// the copies of the reps kept by the cache, made on their first insertion
+	std::vector<typename aux::RefinementCache<eT>::ChanPtr> shared_reps(n);
+	std::mutex shared_mutex;
+	auto shared = [&](uint a) {
+		std::lock_guard<std::mutex> lock(shared_mutex);
+		if(!shared_reps[a])
+			shared_reps[a] = std::make_shared<const Chan<eT>>(Cs[reps[a]]);
+		return shared_reps[a];
+	};
+	std::vector<std::vector<std::pair<uint,bool>>> screened(n);
+	parallel::for_each(n, [&](uint a) {
+		const Chan<eT>& A = Cs[reps[a]];
+		for(uint b = 0; b < n; b++) {
+			if(a == b) {
+				screened[a].push_back({ b, true });
+			} else if(auto r = aux::screen(A, Cs[reps[b]], values[a], values[b])) {
+				screened[a].push_back({ b, *r });
+			} else if(auto c = cache.find(hashes[reps[a]], hashes[reps[b]], A, Cs[reps[b]])) {
+				screened[a].push_back({ b, *c });
+			}
+		}
+	});
+	for(uint a = 0; a < n; a++)
+		for(auto [b, r] : screened[a])
+			record(a, b, r);
+
+	// the rest, in batches of rows. Pairs are deduced when possible while building the batch, using all facts so far
+	uint batch_rows = aux::lattice_parallel_lp ? parallel::n_threads() : 1;
+	for(uint first_row = 0; first_row < n; first_row += batch_rows) {
+		uint last_row = std::min(first_row + batch_rows, n);
+
+		std::vector<std::vector<uint>> todo(last_row - first_row);
+		for(uint p = first_row; p < last_row; p++) {
+			uint a = perm[p];
+			for(uint q = 0; q < n; q++) {
+				uint b = perm[q];
+				if(known(a, b))
+					continue;
+				if(T.intersects(a, Tt, b))
+					record(a, b, true);
+				else if(Tt.intersects(a, Ft, b) || T.intersects(b, F, a))
+					record(a, b, false);
+				else
+					todo[p - first_row].push_back(b);
+			}
+		}
 
-	// cost, quadratic part: C.C
-	// coeff 2 for the C variables (because of the 1/2 in the QP), 0 for the R variables
-	for(uint x = 0; x < Cr; x++)
-		for(uint z = 0; z < Cc; z++)
-			qp.set_obj_coeff(C[x][z], C[x][z], 2);
+		auto solve_row = [&](uint k) {
+			uint a = perm[first_row + k];
+			aux::Factorizer<eT> factorizer(Cs[reps[a]]);
+			for(uint b : todo[k]) {
+				{
+					std::lock_guard<std::mutex> lock(facts_mutex);	// may have been deduced by another row meanwhile
+					if(known(a, b))									// (only reads here, writes below, both locked)
+						continue;
+				}
+				bool r = factorizer(Cs[reps[b]]);
+				cache.insert(hashes[reps[a]], hashes[reps[b]], shared(a), shared(b), r);
+
+				std::lock_guard<std::mutex> lock(facts_mutex);
+				record(a, b, r);
+			}
+		};
+		if(aux::lattice_parallel_lp)
+			parallel::for_each(todo.size(), solve_row);
+		else
+			for(uint k = 0; k < todo.size(); k++)
+				solve_row(k);
+	}
 
-	// cost, linear part: -2BC
-	// coeffs -2B for the C variables, 0 for the R variables
-	for(uint x = 0; x < Cr; x++)
-		for(uint z = 0; z < Cc; z++)
-			qp.set_obj_coeff(C[x][z], -2 * B(x,z));
+	// equivalence classes of representatives, then of all channels
+	std::vector<uint> rep_cls(n, uint(-1));
+	uint n_cls = 0;
+	for(uint i = 0; i < N; i++) {
+		uint a = rep_of[i];
+		if(rep_cls[a] != uint(-1))
+			continue;
+		for(uint b = 0; b < n; b++)
+			if(T.get(a, b) && T.get(b, a))
+				rep_cls[b] = n_cls;
+		n_cls++;
+	}
 
-	// precision of the solution (Kostas: not 100% sure here)
-	// if no value is set by the user, use 1e-5 instead of OSQP's defaults
-	if(qp::Defaults::osqp_eps_abs < 0.0)	qp.osqp_eps_abs = 1e-5;
-	if(qp::Defaults::osqp_eps_rel < 0.0)	qp.osqp_eps_rel = 1e-5;
+	Lattice res;
+	res.refined.set_size(N, N);
+	res.cls.set_size(N);
+	for(uint i = 0; i < N; i++) {
+		res.cls(i) = rep_cls[rep_of[i]];
+		for(uint j = 0; j < N; j++)
+			res.refined(i, j) = T.get(rep_of[i], rep_of[j]);
+	}
 
-	// ready
-	if(!qp.solve())
-		throw std::runtime_error("refined_by: QP infeasible, this shouldn't happen");
-
-	// add B.B to the cost function to obtained the squared distance (see the program definition above)
-	eT dist = qp.objective() + arma::dot(B, B);
-
-	bool res = equal(dist, eT(0), eT(qp.osqp_eps_abs), eT(qp.osqp_eps_rel));
-	if(res) {
-		G.clear();
-	} else {
-		G.set_size(Cc, Cr);
-		for(uint x = 0; x < Cr; x++)
-			for(uint z = 0; z < Cc; z++)
-				G(z,x) = B(x,z) - qp.solution(C[x][z]);
-		G -= G.min();	// non-negative
-		G /= G.max();	// and in [0,1]
+	// Hasse diagram, on one representative per class
+	std::vector<uint> cls_rep(n_cls);
+	for(uint a = 0; a < n; a++)
+		cls_rep[rep_cls[a]] = a;
+	for(uint c = 0; c < n_cls; c++) {
+		for(uint d = 0; d < n_cls; d++) {
+			uint a = cls_rep[c], b = cls_rep[d];
+			if(c == d || !T.get(a, b))
+				continue;
+			bool between = false;
+			for(uint e = 0; e < n_cls && !between; e++)
+				between = e != c && e != d && T.get(a, cls_rep[e]) && T.get(cls_rep[e], b);
+			if(!between)
+				res.edges.push_back({ c, d });
+		}
 	}
+	return res;
+}
 
-	R.set_size(Rr, Rc);
-	for(uint y = 0; y < Rr; y++)
-		for(uint z = 0; z < Rc; z++)
-			R(y,z) = qp.solution(RR[y][z]);
+// The refinement order of Cs: res(i,j) = 1 iff Cs[i] is refined by Cs[j] (see lattice)
+//
+template<typename eT>
+arma::umat order(const std::vector<Chan<eT>>& Cs) {
+	return lattice(Cs).refined;
+}
 
-	return res;
+// Projects B to { AR | R } (in euclidean distance, via quadratic programming), for a fixed A and many B.
+// The QP only depends on A and the size of B, B itself enters only in the linear part of the cost. So the QP is built
+// once per number of columns of B and re-solved with OSQP's workspace kept (see QuadraticProgram::warm_start): the
+// factorization of the KKT system is reused and each solve starts from the solution for the previous B.
+//
+template<typename eT>
+class Projector {
+	private:
+		Chan<eT> A;
+		qp::QuadraticProgram<eT> qp;
+		std::vector<std::vector<uint>> C, RR;		// variables for C = AR and R
+		uint n_cols = 0;							// columns of the current QP (0: not built)
+
+		void build(uint Cc) {
+			uint Cr = A.n_rows;
+			uint Rr = A.n_cols;
+			uint Rc = Cc;
+
+			// We want to find the point C=AR that is closest (in euclidean distance) to B.
+			// If it's B itself then B refines A, otherwise G=(B-C)^T is the gain function we want.
+			//
+			// The (squared) euclidean distance between C and B can be written as ("." is the dot product)
+			//   |C-B|_2^2 = (C-B).(C-B) = C.C -2B.C + B.B
+			// B.B is constant so we need to minimize C.C -2B.C
+			//
+			// We have 2 types of variables:
+			// - entries of C (Cr x Cc), constrained by C=AR
+			// - entries of R (Rr x Rc), constrained to form a channel
+
+			qp.clear();
+			qp.warm_start = true;
+
+			C = qp.make_vars(Cr, Cc);
+			RR = qp.make_vars(Rr, Rc);			// RR to distringuish from param R
+
+			// constraints for C
+			for(uint x = 0; x < Cr; x++) {
+				for(uint z = 0; z < Cc; z++) {
+					// We need to add the constraint: C_xz - sum_y A_xy R_yz = 0
+					// C_xz has coeff 1, each R_yz has coeff - Axy, and the bounds are 0
+					//
+					auto con = qp.make_con(0, 0);
+					qp.set_con_coeff(con, C[x][z], 1);	// coeff of C_xz
+
+					for(uint y = 0; y < Rr; y++)
+						qp.set_con_coeff(con, RR[y][z], -A(x,y));	// coeff of R_yz
+				}
+			}
+
+			// constraints for R
+			for(uint y = 0; y < Rr; y++) {
+				for(uint z = 0; z < Rc; z++) {
+					// We need to add the constraint: 0 <= R_yz <= 1
+					// R_yz has coeff 1, and the bounds are 0,1
+					//
+					auto con = qp.make_con(0, 1);
+					qp.set_con_coeff(con, RR[y][z], 1);
+				}
+
+				// We need to add the constraint: sum_z R_yz = 1
+				// each R_yz has coeff 1, and the bounds are both 1
+				auto con = qp.make_con(1, 1);
+
+				for(uint z = 0; z < Rc; z++)
+					qp.set_con_coeff(con, RR[y][z], 1);
+			}
+
+			// cost, quadratic part: C.C
+			// coeff 2 for the C variables (because of the 1/2 in the QP), 0 for the R variables
+			for(uint x = 0; x < Cr; x++)
+				for(uint z = 0; z < Cc; z++)
+					qp.set_obj_coeff(C[x][z], C[x][z], 2);
+
+			// precision of the solution (Kostas: not 100% sure here)
+			// if no value is set by the user, use 1e-5 instead of OSQP's defaults
+			if(qp::Defaults::osqp_eps_abs < 0.0)	qp.osqp_eps_abs = 1e-5;
+			if(qp::Defaults::osqp_eps_rel < 0.0)	qp.osqp_eps_rel = 1e-5;
+
+			n_cols = Cc;
+		}
+
+	public:
+		explicit Projector(const Chan<eT>& A) : A(A) {}
+
+		// see refined_by(A, B, G, R)
+		bool operator()(const Chan<eT>& B, Mat<eT>& G, Chan<eT>& R) {
+			if(A.n_rows != B.n_rows)
+				throw std::runtime_error("invalid sizes");
+
+			uint Cr = B.n_rows;
+			uint Cc = B.n_cols;
+			uint Rr = A.n_cols;
+			uint Rc = B.n_cols;
+
+			if(n_cols != Cc)
+				build(Cc);
+
+			// cost, linear part: -2BC
+			// coeffs -2B for the C variables, 0 for the R variables
+			for(uint x = 0; x < Cr; x++)
+				for(uint z = 0; z < Cc; z++)
+					qp.set_obj_coeff(C[x][z], -2 * B(x,z));
+
+			// ready
+			if(!qp.solve())
+				throw std::runtime_error("refined_by: QP infeasible, this shouldn't happen");
+
+			// add B.B to the cost function to obtained the squared distance (see the program definition above)
+			eT dist = qp.objective() + arma::dot(B, B);
+
+			bool res = equal(dist, eT(0), eT(qp.osqp_eps_abs), eT(qp.osqp_eps_rel));
+			if(res) {
+				G.clear();
+			} else {
+				G.set_size(Cc, Cr);
+				for(uint x = 0; x < Cr; x++)
+					for(uint z = 0; z < Cc; z++)
+						G(z,x) = B(x,z) - qp.solution(C[x][z]);
+				G -= G.min();	// non-negative
+				G /= G.max();	// and in [0,1]
+			}
+
+			R.set_size(Rr, Rc);
+			for(uint y = 0; y < Rr; y++)
+				for(uint z = 0; z < Rc; z++)
+					R(y,z) = qp.solution(RR[y][z]);
+
+			return res;
+		}
+};
+
+// same as refined_by(A, B), using the method of projecting B to { AR | R } (via quadratic programming)
+// - if false, a counter-example G is given
+//   (i.e. a gain function such that A leaks strictly less than B for the uniform prior)
+// - also, the remapping channel R that minimizes the euclidean distance between AR and B is returned.
+//   When the function returns true, then AR = B holds.
+// To check many B's against the same A, use a Projector directly.
+//
+// Note1: It should be possible to do the same thing by projecting wrt the manhattan norm (see Boyd 8.1.2).
+//        This can be done via LP so it will likely be faster
+// Note2: refined_by is equivalent to add_metric(uni, A, B) == 0, so this also gives an LP solution, but
+//        it turns out to be much slower than the projection method (although the latter is done via QP).
+//
+template<typename eT>
+bool refined_by(const Chan<eT>& A, const Chan<eT>& B, Mat<eT>& G, Chan<eT>& R) {
+	return Projector<eT>(A)(B, G, R);
 }
 
 // same, without R
@@ -172,17 +673,42 @@ bool priv_refined_by(const Chan<eT>& A, const Chan<eT>& B) {
 
 
 
+namespace aux {
+
+// above this number of pairwise constraints, add_metric generates them lazily
+inline size_t add_metric_lazy_cons = 1 << 16;
+
+// violated constraints added per column of A in each round of the lazy generation
+const uint add_metric_cons_per_round = 4;
+
+} // namespace aux
+
+// The additive refinement metric: max_G V_G[pi,B] - V_G[pi,A] over 1-bounded gain functions, and a G attaining it
+// (one action per column of A, then per column of B, plus a last action of gain 0).
+//
+// V_G only depends on the hypers, so A and B are first reduced to their distinct posteriors (via hyper_compact,
+// merging identical and scaled columns, dropping zero-probability outputs), and secrets with pi(x) = 0 are dropped.
+// For large programs the "column y of A prefers action y over w" constraints are generated lazily: the program is
+// solved with the ones found so far (warm-started), and the most violated ones are added, until none is.
+//
 template<typename eT>
 std::pair<eT,Mat<eT>> add_metric(const Prob<eT>& pi, const Chan<eT>& A, const Chan<eT>& B) {
 	if(pi.n_elem != A.n_rows || A.n_rows != B.n_rows)
 		throw std::runtime_error("invalid sizes");
 
-	Mat<eT> AB = arma::join_rows(A, B);
-	uint K = A.n_rows,
-		 M = A.n_cols,
-		 N = B.n_cols;
+	arma::uvec inner_A, inner_B;
+	auto HA = channel::hyper_compact(A, pi, 1e-6, &inner_A),
+		 HB = channel::hyper_compact(B, pi, 1e-6, &inner_B);
+	arma::urowvec support = pi > eT(0);			// two steps for rat
+	arma::uvec xs = arma::find(support);
+
+	// joints of the reduced channels, on the support of pi
+	Mat<eT> AB = arma::join_rows(HA.inners.rows(xs), HB.inners.rows(xs));
+	AB.each_row() %= arma::join_rows(HA.outer, HB.outer);
 
-	assert(AB.n_rows == K && AB.n_cols == M+N);
+	uint K = xs.n_elem,
+		 M = HA.outer.n_elem,
+		 N = HB.outer.n_elem;
 
 	// vars: gain function (M+N)xK, bounded <= 1		(first for A, then for B)
 	lp::LinearProgram<eT> lp;
@@ -191,86 +717,212 @@ std::pair<eT,Mat<eT>> add_metric(const Prob<eT>& pi, const Chan<eT>& A, const Ch
 
 	// Objective function assumes each column gives a diffent best w
 	// maximize
-	// + sum_{M <= y < M+N} sum_x pi_x B_x,y g(y,x)
-	// - sum_{0 <= y < M  } sum_x pi_x A_x,y g(y,x)
+	// + sum_{M <= y < M+N} sum_x J_x,y g(y,x)
+	// - sum_{0 <= y < M  } sum_x J_x,y g(y,x)
 	//
 	for(uint y = 0; y < M+N; y++)
 		for(uint x = 0; x < K; x++)
-			lp.set_obj_coeff(vars[y][x], (y < M ? -1 : 1) * pi(x) * AB(x,y));
+			lp.set_obj_coeff(vars[y][x], (y < M ? -1 : 1) * AB(x,y));
 
-	// s.t. 
-	// sum_x pi_x A_x,y g(y,x)  >=  sum_x pi_x A_x,y g(w,x)       for all 0 <= y < M, w != y
+	// s.t.
+	// sum_x J_x,y g(y,x)  >=  sum_x J_x,y g(w,x)       for all 0 <= y < M, w != y
 	//
-	for(uint y = 0; y < M; y++) {
-		for(uint w = 0; w < M+N; w++) {
-			if(y == w) continue;
-
-			auto con = lp.make_con(eT(0), infinity<eT>());
-
-			for(uint x = 0; x < K; x++) {
-				lp.set_con_coeff(con, vars[y][x],   pi(x) * AB(x,y));
-				lp.set_con_coeff(con, vars[w][x], - pi(x) * AB(x,y));
-			}
+	auto set_pair_coeffs = [&](auto& prog, uint con, uint y, uint w) {
+		for(uint x = 0; x < K; x++) {
+			prog.set_con_coeff(con, vars[y][x],   AB(x,y));
+			prog.set_con_coeff(con, vars[w][x], - AB(x,y));
 		}
+	};
+
+	bool lazy = size_t(M) * (M+N-1) > aux::add_metric_lazy_cons;
+	if(!lazy) {
+		// These are M(M+N-1) constraints, generated in parallel (each block handles a range of y), unless the program
+		// would exceed the memory limit (see lp::SolveOptions)
+		lp.check_memory(uint64_t(M+N) * K, uint64_t(M) * (M+N), uint64_t(M) * (M+N-1) * 2 * K + uint64_t(M) * K);
+		uint n_blocks = std::min(M, 4 * parallel::n_threads());
+		lp.make_cons_parallel(n_blocks, [&](uint b, auto& block) {
+			uint first = b * M / n_blocks,
+				 last = (b + 1) * M / n_blocks;
+			block.reserve_con_coeffs(size_t(last - first) * (M+N-1) * 2 * K);
+
+			for(uint y = first; y < last; y++) {
+				for(uint w = 0; w < M+N; w++) {
+					if(y == w) continue;
+					set_pair_coeffs(block, block.make_con(eT(0), infinity<eT>()), y, w);
+				}
+			}
+		});
 	}
 
-	// sum_x pi_x A_x,y g(y,x)  >=  0       for all 0 <= y < M
+	// sum_x J_x,y g(y,x)  >=  0       for all 0 <= y < M
 	//
 	for(uint y = 0; y < M; y++) {
 		auto con = lp.make_con(eT(0), infinity<eT>());
 
 		for(uint x = 0; x < K; x++)
-			lp.set_con_coeff(con, vars[y][x], pi(x) * AB(x,y));
+			lp.set_con_coeff(con, vars[y][x], AB(x,y));
 	}
 
+	Mat<eT> Gs(M+N, K);
+	auto read_solution = [&]() {
+		for(uint w = 0; w < M+N; w++)
+			for(uint x = 0; x < K; x++)
+				Gs(w,x) = lp.solution(vars[w][x]);
+	};
+
 	// ready
+	lp.warm_start = lazy;
 	if(!lp.solve())
 		throw std::runtime_error("add_metric: LP infeasible, this shouldn't happen");
+	read_solution();
+
+	if(lazy) {
+		std::vector<std::vector<bool>> added(M, std::vector<bool>(M+N, false));
+		for(;;) {
+			// V(w,y): gain of action w on column y of A
+			Mat<eT> V = Gs * AB.cols(0, M-1);
+
+			uint n_added = 0;
+			for(uint y = 0; y < M; y++) {
+				std::vector<std::pair<eT,uint>> violated;
+				for(uint w = 0; w < M+N; w++)
+					if(w != y && !added[y][w] && less_than(V(y,y), V(w,y)))
+						violated.push_back({ V(w,y), w });
+
+				uint n = std::min<size_t>(violated.size(), aux::add_metric_cons_per_round);
+				std::partial_sort(violated.begin(), violated.begin() + n, violated.end(), [](auto& a, auto& b) { return b.first < a.first; });
+				for(uint i = 0; i < n; i++) {
+					uint w = violated[i].second;
+					set_pair_coeffs(lp, lp.make_con(eT(0), infinity<eT>()), y, w);
+					added[y][w] = true;
+					n_added++;
+				}
+			}
+			if(n_added == 0)
+				break;
 
-	// reconstrict gain function
-	Mat<eT> G(M+N+1, K);
-	G.row(M+N).fill(eT(0));
+			if(!lp.solve())
+				throw std::runtime_error("add_metric: LP infeasible, this shouldn't happen");
+			read_solution();
+		}
+	}
 
-	for(uint w = 0; w < M+N; w++)
+	// reconstrict gain function, in terms of the original columns and secrets (rows of merged columns are repeated,
+	// those of dropped ones are 0)
+	Mat<eT> G(A.n_cols + B.n_cols + 1, pi.n_elem, arma::fill::zeros);
+	auto copy_row = [&](uint w, arma::uword j) {
+		if(j == std::numeric_limits<arma::uword>::max())		// zero-probability column, action of gain 0
+			return;
 		for(uint x = 0; x < K; x++)
-			G(w,x) = lp.solution(vars[w][x]);
+			G(w, xs(x)) = Gs(j, x);
+	};
+	for(uint y = 0; y < A.n_cols; y++)
+		copy_row(y, inner_A(y));
+	for(uint z = 0; z < B.n_cols; z++)
+		copy_row(A.n_cols + z, M + inner_B(z));
 
 	return { lp.objective(), G };
 }
 
 
+namespace aux {
+
+// costs(i,j) = convex_separation_quasi(innersA.col(i), innersB.col(j)) = max(0, 1 - min_x b_x/a_x), the min over the
+// support of a. Computed one inner of A at a time, for all inners of B together.
+//
+template<typename eT>
+Mat<eT> convex_separation_costs(const Mat<eT>& innersA, const Mat<eT>& innersB) {
+	if(innersA.n_rows != innersB.n_rows)
+		throw std::runtime_error("size mismatch");
+
+	Mat<eT> res(innersA.n_cols, innersB.n_cols, arma::fill::zeros);
+	std::vector<arma::uword> supp;
+	for(uint i = 0; i < innersA.n_cols; i++) {
+		supp.clear();
+		for(uint x = 0; x < innersA.n_rows; x++)
+			if(!equal(innersA(x, i), eT(0)))
+				supp.push_back(x);
+		if(supp.empty())
+			continue;
+
+		arma::uvec s(supp);
+		Mat<eT> ratios = innersB.rows(s);
+		ratios.each_col() /= Col<eT>(innersA.col(i).elem(s));
+		Row<eT> min_ratio = arma::min(ratios, 0);
+
+		for(uint j = 0; j < innersB.n_cols; j++)
+			if(min_ratio(j) < eT(1))
+				res(i, j) = eT(1) - min_ratio(j);
+	}
+	return res;
+}
+
+} // namespace aux
+
+// Kantorovich distance between two compact hypers (see channel::hyper_compact), wrt the convex separation quasi-metric
+// on the inners (which gives the bound on the additive refinement metric below).
+//
+// The problem is solved directly as a transportation between the inners of HA and those of HB: the costs are computed
+// in a single pass (aux::convex_separation_costs), and the distance via metric::TransportSimplex, with buffers reused by
+// all calls of the same thread (falling back to the LP if the simplex does not converge). Note that FastEMD cannot be
+// used, the quasi-metric is neither symmetric nor a metric.
+//
+template<typename eT>
+eT hyper_kantorovich(const channel::Hyper<eT>& HA, const channel::Hyper<eT>& HB) {
+	Mat<eT> costs = aux::convex_separation_costs(HA.inners, HB.inners);
+
+	thread_local metric::TransportSimplex<eT> simplex;
+	if(simplex.solve(costs, HA.outer, HB.outer))
+		return simplex.objective();
+
+	// the LP on the joint space of inners, with zero mass for the inners of the other hyper
+	uint m = costs.n_rows, n = costs.n_cols;
+	Prob<eT> a = arma::join_rows(HA.outer, Prob<eT>(n, arma::fill::zeros)),
+			 b = arma::join_rows(Prob<eT>(m, arma::fill::zeros), HB.outer);
+	auto q = [&](uint i, uint j) -> eT { return i < m && j >= m ? costs(i, j - m) : eT(0); };
+	return metric::kantorovich_lp<eT, Prob<eT>>(q)(a, b);
+}
+
 // bound on the additive refinement metric for 1-bounded gain functions via the Kantorovich
 //
+// With max_gap > 0 (floating types only), the Kantorovich distance is approximated with Sinkhorn's algorithm, and the
+// upper end of its certified interval is returned (so the result is still a bound, at most max_gap larger than the
+// exact one). The regulariser is reduced until the interval is narrow enough, falling back to the exact solver.
+//
 template<typename eT>
-eT add_metric_bound(const Prob<eT>& pi, const Chan<eT>& A, const Chan<eT>& B) {
+eT add_metric_bound(const Prob<eT>& pi, const Chan<eT>& A, const Chan<eT>& B, eT max_gap = eT(0)) {
 	if(A.n_rows != B.n_rows)
 		throw std::runtime_error("invalid sizes");
 
-	auto [outerA, innersA] = channel::hyper(A, pi);
-	auto [outerB, innersB] = channel::hyper(B, pi);
-
-	// We need the distributions outerA, outerB to refer to the same 'space' of inners.
-	// So we put the inners together in the same matrix, and add zeroes on the right/left
-	// of outerA/outerB respectively.
-	//
-	Mat<eT> inners = arma::join_rows(innersA, innersB);
+	// compact hypers, so that the transportation problem only involves the distinct inners
+	auto HA = channel::hyper_compact(A, pi);
+	auto HB = channel::hyper_compact(B, pi);
 
-	outerA.insert_cols(outerA.n_elem, innersB.n_cols);	// add on the right as many zeroes as B's inners
-	outerB.insert_cols(0,             innersA.n_cols);	// add on the left  as many zeroes as A's inners
+	if constexpr (std::is_floating_point<eT>::value) {
+		if(max_gap > eT(0)) {
+			metric::Sinkhorn<eT> sink(aux::convex_separation_costs(HA.inners, HB.inners));
+			sink.log_domain = true;
 
-	// metric between the colums of A
-	auto q = metric::compose<eT,uint,Prob<eT>>(
-		metric::convex_separation_quasi<eT, Prob<eT>>(),
+			for(sink.reg = eT(1e-1); sink.reg >= eT(1e-4); sink.reg /= 10) {
+				auto [lower, upper] = sink.bounds(HA.outer, HB.outer);
+				if(upper(0) - lower(0) <= max_gap)
+					return upper(0);
+			}
+		}
+	}
 
-		[&](uint i) -> Prob<eT> { return inners.col(i).t(); }
-	);
+	return hyper_kantorovich(HA, HB);
+}
 
-	// Important: we need kantorovich_lp, cause kantorovich uses the FastEMD algorithm which assumes
-	// that q is a metric (but our convex_separation_quasi is not!)
-	// TODO: does it work if we 'metricify' q?
-	//
-	auto kant = metric::kantorovich_lp<eT,Prob<eT>>(q);
-	return kant(outerA, outerB);
+// add_metric_bound for many pairs of channels (pairs[k].first, pairs[k].second), computed in parallel
+//
+template<typename eT>
+Col<eT> add_metric_bounds(const Prob<eT>& pi, const std::vector<std::pair<Chan<eT>, Chan<eT>>>& pairs, eT max_gap = eT(0)) {
+	Col<eT> res(pairs.size());
+	parallel::for_each(pairs.size(), [&](uint k) {
+		res(k) = add_metric_bound(pi, pairs[k].first, pairs[k].second, max_gap);
+	});
+	return res;
 }
 
 
@@ -1,25 +1,144 @@
 
 namespace rng {
 
+// Philox4x32-10 counter-based generator (Salmon et al, Parallel random numbers: as easy as 1, 2, 3, SC 2011).
+// The i-th output of stream s under key seed is a pure function of (seed, s, i), so:
+//  - streams are independent and need no state to be shared between threads,
+//  - discard(n) jumps ahead in O(1).
+// Satisfies UniformRandomBitGenerator, producing 64-bit values (two per block of the 128-bit counter).
+//
+class Philox {
+	private:
+		uint32_t key[2];
+		uint64_t stream_id, block = 0;
+		uint64_t buf[2];
+		uint pos = 2;						// next unused element of buf (2 = empty)
+
+		void generate() {
+			uint32_t c[4] = { uint32_t(block), uint32_t(block >> 32), uint32_t(stream_id), uint32_t(stream_id >> 32) };
+			uint32_t k0 = key[0], k1 = key[1];
+
+			for(uint r = 0; r < 10; r++) {
+				uint64_t p0 = uint64_t(0xD2511F53) * c[0],
+						 p1 = uint64_t(0xCD9E8D57) * c[2];
+				c[0] = uint32_t(p1 >> 32) ^ c[1] ^ k0;
+				c[1] = uint32_t(p1);
+				c[2] = uint32_t(p0 >> 32) ^ c[3] ^ k1;
+				c[3] = uint32_t(p0);
+				k0 += 0x9E3779B9;
+				k1 += 0xBB67AE85;
+			}
+			buf[0] = (uint64_t(c[1]) << 32) | c[0];
+			buf[1] = (uint64_t(c[3]) << 32) | c[2];
+			block++;
+			pos = 0;
+		}
+
+	public:
+		typedef uint64_t result_type;
+
+		explicit Philox(uint64_t seed = 0, uint64_t stream_id = 0) : key { uint32_t(seed), uint32_t(seed >> 32) }, stream_id(stream_id) {}
+
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+		inline result_type operator()() {
+			if(pos == 2)
+				generate();
+			return buf[pos++];
+		}
+
+		// skip the next n outputs
+		void discard(uint64_t n) {
+			uint64_t next = 2 * block - (2 - pos) + n;		// index of the next output
+			block = next / 2;
+			pos = 2;
+			if(next % 2) {
+				generate();
+				pos = 1;
+			}
+		}
+};
+
+typedef Philox Engine;
+
+// stream(seed, id) is determined by (seed, id) only, so results do not depend on the number of threads
 inline
-void set_seed(uint seed) {
+Engine stream(uint64_t seed, uint64_t id) {
+	return Engine(seed, id);
+}
+
+namespace aux {
+	// The global seed (set by set_seed) and a counter of set_seed calls, so that the per-thread generators
+	// know when to restart.
+	inline std::atomic<uint64_t>& global_seed() { static std::atomic<uint64_t> s(5489); return s; }
+	inline std::atomic<uint64_t>& epoch()       { static std::atomic<uint64_t> e(0);    return e; }
+	inline std::atomic<uint64_t>& n_streams()   { static std::atomic<uint64_t> n(0);    return n; }
+
+	// The generator of the calling thread. Threads get consecutive stream ids in the order they first draw after
+	// set_seed, so the draws of a single-threaded program are fully determined by the seed.
+	inline Engine& thread_engine() {
+		thread_local Engine gen;
+		thread_local uint64_t gen_epoch = uint64_t(-1);
 
-	arma::arma_rng::set_seed(seed);
-	std::srand(seed);
+		uint64_t e = epoch();
+		if(gen_epoch != e) {
+			gen = stream(global_seed(), n_streams()++);
+			gen_epoch = e;
+		}
+		return gen;
+	}
+}
+
+inline
+void set_seed(uint64_t seed) {
+	aux::global_seed() = seed;
+	aux::n_streams() = 0;
+	aux::epoch()++;
+
+	arma::arma_rng::set_seed(arma::arma_rng::seed_type(seed));		// used by armadillo's randu/randn/randi
+	std::srand(unsigned(seed));
 }
 
 inline
 void set_seed_random() {
-	arma::arma_rng::set_seed_random();
+	std::random_device rd;
+	set_seed((uint64_t(rd()) << 32) ^ rd());
+}
 
-	arma::uvec v = arma::randi<arma::uvec>(1);
-	std::srand(v(0));
+// uniform in [0,1), using the mantissa bits of eT (so float never rounds to 1)
+template<typename eT, typename G>
+inline
+eT randu(G& gen) {
+	if constexpr (std::is_same<eT, float>::value)
+		return float(gen() >> 40) * 0x1p-24f;
+	else
+		return eT(double(gen() >> 11) * 0x1p-53);
 }
 
+// scalar draw from the calling thread's generator
 template<typename eT>
 eT
 randu() {
-	return Row<eT>(1).randu().at(0);		// use armadillo's rng
+	return randu<eT>(aux::thread_engine());
+}
+
+// a fresh seed drawn from the calling thread's generator (so it follows set_seed)
+inline
+uint64_t random_seed() {
+	return aux::thread_engine()();
+}
+
+// Calls f(gen, begin, end) for consecutive chunks covering [0, n), in parallel, each chunk with its own stream.
+// Chunks have a fixed size, so the draws only depend on seed (not on the number of threads).
+//
+template<typename F>
+void parallel_streams(size_t n, uint64_t seed, F f) {
+	const size_t chunk = 1 << 16;
+	parallel::for_each((n + chunk - 1) / chunk, [&](uint c) {
+		Engine gen = stream(seed, c);
+		f(gen, c * chunk, std::min(n, (c + 1) * chunk));
+	});
 }
 
 }
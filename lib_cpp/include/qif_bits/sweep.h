@@ -0,0 +1,604 @@
+namespace sweep {
+
+// Parameter sweeps (eg. a mechanism evaluated for all combinations of some epsilons, grid sizes and priors), run in
+// the threads of this process or spread over several processes and nodes.
+//
+// A Grid is the cartesian product of named parameter axes, each of its points is a task identified by its index. The
+// task function f(params) returns a matrix (a channel, or a row of measurements), stored in the binary format (see
+// binary::save) as result_file(dir, id). Results are written to a temporary name and then renamed, and tasks that
+// already have a result are skipped, so an interrupted sweep is resumed by simply running it again. aggregate()
+// collects the results of all tasks in a single matrix.
+//
+// Distribution uses a simple TCP work queue: one process runs a Server on the grid, which hands out tasks to any
+// number of worker processes running work() with the same task function (on nodes sharing dir, eg. over NFS). A task
+// that throws is retried up to max_retries times, and a task handed to a worker that does not report back within the
+// lease time (a crashed or pre-empted node) is handed out again. Under MPI, rank 0 can run the Server and the other
+// ranks work(). The Server listens on loopback only, unless Options::bind_address is set (eg. "0.0.0.0" or the address
+// of the cluster interface) for workers on other nodes. A non-empty Options::token, the same on the server and the
+// workers, is then required from every connection. The protocol is plain text (the token is sent in clear), meant
+// for trusted cluster networks.
+//
+//     sweep::Grid grid;
+//     grid.add("epsilon", { 0.1, 0.5, 1 }).add("width", { 10, 20, 40 });
+//     auto f = [](const sweep::Params& p) { ... return Mat<double>(...); };
+//
+//     sweep::run<double>(grid, f, "out");                        // all tasks in this process, or
+//     sweep::Server(grid, "out", 5555).run();                     // on the coordinator, and
+//     sweep::work<double>("coordinator", 5555, f, "out");         // on each worker
+//
+//     binary::save("sweep.bin", sweep::aggregate<double>(grid, "out"));
+//
+
+typedef std::map<std::string, double> Params;
+
+template<typename eT>
+using Task = std::function<Mat<eT>(const Params&)>;
+
+struct Options {
+	uint max_retries = 2;			// extra attempts of a task that throws
+	double lease = 3600;			// seconds after which a task handed to a worker is given to another one (Server)
+	double connect_timeout = 60;	// seconds a worker keeps trying to reach the server (work)
+	std::string bind_address = "127.0.0.1";	// address the Server listens on, "" for all interfaces
+	std::string token;				// shared secret of the Server and its workers, no whitespace ("" for none)
+};
+
+struct Report {
+	std::vector<uint> done, failed;			// task ids, done includes the tasks that already had a result
+	std::map<uint, std::string> errors;		// last error of each failed task
+};
+
+class Grid {
+	public:
+		// Adds an axis, varying slower than all axes added after it (tasks are numbered as nested loops over the
+		// axes, in the order they were added)
+		Grid& add(const std::string& name, const std::vector<double>& values) {
+			if(name.empty() || name.find_first_of(" \t\r\n=") != std::string::npos)
+				throw std::runtime_error("invalid parameter name '" + name + "'");
+			if(values.empty())
+				throw std::runtime_error("no values for parameter " + name);
+			if(std::find(axes.begin(), axes.end(), name) != axes.end())
+				throw std::runtime_error("duplicate parameter " + name);
+
+			axes.push_back(name);
+			axis_values.push_back(values);
+			return *this;
+		}
+
+		uint size() const {
+			uint res = 1;
+			for(auto& v : axis_values)
+				res *= v.size();
+			return res;
+		}
+
+		const std::vector<std::string>& names() const { return axes; }
+
+		Params operator[](uint id) const {
+			if(id >= size())
+				throw std::runtime_error("invalid task id " + std::to_string(id));
+
+			Params res;
+			for(uint a = axes.size(); a-- > 0; ) {
+				res[axes[a]] = axis_values[a][id % axis_values[a].size()];
+				id /= axis_values[a].size();
+			}
+			return res;
+		}
+
+		// the parameters of task id, in the order of the axes
+		std::vector<double> values(uint id) const {
+			Params p = (*this)[id];
+			std::vector<double> res;
+			for(auto& name : axes)
+				res.push_back(p[name]);
+			return res;
+		}
+
+	private:
+		std::vector<std::string> axes;
+		std::vector<std::vector<double>> axis_values;
+};
+
+inline std::string result_file(const std::string& dir, uint id) {
+	std::ostringstream name;
+	name << "task_" << std::setw(6) << std::setfill('0') << id << ".bin";
+	return (std::filesystem::path(dir) / name.str()).string();
+}
+
+inline bool has_result(const std::string& dir, uint id) {
+	std::error_code ec;
+	return std::filesystem::exists(result_file(dir, id), ec);
+}
+
+template<typename eT>
+Mat<eT> load_result(const std::string& dir, uint id) {
+	return binary::load<eT>(result_file(dir, id));
+}
+
+namespace aux {
+
+inline double now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename eT>
+void write_result(const std::string& dir, uint id, const Mat<eT>& M) {
+	namespace fs = std::filesystem;
+
+	// unique temporary name in the same directory, so that the rename is atomic
+	std::ostringstream tmp_name;
+	tmp_name << fs::path(result_file(dir, id)).filename().string() << ".tmp-" << rng::random_seed();
+	const fs::path tmp = fs::path(dir) / tmp_name.str();
+
+	try {
+		fs::create_directories(dir);
+		binary::save(tmp.string(), M);
+		fs::rename(tmp, result_file(dir, id));
+	} catch(std::exception&) {
+		std::error_code ec;
+		fs::remove(tmp, ec);
+		throw;
+	}
+}
+
+// runs task id, with retries, returning the last error ("" on success)
+template<typename eT>
+std::string run_task(const Grid& grid, const Task<eT>& f, const std::string& dir, uint id, uint attempts) {
+	std::string error;
+	for(uint a = 0; a < attempts; a++) {
+		try {
+			write_result(dir, id, f(grid[id]));
+			return "";
+		} catch(std::exception& e) {
+			error = e.what();
+			if(error.empty())
+				error = "unknown error";
+		}
+	}
+	return error;
+}
+
+inline std::string format_params(const Params& p) {
+	std::ostringstream out;
+	out << std::setprecision(17);
+	for(auto& [name, value] : p)
+		out << " " << name << "=" << value;
+	return out.str();
+}
+
+inline Params parse_params(std::istringstream& in) {
+	Params res;
+	std::string item;
+	while(in >> item) {
+		size_t eq = item.find('=');
+		if(eq == std::string::npos)
+			throw std::runtime_error("sweep: malformed message");
+		res[item.substr(0, eq)] = std::stod(item.substr(eq + 1));
+	}
+	return res;
+}
+
+// Bookkeeping of the tasks of a Server: each one is pending, running (handed to a worker at some time), done or failed
+//
+class Queue {
+	public:
+		Queue(const std::vector<uint>& ids, uint max_retries, double lease) : max_retries(max_retries), lease(lease) {
+			for(uint id : ids) {
+				tasks[id] = {};
+				pending.push_back(id);
+			}
+		}
+
+		// a task to run at time t (a pending one, or one whose lease expired), if any
+		std::optional<uint> next(double t) {
+			for(auto& [id, s] : tasks)
+				if(s.status == Status::running && t - s.since > lease) {
+					s.status = Status::pending;
+					s.error = "lease expired";
+					if(s.attempts > max_retries)
+						s.status = Status::failed;
+					else
+						pending.push_back(id);
+				}
+
+			if(pending.empty())
+				return {};
+			uint id = pending.front();
+			pending.pop_front();
+
+			State& s = tasks[id];
+			s.status = Status::running;
+			s.since = t;
+			s.attempts++;
+			return id;
+		}
+
+		void done(uint id) {
+			auto it = tasks.find(id);
+			if(it == tasks.end())
+				return;
+			if(it->second.status == Status::pending)			// re-queued after its lease expired, but finished after all
+				pending.erase(std::find(pending.begin(), pending.end(), id));
+			it->second.status = Status::done;
+		}
+
+		// a task handed out whose TASK message could not be delivered, back to the front of the queue
+		void release(uint id) {
+			auto it = tasks.find(id);
+			if(it == tasks.end() || it->second.status != Status::running)
+				return;
+			it->second.status = Status::pending;
+			it->second.attempts--;
+			pending.push_front(id);
+		}
+
+		void fail(uint id, const std::string& error) {
+			auto it = tasks.find(id);
+			if(it == tasks.end() || it->second.status != Status::running)
+				return;
+			State& s = it->second;
+			s.error = error;
+			if(s.attempts > max_retries) {
+				s.status = Status::failed;
+			} else {
+				s.status = Status::pending;
+				pending.push_back(id);
+			}
+		}
+
+		bool finished() const {
+			for(auto& [id, s] : tasks)
+				if(s.status == Status::pending || s.status == Status::running)
+					return false;
+			return true;
+		}
+
+		// adds the done/failed tasks to r
+		void report(Report& r) const {
+			for(auto& [id, s] : tasks) {
+				if(s.status == Status::done)
+					r.done.push_back(id);
+				else if(s.status == Status::failed) {
+					r.failed.push_back(id);
+					r.errors[id] = s.error;
+				}
+			}
+		}
+
+	private:
+		enum class Status { pending, running, done, failed };
+		struct State {
+			Status status = Status::pending;
+			uint attempts = 0;
+			double since = 0;
+			std::string error;
+		};
+
+		uint max_retries;
+		double lease;
+		std::map<uint, State> tasks;
+		std::deque<uint> pending;
+};
+
+// TCP connections carrying one line per message, implemented in src/sweep.cpp (POSIX sockets, not available on
+// other platforms)
+//
+class Connection {
+	public:
+		explicit Connection(int fd);
+		~Connection();
+		Connection(const Connection&) = delete;
+		Connection& operator=(const Connection&) = delete;
+
+		std::string read_line();						// throws on timeout or closed connection
+		void write_line(const std::string& line);
+
+	private:
+		int fd;
+		std::string buffer;
+};
+
+class Listener {
+	public:
+		// port 0: any free port. address is numeric (IPv4 or IPv6), "" for all interfaces
+		Listener(uint16_t port, const std::string& address);
+		~Listener();
+		Listener(const Listener&) = delete;
+		Listener& operator=(const Listener&) = delete;
+
+		uint16_t port() const { return bound_port; }
+		std::unique_ptr<Connection> accept(double timeout);	// nullptr on timeout
+
+	private:
+		int fd;
+		uint16_t bound_port;
+};
+
+std::unique_ptr<Connection> connect(const std::string& host, uint16_t port);		// nullptr if unreachable
+
+inline void check_token(const std::string& token) {
+	if(token.find_first_of(" \t\r\n") != std::string::npos)
+		throw std::runtime_error("sweep: the token cannot contain whitespace");
+}
+
+// sends line to the server (preceded by AUTH <token> if token is not empty) and returns its reply, trying to connect
+// for up to timeout seconds ("" if unreachable)
+inline std::string request(const std::string& host, uint16_t port, const std::string& line, double timeout, const std::string& token = "") {
+	double start = now();
+	while(true) {
+		try {
+			if(auto conn = connect(host, port)) {
+				if(!token.empty())
+					conn->write_line("AUTH " + token);
+				conn->write_line(line);
+				return conn->read_line();
+			}
+		} catch(std::runtime_error&) {
+			// connection dropped, try again
+		}
+		if(now() - start >= timeout)
+			return "";
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}
+}
+
+} // namespace aux
+
+// Runs all tasks of the grid without a result in dir, in the threads of this process (see parallel::for_each)
+//
+template<typename eT>
+Report run(const Grid& grid, const Task<eT>& f, const std::string& dir, const Options& opt = {}) {
+	Report res;
+	std::vector<uint> todo;
+	for(uint id = 0; id < grid.size(); id++)
+		(has_result(dir, id) ? res.done : todo).push_back(id);
+
+	std::vector<std::string> errors(todo.size());
+	parallel::for_each(todo.size(), [&](uint i) {
+		errors[i] = aux::run_task(grid, f, dir, todo[i], opt.max_retries + 1);
+	});
+
+	for(uint i = 0; i < todo.size(); i++) {
+		if(errors[i].empty()) {
+			res.done.push_back(todo[i]);
+		} else {
+			res.failed.push_back(todo[i]);
+			res.errors[todo[i]] = errors[i];
+		}
+	}
+	std::sort(res.done.begin(), res.done.end());
+	return res;
+}
+
+// Coordinator of a distributed sweep: hands out the tasks of the grid without a result in dir to the workers that
+// connect to it. run() returns when every task is done or has failed.
+//
+// Messages (one line each, preceded by AUTH <token> if Options::token is set; the server replies to every message and
+// closes the connection):
+//     GET                   ->  TASK <id> <name>=<value> ...  |  WAIT <seconds>  |  DONE
+//     OK <id>               ->  ACK
+//     FAIL <id> <error>     ->  ACK
+//
+// Each connection is served in its own thread, so a silent client only holds its own connection (until the io
+// timeout). A task is done only once its OK is received and its result in dir is a valid matrix file, otherwise it
+// counts as a failed attempt.
+//
+class Server {
+	public:
+		Server(const Grid& grid, const std::string& dir, uint16_t port, const Options& opt = {})
+			: grid(grid), opt(opt), dir(dir), listener(port, opt.bind_address), queue(todo(grid, dir), opt.max_retries, opt.lease) {
+			aux::check_token(opt.token);
+		}
+
+		uint16_t port() const { return listener.port(); }
+
+		Report run() {
+			std::list<std::future<void>> handlers;
+			auto spawn = [&](std::unique_ptr<aux::Connection> conn) {
+				std::shared_ptr<aux::Connection> c(std::move(conn));
+				handlers.push_back(std::async(std::launch::async, [this, c] {
+					try {
+						handle(*c);
+					} catch(std::runtime_error&) {
+						// a worker that disconnects or sends garbage is ignored, its task will be handed out again
+					}
+				}));
+			};
+			auto prune = [&] {
+				handlers.remove_if([](std::future<void>& h) { return h.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+			};
+
+			while(!finished()) {
+				if(auto conn = listener.accept(1))
+					spawn(std::move(conn));
+				prune();
+			}
+
+			// keep answering for a while, so that waiting workers learn that the sweep is over
+			for(double end = aux::now() + 2; aux::now() < end; ) {
+				if(auto conn = listener.accept(0.2))
+					spawn(std::move(conn));
+				prune();
+			}
+			handlers.clear();			// waits for the remaining connections
+
+			Report res = existing;
+			queue.report(res);
+			std::sort(res.done.begin(), res.done.end());
+			return res;
+		}
+
+	private:
+		Grid grid;
+		Options opt;
+		std::string dir;
+		Report existing;
+		aux::Listener listener;
+		aux::Queue queue;
+		std::mutex mutex;			// protects queue
+
+		std::vector<uint> todo(const Grid& grid, const std::string& dir) {
+			std::vector<uint> res;
+			for(uint id = 0; id < grid.size(); id++)
+				(has_result(dir, id) ? existing.done : res).push_back(id);
+			return res;
+		}
+
+		bool finished() {
+			std::lock_guard<std::mutex> lock(mutex);
+			return queue.finished();
+		}
+
+		// the result of task id is a complete matrix file (binary::elem_type checks the header and the size)
+		bool valid_result(uint id) {
+			try {
+				binary::elem_type(result_file(dir, id));
+				return true;
+			} catch(std::exception&) {
+				return false;
+			}
+		}
+
+		void handle(aux::Connection& conn) {
+			std::string line = conn.read_line();
+			if(!opt.token.empty()) {
+				// compared without stopping at the first difference
+				const std::string expected = "AUTH " + opt.token;
+				unsigned char diff = line.size() != expected.size();
+				for(size_t i = 0; i < line.size() && i < expected.size(); i++)
+					diff |= line[i] ^ expected[i];
+				if(diff)
+					throw std::runtime_error("sweep: unauthenticated connection");
+				line = conn.read_line();
+			}
+
+			std::istringstream in(line);
+			std::string cmd;
+			in >> cmd;
+
+			if(cmd == "GET") {
+				std::optional<uint> id;
+				bool done;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					id = queue.next(aux::now());
+					done = queue.finished();
+				}
+				if(!id) {
+					conn.write_line(done ? "DONE" : "WAIT 1");
+					return;
+				}
+				try {
+					conn.write_line("TASK " + std::to_string(*id) + aux::format_params(grid[*id]));
+				} catch(std::runtime_error&) {
+					std::lock_guard<std::mutex> lock(mutex);
+					queue.release(*id);			// never reached the worker
+					throw;
+				}
+
+			} else if(cmd == "OK" || cmd == "FAIL") {
+				uint id;
+				if(!(in >> id))
+					throw std::runtime_error("sweep: malformed message");
+				std::string error;
+				if(cmd == "OK") {
+					std::string extra;
+					if(in >> extra)
+						throw std::runtime_error("sweep: malformed message");
+					if(!valid_result(id))
+						error = "missing or invalid result";
+				} else {
+					std::getline(in >> std::ws, error);
+					if(error.empty())
+						error = "unknown error";
+				}
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if(error.empty())
+						queue.done(id);
+					else
+						queue.fail(id, error);
+				}
+				conn.write_line("ACK");
+
+			} else {
+				throw std::runtime_error("sweep: unknown message");
+			}
+		}
+};
+
+inline Report serve(const Grid& grid, const std::string& dir, uint16_t port, const Options& opt = {}) {
+	return Server(grid, dir, port, opt).run();
+}
+
+// Worker of a distributed sweep: runs the tasks handed out by the server at host:port, writing their results to dir,
+// until the sweep is over (or the server is unreachable for connect_timeout seconds). Returns the number of tasks
+// completed by this worker. Several workers can run in the same process (eg. one per thread).
+//
+template<typename eT>
+uint work(const std::string& host, uint16_t port, const Task<eT>& f, const std::string& dir, const Options& opt = {}) {
+	aux::check_token(opt.token);
+	uint res = 0;
+	while(true) {
+		std::istringstream in(aux::request(host, port, "GET", opt.connect_timeout, opt.token));
+		std::string cmd;
+		in >> cmd;
+
+		if(cmd == "TASK") {
+			uint id;
+			in >> id;
+			Params params = aux::parse_params(in);
+
+			std::string error;
+			try {
+				aux::write_result(dir, id, f(params));
+			} catch(std::exception& e) {
+				error = e.what();
+				std::replace(error.begin(), error.end(), '\n', ' ');
+				if(error.empty())
+					error = "unknown error";
+			}
+			if(error.empty())
+				res++;
+			aux::request(host, port, (error.empty() ? "OK " : "FAIL ") + std::to_string(id) + (error.empty() ? "" : " " + error), opt.connect_timeout, opt.token);
+
+		} else if(cmd == "WAIT") {
+			double seconds = 1;
+			in >> seconds;
+			std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+
+		} else {
+			break;		// DONE, or the server is gone
+		}
+	}
+	return res;
+}
+
+// One row per task of the grid (in id order): the task's parameters, in the order of the axes, followed by the
+// elements of its result (column-major). All results must exist and have the same number of elements.
+//
+template<typename eT>
+Mat<eT> aggregate(const Grid& grid, const std::string& dir) {
+	const uint n_axes = grid.names().size();
+	Mat<eT> res;
+
+	for(uint id = 0; id < grid.size(); id++) {
+		if(!has_result(dir, id))
+			throw std::runtime_error("sweep: missing result of task " + std::to_string(id));
+		Mat<eT> M = load_result<eT>(dir, id);
+
+		if(id == 0)
+			res.set_size(grid.size(), n_axes + M.n_elem);
+		else if(n_axes + M.n_elem != res.n_cols)
+			throw std::runtime_error("sweep: results of different sizes");
+
+		std::vector<double> values = grid.values(id);
+		for(uint a = 0; a < n_axes; a++)
+			res(id, a) = eT(values[a]);
+		for(uint i = 0; i < M.n_elem; i++)
+			res(id, n_axes + i) = M(i);
+	}
+	return res;
+}
+
+} // namespace sweep
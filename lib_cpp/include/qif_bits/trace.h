@@ -0,0 +1,213 @@
+namespace trace {
+
+// Lightweight tracing of the library's main entry points (LP/QP solves, Kantorovich distances, hypers, sampling and
+// the mechanism constructors), exportable in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+//
+// Spans are only compiled in when qif is built with -DQIF_TRACE=ON (QIF_TRACE in config.h), otherwise QIF_TRACE_SPAN
+// expands to nothing and there is no overhead at all. When compiled in, recording is still off until set_enabled(true)
+// is called (or the QIF_TRACE environment variable is set to 1), and a disabled span costs a single atomic load.
+//
+// Each thread records its spans in its own fixed-size ring buffer (no locking, the oldest spans are overwritten when
+// it is full), the buffers outlive their threads so spans of finished parallel jobs are kept. chrome_json() collects
+// the spans of all threads; spans recorded while it runs may be missing or (if their buffer wraps) garbled, so it is
+// meant to be called after the traced computation.
+//
+// Span names must be string literals (only the pointer is stored).
+//
+
+namespace aux {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Event {
+	const char* name;
+	int64_t start, end;		// ns since origin()
+};
+
+class Buffer {
+	public:
+		const uint tid;
+
+		Buffer(uint tid, uint capacity) : tid(tid), events(std::max(capacity, 1u)) {}
+
+		void push(const char* name, int64_t start, int64_t end) {
+			uint64_t h = head.load(std::memory_order_relaxed);
+			events[h % events.size()] = { name, start, end };
+			head.store(h + 1, std::memory_order_release);
+		}
+
+		// the events recorded since the last clear(), at most events.size()
+		std::vector<Event> snapshot() const {
+			uint64_t h = head.load(std::memory_order_acquire);
+			uint64_t from = std::max(cleared.load(), h > events.size() ? h - events.size() : 0);
+			std::vector<Event> res;
+			res.reserve(h - from);
+			for(uint64_t i = from; i < h; i++)
+				res.push_back(events[i % events.size()]);
+			return res;
+		}
+
+		// only moves the start mark, so that the owning thread can keep pushing
+		void clear() {
+			cleared = head.load();
+		}
+
+	private:
+		std::vector<Event> events;
+		std::atomic<uint64_t> head{0}, cleared{0};
+};
+
+inline std::atomic<bool>& enabled_ref() {
+	static std::atomic<bool> e = [] {
+		const char* env = std::getenv("QIF_TRACE");
+		return env && std::string(env) == "1";
+	}();
+	return e;
+}
+
+inline std::atomic<uint>& buffer_size_ref() {
+	static std::atomic<uint> n(1u << 16);
+	return n;
+}
+
+inline int64_t origin_ns() {
+	static const Clock::time_point origin = Clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(origin.time_since_epoch()).count();
+}
+
+inline int64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count() - origin_ns();
+}
+
+// all buffers ever created, under a mutex (only taken when a thread records its first span, and by the readers)
+inline std::mutex& registry_mutex() {
+	static std::mutex m;
+	return m;
+}
+inline std::vector<std::shared_ptr<Buffer>>& registry() {
+	static std::vector<std::shared_ptr<Buffer>> bufs;
+	return bufs;
+}
+
+inline Buffer& thread_buffer() {
+	thread_local std::shared_ptr<Buffer> buf = [] {
+		std::lock_guard<std::mutex> lock(registry_mutex());
+		auto& bufs = registry();
+		bufs.push_back(std::make_shared<Buffer>(uint(bufs.size()), buffer_size_ref().load()));
+		return bufs.back();
+	}();
+	return *buf;
+}
+
+inline void append_json_string(std::ostringstream& out, const char* s) {
+	out << '"';
+	for(; *s; s++) {
+		if(*s == '"' || *s == '\\')
+			out << '\\';
+		out << *s;
+	}
+	out << '"';
+}
+
+} // namespace aux
+
+// true if the library was built with tracing spans
+constexpr bool compiled() {
+	#ifdef QIF_TRACE
+	return true;
+	#else
+	return false;
+	#endif
+}
+
+inline bool enabled() {
+	return aux::enabled_ref().load(std::memory_order_relaxed);
+}
+
+inline void set_enabled(bool enabled) {
+	aux::enabled_ref() = enabled;
+}
+
+// capacity (in spans) of the ring buffers of threads that have not recorded anything yet
+inline void set_buffer_size(uint n) {
+	aux::buffer_size_ref() = n;
+}
+
+// drops the spans recorded so far, in all threads
+inline void clear() {
+	std::lock_guard<std::mutex> lock(aux::registry_mutex());
+	for(auto& buf : aux::registry())
+		buf->clear();
+}
+
+// RAII span, recorded (if tracing is enabled) from construction to destruction
+//
+class Span {
+	public:
+		explicit Span(const char* name) {
+			if(enabled()) {
+				this->name = name;
+				start = aux::now();
+			}
+		}
+		~Span() {
+			if(name)
+				aux::thread_buffer().push(name, start, aux::now());
+		}
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		const char* name = nullptr;
+		int64_t start = 0;
+};
+
+// all recorded spans as a Chrome trace JSON document (complete "X" events, timestamps in microseconds)
+//
+inline std::string chrome_json() {
+	std::vector<std::shared_ptr<aux::Buffer>> bufs;
+	{
+		std::lock_guard<std::mutex> lock(aux::registry_mutex());
+		bufs = aux::registry();
+	}
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	for(auto& buf : bufs) {
+		for(const aux::Event& e : buf->snapshot()) {
+			out << (first ? "\n" : ",\n") << "{\"name\":";
+			aux::append_json_string(out, e.name);
+			out << ",\"cat\":\"qif\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buf->tid
+				<< ",\"ts\":" << double(e.start) / 1e3 << ",\"dur\":" << double(e.end - e.start) / 1e3 << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+	return out.str();
+}
+
+// writes chrome_json() to the given file
+//
+inline void dump(const std::string& filename) {
+	std::ofstream file(filename);
+	if(!file)
+		throw std::runtime_error("cannot open " + filename);
+	file << chrome_json();
+	if(!file)
+		throw std::runtime_error("cannot write " + filename);
+}
+
+} // namespace trace
+
+#define QIF_TRACE_CONCAT_(a, b) a##b
+#define QIF_TRACE_CONCAT(a, b) QIF_TRACE_CONCAT_(a, b)
+
+// QIF_TRACE_SPAN("ns::function") traces the rest of the enclosing scope
+#ifdef QIF_TRACE
+#define QIF_TRACE_SPAN(name) ::qif::trace::Span QIF_TRACE_CONCAT(qif_trace_span_, __LINE__)(name)
+#else
+#define QIF_TRACE_SPAN(name) ((void)0)
+#endif
@@ -36,6 +36,24 @@ typedef Row<double>  prob;
 typedef Row<float>  fprob;
 typedef Row<rat>    rprob;
 
+// compile-time sized channels/priors (armadillo fixed-size matrices, no heap allocation), eg. for the 2-row channels
+// of pred_vuln::binary_channel. They are Chan/Prob objects, and the measures use unrolled kernels for sizes up to
+// channel::aux::small_size (see channel::aux::with_small_size).
+template<typename eT, uint N, uint M> using FixedChan = typename Mat<eT>::template fixed<N, M>;
+template<typename eT, uint N> using FixedProb = typename Row<eT>::template fixed<N>;
+
+typedef FixedChan<double, 2, 2> chan22;
+typedef FixedChan<double, 3, 3> chan33;
+typedef FixedProb<double, 2>    prob2;
+typedef FixedProb<double, 3>    prob3;
+
+// sparse channels, for channels with very few non-zero elements
+template<typename eT> using SpChan = arma::SpMat<eT>;
+
+typedef SpChan<double> spchan;
+typedef SpChan<float> fspchan;
+typedef SpChan<rat>   rspchan;
+
 typedef Mat<rat>     rmat;
 typedef Col<rat>  rcolvec;
 typedef Row<rat>  rrowvec;
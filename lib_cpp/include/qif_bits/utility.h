@@ -3,19 +3,217 @@ namespace utility {
 	template<typename eT>
 	eT
 	expected_distance(const Mat<eT>& Dist, const Prob<eT>& pi, const Chan<eT>& C) {
-		return arma::dot(pi, arma::sum(C % Dist, 1));
+		channel::check_prior_size(pi, C);
+		if(Dist.n_rows != C.n_rows || Dist.n_cols != C.n_cols)
+			throw std::runtime_error("invalid distance matrix size");
+
+		// a single pass over the columns of C and Dist (contiguous), with a compensated (vectorized) sum
+		CompensatedSum<eT> sum;
+		const eT* p = pi.memptr();
+		for(uint j = 0; j < C.n_cols; j++) {
+			const eT* c = C.colptr(j);
+			const eT* d = Dist.colptr(j);
+			sum.add_each(C.n_rows, [&](size_t i) { return p[i] * c[i] * d[i]; });
+		}
+		return sum.value();
 	}
 
 	template<typename eT>
 	eT
 	expected_distance(const Metric<eT, uint>& dist, const Prob<eT>& pi, const Chan<eT>& C) {
+		CompensatedSum<eT> sum;
+		for(uint i = 0; i < C.n_rows; i++) {
+			CompensatedSum<eT> sum2;
+			for(uint j = 0; j < C.n_cols; j++)
+				sum2.add(C(i,j) * dist(i, j));
+			sum.add(pi(i) * sum2.value());
+		}
+		return sum.value();
+	}
+
+	template<typename eT>
+	eT
+	expected_distance(const metric::CachedMetric<eT>& dist, const Prob<eT>& pi, const Chan<eT>& C) {
+		return expected_distance(dist.matrix(C.n_rows, C.n_cols), pi, C);
+	}
+
+	// for lazy channels, rows are computed one at a time
+	template<typename eT>
+	eT
+	expected_distance(const Mat<eT>& Dist, const Prob<eT>& pi, const channel::LazyChan<eT>& C) {
+		channel::check_prior_size(pi, C);
+
 		eT sum(0);
+		Row<eT> row;
 		for(uint i = 0; i < C.n_rows; i++) {
+			if(pi(i) == eT(0))
+				continue;
+			C.row(i, row);
+			sum += pi(i) * arma::dot(row, Dist.row(i));
+		}
+		return sum;
+	}
+
+	template<typename eT>
+	eT
+	expected_distance(const Metric<eT, uint>& dist, const Prob<eT>& pi, const channel::LazyChan<eT>& C) {
+		channel::check_prior_size(pi, C);
+
+		eT sum(0);
+		Row<eT> row;
+		for(uint i = 0; i < C.n_rows; i++) {
+			if(pi(i) == eT(0))
+				continue;
+			C.row(i, row);
+
 			eT sum2(0);
 			for(uint j = 0; j < C.n_cols; j++)
-				sum2 += C(i,j) * dist(i, j);
+				sum2 += row(j) * dist(i, j);
 			sum += pi(i) * sum2;
 		}
 		return sum;
 	}
+
+	// for memory-mapped channels, rows are processed in blocks (in the calling thread, so dist can be any Metric)
+	template<typename eT>
+	eT
+	expected_distance(const Mat<eT>& Dist, const Prob<eT>& pi, const channel::MappedChan<eT>& C) {
+		channel::check_prior_size(pi, C);
+
+		eT sum(0);
+		C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+			for(uint k = 0; k < Bt.n_cols; k++)
+				if(pi(first + k) != eT(0))
+					sum += pi(first + k) * arma::dot(Bt.col(k), Dist.row(first + k));
+		});
+		return sum;
+	}
+
+	template<typename eT>
+	eT
+	expected_distance(const Metric<eT, uint>& dist, const Prob<eT>& pi, const channel::MappedChan<eT>& C) {
+		channel::check_prior_size(pi, C);
+
+		eT sum(0);
+		C.for_each_block([&](uint first, const Mat<eT>& Bt) {
+			for(uint k = 0; k < Bt.n_cols; k++) {
+				uint i = first + k;
+				if(pi(i) == eT(0))
+					continue;
+
+				eT sum2(0);
+				for(uint j = 0; j < C.n_cols; j++)
+					sum2 += Bt(j, k) * dist(i, j);
+				sum += pi(i) * sum2;
+			}
+		});
+		return sum;
+	}
+
+	// for quantized channels, the codes of each row are decoded on the fly (see channel::QuantizedChan)
+	template<typename eT, typename Q>
+	eT
+	expected_distance(const Mat<eT>& Dist, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+		channel::check_prior_size(pi, C);
+		if(Dist.n_rows != C.n_rows || Dist.n_cols != C.n_cols)
+			throw std::runtime_error("invalid distance matrix size");
+		typedef channel::aux::Codec<Q> codec;
+
+		eT sum(0);
+		for(uint i = 0; i < C.n_rows; i++) {
+			const eT s = pi(i) * C.scale(i);
+			if(s == eT(0))
+				continue;
+
+			const Q* q = C.row_codes(i);
+			eT sum2(0);
+			for(uint j = 0; j < C.n_cols; j++)
+				sum2 += eT(codec::decode(q[j])) * Dist(i, j);
+			sum += s * sum2;
+		}
+		return sum;
+	}
+
+	template<typename eT, typename Q>
+	eT
+	expected_distance(const Metric<eT, uint>& dist, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+		channel::check_prior_size(pi, C);
+		typedef channel::aux::Codec<Q> codec;
+
+		eT sum(0);
+		for(uint i = 0; i < C.n_rows; i++) {
+			const eT s = pi(i) * C.scale(i);
+			if(s == eT(0))
+				continue;
+
+			const Q* q = C.row_codes(i);
+			eT sum2(0);
+			for(uint j = 0; j < C.n_cols; j++)
+				sum2 += eT(codec::decode(q[j])) * dist(i, j);
+			sum += s * sum2;
+		}
+		return sum;
+	}
+
+	// bound to the difference between expected_distance(Dist, pi, C) and the expected distance of the uncompressed
+	// channel, sum_x pi(x) C.max_error(x) sum_y |Dist(x,y)|
+	template<typename eT, typename Q>
+	eT
+	expected_distance_error(const Mat<eT>& Dist, const Prob<eT>& pi, const channel::QuantizedChan<eT, Q>& C) {
+		channel::check_prior_size(pi, C);
+		if(Dist.n_rows != C.n_rows || Dist.n_cols != C.n_cols)
+			throw std::runtime_error("invalid distance matrix size");
+
+		return arma::dot(pi.t() % C.max_errors(), Col<eT>(arma::sum(arma::abs(Dist), 1)));
+	}
+
+	// Maintains expected_distance(Dist, pi, C) while entries or rows of C change (eg in a local search over channels):
+	// the contribution pi(x) <C.row(x), Dist.row(x)> of every row is kept, so a row change costs O(m) and an entry
+	// change O(1), instead of O(n m).
+	template<typename eT>
+	class IncrementalExpectedDistance {
+		public:
+			IncrementalExpectedDistance(const Mat<eT>& Dist, const Prob<eT>& pi, const Chan<eT>& C) : Dist(Dist), pi(pi), C(C) {
+				channel::check_prior_size(pi, C);
+				if(Dist.n_rows != C.n_rows || Dist.n_cols != C.n_cols)
+					throw std::runtime_error("invalid distance matrix size");
+				recompute();
+			}
+
+			eT value() const					{ return sum; }
+			const Chan<eT>& channel() const		{ return C; }
+
+			void set(uint x, uint y, const eT& v) {
+				eT diff = pi(x) * (v - C(x, y)) * Dist(x, y);
+				C(x, y) = v;
+				row_dist(x) += diff;
+				sum += diff;
+			}
+
+			void set_row(uint x, const Row<eT>& row) {
+				if(row.n_elem != C.n_cols) throw std::runtime_error("invalid row size");
+				C.row(x) = row;
+				eT d = pi(x) * arma::dot(row, Dist.row(x));
+				sum += d - row_dist(x);
+				row_dist(x) = d;
+			}
+
+			// value() if row x of C was replaced by row
+			eT value_with_row(uint x, const Row<eT>& row) const {
+				return sum - row_dist(x) + pi(x) * arma::dot(row, Dist.row(x));
+			}
+
+			// recomputed from scratch, to discard the rounding errors accumulated by the updates
+			void recompute() {
+				row_dist = pi.t() % arma::sum(C % Dist, 1);
+				sum = arma::accu(row_dist);
+			}
+
+		private:
+			Mat<eT> Dist;
+			Prob<eT> pi;
+			Chan<eT> C;
+			Col<eT> row_dist;
+			eT sum;
+	};
 }
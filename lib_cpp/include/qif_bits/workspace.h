@@ -0,0 +1,192 @@
+namespace workspace {
+
+// Scratch memory for the temporaries of the library's measures (panels of the joint and of G*J, index vectors of
+// hyper, ...). A Workspace is a bump allocator: temporaries are carved out of its blocks and released all at once
+// when the Frame that allocated them closes. When a computation needs more than the current capacity a new block is
+// added, and once the workspace is empty again all blocks are merged into a single one of the peak size, so repeated
+// calls of the same sizes (eg. a measure evaluated in a loop) do no heap allocation at all after the first one.
+//
+// A workspace is used by the library only while a Scoped object installs it for the calling thread. It is not thread
+// safe: the parallel jobs started inside its scope (which run in the threads of the pool) allocate normally. Without
+// a workspace, or for element types that are not trivially copyable (rat), Buffer falls back to the heap.
+//
+//     workspace::Workspace ws;
+//     workspace::Scoped scoped(ws);
+//     for(...) measure::g_vuln::posterior(G, pi, C);      // temporaries come from ws
+//
+
+class Workspace {
+	public:
+		static const size_t alignment = 64;
+
+		explicit Workspace(size_t bytes = 0) {
+			if(bytes > 0)
+				blocks.emplace_back(bytes);
+		}
+		Workspace(const Workspace&) = delete;
+		Workspace& operator=(const Workspace&) = delete;
+
+		// n bytes, aligned to `alignment`. Valid until the workspace is rewound to a mark taken before this call.
+		void* alloc(size_t n) {
+			n = (n + alignment - 1) / alignment * alignment;
+
+			while(cur < blocks.size() && blocks[cur].used + n > blocks[cur].size)
+				cur++;												// blocks after the current one are empty
+			if(cur == blocks.size())
+				blocks.emplace_back(std::max(n, capacity()));		// at least doubles the capacity
+
+			Block& b = blocks[cur];
+			void* res = b.base + b.used;
+			b.used += n;
+			in_use += n;
+			peak_bytes = std::max(peak_bytes, in_use);
+			return res;
+		}
+
+		struct Mark {
+			size_t block, used, in_use;
+		};
+
+		Mark mark() const {
+			return { cur, blocks.empty() ? 0 : blocks[cur].used, in_use };
+		}
+
+		// releases everything allocated after m was taken
+		void rewind(const Mark& m) {
+			for(size_t b = m.block + 1; b < blocks.size(); b++)
+				blocks[b].used = 0;
+			if(!blocks.empty())
+				blocks[m.block].used = m.used;
+			cur = m.block;
+			in_use = m.in_use;
+
+			if(in_use == 0 && blocks.size() > 1) {
+				blocks.clear();
+				blocks.emplace_back(peak_bytes);
+			}
+		}
+
+		size_t capacity() const {
+			size_t res = 0;
+			for(const Block& b : blocks)
+				res += b.size;
+			return res;
+		}
+
+		size_t used() const			{ return in_use; }
+		size_t peak() const			{ return peak_bytes; }
+		size_t n_blocks() const		{ return blocks.size(); }
+
+	private:
+		struct Block {
+			std::unique_ptr<char[]> data;
+			char* base;
+			size_t size, used = 0;
+
+			explicit Block(size_t size) : data(new char[size + alignment]), size(size) {
+				size_t addr = reinterpret_cast<size_t>(data.get());
+				base = data.get() + (alignment - addr % alignment) % alignment;
+			}
+		};
+
+		std::vector<Block> blocks;
+		size_t cur = 0, in_use = 0, peak_bytes = 0;
+};
+
+namespace aux {
+
+inline Workspace*& current_ref() {
+	thread_local Workspace* ws = nullptr;
+	return ws;
+}
+
+} // namespace aux
+
+// the workspace installed for the calling thread, or nullptr
+inline Workspace* current() {
+	return aux::current_ref();
+}
+
+// Installs ws for the calling thread while in scope
+//
+class Scoped {
+	public:
+		explicit Scoped(Workspace& ws) : prev(aux::current_ref()) { aux::current_ref() = &ws; }
+		~Scoped() { aux::current_ref() = prev; }
+
+		Scoped(const Scoped&) = delete;
+		Scoped& operator=(const Scoped&) = delete;
+
+	private:
+		Workspace* prev;
+};
+
+// Releases, on destruction, everything allocated from the current workspace since construction. Has to outlive the
+// Buffers that use it (declare it first).
+//
+class Frame {
+	public:
+		Frame() : ws(current()) {
+			if(ws)
+				m = ws->mark();
+		}
+		~Frame() {
+			if(ws)
+				ws->rewind(m);
+		}
+
+		Frame(const Frame&) = delete;
+		Frame& operator=(const Frame&) = delete;
+
+	private:
+		Workspace* ws;
+		Workspace::Mark m;
+};
+
+// n uninitialized elements, from the current workspace if possible (otherwise owned by the buffer). mat/col/row give
+// armadillo objects using the buffer's memory directly (auxiliary memory, so they cannot be resized).
+//
+template<typename eT>
+class Buffer {
+	public:
+		explicit Buffer(size_t n) : n(n) {
+			Workspace* ws = current();
+			if constexpr (std::is_trivially_copyable<eT>::value)
+				if(ws && n > 0)
+					ptr = static_cast<eT*>(ws->alloc(n * sizeof(eT)));
+			if(!ptr) {
+				own.resize(std::max<size_t>(n, 1));
+				ptr = own.data();
+			}
+		}
+		Buffer(const Buffer&) = delete;
+		Buffer& operator=(const Buffer&) = delete;
+
+		eT* memptr()		{ return ptr; }
+		size_t size() const	{ return n; }
+
+		Mat<eT> mat(uint n_rows, uint n_cols) {
+			check(size_t(n_rows) * n_cols);
+			return Mat<eT>(ptr, n_rows, n_cols, false, true);
+		}
+		Col<eT> col(uint n_elem) {
+			check(n_elem);
+			return Col<eT>(ptr, n_elem, false, true);
+		}
+		Row<eT> row(uint n_elem) {
+			check(n_elem);
+			return Row<eT>(ptr, n_elem, false, true);
+		}
+
+	private:
+		size_t n;
+		eT* ptr = nullptr;
+		std::vector<eT> own;
+
+		void check(size_t m) const {
+			if(m > n)
+				throw std::runtime_error("workspace buffer too small");
+		}
+};
+
+} // namespace workspace
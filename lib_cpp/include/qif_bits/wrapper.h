@@ -21,13 +21,24 @@ void glp_init_smcp(glp_smcp *parm);
 int glp_simplex(glp_prob *P, const glp_smcp *parm);
 int glp_get_status(glp_prob *P);
 int glp_get_dual_stat(glp_prob *P);
+int glp_get_prim_stat(glp_prob *P);
 double glp_get_col_prim(glp_prob *P, int j);
 int glp_interior(glp_prob *P, const glp_iptcp *parm);
 void glp_init_iptcp(glp_iptcp *parm);
 int glp_ipt_status(glp_prob *P);
 double glp_ipt_col_prim(glp_prob *P, int j);
+double glp_get_row_dual(glp_prob *P, int i);
+double glp_get_col_dual(glp_prob *P, int j);
+double glp_ipt_row_dual(glp_prob *P, int i);
+double glp_ipt_col_dual(glp_prob *P, int j);
 void glp_delete_prob(glp_prob *P);
 int glp_free_env(void);
+void glp_set_row_stat(glp_prob *P, int i, int stat);
+void glp_set_col_stat(glp_prob *P, int j, int stat);
+int glp_get_row_stat(glp_prob *P, int i);
+int glp_get_col_stat(glp_prob *P, int j);
+void glp_std_basis(glp_prob *P);
+int glp_get_it_cnt(glp_prob *P);
 #endif
 
 
@@ -37,6 +48,9 @@ void osqp_set_default_settings(OSQPSettings *settings);
 c_int osqp_setup(OSQPWorkspace **work, const OSQPData *data, OSQPSettings *settings);
 c_int osqp_solve(OSQPWorkspace *work);
 c_int osqp_cleanup(OSQPWorkspace *work);
+c_int osqp_update_lin_cost(OSQPWorkspace *work, const c_float *q_new);
+c_int osqp_update_bounds(OSQPWorkspace *work, const c_float *l_new, const c_float *u_new);
+c_int osqp_warm_start(OSQPWorkspace *work, const c_float *x, const c_float *y);
 csc* csc_matrix(c_int m, c_int n, c_int nzmax, c_float *x, c_int *i, c_int *p);
 
 
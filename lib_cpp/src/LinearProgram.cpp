@@ -2,9 +2,14 @@
 
 namespace qif::lp {
 
+bool   Defaults::instrument = false;
 bool   Defaults::presolve  = true;
 string Defaults::msg_level = MsgLevel::OFF;
 string Defaults::method    = Method::AUTO;
 string Defaults::solver    = Solver::AUTO;
+string Defaults::pricing   = Pricing::AUTO;
+string Defaults::external_command;
+string Defaults::external_format = SolutionFormat::AUTO;
+std::vector<string> Defaults::portfolio;
 
 } // namespace qif::lp
@@ -0,0 +1,61 @@
+#include "qif"
+
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define QIF_HAS_MMAP
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace qif {
+
+MappedFile::MappedFile(const std::string& filename) {
+#ifdef QIF_HAS_MMAP
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		throw std::runtime_error("cannot open " + filename);
+
+	struct stat st;
+	if(::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::runtime_error("cannot stat " + filename);
+	}
+	len = st.st_size;
+
+	if(len > 0) {
+		void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("cannot mmap " + filename);
+		}
+		::madvise(p, len, MADV_SEQUENTIAL);
+		ptr = static_cast<const char*>(p);
+		mapped = true;
+	}
+	::close(fd);				// the mapping stays valid after closing
+
+#else
+	std::ifstream file(filename, std::ios::binary);
+	if(!file)
+		throw std::runtime_error("cannot open " + filename);
+
+	std::ostringstream ss;
+	ss << file.rdbuf();
+	buffer = ss.str();
+	ptr = buffer.data();
+	len = buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef QIF_HAS_MMAP
+	if(mapped)
+		::munmap(const_cast<char*>(ptr), len);
+#endif
+}
+
+} // namespace qif
@@ -4,6 +4,7 @@ namespace qif::qp {
 
 
 Method    Defaults::method       = Method::ADDM;
+bool        Defaults::instrument   = false;
 bool        Defaults::osqp_polish  = true;
 bool        Defaults::osqp_verbose = false;
 double      Defaults::osqp_alpha   = -1.0;		// negative means
@@ -12,7 +13,7 @@ double      Defaults::osqp_eps_rel = -1.0;		// defaults
 
 
 std::ostream& operator<<(std::ostream& os, const Status& status) {
-	std::string s[] = { "optimal", "infeasible", "error" };
+	std::string s[] = { "optimal", "infeasible", "interrupted", "error" };
 	return os << s[static_cast<uint>(status)];
 }
 
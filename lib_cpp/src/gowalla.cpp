@@ -11,56 +11,179 @@ std::map<std::string,latlon> locations = {
 
 namespace gowalla {
 
-std::vector<Entry> read_dataset(string filename) {
-	std::vector<Entry> list;
-	string line, date;
+namespace {
 
-	std::ifstream file;
-	file.open(filename);
-	if(!file)
-		throw std::runtime_error("cannot open " + filename);
+// Hand-written scanner for the check-in format "userId <ws> date <ws> lat <ws> lon <ws> locationId", working in place
+// on the mapped file (no copies, no locale, no istringstream).
+//
+struct Scanner {
+	const char *p, *end;
 
-    while(getline(file, line) ) {
-		Entry entry;
-		std::istringstream line_s(line);
-		line_s >> entry.userId >> date >> entry.location.lat >> entry.location.lon >> entry.locationId;
- 		list.push_back(entry);
-    }
-	file.close();
+	inline void skip_space() {
+		while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+	}
 
-	return list;
-}
+	inline bool skip_token() {
+		skip_space();
+		const char* start = p;
+		while(p < end && !std::isspace(static_cast<unsigned char>(*p)))
+			p++;
+		return p > start;
+	}
 
-std::vector<uint> to_grid(const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size) {
+	inline bool parse_uint(uint& v) {
+		skip_space();
+		const char* start = p;
+		uint64_t x = 0;
+		while(p < end && *p >= '0' && *p <= '9')
+			x = 10 * x + (*p++ - '0');
+		v = x;
+		return p > start;
+	}
 
-	double lon_d = std::abs(center.lon - center.add_vector(cell_size, pi<double>()/2).lon);
-	double lat_d = std::abs(center.lat - center.add_vector(cell_size, 0).lat);
+	// Fast path for up to 15 significant digits and a small exponent, where m / 10^k is correctly rounded (both are
+	// exact doubles). Anything else goes through strtod.
+	//
+	inline bool parse_double(double& v) {
+		static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
 
-	double lon_min = center.lon - (lon_d * width) / 2;
-	double lon_max = center.lon + (lon_d * width) / 2;
-	double lat_min = center.lat - (lat_d * height) / 2;
-	double lat_max = center.lat + (lat_d * height) / 2;
+		skip_space();
+		const char* start = p;
+		bool neg = p < end && *p == '-';
+		if(p < end && (*p == '-' || *p == '+'))
+			p++;
 
-	std::vector<uint> points;
-	for(auto e : dataset) {
-		if(!(e.location.lat >= lat_min && e.location.lat < lat_max && e.location.lon >= lon_min && e.location.lon < lon_max))
-			continue;
+		uint64_t m = 0;
+		int digits = 0, frac = 0;
+		for(; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+			m = 10 * m + (*p - '0');
+		if(p < end && *p == '.')
+			for(p++; p < end && *p >= '0' && *p <= '9'; p++, digits++, frac++)
+				m = 10 * m + (*p - '0');
 
-		uint x = std::floor((e.location.lon - lon_min) / lon_d);
-		uint y = std::floor((e.location.lat - lat_min) / lat_d);
+		if(digits == 0)
+			return false;
 
-		points.push_back(y * width + x);
+		if(digits <= 15 && frac <= 22 && (p == end || (*p != 'e' && *p != 'E'))) {
+			v = double(m) / pow10[frac];
+			if(neg) v = -v;
+			return true;
+		}
+
+		// slow path
+		while(p < end && !std::isspace(static_cast<unsigned char>(*p)))
+			p++;
+		string token(start, p);
+		char* token_end;
+		v = std::strtod(token.c_str(), &token_end);
+		return token_end == token.c_str() + token.size();
 	}
 
-	return points;
+	inline void next_line() {
+		while(p < end && *p != '\n')
+			p++;
+		if(p < end)
+			p++;
+	}
+
+	// parses the next non-empty line into e, returns false at the end of the input
+	bool parse_entry(Entry& e) {
+		while(true) {
+			skip_space();
+			if(p == end)
+				return false;
+			if(*p != '\n')
+				break;
+			p++;
+		}
+
+		if(!(parse_uint(e.userId) && skip_token() && parse_double(e.location.lat) && parse_double(e.location.lon) && parse_uint(e.locationId)))
+			throw std::runtime_error("malformed check-in entry");
+		next_line();
+		return true;
+	}
+};
+
+// number of chunks for parse_chunks, at least 1MB each
+inline uint n_chunks(const MappedFile& file) {
+	return std::max<size_t>(1, std::min<size_t>(4 * parallel::n_threads(), file.size() / (1 << 20)));
 }
 
-prob to_grid_prior(const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size) {
-	std::vector<uint> points = to_grid(dataset, center, width, height, cell_size);
+// Calls f(chunk, entry) for every entry of the file, the file being split in n_chunks pieces (at line boundaries)
+// that are parsed in parallel. Entries of the same chunk are visited in file order.
+//
+template<typename F>
+void parse_chunks(const MappedFile& file, uint n_chunks, F f) {
+	size_t size = file.size();
+
+	std::vector<const char*> bounds(n_chunks + 1);
+	bounds[0] = file.begin();
+	bounds[n_chunks] = file.end();
+	for(uint c = 1; c < n_chunks; c++) {
+		const char* q = std::max(bounds[c-1], file.begin() + c * (size / n_chunks));
+		while(q < file.end() && q[-1] != '\n')
+			q++;
+		bounds[c] = q;
+	}
+
+	parallel::for_each(n_chunks, [&](uint c) {
+		Scanner sc { bounds[c], bounds[c+1] };
+		Entry e;
+		while(sc.parse_entry(e))
+			f(c, e);
+	});
+}
+
+// maps locations to the cells of a width x height grid centered at center. The projection constants (which involve
+// trigonometry) are computed once, in the constructor.
+//
+struct GridMap {
+	uint width, height;
+	double lon_d, lat_d, lon_min, lon_max, lat_min, lat_max;
+
+	GridMap(latlon center, uint width, uint height, double cell_size) : width(width), height(height) {
+		lon_d = std::abs(center.lon - center.add_vector(cell_size, pi<double>()/2).lon);
+		lat_d = std::abs(center.lat - center.add_vector(cell_size, 0).lat);
+
+		lon_min = center.lon - (lon_d * width) / 2;
+		lon_max = center.lon + (lon_d * width) / 2;
+		lat_min = center.lat - (lat_d * height) / 2;
+		lat_max = center.lat + (lat_d * height) / 2;
+	}
+
+	GridMap(const Grid& g) : GridMap(g.center, g.width, g.height, g.cell_size) {}
+
+	// false if the location is outside the grid
+	inline bool cell(const latlon& loc, uint& c) const {
+		int32_t res;
+		cells(&loc.lat, &loc.lon, 1, &res);
+		c = res;
+		return res >= 0;
+	}
+
+	// Cells of len locations (-1 for those outside). Branch-free, so that the compiler can vectorize it. The
+	// coordinates are clamped before the conversion to int, which also keeps x,y inside the grid when rounding
+	// puts a location just below lon_max/lat_max on the border.
+	//
+	inline void cells(const double* lat, const double* lon, size_t len, int32_t* res) const {
+		const double max_x = width - 1, max_y = height - 1;
+		for(size_t k = 0; k < len; k++) {
+			double la = lat[k], lo = lon[k];
+			bool in = (la >= lat_min) & (la < lat_max) & (lo >= lon_min) & (lo < lon_max);
+			int32_t x = int32_t(std::min(std::max((lo - lon_min) / lon_d, 0.0), max_x));
+			int32_t y = int32_t(std::min(std::max((la - lat_min) / lat_d, 0.0), max_y));
+			res[k] = in ? y * int32_t(width) + x : -1;
+		}
+	}
+};
+
+prob points_to_prior(const std::vector<uint>& points, uint width, uint height) {
 	if(points.size() == 0)
 		throw std::runtime_error("empty list");
 
-	prob pi(width * height);
+	prob pi(width * height, arma::fill::zeros);
 	for(uint p : points)
 		pi(p)++;
 
@@ -68,6 +191,426 @@ prob to_grid_prior(const std::vector<Entry>& dataset, latlon center, uint width,
 	return pi;
 }
 
+// One parallel pass over n locations, given as separate lat/lon arrays, computing for every grid the cells
+// of the locations inside it (in input order, if points != nullptr) and the normalized histogram of these cells (if
+// priors != nullptr). Each thread processes a contiguous range in blocks, first computing the cells of a whole block
+// for one grid (vectorized), then collecting them.
+//
+void grid_pass(const double* lat, const double* lon, size_t n, const std::vector<Grid>& grids,
+	std::vector<std::vector<uint>>* points, std::vector<prob>* priors) {
+
+	const size_t block = 4096;
+	uint n_grids = grids.size();
+	uint n_chunks = std::max<size_t>(1, std::min<size_t>(parallel::n_threads(), n / block));
+
+	std::vector<GridMap> maps(grids.begin(), grids.end());
+
+	// per chunk, per grid
+	std::vector<std::vector<std::vector<uint>>> chunk_points(points ? n_chunks : 0, std::vector<std::vector<uint>>(n_grids));
+	std::vector<std::vector<std::vector<uint32_t>>> chunk_hist(priors ? n_chunks : 0, std::vector<std::vector<uint32_t>>(n_grids));
+
+	parallel::for_each(n_chunks, [&](uint ch) {
+		size_t begin = n * ch / n_chunks, end = n * (ch + 1) / n_chunks;
+		std::vector<int32_t> cells(block);
+
+		if(priors)
+			for(uint g = 0; g < n_grids; g++)
+				chunk_hist[ch][g].assign(grids[g].width * grids[g].height, 0);
+
+		for(size_t i = begin; i < end; i += block) {
+			size_t len = std::min(block, end - i);
+
+			for(uint g = 0; g < n_grids; g++) {
+				maps[g].cells(lat + i, lon + i, len, cells.data());
+
+				if(points) {
+					auto& pts = chunk_points[ch][g];
+					for(size_t k = 0; k < len; k++)
+						if(cells[k] >= 0)
+							pts.push_back(cells[k]);
+				}
+				if(priors) {
+					auto& hist = chunk_hist[ch][g];
+					for(size_t k = 0; k < len; k++)
+						if(cells[k] >= 0)
+							hist[cells[k]]++;
+				}
+			}
+		}
+	});
+
+	if(points) {
+		points->assign(n_grids, {});
+		for(uint g = 0; g < n_grids; g++)
+			for(uint ch = 0; ch < n_chunks; ch++)
+				(*points)[g].insert((*points)[g].end(), chunk_points[ch][g].begin(), chunk_points[ch][g].end());
+	}
+
+	if(priors) {
+		priors->resize(n_grids);
+		for(uint g = 0; g < n_grids; g++) {
+			prob& pi = (*priors)[g];
+			pi.zeros(grids[g].width * grids[g].height);
+			for(uint ch = 0; ch < n_chunks; ch++)
+				for(uint c = 0; c < pi.n_elem; c++)
+					pi(c) += chunk_hist[ch][g][c];
+
+			double total = arma::accu(pi);
+			if(total == 0)
+				throw std::runtime_error("empty list");
+			pi /= total;
+		}
+	}
+}
+
+// Copies the lat/lon of the entries into separate (contiguous) arrays, for grid_pass. Reading them in place, with
+// a stride over the Entry objects, would index past the double member they point to.
+//
+void entry_coords(const std::vector<Entry>& dataset, std::vector<double>& lat, std::vector<double>& lon) {
+	lat.resize(dataset.size());
+	lon.resize(dataset.size());
+	for(size_t i = 0; i < dataset.size(); i++) {
+		lat[i] = dataset[i].location.lat;
+		lon[i] = dataset[i].location.lon;
+	}
+}
+
+} // anonymous namespace
+
+std::vector<Entry> read_dataset(string filename) {
+	MappedFile file(filename);
+
+	std::vector<std::vector<Entry>> chunks(n_chunks(file));
+	parse_chunks(file, chunks.size(), [&](uint c, const Entry& e) { chunks[c].push_back(e); });
+
+	size_t total = 0;
+	for(auto& chunk : chunks)
+		total += chunk.size();
+
+	std::vector<Entry> list;
+	list.reserve(total);
+	for(auto& chunk : chunks)
+		list.insert(list.end(), chunk.begin(), chunk.end());
+
+	return list;
+}
+
+void for_each_entry(string filename, const std::function<void(const Entry&)>& f) {
+	MappedFile file(filename);
+	Scanner sc { file.begin(), file.end() };
+
+	Entry e;
+	while(sc.parse_entry(e))
+		f(e);
+}
+
+std::vector<uint> to_grid(string filename, latlon center, uint width, uint height, double cell_size) {
+	MappedFile file(filename);
+	GridMap grid(center, width, height, cell_size);
+
+	std::vector<std::vector<uint>> chunks(n_chunks(file));
+	parse_chunks(file, chunks.size(), [&](uint ch, const Entry& e) {
+		uint c;
+		if(grid.cell(e.location, c))
+			chunks[ch].push_back(c);
+	});
+
+	std::vector<uint> points;
+	for(auto& chunk : chunks)
+		points.insert(points.end(), chunk.begin(), chunk.end());
+	return points;
+}
+
+prob to_grid_prior(string filename, latlon center, uint width, uint height, double cell_size) {
+	return points_to_prior(to_grid(filename, center, width, height, cell_size), width, height);
+}
+
+std::vector<uint> to_grid(const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size) {
+	if(dataset.empty())
+		return {};
+
+	std::vector<double> lat, lon;
+	entry_coords(dataset, lat, lon);
+
+	std::vector<std::vector<uint>> points;
+	grid_pass(lat.data(), lon.data(), dataset.size(), { Grid(center, width, height, cell_size) }, &points, nullptr);
+	return points[0];
+}
+
+prob to_grid_prior(const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size) {
+	return to_grid_prior(dataset, { Grid(center, width, height, cell_size) })[0];
+}
+
+std::vector<prob> to_grid_prior(const std::vector<Entry>& dataset, const std::vector<Grid>& grids) {
+	if(dataset.empty())
+		throw std::runtime_error("empty list");
+
+	std::vector<double> lat, lon;
+	entry_coords(dataset, lat, lon);
+
+	std::vector<prob> priors;
+	grid_pass(lat.data(), lon.data(), dataset.size(), grids, nullptr, &priors);
+	return priors;
+}
+
+std::vector<std::vector<uint>> to_grid(const double* lat, const double* lon, size_t n, const std::vector<Grid>& grids) {
+	std::vector<std::vector<uint>> points;
+	grid_pass(lat, lon, n, grids, &points, nullptr);
+	return points;
+}
+
+std::vector<prob> to_grid_prior(const double* lat, const double* lon, size_t n, const std::vector<Grid>& grids) {
+	std::vector<prob> priors;
+	grid_pass(lat, lon, n, grids, nullptr, &priors);
+	return priors;
+}
+
+
+// -- Streaming per-user reports ---------------------------------------------
+
+namespace {
+
+// the cells (in the grid) of the check-ins of a range of users, user u having cells[offsets[u]..offsets[u+1])
+struct CellBatch {
+	std::vector<uint> users, offsets, cells;
+};
+
+// the sparse histogram of each user, (cell, count) pairs in counts[offsets[u]..offsets[u+1])
+struct HistBatch {
+	std::vector<uint> users, offsets;
+	std::vector<std::pair<uint, uint>> counts;
+};
+
+} // anonymous namespace
+
+void user_reports(string filename, const Grid& grid, const UserMeasure& measure, const std::function<void(const UserReport&)>& report, const ReportOptions& opt) {
+	MappedFile file(filename);
+	const GridMap map(grid);
+	const uint n_cells = grid.width * grid.height;
+
+	pipeline::Queue<std::vector<Entry>> parsed(opt.queue_capacity);
+	pipeline::Queue<CellBatch> projected(opt.queue_capacity);
+	pipeline::Queue<HistBatch> histograms(opt.queue_capacity);
+	pipeline::Queue<std::vector<UserReport>> reports(opt.queue_capacity);
+	pipeline::Pipeline p;
+
+	// batches of whole users, so that the next stages can process them independently
+	p.source(parsed, [&](auto& emit) {
+		Scanner sc { file.begin(), file.end() };
+		std::vector<Entry> batch;
+		Entry e;
+		while(sc.parse_entry(e)) {
+			if(batch.size() >= opt.batch_size && e.userId != batch.back().userId) {
+				if(!emit(std::move(batch)))
+					return;
+				batch.clear();
+			}
+			batch.push_back(e);
+		}
+		if(!batch.empty())
+			emit(std::move(batch));
+	});
+
+	// keeps the check-ins inside the grid, as cells
+	p.stage(parsed, projected, opt.project_threads, [&](std::vector<Entry>&& batch) {
+		CellBatch res;
+		for(size_t i = 0; i < batch.size(); i++) {
+			if(i == 0 || batch[i].userId != batch[i-1].userId) {
+				res.users.push_back(batch[i].userId);
+				res.offsets.push_back(res.cells.size());
+			}
+			uint c;
+			if(map.cell(batch[i].location, c))
+				res.cells.push_back(c);
+		}
+		res.offsets.push_back(res.cells.size());
+		return res;
+	});
+
+	p.stage(projected, histograms, 1, [&](CellBatch&& batch) {
+		HistBatch res;
+		for(size_t u = 0; u < batch.users.size(); u++) {
+			uint n = batch.offsets[u+1] - batch.offsets[u];
+			if(n == 0 || n < opt.min_checkins)
+				continue;
+			auto first = batch.cells.begin() + batch.offsets[u], last = first + n;
+			std::sort(first, last);
+
+			res.users.push_back(batch.users[u]);
+			res.offsets.push_back(res.counts.size());
+			for(auto it = first; it != last; ) {
+				auto next = std::upper_bound(it, last, *it);
+				res.counts.emplace_back(*it, uint(next - it));
+				it = next;
+			}
+		}
+		res.offsets.push_back(res.counts.size());
+		return res;
+	});
+
+	p.stage(histograms, reports, opt.measure_threads, [&](HistBatch&& batch) {
+		std::vector<UserReport> res;
+		prob pi(n_cells);
+		for(size_t u = 0; u < batch.users.size(); u++) {
+			uint n = 0;
+			pi.zeros();
+			for(uint k = batch.offsets[u]; k < batch.offsets[u+1]; k++) {
+				pi(batch.counts[k].first) = batch.counts[k].second;
+				n += batch.counts[k].second;
+			}
+			pi /= double(n);
+			res.push_back({ batch.users[u], n, measure(pi) });
+		}
+		return res;
+	});
+
+	p.sink(reports, [&](std::vector<UserReport>&& batch) {
+		for(auto& r : batch)
+			report(r);
+	});
+
+	p.run();
+}
+
+void user_reports(string filename, const Grid& grid, const chan& C, const std::function<void(const UserReport&)>& report, const ReportOptions& opt) {
+	if(C.n_rows != grid.width * grid.height)
+		throw std::runtime_error("the mechanism should have a row for each cell of the grid");
+
+	auto bayes = [&C](const prob& pi) {
+		return std::vector<double> { measure::bayes_vuln::prior(pi), measure::bayes_vuln::posterior(pi, C) };
+	};
+	user_reports(filename, grid, bayes, report, opt);
+}
+
+// -- Binary columnar cache --------------------------------------------------
+
+namespace {
+
+struct ColumnsHeader {
+	char magic[8];					// "QIFCHKIN"
+	uint32_t version;
+	uint32_t has_grid;
+	uint64_t size;
+	double center_lat, center_lon, cell_size;
+	uint32_t width, height;
+	uint64_t reserved;
+};
+static_assert(sizeof(ColumnsHeader) == 64, "the header should be 64 bytes");
+
+const char columns_magic[8] = { 'Q', 'I', 'F', 'C', 'H', 'K', 'I', 'N' };
+const uint32_t columns_version = 1;
+
+template<typename T>
+void write_column(std::ofstream& file, const std::vector<Entry>& dataset, T f) {
+	std::vector<decltype(f(dataset[0]))> col;
+	col.reserve(dataset.size());
+	for(auto& e : dataset)
+		col.push_back(f(e));
+	file.write(reinterpret_cast<const char*>(col.data()), col.size() * sizeof(col[0]));
+}
+
+void write_columns_impl(string filename, const std::vector<Entry>& dataset, const GridMap* grid, latlon center, uint width, uint height, double cell_size) {
+	std::ofstream file(filename, std::ios::binary);
+	if(!file)
+		throw std::runtime_error("cannot open " + filename);
+
+	ColumnsHeader h {};
+	std::copy(columns_magic, columns_magic + 8, h.magic);
+	h.version = columns_version;
+	h.has_grid = grid != nullptr;
+	h.size = dataset.size();
+	h.center_lat = center.lat;
+	h.center_lon = center.lon;
+	h.cell_size = cell_size;
+	h.width = width;
+	h.height = height;
+	file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+	// doubles first, so that all columns are aligned
+	if(!dataset.empty()) {
+		write_column(file, dataset, [](const Entry& e) { return e.location.lat; });
+		write_column(file, dataset, [](const Entry& e) { return e.location.lon; });
+		write_column(file, dataset, [](const Entry& e) { return uint32_t(e.userId); });
+		write_column(file, dataset, [](const Entry& e) { return uint32_t(e.locationId); });
+		if(grid)
+			write_column(file, dataset, [&](const Entry& e) { uint c; return grid->cell(e.location, c) ? uint32_t(c) : std::numeric_limits<uint32_t>::max(); });
+	}
+
+	if(!file)
+		throw std::runtime_error("cannot write " + filename);
+}
+
+} // anonymous namespace
+
+bool Columns::has_grid(latlon center, uint width, uint height, double cell_size) const {
+	return cell != nullptr && this->center.lat == center.lat && this->center.lon == center.lon &&
+		this->width == width && this->height == height && this->cell_size == cell_size;
+}
+
+void write_columns(string filename, const std::vector<Entry>& dataset) {
+	write_columns_impl(filename, dataset, nullptr, latlon(0, 0), 0, 0, 0);
+}
+
+void write_columns(string filename, const std::vector<Entry>& dataset, latlon center, uint width, uint height, double cell_size) {
+	GridMap grid(center, width, height, cell_size);
+	write_columns_impl(filename, dataset, &grid, center, width, height, cell_size);
+}
+
+Columns read_columns(string filename) {
+	Columns res;
+	res.file = std::make_shared<const MappedFile>(filename);
+	const MappedFile& file = *res.file;
+
+	ColumnsHeader h;
+	if(file.size() < sizeof(h))
+		throw std::runtime_error(filename + ": not a columns file");
+	std::copy(file.begin(), file.begin() + sizeof(h), reinterpret_cast<char*>(&h));
+
+	if(!std::equal(columns_magic, columns_magic + 8, h.magic))
+		throw std::runtime_error(filename + ": not a columns file");
+	if(h.version != columns_version)
+		throw std::runtime_error(filename + ": unsupported version " + std::to_string(h.version));
+	// h.size is bounded by the remaining bytes before multiplying, so a crafted size cannot overflow the check
+	const uint64_t elem_size = 2 * sizeof(double) + (h.has_grid ? 3 : 2) * sizeof(uint32_t);
+	const uint64_t remaining = file.size() - sizeof(h);
+	if(h.size > remaining / elem_size || h.size * elem_size != remaining)
+		throw std::runtime_error(filename + ": truncated file");
+
+	const char* p = file.begin() + sizeof(h);
+	res.size = h.size;
+	res.lat        = reinterpret_cast<const double*>(p);   p += h.size * sizeof(double);
+	res.lon        = reinterpret_cast<const double*>(p);   p += h.size * sizeof(double);
+	res.userId     = reinterpret_cast<const uint32_t*>(p); p += h.size * sizeof(uint32_t);
+	res.locationId = reinterpret_cast<const uint32_t*>(p); p += h.size * sizeof(uint32_t);
+	if(h.has_grid) {
+		res.cell = reinterpret_cast<const uint32_t*>(p);
+		res.center = latlon(h.center_lat, h.center_lon);
+		res.width = h.width;
+		res.height = h.height;
+		res.cell_size = h.cell_size;
+	}
+	return res;
+}
+
+std::vector<uint> to_grid(const Columns& data, latlon center, uint width, uint height, double cell_size) {
+	if(data.has_grid(center, width, height, cell_size)) {
+		std::vector<uint> points;
+		for(size_t i = 0; i < data.size; i++)
+			if(data.cell[i] != std::numeric_limits<uint32_t>::max())
+				points.push_back(data.cell[i]);
+		return points;
+	}
+
+	return to_grid(data.lat, data.lon, data.size, { Grid(center, width, height, cell_size) })[0];
+}
+
+prob to_grid_prior(const Columns& data, latlon center, uint width, uint height, double cell_size) {
+	if(data.has_grid(center, width, height, cell_size))
+		return points_to_prior(to_grid(data, center, width, height, cell_size), width, height);
+
+	return to_grid_prior(data.lat, data.lon, data.size, { Grid(center, width, height, cell_size) })[0];
+}
+
 // Dummy latlon -> euclid projection. Filters the latlon points keeping only those in a width x height (meters)
 // rectangle centered at 'center'. Coordinates are converted to euclidean, putting the bottom-left corner at (0,0)
 // and top-right at (width,height)
@@ -83,7 +626,7 @@ std::vector<point> project_dummy(const std::vector<Entry>& dataset, latlon cente
 	double lat_max = center.lat + lat_d / 2;
 
 	std::vector<point> res;
-	for(Entry e : dataset) {
+	for(auto& e : dataset) {
 		if(!(e.location.lat >= lat_min && e.location.lat < lat_max && e.location.lon >= lon_min && e.location.lon < lon_max))
 			continue;
 
@@ -96,5 +639,13 @@ std::vector<point> project_dummy(const std::vector<Entry>& dataset, latlon cente
 	return res;
 }
 
+geo::QuadTree<double> to_quadtree(const std::vector<Entry>& dataset, latlon center, double size, uint max_points, double min_size) {
+	return geo::QuadTree<double>(project_dummy(dataset, center, size, size), size, max_points, min_size);
+}
+
+prob to_quadtree_prior(const std::vector<Entry>& dataset, latlon center, const geo::QuadTree<double>& tree) {
+	return tree.prior(project_dummy(dataset, center, tree.size(), tree.size()));
+}
+
 } // namespace gowalla
 } // namespace qif
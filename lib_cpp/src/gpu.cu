@@ -0,0 +1,209 @@
+// CUDA kernels of qif_bits/gpu.h, only compiled when QIF_USE_CUDA is set. This file does not include qif (nvcc does
+// not need to see armadillo/mp++), so the declarations of gpu.h are repeated here and have to be kept in sync.
+//
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <cuda_runtime.h>
+#include <cublas_v2.h>
+
+namespace qif {
+
+typedef uint32_t uint;
+
+namespace gpu::aux {
+
+// target number of rows of the stacked gain matrix, and number of columns of C per GEMM (as in the CPU version,
+// g_vuln::aux::fused_posterior_batch)
+const uint batch_stacked_rows = 2048;
+const uint panel_cols = 1024;
+
+inline void check(cudaError_t err) {
+	if(err != cudaSuccess)
+		throw std::runtime_error(std::string("CUDA error: ") + cudaGetErrorString(err));
+}
+
+inline void check(cublasStatus_t status) {
+	if(status != CUBLAS_STATUS_SUCCESS)
+		throw std::runtime_error("cuBLAS error " + std::to_string(int(status)));
+}
+
+// one cuBLAS handle per host thread
+inline cublasHandle_t handle() {
+	struct Handle {
+		cublasHandle_t h = nullptr;
+		Handle()  { check(cublasCreate(&h)); }
+		~Handle() { cublasDestroy(h); }
+	};
+	thread_local Handle res;
+	return res.h;
+}
+
+// device buffer of n elements
+template<typename eT>
+class Buffer {
+	public:
+		explicit Buffer(size_t n) {
+			if(n > 0)
+				check(cudaMalloc(&ptr, n * sizeof(eT)));
+		}
+		~Buffer() { if(ptr) cudaFree(ptr); }
+		Buffer(const Buffer&) = delete;
+		Buffer& operator=(const Buffer&) = delete;
+
+		eT* get() const { return ptr; }
+
+		void from_host(const eT* src, size_t n) { check(cudaMemcpy(ptr, src, n * sizeof(eT), cudaMemcpyHostToDevice)); }
+		void to_host(eT* dst, size_t n) const   { check(cudaMemcpy(dst, ptr, n * sizeof(eT), cudaMemcpyDeviceToHost)); }
+
+	private:
+		eT* ptr = nullptr;
+};
+
+// gemv/gemm dispatch on the element type
+inline cublasStatus_t gemv(cublasOperation_t op, int m, int n, const float* A, const float* x, float* y) {
+	const float one = 1, zero = 0;
+	return cublasSgemv(handle(), op, m, n, &one, A, m, x, 1, &zero, y, 1);
+}
+inline cublasStatus_t gemv(cublasOperation_t op, int m, int n, const double* A, const double* x, double* y) {
+	const double one = 1, zero = 0;
+	return cublasDgemv(handle(), op, m, n, &one, A, m, x, 1, &zero, y, 1);
+}
+inline cublasStatus_t gemm(int m, int n, int k, const float* A, int lda, const float* B, int ldb, float* C) {
+	const float one = 1, zero = 0;
+	return cublasSgemm(handle(), CUBLAS_OP_N, CUBLAS_OP_N, m, n, k, &one, A, lda, B, ldb, &zero, C, m);
+}
+inline cublasStatus_t gemm(int m, int n, int k, const double* A, int lda, const double* B, int ldb, double* C) {
+	const double one = 1, zero = 0;
+	return cublasDgemm(handle(), CUBLAS_OP_N, CUBLAS_OP_N, m, n, k, &one, A, lda, B, ldb, &zero, C, m);
+}
+
+// S((k-k0) n_w + w, x) = G(w, x) Pis(k, x), for k0 <= k < k0 + n_b
+template<typename eT>
+__global__ void stack_kernel(eT* S, const eT* G, uint n_w, const eT* Pis, uint n_k, uint k0, uint n_b, uint n_x) {
+	size_t rows = size_t(n_b) * n_w;
+	size_t i = size_t(blockIdx.x) * blockDim.x + threadIdx.x;
+	if(i >= rows * n_x)
+		return;
+
+	uint r = uint(i % rows), x = uint(i / rows);
+	uint k = r / n_w, w = r % n_w;
+	S[i] = G[size_t(x) * n_w + w] * Pis[size_t(x) * n_k + k0 + k];
+}
+
+// atomicAdd on doubles is native from sm_60, older architectures get the usual compare-and-swap loop
+__device__ inline void atomic_add(double* address, double val) {
+	#if __CUDA_ARCH__ >= 600
+	atomicAdd(address, val);
+	#else
+	unsigned long long* p = reinterpret_cast<unsigned long long*>(address);
+	unsigned long long old = *p, assumed;
+	do {
+		assumed = old;
+		old = atomicCAS(p, assumed, __double_as_longlong(val + __longlong_as_double(assumed)));
+	} while(assumed != old);
+	#endif
+}
+
+// acc(k0 + k) += opt_w SC(k n_w + w, y), for all y of the panel. Accumulated in double (also for float, like the CPU
+// version), the few k of a block make the atomics cheap.
+template<typename eT>
+__global__ void reduce_kernel(const eT* SC, uint n_w, uint n_b, uint n_y, bool minimize, double* acc) {
+	size_t i = size_t(blockIdx.x) * blockDim.x + threadIdx.x;
+	if(i >= size_t(n_b) * n_y)
+		return;
+
+	uint k = uint(i % n_b), y = uint(i / n_b);
+	const eT* col = SC + size_t(y) * n_b * n_w + size_t(k) * n_w;
+	eT opt = col[0];
+	for(uint w = 1; w < n_w; w++)
+		opt = minimize ? min(opt, col[w]) : max(opt, col[w]);
+
+	atomic_add(acc + k, double(opt));
+}
+
+inline uint n_blocks(size_t n, uint threads) {
+	return uint((n + threads - 1) / threads);
+}
+
+template<typename eT>
+std::shared_ptr<void> upload_impl(const eT* C, uint n_rows, uint n_cols) {
+	size_t n = size_t(n_rows) * n_cols;
+	eT* ptr = nullptr;
+	check(cudaMalloc(&ptr, std::max<size_t>(n, 1) * sizeof(eT)));
+	std::shared_ptr<void> res(ptr, [](void* p) { cudaFree(p); });
+
+	check(cudaMemcpy(ptr, C, n * sizeof(eT), cudaMemcpyHostToDevice));
+	return res;
+}
+
+template<typename eT>
+void product_impl(cublasOperation_t op, const void* dC, uint n_rows, uint n_cols, const eT* v, uint n_v, eT* res, uint n_res) {
+	Buffer<eT> d_v(n_v), d_res(n_res);
+	d_v.from_host(v, n_v);
+	check(gemv(op, n_rows, n_cols, static_cast<const eT*>(dC), d_v.get(), d_res.get()));
+	d_res.to_host(res, n_res);
+}
+
+template<typename eT>
+void posterior_batch_impl(const void* dC, uint n_x, uint n_y, const eT* G, uint n_w, const eT* Pis, uint n_k, bool minimize, eT* res) {
+	const eT* C = static_cast<const eT*>(dC);
+	const uint threads = 256;
+	const uint block = std::max(1u, batch_stacked_rows / n_w);		// priors per block
+	const uint panel = std::min(panel_cols, n_y);
+
+	Buffer<eT> d_G(size_t(n_w) * n_x), d_Pis(size_t(n_k) * n_x);
+	d_G.from_host(G, size_t(n_w) * n_x);
+	d_Pis.from_host(Pis, size_t(n_k) * n_x);
+
+	Buffer<eT> S(size_t(block) * n_w * n_x), SC(size_t(block) * n_w * panel);
+	Buffer<double> acc(n_k);
+	check(cudaMemset(acc.get(), 0, n_k * sizeof(double)));
+
+	for(uint k0 = 0; k0 < n_k; k0 += block) {
+		uint n_b = std::min(block, n_k - k0);
+		uint rows = n_b * n_w;
+
+		stack_kernel<<<n_blocks(size_t(rows) * n_x, threads), threads>>>(S.get(), d_G.get(), n_w, d_Pis.get(), n_k, k0, n_b, n_x);
+		check(cudaGetLastError());
+
+		for(uint y0 = 0; y0 < n_y; y0 += panel) {
+			uint n_p = std::min(panel, n_y - y0);
+
+			check(gemm(rows, n_p, n_x, S.get(), rows, C + size_t(y0) * n_x, n_x, SC.get()));
+
+			reduce_kernel<<<n_blocks(size_t(n_b) * n_p, threads), threads>>>(SC.get(), n_w, n_b, n_p, minimize, acc.get() + k0);
+			check(cudaGetLastError());
+		}
+	}
+
+	std::vector<double> host(n_k);
+	acc.to_host(host.data(), n_k);
+	for(uint k = 0; k < n_k; k++)
+		res[k] = eT(host[k]);
+}
+
+int device_count() {
+	int n = 0;
+	if(cudaGetDeviceCount(&n) != cudaSuccess)
+		return 0;
+	return n;
+}
+
+std::shared_ptr<void> upload(const float* C, uint n_rows, uint n_cols)		{ return upload_impl(C, n_rows, n_cols); }
+std::shared_ptr<void> upload(const double* C, uint n_rows, uint n_cols)	{ return upload_impl(C, n_rows, n_cols); }
+
+void left(const void* dC, uint n_rows, uint n_cols, const float* v, float* res)		{ product_impl(CUBLAS_OP_T, dC, n_rows, n_cols, v, n_rows, res, n_cols); }
+void left(const void* dC, uint n_rows, uint n_cols, const double* v, double* res)		{ product_impl(CUBLAS_OP_T, dC, n_rows, n_cols, v, n_rows, res, n_cols); }
+void right(const void* dC, uint n_rows, uint n_cols, const float* v, float* res)		{ product_impl(CUBLAS_OP_N, dC, n_rows, n_cols, v, n_cols, res, n_rows); }
+void right(const void* dC, uint n_rows, uint n_cols, const double* v, double* res)	{ product_impl(CUBLAS_OP_N, dC, n_rows, n_cols, v, n_cols, res, n_rows); }
+
+void posterior_batch(const void* dC, uint n_rows, uint n_cols, const float* G, uint n_w, const float* Pis, uint n_k, bool minimize, float* res)		{ posterior_batch_impl(dC, n_rows, n_cols, G, n_w, Pis, n_k, minimize, res); }
+void posterior_batch(const void* dC, uint n_rows, uint n_cols, const double* G, uint n_w, const double* Pis, uint n_k, bool minimize, double* res)	{ posterior_batch_impl(dC, n_rows, n_cols, G, n_w, Pis, n_k, minimize, res); }
+
+} // namespace gpu::aux
+} // namespace qif
@@ -0,0 +1,11 @@
+#include "qif"
+
+// The explicit instantiations declared extern in qif_bits/instantiate.h
+
+namespace qif {
+
+#define QIF_INSTANTIATE(...) template __VA_ARGS__;
+QIF_INSTANTIATIONS(QIF_INSTANTIATE)
+#undef QIF_INSTANTIATE
+
+} // namespace qif
@@ -2,6 +2,8 @@
 extern "C" {
 	#include <gsl/gsl_sf.h>				// gsl_sf_lambert_Wm1
 	#include <gsl/gsl_monte_miser.h>
+	#include <gsl/gsl_integration.h>
+	#include <gsl/gsl_errno.h>
 }
 
 #include "qif"
@@ -15,11 +17,15 @@ using std::min;
 //double max_error = 0;
 //double sum_error = 0;
 
-double _coeff, _epsilon;					// params of palnar_laplace_pdf, need to be global to pass function pointer to gsl_monte_miser_integrate
+// params of planar_laplace_pdf, passed through the params pointer of gsl_monte_function
+struct PdfParams {
+	double coeff;
+	double epsilon;
+};
 
-
-double planar_laplace_pdf(double *x, size_t, void *) {
-	return _coeff * exp( - _epsilon * sqrt(x[0] * x[0] + x[1] * x[1]) );
+double planar_laplace_pdf(double *x, size_t, void *params) {
+	const PdfParams& p = *static_cast<PdfParams*>(params);
+	return p.coeff * exp( - p.epsilon * sqrt(x[0] * x[0] + x[1] * x[1]) );
 }
 
 double inverse_cumulative_gamma(double epsilon, double p) {
@@ -32,23 +38,121 @@ int bound(int val, int min_val, int max_val) {
 	return min(max(val, min_val), max_val);
 }
 
-gsl_rng *r;
-gsl_monte_function L = { &planar_laplace_pdf, 2, 0 };
 
-double integrate_laplace(double epsilon, const arma::vec& a, const arma::vec& b, int calls) {
-	if(!r) {
-		gsl_rng_env_setup();
-		r = gsl_rng_alloc(gsl_rng_default);
-	}
+// GSL's default error handler calls abort(). Turn it off while integrating (restoring the previous
+// one on exit), so that failures are reported through the returned status and thrown as exceptions.
+// The handler is global and integrations run concurrently, so the first active guard turns it off
+// and the last one restores it.
+//
+class GslHandlerOff {
+	public:
+		GslHandlerOff() {
+			std::lock_guard<std::mutex> lock(mutex);
+			if(active++ == 0)
+				prev = gsl_set_error_handler_off();
+		}
+		~GslHandlerOff() {
+			std::lock_guard<std::mutex> lock(mutex);
+			if(--active == 0)
+				gsl_set_error_handler(prev);
+		}
+		GslHandlerOff(const GslHandlerOff&) = delete;
+		GslHandlerOff& operator=(const GslHandlerOff&) = delete;
+
+	private:
+		inline static std::mutex mutex;
+		inline static uint active = 0;
+		inline static gsl_error_handler_t* prev = nullptr;
+};
+
+void check_status(int status, const char* what) {
+	if(status)
+		throw std::runtime_error(std::string("planar_laplace: ") + what + " failed: " + gsl_strerror(status));
+}
 
-	_epsilon = epsilon;
-	_coeff = (_epsilon * _epsilon) / (2 * arma::Datum<double>::pi);
+
+// nested 1d adaptive Gauss-Kronrod quadrature. The outer integral is over x, the inner over y.
+// The pdf is not smooth at the origin, so intervals containing 0 are split there, making the
+// singularity lie on the boundary where the adaptive method deals with it much better.
+//
+const size_t quad_limit = 1000;				// max subintervals per 1d integral
+const double quad_epsabs = 1e-14;
+const double quad_epsrel_inner = 1e-11;		// inner is tighter than outer, so that its error does not
+const double quad_epsrel_outer = 1e-9;		// look like noise to the outer integration
+
+struct QuadParams {
+	PdfParams pdf;
+	double x;								// current x of the outer integration
+	double y_min, y_max;
+	gsl_integration_workspace* inner;
+	int inner_status;						// first failure of the inner integration (we cannot throw through GSL)
+};
+
+// status keeps the first non-zero status returned by gsl
+double integrate_1d(gsl_function* F, double lo, double hi, double epsrel, gsl_integration_workspace* w, int& status) {
+	if(lo < 0 && hi > 0)
+		return integrate_1d(F, lo, 0, epsrel, w, status) + integrate_1d(F, 0, hi, epsrel, w, status);
 
 	double res, err;
+	int st = gsl_integration_qag(F, lo, hi, quad_epsabs, epsrel, quad_limit, GSL_INTEG_GAUSS21, w, &res, &err);
+	if(!status)
+		status = st;
+	return res;
+}
+
+double quad_inner(double y, void *params) {
+	QuadParams& q = *static_cast<QuadParams*>(params);
+	double x[2] = { q.x, y };
+	return planar_laplace_pdf(x, 2, &q.pdf);
+}
+
+double quad_outer(double x, void *params) {
+	QuadParams& q = *static_cast<QuadParams*>(params);
+	q.x = x;
 
-	gsl_monte_miser_state *s = gsl_monte_miser_alloc (2);
-	gsl_monte_miser_integrate(&L, a.colptr(0), b.colptr(0), 2, calls, r, s, &res, &err);
-	gsl_monte_miser_free(s);
+	gsl_function F = { &quad_inner, params };
+	return integrate_1d(&F, q.y_min, q.y_max, quad_epsrel_inner, q.inner, q.inner_status);
+}
+
+
+// IntegrationContext ////////////////////////////////////////////////////////
+
+IntegrationContext::IntegrationContext() {
+	// gsl_rng_env_setup reads GSL_RNG_TYPE/GSL_RNG_SEED and sets global variables, so call only once
+	static std::once_flag env_flag;
+	std::call_once(env_flag, gsl_rng_env_setup);
+
+	rng = gsl_rng_alloc(gsl_rng_default);
+	state = gsl_monte_miser_alloc(2);
+	outer_ws = gsl_integration_workspace_alloc(quad_limit);
+	inner_ws = gsl_integration_workspace_alloc(quad_limit);
+}
+
+IntegrationContext::IntegrationContext(unsigned long seed) : IntegrationContext() {
+	set_seed(seed);
+}
+
+IntegrationContext::~IntegrationContext() {
+	gsl_monte_miser_free(static_cast<gsl_monte_miser_state*>(state));
+	gsl_rng_free(static_cast<gsl_rng*>(rng));
+	gsl_integration_workspace_free(static_cast<gsl_integration_workspace*>(outer_ws));
+	gsl_integration_workspace_free(static_cast<gsl_integration_workspace*>(inner_ws));
+}
+
+void IntegrationContext::set_seed(unsigned long seed) {
+	gsl_rng_set(static_cast<gsl_rng*>(rng), seed);
+}
+
+double IntegrationContext::integrate(double epsilon, const arma::vec& a, const arma::vec& b, int calls) {
+	PdfParams params = { (epsilon * epsilon) / (2 * arma::Datum<double>::pi), epsilon };
+	gsl_monte_function L = { &planar_laplace_pdf, 2, &params };
+
+	// miser's state only holds the algorithm's parameters and scratch space, so it can be reused across calls
+	GslHandlerOff handler_off;
+	double res, err;
+	int status = gsl_monte_miser_integrate(&L, a.colptr(0), b.colptr(0), 2, calls, static_cast<gsl_rng*>(rng),
+		static_cast<gsl_monte_miser_state*>(state), &res, &err);
+	check_status(status, "miser integration");
 
 	// store errors
 	//if(err > max_error) max_error = err;
@@ -57,5 +161,32 @@ double integrate_laplace(double epsilon, const arma::vec& a, const arma::vec& b,
 	return res;
 }
 
-} // namespace qif::mechanism::geo_ind
+double IntegrationContext::integrate_quadrature(double epsilon, const arma::vec& a, const arma::vec& b) {
+	QuadParams params = {
+		{ (epsilon * epsilon) / (2 * arma::Datum<double>::pi), epsilon },
+		0, a(1), b(1),
+		static_cast<gsl_integration_workspace*>(inner_ws),
+		0
+	};
+	gsl_function F = { &quad_outer, &params };
+
+	GslHandlerOff handler_off;
+	int status = 0;
+	double res = integrate_1d(&F, a(0), b(0), quad_epsrel_outer, static_cast<gsl_integration_workspace*>(outer_ws), status);
+	check_status(params.inner_status, "inner quadrature");
+	check_status(status, "outer quadrature");
+	return res;
+}
+
+double integrate_laplace(double epsilon, const arma::vec& a, const arma::vec& b, int calls) {
+	// every thread gets its own context, so calling from multiple threads is safe
+	thread_local IntegrationContext ctx;
+	return ctx.integrate(epsilon, a, b, calls);
+}
+
+double integrate_laplace_quadrature(double epsilon, const arma::vec& a, const arma::vec& b) {
+	thread_local IntegrationContext ctx;
+	return ctx.integrate_quadrature(epsilon, a, b);
+}
 
+} // namespace qif::mechanism::geo_ind
@@ -0,0 +1,144 @@
+#include "qif"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define QIF_HAS_SOCKETS
+	#include <sys/socket.h>
+	#include <sys/time.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <netdb.h>
+	#include <poll.h>
+	#include <unistd.h>
+#endif
+
+namespace qif::sweep::aux {
+
+#ifdef QIF_HAS_SOCKETS
+
+// seconds a connection waits for the other side, so that a stuck peer cannot block the server
+const int io_timeout = 10;
+
+Connection::Connection(int fd) : fd(fd) {
+	struct timeval tv = { io_timeout, 0 };
+	::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	int one = 1;
+	::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+Connection::~Connection() {
+	::close(fd);
+}
+
+std::string Connection::read_line() {
+	size_t nl;
+	while((nl = buffer.find('\n')) == std::string::npos) {
+		char chunk[4096];
+		ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+		if(n <= 0)
+			throw std::runtime_error("sweep: connection closed");
+		buffer.append(chunk, n);
+	}
+	std::string line = buffer.substr(0, nl);
+	buffer.erase(0, nl + 1);
+	return line;
+}
+
+void Connection::write_line(const std::string& line) {
+	std::string data = line + "\n";
+	for(size_t sent = 0; sent < data.size(); ) {
+		#ifdef MSG_NOSIGNAL
+		ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);	// no SIGPIPE if the peer is gone
+		#else
+		ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, 0);
+		#endif
+		if(n <= 0)
+			throw std::runtime_error("sweep: connection closed");
+		sent += n;
+	}
+}
+
+Listener::Listener(uint16_t port, const std::string& address) {
+	struct addrinfo hints {}, *res = nullptr;
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+	if(::getaddrinfo(address.empty() ? nullptr : address.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res)
+		throw std::runtime_error("sweep: invalid address " + address);
+
+	fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if(fd < 0) {
+		::freeaddrinfo(res);
+		throw std::runtime_error("sweep: cannot create socket");
+	}
+
+	int one = 1;
+	::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	bool ok = ::bind(fd, res->ai_addr, res->ai_addrlen) == 0 && ::listen(fd, 128) == 0;
+	::freeaddrinfo(res);
+	if(!ok) {
+		::close(fd);
+		throw std::runtime_error("sweep: cannot listen on " + address + " port " + std::to_string(port));
+	}
+
+	struct sockaddr_storage addr {};
+	socklen_t len = sizeof(addr);
+	::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+	bound_port = addr.ss_family == AF_INET6
+		? ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port)
+		: ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+}
+
+Listener::~Listener() {
+	::close(fd);
+}
+
+std::unique_ptr<Connection> Listener::accept(double timeout) {
+	struct pollfd p = { fd, POLLIN, 0 };
+	if(::poll(&p, 1, int(timeout * 1000)) <= 0)
+		return nullptr;
+
+	int conn = ::accept(fd, nullptr, nullptr);
+	if(conn < 0)
+		return nullptr;
+	return std::make_unique<Connection>(conn);
+}
+
+std::unique_ptr<Connection> connect(const std::string& host, uint16_t port) {
+	struct addrinfo hints {}, *res = nullptr;
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if(::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0)
+		return nullptr;
+
+	std::unique_ptr<Connection> conn;
+	for(struct addrinfo* a = res; a && !conn; a = a->ai_next) {
+		int fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if(fd < 0)
+			continue;
+		if(::connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+			conn = std::make_unique<Connection>(fd);
+		else
+			::close(fd);
+	}
+	::freeaddrinfo(res);
+	return conn;
+}
+
+#else
+
+Connection::Connection(int fd) : fd(fd) {}
+Connection::~Connection() {}
+std::string Connection::read_line() { throw std::runtime_error("sweep: sockets are not supported on this platform"); }
+void Connection::write_line(const std::string&) { throw std::runtime_error("sweep: sockets are not supported on this platform"); }
+
+Listener::Listener(uint16_t, const std::string&) : fd(-1), bound_port(0) { throw std::runtime_error("sweep: sockets are not supported on this platform"); }
+Listener::~Listener() {}
+std::unique_ptr<Connection> Listener::accept(double) { return nullptr; }
+
+std::unique_ptr<Connection> connect(const std::string&, uint16_t) { return nullptr; }
+
+#endif
+
+} // namespace qif::sweep::aux
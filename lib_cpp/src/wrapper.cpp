@@ -18,13 +18,24 @@ void glp_init_smcp(glp_smcp *parm)																{ return ::glp_init_smcp(parm)
 int glp_simplex(glp_prob *P, const glp_smcp *parm)												{ return ::glp_simplex(P, parm); }
 int glp_get_status(glp_prob *P)																	{ return ::glp_get_status(P); }
 int glp_get_dual_stat(glp_prob *P)																{ return ::glp_get_dual_stat(P); }
+int glp_get_prim_stat(glp_prob *P)																{ return ::glp_get_prim_stat(P); }
 double glp_get_col_prim(glp_prob *P, int j)														{ return ::glp_get_col_prim(P, j); }
 int glp_interior(glp_prob *P, const glp_iptcp *parm)											{ return ::glp_interior(P, parm); }
 void glp_init_iptcp(glp_iptcp *parm)															{ return ::glp_init_iptcp(parm); }
 int glp_ipt_status(glp_prob *P)																	{ return ::glp_ipt_status(P); }
 double glp_ipt_col_prim(glp_prob *P, int j)														{ return ::glp_ipt_col_prim(P, j); }
+double glp_get_row_dual(glp_prob *P, int i)														{ return ::glp_get_row_dual(P, i); }
+double glp_get_col_dual(glp_prob *P, int j)														{ return ::glp_get_col_dual(P, j); }
+double glp_ipt_row_dual(glp_prob *P, int i)														{ return ::glp_ipt_row_dual(P, i); }
+double glp_ipt_col_dual(glp_prob *P, int j)														{ return ::glp_ipt_col_dual(P, j); }
 void glp_delete_prob(glp_prob *P)																{ return ::glp_delete_prob(P); }
 int glp_free_env(void)																			{ return ::glp_free_env(); }
+void glp_set_row_stat(glp_prob *P, int i, int stat)												{ return ::glp_set_row_stat(P, i, stat); }
+void glp_set_col_stat(glp_prob *P, int j, int stat)												{ return ::glp_set_col_stat(P, j, stat); }
+int glp_get_row_stat(glp_prob *P, int i)														{ return ::glp_get_row_stat(P, i); }
+int glp_get_col_stat(glp_prob *P, int j)														{ return ::glp_get_col_stat(P, j); }
+void glp_std_basis(glp_prob *P)																	{ return ::glp_std_basis(P); }
+int glp_get_it_cnt(glp_prob *P)																	{ return ::glp_get_it_cnt(P); }
 #endif
 
 
@@ -34,6 +45,9 @@ void osqp_set_default_settings(OSQPSettings *settings)									{ return ::osqp_s
 c_int osqp_setup(OSQPWorkspace **work, const OSQPData *data, OSQPSettings *settings)	{ return ::osqp_setup(work, data, settings); }
 c_int osqp_solve(OSQPWorkspace *work)													{ return ::osqp_solve(work); }
 c_int osqp_cleanup(OSQPWorkspace *work)													{ return ::osqp_cleanup(work); }
+c_int osqp_update_lin_cost(OSQPWorkspace *work, const c_float *q_new)						{ return ::osqp_update_lin_cost(work, q_new); }
+c_int osqp_update_bounds(OSQPWorkspace *work, const c_float *l_new, const c_float *u_new)	{ return ::osqp_update_bounds(work, l_new, u_new); }
+c_int osqp_warm_start(OSQPWorkspace *work, const c_float *x, const c_float *y)			{ return ::osqp_warm_start(work, x, y); }
 csc* csc_matrix(c_int m, c_int n, c_int nzmax, c_float *x, c_int *i, c_int *p)			{ return ::csc_matrix(m, n, nzmax, x, i, p); }
 
 
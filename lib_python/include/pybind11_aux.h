@@ -5,6 +5,7 @@
 #include <vector>
 #include <pybind11/pybind11.h>
 #include <pybind11/functional.h>
+#include <pybind11/stl.h>			// std::vector results
 #include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 #include <armadillo>
@@ -17,9 +18,93 @@ using qif::uint;
 template<typename... Args>
 constexpr auto overload = pybind11::overload_cast<Args...>;	// for selecting member of overloaded function
 
-extern pybind11::handle def_c, double_c, uint_c, rat_c, point_c;
+// Time spent in the C++ functions bound with nogil, for profiling the binding overhead (qif.trace.cpp_time). The guard
+// lives between the conversion of the arguments and that of the result, so the difference between the time of a
+// python call and its C++ time is the cost of the binding layer. Only the outermost call of each thread is counted
+// (nested calls through python callbacks are part of it, and so is the time spent in the callbacks themselves).
+// Off by default, a disabled timer costs an atomic load per call.
+//
+class CppTimer {
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		static std::atomic<bool>& enabled()		{ static std::atomic<bool> e(false); return e; }
+		static std::atomic<int64_t>& total_ns()	{ static std::atomic<int64_t> n(0); return n; }
+		static std::atomic<int64_t>& calls()	{ static std::atomic<int64_t> n(0); return n; }
+
+		CppTimer() {
+			if(enabled().load(std::memory_order_relaxed) && depth() == 0) {
+				depth()++;
+				outer = true;
+				start = Clock::now();
+			}
+		}
+		~CppTimer() {
+			if(!outer)
+				return;
+			depth()--;
+			total_ns() += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+			calls()++;
+		}
+		CppTimer(const CppTimer&) = delete;
+		CppTimer& operator=(const CppTimer&) = delete;
+
+	private:
+		bool outer = false;
+		Clock::time_point start;
+
+		static uint& depth() { thread_local uint d = 0; return d; }
+};
+
+// Releases the GIL for the duration of a call: m.def("f", f, "x"_a, nogil()). Arguments are converted before and the
+// result after, with the GIL held. Also fine for functions taking python callbacks (eg metrics), since pybind11
+// re-acquires the GIL whenever one of them is called. Not for functions that touch python objects themselves.
+// The call is timed by CppTimer (constructed after the GIL is released, destroyed before it is re-acquired).
+typedef pybind11::call_guard<pybind11::gil_scoped_release, CppTimer> nogil;
+
+// Returns f as a python function that releases the GIL while running, for the heavy callables produced by the library
+// (eg kantorovich metrics).
+template<typename F>
+pybind11::cpp_function nogil_function(F f) {
+	return pybind11::cpp_function(std::move(f), nogil());
+}
+
+// For the *_many variants: evaluates f(as[i], bs[i]) for all i in parallel, without the GIL. A list of size 1 is used
+// with all elements of the other. f is called from worker threads, so it should not call back into python.
+template<typename F, typename A, typename B>
+auto map_many(F f, const std::vector<A>& as, const std::vector<B>& bs) {
+	std::vector<decltype(f(as[0], bs[0]))> res;
+	if(as.empty() || bs.empty())
+		return res;
+	if(as.size() != bs.size() && as.size() != 1 && bs.size() != 1)
+		throw std::runtime_error("lists of incompatible sizes");
+
+	res.resize(std::max(as.size(), bs.size()));
+
+	pybind11::gil_scoped_release release;
+	qif::parallel::for_each(res.size(), [&](uint i) {
+		res[i] = f(as[as.size() == 1 ? 0 : i], bs[bs.size() == 1 ? 0 : i]);
+	});
+	return res;
+}
+
+extern pybind11::handle def_c, double_c, float_c, uint_c, rat_c, point_c;
+
+// A rat matrix (or vector) owned by C++, exposed to python as qif.RationalArray (see the Mat<rat> caster)
+struct RationalArray {
+	std::shared_ptr<arma::Mat<qif::rat>> mat;
+	bool vector;				// 1-dimensional
+};
+
+extern bool rational_arrays;	// return rat matrices as RationalArray, set by set_rational_arrays
+
+// qif.metric.defaults, vectorize = false calls every python metric once per pair (see type_caster<Metric> below)
+struct MetricDefaults {
+	inline static bool vectorize = true;
+};
 
 struct double_c_t {};		// a type that only accepts double_c
+struct float_c_t {};
 struct uint_c_t {};
 struct rat_c_t {};
 struct point_c_t {};
@@ -41,6 +126,13 @@ public:
 		return (src.is(def_type()) ? def_c : src).is(double_c);
 	}
 };
+template <> struct type_caster<float_c_t> {
+public:
+	PYBIND11_TYPE_CASTER(float_c_t, _("class[float32]"));
+	bool load(handle src, bool) {
+		return (src.is(def_type()) ? def_c : src).is(float_c);
+	}
+};
 template <> struct type_caster<uint_c_t> {
 public:
 	PYBIND11_TYPE_CASTER(uint_c_t, _("class[uint]"));
@@ -86,6 +178,12 @@ public:
 			return _("Col<double>");
 		else if constexpr (std::is_same<Type, arma::Mat<double>>::value)
 			return _("Mat<double>");
+		else if constexpr (std::is_same<Type, arma::Row<float>>::value)
+			return _("Row<float>");
+		else if constexpr (std::is_same<Type, arma::Col<float>>::value)
+			return _("Col<float>");
+		else if constexpr (std::is_same<Type, arma::Mat<float>>::value)
+			return _("Mat<float>");
 		else if constexpr (std::is_same<Type, arma::Row<uint>>::value)
 			return _("Row<uint>");
 		else if constexpr (std::is_same<Type, arma::Col<uint>>::value)
@@ -186,8 +284,132 @@ public:
 };
 
 
-///////////////////////////// Mat<rat> | Row<rat> | Col<rat> ///////////////////////////////////////
+///////////////////////////// MappedChan<double> ///////////////////////////////////////
+//
+// A memory-mapped (numpy.memmap), C-ordered 2d float64 array, as a MappedChan view of its memory: no copy and no
+// transposition, so arrays larger than RAM can be used. Bindings that support it register a MappedChan overload
+// *before* the Mat one. Other arrays go to the latter: Fortran-ordered ones are used in place, and C-ordered ones that
+// are in memory are copied once to a (column-major) Chan, which the parallel measures handle much faster than the
+// serial row-by-row MappedChan path.
+//
+template <> struct type_caster<qif::channel::MappedChan<double>> {
+	using MappedChan = qif::channel::MappedChan<double>;
+
+private:
+	std::unique_ptr<MappedChan> value_ref;
+
+public:
+	static constexpr auto name = _("Mat<double>[C-order]");
+
+	bool load(handle src, bool) {
+		using Array = array_t<double>;
+		if(!isinstance<Array>(src))
+			return false;
+
+		if(!isinstance(src, module_::import("numpy").attr("memmap")))
+			return false;
+
+		Array array = reinterpret_borrow<Array>(src);
+		const ssize_t sz = sizeof(double);
+		if(array.ndim() != 2 || array.strides(1) != sz || array.strides(0) != sz * array.shape(1))
+			return false;
+
+		// src is kept alive by the caller during the call
+		value_ref.reset(new MappedChan(array.data(), array.shape(0), array.shape(1)));
+		return true;
+	}
+
+	operator MappedChan*() { return value_ref.get(); }
+	operator MappedChan&() { return *value_ref; }
+	template <typename _T> using cast_op_type = pybind11::detail::cast_op_type<_T>;
+};
+
+
+///////////////////////////// SpMat<native> ///////////////////////////////////////
+//
+// scipy.sparse matrices, recognised by their format/indptr/indices/data attributes (scipy itself is only imported to
+// return results). Armadillo's SpMat cannot use external memory, so the three CSC buffers are copied in bulk (O(nnz),
+// no python call per element). CSR is read as the CSC form of the transpose, which is then transposed, other formats
+// (coo, lil, ...) are converted with tocsc() in the convert pass. Results are returned as csc_matrix.
+//
+template <typename eT>
+class type_caster<arma::SpMat<eT>, std::enable_if_t<std::is_floating_point<eT>::value>> {
+	using Type = arma::SpMat<eT>;
+	using uword = arma::uword;
+
+private:
+	std::shared_ptr<Type> value_ref;
+
+public:
+	static constexpr auto name = _("scipy.sparse.csc_matrix");
+
+	bool load(handle src, bool convert) {
+		if(!hasattr(src, "format") || !hasattr(src, "tocsc"))
+			return false;
+
+		object m = reinterpret_borrow<object>(src);
+		std::string format = m.attr("format").cast<std::string>();
+		if(format != "csc" && format != "csr") {
+			if(!convert || !hasattr(m, "tocsc"))
+				return false;
+			m = m.attr("tocsc")();
+			format = "csc";
+		}
+		if(!m.attr("has_canonical_format").cast<bool>()) {		// armadillo needs sorted indices, without duplicates
+			m = m.attr("copy")();
+			m.attr("sum_duplicates")();
+		}
+
+		using IndexArray = array_t<uword, array::forcecast | array::c_style>;
+		using DataArray = array_t<eT, array::forcecast | array::c_style>;
+		IndexArray indptr = IndexArray::ensure(m.attr("indptr")), indices = IndexArray::ensure(m.attr("indices"));
+		DataArray data = DataArray::ensure(m.attr("data"));
+		if(!indptr || !indices || !data)
+			return false;
+
+		// views of the (possibly converted) numpy buffers, copied once by the SpMat constructor
+		auto shape = m.attr("shape").cast<std::pair<uword, uword>>();
+		const bool csc = format == "csc";
+		const uword n_rows = csc ? shape.first : shape.second, n_cols = csc ? shape.second : shape.first;
+		const arma::Col<uword> v_indices(const_cast<uword*>(indices.data()), indices.size(), false, true);
+		const arma::Col<uword> v_indptr(const_cast<uword*>(indptr.data()), indptr.size(), false, true);
+		const arma::Col<eT> v_data(const_cast<eT*>(data.data()), data.size(), false, true);
+
+		value_ref = std::make_shared<Type>(v_indices, v_indptr, v_data, n_rows, n_cols);
+		if(!csc)
+			*value_ref = value_ref->t();
+
+		return true;
+	}
+
+	operator Type*() { return value_ref.get(); }
+	operator Type&() { return *value_ref; }
+	operator Type&&() && { return std::move(*value_ref); }
+	template <typename _T> using cast_op_type = pybind11::detail::cast_op_type<_T>;
+
+	static handle cast(const Type& src, return_value_policy /* policy */, handle /* parent */) {
+		src.sync();
 
+		array_t<eT> data(src.n_nonzero, src.values);
+		array_t<int64_t> indices(src.n_nonzero), indptr(src.n_cols + 1);
+		for(uword i = 0; i < src.n_nonzero; i++)
+			indices.mutable_at(i) = src.row_indices[i];
+		for(uword j = 0; j <= src.n_cols; j++)
+			indptr.mutable_at(j) = src.col_ptrs[j];
+
+		object csc_matrix = module_::import("scipy.sparse").attr("csc_matrix");
+		return csc_matrix(make_tuple(data, indices, indptr), make_tuple(src.n_rows, src.n_cols)).release();
+	}
+};
+
+
+///////////////////////////// Mat<rat> | Row<rat> | Col<rat> ///////////////////////////////////////
+//
+// Rat matrices are exchanged either as numpy arrays of Fraction objects (one python object per element, converted
+// each way), or as qif.RationalArray, which holds the C++ matrix itself: a RationalArray argument is used in place,
+// and with set_rational_arrays(True) results are returned as RationalArray too, so exact computations can be chained
+// from python without ever materialising Fractions.
+//
 template <typename Type>
 class type_caster<
 	Type,
@@ -198,18 +420,38 @@ class type_caster<
 > {
 	using rat = qif::rat;
 
-	PYBIND11_TYPE_CASTER(Type, []{
+private:
+	std::shared_ptr<Type> value_ref;
+	bool is_view = false;				// value_ref uses the memory of a RationalArray
+
+public:
+	static constexpr auto name = [] {
 		if constexpr (std::is_same<Type, arma::Row<rat>>::value)
 			return _("Row<rat>");
 		else if constexpr (std::is_same<Type, arma::Col<rat>>::value)
 			return _("Col<rat>");
 		else
 			return _("Mat<rat>");
-	}());
-
-public:
+	}();
 
 	bool load(handle src, bool) {
+		constexpr bool is_vector = !arma::is_Mat_only<Type>::value;
+
+		if(isinstance<RationalArray>(src)) {
+			// no copy, the matrix is kept alive by the deleter
+			auto mat = src.cast<const RationalArray&>().mat;
+			if(src.cast<const RationalArray&>().vector != is_vector)
+				return false;
+
+			Type* view;
+			if constexpr (is_vector)
+				view = new Type(mat->memptr(), mat->n_elem, false, true);
+			else
+				view = new Type(mat->memptr(), mat->n_rows, mat->n_cols, false, true);
+			value_ref = std::shared_ptr<Type>(view, [mat](Type* p) { delete p; });
+			is_view = true;
+			return true;
+		}
 
 		if(!isinstance<buffer>(src))
 			return false;
@@ -219,8 +461,11 @@ public:
 		if(info.format != "O")
 			return false;		// dtype should be object
 
+		value_ref = std::make_shared<Type>();
+		is_view = false;
+		Type& value = *value_ref;
 
-		if constexpr (std::is_same<Type, arma::Row<rat>>::value || std::is_same<Type, arma::Col<rat>>::value) {
+		if constexpr (is_vector) {
 
 			if(info.ndim != 1)
 				return false;
@@ -234,7 +479,7 @@ public:
 			for(uint x = 0; x < n_elem; x++)
 				value(x) = handle(*(PyObject**)(ptr + x*sx)).cast<rat>();
 
-		} else if constexpr (std::is_same<Type, arma::Mat<rat>>::value) {
+		} else {
 
 			if(info.ndim != 2)
 				return false;
@@ -255,8 +500,35 @@ public:
 		return true;
 	}
 
-    // const lvalue reference return; we always copy so no need to define other cases
-	static handle cast(const Type& src, return_value_policy /* policy */, handle /* parent */) {
+    operator Type*() { return value_ref.get(); }
+    operator Type&() { return *value_ref; }
+    // by-value arguments: a RationalArray is copied, so that the callee cannot modify (or steal) the caller's array.
+    // Only a matrix owned by the caster (converted from Fractions) is moved
+    operator Type&&() && {
+        if(is_view) {
+            value_ref = std::make_shared<Type>(*value_ref);		// armadillo copies always allocate
+            is_view = false;
+        }
+        return std::move(*value_ref);
+    }
+    template <typename _T> using cast_op_type = pybind11::detail::cast_op_type<_T>;
+
+	// Normal returned non-reference, non-const value:
+	static handle cast(Type&& src, return_value_policy policy, handle parent) {
+		if(!rational_arrays)
+			return to_objects(src);
+
+		constexpr bool is_vector = !arma::is_Mat_only<Type>::value;
+		return pybind11::cast(RationalArray { std::make_shared<arma::Mat<rat>>(std::move(src)), is_vector }).release();
+	}
+
+    // const lvalue reference return; copy
+	static handle cast(const Type& src, return_value_policy policy, handle parent) {
+		return rational_arrays ? cast(Type(src), policy, parent) : to_objects(src);
+	}
+
+	// numpy array of Fraction objects
+	static handle to_objects(const Type& src) {
 
 		size_t sz = sizeof(PyObject*);
 		std::vector<size_t> shape, strides;
@@ -286,4 +558,131 @@ public:
 	}
 };
 
+
+///////////////////////////// Metric<double,uint> ///////////////////////////////////////
+//
+// A python metric on uint is called by the library once per pair of indexes, often n^2 times or more, each call being a
+// roundtrip to the interpreter. Instead, python functions are evaluated in vectorised form: d(I, J) is called once on
+// integer index arrays (of some size N x N, grown by doubling when an index >= N is requested), and the resulting
+// distance matrix is used from then on, without the GIL.
+//
+// If d does not support arrays (raises, or does not return a N x N array of numbers), or the matrix would be too
+// large, it falls back to calling d(i, j) for each pair (the previous behaviour). So are functions coming from C++
+// (eg metric.euclidean()).
+//
+// Functions that accept arrays but are meant for scalars (they have side effects, or give a wrong result elementwise,
+// eg. using `and` or `if`) can opt out: those marked with metric.scalar (attribute qif_vectorize = False) are always
+// called per pair, and so are all functions if metric.defaults.vectorize is False.
+//
+template <> struct type_caster<qif::Metric<double,uint>> {
+	using Metric = qif::Metric<double,uint>;
+
+	PYBIND11_TYPE_CASTER(Metric, _("Callable[[int, int], float]"));
+
+	struct State {
+		object fn;
+		std::mutex mutex;				// protects matrix. Never held while calling python (which may switch threads)
+		arma::mat matrix;				// d(i, j) for i, j < matrix.n_rows, only grows
+		std::atomic<bool> per_pair;
+
+		static const uint max_elems = 1 << 24;
+
+		~State() {
+			gil_scoped_acquire gil;		// fn might be destroyed from a thread without the GIL
+			fn = object();
+		}
+
+		// evaluates fn on the N x N grid, with the GIL held
+		bool evaluate(uint N, arma::mat& M) {
+			array_t<int64_t> I({ N, N }), J({ N, N });
+			auto i = I.mutable_unchecked<2>();
+			auto j = J.mutable_unchecked<2>();
+			for(uint x = 0; x < N; x++)
+				for(uint y = 0; y < N; y++) {
+					i(x, y) = x;
+					j(x, y) = y;
+				}
+
+			object res;
+			try {
+				res = fn(I, J);
+			} catch(error_already_set&) {
+				return false;
+			}
+			auto D = array_t<double, array::forcecast>::ensure(res);
+			if(!D || D.ndim() != 2 || D.shape(0) != ssize_t(N) || D.shape(1) != ssize_t(N))
+				return false;
+
+			M.set_size(N, N);
+			auto d = D.unchecked<2>();
+			for(uint y = 0; y < N; y++)
+				for(uint x = 0; x < N; x++)
+					M(x, y) = d(x, y);
+			return true;
+		}
+
+		// makes matrix cover index n-1 (or switches to per_pair), with the GIL held
+		void grow(uint n) {
+			uint cur;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				cur = matrix.n_rows;
+			}
+			if(cur >= n)
+				return;		// grown by another thread
+
+			uint N = std::max(n, 2 * cur);
+			arma::mat M;
+			if(size_t(n) * n > max_elems ||
+			   !((size_t(N) * N <= max_elems && evaluate(N, M)) || (N > n && evaluate(n, M)))) {
+				per_pair = true;
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if(M.n_rows > matrix.n_rows)
+				matrix = std::move(M);
+		}
+
+		double operator()(uint a, uint b) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if(!per_pair && a < matrix.n_rows && b < matrix.n_rows)
+					return matrix(a, b);
+			}
+
+			gil_scoped_acquire gil;
+			if(!per_pair)
+				grow(std::max(a, b) + 1);
+			if(per_pair)
+				return fn(a, b).template cast<double>();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			return matrix(a, b);
+		}
+	};
+
+	bool load(handle src, bool) {
+		if(src.is_none() || !PyCallable_Check(src.ptr()))
+			return false;
+
+		auto state = std::make_shared<State>();
+		state->fn = reinterpret_borrow<object>(src);
+		object flag = getattr(src, "qif_vectorize", none());
+		state->per_pair =
+			PyCFunction_Check(src.ptr()) ||			// pybind11 functions cannot take arrays
+			!MetricDefaults::vectorize ||
+			(!flag.is_none() && !bool_(flag));
+
+		value = [state](const uint& a, const uint& b) { return (*state)(a, b); };
+		return true;
+	}
+
+	static handle cast(const Metric& src, return_value_policy policy, handle) {
+		if(!src)
+			return none().release();
+		return cpp_function(src, policy).release();
+	}
+};
+
 } // pybind11:detail
\ No newline at end of file
@@ -14,9 +14,11 @@ void init_mechanism_module(py::module);
 void init_refinement_module(py::module);
 void init_utility_module(py::module);
 void init_lp_module(py::module);
+void init_trace_module(py::module);
 
 
-py::handle def_c, double_c, uint_c, rat_c, point_c;
+py::handle def_c, double_c, float_c, uint_c, rat_c, point_c;
+bool rational_arrays = false;
 
 
 PYBIND11_MODULE(_qif, m) {
@@ -25,7 +27,7 @@ PYBIND11_MODULE(_qif, m) {
 
 	// use np.random.randint to get a seed. Use int32_t instead of uint, cause numpy uses int32 for some reason on windows!
 	uint seed = np.attr("random").attr("randint")(std::numeric_limits<int32_t>::max()).cast<uint>();
-	arma::arma_rng::set_seed(seed);
+	qif::rng::set_seed(seed);
 
 	// Init mp++'s pybind11 integration
 	mppp_pybind11::init();
@@ -40,8 +42,42 @@ PYBIND11_MODULE(_qif, m) {
         .def(py::self + py::self)
         .def("__repr__", &point::to_string);
 
+	// rat matrices held in C++ (see the Mat<rat> caster)
+	py::class_<RationalArray>(m, "RationalArray")
+		.def(py::init([](py::array a) {
+			bool vector = a.ndim() == 1;
+			auto mat = vector
+				? std::make_shared<rmat>(a.cast<rrowvec>())	// conversion from Fraction objects
+				: std::make_shared<rmat>(a.cast<rmat>());
+			return RationalArray { mat, vector };
+		}), "a"_a)
+		.def_property_readonly("ndim",  [](const RationalArray& a) { return a.vector ? 1 : 2; })
+		.def_property_readonly("shape", [](const RationalArray& a) {
+			return a.vector ? py::make_tuple(a.mat->n_elem) : py::make_tuple(a.mat->n_rows, a.mat->n_cols);
+		})
+		.def("__len__",     [](const RationalArray& a) { return a.vector ? a.mat->n_elem : a.mat->n_rows; })
+		.def("__getitem__", [](const RationalArray& a, uint i) {
+			if(!a.vector) throw py::index_error("use a[i, j] for matrices");
+			if(i >= a.mat->n_elem) throw py::index_error();
+			return a.mat->at(i);
+		})
+		.def("__getitem__", [](const RationalArray& a, std::pair<uint,uint> ij) {
+			if(a.vector) throw py::index_error("use a[i] for vectors");
+			if(ij.first >= a.mat->n_rows || ij.second >= a.mat->n_cols) throw py::index_error();
+			return a.mat->at(ij.first, ij.second);
+		})
+		.def("to_numpy",    [](const RationalArray& a) {
+			return a.vector
+				? py::reinterpret_steal<py::object>(py::detail::make_caster<rrowvec>::to_objects(rrowvec(a.mat->memptr(), a.mat->n_elem, false, true)))
+				: py::reinterpret_steal<py::object>(py::detail::make_caster<rmat>::to_objects(*a.mat));
+		})
+		.def("__repr__",    [](py::object a) { return "RationalArray(" + py::repr(a.attr("to_numpy")()).cast<std::string>() + ")"; });
+
+	m.def("set_rational_arrays", [](bool enable) { rational_arrays = enable; }, "enable"_a);
+
 	// global class references
 	double_c = np.attr("float64");
+	float_c  = np.attr("float32");
 	uint_c   = np.attr("uint32");
 	rat_c    = py::module::import("fractions").attr("Fraction");
 	point_c  = m.attr("point");
@@ -49,6 +85,9 @@ PYBIND11_MODULE(_qif, m) {
 
 	m.def("set_default_type", [](py::object t) { def_c = t; });
 
+	m.def("set_num_threads", &set_num_threads, "n"_a);
+	m.def("get_num_threads", &get_num_threads);
+
 	// initialize modules
 	init_channel_module   (m.def_submodule("channel",   ""));
 	init_probab_module    (m.def_submodule("probab",    ""));
@@ -58,6 +97,7 @@ PYBIND11_MODULE(_qif, m) {
 	init_refinement_module(m.def_submodule("refinement",""));
 	init_utility_module   (m.def_submodule("utility",   ""));
 	init_lp_module        (m.def_submodule("lp",        ""));
+	init_trace_module     (m.def_submodule("trace",     ""));
 
 #ifdef QIF_VERSION
     m.attr("__version__") = QIF_VERSION;
@@ -13,6 +13,7 @@ Quantitative Information Flow library.
 	refinement
 	utility
 	lp
+	trace
 
 |
 """
@@ -30,11 +31,14 @@ except:
 # these, and import their contents in the corresponding __init__.py.
 #
 from . import channel, metric, measure, mechanism			# packages
-from ._qif import probab, refinement, utility, lp			# modules
+from ._qif import probab, refinement, utility, lp, trace	# modules
 from ._qif import __version__, point, set_default_type		# other stuff
+from ._qif import set_num_threads, get_num_threads
+from ._qif import RationalArray, set_rational_arrays
 
 # data type aliases
 from numpy import float64 as double
+from numpy import float32 as single
 from fractions import Fraction as rat
 from numpy import uint32 as uint
 
@@ -10,6 +10,7 @@ Submodules
 - refinement
 - utility
 - lp
+- trace
 """
 from . import typing as t
 # from __future__ import annotations
@@ -26,7 +27,8 @@ from . import ( # modules
     probab as probab,
     refinement as refinement,
     utility as utility,
-    lp as lp
+    lp as lp,
+    trace as trace
 )
 
 from numpy import float64 as double
@@ -52,6 +54,27 @@ class point:
     @staticmethod
     def from_polar(angle: float, radius: float) -> point: ...
 
+class RationalArray:
+    """A matrix or vector of rats held in C++, passed to qif functions without conversion to Fraction objects."""
+    def __init__(self, a: t.ndarray) -> None: ...
+    def __len__(self) -> int: ...
+    @t.overload
+    def __getitem__(self, i: int) -> t.rat: ...
+    @t.overload
+    def __getitem__(self, ij: t.Tuple[int, int]) -> t.rat: ...
+    def to_numpy(self) -> t.ndarray: ...
+
+    @property
+    def ndim(self) -> int: ...
+    @property
+    def shape(self) -> t.Tuple[int, ...]: ...
+
+def get_num_threads() -> int: ...
+
 def set_default_type(type: t.TypeLike) -> None: ...
 
+def set_num_threads(n: int) -> None: ...
+
+def set_rational_arrays(enable: bool) -> None: ...
+
 __version__: str
\ No newline at end of file
@@ -37,32 +37,65 @@ void init_channel_module(py::module m) {
 	m.def("posterior",      channel::posterior<double>, "C"_a, "pi"_a, "col"_a);
 	m.def("posterior",      channel::posterior<rat>,    "C"_a, "pi"_a, "col"_a);
 
-	m.def("posteriors",     channel::posteriors<double>, "C"_a, "pi"_a = prob());
-	m.def("posteriors",     channel::posteriors<rat>,    "C"_a, "pi"_a /* = rprob() */);	// this causes a weird "vector out of range" error on windows.
-
-	m.def("hyper",     		channel::hyper<double>, "C"_a, "pi"_a);
-	m.def("hyper",     		channel::hyper<rat>,    "C"_a, "pi"_a);
-
-	m.def("reduced",   		channel::reduced<double>, "C"_a);
-	m.def("reduced",   		channel::reduced<rat>,    "C"_a);
-
-	m.def("iterative_bayesian_update", channel::iterative_bayesian_update<double>, "C"_a, "out"_a, "start"_a = prob(),        "max_diff"_a = 1e-6, "max_iter"_a = 0);
-	m.def("iterative_bayesian_update", channel::iterative_bayesian_update<rat>,    "C"_a, "out"_a, "start"_a /* = rprob() */, "max_diff"_a = 1e-6, "max_iter"_a = 0);
-
-	// TODO: add "method" to factorize
-	m.def("factorize",   	channel::factorize<double>, "A"_a, "B"_a, "col_stoch"_a = false);
-	m.def("factorize",   	channel::factorize<rat>,    "A"_a, "B"_a, "col_stoch"_a = false);
-
-	m.def("left_factorize", channel::left_factorize<double>, "A"_a, "B"_a, "col_stoch"_a = false);
-	m.def("left_factorize", channel::left_factorize<rat>,    "A"_a, "B"_a, "col_stoch"_a = false);
+	m.def("posteriors",     overload<const spchan&,const  prob&>(channel::posteriors<double>), "C"_a, "pi"_a = prob(), nogil());	// scipy.sparse, result csc_matrix
+	m.def("posteriors",     overload<const channel::MappedChan<double>&,const  prob&>(channel::posteriors<double>), "C"_a, "pi"_a = prob(), nogil());	// memory-mapped C-ordered, without copy
+	m.def("posteriors",     overload<const  chan&,const  prob&>(channel::posteriors<double>), "C"_a, "pi"_a = prob(), nogil());
+	m.def("posteriors",     overload<const rchan&,const rprob&>(channel::posteriors<rat>),    "C"_a, "pi"_a /* = rprob() */);	// this causes a weird "vector out of range" error on windows.
+
+	m.def("hyper",     		overload<const spchan&,const  prob&>(channel::hyper<double>), "C"_a, "pi"_a, nogil());	// scipy.sparse, inners as csc_matrix
+	m.def("hyper",     		overload<const  chan&,const  prob&>(channel::hyper<double>), "C"_a, "pi"_a, nogil());
+	m.def("hyper",     		overload<const rchan&,const rprob&>(channel::hyper<rat>),    "C"_a, "pi"_a, nogil());
+
+	m.def("hyper_compact",	[](const  chan& C, const  prob& pi, double quantum) { auto h = channel::hyper_compact(C, pi, quantum); return std::make_pair(h.outer, h.inners); }, "C"_a, "pi"_a, "quantum"_a = 1e-6, nogil());
+	m.def("hyper_compact",	[](const rchan& C, const rprob& pi, double quantum) { auto h = channel::hyper_compact(C, pi, quantum); return std::make_pair(h.outer, h.inners); }, "C"_a, "pi"_a, "quantum"_a = 1e-6, nogil());
+
+	m.def("reduced",   		channel::reduced<double>, "C"_a, "quantum"_a = 1e-6, nogil());
+	m.def("reduced",   		channel::reduced<rat>,    "C"_a, "quantum"_a = 1e-6, nogil());
+
+	// (coarsened channel, cluster of each output, error, max_radius, bound on the decrease of V_G), G empty for the
+	// Bayes vulnerability
+	m.def("coarsen",		[](const  chan& C, const  prob& pi, uint n_cols, const std::string& method, uint max_iter, uint64_t seed, const  chan& G) {
+		auto r = channel::coarsen(C, pi, n_cols, method, max_iter, seed);
+		return std::make_tuple(r.C, arma::conv_to<arma::Col<uint>>::from(r.cluster), r.error, r.max_radius, G.is_empty() ? r.error : r.g_vuln_bound(G));
+	}, "C"_a, "pi"_a, "n_cols"_a, "method"_a = "kmeans", "max_iter"_a = 100, "seed"_a = 0, "G"_a = chan(), nogil());
+	m.def("coarsen",		[](const rchan& C, const rprob& pi, uint n_cols, const std::string& method, uint max_iter, uint64_t seed, const rchan& G) {
+		auto r = channel::coarsen(C, pi, n_cols, method, max_iter, seed);
+		return std::make_tuple(r.C, arma::conv_to<arma::Col<uint>>::from(r.cluster), r.error, r.max_radius, G.is_empty() ? r.error : r.g_vuln_bound(G));
+	}, "C"_a, "pi"_a, "n_cols"_a, "method"_a = "kmeans", "max_iter"_a = 100, "seed"_a = 0, "G"_a = rchan(), nogil());
+
+	// checkpoint: file saving the estimate every checkpoint_every steps, resumed from if it exists (see checkpoint.h)
+	m.def("iterative_bayesian_update", [](const  chan& C, const  prob& out, const  prob& start, double max_diff, uint max_iter, const std::string& method, const std::string& file, uint every) {
+		typedef channel::IbuState<double> State;
+		return channel::iterative_bayesian_update<double>(C, out, start, max_diff, max_iter, method, file.empty() ? checkpoint::Hook<State>() : checkpoint::file<State>(file, every));
+	}, "C"_a, "out"_a, "start"_a = prob(),        "max_diff"_a = 1e-6, "max_iter"_a = 0, "method"_a = "em", "checkpoint"_a = "", "checkpoint_every"_a = 100, nogil());
+	m.def("iterative_bayesian_update", [](const rchan& C, const rprob& out, const rprob& start, rat max_diff, uint max_iter, const std::string& method, const std::string& file, uint every) {
+		typedef channel::IbuState<rat> State;
+		return channel::iterative_bayesian_update<rat>(C, out, start, max_diff, max_iter, method, file.empty() ? checkpoint::Hook<State>() : checkpoint::file<State>(file, every));
+	}, "C"_a, "out"_a, "start"_a /* = rprob() */, "max_diff"_a = 1e-6, "max_iter"_a = 0, "method"_a = "em", "checkpoint"_a = "", "checkpoint_every"_a = 100, nogil());
+
+	m.def("factorize",   	channel::factorize<double>, "A"_a, "B"_a, "col_stoch"_a = false, "method"_a = "auto", nogil());
+	m.def("factorize",   	channel::factorize<rat>,    "A"_a, "B"_a, "col_stoch"_a = false, "method"_a = "auto", nogil());
+
+	m.def("left_factorize", channel::left_factorize<double>, "A"_a, "B"_a, "col_stoch"_a = false, "method"_a = "auto", nogil());
+	m.def("left_factorize", channel::left_factorize<rat>,    "A"_a, "B"_a, "col_stoch"_a = false, "method"_a = "auto", nogil());
 
 	m.def("sum_column_min", channel::sum_column_min<double>, "C"_a);
 	m.def("sum_column_min", channel::sum_column_min<rat>,    "C"_a);
 
-	m.def("sample",     		overload<const  chan&, const  prob&>(channel::sample<double>), "C"_a, "pi"_a);
-	m.def("sample",     		overload<const rchan&, const rprob&>(channel::sample<rat>),    "C"_a, "pi"_a);
+	m.def("sample",     		overload<const  chan&, const  prob&>(channel::sample<double>), "C"_a, "pi"_a, nogil());
+	m.def("sample",     		overload<const rchan&, const rprob&>(channel::sample<rat>),    "C"_a, "pi"_a, nogil());
+
+	m.def("sample",     		overload<const  chan&, const  prob&, uint>(channel::sample<double>), "C"_a, "pi"_a, "n_samples"_a, nogil());
+	m.def("sample",     		overload<const rchan&, const rprob&, uint>(channel::sample<rat>),    "C"_a, "pi"_a, "n_samples"_a, nogil());
+
+	// binary serialisation (see qif::binary), rat files are loaded exactly, float files as double
+	m.def("save",			[](const std::string& f, const  chan& C) { binary::save(f, C); }, "filename"_a, "C"_a);
+	m.def("save",			[](const std::string& f, const rchan& C) { binary::save(f, C); }, "filename"_a, "C"_a);
 
-	m.def("sample",     		overload<const  chan&, const  prob&, uint>(channel::sample<double>), "C"_a, "pi"_a, "n_samples"_a);
-	m.def("sample",     		overload<const rchan&, const rprob&, uint>(channel::sample<rat>),    "C"_a, "pi"_a, "n_samples"_a);
+	m.def("load",			[](const std::string& f) -> py::object {
+		return binary::elem_type(f) == binary::aux::elem_code<rat>()
+			? py::cast(binary::load<rat>(f))
+			: py::cast(binary::load<double>(f));
+	}, "filename"_a);
 
 }
\ No newline at end of file
@@ -9,19 +9,28 @@ from . import compose as compose
 
 def assert_proper(C: t.ndarray) -> None: ...
 
+def coarsen(C: t.ndarray, pi: t.ndarray, n_cols: int, method: str = 'kmeans', max_iter: int = 100, seed: int = 0, G: t.ndarray = ...) -> t.Tuple[t.ndarray, t.ndarray, t.FloatOrRat, t.FloatOrRat, t.FloatOrRat]: ...
+
 def deterministic(map: t.Callable[[int], int], n_rows: int, n_cols: int, type: t.TypeLike = t.def_type) -> t.ndarray: ...
 
-def factorize(A: t.ndarray, B: t.ndarray, col_stoch: bool = False) -> t.ndarray: ...
+def factorize(A: t.ndarray, B: t.ndarray, col_stoch: bool = False, method: str = "auto") -> t.ndarray: ...
 
+@t.overload
 def hyper(C: t.ndarray, pi: t.ndarray) -> t.Tuple[t.ndarray, t.ndarray]: ...
+@t.overload
+def hyper(C: t.SparseMatrix, pi: t.ndarray) -> t.Tuple[t.ndarray, t.SparseMatrix]: ...
+
+def hyper_compact(C: t.ndarray, pi: t.ndarray, quantum: float = 1e-06) -> t.Tuple[t.ndarray, t.ndarray]: ...
 
 def identity(n_rows: int, type: t.TypeLike = t.def_type) -> t.ndarray: ...
 
 def is_proper(C: t.ndarray, mrd: t.FloatOrRat = 2.220446049250313e-14) -> bool: ...
 
-def iterative_bayesian_update(C: t.ndarray, out: t.ndarray, start: t.ndarray = t.array([]), max_diff: t.FloatOrRat = 1e-06, max_iter: int = 0) -> t.Tuple[t.ndarray, int]: ...
+def iterative_bayesian_update(C: t.ndarray, out: t.ndarray, start: t.ndarray = t.array([]), max_diff: t.FloatOrRat = 1e-06, max_iter: int = 0, method: str = 'em', checkpoint: str = '', checkpoint_every: int = 100) -> t.Tuple[t.ndarray, int]: ...
 
-def left_factorize(A: t.ndarray, B: t.ndarray, col_stoch: bool = False) -> t.ndarray: ...
+def left_factorize(A: t.ndarray, B: t.ndarray, col_stoch: bool = False, method: str = "auto") -> t.ndarray: ...
+
+def load(filename: str) -> t.ndarray: ...
 
 def no_interference(n_rows: int, n_cols: int = 1, type: t.TypeLike = t.def_type) -> t.ndarray: ...
 
@@ -29,11 +38,16 @@ def normalize(C: t.ndarray) -> t.ndarray: ...
 
 def posterior(C: t.ndarray, pi: t.ndarray, col: int) -> t.ndarray: ...
 
+@t.overload
 def posteriors(C: t.ndarray, pi: t.ndarray = t.array([])) -> t.ndarray: ...
+@t.overload
+def posteriors(C: t.SparseMatrix, pi: t.ndarray = t.array([])) -> t.SparseMatrix: ...
 
 def randu(n_rows: int, n_cols: int = 0, type: t.TypeLike = t.def_type) -> t.ndarray: ...
 
-def reduced(C: t.ndarray) -> t.ndarray: ...
+def reduced(C: t.ndarray, quantum: float = 1e-06) -> t.ndarray: ...
+
+def save(filename: str, C: t.ndarray) -> None: ...
 
 @t.overload
 def sample(C: t.ndarray, pi: t.ndarray) -> t.Tuple[int, int]: ...
@@ -13,10 +13,18 @@ void init_channel_compose_module(py::module m) {
 		Channel composition.
 	)pbdoc";
 
-	m.def("parallel", 				parallel<double>, "A"_a, "B"_a);
-	m.def("parallel",		 		parallel<rat>,    "A"_a, "B"_a);
+	m.def("cascade", 				overload<const chan&, const chan&>(cascade<double>), "A"_a, "B"_a, nogil());
+	m.def("cascade", 				overload<const rchan&, const rchan&>(cascade<rat>), "A"_a, "B"_a, nogil());
+	m.def("cascade", 				overload<const std::vector<chan>&>(cascade<double>), "Cs"_a, nogil());
+	m.def("cascade", 				overload<const std::vector<rchan>&>(cascade<rat>), "Cs"_a, nogil());
 
-	m.def("repeated_independent", 	repeated_independent<double>, "C"_a, "n"_a);
-	m.def("repeated_independent", 	repeated_independent<rat>,    "C"_a, "n"_a);
+	m.def("parallel", 				parallel<double>, "A"_a, "B"_a, nogil());
+	m.def("parallel",		 		parallel<rat>,    "A"_a, "B"_a, nogil());
+
+	m.def("repeated_independent", 	repeated_independent<double>, "C"_a, "n"_a, nogil());
+	m.def("repeated_independent", 	repeated_independent<rat>,    "C"_a, "n"_a, nogil());
+
+	m.def("repeated_independent_types", repeated_independent_types<double>, "C"_a, "n"_a, nogil());
+	m.def("repeated_independent_types", repeated_independent_types<rat>,    "C"_a, "n"_a, nogil());
 
 }
\ No newline at end of file
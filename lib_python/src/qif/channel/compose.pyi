@@ -3,6 +3,13 @@ Channel composition.
 """
 from .. import typing as t
 
+@t.overload
+def cascade(A: t.ndarray, B: t.ndarray) -> t.ndarray: ...
+@t.overload
+def cascade(Cs: t.List[t.ndarray]) -> t.ndarray: ...
+
 def parallel(A: t.ndarray, B: t.ndarray) -> t.ndarray: ...
 
 def repeated_independent(C: t.ndarray, n: int) -> t.ndarray: ...
+
+def repeated_independent_types(C: t.ndarray, n: int) -> t.ndarray: ...
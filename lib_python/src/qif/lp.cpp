@@ -14,9 +14,84 @@ void init_lp_module(py::module m) {
 
 	// Types
     py::class_<lp::Defaults>(m, "defaults")
+		.def_readwrite_static("instrument",    &lp::Defaults::instrument)
+		.def_readwrite_static("instrument_qp", &qp::Defaults::instrument)
 		.def_readwrite_static("presolve",  &lp::Defaults::presolve)
 		.def_readwrite_static("msg_level", &lp::Defaults::msg_level)
 		.def_readwrite_static("method",    &lp::Defaults::method)
-		.def_readwrite_static("solver",    &lp::Defaults::solver);
+		.def_readwrite_static("solver",    &lp::Defaults::solver)
+		.def_readwrite_static("pricing",   &lp::Defaults::pricing)
+		.def_readwrite_static("external_command", &lp::Defaults::external_command)
+		.def_readwrite_static("external_format", &lp::Defaults::external_format)
+		.def_readwrite_static("portfolio", &lp::Defaults::portfolio);
+
+	py::class_<lp::MemoryEstimate>(m, "memory_estimate")
+		.def_readonly("build",        &lp::MemoryEstimate::build)
+		.def_readonly("canonicalize", &lp::MemoryEstimate::canonicalize)
+		.def_readonly("setup",        &lp::MemoryEstimate::setup)
+		.def("peak", &lp::MemoryEstimate::peak);
+
+	py::class_<lp::Stats>(m, "stats")
+		.def_readonly("solver",       &lp::Stats::solver)
+		.def_readonly("portfolio_winner", &lp::Stats::portfolio_winner)
+		.def_readonly("status",       &lp::Stats::status)
+		.def_readonly("n_var",        &lp::Stats::n_var)
+		.def_readonly("n_con",        &lp::Stats::n_con)
+		.def_readonly("nnz",          &lp::Stats::nnz)
+		.def_readonly("iterations",   &lp::Stats::iterations)
+		.def_readonly("build",        &lp::Stats::build)
+		.def_readonly("canonicalize", &lp::Stats::canonicalize)
+		.def_readonly("setup",        &lp::Stats::setup)
+		.def_readonly("solve",        &lp::Stats::solve)
+		.def_readonly("extract",      &lp::Stats::extract)
+		.def_readonly("memory",       &lp::Stats::memory)
+		.def("total", &lp::Stats::total);
+
+	// A double program built from matrices: A can be a scipy.sparse matrix (see the SpMat caster) or a dense array.
+	// sense has one of '<', '>', '=' per constraint (empty: all '<').
+	typedef lp::LinearProgram<double> LP;
+	auto to_sense = [](const std::string& sense) { return Col<char>(std::vector<char>(sense.begin(), sense.end())); };
+
+	py::class_<LP>(m, "linear_program")
+		.def(py::init<>())
+		.def_readwrite("maximize",  &LP::maximize)
+		.def_readwrite("method",    &LP::method)
+		.def_readwrite("solver",    &LP::solver)
+		.def_readwrite("presolve",  &LP::presolve)
+		.def_readwrite("msg_level", &LP::msg_level)
+		.def_readwrite("external_command", &LP::external_command)
+		.def_readwrite("external_format", &LP::external_format)
+		.def_readwrite("sensitivity", &LP::sensitivity)
+		.def_readwrite("portfolio", &LP::portfolio)
+		.def_readwrite("family",    &LP::family)
+		.def_readonly("status",     &LP::status)
+		.def_readonly("portfolio_winner", &LP::portfolio_winner)
+		.def("from_matrix", [to_sense](LP& lp, const spchan& A, const arma::vec& b, const arma::vec& c, const std::string& sense, bool non_negative) {
+			lp.from_matrix(A, b, c, to_sense(sense), non_negative);
+		}, "A"_a, "b"_a, "c"_a, "sense"_a = "", "non_negative"_a = true)
+		.def("from_matrix", [to_sense](LP& lp, const chan& A, const arma::vec& b, const arma::vec& c, const std::string& sense, bool non_negative) {
+			lp.from_matrix(spchan(A), b, c, to_sense(sense), non_negative);
+		}, "A"_a, "b"_a, "c"_a, "sense"_a = "", "non_negative"_a = true)
+		.def("solve",        &LP::solve, nogil())
+		.def("objective",    &LP::objective)
+		.def("solution",     overload<>(&LP::solution))
+		.def("has_solution", &LP::has_solution)
+		.def("duals",        &LP::duals)
+		.def("reduced_costs", &LP::reduced_costs)
+		.def("has_duals",    &LP::has_duals)
+		.def("write_mps",    overload<const std::string&>(&LP::write_mps), "filename"_a, nogil())
+		.def("write_lp",     overload<const std::string&>(&LP::write_lp),  "filename"_a, nogil())
+		.def("read_mps",     overload<const std::string&>(&LP::read_mps),  "filename"_a, nogil())
+		.def("to_mps",       &LP::to_mps);
+
+	// Methods
+	m.def("last_stats",    &lp::last_stats);
+	m.def("last_qp_stats", &qp::last_stats);
+	m.def("portfolio_wins", &lp::portfolio_wins, "family"_a, "rational"_a = false);
+	m.def("portfolio_best", &lp::portfolio_best, "family"_a, "rational"_a = false);
+	m.def("clear_portfolio_wins", &lp::clear_portfolio_wins);
+	m.def("estimate_memory", [](uint n_var, uint n_con, uint64_t nnz, bool rational) {
+		return rational ? lp::LinearProgram<rat>().estimate_memory(n_var, n_con, nnz) : lp::LinearProgram<double>().estimate_memory(n_var, n_con, nnz);
+	}, "n_var"_a, "n_con"_a, "nnz"_a, "rational"_a = false);
 
 }
\ No newline at end of file
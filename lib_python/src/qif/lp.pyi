@@ -2,9 +2,85 @@
 Linear solver.
 """
 
+from . import typing as t
+
 class defaults():
+    instrument = False
+    instrument_qp = False
     method = 'AUTO'
     msg_level = 'OFF'
     presolve = True
+    pricing = 'AUTO'
     solver = 'AUTO'
+    external_command = ''
+    external_format = 'AUTO'
+    portfolio: t.List[str] = []
+
+
+class memory_estimate():
+    build: int
+    canonicalize: int
+    setup: int
+
+    def peak(self) -> int: ...
+
+
+class stats():
+    solver: str
+    portfolio_winner: str
+    status: str
+    n_var: int
+    n_con: int
+    nnz: int
+    iterations: int
+    build: float
+    canonicalize: float
+    setup: float
+    solve: float
+    extract: float
+    memory: memory_estimate
+
+    def total(self) -> float: ...
+
+class linear_program():
+    maximize: bool
+    method: str
+    solver: str
+    presolve: bool
+    msg_level: str
+    external_command: str
+    external_format: str
+    sensitivity: bool
+    portfolio: t.List[str]
+    family: str
+    status: str
+    portfolio_winner: str
+
+    @t.overload
+    def from_matrix(self, A: t.SparseMatrix, b: t.ndarray, c: t.ndarray, sense: str = '', non_negative: bool = True) -> None: ...
+    @t.overload
+    def from_matrix(self, A: t.ndarray, b: t.ndarray, c: t.ndarray, sense: str = '', non_negative: bool = True) -> None: ...
+    def solve(self) -> bool: ...
+    def objective(self) -> float: ...
+    def solution(self) -> t.ndarray: ...
+    def has_solution(self) -> bool: ...
+    def duals(self) -> t.ndarray: ...
+    def reduced_costs(self) -> t.ndarray: ...
+    def has_duals(self) -> bool: ...
+    def write_mps(self, filename: str) -> None: ...
+    def write_lp(self, filename: str) -> None: ...
+    def read_mps(self, filename: str) -> None: ...
+    def to_mps(self) -> str: ...
+
+
+def last_qp_stats() -> stats: ...
+
+def last_stats() -> stats: ...
+
+def portfolio_wins(family: str, rational: bool = False) -> t.Dict[str, int]: ...
+
+def portfolio_best(family: str, rational: bool = False) -> str: ...
+
+def clear_portfolio_wins() -> None: ...
 
+def estimate_memory(n_var: int, n_con: int, nnz: int, rational: bool = False) -> memory_estimate: ...
@@ -15,22 +15,44 @@ void init_bayes_vuln_module(py::module m) {
 
 	m.def("prior",      			bayes_vuln::prior<double>, "pi"_a);
 	m.def("prior",      			bayes_vuln::prior<rat>,    "pi"_a);
+	m.def("prior",      			bayes_vuln::prior<float>,  "pi"_a);
 
-	m.def("posterior",     			bayes_vuln::posterior<double>, "pi"_a, "C"_a);
-	m.def("posterior",     			bayes_vuln::posterior<rat>,    "pi"_a, "C"_a);
+	// scipy.sparse channels
+	m.def("posterior",     			overload<const  prob&,const spchan&>(bayes_vuln::posterior<double>), "pi"_a, "C"_a, nogil());
+	// memory-mapped C-ordered channels, without copy (see the MappedChan caster)
+	m.def("posterior",     			overload<const  prob&,const channel::MappedChan<double>&>(bayes_vuln::posterior<double>), "pi"_a, "C"_a, nogil());
+	m.def("posterior",     			overload<const  prob&,const  chan&>(bayes_vuln::posterior<double>), "pi"_a, "C"_a, nogil());
+	m.def("posterior",     			overload<const rprob&,const rchan&>(bayes_vuln::posterior<rat>),    "pi"_a, "C"_a, nogil());
+	m.def("posterior",     			overload<const fprob&,const fchan&>(bayes_vuln::posterior<float>),  "pi"_a, "C"_a, nogil());	// float32, summed in double
+	m.def("posterior",     			overload<const  chan&,const  chan&>(bayes_vuln::posterior<double>), "pis"_a, "C"_a, nogil());
+	m.def("posterior",     			overload<const rchan&,const rchan&>(bayes_vuln::posterior<rat>),    "pis"_a, "C"_a, nogil());
 
-	m.def("add_leakage",   			bayes_vuln::add_leakage<double>, "pi"_a, "C"_a);
-	m.def("add_leakage",   			bayes_vuln::add_leakage<rat>,    "pi"_a, "C"_a);
+	m.def("add_leakage",   			overload<const prob&,const chan&>(bayes_vuln::add_leakage<double>), "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",   			overload<const rprob&,const rchan&>(bayes_vuln::add_leakage<rat>),    "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",   			overload<const fprob&,const fchan&>(bayes_vuln::add_leakage<float>),  "pi"_a, "C"_a, nogil());
 
-	m.def("mult_leakage",  			bayes_vuln::mult_leakage<double>, "pi"_a, "C"_a);
-	m.def("mult_leakage",  			bayes_vuln::mult_leakage<rat>,    "pi"_a, "C"_a);
+	m.def("mult_leakage",  			overload<const prob&,const chan&>(bayes_vuln::mult_leakage<double>), "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",  			overload<const rprob&,const rchan&>(bayes_vuln::mult_leakage<rat>),    "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",  			overload<const fprob&,const fchan&>(bayes_vuln::mult_leakage<float>),  "pi"_a, "C"_a, nogil());
 
-	m.def("min_entropy_leakage",	bayes_vuln::min_entropy_leakage<double>, "pi"_a, "C"_a);
+	m.def("min_entropy_leakage",	bayes_vuln::min_entropy_leakage<double>, "pi"_a, "C"_a, nogil());
 
-	m.def("mult_capacity",  		bayes_vuln::mult_capacity<double>, "C"_a);
-	m.def("mult_capacity",  		bayes_vuln::mult_capacity<rat>,    "C"_a);
+	m.def("mult_capacity",  		bayes_vuln::mult_capacity<double>, "C"_a, nogil());
+	m.def("mult_capacity",  		bayes_vuln::mult_capacity<rat>,    "C"_a, nogil());
 
-	m.def("strategy",  				bayes_vuln::strategy<double>, "pi"_a, "C"_a);
-	m.def("strategy",  				bayes_vuln::strategy<rat>,    "pi"_a, "C"_a);
+	m.def("strategy",  				bayes_vuln::strategy<double>, "pi"_a, "C"_a, nogil());
+	m.def("strategy",  				bayes_vuln::strategy<rat>,    "pi"_a, "C"_a, nogil());
+
+
+	// batched versions: lists of priors and channels (a list of size 1 is used with every element of the other),
+	// computed in parallel
+	m.def("posterior_many",			[](const std::vector< prob>& pis, const std::vector< chan>& Cs) { return map_many(overload<const  prob&,const  chan&>(bayes_vuln::posterior<double>), pis, Cs); }, "pis"_a, "Cs"_a);
+	m.def("posterior_many",			[](const std::vector<rprob>& pis, const std::vector<rchan>& Cs) { return map_many(overload<const rprob&,const rchan&>(bayes_vuln::posterior<rat>),    pis, Cs); }, "pis"_a, "Cs"_a);
+
+	m.def("add_leakage_many",		[](const std::vector< prob>& pis, const std::vector< chan>& Cs) { return map_many(overload<const prob&,const chan&>(bayes_vuln::add_leakage<double>), pis, Cs); }, "pis"_a, "Cs"_a);
+	m.def("add_leakage_many",		[](const std::vector<rprob>& pis, const std::vector<rchan>& Cs) { return map_many(overload<const rprob&,const rchan&>(bayes_vuln::add_leakage<rat>),    pis, Cs); }, "pis"_a, "Cs"_a);
+
+	m.def("mult_leakage_many",		[](const std::vector< prob>& pis, const std::vector< chan>& Cs) { return map_many(overload<const prob&,const chan&>(bayes_vuln::mult_leakage<double>), pis, Cs); }, "pis"_a, "Cs"_a);
+	m.def("mult_leakage_many",		[](const std::vector<rprob>& pis, const std::vector<rchan>& Cs) { return map_many(overload<const rprob&,const rchan&>(bayes_vuln::mult_leakage<rat>),    pis, Cs); }, "pis"_a, "Cs"_a);
 
 }
\ No newline at end of file
@@ -5,13 +5,22 @@ from .. import typing as t
 
 def add_leakage(pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 
+def add_leakage_many(pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[t.FloatOrRat]: ...
+
 def min_entropy_leakage(pi: t.ndarray, C: t.ndarray) -> float: ...
 
 def mult_capacity(C: t.ndarray) -> t.FloatOrRat: ...
 
 def mult_leakage(pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 
-def posterior(pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
+def mult_leakage_many(pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[t.FloatOrRat]: ...
+
+@t.overload
+def posterior(pi: t.ndarray, C: t.ChanLike) -> t.FloatOrRat: ...
+@t.overload
+def posterior(pis: t.ndarray, C: t.ndarray) -> t.ndarray: ...
+
+def posterior_many(pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[t.FloatOrRat]: ...
 
 def prior(pi: t.ndarray) -> t.FloatOrRat: ...
 
@@ -13,10 +13,15 @@ void init_d_privacy_module(py::module m) {
 		:math:`d`-privacy.
 	)pbdoc";
 
-	m.def("prior",      		d_privacy::prior<double>, "pi"_a, "d"_a);
+	m.def("prior",      		d_privacy::prior<double>, "pi"_a, "d"_a, "d_chain"_a = metric::never_chainable<uint>, nogil());
 
-	m.def("is_private",  	 	d_privacy::is_private<double>, "C"_a, "d"_a);
+	m.def("prior_line",    		overload<const prob&,const prob&>(d_privacy::prior_line<double>), "pi"_a, "pos"_a);
+	m.def("prior_line",    		overload<const prob&,double>(d_privacy::prior_line<double>), "pi"_a, "step"_a = 1.0);
 
-	m.def("smallest_epsilon",	d_privacy::smallest_epsilon<double>, "C"_a, "d"_a);
+	m.def("prior_grid",    		d_privacy::prior_grid<double>, "pi"_a, "width"_a, "step"_a = 1.0);
+
+	m.def("is_private",  	 	d_privacy::is_private<double>, "C"_a, "d"_a, "d_chain"_a = metric::never_chainable<uint>, nogil());
+
+	m.def("smallest_epsilon",	d_privacy::smallest_epsilon<double>, "C"_a, "d"_a, "d_chain"_a = metric::never_chainable<uint>, nogil());
 
 }
\ No newline at end of file
@@ -3,9 +3,16 @@
 """
 from .. import typing as t
 
-def is_private(C: t.ndarray, d: t.Metric[int,float]) -> bool: ...
+def is_private(C: t.ndarray, d: t.Metric[int,float], d_chain: t.Metric[int,bool] = ...) -> bool: ...
 
-def prior(pi: t.ndarray, d: t.Metric[int,float]) -> float: ...
+def prior(pi: t.ndarray, d: t.Metric[int,float], d_chain: t.Metric[int,bool] = ...) -> float: ...
 
-def smallest_epsilon(C: t.ndarray, d: t.Metric[int,float]) -> float: ...
+def prior_grid(pi: t.ndarray, width: int, step: float = 1.0) -> float: ...
+
+@t.overload
+def prior_line(pi: t.ndarray, pos: t.ndarray) -> float: ...
+@t.overload
+def prior_line(pi: t.ndarray, step: float = 1.0) -> float: ...
+
+def smallest_epsilon(C: t.ndarray, d: t.Metric[int,float], d_chain: t.Metric[int,bool] = ...) -> float: ...
 
@@ -18,28 +18,38 @@ void init_g_vuln_module(py::module m) {
 	m.def("prior",				overload<const rchan&,              const rprob&>(g_vuln::prior<rat>   ), "G"_a, "pi"_a);
 	m.def("prior",				overload<const Metric<rat,uint>&,   const rprob&>(g_vuln::prior<rat>   ), "G"_a, "pi"_a);
 
-	m.def("posterior",			overload<const  chan&,              const  prob&,const  chan&>(g_vuln::posterior<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("posterior",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::posterior<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("posterior",			overload<const rchan&,              const rprob&,const rchan&>(g_vuln::posterior<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("posterior",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::posterior<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("add_leakage",		overload<const  chan&,              const  prob&,const  chan&>(g_vuln::add_leakage<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("add_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::add_leakage<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("add_leakage",		overload<const rchan&,              const rprob&,const rchan&>(g_vuln::add_leakage<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("add_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::add_leakage<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("mult_leakage",		overload<const  chan&,              const  prob&,const  chan&>(g_vuln::mult_leakage<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("mult_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::mult_leakage<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("mult_leakage",		overload<const rchan&,              const rprob&,const rchan&>(g_vuln::mult_leakage<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("mult_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::mult_leakage<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("strategy",			overload<const  chan&,              const  prob&,const  chan&>(g_vuln::strategy<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("strategy",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::strategy<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("strategy",			overload<const rchan&,              const rprob&,const rchan&>(g_vuln::strategy<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("strategy",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::strategy<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("add_capacity",		g_vuln::add_capacity<double>, "pi"_a, "C"_a, "one_spanning_g"_a = false);
-	m.def("add_capacity",		g_vuln::add_capacity<rat>,    "pi"_a, "C"_a, "one_spanning_g"_a = false);
+	// memory-mapped C-ordered channels, without copy (see the MappedChan caster)
+	m.def("posterior",			overload<const  chan&,              const  prob&,const spchan&>(g_vuln::posterior<double>), "G"_a, "pi"_a, "C"_a, nogil());	// scipy.sparse
+	m.def("posterior",			overload<const Metric<double,uint>&,const  prob&,const spchan&>(g_vuln::posterior<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const  chan&,              const  prob&,const channel::MappedChan<double>&>(g_vuln::posterior<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<double,uint>&,const  prob&,const channel::MappedChan<double>&>(g_vuln::posterior<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const  chan&,              const  prob&,const  chan&>(g_vuln::posterior<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::posterior<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const rchan&,              const rprob&,const rchan&>(g_vuln::posterior<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::posterior<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const fchan&,              const fprob&,const fchan&>(g_vuln::posterior<float> ), "G"_a, "pi"_a, "C"_a, nogil());	// float32, summed in double
+	m.def("posterior",			overload<const  chan&,              const  chan&,const  chan&>(g_vuln::posterior<double>), "G"_a, "pis"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<double,uint>&,const  chan&,const  chan&>(g_vuln::posterior<double>), "g"_a, "pis"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const rchan&,              const rchan&,const rchan&>(g_vuln::posterior<rat>   ), "G"_a, "pis"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<rat,uint>&,   const rchan&,const rchan&>(g_vuln::posterior<rat>   ), "g"_a, "pis"_a, "C"_a, nogil());
+
+	m.def("add_leakage",		overload<const  chan&,              const  prob&,const  chan&>(g_vuln::add_leakage<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::add_leakage<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",		overload<const rchan&,              const rprob&,const rchan&>(g_vuln::add_leakage<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::add_leakage<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+
+	m.def("mult_leakage",		overload<const  chan&,              const  prob&,const  chan&>(g_vuln::mult_leakage<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::mult_leakage<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",		overload<const rchan&,              const rprob&,const rchan&>(g_vuln::mult_leakage<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::mult_leakage<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+
+	m.def("strategy",			overload<const  chan&,              const  prob&,const  chan&>(g_vuln::strategy<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("strategy",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(g_vuln::strategy<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("strategy",			overload<const rchan&,              const rprob&,const rchan&>(g_vuln::strategy<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("strategy",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(g_vuln::strategy<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+
+	m.def("add_capacity",		g_vuln::add_capacity<double>, "pi"_a, "C"_a, "one_spanning_g"_a = false, nogil());
+	m.def("add_capacity",		g_vuln::add_capacity<rat>,    "pi"_a, "C"_a, "one_spanning_g"_a = false, nogil());
 
 	m.def("g_id",				[](double_c_t) { return g_vuln::g_id<double>; }, "type"_a = def_type());
 	m.def("g_id",				[](rat_c_t   ) { return g_vuln::g_id<rat>;    }, "type"_a = def_type());
@@ -50,12 +60,35 @@ void init_g_vuln_module(py::module m) {
 	m.def("g_add",				g_vuln::g_add<double>, "G1"_a, "G2"_a);
 	m.def("g_add",				g_vuln::g_add<rat>,    "G1"_a, "G2"_a);
 
-	m.def("g_from_posterior",	g_vuln::g_from_posterior<double>, "G"_a, "C"_a);
-	m.def("g_from_posterior",	g_vuln::g_from_posterior<rat>,    "G"_a, "C"_a);
-
-	m.def("g_to_bayes",			overload<chan,                      const  prob&>(g_vuln::g_to_bayes<double>), "G"_a, "pi"_a);
-	m.def("g_to_bayes",			overload<const Metric<double,uint>&,const  prob&>(g_vuln::g_to_bayes<double>), "g"_a, "pi"_a);
-	m.def("g_to_bayes",			overload<rchan,                     const rprob&>(g_vuln::g_to_bayes<rat>   ), "G"_a, "pi"_a);
-	m.def("g_to_bayes",			overload<const Metric<rat,uint>&,   const rprob&>(g_vuln::g_to_bayes<rat>   ), "g"_a, "pi"_a);
+	m.def("g_from_posterior",	g_vuln::g_from_posterior<double>, "G"_a, "C"_a, nogil());
+	m.def("g_from_posterior",	g_vuln::g_from_posterior<rat>,    "G"_a, "C"_a, nogil());
+
+	m.def("g_to_bayes",			overload<chan,                      const  prob&>(g_vuln::g_to_bayes<double>), "G"_a, "pi"_a, nogil());
+	m.def("g_to_bayes",			overload<const Metric<double,uint>&,const  prob&>(g_vuln::g_to_bayes<double>), "g"_a, "pi"_a, nogil());
+	m.def("g_to_bayes",			overload<rchan,                     const rprob&>(g_vuln::g_to_bayes<rat>   ), "G"_a, "pi"_a, nogil());
+	m.def("g_to_bayes",			overload<const Metric<rat,uint>&,   const rprob&>(g_vuln::g_to_bayes<rat>   ), "g"_a, "pi"_a, nogil());
+
+
+	// batched versions, for a gain matrix G (see bayes_vuln.posterior_many)
+	m.def("posterior_many",		[](const  chan& G, const std::vector< prob>& pis, const std::vector< chan>& Cs) {
+		return map_many([&](const  prob& pi, const  chan& C) { return g_vuln::posterior(G, pi, C); }, pis, Cs);
+	}, "G"_a, "pis"_a, "Cs"_a);
+	m.def("posterior_many",		[](const rchan& G, const std::vector<rprob>& pis, const std::vector<rchan>& Cs) {
+		return map_many([&](const rprob& pi, const rchan& C) { return g_vuln::posterior(G, pi, C); }, pis, Cs);
+	}, "G"_a, "pis"_a, "Cs"_a);
+
+	m.def("add_leakage_many",	[](const  chan& G, const std::vector< prob>& pis, const std::vector< chan>& Cs) {
+		return map_many([&](const  prob& pi, const  chan& C) { return g_vuln::add_leakage(G, pi, C); }, pis, Cs);
+	}, "G"_a, "pis"_a, "Cs"_a);
+	m.def("add_leakage_many",	[](const rchan& G, const std::vector<rprob>& pis, const std::vector<rchan>& Cs) {
+		return map_many([&](const rprob& pi, const rchan& C) { return g_vuln::add_leakage(G, pi, C); }, pis, Cs);
+	}, "G"_a, "pis"_a, "Cs"_a);
+
+	m.def("mult_leakage_many",	[](const  chan& G, const std::vector< prob>& pis, const std::vector< chan>& Cs) {
+		return map_many([&](const  prob& pi, const  chan& C) { return g_vuln::mult_leakage(G, pi, C); }, pis, Cs);
+	}, "G"_a, "pis"_a, "Cs"_a);
+	m.def("mult_leakage_many",	[](const rchan& G, const std::vector<rprob>& pis, const std::vector<rchan>& Cs) {
+		return map_many([&](const rprob& pi, const rchan& C) { return g_vuln::mult_leakage(G, pi, C); }, pis, Cs);
+	}, "G"_a, "pis"_a, "Cs"_a);
 
 }
\ No newline at end of file
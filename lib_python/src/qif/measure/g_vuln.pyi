@@ -12,6 +12,8 @@ def add_leakage(G: t.ndarray, pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 @t.overload
 def add_leakage(g: t.Metric[int,t.FloatOrRat], pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 
+def add_leakage_many(G: t.ndarray, pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[t.FloatOrRat]: ...
+
 def g_add(G1: t.ndarray, G2: t.ndarray) -> t.ndarray: ...
 
 def g_from_posterior(G: t.ndarray, C: t.ndarray) -> t.ndarray: ...
@@ -28,10 +30,18 @@ def mult_leakage(G: t.ndarray, pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 @t.overload
 def mult_leakage(g: t.Metric[int,t.FloatOrRat], pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 
+def mult_leakage_many(G: t.ndarray, pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[t.FloatOrRat]: ...
+
+@t.overload
+def posterior(G: t.ndarray, pi: t.ndarray, C: t.ChanLike) -> t.FloatOrRat: ...
 @t.overload
-def posterior(G: t.ndarray, pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
+def posterior(g: t.Metric[int,t.FloatOrRat], pi: t.ndarray, C: t.ChanLike) -> t.FloatOrRat: ...
 @t.overload
-def posterior(g: t.Metric[int,t.FloatOrRat], pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
+def posterior(G: t.ndarray, pis: t.ndarray, C: t.ndarray) -> t.ndarray: ...
+@t.overload
+def posterior(g: t.Metric[int,t.FloatOrRat], pis: t.ndarray, C: t.ndarray) -> t.ndarray: ...
+
+def posterior_many(G: t.ndarray, pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[t.FloatOrRat]: ...
 
 @t.overload
 def prior(G: t.ndarray, pi: t.ndarray) -> t.FloatOrRat: ...
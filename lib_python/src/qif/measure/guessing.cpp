@@ -16,13 +16,19 @@ void init_guessing_module(py::module m) {
 	m.def("prior",      	guessing::prior<double>, "pi"_a);
 	m.def("prior",      	guessing::prior<rat>,    "pi"_a);
 
-	m.def("posterior",     	guessing::posterior<double>, "pi"_a, "C"_a);
-	m.def("posterior",     	guessing::posterior<rat>,    "pi"_a, "C"_a);
+	m.def("posterior",     	overload<const prob&,const chan&>(guessing::posterior<double>), "pi"_a, "C"_a, nogil());
+	m.def("posterior",     	overload<const rprob&,const rchan&>(guessing::posterior<rat>),    "pi"_a, "C"_a, nogil());
 
-	m.def("add_leakage",   	guessing::add_leakage<double>, "pi"_a, "C"_a);
-	m.def("add_leakage",   	guessing::add_leakage<rat>,    "pi"_a, "C"_a);
+	m.def("add_leakage",   	overload<const prob&,const chan&>(guessing::add_leakage<double>), "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",   	overload<const rprob&,const rchan&>(guessing::add_leakage<rat>),    "pi"_a, "C"_a, nogil());
 
-	m.def("mult_leakage",  	guessing::mult_leakage<double>, "pi"_a, "C"_a);
-	m.def("mult_leakage",  	guessing::mult_leakage<rat>,    "pi"_a, "C"_a);
+	m.def("mult_leakage",  	overload<const prob&,const chan&>(guessing::mult_leakage<double>), "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",  	overload<const rprob&,const rchan&>(guessing::mult_leakage<rat>),    "pi"_a, "C"_a, nogil());
+
+	m.def("prior_k",     	guessing::prior_k<double>, "pi"_a, "k"_a);
+	m.def("prior_k",     	guessing::prior_k<rat>,    "pi"_a, "k"_a);
+
+	m.def("posterior_k",   	guessing::posterior_k<double>, "pi"_a, "C"_a, "k"_a, nogil());
+	m.def("posterior_k",   	guessing::posterior_k<rat>,    "pi"_a, "C"_a, "k"_a, nogil());
 
 }
\ No newline at end of file
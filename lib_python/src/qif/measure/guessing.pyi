@@ -9,4 +9,8 @@ def mult_leakage(pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 
 def posterior(pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 
+def posterior_k(pi: t.ndarray, C: t.ndarray, k: int) -> t.FloatOrRat: ...
+
 def prior(pi: t.ndarray) -> t.FloatOrRat: ...
+
+def prior_k(pi: t.ndarray, k: int) -> t.FloatOrRat: ...
@@ -18,28 +18,32 @@ void init_l_risk_module(py::module m) {
 	m.def("prior",				overload<const rchan&,              const rprob&>(l_risk::prior<rat>   ), "G"_a, "pi"_a);
 	m.def("prior",				overload<const Metric<rat,uint>&,   const rprob&>(l_risk::prior<rat>   ), "G"_a, "pi"_a);
 
-	m.def("posterior",			overload<const  chan&,              const  prob&,const  chan&>(l_risk::posterior<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("posterior",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::posterior<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("posterior",			overload<const rchan&,              const rprob&,const rchan&>(l_risk::posterior<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("posterior",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::posterior<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("add_leakage",		overload<const  chan&,              const  prob&,const  chan&>(l_risk::add_leakage<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("add_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::add_leakage<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("add_leakage",		overload<const rchan&,              const rprob&,const rchan&>(l_risk::add_leakage<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("add_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::add_leakage<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("mult_leakage",		overload<const  chan&,              const  prob&,const  chan&>(l_risk::mult_leakage<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("mult_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::mult_leakage<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("mult_leakage",		overload<const rchan&,              const rprob&,const rchan&>(l_risk::mult_leakage<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("mult_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::mult_leakage<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("strategy",			overload<const  chan&,              const  prob&,const  chan&>(l_risk::strategy<double>), "G"_a, "pi"_a, "C"_a);
-	m.def("strategy",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::strategy<double>), "g"_a, "pi"_a, "C"_a);
-	m.def("strategy",			overload<const rchan&,              const rprob&,const rchan&>(l_risk::strategy<rat>   ), "G"_a, "pi"_a, "C"_a);
-	m.def("strategy",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::strategy<rat>   ), "g"_a, "pi"_a, "C"_a);
-
-	m.def("add_capacity",		l_risk::add_capacity<double>, "pi"_a, "C"_a, "one_spanning_g"_a = false);
-	m.def("add_capacity",		l_risk::add_capacity<rat>,    "pi"_a, "C"_a, "one_spanning_g"_a = false);
+	m.def("posterior",			overload<const  chan&,              const  prob&,const  chan&>(l_risk::posterior<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::posterior<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const rchan&,              const rprob&,const rchan&>(l_risk::posterior<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::posterior<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const  chan&,              const  chan&,const  chan&>(l_risk::posterior<double>), "G"_a, "pis"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<double,uint>&,const  chan&,const  chan&>(l_risk::posterior<double>), "g"_a, "pis"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const rchan&,              const rchan&,const rchan&>(l_risk::posterior<rat>   ), "G"_a, "pis"_a, "C"_a, nogil());
+	m.def("posterior",			overload<const Metric<rat,uint>&,   const rchan&,const rchan&>(l_risk::posterior<rat>   ), "g"_a, "pis"_a, "C"_a, nogil());
+
+	m.def("add_leakage",		overload<const  chan&,              const  prob&,const  chan&>(l_risk::add_leakage<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::add_leakage<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",		overload<const rchan&,              const rprob&,const rchan&>(l_risk::add_leakage<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::add_leakage<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+
+	m.def("mult_leakage",		overload<const  chan&,              const  prob&,const  chan&>(l_risk::mult_leakage<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",		overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::mult_leakage<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",		overload<const rchan&,              const rprob&,const rchan&>(l_risk::mult_leakage<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",		overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::mult_leakage<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+
+	m.def("strategy",			overload<const  chan&,              const  prob&,const  chan&>(l_risk::strategy<double>), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("strategy",			overload<const Metric<double,uint>&,const  prob&,const  chan&>(l_risk::strategy<double>), "g"_a, "pi"_a, "C"_a, nogil());
+	m.def("strategy",			overload<const rchan&,              const rprob&,const rchan&>(l_risk::strategy<rat>   ), "G"_a, "pi"_a, "C"_a, nogil());
+	m.def("strategy",			overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(l_risk::strategy<rat>   ), "g"_a, "pi"_a, "C"_a, nogil());
+
+	m.def("add_capacity",		l_risk::add_capacity<double>, "pi"_a, "C"_a, "one_spanning_g"_a = false, nogil());
+	m.def("add_capacity",		l_risk::add_capacity<rat>,    "pi"_a, "C"_a, "one_spanning_g"_a = false, nogil());
 
 	m.def("loss_to_gain",		l_risk::loss_to_gain<double>, "n_secrets"_a, "n_guesses"_a, "l"_a);
 	m.def("loss_to_gain",		l_risk::loss_to_gain<rat>,    "n_secrets"_a, "n_guesses"_a, "l"_a);
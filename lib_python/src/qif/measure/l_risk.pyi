@@ -25,6 +25,10 @@ def mult_leakage(g: t.Metric[int,t.FloatOrRat], pi: t.ndarray, C: t.ndarray) ->
 def posterior(G: t.ndarray, pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 @t.overload
 def posterior(g: t.Metric[int,t.FloatOrRat], pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
+@t.overload
+def posterior(G: t.ndarray, pis: t.ndarray, C: t.ndarray) -> t.ndarray: ...
+@t.overload
+def posterior(g: t.Metric[int,t.FloatOrRat], pis: t.ndarray, C: t.ndarray) -> t.ndarray: ...
 
 @t.overload
 def prior(G: t.ndarray, pi: t.ndarray) -> t.FloatOrRat: ...
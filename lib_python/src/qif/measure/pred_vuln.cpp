@@ -19,19 +19,19 @@ void init_pred_vuln_module(py::module m) {
 	m.def("prior",      	pred_vuln::prior<double>, "P"_a, "pi"_a);
 	m.def("prior",      	pred_vuln::prior<rat>,    "P"_a, "pi"_a);
 
-	m.def("posterior",     	pred_vuln::posterior<double>, "P"_a, "pi"_a, "C"_a);
-	m.def("posterior",     	pred_vuln::posterior<rat>,    "P"_a, "pi"_a, "C"_a);
+	m.def("posterior",     	pred_vuln::posterior<double>, "P"_a, "pi"_a, "C"_a, nogil());
+	m.def("posterior",     	pred_vuln::posterior<rat>,    "P"_a, "pi"_a, "C"_a, nogil());
 
-	m.def("add_leakage",   	pred_vuln::add_leakage<double>, "P"_a, "pi"_a, "C"_a);
-	m.def("add_leakage",   	pred_vuln::add_leakage<rat>,    "P"_a, "pi"_a, "C"_a);
+	m.def("add_leakage",   	pred_vuln::add_leakage<double>, "P"_a, "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",   	pred_vuln::add_leakage<rat>,    "P"_a, "pi"_a, "C"_a, nogil());
 
-	m.def("mult_leakage",  	pred_vuln::mult_leakage<double>, "P"_a, "pi"_a, "C"_a);
-	m.def("mult_leakage",  	pred_vuln::mult_leakage<rat>,    "P"_a, "pi"_a, "C"_a);
+	m.def("mult_leakage",  	pred_vuln::mult_leakage<double>, "P"_a, "pi"_a, "C"_a, nogil());
+	m.def("mult_leakage",  	pred_vuln::mult_leakage<rat>,    "P"_a, "pi"_a, "C"_a, nogil());
 
-	m.def("mult_capacity",  pred_vuln::mult_capacity<double>, "P"_a, "C"_a, "method"_a = "direct");
-	m.def("mult_capacity",  pred_vuln::mult_capacity<rat>,    "P"_a, "C"_a, "method"_a = "direct");
+	m.def("mult_capacity",  pred_vuln::mult_capacity<double>, "P"_a, "C"_a, "method"_a = "direct", nogil());
+	m.def("mult_capacity",  pred_vuln::mult_capacity<rat>,    "P"_a, "C"_a, "method"_a = "direct", nogil());
 
-	m.def("binary_channel", pred_vuln::binary_channel<double>, "P"_a, "pi"_a, "C"_a);
-	m.def("binary_channel",	pred_vuln::binary_channel<rat>,    "P"_a, "pi"_a, "C"_a);
+	m.def("binary_channel", pred_vuln::binary_channel<double>, "P"_a, "pi"_a, "C"_a, nogil());
+	m.def("binary_channel",	pred_vuln::binary_channel<rat>,    "P"_a, "pi"_a, "C"_a, nogil());
 
 }
\ No newline at end of file
@@ -14,13 +14,41 @@ void init_shannon_module(py::module m) {
 	)pbdoc";
 
 	m.def("prior",      	shannon::prior<double>, "pi"_a);
+	m.def("prior",      	shannon::prior<float>,  "pi"_a);
 
-	m.def("posterior",     	shannon::posterior<double>, "pi"_a, "C"_a);
+	m.def("set_fast_log2",	shannon::set_fast_log2, "enabled"_a);
+	m.def("get_fast_log2",	shannon::get_fast_log2);
 
-	m.def("add_leakage",   	shannon::add_leakage<double>, "pi"_a, "C"_a);
+	m.def("posterior",     	overload<const prob&,const spchan&>(shannon::posterior<double>), "pi"_a, "C"_a, nogil());	// scipy.sparse
+	m.def("posterior",     	overload<const prob&,const channel::MappedChan<double>&>(shannon::posterior<double>), "pi"_a, "C"_a, nogil());	// memory-mapped C-ordered, without copy
+	m.def("posterior",     	overload<const prob&,const chan&>(shannon::posterior<double>), "pi"_a, "C"_a, nogil());
+	m.def("posterior",     	overload<const fprob&,const fchan&>(shannon::posterior<float>), "pi"_a, "C"_a, nogil());	// float32, summed in double
 
-	m.def("mult_leakage",  	shannon::mult_leakage<double>, "pi"_a, "C"_a);
+	m.def("add_leakage",   	overload<const prob&,const chan&>(shannon::add_leakage<double>), "pi"_a, "C"_a, nogil());
+	m.def("add_leakage",   	overload<const fprob&,const fchan&>(shannon::add_leakage<float>), "pi"_a, "C"_a, nogil());
 
-	m.def("add_capacity",  	shannon::add_capacity<double>, "C"_a, "md"_a = def_md<double>, "mrd"_a = def_mrd<double>);
+	m.def("mult_leakage",  	overload<const prob&,const chan&>(shannon::mult_leakage<double>), "pi"_a, "C"_a, nogil());
+
+	// checkpoint: file saving the state every checkpoint_every iterations, resumed from if it exists (see checkpoint.h)
+	typedef shannon::CapacityState<double> State;
+	auto hook = [](const std::string& file, uint every) { return file.empty() ? checkpoint::Hook<State>() : checkpoint::file<State>(file, every); };
+
+	m.def("add_capacity",  	[=](const chan& C, double md, double mrd, const std::string& file, uint every) {
+		return shannon::add_capacity<double>(C, md, mrd, hook(file, every));
+	}, "C"_a, "md"_a = def_md<double>, "mrd"_a = def_mrd<double>, "checkpoint"_a = "", "checkpoint_every"_a = 100, nogil());
+
+	m.def("add_capacity_bounds",	[=](const chan& C, double md, double mrd, uint max_iter, double max_time, bool accelerate, const std::string& file, uint every) {
+		return shannon::add_capacity_bounds<double>(C, md, mrd, max_iter, max_time, accelerate, hook(file, every));
+	}, "C"_a, "md"_a = def_md<double>, "mrd"_a = def_mrd<double>,
+		"max_iter"_a = std::numeric_limits<uint>::max(), "max_time"_a = std::numeric_limits<double>::infinity(), "accelerate"_a = true,
+		"checkpoint"_a = "", "checkpoint_every"_a = 100, nogil());
+
+
+	// batched versions (see bayes_vuln.posterior_many)
+	m.def("posterior_many",		[](const std::vector<prob>& pis, const std::vector<chan>& Cs) { return map_many(overload<const prob&,const chan&>(shannon::posterior<double>), pis, Cs); }, "pis"_a, "Cs"_a);
+
+	m.def("add_leakage_many",	[](const std::vector<prob>& pis, const std::vector<chan>& Cs) { return map_many(overload<const prob&,const chan&>(shannon::add_leakage<double>), pis, Cs); }, "pis"_a, "Cs"_a);
+
+	m.def("mult_leakage_many",	[](const std::vector<prob>& pis, const std::vector<chan>& Cs) { return map_many(overload<const prob&,const chan&>(shannon::mult_leakage<double>), pis, Cs); }, "pis"_a, "Cs"_a);
 
 }
\ No newline at end of file
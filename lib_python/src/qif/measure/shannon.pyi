@@ -3,12 +3,24 @@ Shannon entropy.
 """
 from .. import typing as t
 
-def add_capacity(C: t.ndarray, md: float = ..., mrd: float = ...) -> t.Tuple[float, t.ndarray]: ...
+def add_capacity(C: t.ndarray, md: float = ..., mrd: float = ..., checkpoint: str = '', checkpoint_every: int = 100) -> t.Tuple[float, t.ndarray]: ...
+
+def add_capacity_bounds(C: t.ndarray, md: float = ..., mrd: float = ..., max_iter: int = ..., max_time: float = ..., accelerate: bool = True, checkpoint: str = '', checkpoint_every: int = 100) -> t.Tuple[float, float, t.ndarray]: ...
 
 def add_leakage(pi: t.ndarray, C: t.ndarray) -> float: ...
 
+def add_leakage_many(pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[float]: ...
+
+def get_fast_log2() -> bool: ...
+
 def mult_leakage(pi: t.ndarray, C: t.ndarray) -> float: ...
 
-def posterior(pi: t.ndarray, C: t.ndarray) -> float: ...
+def mult_leakage_many(pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[float]: ...
+
+def posterior(pi: t.ndarray, C: t.ChanLike) -> float: ...
+
+def posterior_many(pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[float]: ...
 
 def prior(pi: t.ndarray) -> float: ...
+
+def set_fast_log2(enabled: bool) -> None: ...
@@ -17,6 +17,8 @@ void init_mechanism_d_privacy_module(py::module);
 
 void init_mechanism_module(py::module m) {
 
+	m.def("grid_symmetries", &mechanism::symmetry::grid, "width"_a, "height"_a);
+
 	init_mechanism_bayes_vuln_module(m.def_submodule("bayes_vuln", ""));
 	init_mechanism_bayes_risk_module(m.def_submodule("bayes_risk", ""));
 	init_mechanism_g_vuln_module    (m.def_submodule("g_vuln",     ""));
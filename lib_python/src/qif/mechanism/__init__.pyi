@@ -21,4 +21,6 @@ from . import (
 	shannon as shannon
 )
 
+from .. import typing as t
 
+def grid_symmetries(width: int, height: int) -> t.List[t.List[int]]: ...
@@ -13,13 +13,19 @@ void init_mechanism_bayes_vuln_module(py::module m) {
 		Mechanism construction for Bayes vulnerability.
 	)pbdoc";
 
-	m.def("min_loss_given_max_vuln",	m::bayes_vuln::min_loss_given_max_vuln<double>, "pi"_a, "n_cols"_a, "max_vuln"_a, "loss"_a, "hard_max_loss"_a = infinity<double>());
-	m.def("min_loss_given_max_vuln",	m::bayes_vuln::min_loss_given_max_vuln<rat>,    "pi"_a, "n_cols"_a, "max_vuln"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   ());
+	m.def("min_loss_given_max_vuln",	overload<const  prob&, uint, double,            Metric<double,uint>, double>(m::bayes_vuln::min_loss_given_max_vuln<double>), "pi"_a, "n_cols"_a, "max_vuln"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), nogil());
+	m.def("min_loss_given_max_vuln",	overload<const rprob&, uint, rat,               Metric<rat,   uint>, rat   >(m::bayes_vuln::min_loss_given_max_vuln<rat>   ), "pi"_a, "n_cols"_a, "max_vuln"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), nogil());
+	m.def("min_loss_given_max_vuln",	overload<const  prob&, uint, const arma::vec&, Metric<double,uint>, double>(m::bayes_vuln::min_loss_given_max_vuln<double>), "pi"_a, "n_cols"_a, "max_vulns"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), nogil());
+	m.def("min_loss_given_max_vuln",	overload<const rprob&, uint, const rcolvec&,   Metric<rat,   uint>, rat   >(m::bayes_vuln::min_loss_given_max_vuln<rat>   ), "pi"_a, "n_cols"_a, "max_vulns"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), nogil());
 
-	m.def("min_vuln_given_max_loss",	m::bayes_vuln::min_vuln_given_max_loss<double>, "pi"_a, "n_cols"_a, "max_loss"_a, "loss"_a, "hard_max_loss"_a = infinity<double>());
-	m.def("min_vuln_given_max_loss",	m::bayes_vuln::min_vuln_given_max_loss<rat>,    "pi"_a, "n_cols"_a, "max_loss"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   ());
+	m.def("min_vuln_given_max_loss",	overload<const  prob&, uint, double,            Metric<double,uint>, double>(m::bayes_vuln::min_vuln_given_max_loss<double>), "pi"_a, "n_cols"_a, "max_loss"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), nogil());
+	m.def("min_vuln_given_max_loss",	overload<const rprob&, uint, rat,               Metric<rat,   uint>, rat   >(m::bayes_vuln::min_vuln_given_max_loss<rat>   ), "pi"_a, "n_cols"_a, "max_loss"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), nogil());
+	m.def("min_vuln_given_max_loss",	overload<const  prob&, uint, const arma::vec&, Metric<double,uint>, double>(m::bayes_vuln::min_vuln_given_max_loss<double>), "pi"_a, "n_cols"_a, "max_losses"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), nogil());
+	m.def("min_vuln_given_max_loss",	overload<const rprob&, uint, const rcolvec&,   Metric<rat,   uint>, rat   >(m::bayes_vuln::min_vuln_given_max_loss<rat>   ), "pi"_a, "n_cols"_a, "max_losses"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), nogil());
 
-	m.def("min_vuln_for_row",			m::bayes_vuln::min_vuln_for_row<double>, "pi"_a, "p"_a, "C"_a);
-	m.def("min_vuln_for_row",			m::bayes_vuln::min_vuln_for_row<rat>,    "pi"_a, "p"_a, "C"_a);
+	m.def("frontier", m::bayes_vuln::frontier<double>, "pi"_a, "n_cols"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), nogil());
+
+	m.def("min_vuln_for_row",			m::bayes_vuln::min_vuln_for_row<double>, "pi"_a, "p"_a, "C"_a, nogil());
+	m.def("min_vuln_for_row",			m::bayes_vuln::min_vuln_for_row<rat>,    "pi"_a, "p"_a, "C"_a, nogil());
 
 }
\ No newline at end of file
@@ -2,10 +2,19 @@
 Mechanism construction for Bayes vulnerability.
 """
 from .. import typing as t
+from .g_vuln import Frontier
 
+@t.overload
 def min_loss_given_max_vuln(pi: t.ndarray, n_cols: int, max_vuln: t.FloatOrRat, loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf) -> t.ndarray: ...
+@t.overload
+def min_loss_given_max_vuln(pi: t.ndarray, n_cols: int, max_vulns: t.ndarray, loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf) -> t.List[t.ndarray]: ...
 
 def min_vuln_for_row(pi: t.ndarray, p: t.FloatOrRat, C: t.ndarray) -> t.ndarray: ...
 
+@t.overload
 def min_vuln_given_max_loss(pi: t.ndarray, n_cols: int, max_loss: t.FloatOrRat, loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf) -> t.ndarray: ...
+@t.overload
+def min_vuln_given_max_loss(pi: t.ndarray, n_cols: int, max_losses: t.ndarray, loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf) -> t.List[t.ndarray]: ...
 
+
+def frontier(pi: t.ndarray, n_cols: int, loss: t.Metric[int,float], hard_max_loss: float = t.inf) -> Frontier: ...
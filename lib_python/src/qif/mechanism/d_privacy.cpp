@@ -13,18 +13,20 @@ void init_mechanism_d_privacy_module(py::module m) {
 		Mechanism construction for :math:`d`-privacy.
 	)pbdoc";
 
-	m.def("distance_matrix",	m::d_privacy::distance_matrix<double>, "n_rows"_a, "n_cols"_a, "d"_a);
+	m.def("distance_matrix",	m::d_privacy::distance_matrix<double>, "n_rows"_a, "n_cols"_a, "d"_a, nogil());
 
-	m.def("geometric",			m::d_privacy::geometric<double>, "n_rows"_a, "epsilon"_a = 1, "n_cols"_a = 0, "first_x"_a = 0, "first_y"_a = 0);
+	m.def("geometric",			m::d_privacy::geometric<double>, "n_rows"_a, "epsilon"_a = 1, "n_cols"_a = 0, "first_x"_a = 0, "first_y"_a = 0, nogil());
 
-	m.def("exponential",		m::d_privacy::exponential<double>, "n_rows"_a, "d"_a, "n_cols"_a = 0);
+	m.def("exponential",		overload<uint,Metric<double,uint>,uint>(m::d_privacy::exponential<double>), "n_rows"_a, "d"_a, "n_cols"_a = 0, nogil());
+	m.def("exponential",		overload<const  mat&>(m::d_privacy::exponential<double>), "D"_a, nogil());
+	m.def("exponential",		overload<const fchan&>(m::d_privacy::exponential<float>), "D"_a, nogil());	// float32 channel for a float32 distance matrix
 
-	m.def("randomized_response",m::d_privacy::randomized_response<double>, "n_rows"_a, "epsilon"_a = 1, "n_cols"_a = 0);
+	m.def("randomized_response",m::d_privacy::randomized_response<double>, "n_rows"_a, "epsilon"_a = 1, "n_cols"_a = 0, nogil());
 
-	m.def("tight_constraints",	overload<uint,Metric<double,uint>>(m::d_privacy::tight_constraints<double>), "n_rows"_a, "d"_a);
+	m.def("tight_constraints",	overload<uint,Metric<double,uint>>(m::d_privacy::tight_constraints<double>), "n_rows"_a, "d"_a, nogil());
 
-	m.def("exact_distance",		m::d_privacy::exact_distance<double>, "n_rows"_a, "d"_a);
+	m.def("exact_distance",		m::d_privacy::exact_distance<double>, "n_rows"_a, "d"_a, nogil());
 
-	m.def("min_loss_given_d",	m::d_privacy::min_loss_given_d<double>, "pi"_a, "n_cols"_a, "d_priv"_a, "loss"_a, "vars"_a = "all", "d_priv_ch"_a = metric::never_chainable<uint>, "inf"_a = std::log(1e200));
+	m.def("min_loss_given_d",	m::d_privacy::min_loss_given_d<double>, "pi"_a, "n_cols"_a, "d_priv"_a, "loss"_a, "vars"_a = "all", "d_priv_ch"_a = metric::never_chainable<uint>, "inf"_a = std::log(1e200), "symmetries"_a = std::vector<std::vector<uint>>(), nogil());
 
 }
\ No newline at end of file
@@ -7,7 +7,10 @@ def distance_matrix(n_rows: int, n_cols: int, d: t.Metric[int,float]) -> t.ndarr
 
 def geometric(n_rows: int, epsilon: float = 1, n_cols: int = 0, first_x: int = 0, first_y: int = 0) -> t.ndarray: ...
 
+@t.overload
 def exponential(n_rows: int, d: t.Metric[int,float], n_cols: int = 0) -> t.ndarray: ...
+@t.overload
+def exponential(D: t.ndarray) -> t.ndarray: ...
 
 def randomized_response(n_rows: int, epsilon: float = 1, n_cols: int = 0) -> t.ndarray: ...
 
@@ -15,4 +18,4 @@ def tight_constraints(n_rows: int, d: t.Metric[int,float]) -> t.ndarray: ...
 
 def exact_distance(n_rows: int, d: t.Metric[int,float]) -> t.ndarray: ...
 
-def min_loss_given_d(pi: t.ndarray, n_cols: int, d_priv: t.Metric[int,float], loss: t.Metric[int,float], vars: str = 'all', d_priv_ch: t.Metric[int,bool] = ..., inf: float = ...) -> t.ndarray: ...
+def min_loss_given_d(pi: t.ndarray, n_cols: int, d_priv: t.Metric[int,float], loss: t.Metric[int,float], vars: str = 'all', d_priv_ch: t.Metric[int,bool] = ..., inf: float = ..., symmetries: t.List[t.List[int]] = []) -> t.ndarray: ...
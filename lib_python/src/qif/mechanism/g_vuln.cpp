@@ -5,6 +5,7 @@ namespace py = pybind11;
 using namespace py::literals;
 using namespace qif;
 namespace m = qif::mechanism;
+typedef std::vector<std::vector<uint>> Symmetries;
 
 
 void init_mechanism_g_vuln_module(py::module m) {
@@ -13,10 +14,29 @@ void init_mechanism_g_vuln_module(py::module m) {
 		Mechanism construction for :math:`g`-vulnerabiliy.
 	)pbdoc";
 
-	m.def("min_loss_given_max_vuln",	m::g_vuln::min_loss_given_max_vuln<double>, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vuln"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>());
-	m.def("min_loss_given_max_vuln",	m::g_vuln::min_loss_given_max_vuln<rat>,    "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vuln"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   ());
+	m.def("min_loss_given_max_vuln",	overload<const  prob&, uint, uint, double,            Metric<double,uint>, Metric<double,uint>, double, bool>(m::g_vuln::min_loss_given_max_vuln<double>), "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vuln"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), "lazy_constraints"_a = false, nogil());
+	m.def("min_loss_given_max_vuln",	overload<const rprob&, uint, uint, rat,               Metric<rat,   uint>, Metric<rat,   uint>, rat,    bool>(m::g_vuln::min_loss_given_max_vuln<rat>   ), "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vuln"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), "lazy_constraints"_a = false, nogil());
+	m.def("min_loss_given_max_vuln",	[](const  prob& pi, uint n_cols, uint n_guesses, const arma::vec& max_vulns, Metric<double,uint> gain, Metric<double,uint> loss, double hard_max_loss, bool lazy) { return m::g_vuln::min_loss_given_max_vuln<double>(pi, n_cols, n_guesses, max_vulns, gain, loss, hard_max_loss, lazy); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vulns"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), "lazy_constraints"_a = false, nogil());
+	m.def("min_loss_given_max_vuln",	[](const rprob& pi, uint n_cols, uint n_guesses, const rcolvec& max_vulns, Metric<rat,   uint> gain, Metric<rat,   uint> loss, rat    hard_max_loss, bool lazy) { return m::g_vuln::min_loss_given_max_vuln<rat>(pi, n_cols, n_guesses, max_vulns, gain, loss, hard_max_loss, lazy); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vulns"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), "lazy_constraints"_a = false, nogil());
 
-	m.def("min_vuln_given_max_loss",	m::g_vuln::min_vuln_given_max_loss<double>, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_loss"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>());
-	m.def("min_vuln_given_max_loss",	m::g_vuln::min_vuln_given_max_loss<rat>   , "pi"_a, "n_cols"_a, "n_guesses"_a, "max_loss"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   ());
+	m.def("min_vuln_given_max_loss",	overload<const  prob&, uint, uint, double,            Metric<double,uint>, Metric<double,uint>, double, bool, const Symmetries&>(m::g_vuln::min_vuln_given_max_loss<double>), "pi"_a, "n_cols"_a, "n_guesses"_a, "max_loss"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), "lazy_constraints"_a = false, "symmetries"_a = Symmetries(), nogil());
+	m.def("min_vuln_given_max_loss",	overload<const rprob&, uint, uint, rat,               Metric<rat,   uint>, Metric<rat,   uint>, rat,    bool, const Symmetries&>(m::g_vuln::min_vuln_given_max_loss<rat>   ), "pi"_a, "n_cols"_a, "n_guesses"_a, "max_loss"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), "lazy_constraints"_a = false, "symmetries"_a = Symmetries(), nogil());
+	m.def("min_vuln_given_max_loss",	[](const  prob& pi, uint n_cols, uint n_guesses, const arma::vec& max_losses, Metric<double,uint> gain, Metric<double,uint> loss, double hard_max_loss, bool lazy, const Symmetries& symmetries) { return m::g_vuln::min_vuln_given_max_loss<double>(pi, n_cols, n_guesses, max_losses, gain, loss, hard_max_loss, lazy, symmetries); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_losses"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), "lazy_constraints"_a = false, "symmetries"_a = Symmetries(), nogil());
+	m.def("min_vuln_given_max_loss",	[](const rprob& pi, uint n_cols, uint n_guesses, const rcolvec& max_losses, Metric<rat,   uint> gain, Metric<rat,   uint> loss, rat    hard_max_loss, bool lazy, const Symmetries& symmetries) { return m::g_vuln::min_vuln_given_max_loss<rat>(pi, n_cols, n_guesses, max_losses, gain, loss, hard_max_loss, lazy, symmetries); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_losses"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), "lazy_constraints"_a = false, "symmetries"_a = Symmetries(), nogil());
+
+	// the sweep versions, also returning the dual of the threshold constraint for each value (the slope of the frontier)
+	m.def("min_loss_given_max_vuln_duals",	[](const  prob& pi, uint n_cols, uint n_guesses, const arma::vec& max_vulns, Metric<double,uint> gain, Metric<double,uint> loss, double hard_max_loss, bool lazy) { arma::vec duals; auto Cs = m::g_vuln::min_loss_given_max_vuln<double>(pi, n_cols, n_guesses, max_vulns, gain, loss, hard_max_loss, lazy, &duals); return std::make_tuple(Cs, duals); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vulns"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), "lazy_constraints"_a = false, nogil());
+	m.def("min_loss_given_max_vuln_duals",	[](const rprob& pi, uint n_cols, uint n_guesses, const rcolvec& max_vulns, Metric<rat,   uint> gain, Metric<rat,   uint> loss, rat    hard_max_loss, bool lazy) { rcolvec   duals; auto Cs = m::g_vuln::min_loss_given_max_vuln<rat>   (pi, n_cols, n_guesses, max_vulns, gain, loss, hard_max_loss, lazy, &duals); return std::make_tuple(Cs, duals); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_vulns"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), "lazy_constraints"_a = false, nogil());
+	m.def("min_vuln_given_max_loss_duals",	[](const  prob& pi, uint n_cols, uint n_guesses, const arma::vec& max_losses, Metric<double,uint> gain, Metric<double,uint> loss, double hard_max_loss, bool lazy, const Symmetries& symmetries) { arma::vec duals; auto Cs = m::g_vuln::min_vuln_given_max_loss<double>(pi, n_cols, n_guesses, max_losses, gain, loss, hard_max_loss, lazy, symmetries, &duals); return std::make_tuple(Cs, duals); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_losses"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), "lazy_constraints"_a = false, "symmetries"_a = Symmetries(), nogil());
+	m.def("min_vuln_given_max_loss_duals",	[](const rprob& pi, uint n_cols, uint n_guesses, const rcolvec& max_losses, Metric<rat,   uint> gain, Metric<rat,   uint> loss, rat    hard_max_loss, bool lazy, const Symmetries& symmetries) { rcolvec   duals; auto Cs = m::g_vuln::min_vuln_given_max_loss<rat>   (pi, n_cols, n_guesses, max_losses, gain, loss, hard_max_loss, lazy, symmetries, &duals); return std::make_tuple(Cs, duals); }, "pi"_a, "n_cols"_a, "n_guesses"_a, "max_losses"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<rat>   (), "lazy_constraints"_a = false, "symmetries"_a = Symmetries(), nogil());
+
+	py::class_<m::g_vuln::Frontier<double>>(m, "Frontier")
+		.def_readonly("vulns",      &m::g_vuln::Frontier<double>::vulns)
+		.def_readonly("losses",     &m::g_vuln::Frontier<double>::losses)
+		.def_readonly("mechanisms", &m::g_vuln::Frontier<double>::mechanisms)
+		.def("min_loss_given_max_vuln", &m::g_vuln::Frontier<double>::min_loss_given_max_vuln, "max_vuln"_a)
+		.def("min_vuln_given_max_loss", &m::g_vuln::Frontier<double>::min_vuln_given_max_loss, "max_loss"_a);
+
+	m.def("frontier", m::g_vuln::frontier<double>, "pi"_a, "n_cols"_a, "n_guesses"_a, "gain"_a, "loss"_a, "hard_max_loss"_a = infinity<double>(), nogil());
 
 }
\ No newline at end of file
@@ -3,6 +3,27 @@ Mechanism construction for :math:`g`-vulnerabiliy.
 """
 from .. import typing as t
 
-def min_loss_given_max_vuln(pi: t.ndarray, n_cols: int, n_guesses: int, max_vuln: t.FloatOrRat, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf) -> t.ndarray: ...
+@t.overload
+def min_loss_given_max_vuln(pi: t.ndarray, n_cols: int, n_guesses: int, max_vuln: t.FloatOrRat, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf, lazy_constraints: bool = False) -> t.ndarray: ...
+@t.overload
+def min_loss_given_max_vuln(pi: t.ndarray, n_cols: int, n_guesses: int, max_vulns: t.ndarray, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf, lazy_constraints: bool = False) -> t.List[t.ndarray]: ...
 
-def min_vuln_given_max_loss(pi: t.ndarray, n_cols: int, n_guesses: int, max_loss: t.FloatOrRat, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf) -> t.ndarray: ...
+@t.overload
+def min_vuln_given_max_loss(pi: t.ndarray, n_cols: int, n_guesses: int, max_loss: t.FloatOrRat, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf, lazy_constraints: bool = False, symmetries: t.List[t.List[int]] = []) -> t.ndarray: ...
+@t.overload
+def min_vuln_given_max_loss(pi: t.ndarray, n_cols: int, n_guesses: int, max_losses: t.ndarray, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf, lazy_constraints: bool = False, symmetries: t.List[t.List[int]] = []) -> t.List[t.ndarray]: ...
+
+# the sweep versions, also returning for each value the dual of the threshold constraint (the slope of the frontier, 0
+# if infeasible or if the solver provides no duals)
+def min_loss_given_max_vuln_duals(pi: t.ndarray, n_cols: int, n_guesses: int, max_vulns: t.ndarray, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf, lazy_constraints: bool = False) -> t.Tuple[t.List[t.ndarray], t.ndarray]: ...
+def min_vuln_given_max_loss_duals(pi: t.ndarray, n_cols: int, n_guesses: int, max_losses: t.ndarray, gain: t.Metric[int,t.FloatOrRat], loss: t.Metric[int,t.FloatOrRat], hard_max_loss: t.FloatOrRat = t.inf, lazy_constraints: bool = False, symmetries: t.List[t.List[int]] = []) -> t.Tuple[t.List[t.ndarray], t.ndarray]: ...
+
+class Frontier():
+    vulns: t.ndarray
+    losses: t.ndarray
+    mechanisms: t.List[t.ndarray]
+
+    def min_loss_given_max_vuln(self, max_vuln: float) -> t.ndarray: ...
+    def min_vuln_given_max_loss(self, max_loss: float) -> t.ndarray: ...
+
+def frontier(pi: t.ndarray, n_cols: int, n_guesses: int, gain: t.Metric[int,float], loss: t.Metric[int,float], hard_max_loss: float = t.inf) -> Frontier: ...
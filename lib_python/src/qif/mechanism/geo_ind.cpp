@@ -13,13 +13,32 @@ void init_mechanism_geo_ind_module(py::module m) {
 		Mechanism construction for geo-indistinguishability.
 	)pbdoc";
 
-	m.def("planar_laplace_sample",	m::geo_ind::planar_laplace_sample<double>, "epsilon"_a);
-
-	m.def("planar_laplace_grid",	m::geo_ind::planar_laplace_grid<double>, "width"_a, "height"_a, "step"_a, "epsilon"_a);
-
-	m.def("planar_geometric_sample",	overload<double,double>     (m::geo_ind::planar_geometric_sample<double>), "cell_size"_a, "epsilon"_a);
-	m.def("planar_geometric_sample",	overload<double,double,uint>(m::geo_ind::planar_geometric_sample<double>), "cell_size"_a, "epsilon"_a, "n_samples"_a);
-
-	m.def("planar_geometric_grid",	m::geo_ind::planar_geometric_grid<double>, "width"_a, "height"_a, "step"_a, "epsilon"_a);
+	m.def("planar_laplace_sample",	overload<double>(m::geo_ind::planar_laplace_sample<double>), "epsilon"_a, nogil());
+	m.def("planar_laplace_sample",	[](double epsilon, uint n_samples) { return m::geo_ind::planar_laplace_sample<double>(epsilon, n_samples); }, "epsilon"_a, "n_samples"_a, nogil());
+
+	m.def("planar_laplace_grid",	[](uint width, uint height, double step, double epsilon, const std::string& method, float_c_t) {
+		return m::geo_ind::planar_laplace_grid<float>(width, height, float(step), float(epsilon), method);
+	}, "width"_a, "height"_a, "step"_a, "epsilon"_a, "method"_a = "miser", "type"_a = def_type(), nogil());
+	m.def("planar_laplace_grid",	m::geo_ind::planar_laplace_grid<double>, "width"_a, "height"_a, "step"_a, "epsilon"_a, "method"_a = "miser", nogil());
+
+	m.def("planar_geometric_sample",	overload<double,double>     (m::geo_ind::planar_geometric_sample<double>), "cell_size"_a, "epsilon"_a, nogil());
+	m.def("planar_geometric_sample",	overload<double,double,uint>(m::geo_ind::planar_geometric_sample<double>), "cell_size"_a, "epsilon"_a, "n_samples"_a, nogil());
+
+	m.def("planar_geometric_grid",	m::geo_ind::planar_geometric_grid<double>, "width"_a, "height"_a, "step"_a, "epsilon"_a, nogil());
+
+	// kernels reused across grid sizes
+	typedef m::geo_ind::LaplaceGridKernel<double> LaplaceKernel;
+	py::class_<LaplaceKernel>(m, "LaplaceGridKernel")
+		.def(py::init<double, double, const std::string&>(), "step"_a, "epsilon"_a, "method"_a = "miser")
+		.def("integration",    &LaplaceKernel::integration, "width"_a, "height"_a, nogil())
+		.def("grid",           &LaplaceKernel::grid,        "width"_a, "height"_a, nogil())
+		.def("n_integrations", &LaplaceKernel::n_integrations);
+
+	typedef m::geo_ind::GeometricGridKernel<double> GeometricKernel;
+	py::class_<GeometricKernel>(m, "GeometricGridKernel")
+		.def(py::init<double, double>(), "step"_a, "epsilon"_a)
+		.def("summation",  &GeometricKernel::summation,  "width"_a, "height"_a, nogil())
+		.def("grid",       &GeometricKernel::grid,       "width"_a, "height"_a, nogil())
+		.def("table_size", &GeometricKernel::table_size);
 
 }
\ No newline at end of file
@@ -3,9 +3,12 @@ Mechanism construction for geo-indistinguishability.
 """
 from .. import typing as t
 
+@t.overload
 def planar_laplace_sample(epsilon: float) -> t.point: ...
+@t.overload
+def planar_laplace_sample(epsilon: float, n_samples: int) -> t.ndarray: ...
 
-def planar_laplace_grid(width: int, height: int, step: float, epsilon: float) -> t.ndarray: ...
+def planar_laplace_grid(width: int, height: int, step: float, epsilon: float, method: str = "miser", type: t.TypeLike = t.def_type) -> t.ndarray: ...
 
 @t.overload
 def planar_geometric_sample(cell_size: float, epsilon: float) -> t.point: ...
@@ -13,3 +16,15 @@ def planar_geometric_sample(cell_size: float, epsilon: float) -> t.point: ...
 def planar_geometric_sample(cell_size: float, epsilon: float, n_samples: int) -> t.List[t.point]: ...
 
 def planar_geometric_grid(width: int, height: int, step: float, epsilon: float) -> t.ndarray: ...
+
+class LaplaceGridKernel():
+    def __init__(self, step: float, epsilon: float, method: str = "miser") -> None: ...
+    def integration(self, width: int, height: int) -> t.ndarray: ...
+    def grid(self, width: int, height: int) -> t.ndarray: ...
+    def n_integrations(self) -> int: ...
+
+class GeometricGridKernel():
+    def __init__(self, step: float, epsilon: float) -> None: ...
+    def summation(self, width: int, height: int) -> t.ndarray: ...
+    def grid(self, width: int, height: int) -> t.ndarray: ...
+    def table_size(self) -> int: ...
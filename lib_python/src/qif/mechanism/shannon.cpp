@@ -13,6 +13,6 @@ void init_mechanism_shannon_module(py::module m) {
 		Mechanism construction for Shannon enropy.
 	)pbdoc";
 
-	m.def("max_entropy_given_same_loss",	m::shannon::max_entropy_given_same_loss<double>, "pi"_a, "out"_a, "loss"_a, "md"_a = def_md<double>, "mrd"_a = def_mrd<double>);
+	m.def("max_entropy_given_same_loss",	m::shannon::max_entropy_given_same_loss<double>, "pi"_a, "out"_a, "loss"_a, "md"_a = def_md<double>, "mrd"_a = def_mrd<double>, nogil());
 
 }
\ No newline at end of file
@@ -13,6 +13,15 @@ void init_metric_module(py::module m) {
 
 	init_metric_optimize_module(m.def_submodule("optimize", ""));
 
+	py::class_<MetricDefaults>(m, "defaults")
+		.def_readwrite_static("vectorize", &MetricDefaults::vectorize);
+
+	// marks a python metric on int as scalar-only, it is never called on index arrays
+	m.def("scalar", [](py::object d) {
+		py::setattr(d, "qif_vectorize", py::bool_(false));
+		return d;
+	}, "d"_a);
+
 
 	m.def("euclidean",		[](double_c_t) { return metric::euclidean<double,double>(); }, "type"_a = def_type());
 	m.def("euclidean",		[](uint_c_t  ) { return metric::euclidean<double,uint>  (); }, "type"_a = def_type());
@@ -40,16 +49,23 @@ void init_metric_module(py::module m) {
 	m.def("threshold_inf",			metric::threshold_inf<double,double>);
 
 	m.def("from_distance_matrix",	metric::from_distance_matrix<double>);
-	m.def("to_distance_matrix",		metric::to_distance_matrix<double>);
+	m.def("to_distance_matrix",		overload<Metric<double,uint>,uint,uint,bool,bool>(metric::to_distance_matrix<double>),
+		"d"_a, "n_rows"_a, "n_cols"_a = 0, "symmetric"_a = false, "parallel"_a = false);
+	m.def("euclidean_matrix",		metric::euclidean_matrix<double>, "n_rows"_a, "n_cols"_a = 0, "step"_a = 1.0);
+	m.def("discrete_matrix",		metric::discrete_matrix<double>, "n_rows"_a, "n_cols"_a = 0);
 
 	m.def("l1",						metric::l1<double,prob>);
 	m.def("l2"		,				metric::l2<double,prob>);
 
 	m.def("total_variation",		metric::total_variation<double,prob>);
 	m.def("mult_total_variation",	metric::mult_total_variation<double,prob>);
-	m.def("convex_separation_quasi",metric::convex_separation_quasi<double,prob>);
-	m.def("convex_separation",		metric::convex_separation<double,prob>);
-	m.def("kantorovich",			metric::kantorovich<double,prob>);
-	m.def("mult_kantorovich",		metric::mult_kantorovich<double,prob>);
+	// the metrics below are expensive to evaluate, so they are returned as functions that release the GIL
+	m.def("convex_separation_quasi",[]() { return nogil_function(metric::convex_separation_quasi<double,prob>()); });
+	m.def("convex_separation",		[]() { return nogil_function(metric::convex_separation<double,prob>()); });
+	m.def("kantorovich",			[](const Metric<double,uint>& d) { return nogil_function(metric::kantorovich<double,prob>(d)); }, "d"_a);
+	m.def("kantorovich_sinkhorn",	[](const Metric<double,uint>& d, double reg, double tol, bool log_domain) {
+		return nogil_function(metric::kantorovich_sinkhorn<double,prob>(d, reg, tol, log_domain));
+	}, "d"_a, "reg"_a = 1e-2, "tol"_a = 1e-6, "log_domain"_a = false);
+	m.def("mult_kantorovich",		[](const Metric<double,uint>& d) { return nogil_function(metric::mult_kantorovich<double,prob>(d)); }, "d"_a);
 
 }
@@ -7,20 +7,30 @@ Submodules:
 from .. import typing as t
 from . import optimize as optimize
 
+class defaults():
+    vectorize = True
+
+
 def convex_separation() -> t.Metric[t.ndarray,float]: ...
 
 def convex_separation_quasi() -> t.Metric[t.ndarray,float]: ...
 
 def discrete(type: t.TypeLike = t.def_type) -> t.Metric[t.Any,t.Any]: ...
 
+def discrete_matrix(n_rows: int, n_cols: int = 0) -> t.ndarray: ...
+
 def euclidean(type: t.TypeLike = t.def_type) -> t.Metric[t.Any,t.Any]: ...
 
 def euclidean_chain(type: t.TypeLike = t.def_type) -> t.Metric[t.Any,t.Any]: ...
 
+def euclidean_matrix(n_rows: int, n_cols: int = 0, step: float = 1.0) -> t.ndarray: ...
+
 def from_distance_matrix(M: t.ndarray) -> t.Metric[int,float]: ...
 
 def kantorovich(d: t.Metric[int,float]) -> t.Metric[t.ndarray,float]: ...
 
+def kantorovich_sinkhorn(d: t.Metric[int,float], reg: float = 1e-2, tol: float = 1e-6, log_domain: bool = False) -> t.Metric[t.ndarray,float]: ...
+
 def l1() -> t.Metric[t.ndarray,float]: ...
 
 def l2() -> t.Metric[t.ndarray,float]: ...
@@ -37,13 +47,15 @@ def mult_reals(type: t.TypeLike = t.def_type) -> t.Metric[float,float]: ...
 
 def mult_total_variation() -> t.Metric[t.ndarray,float]: ...
 
+def scalar(d: t.Metric[int,float]) -> t.Metric[int,float]: ...
+
 def scale(d: t.Metric[t.T,t.R], coeff: t.R) -> t.Metric[t.T,t.R]: ...
 
 def threshold(d: t.Metric[t.T,t.R], thres: t.R) -> t.Metric[t.T,t.R]: ...
 
 def threshold_inf(d: t.Metric[t.T,t.R], thres: t.R) -> t.Metric[t.T,t.R]: ...
 
-def to_distance_matrix(d: t.Metric[int,t.R], n_rows: int, n_cols: int) -> t.ndarray: ...
+def to_distance_matrix(d: t.Metric[int,t.R], n_rows: int, n_cols: int = 0, symmetric: bool = False, parallel: bool = False) -> t.ndarray: ...
 
 def total_variation() -> t.Metric[t.ndarray,float]: ...
 
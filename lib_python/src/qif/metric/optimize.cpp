@@ -13,15 +13,19 @@ void init_metric_optimize_module(py::module m) {
 		Metric optimization problems.
 	)pbdoc";
 
-	m.def("l1_diameter",					l1_diameter<double>, "C"_a, "method"_a = "direct");
-	m.def("l1_diameter",					l1_diameter<rat>,    "C"_a, "method"_a = "direct");
+	m.def("l1_diameter",					l1_diameter<double>, "C"_a, "method"_a = "direct", nogil());
+	m.def("l1_diameter",					l1_diameter<rat>,    "C"_a, "method"_a = "direct", nogil());
 
-	m.def("l2_min_enclosing_ball",			l2_min_enclosing_ball<double>, "C"_a);
+	m.def("l1_max_distance",				l1_max_distance<double>, "A"_a, "B"_a, "method"_a = "direct", nogil());
+	m.def("l1_max_distance",				l1_max_distance<rat>,    "A"_a, "B"_a, "method"_a = "direct", nogil());
 
-	m.def("simplex_l1_min_enclosing_ball",	simplex_l1_min_enclosing_ball<double>, "C"_a, "method"_a = "lp", "in_conv_hull"_a = false);
-	m.def("simplex_l1_min_enclosing_ball",	simplex_l1_min_enclosing_ball<rat>,    "C"_a, "method"_a = "lp", "in_conv_hull"_a = false);
+	m.def("l2_min_enclosing_ball",			overload<const chan&>(l2_min_enclosing_ball<double>), "C"_a, nogil());
+	m.def("l2_min_enclosing_ball",			overload<const std::vector<chan>&>(l2_min_enclosing_ball<double>), "Cs"_a, nogil());
 
-	m.def("simplex_project", 				simplex_project<double>, "pi"_a);
-	m.def("simplex_project", 				simplex_project<rat>,    "pi"_a);
+	m.def("simplex_l1_min_enclosing_ball",	simplex_l1_min_enclosing_ball<double>, "C"_a, "method"_a = "auto", "in_conv_hull"_a = false, nogil());
+	m.def("simplex_l1_min_enclosing_ball",	simplex_l1_min_enclosing_ball<rat>,    "C"_a, "method"_a = "auto", "in_conv_hull"_a = false, nogil());
+
+	m.def("simplex_project", 				simplex_project<double>, "pi"_a, nogil());
+	m.def("simplex_project", 				simplex_project<rat>,    "pi"_a, nogil());
 
 }
\ No newline at end of file
@@ -5,9 +5,14 @@ from .. import typing as t
 
 def l1_diameter(C: t.ndarray, method: str = 'direct') -> t.Tuple[t.FloatOrRat, int, int]: ...
 
+def l1_max_distance(A: t.ndarray, B: t.ndarray, method: str = 'direct') -> t.Tuple[t.FloatOrRat, int, int]: ...
+
+@t.overload
 def l2_min_enclosing_ball(C: t.ndarray) -> t.Tuple[float, t.ndarray]: ...
+@t.overload
+def l2_min_enclosing_ball(Cs: t.List[t.ndarray]) -> t.List[t.Tuple[float, t.ndarray]]: ...
 
-def simplex_l1_min_enclosing_ball(C: t.ndarray, method: str = 'lp', in_conv_hull: bool = False) -> t.Tuple[t.FloatOrRat, t.ndarray]: ...
+def simplex_l1_min_enclosing_ball(C: t.ndarray, method: str = 'auto', in_conv_hull: bool = False) -> t.Tuple[t.FloatOrRat, t.ndarray]: ...
 
 def simplex_project(pi: t.ndarray) -> t.ndarray: ...
 
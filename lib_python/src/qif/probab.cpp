@@ -45,4 +45,14 @@ void init_probab_module(py::module m) {
 	m.def("from_grid",  	probab::from_grid<double>, "grid"_a);
 	m.def("from_grid",  	probab::from_grid<rat>,    "grid"_a);
 
+	// binary serialisation (see qif::binary), as 1 x n matrices
+	m.def("save",			[](const std::string& f, const  prob& pi) { binary::save(f, Mat<double>(pi)); }, "filename"_a, "pi"_a);
+	m.def("save",			[](const std::string& f, const rprob& pi) { binary::save(f, Mat<rat>(pi));    }, "filename"_a, "pi"_a);
+
+	m.def("load",			[](const std::string& f) -> py::object {
+		return binary::elem_type(f) == binary::aux::elem_code<rat>()
+			? py::cast(rprob(binary::load<rat>(f)))
+			: py::cast(prob(binary::load<double>(f)));
+	}, "filename"_a);
+
 }
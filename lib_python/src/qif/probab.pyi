@@ -11,12 +11,16 @@ def is_proper(pi: t.ndarray, mrd: t.FloatOrRat = t.def_mrd) -> bool: ...
 
 def is_uniform(pi: t.ndarray, mrd: t.FloatOrRat = t.def_mrd) -> bool: ...
 
+def load(filename: str) -> t.ndarray: ...
+
 def normalize(pi: t.ndarray) -> t.ndarray: ...
 
 def point(n_elem: int, x: int = 0, type: t.TypeLike = t.def_type) -> t.ndarray: ...
 
 def randu(n_elem: int, type: t.TypeLike = t.def_type) -> t.ndarray: ...
 
+def save(filename: str, pi: t.ndarray) -> None: ...
+
 @t.overload
 def sample(pi: t.ndarray) -> int: ...
 @t.overload
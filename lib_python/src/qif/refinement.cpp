@@ -17,10 +17,13 @@ void init_refinement_module(py::module m) {
 	m.def("refined_by",
 		[](const chan& A, const chan& B, std::string method) {
 			if(method == "factorize") {
-				return py::cast(refined_by(A, B));
+				bool res;
+				{ py::gil_scoped_release release; res = refined_by(A, B); }
+				return py::cast(res);
 			} else if(method == "project") {
 				mat G; chan R;
-				bool res = refined_by(A, B, G, R);
+				bool res;
+				{ py::gil_scoped_release release; res = refined_by(A, B, G, R); }
 				return py::cast(std::tuple(res, G, R));
 			} else {
 				throw std::runtime_error("invalid method: " + method);
@@ -31,7 +34,9 @@ void init_refinement_module(py::module m) {
 	m.def("refined_by",
 		[](const rchan& A, const rchan& B, std::string method) {
 			if(method == "factorize") {
-				return py::cast(refined_by(A, B));
+				bool res;
+				{ py::gil_scoped_release release; res = refined_by(A, B); }
+				return py::cast(res);
 			} else if(method == "project") {
 				throw std::runtime_error("project method not available for rat (needs quadratic programming)");
 			} else {
@@ -41,15 +46,42 @@ void init_refinement_module(py::module m) {
 		"A"_a, "B"_a, "method"_a = "factorize"
 	);
 
-	m.def("max_refined_by",  	max_refined_by<double>, "A"_a, "B"_a);
-	m.def("max_refined_by",  	max_refined_by<rat>,    "A"_a, "B"_a);
+	// as a list of lists of bools, res[i][j] == Cs[i] is refined by Cs[j]
+	auto to_lists = [](const arma::umat& M) {
+		std::vector<std::vector<bool>> res(M.n_rows, std::vector<bool>(M.n_cols));
+		for(uint i = 0; i < M.n_rows; i++)
+			for(uint j = 0; j < M.n_cols; j++)
+				res[i][j] = M(i, j);
+		return res;
+	};
+	m.def("order", [to_lists](const std::vector< chan>& Cs) { return to_lists(order(Cs)); }, "Cs"_a, nogil());
+	m.def("order", [to_lists](const std::vector<rchan>& Cs) { return to_lists(order(Cs)); }, "Cs"_a, nogil());
 
-	m.def("priv_refined_by", 	priv_refined_by<double>, "A"_a, "B"_a);
+	// (refined, cls, edges), see Lattice
+	auto lattice_tuple = [to_lists](const Lattice& L) {
+		return std::make_tuple(to_lists(L.refined), arma::conv_to<std::vector<uint>>::from(L.cls), L.edges);
+	};
+	m.def("lattice", [lattice_tuple](const std::vector< chan>& Cs) { return lattice_tuple(lattice(Cs)); }, "Cs"_a, nogil());
+	m.def("lattice", [lattice_tuple](const std::vector<rchan>& Cs) { return lattice_tuple(lattice(Cs)); }, "Cs"_a, nogil());
 
-	m.def("add_metric",      	add_metric<double>, "pi"_a, "A"_a, "B"_a);
-	m.def("add_metric",      	add_metric<rat>,    "pi"_a, "A"_a, "B"_a);
+	m.def("max_refined_by",  	max_refined_by<double>, "A"_a, "B"_a, nogil());
+	m.def("max_refined_by",  	max_refined_by<rat>,    "A"_a, "B"_a, nogil());
 
-	m.def("add_metric_bound",	add_metric_bound<double>, "pi"_a, "A"_a, "B"_a);
-	m.def("add_metric_bound",	add_metric_bound<rat>,    "pi"_a, "A"_a, "B"_a);
+	m.def("priv_refined_by", 	priv_refined_by<double>, "A"_a, "B"_a, nogil());
+
+	m.def("add_metric",      	add_metric<double>, "pi"_a, "A"_a, "B"_a, nogil());
+	m.def("add_metric",      	add_metric<rat>,    "pi"_a, "A"_a, "B"_a, nogil());
+
+	m.def("add_metric_bound",	add_metric_bound<double>, "pi"_a, "A"_a, "B"_a, "max_gap"_a = 0.0, nogil());
+	m.def("add_metric_bound",
+		[](const rprob& pi, const rchan& A, const rchan& B) { return add_metric_bound<rat>(pi, A, B); },
+		"pi"_a, "A"_a, "B"_a, nogil()
+	);
+
+	m.def("add_metric_bounds",	add_metric_bounds<double>, "pi"_a, "pairs"_a, "max_gap"_a = 0.0, nogil());
+	m.def("add_metric_bounds",
+		[](const rprob& pi, const std::vector<std::pair<rchan, rchan>>& pairs) { return add_metric_bounds<rat>(pi, pairs); },
+		"pi"_a, "pairs"_a, nogil()
+	);
 
 }
@@ -6,6 +6,7 @@ from . import typing as t
 # __all__ = [
 #     "add_metric",
 #     "add_metric_bound",
+#     "add_metric_bounds",
 #     "max_refined_by",
 #     "priv_refined_by",
 #     "refined_by"
@@ -18,12 +19,18 @@ def add_metric(pi: t.ndarray, A: t.ndarray, B: t.ndarray) -> t.Tuple[t.rat, t.nd
 # def add_metric(pi: t.ndarray, A: t.ndarray, B: t.ndarray) -> t.Tuple[float, t.ndarray]: ...
 
 # @t.overload
-def add_metric_bound(pi: t.ndarray, A: t.ndarray, B: t.ndarray) -> float: ...
+def add_metric_bound(pi: t.ndarray, A: t.ndarray, B: t.ndarray, max_gap: float = 0.0) -> float: ...
 # @t.overload
 # def add_metric_bound(pi: t.ndarray, A: t.ndarray, B: t.ndarray) -> t.rat: ...
 
+def add_metric_bounds(pi: t.ndarray, pairs: t.List[t.Tuple[t.ndarray, t.ndarray]], max_gap: float = 0.0) -> t.ndarray: ...
+
+def lattice(Cs: t.List[t.ndarray]) -> t.Tuple[t.List[t.List[bool]], t.List[int], t.List[t.Tuple[int, int]]]: ...
+
 def max_refined_by(A: t.ndarray, B: t.ndarray) -> bool: ...
 
+def order(Cs: t.List[t.ndarray]) -> t.List[t.List[bool]]: ...
+
 def priv_refined_by(A: t.ndarray, B: t.ndarray) -> bool: ...
 
 def refined_by(A: t.ndarray, B: t.ndarray, method: str = 'factorize') -> object: ...
@@ -0,0 +1,29 @@
+#include <qif>
+#include "pybind11_aux.h"
+
+namespace py = pybind11;
+using namespace py::literals;
+using namespace qif;
+
+
+void init_trace_module(py::module m) {
+
+	m.doc() = R"pbdoc(
+		Tracing spans of the library's entry points, in the Chrome trace format.
+	)pbdoc";
+
+	m.def("compiled",        &trace::compiled);
+	m.def("enabled",         &trace::enabled);
+	m.def("set_enabled",     &trace::set_enabled, "enabled"_a);
+	m.def("set_buffer_size", &trace::set_buffer_size, "n"_a);
+	m.def("clear",           &trace::clear);
+	m.def("chrome_json",     &trace::chrome_json);
+	m.def("dump",            &trace::dump, "filename"_a, nogil());
+
+	// time spent in C++ by the GIL-releasing functions (see CppTimer), to separate it from the binding overhead
+	m.def("set_cpp_timing",  [](bool enabled) { CppTimer::enabled() = enabled; }, "enabled"_a);
+	m.def("cpp_timing",      []() { return CppTimer::enabled().load(); });
+	m.def("cpp_time",        []() { return double(CppTimer::total_ns().load()) / 1e9; });
+	m.def("cpp_calls",       []() { return CppTimer::calls().load(); });
+	m.def("reset_cpp_time",  []() { CppTimer::total_ns() = 0; CppTimer::calls() = 0; });
+}
@@ -0,0 +1,17 @@
+"""
+Tracing spans of the library's entry points, in the Chrome trace format.
+"""
+
+def compiled() -> bool: ...
+def enabled() -> bool: ...
+def set_enabled(enabled: bool) -> None: ...
+def set_buffer_size(n: int) -> None: ...
+def clear() -> None: ...
+def chrome_json() -> str: ...
+def dump(filename: str) -> None: ...
+
+def set_cpp_timing(enabled: bool) -> None: ...
+def cpp_timing() -> bool: ...
+def cpp_time() -> float: ...
+def cpp_calls() -> int: ...
+def reset_cpp_time() -> None: ...
@@ -8,13 +8,16 @@ from typing import (
 	TypeVar,
 	Any as Any,
 	List as List,
+	Dict as Dict,
 )
-from numpy import ndarray as ndarray, array as array, float64 as double, uint32 as uint
+from numpy import ndarray as ndarray, array as array, float64 as double, float32 as single, uint32 as uint
 from fractions import Fraction as rat
 from . import point as point
 
-TypeLike = Union[Type[double], Type[rat], Type[point], Type[uint]]
+TypeLike = Union[Type[double], Type[single], Type[rat], Type[point], Type[uint]]
 FloatOrRat = Union[float, rat]
+SparseMatrix = Any		# any scipy.sparse matrix (scipy is optional)
+ChanLike = Union[ndarray, SparseMatrix]
 
 R = TypeVar('R')
 T = TypeVar('T')
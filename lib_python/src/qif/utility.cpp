@@ -13,9 +13,21 @@ void init_utility_module(py::module m) {
 		Utility measures.
 	)pbdoc";
 
-	m.def("expected_distance",	overload<const  chan&,              const  prob&,const  chan&>(expected_distance<double>), "D"_a, "pi"_a, "C"_a);
-	m.def("expected_distance",	overload<const Metric<double,uint>&,const  prob&,const  chan&>(expected_distance<double>), "d"_a, "pi"_a, "C"_a);
-	m.def("expected_distance",	overload<const rchan&,              const rprob&,const rchan&>(expected_distance<rat>   ), "D"_a, "pi"_a, "C"_a);
-	m.def("expected_distance",	overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(expected_distance<rat>   ), "d"_a, "pi"_a, "C"_a);
+	// memory-mapped C-ordered channels, without copy (see the MappedChan caster)
+	m.def("expected_distance",	overload<const  chan&,              const  prob&,const channel::MappedChan<double>&>(expected_distance<double>), "D"_a, "pi"_a, "C"_a, nogil());
+	m.def("expected_distance",	overload<const Metric<double,uint>&,const  prob&,const channel::MappedChan<double>&>(expected_distance<double>), "d"_a, "pi"_a, "C"_a, nogil());
+	m.def("expected_distance",	overload<const  chan&,              const  prob&,const  chan&>(expected_distance<double>), "D"_a, "pi"_a, "C"_a, nogil());
+	m.def("expected_distance",	overload<const Metric<double,uint>&,const  prob&,const  chan&>(expected_distance<double>), "d"_a, "pi"_a, "C"_a, nogil());
+	m.def("expected_distance",	overload<const rchan&,              const rprob&,const rchan&>(expected_distance<rat>   ), "D"_a, "pi"_a, "C"_a, nogil());
+	m.def("expected_distance",	overload<const Metric<rat,uint>&,   const rprob&,const rchan&>(expected_distance<rat>   ), "d"_a, "pi"_a, "C"_a, nogil());
+
+
+	// batched version, for a distance matrix D (see measure.bayes_vuln.posterior_many)
+	m.def("expected_distance_many",	[](const  chan& D, const std::vector< prob>& pis, const std::vector< chan>& Cs) {
+		return map_many([&](const  prob& pi, const  chan& C) { return expected_distance(D, pi, C); }, pis, Cs);
+	}, "D"_a, "pis"_a, "Cs"_a);
+	m.def("expected_distance_many",	[](const rchan& D, const std::vector<rprob>& pis, const std::vector<rchan>& Cs) {
+		return map_many([&](const rprob& pi, const rchan& C) { return expected_distance(D, pi, C); }, pis, Cs);
+	}, "D"_a, "pis"_a, "Cs"_a);
 
 }
\ No newline at end of file
@@ -7,3 +7,5 @@ from . import typing as t
 def expected_distance(D: t.ndarray, pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
 @t.overload
 def expected_distance(d: t.Metric[int, t.FloatOrRat], pi: t.ndarray, C: t.ndarray) -> t.FloatOrRat: ...
+
+def expected_distance_many(D: t.ndarray, pis: t.List[t.ndarray], Cs: t.List[t.ndarray]) -> t.List[t.FloatOrRat]: ...
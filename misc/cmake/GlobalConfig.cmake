@@ -65,6 +65,38 @@ if(NOT ${LIB_GLPK} STREQUAL "LIB_GLPK-NOTFOUND")
 	set(QIF_USE_GLPK 1)										# this will be used in qif_bits/config.h
 endif()
 
+# CUDA (optional GPU backend, see qif_bits/gpu.h), off by default, enable with -DQIF_CUDA=ON. Needs both the toolkit
+# (cuBLAS) and a CUDA compiler, and CMake 3.17 for find_package(CUDAToolkit) and the CUDA:: targets. The kernels are
+# built for CMAKE_CUDA_ARCHITECTURES, 60 (Pascal) unless given
+option(QIF_CUDA "Build the CUDA backend" OFF)
+if(QIF_CUDA)
+	if(${CMAKE_VERSION} VERSION_LESS "3.17.0")
+		message(FATAL_ERROR "QIF_CUDA needs CMake 3.17 or later")
+	endif()
+	if(POLICY CMP0104)
+		cmake_policy(SET CMP0104 NEW)						# CMAKE_CUDA_ARCHITECTURES is used (3.18+)
+	endif()
+	if(NOT CMAKE_CUDA_ARCHITECTURES)
+		set(CMAKE_CUDA_ARCHITECTURES 60)
+	endif()
+
+	include(CheckLanguage)
+	check_language(CUDA)
+	find_package(CUDAToolkit)
+	if(CMAKE_CUDA_COMPILER AND CUDAToolkit_FOUND)
+		message(STATUS "Found CUDA: ${CUDAToolkit_VERSION}")
+		set(QIF_USE_CUDA 1)									# this will be used in qif_bits/config.h
+	else()
+		message(FATAL_ERROR "QIF_CUDA is set but no CUDA compiler/toolkit was found")
+	endif()
+endif()
+
+# tracing spans (see qif_bits/trace.h), off by default
+option(QIF_TRACE "Compile tracing spans in the library's entry points" OFF)	# this will be used in qif_bits/config.h
+if(QIF_TRACE)
+	message(STATUS "Tracing spans enabled")
+endif()
+
 # Macros
 MACRO(SUBDIRLIST result curdir)
 	FILE(GLOB children RELATIVE ${curdir} ${curdir}/*)
@@ -144,10 +144,11 @@ void repeated_runs() {
 	Chan<T> C = crowds_matrix(honest, corrupted, pf);
 	double pstop = 0.4;
 
-	uint n = 1;
+	uint n = 2;
 	cout << "channel " << C.n_rows << " x " << C.n_cols << "\n";
 	cout << "capacity of single run " <<  bayes_vuln::mult_capacity(C) << "\n";
-//	cout << "real capacity for " << n << " runs: " << bayes_vuln::mult_capacity(channel::comp::repeated_independent(C, n)) << "\n";
+	// the outputs of the n runs are grouped by type, giving binomial(n+100, 100) columns instead of 101^n
+	cout << "real capacity for " << n << " runs: " << bayes_vuln::mult_capacity(channel::compose::repeated_independent_types(C, n)) << "\n";
 	cout << "comp bound for " << n << " runs: " << n * bayes_vuln::mult_capacity(C) << "\n";
 	cout << "cap_b bound for " << n << " runs: " << bayes_vuln::mult_capacity_bound_cap(C, n) << "\n";
 	cout << "limit bound for pstop " << pstop << ": " << bayes_vuln::mult_capacity(C) / pstop << "\n";
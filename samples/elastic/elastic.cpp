@@ -83,10 +83,7 @@ void compute_elastic_privacy(string area, string dataset, string priv_metric) {
 			dist.load("marco/metric/"+area+".dat");
 			dist.save("temp/metric-"+area+".bin");
 		}
-		Metric<double, uint> d = metric::from_distance_matrix(dist);
-
-
-		elastic = mechanism::d_privacy::exponential(dist.n_rows, d);
+		elastic = mechanism::d_privacy::exponential(dist);
 		elastic.save("temp/elastic-"+area+".bin");
 
 		dist.reset();
@@ -125,12 +122,8 @@ void compute_elastic_privacy(string area, string dataset, string priv_metric) {
 void compute_laplace_privacy(string area, string dataset, string priv_metric, double eps) {
 	string areadataset = area + "-" + dataset;
 
-	chan laplace;
-	if(!laplace.load("temp/laplace-"+std::to_string(eps)+".bin")) {
-
-		laplace = mechanism::geo_ind::planar_laplace_grid<double>(grid_size, grid_size, cell_width, eps);
-		laplace.save("temp/laplace-"+std::to_string(eps)+".bin");
-	}
+	mechanism::memo::set_dir("temp");
+	chan laplace = mechanism::memo::planar_laplace_grid<double>(grid_size, grid_size, cell_width, eps);
 	uint n = laplace.n_rows;
 
 
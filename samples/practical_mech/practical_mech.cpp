@@ -78,8 +78,7 @@ void print_mech(string name, const chan& C, const prob& pi_global, mat& priors,
 	cout << ": " << arma::mean(errors) << ", " << arma::median(errors);
 	cout << "\n";
 
-	chan R = channel::deterministic<double>(l_risk::strategy(Loss, pi_global, C), Loss.n_rows);
-	chan CR = C * R;
+	chan CR = channel::remap(C, l_risk::strategy(Loss, pi_global, C), Loss.n_rows);
 
 	cout << name << " with remap";
 	for(uint i = 0; i < priors.n_rows; i++) {
@@ -97,12 +96,20 @@ void print_mech2(string name, const chan& C, const probdict& globals, mat& prior
 		return;
 	}
 
-	for(auto g : globals) {
+	// the remap strategies of all non-empty global priors, in one batch
+	mat global_priors;
+	for(auto& g : globals)
+		if(!g.second.is_empty())
+			global_priors.insert_rows(global_priors.n_rows, g.second);
+	arma::umat strategies = global_priors.is_empty() ? arma::umat() : l_risk::strategies(Loss, global_priors, C);
+
+	uint k = 0;
+	for(auto& g : globals) {
 		cout << "# " << name << "-" << g.first << "\n";
 
 		chan M = g.second.is_empty()
 			? C
-			: C * channel::deterministic<double>(l_risk::strategy(Loss, g.second, C), Loss.n_rows);
+			: channel::remap(C, strategies.col(k++), Loss.n_rows);
 
 		for(uint i = 0; i < priors.n_rows; i++) {
 			prob pi = priors.row(i);
@@ -43,8 +43,8 @@ int main(int argc, char** argv) {
 
 	// compute remap and print
 	//
-	chan R = channel::deterministic<double>(l_risk::strategy(L, pi, C), L.n_rows);
-	chan CR = C * R;
+	channel::DetChan<double> R(l_risk::strategy(L, pi, C), L.n_rows);
+	chan CR = channel::compose::cascade(C, R);
 
 	cout.setf(std::ios::fixed);
 	cout.precision(6);
@@ -20,14 +20,18 @@ class LinearProgramTest : public BaseTest<eT> {
 			#else
 				std::cerr << "\nGLPK not found, skipping GLPK tests\n\n";
 			#endif
+			#if defined(QIF_USE_ORTOOLS) || defined(QIF_USE_GLPK)
+				solvers.push_back(Solver::HYBRID);
+			#endif
 
 			for(string method : { Method::SIMPLEX_PRIMAL, Method::SIMPLEX_DUAL, Method::INTERIOR }) {
 			for(string solver : solvers) {
 			for(bool presolve : { false, true }) {
 				// some combinations are not valid
 				if(method == Method::INTERIOR && (presolve || solver == Solver::GLOP || solver == Solver::CLP)) continue; // interior: no presolver, no GLOP support, unstable with CLP
-				if(solver == Solver::INTERNAL && (presolve || method != Method::SIMPLEX_PRIMAL)               ) continue; // internal solver: only simplex_primal/no presolve
-				if(this->is_rat               && solver != Solver::INTERNAL                                   ) continue; // rat: only internal solver
+				if(solver == Solver::INTERNAL && method == Method::INTERIOR && this->is_rat                     ) continue; // internal solver: interior only for floats
+				if(solver == Solver::HYBRID   && (method != Method::SIMPLEX_PRIMAL || !this->is_rat)            ) continue; // hybrid: only for rat, falls back to internal
+				if(this->is_rat               && solver != Solver::INTERNAL && solver != Solver::HYBRID       ) continue; // rat: only internal/hybrid solver
 
 				combs.push_back(std::tuple(method, solver, presolve));
 			}}}
@@ -181,7 +185,7 @@ TYPED_TEST_P(LinearProgramTest, Unbounded) {
 		// EXTRA conditions only for unbounded
 		if(lp.solver == Solver::GLOP || lp.solver == Solver::CLP) continue; // OR-tools/DUAL seems unstable with unbounded problems (TODO: investigae)
 
-		auto status = lp.solver != Solver::GLPK || (lp.method == Method::SIMPLEX_PRIMAL && !lp.presolve)
+		auto status = lp.presolve || (lp.solver != Solver::GLPK && lp.method != Method::INTERIOR) || (lp.method == Method::SIMPLEX_PRIMAL && !lp.presolve)
 				? Status::UNBOUNDED
 				: Status::INFEASIBLE_OR_UNBOUNDED;	// sometimes we just know that the problem is infeasible OR unbounded
 
@@ -199,7 +203,818 @@ TYPED_TEST_P(LinearProgramTest, Unbounded) {
 }
 
 
-REGISTER_TYPED_TEST_SUITE_P(LinearProgramTest, Optimal, Infeasible, Unbounded);
+TYPED_TEST_P(LinearProgramTest, WarmStart) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	for(auto comb : t.combs) {
+		// the same program solved for various bounds of the first constraint, modified in place and warm-started
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+		lp.warm_start = true;
+
+		lp.from_matrix(format_num<eT>("1 2; 3 1"), format_num<eT>("1 2"), format_num<eT>("0.6 0.5"));
+
+		for(eT b : { eT(1), eT(3)/2, eT(1)/2, eT(2), eT(1) }) {
+			lp.set_con_bounds(0, -infinity<eT>(), b);
+			EXPECT_TRUE(lp.solve());
+
+			LinearProgram<eT> fresh;
+			std::tie(fresh.method, fresh.solver, fresh.presolve) = comb;
+			fresh.from_matrix(format_num<eT>("1 2; 3 1"), Col<eT>({ b, eT(2) }), format_num<eT>("0.6 0.5"));
+			EXPECT_TRUE(fresh.solve());
+
+			EXPECT_PRED_FORMAT4(equal4<eT>, fresh.objective(), lp.objective(), md, mrd);
+			EXPECT_PRED_FORMAT4(chan_equal4<eT>, fresh.solution(), lp.solution(), md, mrd);
+		}
+
+		// adding a constraint after a solve
+		auto con = lp.make_con(-infinity<eT>(), eT(1)/10);
+		lp.set_con_coeff(con, 1, eT(1));
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(1)/10, lp.solution(1), md, mrd);
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, CoeffUpdates) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	for(auto comb : t.combs) {
+		// max x0 + 2 x1  s.t.  x0 + x1 <= 1, with coefficients overwritten/added before and after solving
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+
+		auto x = lp.make_vars(2, eT(0), infinity<eT>());
+		auto con = lp.make_con(-infinity<eT>(), eT(1));
+		lp.set_obj_coeff(x[0], eT(1));
+		lp.set_obj_coeff(x[1], eT(2));
+		lp.set_con_coeff(con, x[1], eT(1)/2);
+		lp.set_con_coeff(con, x[0], eT(5));
+		lp.set_con_coeff(con, x[0], eT(1));				// overwrite
+		lp.set_con_coeff(con, x[1], eT(1)/2, true);		// add
+
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(2), lp.objective(), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), lp.solution(x[1]), md, mrd);
+
+		// x0 + 4 x1 <= 1, now x0 is better
+		lp.set_con_coeff(con, x[1], eT(3), true);
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), lp.objective(), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), lp.solution(x[0]), md, mrd);
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, InternalPricing) {
+	typedef TypeParam eT;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	// 4x4 assignment problem, highly degenerate
+	Mat<eT> cost(format_num<eT>("4 1 3 2; 2 0 5 3; 3 2 2 1; 4 3 1 2"));
+
+	for(string pricing : { Pricing::BLAND, Pricing::DEVEX }) {
+		LinearProgram<eT> lp;
+		lp.solver = Solver::INTERNAL;
+		lp.pricing = pricing;
+		lp.maximize = false;
+
+		auto x = lp.make_vars(4, 4, eT(0), infinity<eT>());
+		for(uint i = 0; i < 4; i++) {
+			auto row = lp.make_con(eT(1), eT(1));
+			auto col = lp.make_con(eT(1), eT(1));
+			for(uint j = 0; j < 4; j++) {
+				lp.set_obj_coeff(x[i][j], cost(i, j));
+				lp.set_con_coeff(row, x[i][j], eT(1));
+				lp.set_con_coeff(col, x[j][i], eT(1));
+			}
+		}
+
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, InternalBounded) {
+	typedef TypeParam eT;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	for(string method : { Method::SIMPLEX_PRIMAL, Method::SIMPLEX_DUAL }) {
+		// the assignment problem with x in [0,1], upper bounds are not active at the optimum
+		Mat<eT> cost(format_num<eT>("4 1 3 2; 2 0 5 3; 3 2 2 1; 4 3 1 2"));
+
+		LinearProgram<eT> lp;
+		lp.solver = Solver::INTERNAL;
+		lp.method = method;
+		lp.maximize = false;
+
+		auto x = lp.make_vars(4, 4, eT(0), eT(1));
+		for(uint i = 0; i < 4; i++) {
+			auto row = lp.make_con(eT(1), eT(1));
+			auto col = lp.make_con(eT(1), eT(1));
+			for(uint j = 0; j < 4; j++) {
+				lp.set_obj_coeff(x[i][j], cost(i, j));
+				lp.set_con_coeff(row, x[i][j], eT(1));
+				lp.set_con_coeff(col, x[j][i], eT(1));
+			}
+		}
+
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+
+		// max x + 2y + z,  x + y + z <= 2,  1 <= x + z <= 3 (ranged),  x in [0,1], y in [0,1/2], z in [-1,1]
+		lp.clear();
+		lp.method = method;
+		lp.maximize = true;
+		auto v = lp.make_vars(3, eT(0), eT(1));
+		lp.set_var_bounds(v[1], eT(0), eT(1)/eT(2));
+		lp.set_var_bounds(v[2], eT(-1), eT(1));
+		lp.set_obj_coeff(v[0], eT(1));
+		lp.set_obj_coeff(v[1], eT(2));
+		lp.set_obj_coeff(v[2], eT(1));
+		auto c1 = lp.make_con(-infinity<eT>(), eT(2));
+		auto c2 = lp.make_con(eT(1), eT(3));
+		for(uint i = 0; i < 3; i++)
+			lp.set_con_coeff(c1, v[i], eT(1));
+		lp.set_con_coeff(c2, v[0], eT(1));
+		lp.set_con_coeff(c2, v[2], eT(1));
+
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(5)/eT(2), lp.objective(), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(1)/eT(2), lp.solution(v[1]), md, mrd);
+
+		// infeasible because of the bounds,  x + y >= 3,  x, y in [0,1]
+		lp.clear();
+		lp.method = method;
+		lp.maximize = false;
+		auto w = lp.make_vars(2, eT(0), eT(1));
+		lp.set_obj_coeff(w[0], eT(1));
+		auto c = lp.make_con(eT(3), infinity<eT>());
+		lp.set_con_coeff(c, w[0], eT(1));
+		lp.set_con_coeff(c, w[1], eT(1));
+
+		EXPECT_FALSE(lp.solve());
+		EXPECT_EQ(Status::INFEASIBLE, lp.status);
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, InternalRandom) {
+	typedef TypeParam eT;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	// random programs with boxed variables and ranged constraints, integer data so that the same program can be
+	// solved exactly. Boxed variables mean no program is unbounded, some are infeasible. Both simplex methods
+	// should agree with the exact solution of the primal simplex in rat.
+	std::mt19937 gen(42);
+	auto rand_int = [&](int a, int b) { return std::uniform_int_distribution<int>(a, b)(gen); };
+
+	for(uint trial = 0; trial < 50; trial++) {
+		uint n = rand_int(2, 6), m = rand_int(1, 5);
+
+		std::vector<int> var_lb(n), var_ub(n), obj(n), con_lb(m), con_ub(m);
+		std::vector<std::vector<int>> A(m, std::vector<int>(n));
+		for(uint j = 0; j < n; j++) {
+			var_lb[j] = rand_int(-2, 1);
+			var_ub[j] = var_lb[j] + rand_int(0, 3);
+			obj[j] = rand_int(-3, 3);
+		}
+		for(uint i = 0; i < m; i++) {
+			for(uint j = 0; j < n; j++)
+				A[i][j] = rand_int(-3, 3);
+			con_lb[i] = rand_int(-4, 2);
+			con_ub[i] = con_lb[i] + rand_int(0, 4);
+		}
+		bool maximize = rand_int(0, 1);
+
+		auto build = [&](auto& lp) {
+			typedef std::decay_t<decltype(lp.objective())> T;
+			lp.clear();
+			lp.solver = Solver::INTERNAL;
+			lp.maximize = maximize;
+			auto x = lp.make_vars(n);
+			for(uint j = 0; j < n; j++) {
+				lp.set_var_bounds(x[j], T(var_lb[j]), T(var_ub[j]));
+				lp.set_obj_coeff(x[j], T(obj[j]));
+			}
+			for(uint i = 0; i < m; i++) {
+				// some rows are one-sided, the rest ranged or equalities
+				int kind = rand_int(0, 3);
+				auto c = lp.make_con(kind == 0 ? -infinity<T>() : T(con_lb[i]), kind == 1 ? infinity<T>() : T(con_ub[i]));
+				for(uint j = 0; j < n; j++)
+					if(A[i][j] != 0)
+						lp.set_con_coeff(c, x[j], T(A[i][j]));
+			}
+		};
+
+		// the exact reference, the generator is re-seeded so that each build sees the same row kinds
+		auto seed = gen();
+		LinearProgram<rat> ref;
+		gen.seed(seed);
+		build(ref);
+		ref.method = Method::SIMPLEX_PRIMAL;
+		bool ref_solved = ref.solve();
+		ASSERT_NE(Status::UNBOUNDED, ref.status);
+
+		for(string method : { Method::SIMPLEX_PRIMAL, Method::SIMPLEX_DUAL }) {
+			LinearProgram<eT> lp;
+			gen.seed(seed);
+			build(lp);
+			lp.method = method;
+
+			EXPECT_EQ(ref_solved, lp.solve()) << "trial " << trial << ", " << method;
+			EXPECT_EQ(ref.status, lp.status) << "trial " << trial << ", " << method;
+			if(ref_solved && lp.status == Status::OPTIMAL)
+				EXPECT_PRED_FORMAT4(equal4<eT>, static_cast<eT>(ref.objective()), lp.objective(), md, mrd);
+		}
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, InternalInterior) {
+	typedef TypeParam eT;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	// the assignment problem has many optimal solutions, the interior point converges to the middle of the optimal
+	// face and crossover should give a vertex, ie a permutation matrix
+	Mat<eT> cost(format_num<eT>("4 1 3 2; 2 0 5 3; 3 2 2 1; 4 3 1 2"));
+
+	LinearProgram<eT> lp;
+	lp.solver = Solver::INTERNAL;
+	lp.method = Method::INTERIOR;
+	lp.maximize = false;
+
+	auto x = lp.make_vars(4, 4, eT(0), eT(1));
+	for(uint i = 0; i < 4; i++) {
+		auto row = lp.make_con(eT(1), eT(1));
+		auto col = lp.make_con(eT(1), eT(1));
+		for(uint j = 0; j < 4; j++) {
+			lp.set_obj_coeff(x[i][j], cost(i, j));
+			lp.set_con_coeff(row, x[i][j], eT(1));
+			lp.set_con_coeff(col, x[j][i], eT(1));
+		}
+	}
+
+	if(this->is_rat) {
+		EXPECT_THROW(lp.solve(), std::runtime_error);	// only for floats
+		return;
+	}
+
+	EXPECT_TRUE(lp.solve());
+	EXPECT_EQ(Status::OPTIMAL, lp.status);
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+	for(uint i = 0; i < 4; i++)
+		for(uint j = 0; j < 4; j++)
+			EXPECT_TRUE(qif::equal(lp.solution(x[i][j]), eT(0), md, mrd) || qif::equal(lp.solution(x[i][j]), eT(1), md, mrd));
+
+	// free and upper-bounded variables, ranged constraint:  min x - y + 2z,  x - y >= -1,  1 <= y + z <= 4,
+	// x free, y <= 3, z in [0, 2]
+	lp.clear();
+	lp.maximize = false;
+	auto v = lp.make_vars(3);
+	lp.set_var_bounds(v[1], -infinity<eT>(), eT(3));
+	lp.set_var_bounds(v[2], eT(0), eT(2));
+	lp.set_obj_coeff(v[0], eT(1));
+	lp.set_obj_coeff(v[1], eT(-1));
+	lp.set_obj_coeff(v[2], eT(2));
+	auto c1 = lp.make_con(eT(-1), infinity<eT>());
+	auto c2 = lp.make_con(eT(1), eT(4));
+	lp.set_con_coeff(c1, v[0], eT(1));
+	lp.set_con_coeff(c1, v[1], eT(-1));
+	lp.set_con_coeff(c2, v[1], eT(1));
+	lp.set_con_coeff(c2, v[2], eT(1));
+
+	// x - y is at least -1, z = 0
+	EXPECT_TRUE(lp.solve());
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(-1), lp.objective(), md, mrd);
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(0), lp.solution(v[2]), md, mrd);
+}
+
+TYPED_TEST_P(LinearProgramTest, Presolve) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+	eT inf = infinity<eT>();
+
+	for(auto comb : t.combs) {
+		// max x0 + x1 + 2 x2 - x3 + x4 with every kind of reduction:
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+		if(!lp.presolve) continue;
+
+		auto x = lp.make_vars(6, eT(0), inf);
+		lp.set_var_bounds(x[3], eT(1), eT(1));			// fixed
+		lp.set_obj_coeff(x[0], eT(1));
+		lp.set_obj_coeff(x[1], eT(1));
+		lp.set_obj_coeff(x[2], eT(2));
+		lp.set_obj_coeff(x[3], eT(-1));
+		lp.set_obj_coeff(x[4], eT(1));
+		lp.set_var_bounds(x[4], eT(0), eT(3));			// in no constraint, goes to its upper bound
+		lp.set_var_bounds(x[5], eT(-1), eT(2));			// in no constraint, no cost
+
+		auto c = lp.make_con(-inf, eT(4));				// x0 + x1 + x2 <= 4
+		for(uint i = 0; i < 3; i++)
+			lp.set_con_coeff(c, x[i], eT(1));
+		c = lp.make_con(-inf, eT(6));					// duplicate: 2x0 + 2x1 + 2x2 <= 6
+		for(uint i = 0; i < 3; i++)
+			lp.set_con_coeff(c, x[i], eT(2));
+		c = lp.make_con(eT(-1), eT(1));					// x2 + x3 in [-1, 1], a singleton after substituting x3
+		lp.set_con_coeff(c, x[2], eT(1));
+		lp.set_con_coeff(c, x[3], eT(1));
+		c = lp.make_con(-inf, eT(100));					// redundant by the activity bounds: x2 - x3 <= 100
+		lp.set_con_coeff(c, x[2], eT(1));
+		lp.set_con_coeff(c, x[3], eT(-1));
+		c = lp.make_con(eT(0), eT(0));					// empty
+		lp.set_con_coeff(c, x[0], eT(0));
+
+		EXPECT_TRUE(lp.solve());
+		EXPECT_EQ(Status::OPTIMAL, lp.status);
+
+		// x2 <= 0 after substituting x3 = 1, so x0 + x1 = 3 and the objective is 3 + 0 - 1 + 3
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(3), lp.solution(x[0]) + lp.solution(x[1]), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(0), lp.solution(x[2]), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), lp.solution(x[3]), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(3), lp.solution(x[4]), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(0), lp.solution(x[5]), md, mrd);
+
+		// the same without presolve
+		eT obj = lp.objective();
+		lp.presolve = false;
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, obj, lp.objective(), md, mrd);
+
+		// infeasible: conflicting duplicate constraints, found by the presolve
+		lp.presolve = true;
+		c = lp.make_con(-inf, eT(-7));					// -x0 - x1 - x2 <= -7
+		for(uint i = 0; i < 3; i++)
+			lp.set_con_coeff(c, x[i], eT(-1));
+		EXPECT_FALSE(lp.solve());
+		EXPECT_EQ(Status::INFEASIBLE, lp.status);
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, Mps) {
+	typedef TypeParam eT;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+	eT inf = infinity<eT>();
+
+	// max x0 + x1 + 2 x2 - x3 + x4 with ranged, >=, = constraints and fixed/negative bounds
+	LinearProgram<eT> lp;
+	lp.solver = Solver::INTERNAL;
+	auto x = lp.make_vars(5, eT(0), inf);
+	lp.set_var_bounds(x[3], eT(1), eT(1));
+	lp.set_var_bounds(x[4], -inf, eT(2));
+	lp.set_obj_coeff(x[0], eT(1));
+	lp.set_obj_coeff(x[1], eT(1));
+	lp.set_obj_coeff(x[2], eT(2));
+	lp.set_obj_coeff(x[3], eT(-1));
+	lp.set_obj_coeff(x[4], eT(1));
+
+	auto c = lp.make_con(-inf, eT(4));				// x0 + x1 + x2 <= 4
+	for(uint i = 0; i < 3; i++)
+		lp.set_con_coeff(c, x[i], eT(1));
+	c = lp.make_con(eT(-1), eT(1));					// x2 + x3 in [-1, 1]
+	lp.set_con_coeff(c, x[2], eT(1));
+	lp.set_con_coeff(c, x[3], eT(1));
+	c = lp.make_con(eT(-1), inf);					// x0 - x4 >= -1
+	lp.set_con_coeff(c, x[0], eT(1));
+	lp.set_con_coeff(c, x[4], eT(-1));
+	c = lp.make_con(eT(3)/2, eT(3)/2);				// x1 = 1.5
+	lp.set_con_coeff(c, x[1], eT(1));
+
+	EXPECT_TRUE(lp.solve());
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+
+	std::stringstream mps;
+	lp.write_mps(mps);
+	EXPECT_EQ(mps.str(), lp.to_mps());
+
+	LinearProgram<eT> lp2;
+	lp2.solver = Solver::INTERNAL;
+	lp2.read_mps(mps);
+	EXPECT_TRUE(lp2.maximize);
+	EXPECT_TRUE(lp2.solve());
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp2.objective(), md, mrd);
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, lp.solution(), lp2.solution(), md, mrd);
+
+	std::stringstream lpf;
+	lp.write_lp(lpf);
+	EXPECT_NE(string::npos, lpf.str().find("Subject To"));
+	EXPECT_NE(string::npos, lpf.str().find("R2_ub:"));		// the ranged row
+
+	std::istringstream bad("ROWS\n N OBJ\nCOLUMNS\n    MARKER 'MARKER' 'INTORG'\n");
+	EXPECT_ANY_THROW(lp2.read_mps(bad));
+
+	// solutions of external solvers, first value wins, missing ones are 0
+	namespace SF = SolutionFormat;
+	std::istringstream highs("Model status\nOptimal\n# Columns 5\nX1 2.5\nX2 1.5\nX4 1\nX5 2\n# Dual solution values\nX1 7\n");
+	EXPECT_TRUE(lp.read_solution(highs, SF::HIGHS));
+	EXPECT_EQ(Status::OPTIMAL, lp.status);
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, format_num<eT>("2.5; 1.5; 0; 1; 2"), lp.solution(), md, mrd);
+
+	std::istringstream cbc("Infeasible - objective value 0.00000000\n");
+	EXPECT_FALSE(lp.read_solution(cbc, SF::CBC));
+	EXPECT_EQ(Status::INFEASIBLE, lp.status);
+
+	// stopped by a time limit: not optimal, the values are kept as a feasible solution
+	std::istringstream highs_tl("Model status\nTime limit reached\n# Primal solution values\nFeasible\nX1 2\nX2 1.5\n");
+	EXPECT_FALSE(lp.read_solution(highs_tl, SF::HIGHS));
+	EXPECT_EQ(Status::INTERRUPTED, lp.status);
+	EXPECT_TRUE(lp.has_solution());
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, format_num<eT>("2; 1.5; 0; 0; 0"), lp.solution(), md, mrd);
+
+	std::istringstream cbc_tl("Stopped on time - objective value 4.50000000\n      0 X1 2 0\n");
+	EXPECT_FALSE(lp.read_solution(cbc_tl, SF::CBC));
+	EXPECT_EQ(Status::INTERRUPTED, lp.status);
+
+	std::istringstream gurobi("# Objective value = 5\nX1 2.5\nX2 1.5\nX4 1\nX5 2\n");
+	EXPECT_TRUE(lp.read_solution(gurobi, SF::PLAIN));
+	EXPECT_EQ(Status::OPTIMAL, lp.status);
+
+	// the status comes only from where the format puts it, not from words elsewhere in the file
+	std::istringstream highs_words("Model status\nOptimal\n# Columns 5\nX1 2.5\n# Rows 2\ninfeasible 0\n");
+	EXPECT_TRUE(lp.read_solution(highs_words, SF::HIGHS));
+	std::istringstream plain_words("# unbounded, infeasible, time limit\nX1 2.5\n");
+	EXPECT_TRUE(lp.read_solution(plain_words, SF::PLAIN));
+	std::istringstream cbc_words("Optimal - objective value 5\n      0 X1 2.5 0\n      1 infeasible 1 0\n");
+	EXPECT_TRUE(lp.read_solution(cbc_words, SF::CBC));
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(2.5), lp.solution(0), md, mrd);
+	std::istringstream bad_plain("X1 2.5 7\n");
+	EXPECT_ANY_THROW(lp.read_solution(bad_plain, SF::PLAIN));
+	EXPECT_ANY_THROW(lp.read_solution(gurobi, "SOMETHING"));
+
+	// the format follows the command
+	lp.external_command = "/opt/bin/highs --model_file {model}";
+	EXPECT_EQ(SF::HIGHS, lp.solution_format());
+	lp.external_command = "cbc {model} solve solu {solution}";
+	EXPECT_EQ(SF::CBC, lp.solution_format());
+	lp.external_command = "gurobi_cl ResultFile={solution} {model}";
+	EXPECT_EQ(SF::PLAIN, lp.solution_format());
+	lp.external_format = SF::HIGHS;
+	EXPECT_EQ(SF::HIGHS, lp.solution_format());
+	lp.external_format = SF::AUTO;
+
+	#ifndef _WIN32
+	lp.solver = Solver::EXTERNAL;
+	lp.presolve = false;
+	lp.external_command = "printf 'X1 2.5\\nX2 1.5\\nX4 1\\nX5 2\\n' > {solution}";
+	EXPECT_TRUE(lp.solve());
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+
+	// the temporary paths are quoted, a TMPDIR with spaces and metacharacters works
+	namespace fs = std::filesystem;
+	const char* old_tmp = std::getenv("TMPDIR");
+	const string prev_tmp = old_tmp ? old_tmp : "";
+	const fs::path odd_tmp = fs::temp_directory_path() / "qif tmp;$(false) 'x'";
+	fs::create_directories(odd_tmp);
+	setenv("TMPDIR", odd_tmp.c_str(), 1);
+	lp.external_command = "test -f {model} && printf 'X1 2.5\\nX2 1.5\\nX4 1\\nX5 2\\n' > {solution}";
+	EXPECT_TRUE(lp.solve());
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+	if(old_tmp)
+		setenv("TMPDIR", prev_tmp.c_str(), 1);
+	else
+		unsetenv("TMPDIR");
+	fs::remove_all(odd_tmp);
+
+	// a malformed file is an error
+	lp.external_command = "printf 'X1 2.5 7\\n' > {solution}";
+	EXPECT_FALSE(lp.solve());
+	EXPECT_EQ(Status::ERROR, lp.status);
+
+	lp.external_command = "exit 1";
+	EXPECT_FALSE(lp.solve());
+	EXPECT_EQ(Status::ERROR, lp.status);
+	#endif
+}
+
+TYPED_TEST_P(LinearProgramTest, ParallelCons) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	// 4x4 assignment problem, block b creates the constraints of row b and column b
+	Mat<eT> cost(format_num<eT>("4 1 3 2; 2 0 5 3; 3 2 2 1; 4 3 1 2"));
+
+	for(auto comb : t.combs) {
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+		lp.maximize = false;
+
+		auto x = lp.make_vars(4, 4, eT(0), infinity<eT>());
+		for(uint i = 0; i < 4; i++)
+			for(uint j = 0; j < 4; j++)
+				lp.set_obj_coeff(x[i][j], cost(i, j));
+
+		auto first = lp.make_cons_parallel(4, [&](uint b, auto& block) {
+			auto row = block.make_con(eT(1), eT(1));
+			auto col = block.make_con(eT(1), eT(1));
+			for(uint k = 0; k < 4; k++) {
+				block.set_con_coeff(row, x[b][k], eT(1));
+				block.set_con_coeff(col, x[k][b], eT(1));
+			}
+		});
+		EXPECT_EQ(std::vector<uint>({ 0, 2, 4, 6 }), first);
+
+		EXPECT_TRUE(lp.solve());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(5), lp.objective(), md, mrd);
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, Instrument) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	for(auto comb : t.combs) {
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+		lp.instrument = true;
+
+		lp.from_matrix(format_num<eT>("1 2; 3 1"), format_num<eT>("1 2"), format_num<eT>("0.6 0.5"));
+		EXPECT_TRUE(lp.solve());
+
+		const Stats& st = lp.stats;
+		EXPECT_EQ(Status::OPTIMAL, st.status);
+		EXPECT_EQ(lp.solver, st.solver);
+		EXPECT_EQ(2u, st.n_var);
+		EXPECT_EQ(2u, st.n_con);
+		EXPECT_EQ(4u, st.nnz);
+		EXPECT_LE(0, st.build);
+		EXPECT_LE(0, st.solve);
+		EXPECT_LE(st.solve, st.total());
+		if(lp.method != Method::INTERIOR)
+			EXPECT_LE(0, st.iterations);
+		EXPECT_LT(0u, st.memory.build);
+		EXPECT_LE(st.memory.build, st.memory.peak());
+
+		// programs built internally are only accessible through last_stats
+		Stats last = last_stats();
+		EXPECT_EQ(st.n_var, last.n_var);
+		EXPECT_EQ(st.total(), last.total());
+	}
+
+	// not instrumented by default
+	LinearProgram<eT> lp;
+	lp.from_matrix(format_num<eT>("1 2; 3 1"), format_num<eT>("1 2"), format_num<eT>("0.6 0.5"));
+	EXPECT_TRUE(lp.solve());
+	EXPECT_EQ("", lp.stats.status);
+}
+
+TYPED_TEST_P(LinearProgramTest, Limits) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+	eT inf = infinity<eT>();
+
+	// max sum (i+1) x_i  s.t.  x_i + x_{i+1} <= 1, x >= 0. Optimal value 12.
+	auto build = [&](LinearProgram<eT>& lp) {
+		auto x = lp.make_vars(6, eT(0), inf);
+		for(uint i = 0; i < 6; i++)
+			lp.set_obj_coeff(x[i], eT(i + 1));
+		for(uint i = 0; i + 1 < 6; i++) {
+			auto c = lp.make_con(-inf, eT(1));
+			lp.set_con_coeff(c, x[i], eT(1));
+			lp.set_con_coeff(c, x[i+1], eT(1));
+		}
+		return x;
+	};
+
+	for(auto comb : t.combs) {
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+		build(lp);
+
+		// cancelled before starting
+		lp.cancel = CancelToken::create();
+		lp.cancel.cancel();
+		EXPECT_FALSE(lp.solve());
+		EXPECT_EQ(Status::INTERRUPTED, lp.status);
+		EXPECT_FALSE(lp.has_solution());
+
+		// async, no limits
+		lp.cancel = CancelToken();
+		auto res = lp.solve_async();
+		EXPECT_TRUE(res.get());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(12), lp.objective(), md, mrd);
+	}
+
+	// primal simplex interrupted by the iteration limit: once in phase 2 the solution is feasible
+	bool feasible_found = false;
+	for(int64_t limit = 1; ; limit++) {
+		LinearProgram<eT> lp;
+		lp.solver = Solver::INTERNAL;
+		lp.method = Method::SIMPLEX_PRIMAL;
+		lp.presolve = false;
+		lp.instrument = true;
+		lp.iteration_limit = limit;
+		auto x = build(lp);
+
+		if(lp.solve()) {
+			EXPECT_LE(lp.stats.iterations, limit);
+			break;
+		}
+		ASSERT_EQ(Status::INTERRUPTED, lp.status);
+		EXPECT_EQ(limit, lp.stats.iterations);
+		if(!lp.has_solution())
+			continue;
+
+		feasible_found = true;
+		EXPECT_LE(lp.objective(), eT(12) + md);
+		for(uint i = 0; i < 6; i++) {
+			EXPECT_LE(-md, lp.solution(x[i]));
+			if(i + 1 < 6)
+				EXPECT_LE(lp.solution(x[i]) + lp.solution(x[i+1]), eT(1) + md);
+		}
+	}
+	EXPECT_TRUE(feasible_found);
+
+	// limits of programs created inside run_async
+	auto token = CancelToken::create();
+	auto limit = run_async([] { return LinearProgram<eT>().iteration_limit; }, { 0, 7, token });
+	EXPECT_EQ(7, limit.get());
+	EXPECT_EQ(0, LinearProgram<eT>().iteration_limit);
+
+	token.cancel();
+	auto cancelled = run_async([&] {
+		LinearProgram<eT> lp;
+		build(lp);
+		return lp.solve() || lp.status != Status::INTERRUPTED;
+	}, { 0, 0, token });
+	EXPECT_FALSE(cancelled.get());
+
+	// an inactive token can't be cancelled
+	EXPECT_ANY_THROW(CancelToken().cancel());
+}
+
+TYPED_TEST_P(LinearProgramTest, MemoryLimit) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	// the estimate grows with the size, and is available before building
+	for(auto comb : t.combs) {
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+
+		MemoryEstimate small = lp.estimate_memory(10, 10, 100), large = lp.estimate_memory(10, 10, 10000);
+		EXPECT_LT(small.peak(), large.peak());
+		EXPECT_LE(small.build, small.canonicalize);
+		EXPECT_LT(lp.estimate_memory(1000, 10, 100).setup, lp.estimate_memory(1000, 1000, 100).setup);
+
+		// solve() checks the limit of the program as built
+		lp.from_matrix(format_num<eT>("1 2; 3 1"), format_num<eT>("1 2"), format_num<eT>("0.6 0.5"));
+		lp.memory_limit = lp.estimate_memory().peak();
+		EXPECT_TRUE(lp.solve());
+		lp.memory_limit = 1;
+		EXPECT_ANY_THROW(lp.solve());
+	}
+
+	// the limit of the thread reaches programs built internally, which stop while being built
+	{
+		SolveOptions opt;
+		opt.memory_limit = 1 << 16;
+		ScopedOptions scope(opt);
+
+		LinearProgram<eT> lp;
+		EXPECT_EQ(opt.memory_limit, lp.memory_limit);
+		EXPECT_ANY_THROW(lp.make_vars(10000, eT(0), eT(1)));
+		EXPECT_LT(lp.estimate_memory().peak(), lp.estimate_memory(10000, 0, 0).peak());	// stopped early
+	}
+	EXPECT_EQ(0u, LinearProgram<eT>().memory_limit);
+}
+
+TYPED_TEST_P(LinearProgramTest, Duals) {
+	typedef TypeParam eT;
+	LinearProgramTest<eT>& t = *this;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+
+	for(auto comb : t.combs) {
+		LinearProgram<eT> lp;
+		std::tie(lp.method, lp.solver, lp.presolve) = comb;
+		if(lp.solver == Solver::INTERNAL && lp.method == Method::INTERIOR)
+			continue;		// no duals from the internal interior method
+
+		// without sensitivity no duals are computed
+		lp.from_matrix(format_num<eT>("1 2; 3 1"), format_num<eT>("1 2"), format_num<eT>("0.6 0.5"));
+		EXPECT_TRUE(lp.solve());
+		EXPECT_FALSE(lp.has_duals());
+
+		// both constraints are active at (0.6, 0.2):  0.6 = y0 + 3 y1,  0.5 = 2 y0 + y1
+		lp.sensitivity = true;
+		EXPECT_TRUE(lp.solve());
+		ASSERT_TRUE(lp.has_duals());
+		EXPECT_PRED_FORMAT4(chan_equal4<eT>, lp.duals(), format_num<eT>("0.18; 0.14"), md, mrd);
+		EXPECT_PRED_FORMAT4(chan_equal4<eT>, lp.reduced_costs(), format_num<eT>("0; 0"), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, lp.objective(), lp.dual(0) + 2 * lp.dual(1), md, mrd);	// strong duality
+
+		// the first constraint is inactive, relaxing x0 + 2 x1 >= 4 costs 2 per unit, x0 >= 1 costs 1
+		lp.maximize = false;
+		lp.from_matrix(
+			format_num<eT>("3 -4; 1 2; 1 0"),
+			format_num<eT>("12 4 1"),
+			format_num<eT>("3 4"),
+			{ '<', '>', '>' }
+		);
+		EXPECT_TRUE(lp.solve());
+		ASSERT_TRUE(lp.has_duals());
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(0), lp.dual(0), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(2), lp.dual(1), md, mrd);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), lp.dual(2), md, mrd);
+	}
+}
+
+TYPED_TEST_P(LinearProgramTest, Portfolio) {
+	typedef TypeParam eT;
+
+	eT md(def_md<eT>);
+	eT mrd(def_mrd<float>);
+	clear_portfolio_wins();
+
+	// all available backends race, the program is presolved once
+	for(bool presolve : { false, true }) {
+		LinearProgram<eT> lp;
+		lp.solver = Solver::PORTFOLIO;
+		lp.presolve = presolve;
+		lp.family = "portfolio-test";
+		lp.from_matrix(format_num<eT>("1 2; 3 1"), format_num<eT>("1 2"), format_num<eT>("0.6 0.5"));
+
+		EXPECT_TRUE(lp.solve());
+		EXPECT_EQ(Status::OPTIMAL, lp.status);
+		EXPECT_PRED_FORMAT4(equal4<eT>, eT(46)/100, lp.objective(), md, mrd);
+		EXPECT_PRED_FORMAT4(chan_equal4<eT>, lp.solution(), format_num<eT>("0.6; 0.2"), md, mrd);
+		EXPECT_FALSE(lp.portfolio_winner.empty());
+	}
+
+	// the wins are recorded per family (rational programs apart), and AUTO runs the best entry of the family
+	const bool is_rat = std::is_same<eT, rat>::value;
+	auto wins = portfolio_wins("portfolio-test", is_rat);
+	uint total = 0;
+	for(auto& [entry, n] : wins)
+		total += n;
+	EXPECT_EQ(2u, total);
+	EXPECT_TRUE(portfolio_wins("portfolio-test", !is_rat).empty());
+	EXPECT_TRUE(portfolio_wins("other", is_rat).empty());
+
+	LinearProgram<eT> lp;
+	lp.family = "portfolio-test";
+	string best = portfolio_best(lp.family, is_rat);
+	EXPECT_EQ(best.substr(0, best.find(':')), lp.actual_solver());
+	lp.family = "other";
+	EXPECT_EQ(LinearProgram<eT>().actual_solver(), lp.actual_solver());
+
+	// floating-point winners are never used for rat
+	record_portfolio_win("float-winner", "GLOP", true);
+	LinearProgram<rat> lp_rat;
+	lp_rat.family = "float-winner";
+	EXPECT_EQ(LinearProgram<rat>().actual_solver(), lp_rat.actual_solver());
+
+	// explicit entries, and conclusive statuses other than OPTIMAL also win
+	lp.solver = Solver::PORTFOLIO;
+	lp.presolve = false;				// would find the infeasibility itself
+	lp.portfolio = { "INTERNAL", "INTERNAL:SIMPLEX_DUAL" };
+	lp.from_matrix(format_num<eT>("1; 1"), format_num<eT>("3 2"), format_num<eT>("1"), { '>', '<' });
+	EXPECT_FALSE(lp.solve());
+	EXPECT_EQ(Status::INFEASIBLE, lp.status);
+	EXPECT_TRUE(lp.portfolio_winner == "INTERNAL" || lp.portfolio_winner == "INTERNAL:SIMPLEX_DUAL");
+	EXPECT_EQ(1u, portfolio_wins("other", is_rat)[lp.portfolio_winner]);
+
+	// a cancelled solve is interrupted before the race starts
+	lp.cancel = CancelToken::create();
+	lp.cancel.cancel();
+	EXPECT_FALSE(lp.solve());
+	EXPECT_EQ(Status::INTERRUPTED, lp.status);
+	EXPECT_TRUE(lp.portfolio_winner.empty());
+
+	lp.cancel = CancelToken();
+	lp.portfolio = { "PORTFOLIO" };
+	EXPECT_ANY_THROW(lp.solve());
+
+	clear_portfolio_wins();
+}
+
+REGISTER_TYPED_TEST_SUITE_P(LinearProgramTest, Optimal, Infeasible, Unbounded, WarmStart, CoeffUpdates, InternalPricing, InternalBounded, InternalRandom, InternalInterior, Presolve, ParallelCons, Instrument, Limits, MemoryLimit, Mps, Duals, Portfolio);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(LinearProgram, LinearProgramTest, AllTypes);
 
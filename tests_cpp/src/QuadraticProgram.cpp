@@ -48,7 +48,117 @@ TYPED_TEST_P(QuadraticProgramTest, Infeasible) {
 }
 
 
-REGISTER_TYPED_TEST_SUITE_P(QuadraticProgramTest, Optimal, Infeasible);
+TYPED_TEST_P(QuadraticProgramTest, WarmStart) {
+	typedef TypeParam eT;
+
+	auto P = format_num<eT>("4 1; 1 2");
+	auto A = format_num<eT>("1 1; 1 0; 0 1");
+
+	QuadraticProgram<eT> qp;
+	qp.warm_start = true;
+	qp.from_matrix(P, format_num<eT>("1 1"), A, format_num<eT>("1 0 0"), format_num<eT>("1 0.7 0.7"));
+	EXPECT_TRUE(qp.solve());
+
+	// change only the linear cost and the bounds, the workspace is updated in place
+	qp.set_obj_coeff(0, eT(2));
+	qp.set_con_bounds(1, eT(0), eT(0.8));
+	qp.set_con_bounds(2, eT(0), eT(0.8));
+	EXPECT_TRUE(qp.solve());
+
+	QuadraticProgram<eT> fresh;
+	fresh.from_matrix(P, format_num<eT>("2 1"), A, format_num<eT>("1 0 0"), format_num<eT>("1 0.8 0.8"));
+	EXPECT_TRUE(fresh.solve());
+
+	EXPECT_PRED_FORMAT2(equal2<eT>, fresh.objective(), qp.objective());
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, fresh.solution(), qp.solution());
+
+	// structural change, the workspace is rebuilt
+	qp.set_con_coeff(0, 1, eT(2));
+	fresh.set_con_coeff(0, 1, eT(2));
+	EXPECT_TRUE(qp.solve());
+	EXPECT_TRUE(fresh.solve());
+	EXPECT_PRED_FORMAT2(equal2<eT>, fresh.objective(), qp.objective());
+}
+
+
+TYPED_TEST_P(QuadraticProgramTest, Instrument) {
+	typedef TypeParam eT;
+
+	QuadraticProgram<eT> qp;
+	qp.instrument = true;
+	qp.from_matrix(format_num<eT>("4 1; 1 2"), format_num<eT>("1 1"), format_num<eT>("1 1; 1 0; 0 1"), format_num<eT>("1 0 0"), format_num<eT>("1 0.7 0.7"));
+	EXPECT_TRUE(qp.solve());
+
+	EXPECT_EQ(lp::Status::OPTIMAL, qp.stats.status);
+	EXPECT_EQ(2u, qp.stats.n_var);
+	EXPECT_EQ(3u, qp.stats.n_con);
+	EXPECT_EQ(7u, qp.stats.nnz);		// 4 in A, 3 in the upper triangle of P
+	EXPECT_LT(0, qp.stats.iterations);
+	EXPECT_LE(0, qp.stats.setup);
+	EXPECT_EQ(qp.stats.iterations, last_stats().iterations);
+}
+
+
+TYPED_TEST_P(QuadraticProgramTest, Limits) {
+	typedef TypeParam eT;
+
+	auto build = [](QuadraticProgram<eT>& qp) {
+		qp.from_matrix(format_num<eT>("4 1; 1 2"), format_num<eT>("1 1"), format_num<eT>("1 1; 1 0; 0 1"), format_num<eT>("1 0 0"), format_num<eT>("1 0.7 0.7"));
+	};
+
+	// cancelled before starting, no solution
+	QuadraticProgram<eT> qp;
+	build(qp);
+	qp.cancel = lp::CancelToken::create();
+	qp.cancel.cancel();
+	EXPECT_FALSE(qp.solve());
+	EXPECT_EQ(qp::Status::INTERRUPTED, qp.status);
+	EXPECT_FALSE(qp.has_solution());
+
+	// a single ADMM iteration is not enough, the last iterate is kept
+	qp.cancel = lp::CancelToken();
+	qp.iteration_limit = 1;
+	EXPECT_FALSE(qp.solve());
+	EXPECT_EQ(qp::Status::INTERRUPTED, qp.status);
+	EXPECT_TRUE(qp.has_solution());
+	EXPECT_EQ(2u, qp.solution().n_elem);
+
+	// the limit is reset on the next solve, even if the workspace is reused
+	qp.iteration_limit = 0;
+	EXPECT_TRUE(qp.solve());
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(1.88), qp.objective());
+
+	// limits are taken from the options of the thread building the program
+	{
+		lp::SolveOptions opt;
+		opt.iteration_limit = 1;
+		lp::ScopedOptions scope(opt);
+
+		QuadraticProgram<eT> qp2;
+		build(qp2);
+		EXPECT_EQ(1, qp2.iteration_limit);
+		EXPECT_FALSE(qp2.solve());
+		EXPECT_EQ(qp::Status::INTERRUPTED, qp2.status);
+	}
+	EXPECT_EQ(0, QuadraticProgram<eT>().iteration_limit);
+
+	#ifdef PROFILING
+	// a time limit that has passed before OSQP starts
+	qp.time_limit = 1e-12;
+	EXPECT_FALSE(qp.solve());
+	EXPECT_EQ(qp::Status::INTERRUPTED, qp.status);
+	qp.time_limit = 0;
+	#endif
+
+	// async
+	auto res = qp.solve_async();
+	EXPECT_TRUE(res.get());
+	EXPECT_EQ(qp::Status::OPTIMAL, qp.status);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, qp.solution(), format_num<eT>("0.3; 0.7"));
+}
+
+
+REGISTER_TYPED_TEST_SUITE_P(QuadraticProgramTest, Optimal, Infeasible, WarmStart, Instrument, Limits);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(QuadraticProgram, QuadraticProgramTest, NativeTypes);
 
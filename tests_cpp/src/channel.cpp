@@ -128,6 +128,39 @@ TYPED_TEST_P(ChanTestReals, FactorizeSubgrad) {
 	EXPECT_PRED_FORMAT4(chan_equal4<eT>, A, Z, 1e-4, 0);
 }
 
+TYPED_TEST_P(ChanTestReals, FactorizeFista) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	// non factorizable
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, factorize_fista(t.id_10, t.noint_10), 0, 0);
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, factorize_fista(t.id_4,  t.noint_10), 0, 0);
+
+	// fat B as in FactorizeSubgrad, both row and column stochastic
+	int n = 10, m = 15;
+	Chan<eT>
+		B = randu<eT>(n, m),
+		A = B * randu<eT>(m, n),
+		X = factorize_fista(A, B),
+		Z = B * X;
+
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, X, m, n);
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, A, Z, 1e-4, 0);
+
+	Chan<eT> Xc = randu<eT>(n, m).t();			// column stochastic, m x n
+	A = B * Xc;
+	X = factorize_fista(A, B, true);
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, A, Z = B * X, 1e-4, 0);
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, (Chan<eT>)X.t(), n, m);
+
+	// through factorize / left_factorize
+	A = B * randu<eT>(m, n);
+	X = factorize(A, B, false, "fista");
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, A, Z = B * X, 1e-4, 0);
+
+	EXPECT_ANY_THROW(factorize(A, B, false, "foo"));
+}
+
 TYPED_TEST_P(ChanTest, LeftFactorize) {
 	typedef TypeParam eT;
 	BaseTest<eT>& t = *this;
@@ -164,20 +197,519 @@ TYPED_TEST_P(ChanTest, BayesianUpdate) {
 	EXPECT_EQ(1u, iter2);
 	EXPECT_PRED_FORMAT2(prob_equal2<eT>, pi2, t.unif_10);
 
-	if(std::is_same<eT, double>::value) {
+	if constexpr (std::is_same<eT, double>::value) {
 		// the geometric should produce the real prior in many iterations (and with limited accuracy)
 		// Note: for rat this is slow (probably has to do with the huge denominators in the random elements)
 		auto C = mechanism::d_privacy::geometric<eT>(10);
 		auto pi3 = iterative_bayesian_update<eT>(C, t.prand_10 * C, {}, eT(1e-8)).first;
 		EXPECT_PRED_FORMAT4(prob_equal4<eT>, pi3, t.prand_10, eT(0), eT(1e-4));
+
+		// same estimate with fewer steps
+		auto [pi4, iter4] = iterative_bayesian_update<eT>(C, t.prand_10 * C, {}, eT(1e-8), 0, "em");
+		auto [pi5, iter5] = iterative_bayesian_update<eT>(C, t.prand_10 * C, {}, eT(1e-8), 0, "squarem");
+		EXPECT_PRED_FORMAT4(prob_equal4<eT>, pi5, t.prand_10, eT(0), eT(1e-4));
+		EXPECT_LT(iter5, iter4);
+
+		// sparse and operator versions follow exactly the same steps
+		auto op = mechanism::d_privacy::geometric_operator<eT>(10);
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, pi4, iterative_bayesian_update<eT>(SpChan<eT>(C), t.prand_10 * C, {}, eT(1e-8)).first);
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, pi4, iterative_bayesian_update<eT>(op, t.prand_10 * C, {}, eT(1e-8)).first);
+
+		// streaming, the histogram of the reports is proportional to the output distribution
+		StreamingBayesianUpdate<eT> stream(C, eT(1e-8));
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, t.unif_10, stream.estimate());
+		Row<eT> out = t.prand_10 * C;
+		stream.add(Row<eT>(out * eT(500)));
+		stream.add(Row<eT>(out * eT(500)));
+		EXPECT_PRED_FORMAT4(prob_equal4<eT>, pi4, stream.estimate(), eT(0), eT(1e-4));
+	}
+	EXPECT_ANY_THROW(iterative_bayesian_update<eT>(t.id_10, t.prand_10, {}, eT(1e-6), 0, "foo"));
+}
+
+TYPED_TEST_P(ChanTest, GridKernel) {
+	typedef TypeParam eT;
+
+	uint width = 3, height = 4, size = width * height;
+	int cx = width - 1, cy = height - 1;
+	Mat<eT> K = channel::randu<eT>(2*height-1, 2*width-1);
+
+	// naive construction, folding every kernel cell to the closest grid cell
+	Chan<eT> C = arma::zeros<Chan<eT>>(size, size);
+	for(uint in_x = 0; in_x < width; in_x++)
+	for(uint in_y = 0; in_y < height; in_y++)
+	for(int x = -cx; x <= cx; x++)
+	for(int y = -cy; y <= cy; y++) {
+		uint out_x = std::clamp<int>(in_x + x, 0, width-1);
+		uint out_y = std::clamp<int>(in_y + y, 0, height-1);
+		C(in_y * width + in_x, out_y * width + out_x) += K(cy+y, cx+x);
+	}
+
+	LazyChan<eT> L = grid_kernel(K, width, height);
+	EXPECT_EQ(size, L.n_rows);
+	EXPECT_EQ(size, L.n_cols);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, C, L.materialize());
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(C.row(5)), L.row(5));
+	EXPECT_ANY_THROW(L.row(size));
+
+	// measures on lazy channels
+	Prob<eT> pi = probab::randu<eT>(size);
+	Mat<eT> D = channel::randu<eT>(size);
+	auto d = metric::euclidean<eT, uint>();
+
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::bayes_vuln::posterior(pi, C), measure::bayes_vuln::posterior(pi, L));
+	EXPECT_PRED_FORMAT2(equal2<eT>, utility::expected_distance(D, pi, C), utility::expected_distance(D, pi, L));
+	EXPECT_PRED_FORMAT2(equal2<eT>, utility::expected_distance(d, pi, C), utility::expected_distance(d, pi, L));
+}
+
+TYPED_TEST_P(ChanTestReals, Sparse) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	// a deterministic channel with some duplicate columns, and a randomly sparsified one
+	arma::ucolvec map = { 0, 2, 2, 5, 1, 0, 5, 3, 3, 2 };
+	SpChan<eT> D = deterministic_sparse<eT>(map, 7);
+	Chan<eT> Dd = deterministic<eT>(map, 7);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Dd, Chan<eT>(D));
+
+	Chan<eT> Cd = channel::randu<eT>(10, 8);
+	Cd.elem(arma::find(Cd < eT(0.1))).zeros();
+	normalize(Cd);
+	SpChan<eT> C(Cd);
+
+	for(auto [S, Sd] : { std::pair(D, Dd), std::pair(C, Cd) }) {
+		EXPECT_PRED_FORMAT2(chan_equal2<eT>, posteriors(Sd, t.prand_10), Chan<eT>(posteriors(S, t.prand_10)));
+
+		auto [outer_d, inners_d] = hyper(Sd, t.prand_10);
+		auto [outer, inners] = hyper(S, t.prand_10);
+		uint k = 0;
+		for(uint y = 0; y < outer_d.n_cols; y++) {
+			if(qif::equal(outer_d(y), eT(0)))		// the sparse hyper drops merged columns
+				continue;
+			EXPECT_PRED_FORMAT2(equal2<eT>, outer_d(y), outer(k));
+			EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(inners_d.col(y).t()), Prob<eT>(Col<eT>(inners.col(k)).t()));
+			k++;
+		}
+		EXPECT_EQ(k, outer.n_cols);
+		EXPECT_PRED_FORMAT2(equal2<eT>, eT(1), arma::accu(outer));
+
+		EXPECT_PRED_FORMAT2(equal2<eT>, measure::bayes_vuln::posterior(t.prand_10, Sd), measure::bayes_vuln::posterior(t.prand_10, S));
+		EXPECT_PRED_FORMAT2(equal2<eT>, measure::shannon::posterior(t.prand_10, Sd), measure::shannon::posterior(t.prand_10, S));
+
+		Mat<eT> G = channel::randu<eT>(4, 10) - eT(0.2);
+		EXPECT_PRED_FORMAT2(equal2<eT>, measure::g_vuln::posterior(G, t.prand_10, Sd), measure::g_vuln::posterior(G, t.prand_10, S));
+
+		// samples should be in the support of the joint
+		auto [x, y] = sample(S, t.prand_10);
+		EXPECT_GT(Sd(x, y), eT(0));
+		Mat<uint> samples = sample(S, t.prand_10, 100);
+		for(uint i = 0; i < samples.n_rows; i++)
+			EXPECT_GT(Sd(samples(i, 0), samples(i, 1)), eT(0));
+	}
+}
+
+
+TYPED_TEST_P(ChanTestReals, Mapped) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	std::string filename = ::testing::TempDir() + "qif_mapped_chan.bin";
+	Chan<eT> C = channel::randu<eT>(10, 7);
+	channel::write_mapped(filename, C);
+
+	channel::MappedChan<eT> M(filename);
+	M.block_rows = 3;										// several blocks, the last one partial
+	EXPECT_EQ(10u, M.n_rows);
+	EXPECT_EQ(7u, M.n_cols);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, C, M.materialize());
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, C, M.lazy().materialize());
+
+	Prob<eT>& pi = t.prand_10;
+	Mat<eT> G = channel::randu<eT>(4, 10);
+	Mat<eT> D = channel::randu<eT>(10, 7);
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::bayes_vuln::posterior(pi, C), measure::bayes_vuln::posterior(pi, M));
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::g_vuln::posterior(G, pi, C), measure::g_vuln::posterior(G, pi, M));
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::shannon::posterior(pi, C), measure::shannon::posterior(pi, M));
+	EXPECT_PRED_FORMAT2(equal2<eT>, utility::expected_distance(D, pi, C), utility::expected_distance(D, pi, M));
+
+	Prob<eT> out = pi * C;
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, channel::iterative_bayesian_update(C, out, {}, eT(1e-6), 20).first,
+										 channel::iterative_bayesian_update(M, out, {}, eT(1e-6), 20).first);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, channel::posteriors(C, pi), channel::posteriors(M, pi));
+
+	// view of row-major data in memory
+	Mat<eT> Ct = C.t();
+	channel::MappedChan<eT> V(Ct.memptr(), C.n_rows, C.n_cols);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, C, V.materialize());
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::bayes_vuln::posterior(pi, C), measure::bayes_vuln::posterior(pi, V));
+
+	// sizes whose byte count wraps around 2^64 to the actual data size, and sizes that do not fit uint
+	auto write_header = [&](uint64_t n_rows, uint64_t n_cols, uint64_t data_bytes) {
+		std::ofstream file(filename, std::ios::binary);
+		binary::aux::MatHeader h = binary::aux::make_header(binary::aux::elem_code<eT>(), true, n_rows, n_cols, data_bytes);
+		file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		file.write(std::string(data_bytes, '\0').data(), data_bytes);
+	};
+	if(sizeof(eT) == 8)
+		write_header(660819461, 3489369102, 560);			// 8 * 660819461 * 3489369102 = 560 mod 2^64
+	else
+		write_header(2707182199, 1703500422, 296);			// 4 * 2707182199 * 1703500422 = 296 mod 2^64
+	EXPECT_THROW(channel::MappedChan<eT> M2(filename), std::runtime_error);
+
+	write_header(uint64_t(1) << 32, 0, 0);
+	EXPECT_THROW(channel::MappedChan<eT> M2(filename), std::runtime_error);
+
+	std::remove(filename.c_str());
+}
+
+template<typename eT, typename Q>
+void check_quantized(const Chan<eT>& C, const Prob<eT>& pi) {
+	using namespace measure;
+	channel::QuantizedChan<eT, Q> QC(C);
+	const eT slack = std::numeric_limits<eT>::epsilon() * 100;		// rounding of the sums themselves
+	Mat<eT> L = channel::randu<eT>(4, C.n_rows), D = channel::randu<eT>(C.n_rows, C.n_cols);
+
+	EXPECT_EQ(C.n_rows, QC.n_rows);
+	EXPECT_EQ(C.n_cols, QC.n_cols);
+	EXPECT_EQ(C.n_elem * sizeof(Q) + C.n_rows * sizeof(eT), QC.bytes());
+
+	Chan<eT> M = QC.materialize();
+	for(uint x = 0; x < C.n_rows; x++)
+		EXPECT_LE(arma::abs(M.row(x) - C.row(x)).max(), QC.max_error(x));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, M, QC.lazy().materialize());
+
+	EXPECT_LE(std::abs(bayes_vuln::posterior(pi, C) - bayes_vuln::posterior(pi, QC)), bayes_vuln::posterior_error(pi, QC) + slack);
+	EXPECT_LE(std::abs(g_vuln::posterior(L, pi, C) - g_vuln::posterior(L, pi, QC)), g_vuln::posterior_error(L, pi, QC) + slack);
+	EXPECT_LE(std::abs(l_risk::posterior(L, pi, C) - l_risk::posterior(L, pi, QC)), l_risk::posterior_error(L, pi, QC) + slack);
+	EXPECT_LE(std::abs(utility::expected_distance(D, pi, C) - utility::expected_distance(D, pi, QC)), utility::expected_distance_error(D, pi, QC) + slack);
+
+	// the kernels give the measures of the decoded channel
+	auto d = metric::euclidean<eT, uint>();
+	EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, M), bayes_vuln::posterior(pi, QC));
+	EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(L, pi, M), l_risk::posterior(L, pi, QC));
+	EXPECT_PRED_FORMAT2(equal2<eT>, utility::expected_distance(d, pi, M), utility::expected_distance(d, pi, QC));
+}
+
+TYPED_TEST_P(ChanTestReals, Quantized) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Chan<eT> C = channel::randu<eT>(10, 7);
+	C(3, 2) = eT(0);
+	C.row(5).zeros();
+	check_quantized<eT, uint8_t>(C, t.prand_10);
+	check_quantized<eT, uint16_t>(C, t.prand_10);
+	check_quantized<eT, channel::half>(C, t.prand_10);
+
+	channel::QuantizedChan<eT, uint16_t> QC(C);
+	QC.block_rows = 3;										// several blocks, the last one partial
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::g_vuln::posterior(t.id_10, t.prand_10, QC.materialize()), measure::g_vuln::posterior(t.id_10, t.prand_10, QC));
+
+	// half: exact for values representable in half precision
+	for(float v : { 0.0f, 1.0f, 0.5f, 0.75f, 1.0f / 1024, 1.0f / 16777216 })
+		EXPECT_EQ(v, channel::aux::half_to_float(channel::aux::float_to_half(v)));
+
+	Chan<eT> Neg = C;
+	Neg(0, 0) = eT(-1);
+	EXPECT_ANY_THROW((channel::QuantizedChan<eT, uint8_t>(Neg)));
+}
+
+TYPED_TEST_P(ChanTest, Posteriors) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Chan<eT> J = t.crand_10;
+	J.each_col() %= t.prand_10.t();
+	Mat<eT> P = J.each_row() / arma::sum(J);
+
+	Mat<eT> C = t.crand_10;
+	posteriors_inplace(C, t.prand_10);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, P, C);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, P, posteriors(t.crand_10, t.prand_10));
+
+	PosteriorView<eT> view(t.crand_10, t.prand_10);
+	Col<eT> col;
+	for(uint y = 0; y < 10; y++) {
+		view.col(y, col);
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(P.col(y).t()), Prob<eT>(col.t()));
+		EXPECT_PRED_FORMAT2(equal2<eT>, arma::accu(J.col(y)), view.outer(y));
+	}
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, P, view.materialize());
+	EXPECT_ANY_THROW(view.col(10));
+
+	// column 1 is twice column 0, column 2 is zero
+	eT a = eT(1)/6, b = eT(1)/3, c = eT(1)/2;
+	Chan<eT> D = { { a, b, eT(0), c }, { a, b, eT(0), c }, { b, 2*b, eT(0), eT(0) } };
+	Chan<eT> R = { { c, c }, { c, c }, { eT(1), eT(0) } };
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, R, reduced(D));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, R, reduced(R));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, t.id_10, reduced(t.id_10));
+}
+
+TYPED_TEST_P(ChanTest, Binary) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	std::string filename = ::testing::TempDir() + "qif_binary_chan.bin";
+	Chan<eT> C = channel::randu<eT>(10, 7);
+	C(0, 0) = -C(0, 0);										// negative and zero elements
+	C(1, 1) = eT(0);
+	binary::save(filename, C);
+
+	EXPECT_EQ(binary::aux::elem_code<eT>(), binary::elem_type(filename));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, C, binary::load<eT>(filename));
+
+	Chan<double> Cd(C.n_rows, C.n_cols);						// conversion on load
+	for(uint i = 0; i < C.n_elem; i++)
+		Cd(i) = to_double(C(i));
+	EXPECT_PRED_FORMAT2(chan_equal2<double>, Cd, binary::load<double>(filename));
+
+	if constexpr (std::is_floating_point<eT>::value) {
+		binary::Mapped<eT> M(filename);
+		EXPECT_PRED_FORMAT2(chan_equal2<eT>, C, *M);
+	}
+
+	binary::save(filename, Mat<eT>(t.prand_10));			// priors as 1 x n
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, t.prand_10, Prob<eT>(binary::load<eT>(filename)));
+
+	// corrupt headers and data are rejected before allocating anything
+	auto write_raw = [&](uint32_t elem, uint64_t n_rows, uint64_t n_cols, const std::vector<char>& data) {
+		binary::aux::MatHeader h = binary::aux::make_header(elem, false, n_rows, n_cols, data.size());
+		std::ofstream file(filename, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		file.write(data.data(), data.size());
+	};
+	std::vector<char> eight(8, 0);
+	write_raw(1, uint64_t(1) << 61, 8, eight);				// the size product overflows to 0 mod 2^64
+	EXPECT_THROW(binary::load<eT>(filename), std::runtime_error);
+	write_raw(1, uint64_t(1) << 40, uint64_t(1) << 40, eight);
+	EXPECT_THROW(binary::load<eT>(filename), std::runtime_error);
+	write_raw(3, uint64_t(1) << 40, uint64_t(1) << 40, eight);	// rat: huge allocation from the header
+	EXPECT_THROW(binary::load<eT>(filename), std::runtime_error);
+
+	std::vector<char> limbs(16, 0);							// 1 x 1 rat, numerator with INT64_MIN limbs
+	int64_t n = std::numeric_limits<int64_t>::min();
+	std::memcpy(limbs.data(), &n, sizeof(n));
+	write_raw(3, 1, 1, limbs);
+	EXPECT_THROW(binary::load<eT>(filename), std::runtime_error);
+	n = int64_t(1) << 61;									// count * 8 overflows to 0
+	std::memcpy(limbs.data(), &n, sizeof(n));
+	write_raw(3, 1, 1, limbs);
+	EXPECT_THROW(binary::load<eT>(filename), std::runtime_error);
+
+	if constexpr (std::is_floating_point<eT>::value) {
+		write_raw(binary::aux::elem_code<eT>(), uint64_t(1) << 62, 4, std::vector<char>(0));
+		EXPECT_THROW(binary::Mapped<eT> M(filename), std::runtime_error);
+	}
+
+	std::remove(filename.c_str());
+}
+
+TYPED_TEST_P(ChanTest, HyperCompact) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	// every column of B appears twice (scaled by 1/2), plus a zero column
+	Chan<eT> B = channel::randu<eT>(10, 4);
+	Chan<eT> C = arma::join_rows(arma::zeros<Chan<eT>>(10, 1), arma::join_rows(B, B) / eT(2));
+
+	auto [outer, inners] = hyper_compact(C, t.prand_10);
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(t.prand_10 * B), outer);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, posteriors(B, t.prand_10), inners);
+
+	// same distribution of inners as hyper
+	auto [outer_h, inners_h] = hyper(C, t.prand_10);
+	for(uint y = 0; y < outer_h.n_cols; y++) {
+		if(qif::equal(outer_h(y), eT(0)))
+			continue;
+		bool found = false;
+		for(uint j = 0; j < outer.n_cols; j++)
+			if(channel::equal<eT>(inners_h.col(y), inners.col(j)) && qif::equal(outer_h(y), outer(j)))
+				found = true;
+		EXPECT_TRUE(found);
 	}
 }
 
+TYPED_TEST_P(ChanTest, Coarsen) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+	using namespace measure;
+
+	// columns appearing twice are merged exactly
+	Chan<eT> B = channel::randu<eT>(10, 4);
+	Chan<eT> C = arma::join_rows(B, B) / eT(2);
+	auto exact = channel::coarsen(C, t.prand_10, 4);
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, exact.C, 10, 4);
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(0), exact.max_radius);
+	EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(t.prand_10, C), bayes_vuln::posterior(t.prand_10, exact.C));
+
+	// lossy, the vulnerabilities decrease by at most the bound
+	Chan<eT> D = channel::randu<eT>(10, 60);
+	Mat<eT> G = channel::randu<eT>(5, 10);
+	for(std::string method : { "kmeans", "grid" }) {
+		auto res = channel::coarsen(D, t.prand_10, 6, method);
+		EXPECT_LE(res.C.n_cols, 6u);
+		EXPECT_TRUE(channel::is_proper(res.C));
+		EXPECT_PRED_FORMAT2(chan_equal2<eT>, res.C, Chan<eT>(D * channel::deterministic<eT>(res.cluster, res.C.n_cols)));
+		EXPECT_TRUE(less_than_or_eq(res.error, res.max_radius));
+
+		eT v = bayes_vuln::posterior(t.prand_10, D), v2 = bayes_vuln::posterior(t.prand_10, res.C);
+		EXPECT_TRUE(less_than_or_eq(v2, v));
+		EXPECT_TRUE(less_than_or_eq(v - res.error, v2));
+
+		eT g = g_vuln::posterior(G, t.prand_10, D), g2 = g_vuln::posterior(G, t.prand_10, res.C);
+		EXPECT_TRUE(less_than_or_eq(g2, g));
+		EXPECT_TRUE(less_than_or_eq(g - res.g_vuln_bound(G), g2));
+	}
+
+	// many outputs of tiny probability (below def_md) carry a total mass well above it, they count in the bound
+	if constexpr (std::is_same<eT, double>::value) {
+		const uint n_tiny = 2000;
+		const eT tiny = 5e-8;
+		Chan<eT> E = arma::join_rows(Chan<eT>(channel::randu<eT>(10, 4) * (eT(1) - tiny * n_tiny / 10)), Chan<eT>(10, n_tiny, arma::fill::zeros));
+		for(uint y = 0; y < n_tiny; y++)
+			E(y % 10, 4 + y) = tiny;
+		ASSERT_TRUE(channel::is_proper(E));
+
+		auto res = channel::coarsen(E, t.prand_10, 4);
+		eT v = bayes_vuln::posterior(t.prand_10, E), v2 = bayes_vuln::posterior(t.prand_10, res.C);
+		EXPECT_LE(v - v2, res.error + 1e-12);
+		eT g = g_vuln::posterior(G, t.prand_10, E), g2 = g_vuln::posterior(G, t.prand_10, res.C);
+		EXPECT_LE(g - g2, res.g_vuln_bound(G) + 1e-12);
+	}
+
+	EXPECT_ANY_THROW(channel::coarsen(D, t.prand_10, 0));
+	EXPECT_ANY_THROW(channel::coarsen(D, t.prand_10, 6, "foo"));
+}
+
+TYPED_TEST_P(ChanTest, Compose) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+	using namespace channel::compose;
+
+	Chan<eT> A = channel::randu<eT>(3, 2), B = channel::randu<eT>(3, 4);
+	Prob<eT> pi = probab::randu<eT>(3);
+
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, parallel(A, B), parallel_lazy(A, B).materialize());
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, repeated_independent(B, 3), repeated_independent_lazy(B, 3).materialize());
+
+	// grouping the outputs by type preserves the vulnerabilities
+	Mat<eT> G = channel::randu<eT>(5, 3);
+	for(uint n = 1; n <= 3; n++) {
+		Chan<eT> Cn = repeated_independent(B, n), Ct = repeated_independent_types(B, n);
+
+		EXPECT_EQ((n+1)*(n+2)*(n+3)/6, Ct.n_cols);
+		channel::assert_proper(Ct);
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, Cn), bayes_vuln::posterior(pi, Ct));
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, Cn), g_vuln::posterior(G, pi, Ct));
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, Cn), g_vuln::posterior(G, pi, repeated_independent_lazy(B, n)));
+	}
+
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, t.id_10, repeated_independent_types(t.id_10, 1));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, B, repeated_independent_types(B, 1));
+
+	// types (2,0), (1,1), (0,2)
+	Chan<eT> A2 = { { A(0,0)*A(0,0), 2*A(0,0)*A(0,1), A(0,1)*A(0,1) }, { A(1,0)*A(1,0), 2*A(1,0)*A(1,1), A(1,1)*A(1,1) }, { A(2,0)*A(2,0), 2*A(2,0)*A(2,1), A(2,1)*A(2,1) } };
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, A2, repeated_independent_types(A, 2));
+
+	Chan<eT> D = channel::randu<eT>(4, 5), E = channel::randu<eT>(5, 2);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Chan<eT>(B * D), cascade(B, D));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Chan<eT>(t.prand_10 * t.crand_10), cascade(Chan<eT>(t.prand_10), t.crand_10));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Chan<eT>(B * D * E), cascade<eT>({ B, D, E }));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, B, cascade<eT>({ B }));
+	EXPECT_ANY_THROW(cascade(B, E));
+}
+
+TYPED_TEST_P(ChanTest, Deterministic) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	arma::ucolvec map = { 0, 2, 2, 5, 1, 0, 5, 3, 3, 2 };
+	DetChan<eT> D(map, 7);
+	Chan<eT> Dd = deterministic<eT>(map, 7);
+	Prob<eT>& pi = t.prand_10;
+
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Dd, D.materialize());
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Dd, Chan<eT>(D.sparse()));
+	EXPECT_TRUE(arma::all(map == DetChan<eT>(Dd).map));
+	EXPECT_ANY_THROW(DetChan<eT>(t.crand_10));
+	EXPECT_ANY_THROW(DetChan<eT>(map, 5));
+
+	// closed-form measures agree with the dense ones (blocks 4 and 6 are empty)
+	EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, Dd), bayes_vuln::posterior(pi, D));
+	EXPECT_TRUE(arma::all(bayes_vuln::strategy(pi, Dd) == bayes_vuln::strategy(pi, D)));
+	if constexpr (std::is_floating_point<eT>::value) {		// no log for rat
+		EXPECT_PRED_FORMAT2(equal2<eT>, shannon::posterior(pi, Dd), shannon::posterior(pi, D));
+		EXPECT_PRED_FORMAT2(equal2<eT>, shannon::prior(Prob<eT>(pi * Dd)), shannon::prior(pi) - shannon::posterior(pi, D));
+	}
+
+	Mat<eT> G = channel::randu<eT>(4, 10);
+	EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, Dd), g_vuln::posterior(G, pi, D));
+	EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(G, pi, Dd), l_risk::posterior(G, pi, D));
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, posterior(Dd, pi, 2), posterior(D, pi, 2));
+
+	// composition without the matrix product
+	using namespace channel::compose;
+	Chan<eT> A = channel::randu<eT>(3, 10), B = channel::randu<eT>(7, 4);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Chan<eT>(A * Dd), cascade(A, D));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Chan<eT>(Dd * B), cascade(D, B));
+
+	DetChan<eT> E(arma::ucolvec({ 1, 1, 0, 2, 0, 0, 2 }), 3);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Chan<eT>(Dd * E.materialize()), cascade(D, E).materialize());
+	EXPECT_ANY_THROW(cascade(B, D));
+	EXPECT_ANY_THROW(cascade(E, D));
+
+	Mat<uint> pairs = sample(D, pi, 100);
+	for(uint k = 0; k < pairs.n_rows; k++)
+		EXPECT_EQ(map(pairs(k, 0)), pairs(k, 1));
+}
+
+TYPED_TEST_P(ChanTestReals, Empirical) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Chan<eT> C = channel::randu<eT>(10, 6);
+	Prob<eT>& pi = t.prand_10;
+	const uint n = 400000;
+
+	channel::EmpiricalChannel est(10, 6);
+	est.add(channel::sample(C, pi, n));					// in parallel, one shard per block
+	EXPECT_EQ(uint64_t(n), est.n_samples());
+
+	// shards of concurrent producers
+	Mat<uint> pairs = channel::sample(C, pi, n);
+	std::vector<std::thread> producers;
+	for(uint p = 0; p < 4; p++)
+		producers.emplace_back([&, p] {
+			auto shard = est.shard();
+			for(uint k = p; k < n; k += 4)
+				shard.add(pairs(k, 0), pairs(k, 1));
+		});
+	for(auto& th : producers)
+		th.join();
+	EXPECT_EQ(uint64_t(2 * n), est.n_samples());
+
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, C, est.channel<eT>(), eT(0.02), eT(0));
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, Chan<eT>(pi), Chan<eT>(est.prior<eT>()), eT(0.01), eT(0));
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, est.channel<eT>(), Chan<eT>(est.sparse_channel<eT>()), eT(1e-6), eT(0));
+
+	auto v = est.bayes_vuln(0.99);
+	double real = to_double(measure::bayes_vuln::posterior(pi, C));
+	EXPECT_LE(v.lower, real);
+	EXPECT_GE(v.upper, real);
+	EXPECT_LT(v.upper - v.lower, 0.01);
+
+	auto vp = est.prior_bayes_vuln(0.99);
+	EXPECT_LE(vp.lower, to_double(measure::bayes_vuln::prior(pi)));
+	EXPECT_GE(vp.upper, to_double(measure::bayes_vuln::prior(pi)));
+
+	EXPECT_ANY_THROW(est.add(10, 0));
+	EXPECT_ANY_THROW(channel::EmpiricalChannel(3, 3).prior<eT>());
+}
 
 // run ChanTest for all types, ChanTestReals only for native types
 //
-REGISTER_TYPED_TEST_SUITE_P(ChanTest, Construct, Identity, Randu, Factorize, LeftFactorize, BayesianUpdate);
-REGISTER_TYPED_TEST_SUITE_P(ChanTestReals, FactorizeSubgrad);
+REGISTER_TYPED_TEST_SUITE_P(ChanTest, Construct, Identity, Randu, Factorize, LeftFactorize, BayesianUpdate, GridKernel, HyperCompact, Coarsen, Posteriors, Binary, Compose, Deterministic);
+REGISTER_TYPED_TEST_SUITE_P(ChanTestReals, FactorizeSubgrad, FactorizeFista, Sparse, Mapped, Quantized, Empirical);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Chan, ChanTest, AllTypes);
 INSTANTIATE_TYPED_TEST_SUITE_P(Chan, ChanTestReals, NativeTypes);
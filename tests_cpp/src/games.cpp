@@ -0,0 +1,57 @@
+#include "tests_aux.h"
+
+using namespace games;
+
+
+TEST(GamesTest, MinmaxHiddenBayes) {
+	const uint n_adv = 3, n_def = 2, n = 5;
+	Prob<double> pi = probab::randu<double>(n);
+
+	std::vector<std::vector<chan>> Cs(n_adv);
+	for(auto& row : Cs)
+		for(uint d = 0; d < n_def; d++)
+			row.push_back(channel::randu<double>(n, 4));
+
+	// the subgradient is the one of the best adversary action
+	prob delta = { 0.3, 0.7 }, g;
+	double f = bayes_subgradient(pi, Cs, delta, g);
+	double f_max = 0;
+	for(uint a = 0; a < n_adv; a++)
+		f_max = std::max(f_max, measure::bayes_vuln::posterior(pi, chan(0.3 * Cs[a][0] + 0.7 * Cs[a][1])));
+	EXPECT_PRED_FORMAT2(equal2<double>, f_max, f);
+	EXPECT_EQ(n_def, g.n_elem);
+
+	// with 2 defender actions, the minimum can be found by a scan
+	double f_min = infinity<double>();
+	for(double t = 0; t <= 1; t += 1e-4) {
+		prob dt = { t, 1 - t };
+		f_min = std::min(f_min, bayes_subgradient(pi, Cs, dt, g));
+	}
+
+	for(std::string method : { "euclidean", "entropic" }) {
+		auto res = minmax_hidden_bayes(pi, Cs, 1e-2, 100000, method);
+		EXPECT_PRED_FORMAT1(prob_is_proper1<double>, res.second);
+		EXPECT_GE(res.first, f_min - 1e-3);			// the scan is not exact
+		EXPECT_LE(res.first, f_min + 1e-2);
+	}
+
+	// the lp is exact
+	auto res = minmax_hidden_bayes_lp(pi, Cs);
+	EXPECT_PRED_FORMAT1(prob_is_proper1<double>, res.second);
+	EXPECT_PRED_FORMAT2(equal2<double>, res.first, bayes_subgradient(pi, Cs, res.second, g));
+	EXPECT_LE(res.first, f_min + 1e-9);
+	EXPECT_GE(res.first, f_min - 1e-3);
+
+	auto res2 = minmax_hidden_bayes(pi, Cs);					// auto: lp for small games
+	EXPECT_PRED_FORMAT2(equal2<double>, res.first, res2.first);
+
+	EXPECT_ANY_THROW(minmax_hidden_bayes(pi, Cs, 1e-3, 10, "foo"));
+
+	// both players mixing: a bounded number of iterations, returning both average strategies
+	auto both = minmax_hidden_bayes_both(pi, Cs, 200);
+	EXPECT_EQ(n_adv, both.first.n_elem);
+	EXPECT_EQ(n_def, both.second.n_elem);
+	EXPECT_PRED_FORMAT1(prob_is_proper1<double>, both.first);
+	EXPECT_PRED_FORMAT1(prob_is_proper1<double>, both.second);
+	EXPECT_ANY_THROW(minmax_hidden_bayes_both(pi, Cs, 0));
+}
@@ -0,0 +1,76 @@
+#include "tests_aux.h"
+
+using namespace measure;
+
+// define a type-parametrized test case (https://code.google.com/p/googletest/wiki/AdvancedGuide)
+template <typename eT>
+class BatchTest : public BaseTest<eT> {};
+
+TYPED_TEST_SUITE_P(BatchTest);
+
+
+TYPED_TEST_P(BatchTest, Evaluate) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	std::vector<Chan<eT>> Cs = { t.id_10, t.noint_10, t.crand_10, t.c1, channel::randu<eT>(5, 3) };
+	std::vector<batch::Measure> ms = {
+		batch::Measure::smallest_epsilon, batch::Measure::mult_capacity,
+		batch::Measure::g_add_capacity, batch::Measure::shannon_capacity,
+	};
+	batch::Options<eT> opt;
+	opt.d = metric::euclidean<eT, uint>();
+
+	batch::Table<eT> table = batch::evaluate(Cs, ms, opt);
+	EXPECT_EQ(Cs.size(), table.values.n_rows);
+	EXPECT_EQ(ms.size(), table.values.n_cols);
+
+	for(uint i = 0; i < Cs.size(); i++) {
+		const Chan<eT>& C = Cs[i];
+		Prob<eT> unif = probab::uniform<eT>(C.n_rows);
+		EXPECT_PRED_FORMAT2(equal2<eT>, d_privacy::smallest_epsilon(C, opt.d), table.values(i, 0));
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::mult_capacity(C), table.values(i, 1));
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::add_capacity(unif, C), table.values(i, 2));
+		EXPECT_PRED_FORMAT2(equal2<eT>, shannon::add_capacity(C).first, table.values(i, 3));
+	}
+
+	// id leaks the most, noint nothing
+	arma::uvec rank = table.rank(batch::Measure::mult_capacity);
+	EXPECT_EQ(1u, rank(0));
+	EXPECT_EQ(0u, rank(Cs.size() - 1));
+	EXPECT_PRED_FORMAT2(equal2<eT>, table.values(2, 1), table.column(batch::Measure::mult_capacity)(2));
+	EXPECT_ANY_THROW(batch::evaluate(Cs, { batch::Measure::mult_capacity }).column(batch::Measure::shannon_capacity));
+
+	// g_add_capacity on the support of pi
+	batch::Options<eT> opt2;
+	opt2.pi = t.prand_10;
+	opt2.pi(3) = eT(0);
+	std::vector<Chan<eT>> Cs2 = { t.crand_10, t.id_10 };
+	batch::Table<eT> table2 = batch::evaluate(Cs2, { batch::Measure::g_add_capacity }, opt2);
+	for(uint i = 0; i < Cs2.size(); i++)
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::add_capacity(opt2.pi, Cs2[i]), table2.values(i, 0));
+
+	// the distances are computed once per channel size, in the calling thread
+	uint calls = 0;
+	bool other_thread = false;
+	const auto id = std::this_thread::get_id();
+	batch::Options<eT> opt3;
+	opt3.d = [&](uint x1, uint x2) -> eT {
+		calls++;
+		other_thread |= std::this_thread::get_id() != id;
+		return opt.d(x1, x2);
+	};
+	std::vector<Chan<eT>> Cs3 = { t.crand_10, t.id_10, t.noint_10, channel::randu<eT>(5, 3) };
+	batch::Table<eT> table3 = batch::evaluate(Cs3, { batch::Measure::smallest_epsilon }, opt3);
+	EXPECT_EQ(45u + 10u, calls);
+	EXPECT_FALSE(other_thread);
+	for(uint i = 0; i < Cs3.size(); i++)
+		EXPECT_PRED_FORMAT2(equal2<eT>, d_privacy::smallest_epsilon(Cs3[i], opt.d), table3.values(i, 0));
+
+	EXPECT_ANY_THROW(batch::evaluate(Cs, { batch::Measure::smallest_epsilon }));			// no metric
+	EXPECT_ANY_THROW(batch::evaluate(Cs, { batch::Measure::g_add_capacity }, opt2));		// pi of the wrong size
+}
+
+REGISTER_TYPED_TEST_SUITE_P(BatchTest, Evaluate);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(Batch, BatchTest, NativeTypes);
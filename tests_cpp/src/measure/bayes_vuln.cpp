@@ -59,6 +59,60 @@ TYPED_TEST_P(BayesTest, Mult_capacity) {
 	}
 }
 
+TYPED_TEST_P(BayesTest, Incremental) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Chan<eT> C = t.crand_10, other = channel::randu<eT>(10);
+	bayes_vuln::IncrementalPosterior<eT> inc(t.prand_10, C);
+	EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(t.prand_10, C), inc.value());
+
+	for(uint k = 0; k < 10; k++) {
+		uint x = (3 * k) % 10;
+		C.row(x) = other.row(k);
+		inc.set_row(x, other.row(k));
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(t.prand_10, C), inc.value());
+
+		C(k, x) = eT(0);
+		inc.set(k, x, eT(0));
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(t.prand_10, C), inc.value());
+	}
+	C.col(4) = t.id_10.col(2);
+	inc.set_col(4, t.id_10.col(2));
+	EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(t.prand_10, C), inc.value());
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, C, inc.channel());
+}
+
+TYPED_TEST_P(BayesTest, Monitor) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Prob<eT> w = t.prand_10 * eT(10);
+	bayes_vuln::Monitor<eT> mon(t.crand_10, w, 7);		// resyncs during the updates
+
+	for(uint k = 0; k < 20; k++) {
+		uint x = (3 * k) % 10;
+		eT d = k % 3 == 0 ? -w(x) / 2 : eT(k);
+		w(x) += d;
+		mon.add(x, d);
+
+		Prob<eT> pi = w / arma::accu(w);
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::prior(pi), mon.prior());
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, t.crand_10), mon.posterior());
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::mult_leakage(pi, t.crand_10), mon.mult_leakage());
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, pi, mon.prior_dist());
+	}
+
+	w(0) = eT(0);
+	mon.set(0, eT(0));
+	mon.add(arma::ucolvec({ 1, 5 }), Col<eT>({ eT(2), eT(3) }));
+	w(1) += eT(2);
+	w(5) += eT(3);
+	EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(Prob<eT>(w / arma::accu(w)), t.crand_10), mon.posterior());
+
+	EXPECT_ANY_THROW(mon.set(2, eT(-1)));
+}
+
 
 TYPED_TEST_P(BayesTestReals, Min_entropy_leakage) {
 	typedef TypeParam eT;
@@ -81,9 +135,78 @@ TYPED_TEST_P(BayesTestReals, Mult_capacity_bound_cap) {
 	EXPECT_PRED_FORMAT2(equal2<eT>, v, bayes_vuln::mult_capacity_bound_cap(t.id_4, 1e6));
 }
 
+TYPED_TEST_P(BayesTest, Small) {
+	typedef TypeParam eT;
+
+	// small channels go through the unrolled kernels, padding with a zero-probability row gives the general path
+	for(uint n = 1; n <= 3; n++) {
+		for(uint m = 1; m <= 3; m++) {
+			Chan<eT> C = channel::randu<eT>(n, m), Cp = arma::join_vert(C, channel::randu<eT>(1, m));
+			Prob<eT> pi = probab::randu<eT>(n), pip = arma::join_horiz(pi, Prob<eT>(1, arma::fill::zeros));
+			Mat<eT> G = channel::randu<eT>(4, n), Gp = arma::join_horiz(G, Mat<eT>(4, 1, arma::fill::zeros));
+
+			EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pip, Cp), bayes_vuln::posterior(pi, C));
+			EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(Gp, pip, Cp), g_vuln::posterior(G, pi, C));
+			EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(Gp, pip, Cp), l_risk::posterior(G, pi, C));
+		}
+	}
+}
+
+TYPED_TEST_P(BayesTest, CommonDenominator) {
+	typedef TypeParam eT;
+
+	// the definitions, accumulated directly in eT
+	auto naive = [](const Mat<eT>& G, const Prob<eT>& pi, const Chan<eT>& C) {
+		eT sum(0);
+		for(uint y = 0; y < C.n_cols; y++) {
+			eT best(0);
+			for(uint w = 0; w < G.n_rows; w++) {
+				eT v(0);
+				for(uint x = 0; x < C.n_rows; x++)
+					v += G(w, x) * pi(x) * C(x, y);
+				if(w == 0 || v > best)
+					best = v;
+			}
+			sum += best;
+		}
+		return sum;
+	};
+
+	// small denominators (3 and 7), and negative gains
+	Chan<eT> C(6, 5);
+	for(uint x = 0; x < 6; x++)
+		for(uint y = 0; y < 5; y++)
+			C(x, y) = eT(int((x + 2 * y) % 3) + 1) / 7;
+	C = channel::normalize(C);
+	Prob<eT> pi = { eT(1)/3, eT(1)/6, eT(1)/6, eT(1)/9, eT(1)/9, eT(1)/9 };
+	Mat<eT> G(4, 6);
+	for(uint w = 0; w < 4; w++)
+		for(uint x = 0; x < 6; x++)
+			G(w, x) = eT(int((w * x + w) % 5) - 2) / 4;
+
+	Mat<eT> Id = channel::identity<eT>(6);
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive(Id, pi, C), bayes_vuln::posterior(pi, C));
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive(G, pi, C), g_vuln::posterior(G, pi, C));
+
+	if constexpr (std::is_same<eT, rat>::value) {
+		rat res;
+		EXPECT_TRUE(rat_aux::bayes_posterior(pi.memptr(), C.memptr(), C.n_rows, C.n_cols, res));
+		EXPECT_EQ(naive(Id, pi, C), res);
+		EXPECT_TRUE(rat_aux::g_posterior(G.memptr(), G.n_rows, pi.memptr(), C.memptr(), C.n_rows, C.n_cols, false, res));
+		EXPECT_EQ(naive(G, pi, C), res);
+
+		// coprime denominators of ~2^40, whose lcm overflows int64: same result through the mppp arithmetic
+		rat p1(1, 1099511627791LL), p2(1, 1099511627817LL);
+		Prob<eT> pi2 = { p1, p2, 1 - p1 - p2, rat(0), rat(0), rat(0) };
+		EXPECT_FALSE(rat_aux::bayes_posterior(pi2.memptr(), C.memptr(), C.n_rows, C.n_cols, res));
+		EXPECT_EQ(naive(Id, pi2, C), bayes_vuln::posterior(pi2, C));
+		EXPECT_EQ(naive(G, pi2, C), g_vuln::posterior(G, pi2, C));
+	}
+}
+
 // run the BayesTest test-case for all types, and the BayesTestReals only for double/float
 //
-REGISTER_TYPED_TEST_SUITE_P(BayesTest, Vulnerability, Post_vulnerability, Mult_capacity);
+REGISTER_TYPED_TEST_SUITE_P(BayesTest, Vulnerability, Post_vulnerability, Mult_capacity, Incremental, Monitor, Small, CommonDenominator);
 REGISTER_TYPED_TEST_SUITE_P(BayesTestReals, Min_entropy_leakage, Mult_capacity_bound_cap);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Bayes, BayesTest, AllTypes);
@@ -44,8 +44,73 @@ TYPED_TEST_P(MeasureDPrivTest, Smallest_epsilon) {
 	EXPECT_PRED_FORMAT2(equal2<eT>, std::log(7.0/2), smallest_epsilon(C, d));
 }
 
+TYPED_TEST_P(MeasureDPrivTest, Log_kernel) {
+	typedef TypeParam eT;
+
+	// the log-channel kernel should agree with the generic lipschitz_constant, also with zeros in the channel
+	Chan<eT> C = channel::randu<eT>(30, 8);
+	C.col(0).zeros();
+	channel::normalize(C);
+
+	auto d = eT(2) * metric::euclidean<eT, uint>();
+	auto mtv = metric::mult_total_variation<eT, Prob<eT>>();
+	auto rows = [&](uint x) -> Prob<eT> { return C.row(x); };
+
+	eT eps = metric::lipschitz_constant<eT,uint,Prob<eT>>(rows, d, mtv, range<uint>(0, 30));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eps, smallest_epsilon(C, d));
+	EXPECT_TRUE (is_private(C, (eps + eT(0.01)) * d));
+	EXPECT_FALSE(is_private(C, (eps - eT(0.01)) * d));
+
+	// a zero in a single row gives infinite epsilon
+	C(5, 1) = 0;
+	channel::normalize(C);
+	EXPECT_PRED_FORMAT2(equal2<eT>, infinity<eT>(), smallest_epsilon(C, d));
+	EXPECT_FALSE(is_private(C, eT(1000) * d));
+
+	// skipping chainable pairs does not change the result on the geometric mechanism
+	Chan<eT> geom = mechanism::d_privacy::geometric<eT>(30, eT(0.7));
+	auto chain = metric::euclidean_chain<uint>();
+	auto euclid = metric::euclidean<eT, uint>();
+	EXPECT_PRED_FORMAT2(equal2<eT>, smallest_epsilon(geom, euclid), smallest_epsilon(geom, euclid, chain));
+	EXPECT_TRUE (is_private(geom, eT(0.7) * euclid, chain));
+	EXPECT_FALSE(is_private(geom, eT(0.69) * euclid, chain));
+}
+
+TYPED_TEST_P(MeasureDPrivTest, Prior) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	auto euclid = metric::euclidean<eT, uint>();
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(0), prior(t.unif_10, euclid));
+	EXPECT_PRED_FORMAT2(equal2<eT>, infinity<eT>(), prior(t.point_10, euclid));
+
+	Prob<eT> pi = probab::randu<eT>(40);
+	eT naive(0);
+	for(uint i = 0; i < 40; i++)
+		for(uint j = i+1; j < 40; j++)
+			naive = std::max(naive, std::abs(std::log(pi(i)) - std::log(pi(j))) / eT(j - i));
+
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive, prior(pi, euclid));
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive, prior(pi, euclid, metric::euclidean_chain<uint>()));
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive, prior_line(pi));
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive / 2, prior_line(pi, eT(2)));
+
+	// arbitrary positions, given in shuffled order
+	Row<eT> pos = arma::linspace<Row<eT>>(0, 39, 40);
+	arma::uvec perm = arma::randperm(40);
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive, prior_line(Prob<eT>(pi.cols(perm)), Row<eT>(pos.cols(perm))));
+	pos = arma::square(pos);
+	Mat<eT> M = arma::abs(arma::repmat(pos.t(), 1, 40) - arma::repmat(pos, 40, 1));
+	EXPECT_PRED_FORMAT2(equal2<eT>, prior(pi, metric::from_distance_matrix(M)), prior_line(pi, pos));
+
+	// 8 x 5 grid
+	auto grid = metric::grid_manhattan<eT>(8, 5, eT(0.5));
+	EXPECT_PRED_FORMAT2(equal2<eT>, prior(pi, grid), prior_grid(pi, 8, eT(0.5)));
+	ASSERT_ANY_THROW(prior_grid(pi, 7););
+}
+
 
-REGISTER_TYPED_TEST_SUITE_P(MeasureDPrivTest, Is_private, Smallest_epsilon);
+REGISTER_TYPED_TEST_SUITE_P(MeasureDPrivTest, Is_private, Smallest_epsilon, Log_kernel, Prior);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Mech, MeasureDPrivTest, NativeTypes);
 
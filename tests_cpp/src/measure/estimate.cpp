@@ -0,0 +1,59 @@
+#include "tests_aux.h"
+
+using namespace measure;
+
+// define a type-parametrized test case (https://code.google.com/p/googletest/wiki/AdvancedGuide)
+template <typename eT>
+class EstimateTest : public BaseTest<eT> {};
+
+TYPED_TEST_SUITE_P(EstimateTest);
+
+
+TYPED_TEST_P(EstimateTest, Bayes_vuln) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	estimate::Options opt;
+	opt.target_width = 0.01;
+	opt.seed = 42;
+
+	for(auto& C : { t.id_10, t.noint_10, t.crand_10 }) {
+		double real = to_double(bayes_vuln::posterior(t.prand_10, C));
+		estimate::Result res = estimate::bayes_vuln(t.prand_10, C, opt);
+
+		EXPECT_LE(res.upper - res.lower, opt.target_width);
+		EXPECT_NEAR(real, res.value, opt.target_width);
+		EXPECT_NEAR(real, res.plugin, opt.target_width);
+		EXPECT_LE(res.lower, res.value);
+	}
+
+	// same seed, same result
+	EXPECT_EQ(estimate::bayes_vuln(t.prand_10, t.crand_10, opt).value, estimate::bayes_vuln(t.prand_10, t.crand_10, opt).value);
+}
+
+TYPED_TEST_P(EstimateTest, G_vuln) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	estimate::Options opt;
+	opt.target_width = 0.02;
+	opt.seed = 7;
+
+	// channel given as a function: output x+1 or x-1 (mod 10) with equal probability
+	estimate::Sampler walk = [](uint x, rng::Engine& gen) { return (x + (rng::randu<double>(gen) < 0.5 ? 1 : 9)) % 10; };
+	Chan<eT> C = arma::zeros<Chan<eT>>(10, 10);
+	for(uint x = 0; x < 10; x++)
+		C(x, (x + 1) % 10) = C(x, (x + 9) % 10) = eT(1)/2;
+
+	Mat<eT> G = channel::randu<eT>(5, 10);
+	double real = to_double(g_vuln::posterior(G, t.prand_10, C));
+	estimate::Result res = estimate::g_vuln(G, t.prand_10, walk, opt);
+	EXPECT_NEAR(real, res.value, opt.target_width);
+	EXPECT_LE(res.upper - res.lower, opt.target_width);
+
+	EXPECT_NEAR(to_double(bayes_vuln::posterior(t.prand_10, C)), estimate::bayes_vuln(t.prand_10, walk, opt).value, opt.target_width);
+}
+
+REGISTER_TYPED_TEST_SUITE_P(EstimateTest, Bayes_vuln, G_vuln);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(Estimate, EstimateTest, NativeTypes);
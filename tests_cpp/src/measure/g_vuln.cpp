@@ -43,6 +43,29 @@ TYPED_TEST_P(GainTest, Post_vulnerability) {
 	EXPECT_PRED_FORMAT2(equal2<eT>, eT(31)/40, g_vuln::posterior(t.id_2, t.pi4, t.c1));
 
 	ASSERT_ANY_THROW(g_vuln::posterior(t.id_10, t.unif_2, t.id_10));
+
+	// channel with more columns than a single panel, compare with the direct formula
+	Chan<eT> C = channel::randu<eT>(10, 150);
+	Mat<eT> G = channel::randu<eT>(7, 10) - eT(1)/5;
+	Mat<eT> J = C.each_col() % t.prand_10.t();
+	EXPECT_PRED_FORMAT2(equal2<eT>, arma::accu(arma::max(G * J)), g_vuln::posterior(G, t.prand_10, C));
+	EXPECT_PRED_FORMAT2(equal2<eT>, arma::accu(arma::max(G * C)) / 10, g_vuln::posterior(G, t.unif_10, C));
+	EXPECT_PRED_FORMAT2(equal2<eT>, arma::accu(arma::min(G * J)), l_risk::posterior(G, t.prand_10, C));
+
+	// batch of priors
+	Mat<eT> Pis = channel::randu<eT>(5, 10);
+	Pis.row(2) = t.unif_10;
+	Col<eT> Vg = g_vuln::posterior(G, Pis, C);
+	Col<eT> Rl = l_risk::posterior(G, Pis, C);
+	Col<eT> Vb = bayes_vuln::posterior(Pis, C);
+	ASSERT_EQ(5u, Vg.n_elem);
+	for(uint k = 0; k < Pis.n_rows; k++) {
+		Prob<eT> pi = Pis.row(k);
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, C), Vg(k));
+		EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(G, pi, C), Rl(k));
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, C), Vb(k));
+	}
+	ASSERT_ANY_THROW(g_vuln::posterior(G, Mat<eT>(Pis.t()), C));
 }
 
 TYPED_TEST_P(GainTest, Add_capacity) {
@@ -61,9 +84,178 @@ TYPED_TEST_P(GainTest, Add_capacity) {
 	ASSERT_ANY_THROW(g_vuln::add_capacity(t.unif_2, t.id_10));
 }
 
+TYPED_TEST_P(GainTest, Grid_metric) {
+	typedef TypeParam eT;
+
+	// grid metrics go through FFT convolution, compare with the distance matrix
+	uint width = 5, height = 3, n = width * height;
+	auto g = metric::grid_euclidean<eT>(width, height).transform([](eT d) -> eT { return eT(3) - d; });
+	auto l = metric::grid_manhattan<eT>(width, height, eT(1)/2);
+	Mat<eT> G = metric::to_distance_matrix(Metric<eT, uint>(g), n);
+	Mat<eT> L = metric::to_distance_matrix(Metric<eT, uint>(l), n);
+
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(3) - eT(std::sqrt(5.0)), g(0, 2 * width + 1));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(3)/2, l(0, 2 * width + 1));
+
+	Prob<eT> pi = probab::randu<eT>(n);
+	Chan<eT> C = channel::randu<eT>(n, 40);
+	C.col(3).zeros();
+
+	EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::prior(G, pi), g_vuln::prior(g, pi));
+	EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, C), g_vuln::posterior(g, pi, C));
+	EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::prior(L, pi), l_risk::prior(l, pi));
+	EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(L, pi, C), l_risk::posterior(l, pi, C));
+	EXPECT_TRUE(arma::all(g_vuln::strategy(G, pi, C) == g_vuln::strategy(g, pi, C)));
+	EXPECT_TRUE(arma::all(l_risk::strategy(L, pi, C) == l_risk::strategy(l, pi, C)));
+
+	ASSERT_ANY_THROW(g_vuln::posterior(g, probab::uniform<eT>(n + 1), C));
+}
+
+TYPED_TEST_P(GainTest, Context) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Mat<eT> G = metric::to_distance_matrix<eT>(metric::euclidean<eT, uint>(), 10);
+	for(auto& pi : { t.unif_10, t.prand_10, t.point_10 }) {
+		channel::PosteriorContext<eT> ctx(pi, t.crand_10);
+
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, t.crand_10), bayes_vuln::posterior(ctx));
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(t.id_10, pi, t.crand_10), g_vuln::posterior(t.id_10, ctx));
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, t.crand_10), g_vuln::posterior(G, ctx));
+		EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(G, pi, t.crand_10), l_risk::posterior(G, ctx));
+		EXPECT_PRED_FORMAT2(equal2<eT>, guessing::posterior(pi, t.crand_10), guessing::posterior(ctx));
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::mult_leakage(G, pi, t.crand_10), g_vuln::mult_leakage(G, ctx));
+
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(pi * t.crand_10), ctx.outer());
+		EXPECT_PRED_FORMAT2(chan_equal2<eT>, channel::posteriors(t.crand_10, pi), ctx.posteriors());
+	}
+
+	// the hyper is reduced: duplicate columns are merged, zero ones dropped
+	Chan<eT> B = channel::randu<eT>(10, 4);
+	Chan<eT> C = arma::join_rows(arma::zeros<Chan<eT>>(10, 1), arma::join_rows(B, B) / eT(2));
+	channel::PosteriorContext<eT> ctx(t.prand_10, C);
+	const channel::Hyper<eT>& h = ctx.hyper();
+	ASSERT_EQ(B.n_cols, h.outer.n_cols);
+	ASSERT_EQ(B.n_cols, h.inners.n_cols);
+	Prob<eT> outer_B = t.prand_10 * B;
+	Mat<eT> inners_B = channel::posteriors(B, t.prand_10);
+	for(uint y = 0; y < B.n_cols; y++) {
+		bool found = false;
+		for(uint j = 0; j < h.outer.n_cols; j++)
+			if(channel::equal<eT>(inners_B.col(y), h.inners.col(j)) && qif::equal(outer_B(y), h.outer(j)))
+				found = true;
+		EXPECT_TRUE(found);
+	}
+
+	ASSERT_ANY_THROW(channel::PosteriorContext<eT>(t.unif_2, t.id_10));
+}
+
+TYPED_TEST_P(GainTest, Incremental) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Mat<eT> G = metric::to_distance_matrix<eT>(metric::euclidean<eT, uint>(), 10);
+	Chan<eT> C = t.crand_10, other = channel::randu<eT>(10);
+	g_vuln::IncrementalPosterior<eT> gain(G, t.prand_10, C), loss(G, t.prand_10, C, true);
+	utility::IncrementalExpectedDistance<eT> dist(G, t.prand_10, C);
+
+	for(uint k = 0; k < 10; k++) {
+		uint x = (7 * k) % 10;
+		Chan<eT> D = C;
+		D.row(x) = other.row(k);
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, t.prand_10, D), gain.value_with_row(x, other.row(k)));
+		EXPECT_PRED_FORMAT2(equal2<eT>, utility::expected_distance(G, t.prand_10, D), dist.value_with_row(x, other.row(k)));
+
+		C = D;
+		gain.set_row(x, other.row(k));
+		loss.set_row(x, other.row(k));
+		dist.set_row(x, other.row(k));
+		C(k, 9-k) = eT(1)/2;
+		gain.set(k, 9-k, eT(1)/2);
+		loss.set(k, 9-k, eT(1)/2);
+		dist.set(k, 9-k, eT(1)/2);
+
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, t.prand_10, C), gain.value());
+		EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(G, t.prand_10, C), loss.value());
+		EXPECT_PRED_FORMAT2(equal2<eT>, utility::expected_distance(G, t.prand_10, C), dist.value());
+	}
+	C.col(3) = t.id_10.col(5);
+	gain.set_col(3, t.id_10.col(5));
+	EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, t.prand_10, C), gain.value());
+}
+
+TYPED_TEST_P(GainTest, Monitor) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Mat<eT> G = metric::to_distance_matrix<eT>(metric::euclidean<eT, uint>(), 10);
+	Prob<eT> w = t.prand_10 * eT(10);
+	g_vuln::Monitor<eT> gain(G, t.crand_10, w, false, 5), loss(G, t.crand_10, w, true, 5);
+
+	for(uint k = 0; k < 12; k++) {
+		uint x = (7 * k) % 10;
+		eT d = k % 2 == 0 ? -w(x) / 3 : eT(k);
+		w(x) += d;
+		gain.add(x, d);
+		loss.add(x, d);
+
+		Prob<eT> pi = w / arma::accu(w);
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::prior(G, pi), gain.prior());
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, t.crand_10), gain.posterior());
+		EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(G, pi, t.crand_10), loss.posterior());
+	}
+}
+
+TYPED_TEST_P(GainTest, Strategies) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	// the batched strategies agree with one strategy call per prior
+	Mat<eT> G = metric::to_distance_matrix<eT>(metric::euclidean<eT, uint>(), 10);
+	Mat<eT> priors(3, 10);
+	priors.row(0) = t.unif_10;
+	priors.row(1) = t.prand_10;
+	priors.row(2) = t.point_10;
+
+	arma::umat S = g_vuln::strategies(G, priors, t.crand_10);
+	arma::umat R = l_risk::strategies(G, priors, t.crand_10);
+	ASSERT_EQ(10u, S.n_rows);
+	ASSERT_EQ(3u, S.n_cols);
+	for(uint k = 0; k < 3; k++) {
+		Prob<eT> pi = priors.row(k);
+		EXPECT_TRUE(arma::all(g_vuln::strategy(G, pi, t.crand_10) == S.col(k)));
+		EXPECT_TRUE(arma::all(l_risk::strategy(G, pi, t.crand_10) == R.col(k)));
+
+		// and with a direct computation: the chosen guess has the best value for each output (compared by value
+		// since ties can be broken either way)
+		for(uint y = 0; y < t.crand_10.n_cols; y++) {
+			auto value = [&](uint w) {
+				eT v(0);
+				for(uint x = 0; x < G.n_cols; x++)
+					v += G(w, x) * pi(x) * t.crand_10(x, y);
+				return v;
+			};
+			eT best_g = value(0), best_l = value(0);
+			for(uint w = 1; w < G.n_rows; w++) {
+				best_g = std::max(best_g, value(w));
+				best_l = std::min(best_l, value(w));
+			}
+			EXPECT_PRED_FORMAT2(equal2<eT>, best_g, value(S(y, k)));
+			EXPECT_PRED_FORMAT2(equal2<eT>, best_l, value(R(y, k)));
+		}
+	}
+
+	// remapping by a strategy is the product with the deterministic channel
+	arma::ucolvec s = S.col(1);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Chan<eT>(t.crand_10 * channel::deterministic<eT>(s, 10)), channel::remap(t.crand_10, s, 10));
+	s(0) = 10;
+	ASSERT_ANY_THROW(channel::remap(t.crand_10, s, 10));
+	ASSERT_ANY_THROW(channel::remap(t.crand_10, arma::ucolvec(3, arma::fill::zeros), 10));
+}
+
 // run the GainTest test-case for all types
 //
-REGISTER_TYPED_TEST_SUITE_P(GainTest, Vulnerability, Post_vulnerability, Add_capacity);
+REGISTER_TYPED_TEST_SUITE_P(GainTest, Vulnerability, Post_vulnerability, Add_capacity, Grid_metric, Context, Incremental, Monitor, Strategies);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Gain, GainTest, AllTypes);
 
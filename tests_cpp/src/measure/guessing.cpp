@@ -42,10 +42,49 @@ TYPED_TEST_P(GuessingTest, Post_entropy) {
 	ASSERT_ANY_THROW(guessing::posterior(t.unif_2, t.id_10));
 }
 
+TYPED_TEST_P(GuessingTest, Large) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	// columns with more than 256 positive entries go through the radix sort, half of the entries of the other ones
+	// are zero
+	Chan<eT> C = channel::randu<eT>(300, 12);
+	for(uint y = 6; y < C.n_cols; y++)
+		for(uint x = 0; x < C.n_rows; x += 2)
+			C(x, y) = 0;
+	C.each_col() /= arma::sum(C, 1);
+	Prob<eT> pi = probab::randu<eT>(300);
+
+	auto naive = [](Prob<eT> v, uint k) {
+		v = arma::sort(v, "descend");
+		eT sum(0);
+		for(uint i = 0; i < v.n_cols; i++)
+			sum += eT(std::min(i + 1, k)) * v(i);
+		return sum;
+	};
+	eT post(0), post3(0);
+	for(uint y = 0; y < C.n_cols; y++) {
+		Prob<eT> vy = pi % arma::trans(C.col(y));
+		post += naive(vy, C.n_rows);
+		post3 += naive(vy, 3);
+	}
+
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive(pi, pi.n_cols), guessing::prior(pi));
+	EXPECT_PRED_FORMAT2(equal2<eT>, post, guessing::posterior(pi, C));
+	EXPECT_PRED_FORMAT2(equal2<eT>, post, guessing::posterior(channel::PosteriorContext<eT>(pi, C)));
+
+	// bounded number of attempts
+	EXPECT_PRED_FORMAT2(equal2<eT>, guessing::prior(pi), guessing::prior_k(pi, 300));
+	EXPECT_PRED_FORMAT2(equal2<eT>, naive(pi, 3), guessing::prior_k(pi, 3));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(1), guessing::prior_k(t.unif_10, 1));
+	EXPECT_PRED_FORMAT2(equal2<eT>, post3, guessing::posterior_k(pi, C, 3));
+	EXPECT_PRED_FORMAT2(equal2<eT>, post, guessing::posterior_k(pi, C, 1000));
+}
+
 
 // run the GuessingTest test-case for all types
 //
-REGISTER_TYPED_TEST_SUITE_P(GuessingTest, Vulnerability, Post_entropy);
+REGISTER_TYPED_TEST_SUITE_P(GuessingTest, Vulnerability, Post_entropy, Large);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Guessing, GuessingTest, AllTypes);
 
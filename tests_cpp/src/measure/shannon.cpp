@@ -38,6 +38,7 @@ TYPED_TEST_P(ShannonTest, Cond_entropy) {
 	EXPECT_PRED_FORMAT2(equal2<eT>, shannon::prior(pi), shannon::posterior(pi, t.noint_10));
 
 	EXPECT_PRED_FORMAT2(equal2<eT>, 0.669020059980807, shannon::posterior(t.pi3, t.c1));
+	EXPECT_PRED_FORMAT2(equal2<eT>, 0.669020059980807, shannon::posterior(channel::PosteriorContext<eT>(t.pi3, t.c1)));
 
 	ASSERT_ANY_THROW(shannon::posterior<eT>(t.unif_2, t.id_10););
 }
@@ -78,9 +79,110 @@ TYPED_TEST_P(ShannonTest, Capacity) {
 }
 
 
+TYPED_TEST_P(ShannonTest, Capacity_bounds) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	eT cap = 0.19123813831431799;
+
+	// few iterations: a certified interval
+	auto [IL, IU, pi] = shannon::add_capacity_bounds(t.c1, def_md<eT>, def_mrd<eT>, 2);
+	EXPECT_TRUE(less_than_or_eq(IL, cap));
+	EXPECT_TRUE(less_than_or_eq(cap, IU));
+	EXPECT_PRED_FORMAT2(equal2<eT>, IL, shannon::add_leakage(pi, t.c1));
+
+	// plain and accelerated iterations converge to the same value
+	auto [IL1, IU1, pi1] = shannon::add_capacity_bounds(t.c1, def_md<eT>, def_mrd<eT>, std::numeric_limits<uint>::max(), std::numeric_limits<double>::infinity(), false);
+	auto [IL2, IU2, pi2] = shannon::add_capacity_bounds(t.c1);
+	EXPECT_PRED_FORMAT2(equal2<eT>, cap, IL1);
+	EXPECT_PRED_FORMAT2(equal2<eT>, cap, IL2);
+	EXPECT_PRED_FORMAT2(equal2<eT>, IL2, IU2);
+}
+
+TYPED_TEST_P(ShannonTest, Checkpoint) {
+	typedef TypeParam eT;
+	typedef shannon::CapacityState<eT> State;
+
+	Chan<eT> C = channel::randu<eT>(30, 20);
+	const uint max_iter = 200;
+
+	for(bool accelerate : { false, true }) {
+		auto [IL, IU, pi] = shannon::add_capacity_bounds(C, def_md<eT>, def_mrd<eT>, max_iter, std::numeric_limits<double>::infinity(), accelerate);
+
+		// keep the first saved state, resuming from it (after a round-trip through pack) gives the same result
+		checkpoint::Hook<State> hook;
+		hook.every = 1;
+		std::optional<State> first;
+		hook.save = [&](const State& s) { if(!first) first = s; };
+		shannon::add_capacity_bounds(C, def_md<eT>, def_mrd<eT>, max_iter, std::numeric_limits<double>::infinity(), accelerate, hook);
+		ASSERT_TRUE(first.has_value());
+
+		checkpoint::Hook<State> resume;
+		resume.resume = State::unpack(first->pack());
+		auto [IL2, IU2, pi2] = shannon::add_capacity_bounds(C, def_md<eT>, def_mrd<eT>, max_iter, std::numeric_limits<double>::infinity(), accelerate, resume);
+		EXPECT_EQ(IL, IL2);
+		EXPECT_EQ(IU, IU2);
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, pi, pi2);
+	}
+
+	checkpoint::Hook<State> wrong;
+	wrong.resume = State{ 1, probab::uniform<eT>(3), {}, probab::uniform<eT>(3), 0, 1, 0 };
+	EXPECT_ANY_THROW(shannon::add_capacity_bounds(C, def_md<eT>, def_mrd<eT>, max_iter, 1.0, true, wrong));
+}
+
+TYPED_TEST_P(ShannonTest, Fast_log2) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	for(double a : { 1e-300, 1e-10, 0.1, 0.5, 0.7071, 0.7072, 1.0, 1.4142, 1.4143, 3.0, 1e10 })
+		EXPECT_NEAR(std::log2(a), shannon::aux::fast_log2(a), 2e-9);
+
+	// a channel wide enough to be split in blocks of rows computed in parallel
+	Chan<eT> C = channel::randu<eT>(600, 200);
+	C.col(3).zeros();
+	C.each_col() /= arma::sum(C, 1);
+	Prob<eT> pi = probab::randu<eT>(600);
+
+	eT H = 0;
+	for(uint x = 0; x < C.n_rows; x++)
+		H += pi(x) * shannon::prior<eT>(C.row(x));
+	H += shannon::prior(pi) - shannon::prior<eT>(pi * C);
+	EXPECT_PRED_FORMAT2(equal2<eT>, H, shannon::posterior(pi, C));
+
+	// the fast mode gives the same results, up to the accuracy of the type
+	shannon::set_fast_log2(true);
+	EXPECT_TRUE(shannon::get_fast_log2());
+	EXPECT_PRED_FORMAT2(equal2<eT>, 0.721928094887362, shannon::prior(t.pi1));
+	EXPECT_PRED_FORMAT2(equal2<eT>, 0, shannon::prior(t.point_4));
+	EXPECT_PRED_FORMAT2(equal2<eT>, 0.669020059980807, shannon::posterior(t.pi3, t.c1));
+	EXPECT_PRED_FORMAT2(equal2<eT>, H, shannon::posterior(pi, C));
+	shannon::set_fast_log2(false);
+}
+
+TYPED_TEST_P(ShannonTest, Small) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	// compile-time sized types go through the unrolled kernel
+	FixedChan<eT, 2, 2> C = t.c1;
+	FixedProb<eT, 2> pi = t.pi1;
+
+	eT H = 0;
+	for(uint x = 0; x < 2; x++)
+		H += pi(x) * shannon::prior<eT>(C.row(x));
+	H += shannon::prior<eT>(pi) - shannon::prior<eT>(pi * C);
+	EXPECT_PRED_FORMAT2(equal2<eT>, H, shannon::posterior<eT>(pi, C));
+
+	for(uint n = 1; n <= 3; n++) {
+		Chan<eT> D = channel::randu<eT>(n, 3), Dp = arma::join_vert(D, channel::randu<eT>(1, 3));
+		Prob<eT> rho = probab::randu<eT>(n), rhop = arma::join_horiz(rho, Prob<eT>(1, arma::fill::zeros));
+		EXPECT_PRED_FORMAT2(equal2<eT>, shannon::posterior(rhop, Dp), shannon::posterior(rho, D));
+	}
+}
+
 // run the ChanTest test-case for double, float
 //
-REGISTER_TYPED_TEST_SUITE_P(ShannonTest, Entropy, Cond_entropy, Capacity);
+REGISTER_TYPED_TEST_SUITE_P(ShannonTest, Entropy, Cond_entropy, Capacity, Capacity_bounds, Checkpoint, Fast_log2, Small);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Shannon, ShannonTest, NativeTypes);
 
@@ -23,6 +23,10 @@ TYPED_TEST_P(MechDPrivTest, Reals) {
 	Chan<eT> expon = exponential<eT>(size, epsilon * d);
 	Chan<eT> tc = tight_constraints<eT>(size, epsilon * d);
 
+	// from a distance matrix, and from the shortest paths of a line graph
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, expon, exponential(metric::to_distance_matrix<eT>(epsilon * d, size)));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, expon, exponential(size, metric::graph(metric::Graph<eT>::grid(size, 1, epsilon * step))));
+
 	// tight constraints with first/last and middle coeffs forced to be equal
 	arma::uvec cols(size, arma::fill::ones);
 	cols(0) = cols(size-1) = 0;
@@ -172,8 +176,270 @@ TYPED_TEST_P(MechDPrivTest, OptExpLoss) {
 	EXPECT_PRED_FORMAT2(chan_equal2<eT>, t.id_10, opt);
 }
 
+TYPED_TEST_P(MechDPrivTest, OptExpLossNeighbours) {
+	typedef TypeParam eT;
+	namespace ex = metric::expr;
+
+	uint width = 3,
+		 size = width * width;
+	eT epsilon = 0.9;
+
+	// manhattan on a grid reports its neighbourhood, so only constraints between adjacent cells are created.
+	// The result should be the same as using manhattan_chain explicitly.
+	Prob<eT> pi = probab::uniform<eT>(size);
+	auto d_ex = epsilon * ex::grid(width, ex::manhattan<eT, Point<uint>>());
+	auto d = epsilon * metric::grid<eT>(width, metric::manhattan<eT, Point<uint>>());
+	auto d_ch = metric::compose<bool, uint, Point<uint>>(metric::manhattan_chain<Point<uint>>(), geo::cell_to_point<uint>(width));
+	auto loss = metric::euclidean<eT, uint>();
+
+	EXPECT_TRUE(ex::has_neighbours<decltype(d_ex)>::value);
+	EXPECT_EQ(8u, d_ex.neighbours(4).size());
+	EXPECT_EQ(3u, d_ex.neighbours(0).size());
+
+	Chan<eT> opt1 = min_loss_given_d<eT>(pi, size, d_ex, loss);
+	Chan<eT> opt2 = min_loss_given_d<eT>(pi, size, d, loss, "all", d_ch);
+
+	auto exp_loss = [&](const Chan<eT>& C) {
+		eT res(0);
+		for(uint x = 0; x < size; x++)
+			for(uint y = 0; y < size; y++)
+				res += pi(x) * C(x, y) * loss(x, y);
+		return res;
+	};
+
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, opt1, size, size);
+	EXPECT_PRED_FORMAT4(equal4<eT>, exp_loss(opt2), exp_loss(opt1), 1e-5, 0);
+}
+
+TYPED_TEST_P(MechDPrivTest, OptExpLossComponents) {
+	typedef TypeParam eT;
+
+	uint size = 10;
+	eT epsilon = 0.9;
+
+	// inputs 0..4 and 5..9 are far apart, threshold_inf leaves no constraint between them, so the program is split in
+	// two components. The result should be the same as solving each of them on its own.
+	Metric<eT, uint> pos_d = [](const uint& x, const uint& y) -> eT {
+		auto pos = [](uint z) { return int(z < 5 ? z : z + 10); };
+		return std::abs(pos(x) - pos(y));
+	};
+	auto d = metric::threshold_inf<eT>(epsilon * pos_d, epsilon * eT(5));
+	auto loss = metric::euclidean<eT, uint>();
+	Prob<eT> pi = probab::randu<eT>(size);
+
+	auto exp_loss = [&](const Prob<eT>& pi, const Chan<eT>& C, const Metric<eT, uint>& loss) {
+		eT res(0);
+		for(uint x = 0; x < C.n_rows; x++)
+			for(uint y = 0; y < C.n_cols; y++)
+				res += pi(x) * C(x, y) * loss(x, y);
+		return res;
+	};
+
+	Chan<eT> opt = min_loss_given_d<eT>(pi, size, d, loss);
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, opt, size, size);
+
+	eT expected(0);
+	for(uint first : { 0u, 5u }) {
+		Prob<eT> sub_pi = pi.cols(first, first + 4);
+		eT mass = arma::accu(sub_pi);
+		sub_pi /= mass;
+
+		Metric<eT, uint> sub_d = [&](const uint& i, const uint& j) { return d(first + i, first + j); };
+		Metric<eT, uint> sub_loss = [&](const uint& i, const uint& y) { return loss(first + i, y); };
+		Chan<eT> sub_opt = min_loss_given_d<eT>(sub_pi, size, sub_d, sub_loss);
+
+		expected += mass * exp_loss(sub_pi, sub_opt, sub_loss);
+		for(uint i = 0; i < 5; i++)
+			for(uint j = 0; j < 5; j++)
+				for(uint y = 0; y < size; y++)
+					EXPECT_TRUE(less_than_or_eq<eT>(opt(first + i, y), std::exp(sub_d(i, j)) * opt(first + j, y) + eT(1e-5)));
+	}
+	EXPECT_PRED_FORMAT4(equal4<eT>, expected, exp_loss(pi, opt, loss), 1e-5, 0);
+}
+
+TYPED_TEST_P(MechDPrivTest, Operator) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	Chan<eT> rr = randomized_response<eT>(10, eT(0.7)), geom = geometric<eT>(10, eT(0.7));
+	channel::OperatorChan<eT> rr_op = randomized_response_operator<eT>(10, eT(0.7)), geom_op = geometric_operator<eT>(10, eT(0.7));
+
+	Row<eT> res;
+	rr_op.left(t.prand_10, res);
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(t.prand_10 * rr), res);
+	rr_op.right(t.prand_10, res);
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>((rr * t.prand_10.t()).t()), res);
+
+	geom_op.left(t.prand_10, res);
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(t.prand_10 * geom), res);
+	geom_op.right(t.prand_10, res);
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>((geom * t.prand_10.t()).t()), res);
+}
+
+TYPED_TEST_P(MechDPrivTest, Structured) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	const uint n = 10;
+	eT eps(0.7);
+	Chan<eT> rr = randomized_response<eT>(n, eps),
+			 geom = geometric<eT>(n, eps),
+			 expo = exponential<eT>(n, eps * metric::euclidean<eT,uint>());
+	auto rr_s = randomized_response_chan<eT>(n, eps);
+	auto geom_s = geometric_chan<eT>(n, eps);
+	auto expo_s = exponential_chan<eT>(n, eps);
+
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, rr, rr_s.materialize());
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, geom, geom_s.materialize());
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, expo, expo_s.materialize());
+
+	Mat<eT> G = metric::to_distance_matrix<eT>(metric::euclidean<eT,uint>(), n);
+	for(auto& pi : { t.unif_10, t.prand_10, t.point_10 }) {
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, rr), bayes_vuln::posterior(pi, rr_s));
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, geom), bayes_vuln::posterior(pi, geom_s));
+		EXPECT_PRED_FORMAT2(equal2<eT>, bayes_vuln::posterior(pi, expo), bayes_vuln::posterior(pi, expo_s));
+
+		EXPECT_PRED_FORMAT2(equal2<eT>, g_vuln::posterior(G, pi, geom), g_vuln::posterior(G, pi, geom_s));
+		EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(G, pi, rr), l_risk::posterior(G, pi, rr_s));
+		EXPECT_PRED_FORMAT2(equal2<eT>, l_risk::posterior(G, pi, expo), l_risk::posterior(G, pi, expo_s));
+
+		EXPECT_PRED_FORMAT2(prob_equal2<eT>, channel::posterior(geom, pi, 3), channel::posterior(geom_s, pi, 3));
+	}
+	EXPECT_TRUE(arma::all(bayes_vuln::strategy(t.prand_10, rr) == bayes_vuln::strategy(t.prand_10, rr_s)));
+	EXPECT_TRUE(arma::all(bayes_vuln::strategy(t.prand_10, geom) == bayes_vuln::strategy(t.prand_10, geom_s)));
+
+	// sampling: empirical output distribution close to pi C
+	const uint n_samples = 200000;
+	auto output_freq = [&](const Mat<uint>& s) {
+		Row<eT> freq = arma::zeros<Row<eT>>(n);
+		for(uint k = 0; k < n_samples; k++)
+			freq(s(k, 1)) += eT(1) / n_samples;
+		return Chan<eT>(freq);
+	};
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, Chan<eT>(t.prand_10 * geom), output_freq(channel::sample(geom_s, t.prand_10, n_samples)), eT(0.01), eT(0));
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, Chan<eT>(t.prand_10 * expo), output_freq(channel::sample(expo_s, t.prand_10, n_samples)), eT(0.01), eT(0));
+	Mat<uint> s = channel::sample(rr_s, t.unif_10, n_samples);
+	EXPECT_NEAR(double(arma::accu(s.col(0) == s.col(1))) / n_samples, to_double(rr_s.diag), 0.01);
+
+	// iterative bayesian update recovers the prior from the exact output distribution
+	auto [est, reps] = channel::iterative_bayesian_update(geom_s, Prob<eT>(t.prand_10 * geom), t.unif_10, eT(1e-10), 100000u);
+	(void)reps;
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, Chan<eT>(t.prand_10), Chan<eT>(est), eT(1e-2), eT(0));
+}
+
+TYPED_TEST_P(MechDPrivTest, ExponentialSampler) {
+	typedef TypeParam eT;
+
+	eT eps(0.8);
+	const uint n_samples = 100000;
+
+	// empirical distribution of the outputs of input x, compared to row x of the dense exponential
+	auto check = [&](const ExponentialSampler<eT>& s, const Chan<eT>& C, uint x) {
+		Row<uint> xs(n_samples);
+		xs.fill(x);
+		Row<uint> ys = s.sample(xs);
+		Row<eT> freq = arma::zeros<Row<eT>>(C.n_cols);
+		for(uint k = 0; k < n_samples; k++)
+			freq(ys(k)) += eT(1) / n_samples;
+		EXPECT_PRED_FORMAT4(chan_equal4<eT>, Chan<eT>(C.row(x)), Chan<eT>(freq), eT(0.01), eT(0));
+	};
+
+	auto d = eps * metric::euclidean<eT, uint>();
+	Chan<eT> line = exponential<eT>(12, d);
+	ExponentialSampler<eT> gumbel(12, d);
+	check(gumbel, line, 0);
+	check(gumbel, line, 5);
+	gumbel.cache_normalizers();
+	check(gumbel, line, 5);
+	check(ExponentialSampler<eT>::line(12, eps), line, 0);
+	check(ExponentialSampler<eT>::line(12, eps), line, 7);
+
+	Chan<eT> disc = exponential<eT>(6, eps * metric::discrete<eT, uint>());
+	check(ExponentialSampler<eT>::discrete(6, eps), disc, 2);
+
+	auto g = metric::grid_euclidean<eT>(4, 3, eps);
+	Chan<eT> grid = exponential<eT>(12, Metric<eT, uint>(g));
+	ExponentialSampler<eT> grid_s(g);
+	check(grid_s, grid, 0);
+	check(grid_s, grid, 6);
+}
+
+TYPED_TEST_P(MechDPrivTest, OptExpLossSymmetry) {
+	typedef TypeParam eT;
+	namespace sym = mechanism::symmetry;
+
+	uint width = 4,
+		 size = width * width;
+	eT epsilon = 0.7;
+
+	// pi, d_priv and loss are invariant under the 8 symmetries of the square
+	Prob<eT> pi = probab::uniform<eT>(size);
+	auto d = epsilon * metric::grid<eT>(width);
+	auto loss = metric::grid<eT>(width);
+	auto symmetries = sym::grid(width, width);
+	EXPECT_EQ(8u, symmetries.size());
+	EXPECT_EQ(4u, sym::grid(width, width + 1).size());
+
+	sym::Group G(size, symmetries);
+	G.restrict_invariant(pi, loss);
+	EXPECT_EQ(8u, G.size());
+	EXPECT_EQ(36u, G.pair_orbits(size, size).second);		// instead of 256 variables (Burnside: (256 + 2 * 16) / 8)
+	uint n_reps = 0;
+	for(uint x = 0; x < size; x++)
+		n_reps += G.is_rep(x);
+	EXPECT_EQ(3u, n_reps);									// corners, edges, centre
+
+	Chan<eT> opt = min_loss_given_d<eT>(pi, size, d, loss);
+	Chan<eT> opt_sym = min_loss_given_d<eT>(pi, size, d, loss, "all", metric::never_chainable<uint>, eT(std::log(1e200)), symmetries);
+
+	auto exp_loss = [&](const Chan<eT>& C) {
+		eT res(0);
+		for(uint x = 0; x < size; x++)
+			for(uint y = 0; y < size; y++)
+				res += pi(x) * C(x, y) * loss(x, y);
+		return res;
+	};
+
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, opt_sym, size, size);
+	EXPECT_PRED_FORMAT4(equal4<eT>, exp_loss(opt), exp_loss(opt_sym), 1e-5, 0);
+	EXPECT_TRUE(is_private(opt_sym, (epsilon + eT(1e-3)) * loss));
+
+	// the result is invariant
+	for(auto& s : symmetries)
+		for(uint x = 0; x < size; x++)
+			for(uint y = 0; y < size; y++)
+				EXPECT_PRED_FORMAT4(equal4<eT>, opt_sym(x, y), opt_sym(s[x], s[y]), 1e-5, 0);
+
+	// only the symmetries of the program are used: the index distance is only invariant under the rotation by 180
+	// degrees, and a non-symmetric prior leaves none
+	sym::Group G2(size, symmetries);
+	G2.restrict_invariant(pi, metric::euclidean<eT, uint>());
+	EXPECT_EQ(2u, G2.size());
+
+	Prob<eT> pi2 = probab::randu<eT>(size);
+	sym::Group G3(size, symmetries);
+	G3.restrict_invariant(pi2, loss);
+	EXPECT_TRUE(G3.trivial());
+
+	Chan<eT> opt2 = min_loss_given_d<eT>(pi2, size, d, loss);
+	Chan<eT> opt2_sym = min_loss_given_d<eT>(pi2, size, d, loss, "all", metric::never_chainable<uint>, eT(std::log(1e200)), symmetries);
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, opt2, opt2_sym, 1e-5, 0);
+
+	// candidates that are not a group: the rotation by 90 degrees generates all 4 rotations
+	std::vector<uint> rot(size);
+	for(uint i = 0; i < size; i++)
+		rot[i] = (i % width) * width + (width - 1 - i / width);
+	sym::Group G4(size, { rot });
+	EXPECT_EQ(4u, G4.size());
+	EXPECT_ANY_THROW(sym::Group(size, { std::vector<uint>(size, 0) }));
+
+	Chan<eT> opt_rot = min_loss_given_d<eT>(pi, size, d, loss, "all", metric::never_chainable<uint>, eT(std::log(1e200)), { rot });
+	EXPECT_PRED_FORMAT3(chan_is_proper_size3<eT>, opt_rot, size, size);
+	EXPECT_PRED_FORMAT4(equal4<eT>, exp_loss(opt), exp_loss(opt_rot), 1e-5, 0);
+	EXPECT_TRUE(is_private(opt_rot, (epsilon + eT(1e-3)) * loss));
+}
 
-REGISTER_TYPED_TEST_SUITE_P(MechDPrivTest, Reals, Discrete, Grid, OptExpLoss);
+REGISTER_TYPED_TEST_SUITE_P(MechDPrivTest, Reals, Discrete, Grid, OptExpLoss, OptExpLossNeighbours, OptExpLossSymmetry, OptExpLossComponents, Operator, Structured, ExponentialSampler);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Mech, MechDPrivTest, NativeTypes);
 
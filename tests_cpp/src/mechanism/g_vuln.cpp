@@ -0,0 +1,217 @@
+#include "tests_aux.h"
+
+using namespace mechanism;
+
+// define a type-parametrized test case (https://code.google.com/p/googletest/wiki/AdvancedGuide)
+template <typename eT>
+class MechGVulnTest : public BaseTest<eT> {};
+
+TYPED_TEST_SUITE_P(MechGVulnTest);
+
+
+TYPED_TEST_P(MechGVulnTest, Frontier) {
+	typedef TypeParam eT;
+
+	uint n = 6;
+	eT md = eT(1e-4);
+	Prob<eT> pi = probab::randu<eT>(n);
+	auto loss = metric::euclidean<eT, uint>();
+
+	auto F = bayes_vuln::frontier(pi, n, loss);
+	ASSERT_GE(F.vulns.n_elem, 2u);
+	ASSERT_EQ(F.vulns.n_elem, F.mechanisms.size());
+
+	// end points: no leakage beyond the prior, and the identity (zero loss)
+	EXPECT_PRED_FORMAT4(equal4<eT>, measure::bayes_vuln::prior(pi), F.vulns(0), md, md);
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), F.vulns(F.vulns.n_elem - 1), md, md);
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(0), F.losses(F.losses.n_elem - 1), md, md);
+
+	for(uint k = 0; k < F.vulns.n_elem; k++) {
+		EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, F.mechanisms[k]);
+		EXPECT_PRED_FORMAT4(equal4<eT>, F.vulns(k), measure::bayes_vuln::posterior(pi, F.mechanisms[k]), md, md);
+		EXPECT_PRED_FORMAT4(equal4<eT>, F.losses(k), utility::expected_distance(loss, pi, F.mechanisms[k]), md, md);
+		if(k > 0) {
+			EXPECT_LT(F.vulns(k - 1), F.vulns(k));
+			EXPECT_GT(F.losses(k - 1), F.losses(k));
+		}
+	}
+
+	// any threshold gives the same optimal values as solving the program directly
+	for(uint i = 0; i <= 4; i++) {
+		eT max_vuln = F.vulns(0) + (F.vulns(F.vulns.n_elem - 1) - F.vulns(0)) * eT(i) / eT(4);
+		Chan<eT> C = F.min_loss_given_max_vuln(max_vuln);
+		Chan<eT> D = bayes_vuln::min_loss_given_max_vuln(pi, n, max_vuln, loss);
+		EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, C);
+		EXPECT_PRED_FORMAT4(equal4<eT>, utility::expected_distance(loss, pi, D), utility::expected_distance(loss, pi, C), md, md);
+		EXPECT_LE(measure::bayes_vuln::posterior(pi, C), max_vuln + md);
+
+		eT max_loss = F.losses(0) * eT(i) / eT(4);
+		C = F.min_vuln_given_max_loss(max_loss);
+		D = bayes_vuln::min_vuln_given_max_loss(pi, n, max_loss, loss);
+		EXPECT_PRED_FORMAT4(equal4<eT>, measure::bayes_vuln::posterior(pi, D), measure::bayes_vuln::posterior(pi, C), md, md);
+		EXPECT_LE(utility::expected_distance(loss, pi, C), max_loss + md);
+	}
+
+	// infeasible thresholds
+	EXPECT_TRUE(F.min_loss_given_max_vuln(F.vulns(0) / eT(2)).is_empty());
+
+	// the duals are the slopes of the frontier, inside each segment
+	Col<eT> max_vulns(F.vulns.n_elem - 1), duals;
+	for(uint k = 0; k + 1 < F.vulns.n_elem; k++)
+		max_vulns(k) = (F.vulns(k) + F.vulns(k + 1)) / eT(2);
+	mechanism::g_vuln::min_loss_given_max_vuln(pi, n, n, max_vulns, measure::g_vuln::g_id<eT>, loss, infinity<eT>(), false, &duals);
+	ASSERT_EQ(max_vulns.n_elem, duals.n_elem);
+	for(uint k = 0; k + 1 < F.vulns.n_elem; k++) {
+		eT slope = (F.losses(k + 1) - F.losses(k)) / (F.vulns(k + 1) - F.vulns(k));
+		EXPECT_PRED_FORMAT4(equal4<eT>, slope, duals(k), md, eT(1e-2));
+	}
+}
+
+
+TYPED_TEST_P(MechGVulnTest, MinVulnForRow) {
+	typedef TypeParam eT;
+
+	eT md = eT(1e-4);
+
+	// the water-filling row has the same cost as the LP one
+	auto cost = [](const Prob<eT>& pi, eT p, const Chan<eT>& C, const Prob<eT>& row) {
+		arma::Row<eT> maxes = arma::max(C.each_col() % pi.t(), 0);
+		eT res(0);
+		for(uint y = 0; y < C.n_cols; y++)
+			res += std::max(maxes(y), p * row(y));
+		return res;
+	};
+
+	for(uint i = 0; i < 20; i++) {
+		uint M = 1 + i % 5, N = 1 + i % 7;
+		eT p = eT(1) / eT(M + 1);
+		Prob<eT> pi = probab::uniform<eT>(M) * (eT(1) - p);
+		Chan<eT> C = channel::randu<eT>(M, N);
+
+		Prob<eT> row = bayes_vuln::min_vuln_for_row(pi, p, C);
+		Prob<eT> lp_row = bayes_vuln::aux::min_vuln_for_row_lp(pi, p, C);
+
+		EXPECT_PRED_FORMAT2(prob_is_proper1<eT>, row);
+		EXPECT_PRED_FORMAT4(equal4<eT>, cost(pi, p, C, lp_row), cost(pi, p, C, row), md, md);
+	}
+
+	// p = 0: anything is optimal, p large: the row goes where C is already large
+	Chan<eT> C(format_num<eT>("0.5 0.5 0; 0 0.1 0.9"));
+	Prob<eT> pi(format_num<eT>("0.25 0.25"));
+	EXPECT_PRED_FORMAT2(prob_is_proper1<eT>, bayes_vuln::min_vuln_for_row(pi, eT(0), C));
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(format_num<eT>("0 0 1")), bayes_vuln::min_vuln_for_row(pi, eT(0.2), C));
+	EXPECT_PRED_FORMAT2(prob_equal2<eT>, Prob<eT>(format_num<eT>("0.25 0.25 0.5")), bayes_vuln::min_vuln_for_row(pi, eT(0.5), C));
+}
+
+
+TYPED_TEST_P(MechGVulnTest, Symmetry) {
+	typedef TypeParam eT;
+
+	uint width = 3, n = width * width;
+	eT md = eT(1e-4);
+	Prob<eT> pi = probab::uniform<eT>(n);
+	auto loss = metric::grid<eT>(width);
+	auto gain = measure::g_vuln::g_id<eT>;
+	auto symmetries = mechanism::symmetry::grid(width, width);
+
+	Col<eT> max_losses = { eT(0.2), eT(0.5), eT(1) };
+	for(bool lazy : { false, true }) {
+		auto Cs = mechanism::g_vuln::min_vuln_given_max_loss(pi, n, n, max_losses, gain, loss, infinity<eT>(), lazy);
+		auto Ds = mechanism::g_vuln::min_vuln_given_max_loss(pi, n, n, max_losses, gain, loss, infinity<eT>(), lazy, symmetries);
+
+		for(uint i = 0; i < max_losses.n_elem; i++) {
+			const Chan<eT>& D = Ds[i];
+			EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, D);
+			EXPECT_PRED_FORMAT4(equal4<eT>, measure::bayes_vuln::posterior(pi, Cs[i]), measure::bayes_vuln::posterior(pi, D), md, md);
+			EXPECT_LE(utility::expected_distance(loss, pi, D), max_losses(i) + md);
+
+			// the mechanism is invariant
+			for(auto& s : symmetries)
+				for(uint x = 0; x < n; x++)
+					for(uint y = 0; y < n; y++)
+						EXPECT_PRED_FORMAT4(equal4<eT>, D(x, y), D(s[x], s[y]), md, md);
+		}
+	}
+}
+
+TYPED_TEST_P(MechGVulnTest, LazyConstraints) {
+	typedef TypeParam eT;
+
+	// lazily generated vulnerability constraints give the optimum of the fully built program, for a random gain
+	// function with fewer guesses than secrets, with and without hard_max_loss
+	uint n = 7, n_guesses = 4;
+	eT md = eT(1e-4);
+	Prob<eT> pi = probab::randu<eT>(n);
+	Mat<eT> G = channel::randu<eT>(n_guesses, n);
+	Metric<eT, uint> gain = [&](uint w, uint x) { return G(w, x); };
+	auto loss = metric::euclidean<eT, uint>();
+
+	eT v0 = measure::g_vuln::prior(G, pi),
+	   v1 = measure::g_vuln::posterior(G, pi, channel::identity<eT>(n));
+	Col<eT> max_vulns(4), max_losses(4);
+	for(uint i = 0; i < 4; i++) {
+		max_vulns(i) = v0 + (v1 - v0) * eT(i + 1) / eT(4);
+		max_losses(i) = eT(0.5) * eT(i);
+	}
+
+	for(eT hard_max_loss : { infinity<eT>(), eT(3) }) {
+		auto full = mechanism::g_vuln::min_loss_given_max_vuln(pi, n, n_guesses, max_vulns, gain, loss, hard_max_loss, false);
+		auto lazy = mechanism::g_vuln::min_loss_given_max_vuln(pi, n, n_guesses, max_vulns, gain, loss, hard_max_loss, true);
+		for(uint i = 0; i < max_vulns.n_elem; i++) {
+			ASSERT_FALSE(lazy[i].is_empty());
+			EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, lazy[i]);
+			EXPECT_LE(measure::g_vuln::posterior(G, pi, lazy[i]), max_vulns(i) + md);
+			EXPECT_PRED_FORMAT4(equal4<eT>, utility::expected_distance(loss, pi, full[i]), utility::expected_distance(loss, pi, lazy[i]), md, md);
+		}
+
+		full = mechanism::g_vuln::min_vuln_given_max_loss(pi, n, n_guesses, max_losses, gain, loss, hard_max_loss, false);
+		lazy = mechanism::g_vuln::min_vuln_given_max_loss(pi, n, n_guesses, max_losses, gain, loss, hard_max_loss, true);
+		for(uint i = 0; i < max_losses.n_elem; i++) {
+			ASSERT_FALSE(lazy[i].is_empty());
+			EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, lazy[i]);
+			EXPECT_LE(utility::expected_distance(loss, pi, lazy[i]), max_losses(i) + md);
+			EXPECT_PRED_FORMAT4(equal4<eT>, measure::g_vuln::posterior(G, pi, full[i]), measure::g_vuln::posterior(G, pi, lazy[i]), md, md);
+		}
+	}
+
+	// infeasible in both modes
+	EXPECT_TRUE(mechanism::g_vuln::min_loss_given_max_vuln(pi, n, n_guesses, v0 / eT(2), gain, loss, infinity<eT>(), true).is_empty());
+}
+
+// the water-filling only compares and divides, so for rats it should be exact
+TEST(MechGVulnRatTest, MinVulnForRowExact) {
+	auto cost = [](const Prob<rat>& pi, rat p, const Chan<rat>& C, const Prob<rat>& row) {
+		arma::Row<rat> maxes = arma::max(C.each_col() % pi.t(), 0);
+		rat res(0);
+		for(uint y = 0; y < C.n_cols; y++)
+			res += std::max(maxes(y), p * row(y));
+		return res;
+	};
+
+	// maxes = 1/6 1/6 3/10, caps (maxes / p) = 1/2 1/2 9/10: output 2 takes 9/10, output 0 the remaining 1/10
+	Chan<rat> C = { { rat(1, 2), rat(1, 2), rat(0) }, { rat(0), rat(1, 10), rat(9, 10) } };
+	Prob<rat> pi = { rat(1, 3), rat(1, 3) };
+	rat p(1, 3);
+
+	Prob<rat> row = bayes_vuln::min_vuln_for_row(pi, p, C);
+	EXPECT_TRUE(row(0) == rat(1, 10) && row(1) == rat(0) && row(2) == rat(9, 10));
+	EXPECT_EQ(rat(1), arma::accu(row));
+	EXPECT_EQ(rat(19, 30), cost(pi, p, C, row));
+	EXPECT_EQ(cost(pi, p, C, bayes_vuln::aux::min_vuln_for_row_lp(pi, p, C)), cost(pi, p, C, row));
+
+	// random rational channels, same cost as the exact LP
+	for(uint i = 0; i < 10; i++) {
+		uint M = 1 + i % 4, N = 2 + i % 5;
+		rat q(1, M + 1);
+		Prob<rat> pi2 = probab::uniform<rat>(M) * (rat(1) - q);
+		Chan<rat> C2 = channel::randu<rat>(M, N);
+
+		Prob<rat> row2 = bayes_vuln::min_vuln_for_row(pi2, q, C2);
+		EXPECT_EQ(rat(1), arma::accu(row2));
+		EXPECT_EQ(cost(pi2, q, C2, bayes_vuln::aux::min_vuln_for_row_lp(pi2, q, C2)), cost(pi2, q, C2, row2));
+	}
+}
+
+REGISTER_TYPED_TEST_SUITE_P(MechGVulnTest, Frontier, MinVulnForRow, Symmetry, LazyConstraints);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(Mech, MechGVulnTest, NativeTypes);
@@ -35,9 +35,255 @@ TYPED_TEST_P(MechGeoTest, Grid) {
 	EXPECT_PRED_FORMAT4(equal4<eT>, epsilon, smallest_epsilon(geom, d), 0, eT(1e-6));
 }
 
+TYPED_TEST_P(MechGeoTest, GridIntegration) {
+	typedef TypeParam eT;
+
+	// rectangles are integrated in parallel, each with its own seed, so the result should be reproducible
+	Mat<eT> m1 = mechanism::geo_ind::grid_integration<eT>(7, 5, 1, 0.8);
+	Mat<eT> m2 = mechanism::geo_ind::grid_integration<eT>(7, 5, 1, 0.8);
+
+	EXPECT_TRUE(arma::approx_equal(m1, m2, "absdiff", 0));
+	EXPECT_TRUE(arma::approx_equal(m1, arma::fliplr(m1), "absdiff", 0));
+	EXPECT_TRUE(arma::approx_equal(m1, arma::flipud(m1), "absdiff", 0));
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), arma::accu(m1), 0, eT(1e-3));
+
+	// quadrature is deterministic and should agree with miser up to the latter's accuracy
+	Mat<eT> q1 = mechanism::geo_ind::grid_integration<eT>(7, 5, 1, 0.8, "quadrature");
+	Mat<eT> q2 = mechanism::geo_ind::grid_integration<eT>(7, 5, 1, 0.8, "quadrature");
+
+	EXPECT_TRUE(arma::approx_equal(q1, q2, "absdiff", 0));
+	EXPECT_TRUE(arma::approx_equal(q1, m1, "absdiff", 1e-3));
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), arma::accu(q1), 0, eT(1e-4));
+
+	EXPECT_ANY_THROW(mechanism::geo_ind::grid_integration<eT>(7, 5, 1, 0.8, "foo"));
+
+	// gsl errors are thrown instead of aborting (miser rejects an empty rectangle)
+	mechanism::geo_ind::IntegrationContext ctx(1);
+	EXPECT_THROW(ctx.integrate(0.8, { 1, 0 }, { 0, 1 }), std::runtime_error);
+	EXPECT_GT(ctx.integrate(0.8, { 0, 0 }, { 1, 1 }), 0);
+}
+
+
+TYPED_TEST_P(MechGeoTest, GeometricSample) {
+	typedef TypeParam eT;
+
+	eT cell_size = 0.5, eps = 1.2;
+	mechanism::geo_ind::PlanarGeometricSampler<eT> sampler(cell_size, eps);
+
+	uint n = 400000;
+	std::vector<Point<eT>> s1 = sampler.fill(n, 7),
+						   s2 = sampler.fill(n, 7);
+	EXPECT_TRUE(s1 == s2);
+
+	// the frequency of (0,0) should match the normalization coefficient, and that of (cell_size,0) the
+	// coefficient times exp(-eps * cell_size)
+	double f0 = 0, f1 = 0;
+	for(auto& p : s1) {
+		f0 += p == Point<eT>(0, 0);
+		f1 += p == Point<eT>(cell_size, 0);
+	}
+	double coeff = mechanism::geo_ind::_planar_geometric_coeff<double>(cell_size, eps);
+	EXPECT_NEAR(coeff, f0 / n, 5e-3);
+	EXPECT_NEAR(coeff * std::exp(-eps * cell_size), f1 / n, 5e-3);
+}
+
+TYPED_TEST_P(MechGeoTest, RingTable) {
+	typedef TypeParam eT;
+
+	// same cells, in the same order, as GridWalk
+	auto table = geo::ring_table(10);
+	ASSERT_GE(table->n_rings(), 10u);
+	uint k = 0;
+	for(Point<int> p : geo::GridWalk<int>(1)) {
+		if(k == table->ring_start[10])
+			break;
+		EXPECT_EQ(p.x, table->i[k]);
+		EXPECT_EQ(p.y, table->j[k]);
+		EXPECT_DOUBLE_EQ(std::sqrt(double(p.x * p.x + p.y * p.y)), table->radius[k]);
+		k++;
+	}
+	for(uint r = 1; r < 10; r++)
+		EXPECT_EQ(8 * r, table->ring_start[r+1] - table->ring_start[r]);
+
+	// larger tables replace the cache, old pointers stay valid
+	auto big = geo::ring_table(2 * table->n_rings() + 1);
+	EXPECT_GT(big->n_rings(), table->n_rings());
+	EXPECT_EQ(table->radius[5], big->radius[5]);
+
+	// tables above the cache limit are not kept
+	uint max_cached = geo::ring_table_max_cached;
+	geo::ring_table_max_cached = big->n_rings();
+	auto huge = geo::ring_table(big->n_rings() + 1);
+	EXPECT_EQ(big->n_rings() + 1, huge->n_rings());
+	EXPECT_EQ(1, huge.use_count());			// owned by the caller only
+	geo::ring_table_max_cached = max_cached;
+
+	// the coefficient agrees with a direct summation along GridWalk (small eps needs many rings)
+	for(double eps : { 1.2, 0.05 }) {
+		eT cell_size = 0.5;
+		double direct = 0;
+		for(Point<double> p : geo::GridWalk<double>(to_double(cell_size))) {
+			double prob = std::exp(-eps * std::sqrt(p.x * p.x + p.y * p.y));
+			direct += prob;
+			if(prob < 1e-20)
+				break;
+		}
+		double rel = std::is_same<eT, float>::value ? 1e-4 : 1e-9;
+		EXPECT_NEAR(1 / direct, to_double(mechanism::geo_ind::_planar_geometric_coeff<eT>(cell_size, eT(eps))), rel / direct);
+	}
+}
+
+TYPED_TEST_P(MechGeoTest, QuadTree) {
+	typedef TypeParam eT;
+
+	// a cluster near the bottom-left corner gets small leaves, the rest stays coarse
+	std::vector<Point<eT>> points;
+	for(uint k = 0; k < 200; k++)
+		points.push_back(Point<eT>(eT(k % 10) / 10, eT(k / 10) / 20));
+	points.push_back(Point<eT>(7, 7));
+	points.push_back(Point<eT>(9, -1));		// outside, ignored
+
+	geo::QuadTree<eT> T(points, 8, 10, eT(0.25));
+	EXPECT_GT(T.n_leaves(), 4u);
+	EXPECT_EQ(5u, T.max_depth());
+
+	eT area(0);
+	for(uint k = 0; k < T.n_leaves(); k++) {
+		area += T.leaf(k).size * T.leaf(k).size;
+		EXPECT_EQ(k, T.locate(T.leaf(k).center()));
+	}
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(64), area);
+	EXPECT_ANY_THROW(T.locate(Point<eT>(8, 0)));
 
+	Prob<eT> pi = T.prior(points);
+	EXPECT_PRED_FORMAT2(prob_is_proper1<eT>, pi);
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(1) / 201, pi(T.locate(Point<eT>(7, 7))));
+
+	Mat<eT> D = T.distances();
+	auto d = T.metric();
+	EXPECT_PRED_FORMAT2(equal2<eT>, D(0, T.n_leaves() - 1), d(0, T.n_leaves() - 1));
+
+	EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, mechanism::geo_ind::planar_geometric_quadtree<eT>(T, eT(0.5)));
+	EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, mechanism::geo_ind::planar_laplace_quadtree<eT>(T, eT(0.5)));
+
+	// coincident points are split down to min_size, too deep for the lattice of planar_geometric_quadtree
+	geo::QuadTree<eT> deep(std::vector<Point<eT>>(5, Point<eT>(eT(0.1), eT(0.1))), 1, 1, eT(1e-6));
+	EXPECT_EQ(19u, deep.max_depth());
+	EXPECT_ANY_THROW(mechanism::geo_ind::planar_geometric_quadtree<eT>(deep, eT(0.5)));
+	EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, mechanism::geo_ind::planar_laplace_quadtree<eT>(deep, eT(0.5)));
+
+	// fully refined, the leaves are the cells of a uniform grid and the mechanisms agree with the grid ones
+	const uint N = 4;
+	points.clear();
+	for(uint i = 0; i < N; i++)
+		for(uint j = 0; j < N; j++)
+			points.push_back(Point<eT>(eT(i) + eT(0.5), eT(j) + eT(0.5)));
+	geo::QuadTree<eT> U(points, N, 0, 1);
+	ASSERT_EQ(N * N, U.n_leaves());
+
+	std::vector<uint> cell(N * N);		// grid cell of each leaf
+	for(uint k = 0; k < N * N; k++) {
+		Point<eT> c = U.leaf(k).center();
+		cell[k] = uint(to_double(c.y)) * N + uint(to_double(c.x));
+	}
+
+	eT eps(0.8);
+	Chan<eT> Gq = mechanism::geo_ind::planar_geometric_quadtree<eT>(U, eps),
+			 Gg = mechanism::geo_ind::planar_geometric_grid<eT>(N, N, 1, eps),
+			 Lq = mechanism::geo_ind::planar_laplace_quadtree<eT>(U, eps),
+			 Lg = mechanism::geo_ind::planar_laplace_grid<eT>(N, N, 1, eps, "quadrature");
+	for(uint x = 0; x < N * N; x++) {
+		for(uint y = 0; y < N * N; y++) {
+			EXPECT_NEAR(to_double(Gg(cell[x], cell[y])), to_double(Gq(x, y)), 1e-6);
+			EXPECT_NEAR(to_double(Lg(cell[x], cell[y])), to_double(Lq(x, y)), 1e-3);
+		}
+	}
+}
+
+TYPED_TEST_P(MechGeoTest, GridSummation) {
+	typedef TypeParam eT;
+
+	// compare against the direct summation over each cell's rectangle (edge cells include the tail up to far_away)
+	for(auto [width, height] : { std::pair<uint,uint>(7, 5), std::pair<uint,uint>(5, 9) }) {
+		eT step = 1, epsilon = 0.5;
+		Mat<eT> m = mechanism::geo_ind::grid_summation<eT>(width, height, step, epsilon);
+
+		int cx = (width-1)/2, cy = (height-1)/2;
+		int far_away = int(std::max(mechanism::geo_ind::inverse_cumulative_gamma(epsilon, 1-1e-6), std::max(cx, cy) + 0.5));
+		Mat<double> direct(height, width);
+		for(int y = -cy; y <= cy; y++) {
+			for(int x = -cx; x <= cx; x++) {
+				int i = std::abs(x), j = std::abs(y);
+				double prob = 0;
+				for(int si = i; si <= (i == cx ? far_away : i); si++)
+					for(int sj = j; sj <= (j == cy ? far_away : j); sj++)
+						prob += std::exp(-epsilon * std::sqrt(si*si + sj*sj));
+				direct(cy+y, cx+x) = prob;
+			}
+		}
+		direct /= arma::accu(direct);
+		EXPECT_PRED_FORMAT4(chan_equal4<eT>, Chan<eT>(arma::conv_to<Mat<eT>>::from(direct)), m, eT(1e-6), eT(0));
+	}
+}
+
+TYPED_TEST_P(MechGeoTest, GridKernel) {
+	typedef TypeParam eT;
+	eT step = 1, epsilon = 0.5;
+
+	// a sweep over growing (and shrinking) sizes gives the same kernels as building each one from scratch
+	mechanism::geo_ind::GeometricGridKernel<eT> geo(step, epsilon);
+	for(auto [width, height] : { std::pair<uint,uint>(5, 5), std::pair<uint,uint>(7, 5), std::pair<uint,uint>(5, 9), std::pair<uint,uint>(3, 3) }) {
+		Mat<eT> m = mechanism::geo_ind::grid_summation<eT>(width, height, step, epsilon);
+		EXPECT_PRED_FORMAT4(chan_equal4<eT>, m, geo.summation(width, height), eT(1e-6), eT(0));
+	}
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, mechanism::geo_ind::planar_geometric_grid<eT>(3, 4, step, epsilon), geo.grid(3, 4), eT(1e-6), eT(0));
+
+	// square laplace kernels with the quadrature are exactly those of grid_integration, only new cells are integrated
+	mechanism::geo_ind::LaplaceGridKernel<eT> lap(step, epsilon, "quadrature");
+	EXPECT_TRUE(arma::approx_equal(mechanism::geo_ind::grid_integration<eT>(5, 5, step, epsilon, "quadrature"), lap.integration(5, 5), "absdiff", 0));
+	EXPECT_EQ(6u, lap.n_integrations());		// 3 interior + 3 border cells
+	EXPECT_TRUE(arma::approx_equal(mechanism::geo_ind::grid_integration<eT>(7, 7, step, epsilon, "quadrature"), lap.integration(7, 7), "absdiff", 0));
+	EXPECT_EQ(6u + 7u, lap.n_integrations());	// 3 new interior + 4 border cells
+	lap.integration(7, 7);
+	EXPECT_EQ(6u + 7u + 4u, lap.n_integrations());
+
+	// miser values don't depend on the sizes requested before
+	mechanism::geo_ind::LaplaceGridKernel<eT> m1(step, epsilon), m2(step, epsilon);
+	m1.integration(9, 7);
+	EXPECT_TRUE(arma::approx_equal(m1.integration(5, 5), m2.integration(5, 5), "absdiff", 0));
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(1), arma::accu(m1.integration(7, 9)), 0, eT(1e-3));
+
+	EXPECT_ANY_THROW(mechanism::geo_ind::LaplaceGridKernel<eT>(step, epsilon, "foo"));
+}
+
+TYPED_TEST_P(MechGeoTest, LaplaceSample) {
+	typedef TypeParam eT;
+	using namespace mechanism::geo_ind;
+
+	for(double p : { 0.0, 1e-6, 0.1, 0.5, 0.9, 0.9999, 1 - 1e-12 })
+		EXPECT_NEAR(inverse_cumulative_gamma(2.0, p), inverse_cumulative_gamma(2.0, arma::vec{p})(0), 1e-7);
+
+	eT eps = 1.5;
+	uint n = 200000;
+	Mat<eT> s1 = planar_laplace_sample(eps, n, 3),
+			s2 = planar_laplace_sample(eps, n, 3);
+	EXPECT_TRUE(arma::all(arma::vectorise(s1 == s2)));
+
+	// the radius is gamma(2, 1/eps) distributed, with mean 2/eps, and the angle is uniform
+	arma::vec r = arma::sqrt(arma::square(arma::conv_to<arma::vec>::from(s1.col(0))) + arma::square(arma::conv_to<arma::vec>::from(s1.col(1))));
+	EXPECT_NEAR(2 / eps, arma::mean(r), 1e-2);
+	EXPECT_NEAR(0, arma::mean(arma::conv_to<arma::vec>::from(s1.col(0))), 1e-2);
+
+	// snapping in the same pass gives the cells of the same points
+	Point<eT> origin(10, 10);
+	auto to_cell = geo::point_to_cell<eT>(21, eT(1));
+	Row<uint> cells = planar_laplace_sample(eps, 1000, to_cell, origin, 3);
+	Mat<eT> pts = planar_laplace_sample(eps, 1000, 3);
+	for(uint i = 0; i < 1000; i++)
+		EXPECT_EQ(to_cell(Point<eT>(origin.x + pts(i, 0), origin.y + pts(i, 1))), cells(i));
+}
 
-REGISTER_TYPED_TEST_SUITE_P(MechGeoTest, Grid);
+REGISTER_TYPED_TEST_SUITE_P(MechGeoTest, Grid, GridIntegration, GeometricSample, RingTable, QuadTree, GridSummation, GridKernel, LaplaceSample);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Mech, MechGeoTest, NativeTypes);
 
@@ -0,0 +1,74 @@
+#include "tests_aux.h"
+
+using namespace mechanism;
+
+// define a type-parametrized test case (https://code.google.com/p/googletest/wiki/AdvancedGuide)
+template <typename eT>
+class MechMemoTest : public BaseTest<eT> {};
+
+TYPED_TEST_SUITE_P(MechMemoTest);
+
+
+TYPED_TEST_P(MechMemoTest, Cached) {
+	typedef TypeParam eT;
+
+	std::string dir = ::testing::TempDir() + "qif_memo_test";
+	std::filesystem::remove_all(dir);
+	memo::set_dir(dir);
+
+	// the first call computes and stores, later ones read back the same matrix
+	uint calls = 0;
+	memo::Key key("test");
+	key.add(uint(3)).add(eT(0.5));
+	auto compute = [&] { calls++; return Mat<eT>(channel::randu<eT>(4, 3)); };
+
+	Mat<eT> M1 = memo::cached<eT>(key, compute);
+	Mat<eT> M2 = memo::cached<eT>(key, compute);
+	EXPECT_EQ(1u, calls);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, M1, M2);
+
+	// different arguments, different keys
+	memo::Key other("test");
+	other.add(uint(3)).add(eT(0.25));
+	EXPECT_NE(key.hex(), other.hex());
+	memo::cached<eT>(other, compute);
+	EXPECT_EQ(2u, calls);
+
+	// a corrupted file is recomputed
+	std::ofstream(dir + "/" + key.hex() + ".bin") << "garbage";
+	memo::cached<eT>(key, compute);
+	EXPECT_EQ(3u, calls);
+
+	// the keys of the constructors include the cache version
+	memo::Key unsalted("geo_ind::planar_geometric_grid");
+	unsalted.add(uint(binary::aux::elem_code<eT>()));
+	EXPECT_NE(unsalted.hex(), memo::aux::key<eT>("geo_ind::planar_geometric_grid").hex());
+
+	// failures (empty results) are not stored
+	memo::Key failing("failing");
+	auto fail = [&] { calls++; return Mat<eT>(); };
+	EXPECT_TRUE(memo::cached<eT>(failing, fail).is_empty());
+	EXPECT_FALSE(std::filesystem::exists(dir + "/" + failing.hex() + ".bin"));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, M1, memo::cached<eT>(failing, [&] { calls++; return M1; }));
+	EXPECT_EQ(5u, calls);
+
+	// memoised constructors agree with the plain ones
+	auto d = eT(0.8) * metric::euclidean<eT, uint>();
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, d_privacy::exponential<eT>(10, d), memo::exponential<eT>(10, d));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, d_privacy::exponential<eT>(10, d), memo::exponential<eT>(10, d));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, geo_ind::planar_geometric_grid<eT>(3, 3, 1, 0.5), memo::planar_geometric_grid<eT>(3, 3, 1, 0.5));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, geo_ind::planar_geometric_grid<eT>(3, 3, 1, 0.5), memo::planar_geometric_grid<eT>(3, 3, 1, 0.5));
+
+	// disabled
+	memo::set_dir("");
+	memo::cached<eT>(key, compute);
+	memo::cached<eT>(key, compute);
+	EXPECT_EQ(7u, calls);
+
+	std::filesystem::remove_all(dir);
+}
+
+
+REGISTER_TYPED_TEST_SUITE_P(MechMemoTest, Cached);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(Mech, MechMemoTest, NativeTypes);
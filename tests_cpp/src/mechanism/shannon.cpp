@@ -0,0 +1,48 @@
+#include "tests_aux.h"
+
+using namespace mechanism::shannon;
+
+// define a type-parametrized test case (https://code.google.com/p/googletest/wiki/AdvancedGuide)
+template <typename eT>
+class MechShannonTest : public BaseTest<eT> {};
+
+TYPED_TEST_SUITE_P(MechShannonTest);
+
+
+TYPED_TEST_P(MechShannonTest, Banded) {
+	typedef TypeParam eT;
+
+	uint n = 100;
+	auto loss = eT(2) * metric::euclidean<eT, uint>();
+	Prob<eT> pi = probab::randu<eT>(n);
+	Prob<eT> out = probab::uniform<eT>(n);
+
+	Chan<eT> C = max_entropy_given_same_loss(pi, out, loss);
+	BandedChan<eT> B = max_entropy_given_same_loss_banded(pi, out, loss);
+
+	// the default cutoff -log(epsilon) keeps |x-y| <= cutoff/2 (18 for double, 7 for float), so the band is much
+	// smaller than the full rows
+	eT cutoff = -std::log(std::numeric_limits<eT>::epsilon());
+	uint band = 0;
+	for(uint x = 0; x < n; x++)
+		for(uint y = 0; y < n; y++)
+			band += loss(x, y) <= cutoff;
+	EXPECT_EQ(band, B.val.n_elem);
+	EXPECT_LT(B.val.n_elem, n * n / 2);
+	EXPECT_PRED_FORMAT2(chan_is_proper1<eT>, B.to_chan());
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, C, B.to_chan(), eT(1e-4), eT(1e-4));
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, C, Chan<eT>(B.to_sparse()), eT(1e-4), eT(1e-4));
+	EXPECT_PRED_FORMAT4(prob_equal4<eT>, pi * C, B.output(pi), eT(1e-4), eT(1e-4));
+
+	// a small cutoff keeps only the diagonal
+	B = max_entropy_given_same_loss_banded(pi, out, loss, eT(1));
+	EXPECT_EQ(n, B.val.n_elem);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, channel::identity<eT>(n), B.to_chan());
+}
+
+
+// run the MechShannonTest test-case for double, float
+//
+REGISTER_TYPED_TEST_SUITE_P(MechShannonTest, Banded);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(MechShannon, MechShannonTest, NativeTypes);
@@ -152,6 +152,66 @@ TYPED_TEST_P(MetricTest, Convex_separation) {
 	EXPECT_PRED_FORMAT2(equal2<eT>, eT(9)/eT(14), bed(t.pi5, t.unif_4));
 }
 
+TYPED_TEST_P(MetricTest, L1_diameter) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+	using namespace metric::optimize;
+
+	auto l1 = metric::l1<eT, Prob<eT>>();
+
+	for(auto& C : { t.crand_10, t.noint_10, t.id_10, (Chan<eT>)t.crand_10.rows(0, 0) }) {
+		auto [diam, x1, x2] = l1_diameter(C, "direct");
+
+		for(std::string method : { "pruned", "linf" }) {
+			auto [diam2, y1, y2] = l1_diameter(C, method);
+			EXPECT_PRED_FORMAT2(equal2<eT>, diam, diam2);
+			if(C.n_rows > 1)
+				EXPECT_PRED_FORMAT2(equal2<eT>, diam, l1(C.row(y1), C.row(y2)));
+		}
+	}
+
+	Chan<eT> A = t.crand_10.rows(0, 3), B = t.crand_10.rows(4, 9);
+	auto [dist, x1, x2] = l1_max_distance(A, B, "direct");
+	EXPECT_PRED_FORMAT2(equal2<eT>, dist, l1(A.row(x1), B.row(x2)));
+
+	for(std::string method : { "pruned", "linf" }) {
+		auto [dist2, y1, y2] = l1_max_distance(A, B, method);
+		EXPECT_PRED_FORMAT2(equal2<eT>, dist, dist2);
+		EXPECT_PRED_FORMAT2(equal2<eT>, dist, l1(A.row(y1), B.row(y2)));
+	}
+	EXPECT_ANY_THROW(l1_diameter(A, "foo"));
+}
+
+TYPED_TEST_P(MetricTestReals, Min_enclosing_ball) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+	using namespace metric::optimize;
+
+	auto l1 = metric::l1<eT, Prob<eT>>();
+
+	for(auto& C : { t.crand_10, (Chan<eT>)channel::randu<eT>(300, 5) }) {
+		eT r1 = simplex_l1_min_enclosing_ball(C, "lp").first;
+		auto [r2, q2] = simplex_l1_min_enclosing_ball(C, "fo");
+
+		if(!std::is_same<eT, float>::value) {	// the float LP is not precise enough
+		EXPECT_PRED_FORMAT4(equal4<eT>, r1, r2, 1e-4, 0);
+		}
+		EXPECT_PRED_FORMAT1(prob_is_proper1<eT>, q2);
+		EXPECT_EQ(C.n_cols, q2.n_cols);
+		eT max_dist(0);
+		for(uint x = 0; x < C.n_rows; x++)
+			max_dist = std::max(max_dist, l1(C.row(x), q2));
+		EXPECT_PRED_FORMAT4(equal4<eT>, r2, max_dist, 1e-4, 0);
+	}
+
+	// batched l2
+	std::vector<Chan<eT>> Cs = { t.crand_10, t.id_10 };
+	auto res = l2_min_enclosing_ball(Cs);
+	ASSERT_EQ(2u, res.size());
+	for(uint i = 0; i < 2; i++)
+		EXPECT_PRED_FORMAT2(equal2<eT>, l2_min_enclosing_ball(Cs[i]).first, res[i].first);
+}
+
 TYPED_TEST_P(MetricTestReals, Multiplicative_distance) {
 	typedef TypeParam eT;
 	BaseTest<eT>& t = *this;
@@ -186,9 +246,9 @@ TYPED_TEST_P(MetricTest, Kantorovich) {
 		auto kant_cur_disc   = use_lp ? kant_lp_disc   : kant_disc;
 		auto kant_cur_euclid = use_lp ? kant_lp_euclid : kant_euclid;
 
-		// metric::kantorovich runs kantorovich_fastemd for double and kantorovich_lp for the rest
-		// fastemd has worse precision, so we need to set a larger mrd
-		eT mrd = is_double && !use_lp ? eT(1e-5) : def_mrd<eT>;
+		// metric::kantorovich runs the transportation simplex, whose float results can differ in the last digits
+		// (for rat it is exact)
+		eT mrd = !std::is_same<eT, rat>::value && !use_lp ? eT(1e-5) : def_mrd<eT>;
 
 		EXPECT_PRED_FORMAT2(equal2<eT>, eT(0),   kant_cur_disc(t.unif_4, t.unif_4));
 		EXPECT_PRED_FORMAT2(equal2<eT>, eT(0),   kant_cur_disc(t.point_4, t.point_4));
@@ -224,7 +284,11 @@ TYPED_TEST_P(MetricTest, Kantorovich) {
 		}
 	}
 
-	// kantorovich and kantorovich_lp should produce the same result
+	// kantorovich and kantorovich_lp should produce the same result (exactly for rat)
+	eT mrd = std::is_same<eT, rat>::value ? eT(0) : eT(1e-5);
+	EXPECT_PRED_FORMAT4(equal4<eT>, kant_lp_euclid(t.unif_4, t.pi5), kant_euclid(t.unif_4, t.pi5), eT(0), mrd);
+	EXPECT_PRED_FORMAT4(equal4<eT>, kant_lp_disc  (t.pi5, t.unif_4), kant_disc  (t.pi5, t.unif_4), eT(0), mrd);
+
 	if(is_double) {
 		for(uint i = 0; i < 10; i++) {
 			auto p1 = probab::randu<eT>(10),
@@ -233,6 +297,188 @@ TYPED_TEST_P(MetricTest, Kantorovich) {
 			EXPECT_PRED_FORMAT4(equal4<eT>, kant_euclid(p1, p2), kant_lp_euclid(p1, p2), eT(0), eT(1e-4));
 		}
 	}
+
+	// the engine gives the same results, also in batch
+	if constexpr (std::is_same<eT, double>::value) {
+		metric::Kantorovich<eT> engine(euclid, 10);
+		std::vector<typename metric::Kantorovich<eT>::ProbPair> pairs;
+		for(uint i = 0; i < 20; i++)
+			pairs.push_back({ probab::randu<eT>(10), probab::randu<eT>(10) });
+
+		Col<eT> res = engine.distances(pairs);
+		for(uint i = 0; i < pairs.size(); i++) {
+			EXPECT_PRED_FORMAT2(equal2<eT>, kant_euclid(pairs[i].first, pairs[i].second), engine(pairs[i].first, pairs[i].second));
+			EXPECT_PRED_FORMAT2(equal2<eT>, engine(pairs[i].first, pairs[i].second), res(i));
+		}
+		EXPECT_ANY_THROW(engine(t.unif_4, t.point_4));
+	}
+}
+
+TYPED_TEST_P(MetricTest, Transport_simplex) {
+	typedef TypeParam eT;
+
+	// same as the LP on the joint space of the supports, for arbitrary (non-metric, rectangular) costs
+	metric::TransportSimplex<eT> simplex;
+	for(uint k = 0; k < 10; k++) {
+		uint m = 1 + k % 4, n = 1 + (k * 3) % 5;
+		Mat<eT> C = channel::randu<eT>(m, n) * eT(5);
+		C(0, 0) = eT(0);
+		Prob<eT> a = probab::randu<eT>(m), b = probab::randu<eT>(n);
+
+		auto d = [&](uint i, uint j) -> eT { return i < m && j >= m ? C(i, j - m) : eT(0); };
+		Prob<eT> a2 = arma::join_rows(a, Prob<eT>(n, arma::fill::zeros)),
+				 b2 = arma::join_rows(Prob<eT>(m, arma::fill::zeros), b);
+
+		ASSERT_TRUE(simplex.solve(C, a, b));
+		EXPECT_PRED_FORMAT4(equal4<eT>, metric::kantorovich_lp<eT, Prob<eT>>(d)(a2, b2), simplex.objective(), eT(1e-6), eT(1e-6));
+	}
+
+	// point masses
+	Mat<eT> C = format_num<eT>("0 2 3; 4 0 1");
+	ASSERT_TRUE(simplex.solve(C, Prob<eT>(format_num<eT>("1 0")), Prob<eT>(format_num<eT>("0 0 1"))));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(3), simplex.objective());
+
+	EXPECT_ANY_THROW(simplex.solve(C, Prob<eT>(format_num<eT>("1 0")), Prob<eT>(format_num<eT>("0 1"))));
+
+	// non-metric and infinite costs through metric::kantorovich, with both initial bases
+	auto euclid = metric::euclidean<eT, uint>();
+	auto d_inf = metric::threshold_inf(euclid, eT(2)),
+		 d_thres = metric::threshold(euclid, eT(2)) * eT(3);
+	auto kant_inf = metric::kantorovich<eT, Prob<eT>>(d_inf),
+		 kant_thres = metric::kantorovich<eT, Prob<eT>>(d_thres);
+	for(uint k = 0; k < 5; k++) {
+		Prob<eT> a = probab::randu<eT>(6), b = probab::randu<eT>(6);
+		EXPECT_PRED_FORMAT4(equal4<eT>, metric::kantorovich_lp<eT, Prob<eT>>(d_thres)(a, b), kant_thres(a, b), eT(1e-6), eT(1e-6));
+
+		simplex.vogel = false;		// compare the two bases, and the LP fallback
+		ASSERT_TRUE(simplex.solve(metric::to_distance_matrix<eT>(d_inf, 6), a, b));
+		EXPECT_PRED_FORMAT4(equal4<eT>, kant_inf(a, b), simplex.objective(), eT(1e-6), eT(1e-6));
+		EXPECT_PRED_FORMAT4(equal4<eT>, metric::transport_lp<eT>(metric::to_distance_matrix<eT>(d_inf, 6), a, b), simplex.objective(), eT(1e-6), eT(1e-6));
+		simplex.vogel = true;
+	}
+
+	// the mass of 0 cannot go further than 2
+	EXPECT_EQ(infinity<eT>(), kant_inf(probab::point<eT>(6, 0), probab::point<eT>(6, 3)));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(2), kant_inf(probab::point<eT>(6, 0), probab::point<eT>(6, 2)));
+	EXPECT_EQ(infinity<eT>(), metric::transport_lp<eT>(metric::to_distance_matrix<eT>(d_inf, 6), probab::point<eT>(6, 0), probab::point<eT>(6, 3)));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(2), metric::transport_lp<eT>(metric::to_distance_matrix<eT>(d_inf, 6), probab::point<eT>(6, 0), probab::point<eT>(6, 2)));
+}
+
+TYPED_TEST_P(MetricTest, Lipschitz_parallel) {
+	typedef TypeParam eT;
+
+	// same answer as is_lipschitz, for rows of a channel wrt tv, with and without chainability
+	Chan<eT> C = channel::randu<eT>(12, 4);
+	auto rows = [&](uint x) -> Prob<eT> { return C.row(x); };
+	auto tv = metric::total_variation<eT, Prob<eT>>();
+	auto euclid = metric::euclidean<eT, uint>();
+	eT L = metric::lipschitz_constant<eT,uint,Prob<eT>>(rows, euclid, tv, range<uint>(0, 12));
+
+	for(eT c : { eT(2), eT(1), eT(1)/2, eT(0) }) {
+		auto d = (L * c) * euclid;
+		bool expected = metric::is_lipschitz<eT,uint,Prob<eT>>(rows, d, tv, range<uint>(0, 12));
+		EXPECT_EQ(c >= eT(1), expected);
+		EXPECT_EQ(expected, (metric::is_lipschitz_parallel<eT,uint,Prob<eT>>(rows, d, tv, range<uint>(0, 12))));
+		EXPECT_EQ(expected, (metric::is_lipschitz_parallel<eT,uint,Prob<eT>>(rows, d, tv, range<uint>(0, 12), metric::euclidean_chain<uint>())));
+	}
+}
+
+TYPED_TEST_P(MetricTest, Cached) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	auto euclid = metric::euclidean<eT, uint>();
+	auto cached = metric::cached(euclid);
+
+	// usable as a metric
+	Metric<eT, uint> d = cached;
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(5), d(0, 5));
+
+	// matrices are built once and shared by copies
+	const Mat<eT>& D1 = cached.matrix(10);
+	auto copy = cached;
+	EXPECT_EQ(&D1, &copy.matrix(10, 10));
+	EXPECT_NE(&D1, &copy.matrix(10, 4));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, metric::to_distance_matrix(euclid, 10), D1);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, metric::to_distance_matrix(euclid, 10, 4), copy.matrix(10, 4));
+
+	// measures accept the cached metric
+	Chan<eT> C = channel::randu<eT>(10);
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::l_risk::posterior(euclid, t.prand_10, C), measure::l_risk::posterior(cached, t.prand_10, C));
+	EXPECT_PRED_FORMAT2(equal2<eT>, measure::g_vuln::prior(euclid, t.prand_10), measure::g_vuln::prior(cached, t.prand_10));
+	EXPECT_PRED_FORMAT2(equal2<eT>, utility::expected_distance(euclid, t.prand_10, C), utility::expected_distance(cached, t.prand_10, C));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(3)/2, metric::kantorovich<eT, Prob<eT>>(cached)(t.unif_4, t.point_4));
+
+	// so is the FastEMD engine, until clear()
+	const metric::Kantorovich<eT>& K = cached.kantorovich(4);
+	EXPECT_EQ(&K, &copy.kantorovich(4));
+	EXPECT_EQ(4u, K.n());
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(3)/2, (metric::kantorovich_fastemd<eT, Prob<eT>>(copy)(t.unif_4, t.point_4)));
+	EXPECT_PRED_FORMAT2(equal2<eT>, (metric::kantorovich_fastemd<eT, Prob<eT>>(euclid)(t.unif_4, t.point_4)), (metric::kantorovich_fastemd<eT, Prob<eT>>(cached)(t.unif_4, t.point_4)));
+	cached.clear();
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(3)/2, cached.kantorovich(4)(t.unif_4, t.point_4));
+}
+
+TYPED_TEST_P(MetricTest, Distance_matrix) {
+	typedef TypeParam eT;
+
+	auto euclid = metric::euclidean<eT, uint>();
+	auto discr = metric::discrete<eT, uint>();
+	Mat<eT> D(12, 7);
+	for(uint i = 0; i < 12; i++)
+		for(uint j = 0; j < 7; j++)
+			D(i, j) = eT(int(i) - int(j) > 0 ? i - j : j - i);
+
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, D, metric::to_distance_matrix(euclid, 12, 7));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, D, metric::to_distance_matrix(euclid, 12, 7, false, true));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, D, metric::euclidean_matrix<eT>(12, 7));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Mat<eT>(eT(2) * D), metric::euclidean_matrix<eT>(12, 7, eT(2)));
+
+	Mat<eT> S = metric::to_distance_matrix(euclid, 12);
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, S, metric::to_distance_matrix(euclid, 12, 12, true, true));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, S, metric::euclidean_matrix<eT>(12));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, metric::to_distance_matrix(discr, 9, 4), metric::discrete_matrix<eT>(9, 4));
+
+	// grid metrics, from the table of the kernel
+	auto grid = metric::grid_manhattan<eT>(5, 3, eT(2));
+	auto asym = metric::GridMetric<eT>(4, 4, [](int dx, int dy) { return eT(3 * dx + dy + 20); });
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, metric::to_distance_matrix(Metric<eT, uint>(grid), 15), metric::to_distance_matrix(grid, 15));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, metric::to_distance_matrix(Metric<eT, uint>(grid), 15, 6), metric::to_distance_matrix(grid, 15, 6));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, metric::to_distance_matrix(Metric<eT, uint>(asym), 16), metric::to_distance_matrix(asym, 16));
+}
+
+TYPED_TEST_P(MetricTest, Graph) {
+	typedef TypeParam eT;
+
+	// on a grid graph the shortest paths are the manhattan distances
+	auto g = metric::Graph<eT>::grid(5, 4, eT(2));
+	EXPECT_EQ(2 * (4*4 + 5*3), g.n_edges());
+	Mat<eT> D = g.distances();
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, metric::to_distance_matrix(metric::grid_manhattan<eT>(5, 4, eT(2)), 20), D);
+
+	auto d = metric::graph(g);
+	EXPECT_EQ(&d.matrix(20), &d.matrix(20, 20));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(14), d(0, 19));
+
+	// directed graph, with an unreachable vertex
+	metric::Graph<eT> h(4);
+	h.add_edge(0, 1, eT(1), true);
+	h.add_edge(1, 2, eT(1), true);
+	h.add_edge(0, 2, eT(3), true);
+	h.add_edge(2, 0, eT(1), true);
+	D = h.distances();
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(2), D(0, 2));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(1), D(2, 0));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eT(2), D(1, 0));
+	EXPECT_EQ(infinity<eT>(), D(0, 3));
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, Mat<eT>(D.row(1).t()), h.distances_from(1));
+
+	Mat<eT> W(4, 4, arma::fill::zeros);
+	W(0, 1) = W(1, 2) = 1;
+	W(0, 2) = 3;
+	W(2, 0) = 1;
+	EXPECT_PRED_FORMAT2(chan_equal2<eT>, D, metric::Graph<eT>::from_weights(W).distances());
+	ASSERT_ANY_THROW(h.add_edge(0, 4, eT(1)););
 }
 
 TYPED_TEST_P(MetricTestReals, Mult_kantorovich) {
@@ -269,13 +515,117 @@ TYPED_TEST_P(MetricTestReals, Mult_kantorovich) {
 	auto p1 = probab::randu<eT>(10),
 		 p2 = probab::randu<eT>(10);
 	EXPECT_PRED_FORMAT2(equal2<eT>, mtv(p1, p2), mkant_disc(p1, p2));
+
+	// the engine, reused for many pairs, against the generalised flow program of one side
+	auto one_side = [](const Mat<eT>& D, const Prob<eT>& a, const Prob<eT>& b) -> eT {
+		uint n = a.n_cols;
+		lp::LinearProgram<eT> lp;
+		auto x = lp.make_vars(n, n, eT(0), infinity<eT>());
+		auto r = lp.make_vars(n, eT(0), infinity<eT>());
+		auto z = lp.make_var(eT(0), infinity<eT>());
+		lp.maximize = false;
+		lp.set_obj_coeff(z, eT(1));
+		for(uint i = 0; i < n; i++) {
+			auto con = lp.make_con(a(i), a(i));
+			lp.set_con_coeff(con, r[i], eT(-1));
+			for(uint j = 0; j < n; j++)
+				lp.set_con_coeff(con, x[i][j], eT(1));
+		}
+		for(uint j = 0; j < n; j++) {
+			auto con = lp.make_con(-infinity<eT>(), eT(0));
+			lp.set_con_coeff(con, r[j], eT(-1));
+			lp.set_con_coeff(con, z, -b(j));
+			for(uint i = 0; i < n; i++)
+				lp.set_con_coeff(con, x[i][j], std::exp(D(i, j)));
+		}
+		return lp.solve() ? std::log(lp.objective()) : infinity<eT>();
+	};
+
+	Mat<eT> D = metric::to_distance_matrix<eT>(euclid, 6) / eT(2);
+	D(0, 5) = D(5, 0) = eT(0.5);				// not a line any more
+	metric::MultKantorovich<eT> engine(D);
+	for(uint i = 0; i < 5; i++) {
+		Prob<eT> a = probab::randu<eT>(6), b = probab::randu<eT>(6);
+		eT expected = std::max(one_side(D, a, b), one_side(D, b, a));
+		EXPECT_PRED_FORMAT4(equal4<eT>, expected, engine(a, b), eT(1e-5), eT(1e-5));
+		EXPECT_PRED_FORMAT4(equal4<eT>, expected, engine(b, a), eT(1e-5), eT(1e-5));
+	}
+	EXPECT_PRED_FORMAT2(equal2<eT>, infinity<eT>(), metric::MultKantorovich<eT>(disc, 4)(t.unif_4, t.point_4));
+	EXPECT_ANY_THROW(engine(t.unif_4, t.unif_4));
 }
 
 
+TYPED_TEST_P(MetricTestReals, Sinkhorn) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	auto euclid = metric::euclidean<eT, uint>();
+	auto kant_lp = metric::kantorovich_lp<eT, Prob<eT>>(euclid);
+
+	// the certified interval contains the exact distance, for all pairs of the batch
+	Mat<eT> A(5, 10), B(5, 10);
+	for(uint i = 0; i < 5; i++) {
+		A.row(i) = probab::randu<eT>(10);
+		B.row(i) = probab::randu<eT>(10);
+	}
+	B.row(0) = t.point_10;
+
+	for(bool log_domain : { false, true }) {
+		metric::Sinkhorn<eT> sink(euclid, 10);
+		sink.tol = eT(1e-4);
+		sink.log_domain = log_domain;
+
+		auto [lower, upper] = sink.bounds(A, B);
+		for(uint i = 0; i < 5; i++) {
+			eT exact = kant_lp(A.row(i), B.row(i));
+			EXPECT_LE(lower(i), exact + eT(1e-4));
+			EXPECT_GE(upper(i), exact - eT(1e-4));
+			EXPECT_LE(upper(i) - lower(i), eT(0.2));
+		}
+	}
+
+	// smaller regulariser, narrower interval (needs the log domain)
+	auto sink = metric::kantorovich_sinkhorn<eT, Prob<eT>>(euclid, eT(1e-3), eT(1e-4), true);
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(9)/2, sink(t.unif_10, t.point_10), eT(0.05), eT(0));
+}
+
+TYPED_TEST_P(MetricTestReals, Expr) {
+	typedef TypeParam eT;
+	namespace ex = metric::expr;
+
+	// expressions agree with the corresponding std::function metrics
+	eT eps(0.5);
+	auto d_expr = eps * ex::grid<eT>(4);
+	Metric<eT, uint> d_fun = eps * metric::grid<eT>(4);
+
+	auto m_expr = ex::max(ex::threshold(d_expr, eT(1)), ex::discrete<eT, uint>());
+	Metric<eT, uint> m_fun = metric::max(metric::threshold(d_fun, eT(1)), metric::discrete<eT, uint>());
+
+	auto c_expr = ex::mirror(ex::min(ex::from(d_fun), ex::compose<uint>(ex::euclidean<eT, uint>(), [](uint x) -> uint { return 3*x; })));
+
+	for(uint a = 0; a < 16; a++) {
+		for(uint b = 0; b < 16; b++) {
+			EXPECT_PRED_FORMAT2(equal2<eT>, d_fun(a, b), d_expr(a, b));
+			EXPECT_PRED_FORMAT2(equal2<eT>, m_fun(a, b), m_expr(a, b));
+			EXPECT_PRED_FORMAT2(equal2<eT>, std::min(d_fun(b, a), eT(3) * abs_diff(a, b)), c_expr(a, b));
+		}
+	}
+
+	// usable as a Metric, and directly by functions templated on the metric type
+	Metric<eT, uint> erased = d_expr;
+	EXPECT_PRED_FORMAT2(equal2<eT>, d_fun(0, 5), erased(0, 5));
+
+	Chan<eT> geom = mechanism::d_privacy::geometric<eT>(10, eps);
+	auto euclid = ex::euclidean<eT, uint>();
+	EXPECT_TRUE(measure::d_privacy::is_private(geom, eps * euclid));
+	EXPECT_FALSE(measure::d_privacy::is_private(geom, (eps - eT(0.01)) * euclid));
+	EXPECT_PRED_FORMAT2(equal2<eT>, eps, measure::d_privacy::smallest_epsilon(geom, euclid));
+}
+
 // run the MetricTest test-case for double, float, urat
 //
-REGISTER_TYPED_TEST_SUITE_P(MetricTest, Euclidean_uint, Scale, Threshold, Discrete, Manhattan_point, Total_variation, Convex_separation, Kantorovich);
-REGISTER_TYPED_TEST_SUITE_P(MetricTestReals, Euclidean_point, Grid_point, Multiplicative_distance, Mult_kantorovich);
+REGISTER_TYPED_TEST_SUITE_P(MetricTest, Euclidean_uint, Scale, Threshold, Discrete, Manhattan_point, Total_variation, Convex_separation, Kantorovich, Transport_simplex, Lipschitz_parallel, Cached, Distance_matrix, Graph, L1_diameter);
+REGISTER_TYPED_TEST_SUITE_P(MetricTestReals, Min_enclosing_ball, Euclidean_point, Grid_point, Multiplicative_distance, Mult_kantorovich, Sinkhorn, Expr);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Metric, MetricTest, AllTypes);
 INSTANTIATE_TYPED_TEST_SUITE_P(Metric, MetricTestReals, NativeTypes);
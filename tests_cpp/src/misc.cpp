@@ -88,3 +88,737 @@ TEST(MiscTest, Equal) {
 }
 
 
+
+TEST(MiscTest, Parallel) {
+	uint hw = parallel::n_threads();
+
+	std::atomic<uint> sum(0);
+	parallel::for_each(100, [&](uint i) {
+		sum += i;
+		parallel::for_each(3, [&](uint j) { sum += j; });		// nested, runs sequentially
+	});
+	EXPECT_EQ(4950u + 300u, sum);
+
+	EXPECT_THROW(parallel::for_each(50, [](uint i) { if(i == 7) throw std::runtime_error("error"); }), std::runtime_error);
+
+	set_num_threads(3);
+	EXPECT_EQ(3u, get_num_threads());
+	{
+		parallel::ScopedThreads single(1);
+		EXPECT_EQ(1u, parallel::n_threads());
+
+		std::thread::id caller = std::this_thread::get_id();
+		bool same = true;
+		parallel::for_each(20, [&](uint) { same = same && std::this_thread::get_id() == caller; });
+		EXPECT_TRUE(same);
+	}
+	EXPECT_EQ(3u, get_num_threads());
+
+	set_num_threads(0);
+	EXPECT_EQ(hw, get_num_threads());
+}
+
+TEST(MiscTest, Pipeline) {
+	pipeline::Queue<int> q(3);
+	EXPECT_EQ(4u, q.capacity());
+	for(int i = 0; i < 4; i++)
+		EXPECT_TRUE(q.try_push(i));
+	int v = 10;
+	EXPECT_FALSE(q.try_push(v));
+	EXPECT_TRUE(q.try_pop(v));
+	EXPECT_EQ(0, v);
+
+	// source -> stage (4 threads) -> sink
+	pipeline::Queue<uint> numbers(8);
+	pipeline::Queue<uint64_t> squares(8);
+	uint64_t sum = 0;
+	uint count = 0;
+	pipeline::Pipeline p;
+	p.source(numbers, [](auto& emit) {
+		for(uint i = 0; i < 10000; i++)
+			emit(i);
+	});
+	p.stage(numbers, squares, 4, [](uint&& i) { return uint64_t(i) * i; });
+	p.sink(squares, [&](uint64_t&& s) { sum += s; count++; });
+	p.run();
+	EXPECT_EQ(10000u, count);
+	EXPECT_EQ(uint64_t(9999) * 10000 * 19999 / 6, sum);
+
+	// an exception stops the whole pipeline
+	pipeline::Queue<uint> numbers2(8), out2(8);
+	pipeline::Pipeline p2;
+	p2.source(numbers2, [](auto& emit) {
+		for(uint i = 0; emit(i); i++)
+			;
+	});
+	p2.stage(numbers2, out2, 2, [](uint&& i) { if(i == 100) throw std::runtime_error("error"); return i; });
+	p2.sink(out2, [](uint&&) {});
+	EXPECT_THROW(p2.run(), std::runtime_error);
+
+	// per-user reports of check-ins, at the center of a 2x2 grid (cell 3) or outside it
+	namespace fs = std::filesystem;
+	const std::string filename = (fs::temp_directory_path() / "qif_test_checkins.txt").string();
+	{
+		std::ofstream f(filename);
+		f << "1 2010-10-19T23:55:27Z 48.858072 2.348050 1\n"
+		  << "1 2010-10-19T23:55:27Z 48.858072 2.348050 1\n"
+		  << "2 2010-10-19T23:55:27Z 48.858072 2.348050 1\n"
+		  << "2 2010-10-19T23:55:27Z 30.0 2.348050 2\n"
+		  << "3 2010-10-19T23:55:27Z 30.0 2.348050 2\n";
+	}
+	gowalla::ReportOptions opt;
+	opt.batch_size = 1;
+	std::map<uint, gowalla::UserReport> reports;
+	gowalla::user_reports(filename, gowalla::Grid(locations["paris"], 2, 2, 1000), channel::identity<double>(4),
+		[&](const gowalla::UserReport& r) { reports[r.userId] = r; }, opt);
+
+	EXPECT_EQ(2u, reports.size());
+	EXPECT_EQ(2u, reports[1].n_checkins);
+	EXPECT_EQ(1u, reports[2].n_checkins);
+	EXPECT_EQ(2u, reports[1].values.size());
+	EXPECT_DOUBLE_EQ(1, reports[2].values[0]);		// all check-ins in one cell
+	EXPECT_DOUBLE_EQ(1, reports[2].values[1]);
+
+	EXPECT_ANY_THROW(gowalla::user_reports(filename, gowalla::Grid(locations["paris"], 2, 2, 1000), channel::identity<double>(3), [](const gowalla::UserReport&) {}));
+	std::remove(filename.c_str());
+}
+
+TEST(MiscTest, CheckinParsing) {
+	namespace fs = std::filesystem;
+	const std::string filename = (fs::temp_directory_path() / "qif_test_parsing.txt").string();
+
+	// tabs, CRLF, blank lines, signs, exponents (slow path) and more than 15 digits
+	{
+		std::ofstream f(filename, std::ios::binary);
+		f << "0\t2010-10-19T23:55:27Z\t30.2359091167\t-97.7951395833\t22847\n"
+		  << "\n"
+		  << "1  2010-10-18T22:17:43Z  -0.5  +12 7\r\n"
+		  << "2 2010-10-17T23:42:03Z 1.5e1 -2.5E-1 8\n"
+		  << "3 2010-10-17T23:42:03Z 48.85807212345678901 2. 9";		// no final newline
+	}
+	std::vector<gowalla::Entry> data = gowalla::read_dataset(filename);
+	ASSERT_EQ(4u, data.size());
+	std::vector<uint> users, locs;
+	for(auto& e : data) {
+		users.push_back(e.userId);
+		locs.push_back(e.locationId);
+	}
+	EXPECT_EQ(std::vector<uint>({ 0, 1, 2, 3 }), users);
+	EXPECT_EQ(std::vector<uint>({ 22847, 7, 8, 9 }), locs);
+	EXPECT_EQ(30.2359091167, data[0].location.lat);		// correctly rounded, as strtod
+	EXPECT_EQ(-97.7951395833, data[0].location.lon);
+	EXPECT_EQ(-0.5, data[1].location.lat);
+	EXPECT_EQ(12, data[1].location.lon);
+	EXPECT_EQ(15, data[2].location.lat);
+	EXPECT_EQ(-0.25, data[2].location.lon);
+	EXPECT_EQ(std::strtod("48.85807212345678901", nullptr), data[3].location.lat);
+	EXPECT_EQ(2, data[3].location.lon);
+
+	{
+		std::ofstream f(filename);
+		f << "0 2010-10-19T23:55:27Z 30.2 abc 22847\n";
+	}
+	EXPECT_ANY_THROW(gowalla::read_dataset(filename));
+	EXPECT_ANY_THROW(gowalla::for_each_entry(filename, [](const gowalla::Entry&) {}));
+
+	// a file of several MB is parsed in parallel chunks, cut at line boundaries: same entries as the sequential
+	// for_each_entry, in the same order
+	const uint n = 100000;
+	{
+		std::ofstream f(filename);
+		f.precision(17);
+		for(uint i = 0; i < n; i++)
+			f << i << " 2010-10-19T23:55:27Z " << 90 * (arma::randu() - 0.5) << " " << 360 * (arma::randu() - 0.5) << " " << i % 1000 << "\n";
+	}
+	ASSERT_GT(fs::file_size(filename), 2u << 20);
+
+	data = gowalla::read_dataset(filename);
+	ASSERT_EQ(n, data.size());
+	uint i = 0;
+	gowalla::for_each_entry(filename, [&](const gowalla::Entry& e) {
+		EXPECT_EQ(i, data[i].userId);
+		EXPECT_EQ(e.userId, data[i].userId);
+		EXPECT_EQ(e.locationId, data[i].locationId);
+		EXPECT_EQ(e.location.lat, data[i].location.lat);
+		EXPECT_EQ(e.location.lon, data[i].location.lon);
+		i++;
+	});
+	EXPECT_EQ(n, i);
+
+	// to_grid on the file (a single parallel pass) agrees with to_grid on the dataset
+	EXPECT_EQ(gowalla::to_grid(data, latlon(0, 0), 10, 10, 1000000), gowalla::to_grid(filename, latlon(0, 0), 10, 10, 1000000));
+	std::remove(filename.c_str());
+}
+
+TEST(MiscTest, ColumnarCache) {
+	namespace fs = std::filesystem;
+	const std::string filename = (fs::temp_directory_path() / "qif_test_columns.bin").string();
+
+	const uint n = 1000;
+	std::vector<gowalla::Entry> dataset(n);
+	for(uint i = 0; i < n; i++) {
+		dataset[i].userId = i / 10;
+		dataset[i].locationId = 3 * i;
+		dataset[i].location = latlon(locations["paris"].lat + 0.1 * (arma::randu() - 0.5), locations["paris"].lon + 0.1 * (arma::randu() - 0.5));
+	}
+	latlon center = locations["paris"];
+
+	// without a grid, the cells are computed from the mapped columns
+	gowalla::write_columns(filename, dataset);
+	{
+		gowalla::Columns cols = gowalla::read_columns(filename);
+		ASSERT_EQ(n, cols.size);
+		EXPECT_EQ(nullptr, cols.cell);
+		EXPECT_FALSE(cols.has_grid(center, 10, 10, 500));
+		for(uint i = 0; i < n; i++) {
+			EXPECT_EQ(dataset[i].location.lat, cols.lat[i]);
+			EXPECT_EQ(dataset[i].location.lon, cols.lon[i]);
+			EXPECT_EQ(dataset[i].userId, cols.userId[i]);
+			EXPECT_EQ(dataset[i].locationId, cols.locationId[i]);
+		}
+		EXPECT_EQ(gowalla::to_grid(dataset, center, 10, 10, 500), gowalla::to_grid(cols, center, 10, 10, 500));
+	}
+
+	// with a grid, the precomputed cells are used for the same grid, and recomputed for a different one
+	gowalla::write_columns(filename, dataset, center, 10, 10, 500);
+	{
+		gowalla::Columns cols = gowalla::read_columns(filename);
+		ASSERT_EQ(n, cols.size);
+		ASSERT_NE(nullptr, cols.cell);
+		EXPECT_TRUE(cols.has_grid(center, 10, 10, 500));
+		EXPECT_FALSE(cols.has_grid(center, 10, 10, 250));
+		EXPECT_EQ(10u, cols.width);
+		EXPECT_EQ(500, cols.cell_size);
+		EXPECT_EQ(dataset[n-1].location.lon, cols.lon[n-1]);
+		EXPECT_EQ(dataset[n-1].locationId, cols.locationId[n-1]);
+
+		auto pts = gowalla::to_grid(dataset, center, 10, 10, 500);
+		EXPECT_LT(pts.size(), n);
+		EXPECT_EQ(pts, gowalla::to_grid(cols, center, 10, 10, 500));
+		EXPECT_PRED2(equal2<double>, gowalla::to_grid_prior(dataset, center, 10, 10, 500), gowalla::to_grid_prior(cols, center, 10, 10, 500));
+		EXPECT_EQ(gowalla::to_grid(dataset, center, 4, 6, 1000), gowalla::to_grid(cols, center, 4, 6, 1000));
+	}
+
+	// empty dataset
+	gowalla::write_columns(filename, {});
+	EXPECT_EQ(0u, gowalla::read_columns(filename).size);
+
+	// not a columns file, truncated file
+	{
+		std::ofstream f(filename);
+		f << std::string(100, 'x');
+	}
+	EXPECT_ANY_THROW(gowalla::read_columns(filename));
+
+	gowalla::write_columns(filename, dataset);
+	fs::resize_file(filename, fs::file_size(filename) - 4);
+	EXPECT_ANY_THROW(gowalla::read_columns(filename));
+
+	// a header-only file whose size (at offset 16) times the 24 bytes per entry overflows to 0
+	gowalla::write_columns(filename, {});
+	{
+		std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+		uint64_t size = uint64_t(1) << 61;
+		f.seekp(16);
+		f.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	}
+	EXPECT_ANY_THROW(gowalla::read_columns(filename));
+	std::remove(filename.c_str());
+}
+
+TEST(MiscTest, Gridding) {
+	// random check-ins around paris, some of them outside the grids, more than one block (4096) of the batched pass
+	const uint n = 10000;
+	std::vector<gowalla::Entry> dataset(n);
+	std::vector<double> lat(n), lon(n);
+	for(uint i = 0; i < n; i++) {
+		dataset[i].userId = i;
+		dataset[i].locationId = i;
+		dataset[i].location = latlon(locations["paris"].lat + 0.1 * (arma::randu() - 0.5), locations["paris"].lon + 0.1 * (arma::randu() - 0.5));
+		lat[i] = dataset[i].location.lat;
+		lon[i] = dataset[i].location.lon;
+	}
+	std::vector<gowalla::Grid> grids = {
+		gowalla::Grid(locations["paris"], 20, 20, 250),
+		gowalla::Grid(locations["paris"], 7, 5, 1000),
+		gowalla::Grid(locations["paris"], 1, 1, 100000),
+	};
+
+	auto points = gowalla::to_grid(lat.data(), lon.data(), n, grids);
+	auto priors = gowalla::to_grid_prior(lat.data(), lon.data(), n, grids);
+	auto priors2 = gowalla::to_grid_prior(dataset, grids);
+	ASSERT_EQ(grids.size(), points.size());
+	ASSERT_EQ(grids.size(), priors.size());
+
+	for(uint g = 0; g < grids.size(); g++) {
+		const gowalla::Grid& gr = grids[g];
+
+		// the single-grid versions, and a naive histogram of the cells
+		auto pts = gowalla::to_grid(dataset, gr.center, gr.width, gr.height, gr.cell_size);
+		EXPECT_EQ(pts, points[g]);
+		EXPECT_GT(pts.size(), 0u);
+
+		prob hist(gr.width * gr.height, arma::fill::zeros);
+		for(uint c : pts) {
+			ASSERT_LT(c, gr.width * gr.height);
+			hist(c)++;
+		}
+		hist /= arma::accu(hist);
+		EXPECT_PRED2(equal2<double>, hist, priors[g]);
+		EXPECT_PRED2(equal2<double>, hist, priors2[g]);
+		EXPECT_PRED2(equal2<double>, hist, gowalla::to_grid_prior(dataset, gr.center, gr.width, gr.height, gr.cell_size));
+	}
+	EXPECT_LT(points[0].size(), n);		// 5km x 5km, some are outside
+	EXPECT_EQ(n, points[2].size());		// 100km x 100km, all inside
+
+	EXPECT_TRUE(gowalla::to_grid(std::vector<gowalla::Entry>(), locations["paris"], 2, 2, 1000).empty());
+	EXPECT_ANY_THROW(gowalla::to_grid_prior(std::vector<gowalla::Entry>(), grids));
+
+	// quadtree over a 5km square, its prior is the histogram of the projected check-ins over the leaves
+	auto projected = gowalla::project_dummy(dataset, locations["paris"], 5000, 5000);
+	auto tree = gowalla::to_quadtree(dataset, locations["paris"], 5000, 100, 50);
+	EXPECT_GT(tree.n_leaves(), 4u);
+	EXPECT_LE(tree.max_depth(), 6u);			// leaves of at least 50m: 5000 / 2^6 >= 50 > 5000 / 2^7
+	for(uint k = 0; k < tree.n_leaves(); k++)
+		EXPECT_GE(tree.leaf(k).size, 50);
+
+	prob qpi = gowalla::to_quadtree_prior(dataset, locations["paris"], tree);
+	prob qhist(tree.n_leaves(), arma::fill::zeros);
+	for(auto& p : projected)
+		if(tree.inside(p))
+			qhist(tree.locate(p))++;
+	qhist /= arma::accu(qhist);
+	EXPECT_PRED2(equal2<double>, qhist, qpi);
+}
+
+TEST(MiscTest, FloatAccumulation) {
+	// float channels are summed in double, so the measures agree with the double ones up to the float rounding of
+	// the individual elements, independently of the size
+	const uint n = 700;
+	chan Cd = channel::randu<double>(n, n);
+	prob pid = probab::randu<double>(n);
+	fchan Cf = arma::conv_to<fchan>::from(Cd);
+	fprob pif = arma::conv_to<fprob>::from(pid);
+	mat Gd = channel::randu<double>(5, n);
+	fchan Gf = arma::conv_to<fchan>::from(Gd);
+
+	auto rel = [](double a, double b) { return std::abs(a - b) / std::abs(b); };
+	EXPECT_LT(rel(measure::bayes_vuln::posterior(pif, Cf), measure::bayes_vuln::posterior(pid, Cd)), 1e-6);
+	EXPECT_LT(rel(measure::g_vuln::posterior(Gf, pif, Cf), measure::g_vuln::posterior(Gd, pid, Cd)), 1e-5);
+	EXPECT_LT(rel(measure::shannon::posterior(pif, Cf), measure::shannon::posterior(pid, Cd)), 1e-5);
+
+	fchan Nf = Cf * 3.0f;
+	channel::normalize(Nf);
+	EXPECT_LT(arma::abs(arma::sum(arma::conv_to<mat>::from(Nf), 1) - 1.0).max(), 1e-6);
+
+	// mechanisms and the kantorovich engine
+	EXPECT_LT(arma::abs(arma::conv_to<mat>::from(mechanism::geo_ind::planar_laplace_grid<float>(5, 5, 1, 0.5f, "quadrature"))
+		- mechanism::geo_ind::planar_laplace_grid<double>(5, 5, 1, 0.5, "quadrature")).max(), 1e-6);
+
+	mat D = metric::to_distance_matrix<double>(metric::euclidean<double, uint>(), 20);
+	prob a = probab::randu<double>(20), b = probab::randu<double>(20);
+	double kd = metric::Kantorovich<double>(D)(a, b);
+	float kf = metric::Kantorovich<float>(arma::conv_to<fchan>::from(D))(arma::conv_to<fprob>::from(a), arma::conv_to<fprob>::from(b));
+	EXPECT_LT(rel(kf, kd), 1e-5);
+}
+
+TEST(MiscTest, RatAux) {
+	// DotAccumulator is exact across the int64 boundary (128-bit sums), and when it overflows 128 bits (mppp fallback)
+	auto check = [](const std::vector<std::pair<rat, rat>>& terms) {
+		rat_aux::DotAccumulator acc;
+		rat expected(0);
+		for(auto& [a, b] : terms) {
+			acc.add(a, b);
+			expected += a * b;
+		}
+		EXPECT_EQ(expected, acc.result());
+	};
+	const int64_t big = std::numeric_limits<int64_t>::max();
+	const rat huge = rat(mppp::integer<1>(big) * mppp::integer<1>(big));		// does not fit in int64
+
+	std::vector<std::pair<rat, rat>> terms;
+	for(uint i = 0; i < 10; i++)
+		terms.push_back({ rat(big - i), rat(3) });					// sum beyond int64
+	check(terms);
+	for(uint i = 0; i < 10; i++)
+		terms.push_back({ rat(big - i), rat(big) });				// sum beyond 128 bits
+	check(terms);
+
+	terms.clear();
+	for(int64_t p : { 2147483647ll, 2147483629ll, 2147483587ll, 2147483579ll, 2147483563ll })
+		terms.push_back({ rat(1, p), rat(p - 1, p + 2) });			// common denominator beyond 128 bits
+	check(terms);
+
+	terms.push_back({ huge, rat(1, 3) });							// operands outside int64
+	terms.push_back({ rat(-5, 7), rat(big, 11) });
+	terms.push_back({ rat(0), huge });
+	check(terms);
+
+	// the arrays kept by the pool are bounded
+	{
+		std::vector<Mat<rat>> Ms;
+		for(uint k = 0; k < 6; k++)
+			Ms.emplace_back(1024, 512);			// released together, more than the cap
+	}
+	EXPECT_LE(rat_aux::Pool::retained(), rat_aux::Pool::max_cached_bytes);
+}
+
+TEST(MiscTest, CompensatedSum) {
+	// 1 followed by many terms that are lost in a plain double sum
+	const uint n = 1001;
+	arma::vec v(n);
+	v(0) = 1;
+	v.tail(n - 1).fill(1e-16);
+
+	double plain = 0;
+	for(double x : v)
+		plain += x;
+	EXPECT_EQ(1.0, plain);
+
+	const double exact = 1 + 1e-13;
+	EXPECT_NEAR(exact, compensated_accu(v), 1e-16);
+
+	CompensatedSum<double> single;
+	for(double x : v)
+		single.add(x);
+	EXPECT_NEAR(exact, single.value(), 1e-16);
+
+	LargeSum<double> large;
+	for(double x : v)
+		large.add(x);
+	EXPECT_NEAR(exact, large.value(), 1e-16);
+
+	// terms larger than the running sum (plain Kahan fails here)
+	arma::vec w = { 1, 1e100, 1, -1e100 };
+	EXPECT_EQ(2.0, compensated_accu(w));
+
+	// rats are exact
+	rprob r("1/3 1/6 1/2");
+	EXPECT_EQ(rat(1), compensated_accu<rat>(r));
+}
+
+TEST(MiscTest, Gpu) {
+	// never on the device for rats or small problems
+	EXPECT_FALSE(gpu::use<rat>(1e12));
+	EXPECT_FALSE(gpu::use<double>(1));
+
+	if(!gpu::available())
+		GTEST_SKIP() << "no CUDA device";
+
+	chan C = channel::randu<double>(200, 300);
+	mat G = channel::randu<double>(7, 200);
+	mat Pis(50, 200);
+	for(uint k = 0; k < Pis.n_rows; k++)
+		Pis.row(k) = probab::randu<double>(200);
+
+	gpu::DeviceChan<double> D(C);
+	prob v = probab::randu<double>(200), res;
+	D.left(v, res);
+	EXPECT_LT(arma::abs(res - v * C).max(), 1e-10);
+
+	arma::rowvec w = arma::randu<arma::rowvec>(300);
+	D.right(w, res);
+	EXPECT_LT(arma::abs(res - w * C.t()).max(), 1e-10);
+
+	for(bool minimize : { false, true }) {
+		arma::vec dev = D.posterior_batch(G, Pis, minimize);
+		for(uint k = 0; k < Pis.n_rows; k++)
+			EXPECT_NEAR(measure::g_vuln::aux::fused_posterior<double>(G, Pis.row(k), C, minimize), dev(k), 1e-10);
+	}
+
+	// the backend can be turned off
+	gpu::set_enabled(false);
+	EXPECT_FALSE(gpu::use<double>(1e12));
+	gpu::set_enabled(true);
+}
+
+TEST(MiscTest, GeoBatch) {
+	// batch conversions agree with the per-point ones, out-of-grid points are masked
+	uint width = 4, height = 3;
+	auto c2p = geo::cell_to_point<double>(width, 0.5, point(1, 2));
+	auto p2c = geo::point_to_cell<double>(width, 0.5, point(1, 2));
+
+	arma::ucolvec cells = arma::regspace<arma::ucolvec>(0, width * height - 1);
+	arma::vec xs, ys;
+	geo::cells_to_points<double>(cells, width, 0.5, point(1, 2), xs, ys);
+	for(uint k = 0; k < cells.n_elem; k++) {
+		EXPECT_EQ(c2p(k), point(xs(k), ys(k)));
+		EXPECT_EQ(k, p2c(point(xs(k), ys(k))));
+	}
+
+	xs.resize(xs.n_elem + 2);
+	ys.resize(ys.n_elem + 2);
+	xs(xs.n_elem - 2) = 0;		ys(ys.n_elem - 2) = 2;		// left of the grid
+	xs(xs.n_elem - 1) = 1;		ys(ys.n_elem - 1) = 4;		// above the grid
+	arma::ucolvec res;
+	arma::uchar_vec mask;
+	geo::points_to_cells<double>(xs, ys, width, height, 0.5, point(1, 2), res, mask);
+	EXPECT_TRUE(arma::all(res.head(cells.n_elem) == cells));
+	EXPECT_EQ(cells.n_elem, arma::accu(arma::conv_to<arma::uvec>::from(mask)));
+	EXPECT_EQ(0, mask(xs.n_elem - 1));
+
+	geo::points_to_cells<double>(xs, ys, width, 0, 0.5, point(1, 2), res, mask);		// unbounded upwards
+	EXPECT_EQ(1, mask(xs.n_elem - 1));
+}
+
+TEST(MiscTest, SpatialIndex) {
+	// compare against brute force, with the default and a given bucket size
+	const uint n = 300;
+	arma::vec xs = arma::randu<arma::vec>(n) * 10, ys = arma::randu<arma::vec>(n) * 3;
+	xs.head(20).fill(5);		// duplicated x coordinates
+
+	for(double bucket_size : { 0.0, 0.7 }) {
+		geo::SpatialIndex<double> index(xs, ys, bucket_size);
+		EXPECT_EQ(n, index.size());
+
+		arma::vec qx = arma::randu<arma::vec>(100) * 14 - 2, qy = arma::randu<arma::vec>(100) * 5 - 1;
+		arma::ucolvec near = index.nearest(qx, qy);
+
+		for(uint q = 0; q < qx.n_elem; q++) {
+			arma::vec d = arma::sqrt(arma::square(xs - qx(q)) + arma::square(ys - qy(q)));
+			EXPECT_EQ(d.index_min(), near(q));
+
+			double radius = 0.5 + q % 3;
+			std::vector<uint> expected;
+			for(uint k = 0; k < n; k++)
+				if(d(k) <= radius)
+					expected.push_back(k);
+			EXPECT_EQ(expected, index.within(point(qx(q), qy(q)), radius));
+		}
+	}
+
+	EXPECT_ANY_THROW(geo::SpatialIndex<double>(std::vector<point>()).nearest(point(0, 0)));
+}
+
+TEST(MiscTest, Trace) {
+	trace::clear();
+
+	// Span is available also without QIF_TRACE (which only controls the library's spans), nothing is recorded while disabled
+	{ trace::Span s("misc::disabled"); }
+
+	trace::set_enabled(true);
+	{
+		trace::Span outer("misc::outer");
+		parallel::for_each(4, [](uint) { trace::Span inner("misc::inner"); });
+	}
+	std::string json = trace::chrome_json();
+	trace::set_enabled(false);
+
+	auto count = [&](const std::string& s) {
+		uint n = 0;
+		for(size_t pos = json.find(s); pos != std::string::npos; pos = json.find(s, pos + 1))
+			n++;
+		return n;
+	};
+	EXPECT_EQ(0u, count("misc::disabled"));
+	EXPECT_EQ(1u, count("\"misc::outer\""));
+	EXPECT_EQ(4u, count("\"misc::inner\""));
+	EXPECT_EQ(0u, json.find("{\"displayTimeUnit\""));
+
+	trace::clear();
+	EXPECT_EQ(std::string::npos, trace::chrome_json().find("misc::"));
+}
+
+TEST(MiscTest, Workspace) {
+	workspace::Workspace ws(100);
+
+	// bump allocation, rewind, and merging of the blocks once everything is released
+	auto m = ws.mark();
+	void* a = ws.alloc(10);
+	void* b = ws.alloc(80);
+	EXPECT_EQ(0u, reinterpret_cast<size_t>(a) % workspace::Workspace::alignment);
+	EXPECT_EQ(0u, reinterpret_cast<size_t>(b) % workspace::Workspace::alignment);
+	EXPECT_EQ(2u, ws.n_blocks());
+	EXPECT_EQ(192u, ws.used());
+	ws.rewind(m);
+	EXPECT_EQ(0u, ws.used());
+	EXPECT_EQ(1u, ws.n_blocks());
+	EXPECT_EQ(192u, ws.capacity());
+
+	// measures give the same results with a workspace, and reuse it in later calls
+	Mat<double> G = arma::randu<Mat<double>>(5, 100);
+	Chan<double> C = channel::randu<double>(100, 150);
+	Prob<double> pi = probab::randu<double>(100);
+	double vg = measure::g_vuln::posterior(G, pi, C);
+	double guess = measure::guessing::posterior(pi, C);
+	auto hyper = channel::hyper(C, pi);
+
+	{
+		workspace::Scoped scoped(ws);
+		EXPECT_EQ(&ws, workspace::current());
+		EXPECT_DOUBLE_EQ(vg, measure::g_vuln::posterior(G, pi, C));
+
+		size_t capacity = ws.capacity();
+		EXPECT_DOUBLE_EQ(vg, measure::g_vuln::posterior(G, pi, C));
+		EXPECT_EQ(capacity, ws.capacity());
+		EXPECT_EQ(1u, ws.n_blocks());
+		EXPECT_EQ(0u, ws.used());
+
+		EXPECT_DOUBLE_EQ(guess, measure::guessing::posterior(pi, C));
+		auto hyper2 = channel::hyper(C, pi);
+		EXPECT_TRUE(arma::approx_equal(hyper.first, hyper2.first, "absdiff", 1e-12));
+		EXPECT_TRUE(arma::approx_equal(hyper.second, hyper2.second, "absdiff", 1e-12));
+	}
+	EXPECT_EQ(nullptr, workspace::current());
+}
+
+TEST(MiscTest, Sweep) {
+	namespace fs = std::filesystem;
+	const std::string dir = (fs::temp_directory_path() / "qif_test_sweep").string();
+	const std::string dir2 = dir + "_dist";
+	fs::remove_all(dir);
+	fs::remove_all(dir2);
+
+	sweep::Grid grid;
+	grid.add("epsilon", { 0.5, 1, 2 }).add("width", { 2, 3 });
+	EXPECT_EQ(6u, grid.size());
+	EXPECT_EQ(1.0, grid[3].at("epsilon"));
+	EXPECT_EQ(3.0, grid[3].at("width"));
+
+	// the first attempt of task 1 fails, task 5 always fails
+	std::atomic<uint> calls(0), flaky(0);
+	sweep::Task<double> f = [&](const sweep::Params& p) {
+		calls++;
+		if(p.at("epsilon") == 0.5 && p.at("width") == 3 && flaky++ == 0)
+			throw std::runtime_error("flaky");
+		if(p.at("epsilon") == 2 && p.at("width") == 3)
+			throw std::runtime_error("always");
+		return Mat<double>(mechanism::geo_ind::planar_laplace_grid<double>(p.at("width"), 1, 1, p.at("epsilon")));
+	};
+
+	sweep::Report r = sweep::run<double>(grid, f, dir);
+	EXPECT_EQ(std::vector<uint>({ 0, 1, 2, 3, 4 }), r.done);
+	EXPECT_EQ(std::vector<uint>({ 5 }), r.failed);
+	EXPECT_EQ("always", r.errors[5]);
+	EXPECT_TRUE(arma::approx_equal(
+		mechanism::geo_ind::planar_laplace_grid<double>(3, 1, 1, 1), sweep::load_result<double>(dir, 3), "absdiff", 1e-12));
+
+	// resuming only runs the failed task
+	calls = 0;
+	r = sweep::run<double>(grid, f, dir);
+	EXPECT_EQ(3u, calls);
+	EXPECT_EQ(5u, r.done.size());
+	EXPECT_THROW(sweep::aggregate<double>(grid, dir), std::runtime_error);
+
+	// through the work queue, with two workers
+	sweep::Task<double> g = [](const sweep::Params& p) {
+		return Mat<double>({ p.at("epsilon") * p.at("width"), 1 });
+	};
+	sweep::Options opt;
+	opt.connect_timeout = 10;
+	sweep::Server server(grid, dir2, 0, opt);
+	std::atomic<uint> completed(0);
+	std::vector<std::thread> workers;
+	for(uint i = 0; i < 2; i++)
+		workers.emplace_back([&] { completed += sweep::work<double>("localhost", server.port(), g, dir2, opt); });
+	r = server.run();
+	for(auto& w : workers)
+		w.join();
+	EXPECT_EQ(6u, r.done.size());
+	EXPECT_TRUE(r.failed.empty());
+	EXPECT_EQ(6u, completed);
+
+	// one row per task: parameters, then the elements of the result
+	Mat<double> A = sweep::aggregate<double>(grid, dir2);
+	EXPECT_EQ(6u, A.n_rows);
+	EXPECT_EQ(4u, A.n_cols);
+	EXPECT_TRUE(arma::approx_equal(Mat<double>({ 1, 3, 3, 1 }), Mat<double>(A.row(3)), "absdiff", 1e-12));
+
+	// with a token: a silent client does not hold up the others, a wrong token gets nothing, and an OK without a
+	// result is a failed attempt
+	fs::remove_all(dir2);
+	opt.token = "secret";
+	opt.max_retries = 0;
+	sweep::Server server2(grid, dir2, 0, opt);
+	auto silent = sweep::aux::connect("127.0.0.1", server2.port());
+	ASSERT_TRUE(silent);
+
+	auto start = std::chrono::steady_clock::now();
+	std::thread fake([&] {
+		sweep::Options wrong = opt;
+		wrong.token = "guess";
+		wrong.connect_timeout = 1;
+		EXPECT_EQ(0u, sweep::work<double>("localhost", server2.port(), g, dir2, wrong));
+
+		std::istringstream task(sweep::aux::request("localhost", server2.port(), "GET", 10, opt.token));
+		std::string cmd;
+		uint id;
+		task >> cmd >> id;
+		EXPECT_EQ("TASK", cmd);
+		EXPECT_EQ("ACK", sweep::aux::request("localhost", server2.port(), "OK " + std::to_string(id), 10, opt.token));
+		EXPECT_EQ(5u, sweep::work<double>("localhost", server2.port(), g, dir2, opt));
+		EXPECT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 9.0);		// io timeout is 10
+		silent.reset();
+	});
+	r = server2.run();
+	fake.join();
+	EXPECT_EQ(5u, r.done.size());
+	ASSERT_EQ(1u, r.failed.size());
+	EXPECT_EQ("missing or invalid result", r.errors[r.failed[0]]);
+	EXPECT_FALSE(sweep::has_result(dir2, r.failed[0]));
+
+	opt.token = "with space";
+	EXPECT_THROW(sweep::Server(grid, dir2, 0, opt), std::runtime_error);
+	opt.token = "";
+	opt.bind_address = "not an address";
+	EXPECT_THROW(sweep::Server(grid, dir2, 0, opt), std::runtime_error);
+
+	fs::remove_all(dir);
+	fs::remove_all(dir2);
+}
+
+TEST(MiscTest, Checkpoint) {
+	namespace fs = std::filesystem;
+	const std::string file = (fs::temp_directory_path() / "qif_test_checkpoint.bin").string();
+	fs::remove(file);
+
+	// iterative_bayesian_update: interrupted after 50 steps (max_reps), then resumed from the file
+	Chan<double> C = mechanism::d_privacy::geometric<double>(20, 0.3);
+	Prob<double> out = probab::randu<double>(20) * C;
+	auto [pi, steps] = channel::iterative_bayesian_update(C, out, {}, 1e-10);
+	ASSERT_GT(steps, 50u);
+
+	auto hook = checkpoint::file<channel::IbuState<double>>(file, 10);
+	EXPECT_FALSE(hook.resume.has_value());
+	channel::iterative_bayesian_update(C, out, {}, 1e-10, 50, "em", hook);
+
+	hook = checkpoint::file<channel::IbuState<double>>(file, 10);
+	ASSERT_TRUE(hook.resume.has_value());
+	EXPECT_EQ(50u, hook.resume->count);
+	EXPECT_EQ(50u, channel::iterative_bayesian_update(C, out, {}, 1e-10, 30, "em", hook).second);		// already past max_reps
+	auto [pi2, steps2] = channel::iterative_bayesian_update(C, out, {}, 1e-10, 0, "em", hook);
+	EXPECT_EQ(steps, steps2);
+	EXPECT_TRUE(arma::approx_equal(pi, pi2, "absdiff", 0));
+	fs::remove(file);
+
+	// factorize_subgrad and minmax_hidden_bayes, resumed from the state saved at some iteration
+	Chan<double> B = channel::randu<double>(10, 15), A = B * channel::randu<double>(15, 10);
+	Chan<double> X = channel::factorize_subgrad(A, B);
+
+	checkpoint::Hook<channel::FactorizeState<double>> fhook;
+	fhook.every = 1;
+	fhook.save = [&](const channel::FactorizeState<double>& s) { if(!fhook.resume) fhook.resume = s; };
+	channel::factorize_subgrad(A, B, false, 1e-4, fhook);
+	if(fhook.resume) {		// the least-squares start might already be a solution
+		fhook.save = nullptr;
+		EXPECT_TRUE(arma::approx_equal(X, channel::factorize_subgrad(A, B, false, 1e-4, fhook), "absdiff", 0));
+	}
+
+	Prob<double> prior = probab::randu<double>(5);
+	std::vector<std::vector<chan>> Cs(3);
+	for(auto& row : Cs)
+		for(uint d = 0; d < 2; d++)
+			row.push_back(channel::randu<double>(5, 4));
+	auto res = games::minmax_hidden_bayes(prior, Cs, 1e-3, 500, "entropic");
+
+	checkpoint::Hook<games::HiddenBayesState<double>> ghook;
+	ghook.every = 20;
+	ghook.save = [&](const games::HiddenBayesState<double>& s) { if(!ghook.resume) ghook.resume = games::HiddenBayesState<double>::unpack(s.pack()); };
+	games::minmax_hidden_bayes(prior, Cs, 1e-3, 500, "entropic", ghook);
+	if(ghook.resume) {
+		ghook.save = nullptr;
+		auto res2 = games::minmax_hidden_bayes(prior, Cs, 1e-3, 500, "entropic", ghook);
+		EXPECT_EQ(res.first, res2.first);
+		EXPECT_TRUE(arma::approx_equal(res.second, res2.second, "absdiff", 0));
+	}
+}
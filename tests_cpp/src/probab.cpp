@@ -64,9 +64,34 @@ TYPED_TEST_P(ProbTest, Dirac) {
 }
 
 
+TYPED_TEST_P(ProbTest, Sample) {
+	typedef TypeParam eT;
+
+	Prob<eT> pi(format_num<eT>("0.1 0 0.3 0.05 0.55 0"));
+	AliasSampler sampler(pi);
+
+	uint n = 200000;
+	Row<uint> s = sampler.fill(n, 42);
+	EXPECT_TRUE(arma::all(s == sampler.fill(n, 42)));		// same seed, same draws
+
+	Row<double> freq(pi.n_cols, arma::fill::zeros);
+	for(uint x : s)
+		freq(x) += 1.0 / n;
+	for(uint x = 0; x < pi.n_cols; x++)
+		EXPECT_NEAR(to_double(pi(x)), freq(x), 0.01);
+
+	// channel rows
+	Chan<eT> C(format_num<eT>("1 0; 0.5 0.5; 0 1"));
+	Prob<eT> pi2(format_num<eT>("0.5 0 0.5"));
+	Mat<uint> xy = channel::Sampler(C, pi2).fill(1000);
+	for(uint i = 0; i < xy.n_rows; i++)
+		EXPECT_TRUE((xy(i, 0) == 0 && xy(i, 1) == 0) || (xy(i, 0) == 2 && xy(i, 1) == 1));
+}
+
+
 // run the ProbTest test-case for double, float, urat
 //
-REGISTER_TYPED_TEST_SUITE_P(ProbTest, Construct, Uniform, Randu, Dirac);
+REGISTER_TYPED_TEST_SUITE_P(ProbTest, Construct, Uniform, Randu, Dirac, Sample);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Prob, ProbTest, AllTypes);
 
@@ -83,6 +83,15 @@ TYPED_TEST_P(RefinementTestReals, Refined_by) {
 	EXPECT_TRUE(G1.empty());
 	EXPECT_TRUE(G2.empty());
 	EXPECT_PRED_FORMAT4(chan_equal4<eT>, t.crand_10*R, T, 1e-3, 0);
+
+	// many B's against the same A, reusing the QP
+	refinement::Projector<eT> proj(t.crand_10);
+	EXPECT_TRUE(proj(T, G2, R));
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, t.crand_10*R, T, 1e-3, 0);
+	EXPECT_TRUE(proj(t.noint_10, G2, R));
+	EXPECT_PRED_FORMAT4(chan_equal4<eT>, t.crand_10*R, t.noint_10, 1e-3, 0);
+	EXPECT_FALSE(proj(t.id_10, G2, R));
+	EXPECT_TRUE(g_vuln::posterior(G2, t.unif_10, t.crand_10) < g_vuln::posterior(G2, t.unif_10, t.id_10));
 }
 
 TYPED_TEST_P(RefinementTest, Add_metric) {
@@ -101,6 +110,28 @@ TYPED_TEST_P(RefinementTest, Add_metric) {
 	EXPECT_PRED_FORMAT4(equal4<eT>, eT(0), refinement::add_metric(t.unif_10, t.crand_10, T).first, eT(1e-5), eT(0));
 	}
 
+	// splitting a column in two halves and adding zero outputs does not change the metric
+	//
+	Chan<eT> A = format_rat<eT>("1/10 2/5 1/10 2/5; 1/5 1/5 3/10 3/10; 1/2 1/10 1/10 3/10"),
+			 B = format_rat<eT>("1/5 11/50 29/50; 1/5 2/5  2/5; 7/20 2/5 1/4"),
+			 A2 = arma::join_rows(arma::join_rows(A, arma::zeros<Chan<eT>>(3, 1)), Col<eT>(A.col(1) / eT(2)));
+	A2.col(1) /= eT(2);
+	Prob<eT> pi = format_rat<eT>("62/100 3/100 35/100");
+	auto [m1, G1] = refinement::add_metric<eT>(pi, A, B);
+	auto [m2, G2] = refinement::add_metric<eT>(pi, A2, B);
+	EXPECT_PRED_FORMAT4(equal4<eT>, m1, m2, eT(0), eT(1e-5));
+	EXPECT_EQ(A2.n_cols + B.n_cols + 1, G2.n_rows);
+
+	// same with the lazily generated constraints
+	size_t lazy_cons = refinement::aux::add_metric_lazy_cons;
+	refinement::aux::add_metric_lazy_cons = 0;
+	auto [m3, G3] = refinement::add_metric<eT>(pi, A2, B);
+	refinement::aux::add_metric_lazy_cons = lazy_cons;
+	EXPECT_PRED_FORMAT4(equal4<eT>, m1, m3, eT(0), eT(1e-5));
+	EXPECT_EQ(A2.n_cols + B.n_cols + 1, G3.n_rows);
+	for(uint x = 0; x < G3.n_cols; x++)
+		EXPECT_PRED_FORMAT2(equal2<eT>, eT(0), G3(A.n_cols, x));		// the zero column of A2
+
 	// this was causing simplex without Bland rule to loop!
 	//
 	EXPECT_PRED_FORMAT4(equal4<eT>, eT(18643)/2220000, refinement::add_metric<eT>(
@@ -110,9 +141,100 @@ TYPED_TEST_P(RefinementTest, Add_metric) {
     ).first, eT(0), eT(1e-5));
 }
 
+TYPED_TEST_P(RefinementTest, Add_metric_bound) {
+	typedef TypeParam eT;
+
+	Chan<eT> A = format_rat<eT>("1/10 2/5 1/10 2/5; 1/5 1/5 3/10 3/10; 1/2 1/10 1/10 3/10"),
+			 B = format_rat<eT>("1/5 11/50 29/50; 1/5 2/5  2/5; 7/20 2/5 1/4");
+	Prob<eT> pi = format_rat<eT>("62/100 3/100 35/100");
+
+	// same as the Kantorovich LP on the joint space of inners
+	auto HA = channel::hyper_compact(A, pi), HB = channel::hyper_compact(B, pi);
+	Mat<eT> inners = arma::join_rows(HA.inners, HB.inners);
+	Prob<eT> a = arma::join_rows(HA.outer, Prob<eT>(HB.outer.n_elem, arma::fill::zeros)),
+			 b = arma::join_rows(Prob<eT>(HA.outer.n_elem, arma::fill::zeros), HB.outer);
+	auto q = metric::compose<eT,uint,Prob<eT>>(
+		metric::convex_separation_quasi<eT, Prob<eT>>(),
+		[&](uint i) -> Prob<eT> { return inners.col(i).t(); }
+	);
+	eT lp = metric::kantorovich_lp<eT, Prob<eT>>(q)(a, b),
+	   bound = refinement::add_metric_bound(pi, A, B);
+	EXPECT_PRED_FORMAT4(equal4<eT>, lp, bound, eT(1e-6), eT(1e-6));
+	EXPECT_PRED_FORMAT2(equal2<eT>, bound, refinement::hyper_kantorovich(HA, HB));
+
+	// it bounds the metric, and is 0 for the same hyper
+	EXPECT_LE(refinement::add_metric(pi, A, B).first, bound + eT(1e-6));
+	EXPECT_PRED_FORMAT4(equal4<eT>, eT(0), refinement::add_metric_bound(pi, A, A), eT(1e-6), eT(0));
+
+	// batch
+	std::vector<std::pair<Chan<eT>, Chan<eT>>> pairs = { { A, B }, { B, A }, { A, A } };
+	Col<eT> res = refinement::add_metric_bounds(pi, pairs);
+	for(uint k = 0; k < pairs.size(); k++)
+		EXPECT_PRED_FORMAT2(equal2<eT>, refinement::add_metric_bound(pi, pairs[k].first, pairs[k].second), res(k));
+}
+
+TYPED_TEST_P(RefinementTest, Order) {
+	typedef TypeParam eT;
+	BaseTest<eT>& t = *this;
+
+	// exact small channels (deterministic merges of the identity)
+	Chan<eT> A = channel::deterministic<eT>(arma::ucolvec({ 0, 0, 1, 1 }), 2),
+			 B = channel::deterministic<eT>(arma::ucolvec({ 0, 1, 1, 2 }), 3);
+
+	EXPECT_TRUE (refinement::aux::supports_compatible(t.id_4, A));
+	EXPECT_FALSE(refinement::aux::supports_compatible(A, B));
+	EXPECT_FALSE(refinement::aux::supports_compatible(A, t.id_4));
+
+	EXPECT_TRUE (refinement::refined_by(t.id_4, A));
+	EXPECT_FALSE(refinement::refined_by(A, t.id_4));
+	EXPECT_FALSE(refinement::refined_by(A, B));
+
+	arma::umat expected = { { 1, 1, 1, 1 },
+							{ 0, 1, 0, 1 },
+							{ 0, 0, 1, 1 },
+							{ 0, 0, 0, 1 } };
+	arma::umat M = refinement::order<eT>({ t.id_4, A, B, t.noint_4 });
+	EXPECT_TRUE(arma::all(arma::vectorise(M == expected)));
+
+	// a duplicate and an equivalent channel (the identity with permuted columns) are in the same class
+	Chan<eT> P = channel::deterministic<eT>(arma::ucolvec({ 1, 0, 3, 2 }), 4);
+	auto L = refinement::lattice<eT>({ t.id_4, A, B, t.noint_4, t.id_4, P });
+	EXPECT_TRUE(arma::all(L.cls == arma::uvec({ 0, 1, 2, 3, 0, 0 })));
+	EXPECT_EQ(1u, L.refined(5, 1));
+	EXPECT_EQ(0u, L.refined(1, 5));
+
+	std::set<std::pair<uint,uint>> edges(L.edges.begin(), L.edges.end()), expected_edges = { {0, 1}, {0, 2}, {1, 3}, {2, 3} };
+	EXPECT_EQ(expected_edges, edges);
+
+	// the cache compares the channels on a hash match (here a forced collision), and keeps the newest entries
+	refinement::aux::RefinementCache<eT> cache;
+	auto ptr = [](const Chan<eT>& C) { return std::make_shared<const Chan<eT>>(C); };
+	cache.insert(1, 2, ptr(t.id_4), ptr(A), true);
+	EXPECT_EQ(std::optional<bool>(true), cache.find(1, 2, t.id_4, A));
+	EXPECT_FALSE(cache.find(1, 2, t.id_4, B));
+	EXPECT_FALSE(cache.find(2, 1, t.id_4, A));
+
+	size_t max_entries = refinement::aux::refinement_cache_max_entries;
+	refinement::aux::refinement_cache_max_entries = 2;
+	cache.insert(1, 2, ptr(t.id_4), ptr(B), true);
+	cache.insert(3, 4, ptr(A), ptr(B), false);
+	EXPECT_EQ(2u, cache.size());
+	EXPECT_FALSE(cache.find(1, 2, t.id_4, A));					// evicted
+	EXPECT_EQ(std::optional<bool>(true), cache.find(1, 2, t.id_4, B));
+	EXPECT_EQ(std::optional<bool>(false), cache.find(3, 4, A, B));
+
+	// lattice with a (shared) cache that keeps only 2 pairs
+	refinement::aux::RefinementCache<eT>::instance().clear();
+	auto L2 = refinement::lattice<eT>({ t.id_4, A, B, t.noint_4, t.id_4, P });
+	EXPECT_TRUE(arma::all(L2.cls == L.cls));
+	EXPECT_TRUE(arma::all(arma::vectorise(L2.refined == L.refined)));
+	EXPECT_LE(refinement::aux::RefinementCache<eT>::instance().size(), 2u);
+	refinement::aux::refinement_cache_max_entries = max_entries;
+}
+
 // run the RefinementTest test-case for all types, and the RefinementTestReals only for double/float
 //
-REGISTER_TYPED_TEST_SUITE_P(RefinementTest, Add_metric);
+REGISTER_TYPED_TEST_SUITE_P(RefinementTest, Add_metric, Add_metric_bound, Order);
 REGISTER_TYPED_TEST_SUITE_P(RefinementTestReals, Refined_by);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(Refinement, RefinementTest, AllTypes);
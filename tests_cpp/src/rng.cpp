@@ -0,0 +1,42 @@
+#include "tests_aux.h"
+
+
+TEST(RngTest, Philox) {
+	// known-answer test of Philox4x32-10 (counter = key = 0), from the Random123 distribution
+	rng::Philox gen(0, 0);
+	EXPECT_EQ(0xe169c58d6627e8d5ull, gen());
+	EXPECT_EQ(0x9b00dbd8bc57ac4cull, gen());
+
+	// jump-ahead is equivalent to drawing
+	for(uint skip = 0; skip < 5; skip++) {
+		rng::Philox a(7, 3), b(7, 3);
+		a();
+		b();
+		for(uint i = 0; i < skip; i++)
+			a();
+		b.discard(skip);
+		EXPECT_EQ(a(), b());
+	}
+
+	// different streams differ
+	EXPECT_NE(rng::stream(1, 0)(), rng::stream(1, 1)());
+}
+
+TEST(RngTest, Seed) {
+	rng::set_seed(123);
+	double u = rng::randu<double>();
+	float f = rng::randu<float>();
+	rng::set_seed(123);
+	EXPECT_EQ(u, rng::randu<double>());
+	EXPECT_EQ(f, rng::randu<float>());
+
+	EXPECT_GE(u, 0);
+	EXPECT_LT(u, 1);
+
+	// parallel draws only depend on the seed
+	Row<uint> a = probab::AliasSampler(probab::uniform<double>(10)).fill(300000, 5);
+	Row<uint> b = probab::AliasSampler(probab::uniform<double>(10)).fill(300000, 5);
+	EXPECT_TRUE(arma::all(a == b));
+
+	rng::set_seed_random();
+}